@@ -115,6 +115,28 @@
  */
 # define CELLULAR_CTRL_SECURITY_ROOT_OF_TRUST 1
 
+# ifndef CELLULAR_SOCK_PROMPT_GUARD_TIME_MS
+/** The minimum time to wait between receiving the '@' prompt
+ * of AT+USOWR/AT+USOST and sending the data, measured from
+ * the arrival of the prompt.
+ */
+#  define CELLULAR_SOCK_PROMPT_GUARD_TIME_MS 50
+# endif
+
+/** The maximum amount of socket data that may be carried in an
+ * AT+USOWR/AT+USOST command in hex mode, see
+ * cellularCtrlSetSockHexMode().
+ */
+# define CELLULAR_SOCK_HEX_MODE_MAX_LENGTH_BYTES 512
+
+# ifndef CELLULAR_SOCK_DNS_CME_ERROR_HOST_NOT_FOUND
+/** The +CME ERROR code with which the module answers AT+UDNSRN
+ * when the DNS server says that the host name does not exist,
+ * as opposed to the look-up not being possible at the time.
+ */
+#  define CELLULAR_SOCK_DNS_CME_ERROR_HOST_NOT_FOUND 1504
+# endif
+
 /** Whether MQTT is supported by the module or not.
  */
 # define CELLULAR_MQTT_IS_SUPPORTED 1
@@ -212,6 +234,28 @@
 #  define CELLULAR_CTRL_SECURITY_ROOT_OF_TRUST 0
 # endif
 
+# ifndef CELLULAR_SOCK_PROMPT_GUARD_TIME_MS
+/** The minimum time to wait between receiving the '@' prompt
+ * of AT+USOWR/AT+USOST and sending the data, measured from
+ * the arrival of the prompt.
+ */
+#  define CELLULAR_SOCK_PROMPT_GUARD_TIME_MS 50
+# endif
+
+/** The maximum amount of socket data that may be carried in an
+ * AT+USOWR/AT+USOST command in hex mode, see
+ * cellularCtrlSetSockHexMode().
+ */
+# define CELLULAR_SOCK_HEX_MODE_MAX_LENGTH_BYTES 512
+
+# ifndef CELLULAR_SOCK_DNS_CME_ERROR_HOST_NOT_FOUND
+/** The +CME ERROR code with which the module answers AT+UDNSRN
+ * when the DNS server says that the host name does not exist,
+ * as opposed to the look-up not being possible at the time.
+ */
+#  define CELLULAR_SOCK_DNS_CME_ERROR_HOST_NOT_FOUND 1504
+# endif
+
 # ifndef CELLULAR_MQTT_IS_SUPPORTED
 /** Whether MQTT is supported by the module or not.
  * Note: the SARA-R412M-02B modules shipped on C030-R412M
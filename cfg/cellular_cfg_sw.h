@@ -33,6 +33,58 @@
 # define CELLULAR_CFG_ENABLE_LOGGING                 1
 #endif
 
+#ifndef CELLULAR_CFG_SOCK_HEX_MODE
+/** Set this to 1 to put the cellular module into hex mode
+ * (AT+UDCONF=1,1) for socket data by default; it may be
+ * changed at run-time with cellularCtrlSetSockHexMode().
+ * In hex mode, sends of up to
+ * CELLULAR_SOCK_HEX_MODE_MAX_LENGTH_BYTES are carried
+ * in the AT command itself, avoiding the '@' prompt and the
+ * guard time that follows it, at the cost of doubling the
+ * number of bytes that cross the UART for all socket data,
+ * received data included.
+ */
+# define CELLULAR_CFG_SOCK_HEX_MODE                  0
+#endif
+
+#ifndef CELLULAR_CFG_SOCK_TLS_OFFLOAD
+/** Set this to 1 to have the secure sockets of Amazon FreeRTOS
+ * (iot_secure_sockets.c) leave TLS to the cellular module, see
+ * cellularSockTlsProfileGet(), rather than running mbedTLS on
+ * the MCU over a plain socket: the handshake is then done by
+ * the module, saving the RAM of mbedTLS and the AT transactions
+ * that carry the handshake, and a reconnect to the same server
+ * resumes the TLS session.  ALPN is not supported.
+ */
+# define CELLULAR_CFG_SOCK_TLS_OFFLOAD               0
+#endif
+
+#ifndef CELLULAR_CFG_SOCK_TLS_OFFLOAD_ROOT_CA_NAME
+/** With CELLULAR_CFG_SOCK_TLS_OFFLOAD, the name of the root CA,
+ * already stored in the cellular module, e.g. with
+ * cellularSockTlsStoreCredential() when the device is provisioned,
+ * against which servers are checked when the application has not
+ * given a trusted server certificate.
+ */
+# define CELLULAR_CFG_SOCK_TLS_OFFLOAD_ROOT_CA_NAME  "root-ca"
+#endif
+
+#ifndef CELLULAR_CFG_SOCK_TLS_OFFLOAD_CLIENT_CERT_NAME
+/** With CELLULAR_CFG_SOCK_TLS_OFFLOAD, the name of the client
+ * certificate, already stored in the cellular module, with which
+ * the device identifies itself to servers; NULL for none.
+ */
+# define CELLULAR_CFG_SOCK_TLS_OFFLOAD_CLIENT_CERT_NAME NULL
+#endif
+
+#ifndef CELLULAR_CFG_SOCK_TLS_OFFLOAD_CLIENT_KEY_NAME
+/** With CELLULAR_CFG_SOCK_TLS_OFFLOAD, the name of the private
+ * key of the client certificate, already stored in the cellular
+ * module; NULL for none.
+ */
+# define CELLULAR_CFG_SOCK_TLS_OFFLOAD_CLIENT_KEY_NAME NULL
+#endif
+
 #endif // _CELLULAR_CFG_SW_H_
 
 // End of file
@@ -116,10 +116,44 @@
 # define CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT  7
 #endif
 
+#ifndef CELLULAR_CFG_TEST_BLACK_HOLE_IP_ADDRESS
+/** An IP address at which a TCP connection is never answered,
+ * for testing connect timeouts; by default one from TEST-NET-1,
+ * which should go nowhere.
+ */
+# define CELLULAR_CFG_TEST_BLACK_HOLE_IP_ADDRESS  "192.0.2.1"
+#endif
+
+#ifndef CELLULAR_CFG_TEST_ECHO_TLS_SERVER_DOMAIN_NAME
+/** Echo server to use for TLS sockets testing as a domain name.
+ * The default is only good for the simulator, which doesn't
+ * actually do TLS; with a real module this should be an echo
+ * server that runs TLS, and CELLULAR_CFG_TEST_TLS_ROOT_CA its
+ * root CA.
+ */
+# define CELLULAR_CFG_TEST_ECHO_TLS_SERVER_DOMAIN_NAME  CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME
+#endif
+
+#ifndef CELLULAR_CFG_TEST_ECHO_TLS_SERVER_PORT
+/** Port number on the echo server to use for TLS testing.
+ */
+# define CELLULAR_CFG_TEST_ECHO_TLS_SERVER_PORT  443
+#endif
+
+#ifndef CELLULAR_CFG_TEST_TLS_ROOT_CA
+/** The root CA, PEM format, against which the TLS echo server
+ * is checked.  The default is a placeholder that only the
+ * simulator will accept.
+ */
+# define CELLULAR_CFG_TEST_TLS_ROOT_CA  "-----BEGIN CERTIFICATE-----\n" \
+                                        "cellular test root CA placeholder\n" \
+                                        "-----END CERTIFICATE-----\n"
+#endif
+
 #ifndef CELLULAR_CFG_TEST_LOCAL_PORT
 /** Local port number, used when testing binding.
  */
-# define CELLULAR_CFG_TEST_LOCAL_PORT 65543
+# define CELLULAR_CFG_TEST_LOCAL_PORT 50007
 #endif
 
 #ifndef CELLULAR_CFG_TEST_UDP_RETRIES
@@ -188,6 +188,73 @@ extern "C" {
  */
 #define CELLULAR_CTRL_END_TO_END_ENCRYPT_HEADER_SIZE_BYTES 32
 
+/** The AT interface is shared out between clients, see
+ * cellular_ctrl_at_lock_client(), by an arbiter: waiting clients
+ * of higher priority go first and, within a priority, clients
+ * share the time for which the AT interface is held in proportion
+ * to their weight.  These are the fixed clients.
+ */
+#define CELLULAR_CTRL_AT_CLIENT_URC  0 //<! The URC task.
+#define CELLULAR_CTRL_AT_CLIENT_CTRL 1 //<! Control, used by
+                                       //< cellular_ctrl_at_lock().
+#define CELLULAR_CTRL_AT_CLIENT_MQTT 2 //<! MQTT.
+#define CELLULAR_CTRL_AT_CLIENT_SOCK 3 //<! The first of the clients
+                                       //< for sockets, one each.
+
+/** The number of AT clients: the fixed ones plus
+ * one for each socket.
+ */
+#ifndef CELLULAR_CTRL_AT_MAX_NUM_CLIENTS
+# define CELLULAR_CTRL_AT_MAX_NUM_CLIENTS (CELLULAR_CTRL_AT_CLIENT_SOCK + 7)
+#endif
+
+/** The number of tasks that may be waiting for the AT
+ * interface at any one time; any more wait their turn to
+ * wait.
+ */
+#ifndef CELLULAR_CTRL_AT_MAX_NUM_WAITERS
+# define CELLULAR_CTRL_AT_MAX_NUM_WAITERS 10
+#endif
+
+/** The default priority of the URC task.  It goes first
+ * since URCs waiting in the UART get in the way of every
+ * other client.
+ */
+#ifndef CELLULAR_CTRL_AT_CLIENT_URC_PRIORITY
+# define CELLULAR_CTRL_AT_CLIENT_URC_PRIORITY 2
+#endif
+
+/** The default priority of control: ahead of data, so
+ * that control commands are not held up by a task pumping
+ * data through the module.
+ */
+#ifndef CELLULAR_CTRL_AT_CLIENT_CTRL_PRIORITY
+# define CELLULAR_CTRL_AT_CLIENT_CTRL_PRIORITY 1
+#endif
+
+/** The default priority of MQTT and of each socket.
+ */
+#ifndef CELLULAR_CTRL_AT_CLIENT_DATA_PRIORITY
+# define CELLULAR_CTRL_AT_CLIENT_DATA_PRIORITY 0
+#endif
+
+/** The default weight of every client.
+ */
+#ifndef CELLULAR_CTRL_AT_CLIENT_WEIGHT
+# define CELLULAR_CTRL_AT_CLIENT_WEIGHT 1
+#endif
+
+/** The default maximum time for which a client should hold
+ * the AT interface in one turn.  An AT command in progress
+ * can't be cut short, so a turn that goes on longer is counted
+ * as an overrun and charged in full against the client's share;
+ * the URC task, which processes as many URCs as are waiting,
+ * gives way at this point if others are waiting.
+ */
+#ifndef CELLULAR_CTRL_AT_MAX_HOLD_TIME_MS
+# define CELLULAR_CTRL_AT_MAX_HOLD_TIME_MS 1000
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -278,6 +345,21 @@ typedef enum {
     CELLULAR_CTRL_MAX_NUM_NETWORK_STATUS
 } CellularCtrlNetworkStatus_t;
 
+/** Statistics for a client of the AT interface, see
+ * cellularCtrlGetAtClientStats().
+ */
+typedef struct {
+    size_t numTurns;      //<! Times the client had the AT interface.
+    size_t numWaits;      //<! Turns for which the client had to wait.
+    size_t queueDepth;    //<! Turns the client is waiting for now.
+    size_t maxQueueDepth; //<! The most it has waited for at once.
+    int64_t totalWaitMs;  //<! Time spent waiting.
+    int64_t maxWaitMs;    //<! The longest wait.
+    int64_t totalHoldMs;  //<! Time spent holding the AT interface.
+    int64_t maxHoldMs;    //<! The longest turn.
+    size_t numOverruns;   //<! Turns longer than the maximum hold time.
+} CellularCtrlAtClientStats_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS
  * -------------------------------------------------------------- */
@@ -344,6 +426,65 @@ bool cellularCtrlIsPowered();
  */
 bool cellularCtrlIsAlive();
 
+/** Set the priority and weight of a client of the AT
+ * interface, e.g. CELLULAR_CTRL_AT_CLIENT_MQTT; the settings
+ * of all clients are returned to their defaults by
+ * cellularCtrlInit().
+ *
+ * @param client   the client.
+ * @param priority the priority, higher goes first.
+ * @param weight   the weight, at least 1: within a priority,
+ *                 a client of weight 2 gets twice the time
+ *                 on the AT interface of a client of weight 1.
+ * @return         zero on success or negative error code.
+ */
+int32_t cellularCtrlSetAtClient(int32_t client, int32_t priority,
+                                int32_t weight);
+
+/** Set the maximum time for which a client should hold the
+ * AT interface in one turn; see CELLULAR_CTRL_AT_MAX_HOLD_TIME_MS,
+ * to which it is returned by cellularCtrlInit().
+ *
+ * @param maxHoldTimeMs the maximum hold time.
+ * @return              zero on success or negative error code.
+ */
+int32_t cellularCtrlSetAtMaxHoldTime(int32_t maxHoldTimeMs);
+
+/** Get the statistics of a client of the AT interface: how
+ * often and for how long it has waited and held the AT
+ * interface.
+ *
+ * @param client the client.
+ * @param pStats a place to put the statistics.
+ * @return       zero on success or negative error code.
+ */
+int32_t cellularCtrlGetAtClientStats(int32_t client,
+                                     CellularCtrlAtClientStats_t *pStats);
+
+/** Reset the statistics of all clients of the AT interface,
+ * except for their queue depth.
+ */
+void cellularCtrlResetAtClientStats();
+
+/** Set whether socket data is carried in hex (AT+UDCONF=1):
+ * see CELLULAR_CFG_SOCK_HEX_MODE, which sets the default
+ * that cellularCtrlInit() returns to.  If the module is
+ * powered the setting is applied to it immediately, so the
+ * module must then be responsive, else it is applied when
+ * the module is powered on.  It may be changed with sockets
+ * open.
+ *
+ * @param onNotOff true to carry socket data in hex, else false.
+ * @return         zero on success or negative error code.
+ */
+int32_t cellularCtrlSetSockHexMode(bool onNotOff);
+
+/** Get whether socket data is carried in hex.
+ *
+ * @return true if socket data is carried in hex, else false.
+ */
+bool cellularCtrlGetSockHexMode();
+
 /** Power the cellular module on.  If this function returns
  * success then the cellular module is ready to receive configuration
  * commands and register with the cellular network.  The caller
@@ -104,6 +104,12 @@ static int32_t gUart;
  */
 static int32_t gAtNumConsecutiveTimeouts;
 
+/** Whether socket data is carried in hex; only changed with
+ * the AT interface locked, so that the sockets code sees it
+ * change in step with the module.
+ */
+static bool gSockHexMode = CELLULAR_CFG_SOCK_HEX_MODE;
+
 /** The current registration statuses, one for each RAN.
  */
 static CellularCtrlNetworkStatus_t gNetworkStatus[CELLULAR_CTRL_MAX_NUM_RANS];
@@ -429,6 +435,8 @@ static CellularCtrlErrorCode_t moduleConfigure(int32_t uart)
         moduleConfigureOne(uart, "AT+CPSMS=0") && 
         // TODO switch off UART power saving until it is integrated into this API
         moduleConfigureOne(uart, "AT+UPSV=0") &&
+        // Socket data in hex, if required
+        (!gSockHexMode || moduleConfigureOne(uart, "AT+UDCONF=1,1")) &&
         moduleConfigureOne(uart, "ATI9") &&
         // Stay in airplane mode until commanded to connect
         moduleConfigureOne(uart, "AT+CFUN=4")) {
@@ -950,6 +958,7 @@ int32_t cellularCtrlInit(int32_t pinEnablePower,
                             }
                             clearRadioParameters();
                             gAtNumConsecutiveTimeouts = 0;
+                            gSockHexMode = CELLULAR_CFG_SOCK_HEX_MODE;
                             cellular_ctrl_at_set_at_timeout_callback(atTimeoutCallback);
                             gInitialised = true;
                         }
@@ -1006,6 +1015,114 @@ bool cellularCtrlIsAlive()
     return isAlive;
 }
 
+// Set the priority and weight of a client of the AT interface.
+int32_t cellularCtrlSetAtClient(int32_t client, int32_t priority,
+                                int32_t weight)
+{
+    CellularCtrlErrorCode_t errorCode = CELLULAR_CTRL_NOT_INITIALISED;
+
+    if (gInitialised) {
+        errorCode = CELLULAR_CTRL_INVALID_PARAMETER;
+        if (cellular_ctrl_at_set_client(client, priority,
+                                        weight) == CELLULAR_CTRL_AT_SUCCESS) {
+            errorCode = CELLULAR_CTRL_SUCCESS;
+        }
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Set the maximum hold time of the AT interface.
+int32_t cellularCtrlSetAtMaxHoldTime(int32_t maxHoldTimeMs)
+{
+    CellularCtrlErrorCode_t errorCode = CELLULAR_CTRL_NOT_INITIALISED;
+
+    if (gInitialised) {
+        errorCode = CELLULAR_CTRL_INVALID_PARAMETER;
+        if (maxHoldTimeMs > 0) {
+            cellular_ctrl_at_set_max_hold_time(maxHoldTimeMs);
+            errorCode = CELLULAR_CTRL_SUCCESS;
+        }
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Get the statistics of a client of the AT interface.
+int32_t cellularCtrlGetAtClientStats(int32_t client,
+                                     CellularCtrlAtClientStats_t *pStats)
+{
+    CellularCtrlErrorCode_t errorCode = CELLULAR_CTRL_NOT_INITIALISED;
+    cellular_ctrl_at_client_stats_t stats;
+
+    if (gInitialised) {
+        errorCode = CELLULAR_CTRL_INVALID_PARAMETER;
+        if ((pStats != NULL) &&
+            (cellular_ctrl_at_get_client_stats(client,
+                                               &stats) == CELLULAR_CTRL_AT_SUCCESS)) {
+            pStats->numTurns = stats.num_turns;
+            pStats->numWaits = stats.num_waits;
+            pStats->queueDepth = stats.queue_depth;
+            pStats->maxQueueDepth = stats.max_queue_depth;
+            pStats->totalWaitMs = stats.total_wait_ms;
+            pStats->maxWaitMs = stats.max_wait_ms;
+            pStats->totalHoldMs = stats.total_hold_ms;
+            pStats->maxHoldMs = stats.max_hold_ms;
+            pStats->numOverruns = stats.num_overruns;
+            errorCode = CELLULAR_CTRL_SUCCESS;
+        }
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Reset the statistics of all clients of the AT interface.
+void cellularCtrlResetAtClientStats()
+{
+    if (gInitialised) {
+        cellular_ctrl_at_reset_client_stats();
+    }
+}
+
+// Set whether socket data is carried in hex.
+int32_t cellularCtrlSetSockHexMode(bool onNotOff)
+{
+    CellularCtrlErrorCode_t errorCode = CELLULAR_CTRL_NOT_INITIALISED;
+
+    if (gInitialised) {
+        errorCode = CELLULAR_CTRL_SUCCESS;
+        if (onNotOff != gSockHexMode) {
+            if (cellularCtrlIsPowered()) {
+                // Tell the module and change the flag before
+                // unlocking so that no socket data can be
+                // sent or read in between
+                errorCode = CELLULAR_CTRL_AT_ERROR;
+                cellular_ctrl_at_lock();
+                cellular_ctrl_at_cmd_start("AT+UDCONF=");
+                cellular_ctrl_at_write_int(1);
+                cellular_ctrl_at_write_int(onNotOff);
+                cellular_ctrl_at_cmd_stop_read_resp();
+                if (cellular_ctrl_at_get_last_error() == 0) {
+                    gSockHexMode = onNotOff;
+                    errorCode = CELLULAR_CTRL_SUCCESS;
+                }
+                cellular_ctrl_at_unlock();
+            } else {
+                // The module will be told at power on
+                gSockHexMode = onNotOff;
+            }
+        }
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Get whether socket data is carried in hex.
+bool cellularCtrlGetSockHexMode()
+{
+    return gSockHexMode;
+}
+
 // Power the cellular module on.
 int32_t cellularCtrlPowerOn(const char *pPin)
 {
@@ -29,6 +29,7 @@
 # include "cellular_cfg_override.h" // For a customer's configuration override
 #endif
 #include "cellular_cfg_sw.h"
+#include "cellular_cfg_module.h"
 #include "cellular_cfg_os_platform_specific.h"
 #include "cellular_port_clib.h"
 #include "cellular_port.h"
@@ -37,6 +38,7 @@
 #include "cellular_port_gpio.h"
 #include "cellular_port_uart.h"
 #include "cellular_ctrl_at.h"
+#include "cellular_ctrl.h" // For the AT clients
 
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
@@ -59,6 +61,10 @@
 // interface
 #define CELLULAR_CTRL_AT_BUFF_SIZE        1024
 
+// The virtual time of the AT arbiter advances by this much for
+// each millisecond a client of weight 1 holds the UART stream.
+#define CELLULAR_CTRL_AT_ARBITER_TAG_SCALE 1000
+
 // A marker to check for buffer overruns
 #define CELLULAR_CTRL_AT_MARKER           "DEADBEEF"
 
@@ -196,6 +202,25 @@ typedef enum {
     CELLULAR_CTRL_AT_CONTROL_TERMINATE
 } cellular_ctrl_at_control_t;
 
+// A client of the AT arbiter.
+typedef struct {
+    int32_t priority;
+    int32_t weight;
+    int64_t finish_tag; // Virtual time at which its last turn ended
+    cellular_ctrl_at_client_stats_t stats;
+} cellular_ctrl_at_client_t;
+
+// A task waiting for its turn on the UART stream.
+typedef struct {
+    bool in_use;
+    bool granted;       // It is its turn, it just hasn't woken up yet
+    int32_t client;
+    int64_t start_tag;  // Virtual time at which its turn should start
+    uint32_t sequence;  // Order of arrival, to break ties
+    int64_t wait_start_ms;
+    CellularPortQueueHandle_t queue; // Sent an item when it is its turn
+} cellular_ctrl_at_waiter_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -208,8 +233,31 @@ static const uint8_t _map_3gpp_errors[][2] =  {
     { 146, 46 }, { 178, 65 }, { 179, 66 }, { 180, 48 }, { 181, 83 }, { 171, 49 },
 };
 
-// Mutex to control access to the UART stream.
-static CellularPortMutexHandle_t _mtx_stream;
+// The arbiter that controls access to the UART stream, sharing
+// it out between clients by start-time fair queueing within
+// strict priorities.  The mutex protects the arbiter, nothing
+// else.
+static CellularPortMutexHandle_t _mtx_arbiter;
+static cellular_ctrl_at_client_t _clients[CELLULAR_CTRL_AT_MAX_NUM_CLIENTS];
+static cellular_ctrl_at_waiter_t _waiters[CELLULAR_CTRL_AT_MAX_NUM_WAITERS];
+
+// Whether the UART stream is held and, if so, by which client,
+// since when and from which virtual time.
+static bool _arbiter_busy;
+static int32_t _arbiter_client;
+static int64_t _arbiter_turn_start_ms;
+static int64_t _arbiter_turn_start_tag;
+
+// The virtual time of the arbiter: the start tag of the
+// turn in progress or of the last one.
+static int64_t _arbiter_virtual_time;
+
+// Incremented for each waiter, see cellular_ctrl_at_waiter_t.
+static uint32_t _arbiter_sequence;
+
+// The maximum time for which a client should hold the UART
+// stream in one turn.
+static int32_t _max_hold_time_ms;
 
 // Task buffer and task stack for the URC task.
 static CellularPortTaskHandle_t _task_handle_urc;
@@ -294,6 +342,25 @@ static bool _debug_on = false;
 // Whether printing of AT commands and responses is on or off
 static bool _print_at_on = true;
 
+// The number of bytes written to and read from the UART
+static size_t _num_bytes_written = 0;
+static size_t _num_bytes_read = 0;
+
+// Table to encode a nibble as a hex character.
+static const char _hex_encode[] = {'0', '1', '2', '3', '4', '5', '6', '7',
+                                   '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
+
+// Table to decode a hex character, either case, to a nibble;
+// anything that isn't hex decodes as zero.
+static const uint8_t _hex_decode[256] = {['0'] = 0x0, ['1'] = 0x1, ['2'] = 0x2,
+                                         ['3'] = 0x3, ['4'] = 0x4, ['5'] = 0x5,
+                                         ['6'] = 0x6, ['7'] = 0x7, ['8'] = 0x8,
+                                         ['9'] = 0x9, ['a'] = 0xa, ['b'] = 0xb,
+                                         ['c'] = 0xc, ['d'] = 0xd, ['e'] = 0xe,
+                                         ['f'] = 0xf, ['A'] = 0xa, ['B'] = 0xb,
+                                         ['C'] = 0xc, ['D'] = 0xd, ['E'] = 0xe,
+                                         ['F'] = 0xf};
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -320,15 +387,7 @@ int32_t hex_str_to_int(const char *hex_string, int32_t hex_string_length)
 
 int32_t hex_str_to_char_str(const char *str, int32_t len, char *buf)
 {
-    int32_t str_count = 0;
-    for (size_t i = 0; i + 1 < len; i += 2) {
-        int32_t upper = hex_str_to_int(str + i, 1);
-        int32_t lower = hex_str_to_int(str + i + 1, 1);
-        buf[str_count] = ((upper << 4) & 0xF0) | (lower & 0x0F);
-        str_count++;
-    }
-
-    return str_count;
+    return (int32_t) cellular_ctrl_at_hex_decode(buf, str, len);
 }
 
 // Copy content of one char buffer to another
@@ -465,6 +524,7 @@ static bool fill_buffer(bool wait_for_timeout)
         if (len > 0) {
             print_at((char *) (_buf.recv_buff) + _buf.recv_len, len);
             _buf.recv_len += len;
+            _num_bytes_read += len;
             return true;
         }
     }
@@ -829,6 +889,7 @@ static size_t write(const void *data, size_t len)
         }
 #endif
         write_len += (size_t) ret;
+        _num_bytes_written += (size_t) ret;
     }
 
     _print_at_on = print_at_on;
@@ -875,12 +936,229 @@ static bool find_urc_handler(const char *prefix)
     return false;
 }
 
+// Set the clients of the arbiter to their defaults.
+static void arbiter_reset()
+{
+    _arbiter_busy = false;
+    _arbiter_virtual_time = 0;
+    _arbiter_sequence = 0;
+    _max_hold_time_ms = CELLULAR_CTRL_AT_MAX_HOLD_TIME_MS;
+    pCellularPort_memset(_clients, 0, sizeof(_clients));
+    for (size_t x = 0; x < CELLULAR_CTRL_AT_MAX_NUM_CLIENTS; x++) {
+        _clients[x].priority = CELLULAR_CTRL_AT_CLIENT_DATA_PRIORITY;
+        _clients[x].weight = CELLULAR_CTRL_AT_CLIENT_WEIGHT;
+    }
+    _clients[CELLULAR_CTRL_AT_CLIENT_URC].priority = CELLULAR_CTRL_AT_CLIENT_URC_PRIORITY;
+    _clients[CELLULAR_CTRL_AT_CLIENT_CTRL].priority = CELLULAR_CTRL_AT_CLIENT_CTRL_PRIORITY;
+}
+
+// Create the arbiter, returning false on failure.
+static bool arbiter_create()
+{
+    bool success = false;
+    size_t x;
+
+    if (cellularPortMutexCreate(&_mtx_arbiter) == 0) {
+        success = true;
+        for (x = 0; success && (x < CELLULAR_CTRL_AT_MAX_NUM_WAITERS); x++) {
+            _waiters[x].in_use = false;
+            if (cellularPortQueueCreate(1, sizeof(int32_t),
+                                        &(_waiters[x].queue)) != 0) {
+                success = false;
+                while (x > 0) {
+                    x--;
+                    cellularPortQueueDelete(_waiters[x].queue);
+                }
+                cellularPortMutexDelete(_mtx_arbiter);
+            }
+        }
+    }
+    if (success) {
+        arbiter_reset();
+    }
+
+    return success;
+}
+
+// Delete the arbiter.
+static void arbiter_delete()
+{
+    for (size_t x = 0; x < CELLULAR_CTRL_AT_MAX_NUM_WAITERS; x++) {
+        cellularPortQueueDelete(_waiters[x].queue);
+    }
+    cellularPortMutexDelete(_mtx_arbiter);
+}
+
+// Give the UART stream to a client.
+// This does NOT lock the arbiter, you need to do that.
+static void arbiter_grant(int32_t client, int64_t start_tag)
+{
+    _arbiter_busy = true;
+    _arbiter_client = client;
+    _arbiter_turn_start_ms = cellularPortGetTickTimeMs();
+    _arbiter_turn_start_tag = start_tag;
+    if (start_tag > _arbiter_virtual_time) {
+        _arbiter_virtual_time = start_tag;
+    }
+    _clients[client].stats.num_turns++;
+}
+
+// Return true if waiter1 should go before waiter2.
+// This does NOT lock the arbiter, you need to do that.
+static bool arbiter_goes_first(const cellular_ctrl_at_waiter_t *waiter1,
+                               const cellular_ctrl_at_waiter_t *waiter2)
+{
+    int32_t priority1 = _clients[waiter1->client].priority;
+    int32_t priority2 = _clients[waiter2->client].priority;
+
+    if (priority1 != priority2) {
+        return priority1 > priority2;
+    }
+    if (waiter1->start_tag != waiter2->start_tag) {
+        return waiter1->start_tag < waiter2->start_tag;
+    }
+
+    return (int32_t) (waiter1->sequence - waiter2->sequence) < 0;
+}
+
+// Wait for the turn of a client on the UART stream.
+static void arbiter_acquire(int32_t client)
+{
+    cellular_ctrl_at_client_t *c = &(_clients[client]);
+    cellular_ctrl_at_waiter_t *waiter = NULL;
+    int64_t start_tag;
+    int64_t wait_ms;
+    int32_t item;
+    bool granted = false;
+
+    while (!granted && (waiter == NULL)) {
+        CELLULAR_PORT_MUTEX_LOCK(_mtx_arbiter);
+
+        // A client can't start before the end of its last
+        // turn in virtual time: this is what shares out the
+        // stream in proportion to weight
+        start_tag = _arbiter_virtual_time;
+        if (start_tag < c->finish_tag) {
+            start_tag = c->finish_tag;
+        }
+        if (!_arbiter_busy) {
+            // Nobody is waiting if the stream is free
+            arbiter_grant(client, start_tag);
+            granted = true;
+        } else {
+            for (size_t x = 0; (waiter == NULL) &&
+                               (x < CELLULAR_CTRL_AT_MAX_NUM_WAITERS); x++) {
+                if (!_waiters[x].in_use) {
+                    waiter = &(_waiters[x]);
+                    waiter->in_use = true;
+                    waiter->granted = false;
+                    waiter->client = client;
+                    waiter->start_tag = start_tag;
+                    waiter->sequence = _arbiter_sequence++;
+                    waiter->wait_start_ms = cellularPortGetTickTimeMs();
+                    c->stats.queue_depth++;
+                    if (c->stats.queue_depth > c->stats.max_queue_depth) {
+                        c->stats.max_queue_depth = c->stats.queue_depth;
+                    }
+                }
+            }
+        }
+
+        CELLULAR_PORT_MUTEX_UNLOCK(_mtx_arbiter);
+
+        if (!granted && (waiter == NULL)) {
+            // All the places to wait are taken
+            cellularPortTaskBlock(10);
+        }
+    }
+
+    if (waiter != NULL) {
+        // Wait for arbiter_release() to say it's our turn
+        cellularPortQueueReceive(waiter->queue, &item);
+
+        CELLULAR_PORT_MUTEX_LOCK(_mtx_arbiter);
+
+        wait_ms = cellularPortGetTickTimeMs() - waiter->wait_start_ms;
+        c->stats.num_waits++;
+        c->stats.total_wait_ms += wait_ms;
+        if (wait_ms > c->stats.max_wait_ms) {
+            c->stats.max_wait_ms = wait_ms;
+        }
+        waiter->in_use = false;
+
+        CELLULAR_PORT_MUTEX_UNLOCK(_mtx_arbiter);
+    }
+}
+
+// End the turn of the client holding the UART stream, charging
+// it for the time it held it, and give the stream to whoever
+// goes next.
+static void arbiter_release()
+{
+    cellular_ctrl_at_client_t *c;
+    cellular_ctrl_at_waiter_t *next = NULL;
+    int64_t hold_ms;
+    int32_t item = 0;
+
+    CELLULAR_PORT_MUTEX_LOCK(_mtx_arbiter);
+
+    c = &(_clients[_arbiter_client]);
+    hold_ms = cellularPortGetTickTimeMs() - _arbiter_turn_start_ms;
+    c->finish_tag = _arbiter_turn_start_tag +
+                    (((hold_ms + 1) * CELLULAR_CTRL_AT_ARBITER_TAG_SCALE) / c->weight);
+    c->stats.total_hold_ms += hold_ms;
+    if (hold_ms > c->stats.max_hold_ms) {
+        c->stats.max_hold_ms = hold_ms;
+    }
+    if (hold_ms > _max_hold_time_ms) {
+        c->stats.num_overruns++;
+    }
+
+    for (size_t x = 0; x < CELLULAR_CTRL_AT_MAX_NUM_WAITERS; x++) {
+        if (_waiters[x].in_use && !_waiters[x].granted &&
+            ((next == NULL) || arbiter_goes_first(&(_waiters[x]), next))) {
+            next = &(_waiters[x]);
+        }
+    }
+    if (next != NULL) {
+        next->granted = true;
+        _clients[next->client].stats.queue_depth--;
+        arbiter_grant(next->client, next->start_tag);
+        cellularPortQueueSend(next->queue, &item);
+    } else {
+        _arbiter_busy = false;
+    }
+
+    CELLULAR_PORT_MUTEX_UNLOCK(_mtx_arbiter);
+}
+
+// Return true if the turn of the client holding the UART stream
+// has gone on for longer than the maximum hold time and someone
+// else is waiting.
+static bool arbiter_turn_over()
+{
+    bool turn_over = false;
+
+    CELLULAR_PORT_MUTEX_LOCK(_mtx_arbiter);
+
+    if (cellularPortGetTickTimeMs() - _arbiter_turn_start_ms >= _max_hold_time_ms) {
+        for (size_t x = 0; !turn_over &&
+                           (x < CELLULAR_CTRL_AT_MAX_NUM_WAITERS); x++) {
+            turn_over = _waiters[x].in_use && !_waiters[x].granted;
+        }
+    }
+
+    CELLULAR_PORT_MUTEX_UNLOCK(_mtx_arbiter);
+
+    return turn_over;
+}
+
 // Just unlock the UART stream, don't kick off
 // any further data receipt.  This is used in
 // task_urc to avoid recursion.
 static void cellular_ctrl_at_unlock_no_data_check()
 {
-    cellularPortMutexUnlock(_mtx_stream);
+    arbiter_release();
 }
 
 // Convert a string which should contain
@@ -991,7 +1269,7 @@ static void task_urc(void *parameters)
 
             // Potential URC data is available, lock the AT
             // AT interface and process it for URCs
-            cellular_ctrl_at_lock();
+            cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_URC);
 
             if ((data_size_or_error > 0) || (_buf.recv_pos < _buf.recv_len)) {
                 if (_debug_on) {
@@ -1012,6 +1290,12 @@ static void task_urc(void *parameters)
                             // We have no more data to process, leave this loop
                             break;
                         }
+                        if (arbiter_turn_over()) {
+                            // Give way: what is left will be handled
+                            // by whoever has the stream next or after
+                            // their cellular_ctrl_at_unlock()
+                            break;
+                        }
                     // If no match was found, look for CELLULAR_CTRL_AT_CRLF
                     } else if (mem_str(_buf.recv_buff, _buf.recv_len,
                                        CELLULAR_CTRL_AT_CRLF, CELLULAR_CTRL_AT_CRLF_LENGTH)) {
@@ -1160,16 +1444,17 @@ cellular_ctrl_at_error_code_t cellular_ctrl_at_init(int32_t uart,
     set_tag(&_info_stop, CELLULAR_CTRL_AT_CRLF);
     set_tag(&_elem_stop, ")");
 
-    // Mutex protections for the data stream and the tasks
-    if (cellularPortMutexCreate(&_mtx_stream) != 0) {
+    // The arbiter for the data stream and mutex protections
+    // for the tasks
+    if (!arbiter_create()) {
         return CELLULAR_CTRL_AT_OUT_OF_MEMORY;
     }
     if (cellularPortMutexCreate(&_mtx_urc_task_running) != 0) {
-        cellularPortMutexDelete(_mtx_stream);
+        arbiter_delete();
         return CELLULAR_CTRL_AT_OUT_OF_MEMORY;
     }
     if (cellularPortMutexCreate(&_mtx_callbacks_task_running) != 0) {
-        cellularPortMutexDelete(_mtx_stream);
+        arbiter_delete();
         cellularPortMutexDelete(_mtx_urc_task_running);
         return CELLULAR_CTRL_AT_OUT_OF_MEMORY;
     }
@@ -1178,7 +1463,7 @@ cellular_ctrl_at_error_code_t cellular_ctrl_at_init(int32_t uart,
     if (cellularPortQueueCreate(CELLULAR_CTRL_AT_CALLBACK_QUEUE_LENGTH,
                                 sizeof(cellular_ctrl_at_callback_t),
                                 &_queue_callbacks) != 0) {
-        cellularPortMutexDelete(_mtx_stream);
+        arbiter_delete();
         cellularPortMutexDelete(_mtx_urc_task_running);
         cellularPortMutexDelete(_mtx_callbacks_task_running);
         return CELLULAR_CTRL_AT_OUT_OF_MEMORY;
@@ -1188,7 +1473,7 @@ cellular_ctrl_at_error_code_t cellular_ctrl_at_init(int32_t uart,
     if (cellularPortQueueCreate(CELLULAR_CTRL_AT_URC_CONTROL_QUEUE_LENGTH,
                                 sizeof(cellular_ctrl_at_control_t),
                                 &_queue_urc_control) != 0) {
-        cellularPortMutexDelete(_mtx_stream);
+        arbiter_delete();
         cellularPortMutexDelete(_mtx_urc_task_running);
         cellularPortMutexDelete(_mtx_callbacks_task_running);
         cellularPortQueueDelete(_queue_callbacks);
@@ -1201,7 +1486,7 @@ cellular_ctrl_at_error_code_t cellular_ctrl_at_init(int32_t uart,
                                NULL,
                                CELLULAR_CTRL_AT_TASK_URC_PRIORITY,
                                &_task_handle_urc) != 0) {
-        cellularPortMutexDelete(_mtx_stream);
+        arbiter_delete();
         cellularPortMutexDelete(_mtx_urc_task_running);
         cellularPortMutexDelete(_mtx_callbacks_task_running);
         cellularPortQueueDelete(_queue_callbacks);
@@ -1224,7 +1509,7 @@ cellular_ctrl_at_error_code_t cellular_ctrl_at_init(int32_t uart,
         cellularPortQueueSend(_queue_urc_control, (void *) &ctrl);
         CELLULAR_PORT_MUTEX_LOCK(_mtx_urc_task_running);
         CELLULAR_PORT_MUTEX_UNLOCK(_mtx_urc_task_running);
-        cellularPortMutexDelete(_mtx_stream);
+        arbiter_delete();
         cellularPortMutexDelete(_mtx_urc_task_running);
         cellularPortMutexDelete(_mtx_callbacks_task_running);
         cellularPortQueueDelete(_queue_callbacks);
@@ -1277,7 +1562,7 @@ void cellular_ctrl_at_deinit()
         }
 
         // Tidy up
-        cellularPortMutexDelete(_mtx_stream);
+        arbiter_delete();
         cellularPortMutexDelete(_mtx_urc_task_running);
         cellularPortMutexDelete(_mtx_callbacks_task_running);
         cellularPortQueueDelete(_queue_callbacks);
@@ -1312,6 +1597,50 @@ void cellular_ctrl_at_print_at_set(bool onNotOff)
     _print_at_on = onNotOff;
 }
 
+void cellular_ctrl_at_get_num_bytes(size_t *num_bytes_written,
+                                    size_t *num_bytes_read)
+{
+    if (num_bytes_written != NULL) {
+        *num_bytes_written = _num_bytes_written;
+    }
+    if (num_bytes_read != NULL) {
+        *num_bytes_read = _num_bytes_read;
+    }
+}
+
+void cellular_ctrl_at_reset_num_bytes()
+{
+    _num_bytes_written = 0;
+    _num_bytes_read = 0;
+}
+
+size_t cellular_ctrl_at_hex_encode(char *hex, const char *data,
+                                   size_t data_len)
+{
+    const uint8_t *in = (const uint8_t *) data;
+
+    for (size_t i = 0; i < data_len; i++) {
+        *hex++ = _hex_encode[*in >> 4];
+        *hex++ = _hex_encode[*in & 0x0f];
+        in++;
+    }
+
+    return data_len * 2;
+}
+
+size_t cellular_ctrl_at_hex_decode(char *data, const char *hex,
+                                   size_t hex_len)
+{
+    const uint8_t *in = (const uint8_t *) hex;
+
+    for (size_t i = 0; i + 1 < hex_len; i += 2) {
+        *data++ = (char) ((_hex_decode[*in] << 4) | _hex_decode[*(in + 1)]);
+        in += 2;
+    }
+
+    return hex_len / 2;
+}
+
 cellular_ctrl_at_error_code_t cellular_ctrl_at_set_urc_handler(const char *prefix,
                                                                void (callback) (void *),
                                                                void *callback_param)
@@ -1386,9 +1715,18 @@ bool cellular_ctrl_at_callback(void (callback)(void *),
 
 // Lock the UART stream.
 void cellular_ctrl_at_lock()
+{
+    cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_CTRL);
+}
+
+// Lock the UART stream as a given client.
+void cellular_ctrl_at_lock_client(int32_t client)
 {
     if (_uart >= 0) {
-        cellularPortMutexLock(_mtx_stream);
+        if ((client < 0) || (client >= CELLULAR_CTRL_AT_MAX_NUM_CLIENTS)) {
+            client = CELLULAR_CTRL_AT_CLIENT_CTRL;
+        }
+        arbiter_acquire(client);
         cellular_ctrl_at_clear_error();
         // No need to worry about overflow here, we're never awake
         // for long enough
@@ -1413,6 +1751,76 @@ void cellular_ctrl_at_unlock()
     }
 }
 
+// Set the priority and weight of a client.
+cellular_ctrl_at_error_code_t cellular_ctrl_at_set_client(int32_t client,
+                                                          int32_t priority,
+                                                          int32_t weight)
+{
+    cellular_ctrl_at_error_code_t error = CELLULAR_CTRL_AT_NOT_INITIALISED;
+
+    if (_uart >= 0) {
+        error = CELLULAR_CTRL_AT_INVALID_PARAMETER;
+        if ((client >= 0) && (client < CELLULAR_CTRL_AT_MAX_NUM_CLIENTS) &&
+            (weight > 0)) {
+            CELLULAR_PORT_MUTEX_LOCK(_mtx_arbiter);
+            _clients[client].priority = priority;
+            _clients[client].weight = weight;
+            CELLULAR_PORT_MUTEX_UNLOCK(_mtx_arbiter);
+            error = CELLULAR_CTRL_AT_SUCCESS;
+        }
+    }
+
+    return error;
+}
+
+// Set the maximum hold time.
+void cellular_ctrl_at_set_max_hold_time(int32_t max_hold_time_ms)
+{
+    if (_uart >= 0) {
+        CELLULAR_PORT_MUTEX_LOCK(_mtx_arbiter);
+        _max_hold_time_ms = max_hold_time_ms;
+        CELLULAR_PORT_MUTEX_UNLOCK(_mtx_arbiter);
+    }
+}
+
+// Get the statistics of a client.
+cellular_ctrl_at_error_code_t cellular_ctrl_at_get_client_stats(int32_t client,
+                                                                cellular_ctrl_at_client_stats_t *stats)
+{
+    cellular_ctrl_at_error_code_t error = CELLULAR_CTRL_AT_NOT_INITIALISED;
+
+    if (_uart >= 0) {
+        error = CELLULAR_CTRL_AT_INVALID_PARAMETER;
+        if ((client >= 0) && (client < CELLULAR_CTRL_AT_MAX_NUM_CLIENTS) &&
+            (stats != NULL)) {
+            CELLULAR_PORT_MUTEX_LOCK(_mtx_arbiter);
+            *stats = _clients[client].stats;
+            CELLULAR_PORT_MUTEX_UNLOCK(_mtx_arbiter);
+            error = CELLULAR_CTRL_AT_SUCCESS;
+        }
+    }
+
+    return error;
+}
+
+// Reset the statistics of all clients.
+void cellular_ctrl_at_reset_client_stats()
+{
+    size_t queue_depth;
+
+    if (_uart >= 0) {
+        CELLULAR_PORT_MUTEX_LOCK(_mtx_arbiter);
+        for (size_t x = 0; x < CELLULAR_CTRL_AT_MAX_NUM_CLIENTS; x++) {
+            queue_depth = _clients[x].stats.queue_depth;
+            pCellularPort_memset(&(_clients[x].stats), 0,
+                                 sizeof(_clients[x].stats));
+            _clients[x].stats.queue_depth = queue_depth;
+            _clients[x].stats.max_queue_depth = queue_depth;
+        }
+        CELLULAR_PORT_MUTEX_UNLOCK(_mtx_arbiter);
+    }
+}
+
 // Unlock the UART stream and return the last error.
 cellular_ctrl_at_error_code_t cellular_ctrl_at_unlock_return_error()
 {
@@ -1550,6 +1958,41 @@ int32_t cellular_ctrl_at_read_bytes(uint8_t *buf, size_t len)
     return read_len;
 }
 
+int32_t cellular_ctrl_at_read_bytes_span(size_t len,
+                                         void (*callback)(const uint8_t *,
+                                                          size_t, void *),
+                                         void *callback_param)
+{
+    size_t read_len = 0;
+    size_t span_len;
+
+    if ((_uart < 0) || (_last_error != CELLULAR_CTRL_AT_SUCCESS) ||
+        (_stop_tag != NULL) || (callback == NULL)) {
+        return -1;
+    }
+
+    while (read_len < len) {
+        if (_buf.recv_pos == _buf.recv_len) {
+            // Let get_char() refill the buffer, dealing with
+            // any timeout, then put the character back
+            if (get_char() == -1) {
+                return -1;
+            }
+            _buf.recv_pos--;
+        }
+        span_len = _buf.recv_len - _buf.recv_pos;
+        if (span_len > len - read_len) {
+            span_len = len - read_len;
+        }
+        callback((const uint8_t *) (_buf.recv_buff + _buf.recv_pos),
+                 span_len, callback_param);
+        _buf.recv_pos += span_len;
+        read_len += span_len;
+    }
+
+    return read_len;
+}
+
 int32_t cellular_ctrl_at_read_string(char *buf, size_t size,
                                      bool read_even_stop_tag)
 {
@@ -69,6 +69,23 @@ typedef enum {
     CELLULAR_CTRL_AT_DEVICE_ERROR = -6
 } cellular_ctrl_at_error_code_t;
 
+/** Statistics for a client of the AT interface, see
+ * cellular_ctrl_at_get_client_stats(); the clients and
+ * the configuration of the arbiter that shares out the AT
+ * interface between them are in cellular_ctrl.h.
+ */
+typedef struct {
+    size_t num_turns;       //<! Times the client had the AT interface.
+    size_t num_waits;       //<! Turns for which the client had to wait.
+    size_t queue_depth;     //<! Turns the client is waiting for now.
+    size_t max_queue_depth; //<! The most it has waited for at once.
+    int64_t total_wait_ms;  //<! Time spent waiting.
+    int64_t max_wait_ms;    //<! The longest wait.
+    int64_t total_hold_ms;  //<! Time spent holding the AT interface.
+    int64_t max_hold_ms;    //<! The longest turn.
+    size_t num_overruns;    //<! Turns longer than the maximum hold time.
+} cellular_ctrl_at_client_stats_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -121,6 +138,48 @@ bool cellular_ctrl_at_print_at_get();
  */
 void cellular_ctrl_at_print_at_set(bool onNotOff);
 
+/** Get the number of bytes that have crossed the UART, e.g.
+ * to compare the cost of one way of doing something with
+ * that of another.
+ *
+ * @param num_bytes_written a place to put the number of bytes
+ *                          written to the UART, may be NULL.
+ * @param num_bytes_read    a place to put the number of bytes
+ *                          read from the UART, may be NULL.
+ */
+void cellular_ctrl_at_get_num_bytes(size_t *num_bytes_written,
+                                    size_t *num_bytes_read);
+
+/** Reset the number of bytes that have crossed the UART.
+ */
+void cellular_ctrl_at_reset_num_bytes();
+
+/** Encode binary data as hex, two lower-case hex characters per
+ * byte, most significant nibble first.  The output is not
+ * terminated.
+ *
+ * @param hex      a place to put the hex, at least
+ *                 data_len * 2 bytes long.
+ * @param data     the binary data.
+ * @param data_len the number of bytes of binary data.
+ * @return         the number of hex characters written.
+ */
+size_t cellular_ctrl_at_hex_encode(char *hex, const char *data,
+                                   size_t data_len);
+
+/** Decode hex, either case, into binary data; a character that
+ * is not hex is decoded as zero and an odd final character is
+ * ignored.  hex and data may be the same buffer.
+ *
+ * @param data    a place to put the binary data, at least
+ *                hex_len / 2 bytes long.
+ * @param hex     the hex.
+ * @param hex_len the number of hex characters.
+ * @return        the number of bytes written to data.
+ */
+size_t cellular_ctrl_at_hex_decode(char *data, const char *hex,
+                                   size_t hex_len);
+
 /** Set the handler for a URC. If the URC is found when parsing AT
  * responses, then the handler is called.  If a handler is
  * already set then this is ignored.
@@ -181,14 +240,65 @@ cellular_ctrl_at_device_err_t
 cellular_ctrl_at_get_last_device_error();
 
 /** Lock the UART stream in order that the user
- * can control it and start the AT timeout running.
+ * can control it and start the AT timeout running.  This
+ * is done as the client CELLULAR_CTRL_AT_CLIENT_CTRL.
  */
 void cellular_ctrl_at_lock();
 
+/** Lock the UART stream as the given client, waiting for
+ * the turn of the client as decided by the arbiter, and start
+ * the AT timeout running.
+ *
+ * @param client the client, from CELLULAR_CTRL_AT_CLIENT_URC
+ *               to CELLULAR_CTRL_AT_MAX_NUM_CLIENTS - 1; anything
+ *               else is treated as CELLULAR_CTRL_AT_CLIENT_CTRL.
+ */
+void cellular_ctrl_at_lock_client(int32_t client);
+
 /** Unlock the UART stream after at_lock_stream().
  */
 void cellular_ctrl_at_unlock();
 
+/** Set the priority and weight of a client of the AT
+ * interface, see cellular_ctrl_at_lock_client().  The
+ * settings of all clients are returned to the defaults
+ * by cellular_ctrl_at_init().
+ *
+ * @param client   the client.
+ * @param priority the priority, higher goes first.
+ * @param weight   the weight, at least 1: within a priority,
+ *                 a client of weight 2 gets twice the time
+ *                 on the AT interface of a client of weight 1.
+ * @return         zero on success, otherwise negative error
+ *                 code.
+ */
+cellular_ctrl_at_error_code_t cellular_ctrl_at_set_client(int32_t client,
+                                                          int32_t priority,
+                                                          int32_t weight);
+
+/** Set the maximum time for which a client should hold the
+ * AT interface in one turn; see CELLULAR_CTRL_AT_MAX_HOLD_TIME_MS,
+ * to which it is returned by cellular_ctrl_at_init().
+ *
+ * @param max_hold_time_ms the maximum hold time.
+ */
+void cellular_ctrl_at_set_max_hold_time(int32_t max_hold_time_ms);
+
+/** Get the statistics of a client of the AT interface.
+ *
+ * @param client the client.
+ * @param stats  a place to put the statistics.
+ * @return       zero on success, otherwise negative error
+ *               code.
+ */
+cellular_ctrl_at_error_code_t cellular_ctrl_at_get_client_stats(int32_t client,
+                                                                cellular_ctrl_at_client_stats_t *stats);
+
+/** Reset the statistics of all clients of the AT interface,
+ * except for their queue depth.
+ */
+void cellular_ctrl_at_reset_client_stats();
+
 /** Unlock the UART stream and return the last error.
  *
  * @return last error that happened when parsing AT responses.
@@ -363,6 +473,26 @@ void cellular_ctrl_at_skip_param(uint32_t count);
  */
 int32_t cellular_ctrl_at_read_bytes(uint8_t *buf, size_t len);
 
+/** Reads the given number of bytes from the receiving buffer
+ * without copying them: callback is called with each span of
+ * the bytes as it sits in the receiving buffer, the buffer
+ * being refilled from the UART in between as necessary.  The
+ * pointer passed to callback is only valid for the duration of
+ * the call.  Delimiters and stop-tags are not obeyed, and hence
+ * cellular_ctrl_at_set_stop_tag(NULL) must have been called
+ * before calling this.
+ *
+ * @param len            the number of bytes to read.
+ * @param callback       the function to call with each span.
+ * @param callback_param the parameter to pass to callback.
+ * @return               number of successfully read bytes or
+ *                       -1 in case of error.
+ */
+int32_t cellular_ctrl_at_read_bytes_span(size_t len,
+                                         void (*callback)(const uint8_t *,
+                                                          size_t, void *),
+                                         void *callback_param);
+
 /** Reads chars from reading buffer. Terminates with NULL. Skips
  * the quotation marks. Stops on delimiter or stop tag.
  *
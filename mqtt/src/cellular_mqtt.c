@@ -137,11 +137,6 @@ static volatile MqttUrcStatus_t gUrcStatus;
 static MqttUrcMessage_t gUrcMessage;
 #endif
 
-/** Hex table.
- */
-static const char gHex[] = {'0', '1', '2', '3', '4', '5', '6',
-                            '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
-
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS: URCS AND RELATED FUNCTIONS
  * -------------------------------------------------------------- */
@@ -461,7 +456,7 @@ static void printErrorCodes()
     int32_t err1;
     int32_t err2;
 
-    cellular_ctrl_at_lock();
+    cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
     cellular_ctrl_at_cmd_start("AT+UMQTTER");
     cellular_ctrl_at_cmd_stop();
     cellular_ctrl_at_resp_start("+UMQTTER:", false);
@@ -500,29 +495,6 @@ static CellularMqttErrorCode_t atMqttStopCmdGetRespAndUnlock()
     return errorCode;
 }
 
-// Convert a message buffer into a hex version of that buffer,
-// returning the number of bytes (not hex values) in the hex buffer.
-static size_t toHex(char *pHex, const char *pBinary,
-                    size_t binaryLength)
-{
-    size_t hexLength = 0;
-
-    for (size_t x = 0; x < (binaryLength * 2); x++) {
-        if ((x & 1) == 0) {
-            // Even
-            *pHex = gHex[(*pBinary & 0xF0) >> 4];
-        } else {
-            // Odd
-            *pHex = gHex[*pBinary & 0x0F];
-            pBinary++;
-        }
-        pHex++;
-        hexLength++;
-    }
-
-    return hexLength;
-}
-
 #ifdef CELLULAR_CFG_MODULE_SARA_R4
 // Set the given gUrcStatus item to "not filled in".
 // The switch statement here should match that in UUMQTTx_urc()
@@ -625,7 +597,7 @@ static CellularCtrlErrorCode_t doUmqttQuery(int32_t number)
         // Now send the AT command
         errorCode = CELLULAR_MQTT_AT_ERROR;
         cellularPort_snprintf(buffer, sizeof(buffer), "AT+UMQTT=%d?", number);
-        cellular_ctrl_at_lock();
+        cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
         cellular_ctrl_at_cmd_start(buffer);
         cellular_ctrl_at_cmd_stop();
         cellular_ctrl_at_resp_start("+UMQTT:", false);
@@ -665,7 +637,7 @@ static CellularMqttErrorCode_t setKeepAlive(bool onNotOff)
         // mutex protection of the AT interface
         // lock is sufficient
         errorCode = CELLULAR_MQTT_AT_ERROR;
-        cellular_ctrl_at_lock();
+        cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
         cellular_ctrl_at_cmd_start("AT+UMQTTC=");
         // Set ping
         cellular_ctrl_at_write_int(8);
@@ -705,7 +677,7 @@ static CellularMqttErrorCode_t setSessionClean(bool onNotOff)
         // mutex protection of the AT interface
         // lock is sufficient
         errorCode = CELLULAR_MQTT_AT_ERROR;
-        cellular_ctrl_at_lock();
+        cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
         cellular_ctrl_at_cmd_start("AT+UMQTT=");
         // Set client clean session
         cellular_ctrl_at_write_int(12);
@@ -728,7 +700,7 @@ static CellularMqttErrorCode_t setSecurity(bool onNotOff,
         // mutex protection of the AT interface
         // lock is sufficient
         errorCode = CELLULAR_MQTT_AT_ERROR;
-        cellular_ctrl_at_lock();
+        cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
         cellular_ctrl_at_cmd_start("AT+UMQTT=");
         // Set security
         cellular_ctrl_at_write_int(11);
@@ -759,7 +731,7 @@ static CellularMqttErrorCode_t connect(bool onNotOff)
 
         errorCode = CELLULAR_MQTT_AT_ERROR;
         gUrcStatus.updateFlag = false;
-        cellular_ctrl_at_lock();
+        cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
         // Have seen this take a little while
         cellular_ctrl_at_set_at_timeout(15000, false);
         cellular_ctrl_at_cmd_start("AT+UMQTTC=");
@@ -847,7 +819,7 @@ static bool isSecured(int32_t *pSecurityProfileId)
     // No need to lock the mutex, the
     // mutex protection of the AT interface
     // lock is sufficient
-    cellular_ctrl_at_lock();
+    cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
     cellular_ctrl_at_cmd_start("AT+UMQTT=");
     cellular_ctrl_at_write_int(11);
     cellular_ctrl_at_cmd_stop();
@@ -914,7 +886,7 @@ int32_t cellularMqttInit(const char *pServerNameStr,
                     if (cellularSockIpAddressToString(&(address.ipAddress),
                                                       pAddress,
                                                       CELLULAR_MQTT_SERVER_ADDRESS_STRING_MAX_LENGTH_BYTES) == 0) {
-                        cellular_ctrl_at_lock();
+                        cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
                         cellular_ctrl_at_cmd_start("AT+UMQTT=");
                         // Set the server IP address
                         cellular_ctrl_at_write_int(3);
@@ -936,7 +908,7 @@ int32_t cellularMqttInit(const char *pServerNameStr,
                     // and then remove it from the string
                     port = cellularSockDomainGetPort(pAddress);
                     pTmp = pCellularSockDomainRemovePort(pAddress);
-                    cellular_ctrl_at_lock();
+                    cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
                     cellular_ctrl_at_cmd_start("AT+UMQTT=");
                     // Set the server name
                     cellular_ctrl_at_write_int(2);
@@ -955,7 +927,7 @@ int32_t cellularMqttInit(const char *pServerNameStr,
 
                 // Now deal with the credentials
                 if (keepGoing && (pUserNameStr != NULL)) {
-                    cellular_ctrl_at_lock();
+                    cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
                     cellular_ctrl_at_cmd_start("AT+UMQTT=");
                     // Set credentials
                     cellular_ctrl_at_write_int(4);
@@ -970,7 +942,7 @@ int32_t cellularMqttInit(const char *pServerNameStr,
 
                 // Finally deal with the local client ID
                 if (keepGoing && (pClientIdStr != NULL)) {
-                    cellular_ctrl_at_lock();
+                    cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
                     cellular_ctrl_at_cmd_start("AT+UMQTT=");
                     // Set client ID
                     cellular_ctrl_at_write_int(0);
@@ -982,7 +954,7 @@ int32_t cellularMqttInit(const char *pServerNameStr,
 #ifdef CELLULAR_CFG_MODULE_SARA_R4
                 if (keepGoing) {
                     // If this is SARA-R4, select verbose message reads
-                    cellular_ctrl_at_lock();
+                    cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
                     cellular_ctrl_at_cmd_start("AT+UMQTTC=");
                     // Message read format
                     cellular_ctrl_at_write_int(7);
@@ -1065,7 +1037,7 @@ int32_t cellularMqttGetClientId(char *pClientIdStr,
             // mutex protection of the AT interface
             // lock is sufficient
             errorCode = CELLULAR_MQTT_AT_ERROR;
-            cellular_ctrl_at_lock();
+            cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
             cellular_ctrl_at_cmd_start("AT+UMQTT=0");
             cellular_ctrl_at_cmd_stop();
             cellular_ctrl_at_resp_start("+UMQTT:", false);
@@ -1099,7 +1071,7 @@ int32_t cellularMqttSetLocalPort(uint16_t port)
         // No need to lock the mutex, the
         // mutex protection of the AT interface
         // lock is sufficient
-        cellular_ctrl_at_lock();
+        cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
         cellular_ctrl_at_cmd_start("AT+UMQTT=");
         // Set the local port
         cellular_ctrl_at_write_int(1);
@@ -1159,7 +1131,7 @@ int32_t cellularMqttGetLocalPort()
         // mutex protection of the AT interface
         // lock is sufficient
         errorCodeOrPort = CELLULAR_MQTT_AT_ERROR;
-        cellular_ctrl_at_lock();
+        cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
         cellular_ctrl_at_cmd_start("AT+UMQTT=");
         cellular_ctrl_at_write_int(1);
         cellular_ctrl_at_cmd_stop();
@@ -1189,7 +1161,7 @@ int32_t cellularMqttSetInactivityTimeout(int32_t seconds)
         // No need to lock the mutex, the
         // mutex protection of the AT interface
         // lock is sufficient
-        cellular_ctrl_at_lock();
+        cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
         cellular_ctrl_at_cmd_start("AT+UMQTT=");
         // Set the inactivity timeout
         cellular_ctrl_at_write_int(10);
@@ -1227,7 +1199,7 @@ int32_t cellularMqttGetInactivityTimeout()
         // mutex protection of the AT interface
         // lock is sufficient
         errorCodeOrTimeout = CELLULAR_MQTT_AT_ERROR;
-        cellular_ctrl_at_lock();
+        cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
         cellular_ctrl_at_cmd_start("AT+UMQTT=");
         cellular_ctrl_at_write_int(10);
         cellular_ctrl_at_cmd_stop();
@@ -1311,7 +1283,7 @@ bool cellularMqttIsSessionClean()
         // No need to lock the mutex, the
         // mutex protection of the AT interface
         // lock is sufficient
-        cellular_ctrl_at_lock();
+        cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
         cellular_ctrl_at_cmd_start("AT+UMQTT=");
         cellular_ctrl_at_write_int(12);
         cellular_ctrl_at_cmd_stop();
@@ -1433,7 +1405,8 @@ int32_t cellularMqttPublish(CellularMqttQos_t qos,
             pHexMessage = (char *) pCellularPort_malloc((messageSizeBytes * 2) + 1);
             if (pHexMessage != NULL) {
                 // Convert to hex
-                toHex(pHexMessage, pMessage, messageSizeBytes);
+                cellular_ctrl_at_hex_encode(pHexMessage, pMessage,
+                                            messageSizeBytes);
                 // Add a terminator to make it a string
                 *(pHexMessage + (messageSizeBytes * 2)) = '\0';
 
@@ -1444,7 +1417,7 @@ int32_t cellularMqttPublish(CellularMqttQos_t qos,
                 CELLULAR_PORT_MUTEX_LOCK(gMutex);
 
                 errorCode = CELLULAR_MQTT_AT_ERROR;
-                cellular_ctrl_at_lock();
+                cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
                 gUrcStatus.updateFlag = false;
                 gUrcStatus.publishSuccess = false;
                 cellular_ctrl_at_cmd_start("AT+UMQTTC=");
@@ -1528,7 +1501,7 @@ int32_t cellularMqttSubscribe(CellularMqttQos_t maxQos,
             CELLULAR_PORT_MUTEX_LOCK(gMutex);
 
             errorCodeOrQos = CELLULAR_MQTT_AT_ERROR;
-            cellular_ctrl_at_lock();
+            cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
             gUrcStatus.updateFlag = false;
             gUrcStatus.subscribeSuccess = false;
             cellular_ctrl_at_cmd_start("AT+UMQTTC=");
@@ -1596,7 +1569,7 @@ int32_t cellularMqttUnsubscribe(const char *pTopicFilterStr)
             CELLULAR_PORT_MUTEX_LOCK(gMutex);
 
             errorCode = CELLULAR_MQTT_AT_ERROR;
-            cellular_ctrl_at_lock();
+            cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
             gUrcStatus.updateFlag = false;
             gUrcStatus.unsubscribeSuccess = false;
             cellular_ctrl_at_cmd_start("AT+UMQTTC=");
@@ -1716,7 +1689,7 @@ int32_t cellularMqttMessageRead(char *pTopicNameStr,
                 CELLULAR_PORT_MUTEX_LOCK(gMutex);
 
                 errorCode = CELLULAR_MQTT_AT_ERROR;
-                cellular_ctrl_at_lock();
+                cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
                 cellular_ctrl_at_cmd_start("AT+UMQTTC=");
                 // Read a message
                 cellular_ctrl_at_write_int(6);
@@ -1857,7 +1830,7 @@ int32_t cellularMqttGetLastErrorCode()
     int32_t x;
 
     if (gMutex != NULL) {
-        cellular_ctrl_at_lock();
+        cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_MQTT);
         cellular_ctrl_at_cmd_start("AT+UMQTTER");
         cellular_ctrl_at_cmd_stop();
         cellular_ctrl_at_resp_start("+UMQTTER:", false);
@@ -145,7 +145,10 @@ int32_t cellularPortUartRead(int32_t uart, char *pBuffer,
                              size_t sizeBytes);
 
 /** Write to the given UART interface.  The function will
- * block until all the data has been written.
+ * block until all the data has been written or, on platforms
+ * which transmit asynchronously (e.g. NRF52840), until all
+ * the data has been queued for transmission; in either case
+ * pBuffer may be re-used as soon as the function returns.
  *
  * @param uart      the UART number to use.
  * @param pBuffer   a pointer to a buffer of data to send.
@@ -54,8 +54,11 @@
 #include "FreeRTOSConfig.h"
 
 #include "task.h"
+#include "queue.h"
+#include "semphr.h"
 
 #include <stdbool.h>
+#include <stdio.h>
 #include <string.h>
 
 #undef _SECURE_SOCKETS_WRAPPER_NOT_REDEFINE
@@ -66,26 +69,30 @@
 #define SS_STATUS_SECURED      ( 2 )
 
 /*
- * secure socket context.
+ * a trusted server certificate stored in the cellular module,
+ * under a name made from its index in ca_slots: a copy is kept so
+ * that another certificate can be compared with it in full and
+ * the slot only goes to a different certificate once no socket
+ * is using it.
  */
-typedef enum E_AWS_SOCkET_RX_STATE
+typedef struct _ss_ca_t
 {
-    SST_RX_IDLE,
-    SST_RX_READY,
-    SST_RX_CLOSING,
-    SST_RX_CLOSED,
-} T_AWS_SOCKET_RX_STATE;
+    char * cert;
+    int cert_len;
+    int users;
+} ss_ca_t;
 
+/*
+ * secure socket context.
+ */
 typedef struct _ss_ctx_t
 {
     int ip_socket;
 
-    int state;
     unsigned int status;
     int send_flag;
     int recv_flag;
 
-    TaskHandle_t rx_handle;
     void ( * rx_callback )( Socket_t pxSocket );
 
     bool enforce_tls;
@@ -94,6 +101,7 @@ typedef struct _ss_ctx_t
 
     char * server_cert;
     int server_cert_len;
+    ss_ca_t * ca;
 
     char ** ppcAlpnProtocols;
     uint32_t ulAlpnProtocolsCount;
@@ -108,6 +116,37 @@ typedef struct _ss_ctx_t
 /*static int8_t sockets_allocated = SUPPORTED_DESCRIPTORS; */
 static int8_t sockets_allocated = socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS;
 
+/*
+ * the receive dispatcher: one task, created when the first
+ * receive callback is set, which calls the receive callback of
+ * any socket that the cellular socket layer says has data.
+ */
+static TaskHandle_t rx_dispatcher = NULL;
+static QueueHandle_t rx_queue = NULL;
+static SemaphoreHandle_t rx_mutex = NULL;
+
+/*
+ * the sockets with a receive callback, whether each is already
+ * in rx_queue, whether each has been closed by the remote host
+ * since its callback was last called and the one whose callback
+ * is running, if any.
+ */
+static ss_ctx_t * rx_ctxs[ socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS ];
+static bool rx_pending[ socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS ];
+static bool rx_closed[ socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS ];
+static ss_ctx_t * volatile rx_running = NULL;
+
+#if CELLULAR_CFG_SOCK_TLS_OFFLOAD
+
+/*
+ * the trusted server certificates stored in the cellular module:
+ * each socket uses at most one, so there is always a slot free.
+ */
+static ss_ca_t ca_slots[ socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS ];
+static SemaphoreHandle_t ca_mutex = NULL;
+
+#endif /* CELLULAR_CFG_SOCK_TLS_OFFLOAD */
+
 
 /*-----------------------------------------------------------*/
 
@@ -121,6 +160,19 @@ static int8_t sockets_allocated = socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS;
  */
 #define TICK_TO_US( _t_ )    ( ( _t_ ) * 1000 / configTICK_RATE_HZ * 1000 )
 
+/*
+ * true if TLS for the socket is run on the MCU, false if there
+ * is no TLS or it is offloaded to the cellular module.
+ */
+#define SS_TLS_ON_MCU( _ctx_ )    ( ( _ctx_ )->enforce_tls && !CELLULAR_CFG_SOCK_TLS_OFFLOAD )
+
+/*
+ * prefix for the name under which a trusted server certificate
+ * is stored in the cellular module, followed by its index in
+ * ca_slots.
+ */
+#define SS_TLS_SERVER_CERT_NAME_PREFIX    "ss-ca-"
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -195,52 +247,376 @@ static BaseType_t prvNetworkRecv( void * pvContext,
 
 /*-----------------------------------------------------------*/
 
-static void vTaskRxSelect( void * param )
+#if CELLULAR_CFG_SOCK_TLS_OFFLOAD
+
+/*
+ * @brief Let go of the trusted server certificate of a socket.
+ */
+static void prvTlsOffloadCaRelease( ss_ctx_t * ctx )
 {
-    ss_ctx_t * ctx = ( ss_ctx_t * ) param;
-    int s = ctx->ip_socket;
+    if( NULL != ctx->ca )
+    {
+        xSemaphoreTake( ca_mutex, portMAX_DELAY );
+        ctx->ca->users--;
+        xSemaphoreGive( ca_mutex );
+        ctx->ca = NULL;
+    }
+}
 
-    fd_set read_fds;
-    fd_set write_fds;
-    fd_set err_fds;
+/*-----------------------------------------------------------*/
 
-    FD_ZERO( &read_fds );
-    FD_ZERO( &write_fds );
-    FD_ZERO( &err_fds );
+/*
+ * @brief Store the trusted server certificate of a socket in the
+ * cellular module and put the name it is stored under in name.
+ *
+ * A slot already holding exactly the same certificate is used if
+ * there is one, else a slot that no socket is using is given the
+ * certificate; either way the slot is then the socket's until it
+ * is closed, so the certificate under that name cannot change
+ * beneath it.  Storing the same certificate again under the same
+ * name sends nothing to the module, see
+ * cellularSockTlsStoreCredential().
+ */
+static BaseType_t prvTlsOffloadCaStore( ss_ctx_t * ctx,
+                                        char * name,
+                                        size_t name_size )
+{
+    ss_ca_t * ca = NULL;
+    BaseType_t ret = SOCKETS_SOCKET_ERROR;
+    int i;
 
-    FD_SET( s, &read_fds );
-    FD_SET( s, &err_fds );
+    prvTlsOffloadCaRelease( ctx );
 
-    ctx->state = SST_RX_READY;
+    xSemaphoreTake( ca_mutex, portMAX_DELAY );
 
-    while( 1 )
+    for( i = 0; ( NULL == ca ) && ( i < socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS ); i++ )
+    {
+        if( ( NULL != ca_slots[ i ].cert ) &&
+            ( ca_slots[ i ].cert_len == ctx->server_cert_len ) &&
+            ( 0 == memcmp( ca_slots[ i ].cert, ctx->server_cert,
+                           ctx->server_cert_len ) ) )
+        {
+            ca = &ca_slots[ i ];
+        }
+    }
+
+    for( i = 0; ( NULL == ca ) && ( i < socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS ); i++ )
+    {
+        if( 0 == ca_slots[ i ].users )
+        {
+            ca = &ca_slots[ i ];
+
+            if( NULL != ca->cert )
+            {
+                vPortFree( ca->cert );
+            }
+
+            ca->cert_len = 0;
+            ca->cert = ( char * ) pvPortMalloc( ctx->server_cert_len );
+
+            if( NULL != ca->cert )
+            {
+                memcpy( ca->cert, ctx->server_cert, ctx->server_cert_len );
+                ca->cert_len = ctx->server_cert_len;
+            }
+        }
+    }
+
+    if( ( NULL != ca ) && ( NULL != ca->cert ) )
+    {
+        snprintf( name, name_size, SS_TLS_SERVER_CERT_NAME_PREFIX "%d",
+                  ( int ) ( ca - ca_slots ) );
+
+        if( 0 == cellularSockTlsStoreCredential( CELLULAR_SOCK_TLS_CREDENTIAL_ROOT_CA,
+                                                 name, ctx->server_cert,
+                                                 ctx->server_cert_len ) )
+        {
+            ca->users++;
+            ctx->ca = ca;
+            ret = SOCKETS_ERROR_NONE;
+        }
+        else
+        {
+            /* Whatever the module now has under that name, it
+             * isn't this certificate. */
+            vPortFree( ca->cert );
+            ca->cert = NULL;
+            ca->cert_len = 0;
+        }
+    }
+
+    xSemaphoreGive( ca_mutex );
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Set up the cellular module to do TLS on the socket.
+ *
+ * The trusted server certificate, if there is one, is stored in
+ * the module, see prvTlsOffloadCaStore(), then a security profile
+ * is obtained for the settings and applied to the socket: a
+ * profile with the same settings is reused, allowing the module
+ * to resume the TLS session of a previous connection.
+ */
+static BaseType_t prvTlsOffloadSetUp( ss_ctx_t * ctx )
+{
+    CellularSockTlsProfile_t profile = { 0 };
+    char name[ CELLULAR_SOCK_TLS_CREDENTIAL_NAME_MAX_LENGTH_BYTES + 1 ];
+    int32_t profileId;
+
+    if( 0 < ctx->ulAlpnProtocolsCount )
     {
-        if( ctx->state == SST_RX_CLOSING )
+        configPRINTF( ( "ALPN not supported with TLS offload\n" ) );
+        return SOCKETS_SOCKET_ERROR;
+    }
+
+    profile.pRootCaName = CELLULAR_CFG_SOCK_TLS_OFFLOAD_ROOT_CA_NAME;
+
+    if( NULL != ctx->server_cert )
+    {
+        if( SOCKETS_ERROR_NONE != prvTlsOffloadCaStore( ctx, name, sizeof( name ) ) )
         {
-            ctx->rx_handle = NULL;
-            ctx->state = SST_RX_CLOSED;
-            vTaskDelete( NULL );
+            configPRINTF( ( "TLS offload: storing server certificate fail\n" ) );
+            return SOCKETS_SOCKET_ERROR;
         }
 
-        if( cellular_lwip_select( s + 1, &read_fds,
-                                  &write_fds,
-                                  &err_fds, NULL ) == -1 )
+        profile.pRootCaName = name;
+    }
+
+    profile.validation = CELLULAR_SOCK_TLS_VALIDATION_ROOT_CA;
+    if( NULL != ctx->destination )
+    {
+        profile.validation = CELLULAR_SOCK_TLS_VALIDATION_ROOT_CA_URL;
+        profile.pServerName = ctx->destination;
+    }
+    profile.pClientCertName = CELLULAR_CFG_SOCK_TLS_OFFLOAD_CLIENT_CERT_NAME;
+    profile.pClientKeyName = CELLULAR_CFG_SOCK_TLS_OFFLOAD_CLIENT_KEY_NAME;
+    profile.sessionResumption = true;
+
+    profileId = cellularSockTlsProfileGet( &profile );
+
+    if( ( 0 > profileId ) ||
+        ( 0 != cellular_lwip_setsockopt( ctx->ip_socket,
+                                         CELLULAR_SOCK_OPT_LEVEL_TLS,
+                                         CELLULAR_SOCK_OPT_TLS_SECURITY_PROFILE,
+                                         &profileId, sizeof( profileId ) ) ) )
+    {
+        configPRINTF( ( "TLS offload: security profile fail\n" ) );
+        return SOCKETS_SOCKET_ERROR;
+    }
+
+    return SOCKETS_ERROR_NONE;
+}
+
+#endif /* CELLULAR_CFG_SOCK_TLS_OFFLOAD */
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Find a socket among those with a receive callback.
+ *
+ * rx_mutex must be held.
+ */
+static int prvRxFind( const ss_ctx_t * ctx )
+{
+    int i;
+
+    for( i = 0; i < socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS; i++ )
+    {
+        if( rx_ctxs[ i ] == ctx )
         {
-            /*TaskHandle_t rx_handle = ctx->rx_handle; */
+            return i;
+        }
+    }
 
-            /*ctx->rx_handle   = NULL; */
-            /*ctx->rx_callback = NULL; */
+    return -1;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Queue a socket for the receive dispatcher, closed
+ * being true if this is to report a closure by the remote host.
+ *
+ * ctx is not dereferenced since this may be called for a socket
+ * that has just been closed; a socket is only ever in the queue
+ * once, see prvRxDrain(), so the queue cannot overflow.
+ */
+static void prvRxPost( ss_ctx_t * ctx,
+                       bool closed )
+{
+    int i;
+
+    xSemaphoreTake( rx_mutex, portMAX_DELAY );
 
-            /*vTaskDelete( rx_handle ); */
-            ctx->rx_handle = NULL;
-            vTaskDelete( NULL );
+    i = prvRxFind( ctx );
+
+    if( i >= 0 )
+    {
+        if( closed )
+        {
+            rx_closed[ i ] = true;
+        }
+
+        if( !rx_pending[ i ] &&
+            ( xQueueSend( rx_queue, &ctx, 0 ) == pdTRUE ) )
+        {
+            rx_pending[ i ] = true;
         }
+    }
+
+    xSemaphoreGive( rx_mutex );
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Remove a socket from the queue of the receive
+ * dispatcher, keeping the order of the others.
+ *
+ * rx_mutex must be held, so nothing can be added to the queue
+ * meanwhile; the dispatcher may take an entry meanwhile, hence
+ * the receive does not wait.
+ */
+static void prvRxDrain( const ss_ctx_t * ctx )
+{
+    ss_ctx_t * queued;
+    UBaseType_t n = uxQueueMessagesWaiting( rx_queue );
+
+    while( n > 0 )
+    {
+        n--;
+
+        if( ( xQueueReceive( rx_queue, &queued, 0 ) == pdTRUE ) &&
+            ( queued != ctx ) )
+        {
+            ( void ) xQueueSend( rx_queue, &queued, 0 );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Called by the cellular socket layer, in its callback
+ * task, when data arrives on a socket.
+ */
+static void prvRxDataCallback( void * param )
+{
+    prvRxPost( ( ss_ctx_t * ) param, false );
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Called by the cellular socket layer, in its callback
+ * task, when a socket is closed by the remote host.
+ */
+static void prvRxClosedCallback( void * param )
+{
+    prvRxPost( ( ss_ctx_t * ) param, true );
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief true if there is data waiting to be read on the
+ * socket; this does not block or talk to the module.
+ */
+static bool prvRxHasData( int s )
+{
+    int n = 0;
 
-        if( FD_ISSET( s, &read_fds ) )
+    return ( cellular_lwip_ioctl( s, FIONREAD, &n ) == 0 ) &&
+           ( n > 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief true if there is data, or a closure, waiting to be
+ * read on the socket; this does not block.  Note that a closed
+ * socket stays readable for ever.
+ */
+static bool prvRxReadable( int s )
+{
+    fd_set read_fds;
+    struct timeval timeout = { 0 };
+
+    FD_ZERO( &read_fds );
+    FD_SET( s, &read_fds );
+
+    return ( cellular_lwip_select( s + 1, &read_fds, NULL,
+                                   NULL, &timeout ) > 0 ) &&
+           FD_ISSET( s, &read_fds );
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief The receive dispatcher task.
+ *
+ * The receive callbacks are called here rather than in the
+ * callback task of the cellular socket layer since they will
+ * usually call SOCKETS_Recv().  While a socket still has data
+ * after its callback has returned it goes to the back of the
+ * queue, so one busy socket cannot hold up the others.  A
+ * closure is reported by one call of the callback: a closed
+ * socket is always readable so only data brings it back.
+ */
+static void vTaskRxDispatch( void * param )
+{
+    ss_ctx_t * ctx;
+    void ( * rx_callback )( Socket_t pxSocket );
+    bool closed;
+    int i;
+
+    ( void ) param;
+
+    while( 1 )
+    {
+        if( xQueueReceive( rx_queue, &ctx, portMAX_DELAY ) == pdTRUE )
         {
-            configASSERT( ctx->rx_callback );
-            ctx->rx_callback( ( Socket_t ) ctx );
-            /*vTaskDelay( 10 ); // delay a little bit to yield time for RX */
+            rx_callback = NULL;
+            closed = false;
+
+            xSemaphoreTake( rx_mutex, portMAX_DELAY );
+
+            i = prvRxFind( ctx );
+
+            if( i >= 0 )
+            {
+                /* This call reports the closure, if there was one. */
+                rx_pending[ i ] = false;
+                closed = rx_closed[ i ];
+                rx_closed[ i ] = false;
+                rx_callback = ctx->rx_callback;
+                rx_running = ctx;
+            }
+
+            xSemaphoreGive( rx_mutex );
+
+            if( rx_callback != NULL )
+            {
+                if( closed )
+                {
+                    cellularPortLog("CELLULAR_IOT_SECURE_SOCKETS: socket %d closed by the remote host.\n",
+                                    ctx->ip_socket);
+                }
+
+                rx_callback( ( Socket_t ) ctx );
+
+                /* The callback may have closed the socket. */
+                if( ( rx_running == ctx ) && prvRxHasData( ctx->ip_socket ) )
+                {
+                    prvRxPost( ctx, false );
+                }
+
+                rx_running = NULL;
+            }
         }
     }
 }
@@ -251,29 +627,110 @@ static void prvRxSelectSet( ss_ctx_t * ctx,
                             const void * pvOptionValue )
 {
     BaseType_t xReturned;
-    TaskHandle_t xHandle = NULL;
-    configSTACK_DEPTH_TYPE xStackDepth = socketsconfigRECEIVE_CALLBACK_TASK_STACK_DEPTH;
+    int i;
+
+    configASSERT( rx_mutex != NULL );
+
+    xSemaphoreTake( rx_mutex, portMAX_DELAY );
+
+    if( rx_dispatcher == NULL )
+    {
+        xReturned = xTaskCreate( vTaskRxDispatch,                                  /* pvTaskCode */
+                                 "rxd",                                            /* pcName */
+                                 socketsconfigRECEIVE_CALLBACK_TASK_STACK_DEPTH,   /* usStackDepth */
+                                 NULL,                                             /* pvParameters */
+                                 1,                                                /* uxPriority */
+                                 &rx_dispatcher );                                 /* pxCreatedTask */
+
+        configASSERT( xReturned == pdPASS );
+        configASSERT( rx_dispatcher != NULL );
+    }
 
     ctx->rx_callback = ( void ( * )( Socket_t ) )pvOptionValue;
 
-    xReturned = xTaskCreate( vTaskRxSelect, /* pvTaskCode */
-                             "rxs",         /* pcName */
-                             xStackDepth,   /* usStackDepth */
-                             ctx,           /* pvParameters */
-                             1,             /* uxPriority */
-                             &xHandle );    /* pxCreatedTask */
+    if( prvRxFind( ctx ) < 0 )
+    {
+        i = prvRxFind( NULL );
+        configASSERT( i >= 0 );
+        rx_ctxs[ i ] = ctx;
+        rx_pending[ i ] = false;
+        rx_closed[ i ] = false;
+    }
+
+    xSemaphoreGive( rx_mutex );
 
-    configASSERT( xReturned == pdPASS );
-    configASSERT( xHandle != NULL );
+    cellularSockRegisterCallbackData( ctx->ip_socket,
+                                      prvRxDataCallback,
+                                      ctx );
+    cellularSockRegisterCallbackClosed( ctx->ip_socket,
+                                        prvRxClosedCallback,
+                                        ctx );
 
-    ctx->rx_handle = xHandle;
+    /* Anything that arrived before now won't be signalled: if
+     * the socket is readable without data it was closed. */
+    if( prvRxHasData( ctx->ip_socket ) )
+    {
+        prvRxPost( ctx, false );
+    }
+    else if( prvRxReadable( ctx->ip_socket ) )
+    {
+        prvRxPost( ctx, true );
+    }
 }
 
 /*-----------------------------------------------------------*/
 
 static void prvRxSelectClear( ss_ctx_t * ctx )
 {
-    /* TODO */
+    int i;
+
+    if( rx_mutex == NULL )
+    {
+        return;
+    }
+
+    if( 0 <= ctx->ip_socket )
+    {
+        cellularSockRegisterCallbackData( ctx->ip_socket, NULL, NULL );
+        cellularSockRegisterCallbackClosed( ctx->ip_socket, NULL, NULL );
+    }
+
+    xSemaphoreTake( rx_mutex, portMAX_DELAY );
+
+    i = prvRxFind( ctx );
+
+    if( i >= 0 )
+    {
+        /* Don't leave an entry in rx_queue: it would take the
+         * place of one for another socket. */
+        prvRxDrain( ctx );
+        rx_ctxs[ i ] = NULL;
+        rx_pending[ i ] = false;
+        rx_closed[ i ] = false;
+    }
+
+    ctx->rx_callback = NULL;
+
+    xSemaphoreGive( rx_mutex );
+
+    /* Wait for a running callback to finish, unless it is the
+     * callback that is doing the clearing: the dispatcher uses
+     * ctx until it has let go of it, so this wait must not give
+     * up, since SOCKETS_Close() frees ctx next. */
+    if( xTaskGetCurrentTaskHandle() == rx_dispatcher )
+    {
+        if( rx_running == ctx )
+        {
+            rx_running = NULL;
+        }
+    }
+    else
+    {
+        while( rx_running == ctx )
+        {
+            vTaskDelay( 10 );
+        }
+    }
 }
 
 /*-----------------------------------------------------------*/
@@ -364,12 +821,31 @@ int32_t SOCKETS_Connect( Socket_t xSocket,
         sa_addr.sin_addr.s_addr = pxAddress->ulAddress;
         sa_addr.sin_port = pxAddress->usPort;
 
+        #if CELLULAR_CFG_SOCK_TLS_OFFLOAD
+            if( ctx->enforce_tls &&
+                ( SOCKETS_ERROR_NONE != prvTlsOffloadSetUp( ctx ) ) )
+            {
+                return SOCKETS_SOCKET_ERROR;
+            }
+        #endif
+
         ret = cellular_lwip_connect( ctx->ip_socket,
                                      ( struct sockaddr * ) &sa_addr,
                                      sizeof( sa_addr ) );
 
         if( 0 == ret )
         {
+        #if CELLULAR_CFG_SOCK_TLS_OFFLOAD
+            ctx->status |= SS_STATUS_CONNECTED;
+
+            if( ctx->enforce_tls )
+            {
+                /* The module has done the handshake as part of connecting. */
+                ctx->status |= SS_STATUS_SECURED;
+            }
+
+            return SOCKETS_ERROR_NONE;
+        #else
             TLSParams_t tls_params = { 0 };
             BaseType_t status;
 
@@ -409,6 +885,7 @@ int32_t SOCKETS_Connect( Socket_t xSocket,
             {
                 configPRINTF( ( "TLS_Connect fail (0x%x, %s)\n", ( unsigned int ) -status, ctx->destination ? ctx->destination : "NULL" ) );
             }
+        #endif /* CELLULAR_CFG_SOCK_TLS_OFFLOAD */
         }
         else
         {
@@ -457,7 +934,7 @@ int32_t SOCKETS_Recv( Socket_t xSocket,
         return SOCKETS_SOCKET_ERROR;
     }
 
-    if( ctx->enforce_tls )
+    if( SS_TLS_ON_MCU( ctx ) )
     {
         /* Receive through TLS pipe, if negotiated. */
         return TLS_Recv( ctx->tls_ctx, pvBuffer, xBufferLength );
@@ -498,7 +975,7 @@ int32_t SOCKETS_Send( Socket_t xSocket,
         return SOCKETS_SOCKET_ERROR;
     }
 
-    if( ctx->enforce_tls )
+    if( SS_TLS_ON_MCU( ctx ) )
     {
         /* Send through TLS pipe, if negotiated. */
         return TLS_Send( ctx->tls_ctx, pvBuffer, xDataLength );
@@ -560,6 +1037,10 @@ int32_t SOCKETS_Close( Socket_t xSocket )
 
     ctx = ( ss_ctx_t * ) xSocket;
 
+    /* Before anything is freed: the receive callback, which is
+     * likely to read from the socket, may be running. */
+    prvRxSelectClear( ctx );
+
     /* Clean-up application protocol array. */
     if( NULL != ctx->ppcAlpnProtocols )
     {
@@ -576,25 +1057,19 @@ int32_t SOCKETS_Close( Socket_t xSocket )
         vPortFree( ctx->ppcAlpnProtocols );
     }
 
-    if( true == ctx->enforce_tls )
-    {
-        TLS_Cleanup( ctx->tls_ctx );
-    }
-
-    if( 0 <= ctx->ip_socket )
-    {
-        if( ctx->rx_handle != NULL )
+    #if !CELLULAR_CFG_SOCK_TLS_OFFLOAD
+        if( true == ctx->enforce_tls )
         {
-            int cnt = 0;
-            ctx->state = SST_RX_CLOSING;
-
-            while( ( ctx->state != SST_RX_CLOSED ) && ( cnt < 30 ) )
-            {
-                cnt++;
-                vTaskDelay( 10 );
-            }
+            TLS_Cleanup( ctx->tls_ctx );
         }
+    #endif
 
+    #if CELLULAR_CFG_SOCK_TLS_OFFLOAD
+        prvTlsOffloadCaRelease( ctx );
+    #endif
+
+    if( 0 <= ctx->ip_socket )
+    {
         cellular_lwip_close( ctx->ip_socket );
 
         sockets_allocated++;
@@ -862,6 +1337,32 @@ BaseType_t SOCKETS_Init( void )
 
     cellularPortLog("CELLULAR_IOT_SECURE_SOCKETS: SOCKETS_Init() called.\n");
 
+    /* The receive dispatcher task itself is only created
+     * when a receive callback is first set. */
+    if( rx_mutex == NULL )
+    {
+        rx_mutex = xSemaphoreCreateMutex();
+        rx_queue = xQueueCreate( socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS,
+                                 sizeof( ss_ctx_t * ) );
+
+        if( ( rx_mutex == NULL ) || ( rx_queue == NULL ) )
+        {
+            xResult = pdFAIL;
+        }
+    }
+
+    #if CELLULAR_CFG_SOCK_TLS_OFFLOAD
+        if( ca_mutex == NULL )
+        {
+            ca_mutex = xSemaphoreCreateMutex();
+
+            if( ca_mutex == NULL )
+            {
+                xResult = pdFAIL;
+            }
+        }
+    #endif
+
     return xResult;
 }
 
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2020 u-blox Cambourne Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+    http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _CELLULAR_CFG_HW_PLATFORM_SPECIFIC_H_
+#define _CELLULAR_CFG_HW_PLATFORM_SPECIFIC_H_
+
+/* No #includes allowed here */
+
+/* This header file contains hardware configuration information for
+ * a Linux (or other POSIX) host.  There are no real pins on a
+ * host: a UART is a file descriptor (a pseudo-terminal, a serial
+ * device or an internal loop-back, see cellular_port_uart.c) and
+ * GPIOs are held in memory by a shim (see cellular_port_gpio.c).
+ * The pin numbers below are therefore only used to indicate
+ * whether a signal is present (>= 0) or not (-1) and, for the
+ * GPIOs, to index the shim.
+ */
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS FOR LINUX: MISC
+ * -------------------------------------------------------------- */
+
+#ifndef CELLULAR_CFG_UART
+/** The UART to use, 0 to CELLULAR_PORT_UART_MAX_NUM - 1.  The
+ * device behind it is taken from the environment variable
+ * CELLULAR_PORT_UARTx, where x is this number, e.g.
+ * CELLULAR_PORT_UART0=/dev/ttyUSB0; if that is not set a
+ * pseudo-terminal is created, the name of which is logged when
+ * the UART is initialised.
+ */
+# define CELLULAR_CFG_UART                           0
+#endif
+
+#ifndef CELLULAR_CFG_RTS_THRESHOLD
+/** The buffer threshold at which RTS is de-asserted: not used
+ * on this platform.
+ */
+# define CELLULAR_CFG_RTS_THRESHOLD                  0
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS FOR LINUX: PINS
+ * -------------------------------------------------------------- */
+
+#ifndef CELLULAR_CFG_PIN_ENABLE_POWER
+/** The GPIO output that enables power to the cellular module.
+ * -1 is used where there is no such connection.
+ */
+# define CELLULAR_CFG_PIN_ENABLE_POWER     -1
+#endif
+
+#ifndef CELLULAR_CFG_PIN_PWR_ON
+/** The GPIO output that that is connected to the PWR_ON pin of
+ * the cellular module.
+ */
+# define CELLULAR_CFG_PIN_PWR_ON           0
+#endif
+
+#ifndef CELLULAR_CFG_PIN_VINT
+/** The GPIO input that is connected to the VInt pin of the
+ * cellular module.
+ * -1 is used where there is no such connection.
+ */
+# define CELLULAR_CFG_PIN_VINT             -1
+#endif
+
+#ifndef CELLULAR_CFG_PIN_TXD
+/** The "pin" that sends UART data to the cellular module.
+ * Note: if this is the same as CELLULAR_CFG_PIN_RXD then the
+ * UART is looped back on itself, as if the two were wired
+ * together.
+ */
+# define CELLULAR_CFG_PIN_TXD              1
+#endif
+
+#ifndef CELLULAR_CFG_PIN_RXD
+/** The "pin" that receives UART data from the cellular module.
+ */
+# define CELLULAR_CFG_PIN_RXD              2
+#endif
+
+#ifndef CELLULAR_CFG_PIN_CTS
+/** The "pin" that the cellular modem will use to indicate that
+ * data can be sent to it.  Flow control is left to the device
+ * on this platform so this is only reported back through
+ * cellularPortIsCtsFlowControlEnabled().
+ * -1 is used where there is no such connection.
+ */
+# define CELLULAR_CFG_PIN_CTS              -1
+#endif
+
+#ifndef CELLULAR_CFG_PIN_RTS
+/** The "pin" that tells the cellular modem that it can send more
+ * data to us, see CELLULAR_CFG_PIN_CTS.
+ * -1 is used where there is no such connection.
+ */
+# define CELLULAR_CFG_PIN_RTS              -1
+#endif
+
+#endif // _CELLULAR_CFG_HW_PLATFORM_SPECIFIC_H_
+
+// End of file
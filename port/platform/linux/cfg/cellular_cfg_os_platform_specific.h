@@ -0,0 +1,109 @@
+/*
+ * Copyright 2020 u-blox Cambourne Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+    http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _CELLULAR_CFG_OS_PLATFORM_SPECIFIC_H_
+#define _CELLULAR_CFG_OS_PLATFORM_SPECIFIC_H_
+
+/* No #includes allowed here */
+
+/* This header file contains OS configuration information for
+ * a Linux (or other POSIX) host, where tasks are pthreads.
+ */
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS FOR LINUX: OS GENERIC
+ * -------------------------------------------------------------- */
+
+#ifndef CELLULAR_PORT_OS_PRIORITY_MIN
+/** The minimum task priority.  Tasks on this platform are
+ * pthreads under the default (non-real-time) scheduling policy
+ * so priority is accepted for compatibility but not applied;
+ * the range is kept the same as FreeRTOS so that the relative
+ * priorities used by the cellular code remain valid.
+ */
+# define CELLULAR_PORT_OS_PRIORITY_MIN 0
+#endif
+
+#ifndef CELLULAR_PORT_OS_PRIORITY_MAX
+/** The maximum task priority, see CELLULAR_PORT_OS_PRIORITY_MIN.
+ */
+# define CELLULAR_PORT_OS_PRIORITY_MAX 25
+#endif
+
+#ifndef CELLULAR_PORT_OS_STACK_SIZE_MIN_BYTES
+/** The minimum stack size given to a task.  The stack sizes
+ * requested by the cellular code are sized for an MCU, whereas
+ * on a host the C library (printf() in particular) needs rather
+ * more, so any request smaller than this is rounded up.
+ */
+# define CELLULAR_PORT_OS_STACK_SIZE_MIN_BYTES (1024 * 64)
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS FOR LINUX: AT CLIENT RELATED
+ * -------------------------------------------------------------- */
+
+#ifndef CELLULAR_CTRL_AT_TASK_URC_STACK_SIZE_BYTES
+/** The stack size for the AT task that handles URCs.
+ */
+# define CELLULAR_CTRL_AT_TASK_URC_STACK_SIZE_BYTES (1024 * 5)
+#endif
+
+#ifndef CELLULAR_CTRL_AT_TASK_URC_PRIORITY
+/** The task priority for the URC handler.
+ */
+# define CELLULAR_CTRL_AT_TASK_URC_PRIORITY (CELLULAR_PORT_OS_PRIORITY_MAX - 5)
+#endif
+
+#ifndef CELLULAR_CTRL_TASK_CALLBACK_STACK_SIZE_BYTES
+/** The stack size of the task in the context of which the callbacks
+ * of AT command URCs will be run.
+ */
+# define CELLULAR_CTRL_TASK_CALLBACK_STACK_SIZE_BYTES (1024 * 5)
+#endif
+
+#ifndef CELLULAR_CTRL_TASK_CALLBACK_PRIORITY
+/** The task priority for any callback made via
+ * cellular_ctrl_at_callback().
+ */
+# define CELLULAR_CTRL_TASK_CALLBACK_PRIORITY (CELLULAR_PORT_OS_PRIORITY_MIN + 2)
+#endif
+
+#if (CELLULAR_CTRL_TASK_CALLBACK_PRIORITY >= CELLULAR_CTRL_AT_TASK_URC_PRIORITY)
+# error CELLULAR_CTRL_TASK_CALLBACK_PRIORITY must be less than CELLULAR_CTRL_AT_TASK_URC_PRIORITY
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS FOR LINUX: SOCKETS RELATED
+ * -------------------------------------------------------------- */
+
+#ifndef CELLULAR_SOCK_TASK_TX_FLUSH_STACK_SIZE_BYTES
+/** The stack size of the task that flushes the transmit buffers
+ * of TCP sockets when their flush time expires; the task is only
+ * created if a socket has a transmit buffer.
+ */
+# define CELLULAR_SOCK_TASK_TX_FLUSH_STACK_SIZE_BYTES (1024 * 3)
+#endif
+
+#ifndef CELLULAR_SOCK_TASK_TX_FLUSH_PRIORITY
+/** The task priority of the transmit buffer flush task.
+ */
+# define CELLULAR_SOCK_TASK_TX_FLUSH_PRIORITY (CELLULAR_PORT_OS_PRIORITY_MIN + 2)
+#endif
+
+#endif // _CELLULAR_CFG_OS_PLATFORM_SPECIFIC_H_
+
+// End of file
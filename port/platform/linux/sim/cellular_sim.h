@@ -0,0 +1,430 @@
+/*
+ * Copyright 2020 u-blox Cambourne Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _CELLULAR_SIM_H_
+#define _CELLULAR_SIM_H_
+
+/* No #includes allowed here: stdint.h, stddef.h, stdbool.h
+ * and poll.h must be included before this header.
+ */
+
+/* This header is internal to the cellular module simulator, which
+ * is a host program, not part of the cellular code: it is not for
+ * use by an application.
+ *
+ * The simulator is split into:
+ *
+ * - cellular_sim_main.c: command-line handling, creation of the
+ *   pseudo-terminal and the shared GPIO file and the launching of
+ *   the program under test,
+ * - cellular_sim_modem.c: the AT command engine, power state,
+ *   network registration and the general AT commands,
+ * - cellular_sim_net.c: the local echo servers and the AT
+ *   commands for sockets and DNS,
+ * - cellular_sim_mqtt.c: a stand-in for an MQTT broker and the
+ *   AT commands for MQTT.
+ */
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The maximum number of per-command settings that may be given
+ * on the command line.
+ */
+#define CELLULAR_SIM_MAX_NUM_COMMAND_SETTINGS 32
+
+/** The maximum length of the name of an AT command, e.g. "+USOWR",
+ * including room for a terminator.
+ */
+#define CELLULAR_SIM_COMMAND_NAME_MAX_LENGTH_BYTES 16
+
+/** The maximum number of parameters of an AT command.
+ */
+#define CELLULAR_SIM_COMMAND_MAX_NUM_PARAMETERS 16
+
+/** The maximum length of an AT command line, which must be able
+ * to hold an MQTT publish with its message as hex.
+ */
+#define CELLULAR_SIM_COMMAND_LINE_MAX_LENGTH_BYTES 4096
+
+/** The maximum amount of data that may follow a data prompt.
+ */
+#define CELLULAR_SIM_DATA_MAX_LENGTH_BYTES 4096
+
+/** The number of sockets the simulated module supports, as a
+ * SARA-R4/R5 does.
+ */
+#define CELLULAR_SIM_MAX_NUM_SOCKETS 7
+
+/** The IP address given to the PDP context.
+ */
+#define CELLULAR_SIM_IP_ADDRESS "10.20.30.40"
+
+/** The number of bytes in the GPIO file shared with the program
+ * under test, see cellular_port_gpio.c in the linux src
+ * directory: a byte per pin set by the program under test
+ * followed by a byte per pin driven by the simulator.
+ */
+#define CELLULAR_SIM_GPIO_MAX_NUM 64
+
+/** The value the simulator puts in its half of the shared GPIO
+ * file for a pin it is not driving.
+ */
+#define CELLULAR_SIM_GPIO_NOT_DRIVEN 0xFF
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** Settings for a single AT command, as given on the command line.
+ */
+typedef struct {
+    char name[CELLULAR_SIM_COMMAND_NAME_MAX_LENGTH_BYTES];
+    int32_t latencyMs; // -1 to use the default
+    int32_t errorPercent;
+    int32_t dropPercent;
+} CellularSimCommandSetting_t;
+
+/** The configuration of the simulator.
+ */
+typedef struct {
+    int32_t pinPwrOn;
+    int32_t pinVInt; // -1 if VInt is not driven
+    int32_t bootTimeMs;
+    int32_t registrationTimeMs;
+    int32_t connectTimeMs;
+    int32_t latencyMs;
+    int32_t jitterMs;
+    uint32_t seed;
+    bool verbose;
+    CellularSimCommandSetting_t commandSettings[CELLULAR_SIM_MAX_NUM_COMMAND_SETTINGS];
+    size_t numCommandSettings;
+} CellularSimConfig_t;
+
+/** The form of an AT command.
+ */
+typedef enum {
+    CELLULAR_SIM_COMMAND_TYPE_ACTION, // e.g. AT+CGSN
+    CELLULAR_SIM_COMMAND_TYPE_SET,    // e.g. AT+CFUN=1
+    CELLULAR_SIM_COMMAND_TYPE_QUERY,  // e.g. AT+CFUN?
+    CELLULAR_SIM_COMMAND_TYPE_TEST    // e.g. AT+CFUN=?
+} CellularSimCommandType_t;
+
+/** An AT command, broken into parameters; parameters that
+ * were quoted have their quotes removed.
+ */
+typedef struct {
+    char name[CELLULAR_SIM_COMMAND_NAME_MAX_LENGTH_BYTES];
+    CellularSimCommandType_t type;
+    char *pParameter[CELLULAR_SIM_COMMAND_MAX_NUM_PARAMETERS];
+    bool quoted[CELLULAR_SIM_COMMAND_MAX_NUM_PARAMETERS];
+    size_t numParameters;
+} CellularSimCommand_t;
+
+/** The handler for an AT command.  The handler must end the
+ * command with one of cellularSimOk(), cellularSimError() or
+ * cellularSimPrompt().
+ */
+typedef void (*CellularSimCommandHandler_t)(CellularSimCommand_t *pCommand);
+
+/** The handler for the data that follows a prompt.  The handler
+ * must end the command with cellularSimOk() or cellularSimError().
+ */
+typedef void (*CellularSimDataHandler_t)(const char *pData,
+                                         size_t dataSizeBytes,
+                                         void *pParam);
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS: MODEM
+ * -------------------------------------------------------------- */
+
+/** Run the simulated module until *pStop becomes true.
+ *
+ * @param pConfig  the configuration.
+ * @param fd       the file descriptor of the master side of the
+ *                 pseudo-terminal that is the module's UART.
+ * @param pGpio    the shared GPIO file, mapped into memory.
+ * @param pStop    set this to true to stop.
+ * @return         zero on success else negative error code.
+ */
+int32_t cellularSimModemRun(const CellularSimConfig_t *pConfig,
+                            int32_t fd, volatile uint8_t *pGpio,
+                            volatile bool *pStop);
+
+/** Get the time since the simulator started in milliseconds.
+ *
+ * @return the time in milliseconds.
+ */
+int64_t cellularSimGetTimeMs();
+
+/** Write an information response line, i.e. the text wrapped in
+ * \r\n, as part of the response to the current command.
+ *
+ * @param pFormat printf()-style format string.
+ */
+void cellularSimRespond(const char *pFormat, ...);
+
+/** Write an information response line that ends with binary data
+ * inside quotes, e.g. +USORD: 0,3,"abc", as part of the response
+ * to the current command.
+ *
+ * @param pPrefix       the text before the opening quote, a
+ *                      null-terminated string.
+ * @param pData         the data.
+ * @param dataSizeBytes the number of bytes of data.
+ */
+void cellularSimRespondWithData(const char *pPrefix, const char *pData,
+                                size_t dataSizeBytes);
+
+/** End the current command with "OK".
+ */
+void cellularSimOk();
+
+/** End the current command with an error.
+ */
+void cellularSimError();
+
+/** End the current command with a numbered +CME ERROR; this is
+ * given as a number even with AT+CMEE=2, just ERROR with
+ * AT+CMEE=0.
+ *
+ * @param code the +CME ERROR code.
+ */
+void cellularSimCmeError(int32_t code);
+
+/** Send a prompt and wait for a given number of bytes of data,
+ * which will be passed to pHandler once it has arrived.
+ *
+ * @param prompt        the prompt character, e.g. '@'.
+ * @param dataSizeBytes the number of bytes of data to wait for.
+ * @param pHandler      the handler to call with the data.
+ * @param pParam        a parameter to pass to pHandler.
+ */
+void cellularSimPrompt(char prompt, size_t dataSizeBytes,
+                       CellularSimDataHandler_t pHandler,
+                       void *pParam);
+
+/** Queue an unsolicited result code, which will be sent when
+ * no command is in progress.
+ *
+ * @param pFormat printf()-style format string.
+ */
+void cellularSimUrc(const char *pFormat, ...);
+
+/** Queue an unsolicited result code that has already been
+ * formed, including its leading and trailing \r\n; used where
+ * a URC carries binary data or spans several lines.
+ *
+ * @param pData         the URC.
+ * @param dataSizeBytes the number of bytes in the URC.
+ */
+void cellularSimUrcBytes(const char *pData, size_t dataSizeBytes);
+
+/** Call a function after a delay, provided the module is not
+ * powered off or rebooted before then.
+ *
+ * @param delayMs   the delay in milliseconds.
+ * @param pCallback the function to call.
+ * @param param     a parameter to pass to pCallback.
+ * @return          zero on success else negative error code.
+ */
+int32_t cellularSimTimerStart(int32_t delayMs,
+                              void (*pCallback)(int32_t),
+                              int32_t param);
+
+/** Whether a PDP context is active, i.e. whether sockets and
+ * MQTT may be used.
+ *
+ * @return true if a PDP context is active.
+ */
+bool cellularSimIsDataReady();
+
+/** Get the IMEI of the simulated module.
+ *
+ * @return the IMEI as a null-terminated string.
+ */
+const char *pCellularSimGetImei();
+
+/** Get the time the far end takes to answer a TCP connection.
+ *
+ * @return the time in milliseconds.
+ */
+int32_t cellularSimGetConnectTimeMs();
+
+/** Get an integer parameter of an AT command.
+ *
+ * @param pCommand  the command.
+ * @param index     the index of the parameter.
+ * @param pValue    a place to put the value.
+ * @return          true if the parameter is present and is
+ *                  an integer.
+ */
+bool cellularSimGetInt(const CellularSimCommand_t *pCommand,
+                       size_t index, int32_t *pValue);
+
+/** Get a string parameter of an AT command.
+ *
+ * @param pCommand  the command.
+ * @param index     the index of the parameter.
+ * @return          the string or NULL if there is no such
+ *                  parameter.
+ */
+const char *pCellularSimGetString(const CellularSimCommand_t *pCommand,
+                                  size_t index);
+
+/** Decode a hex string.
+ *
+ * @param pHex      the null-terminated hex string.
+ * @param pBinary   a place to put the decoded bytes.
+ * @param maxSize   the amount of storage at pBinary.
+ * @return          the number of bytes decoded or -1 if pHex
+ *                  is not hex or does not fit.
+ */
+int32_t cellularSimFromHex(const char *pHex, char *pBinary,
+                           size_t maxSize);
+
+/** Encode binary data as hex.
+ *
+ * @param pBinary       the data.
+ * @param dataSizeBytes the number of bytes of data.
+ * @param pHex          a place to put the hex, which must have
+ *                      room for dataSizeBytes * 2 characters;
+ *                      no terminator is added.
+ */
+void cellularSimToHex(const char *pBinary, size_t dataSizeBytes,
+                      char *pHex);
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS: NET
+ * -------------------------------------------------------------- */
+
+/** Start the local TCP and UDP echo servers.
+ *
+ * @return zero on success else negative error code.
+ */
+int32_t cellularSimNetInit();
+
+/** Add a host name to the simulated DNS.
+ *
+ * @param pName      the host name.
+ * @param pIpAddress the IP address to resolve it to.
+ * @return           zero on success else negative error code.
+ */
+int32_t cellularSimNetAddHost(const char *pName,
+                              const char *pIpAddress);
+
+/** Close all sockets, as happens when the module is powered off.
+ */
+void cellularSimNetReset();
+
+/** Add the file descriptors of the open sockets to a poll()
+ * array.
+ *
+ * @param pPollFds      the array.
+ * @param maxNumFds     the number of entries free in the array.
+ * @return              the number of entries added.
+ */
+size_t cellularSimNetPollFds(struct pollfd *pPollFds, size_t maxNumFds);
+
+/** Collect any data that has arrived on the open sockets.
+ */
+void cellularSimNetService();
+
+/** Send any URCs for socket data that has arrived; called by
+ * the engine when no command is in progress.
+ */
+void cellularSimNetUrcs();
+
+/** AT command handlers for sockets and DNS.
+ */
+void cellularSimNetUSOCR(CellularSimCommand_t *pCommand);
+void cellularSimNetUSOCO(CellularSimCommand_t *pCommand);
+void cellularSimNetUSOWR(CellularSimCommand_t *pCommand);
+void cellularSimNetUSOST(CellularSimCommand_t *pCommand);
+void cellularSimNetUSORD(CellularSimCommand_t *pCommand);
+void cellularSimNetUSORF(CellularSimCommand_t *pCommand);
+void cellularSimNetUSOCL(CellularSimCommand_t *pCommand);
+void cellularSimNetUSOLI(CellularSimCommand_t *pCommand);
+void cellularSimNetUSOSEC(CellularSimCommand_t *pCommand);
+void cellularSimNetUSOSO(CellularSimCommand_t *pCommand);
+void cellularSimNetUSOGO(CellularSimCommand_t *pCommand);
+void cellularSimNetUDNSRN(CellularSimCommand_t *pCommand);
+void cellularSimNetUDCONF(CellularSimCommand_t *pCommand);
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS: MQTT
+ * -------------------------------------------------------------- */
+
+/** Reset the MQTT state, as happens when the module is powered
+ * off.
+ */
+void cellularSimMqttReset();
+
+/** Determine whether an MQTT topic name matches a topic filter,
+ * which may include the wildcards '+' and '#'.
+ *
+ * @param pFilter    the topic filter.
+ * @param pTopic     the topic name.
+ * @return           true if there is a match.
+ */
+bool cellularSimMqttTopicMatch(const char *pFilter,
+                               const char *pTopic);
+
+/** AT command handlers for MQTT.
+ */
+void cellularSimMqttUMQTT(CellularSimCommand_t *pCommand);
+void cellularSimMqttUMQTTC(CellularSimCommand_t *pCommand);
+void cellularSimMqttUMQTTER(CellularSimCommand_t *pCommand);
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS: SECURITY
+ * -------------------------------------------------------------- */
+
+/** Forget the TLS sessions kept for resumption, as happens when
+ * the module is powered off; credentials and security profiles
+ * are kept.
+ */
+void cellularSimSecReset();
+
+/** Determine whether a security profile exists.
+ *
+ * @param id  the security profile.
+ * @return    true if there is such a profile.
+ */
+bool cellularSimSecProfileIsValid(int32_t id);
+
+/** Do the TLS handshake of a TCP connection with a security
+ * profile.
+ *
+ * @param id          the security profile.
+ * @param pIpAddress  the IP address of the server.
+ * @param port        the port number of the server.
+ * @return            the number of round trips the handshake
+ *                    takes or negative if it fails.
+ */
+int32_t cellularSimSecHandshake(int32_t id, const char *pIpAddress,
+                                int32_t port);
+
+/** AT command handlers for the credential store and security
+ * profiles.
+ */
+void cellularSimSecUSECMNG(CellularSimCommand_t *pCommand);
+void cellularSimSecUSECPRF(CellularSimCommand_t *pCommand);
+
+#endif // _CELLULAR_SIM_H_
+
+// End of file
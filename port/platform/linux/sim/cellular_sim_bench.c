@@ -0,0 +1,1541 @@
+/*
+ * Copyright 2020 u-blox Cambourne Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Throughput and latency benchmarks for the sockets API, intended
+ * to be run against the cellular module simulator, e.g.:
+ *
+ * cellular_sim -s 1 -L 20 -j 5 -- cellular_sim_bench
+ *
+ * Since the simulator's timing is derived from its seed, the
+ * numbers are repeatable from one run to the next on the same
+ * machine, which makes them useful for comparing one version of
+ * the driver with another.
+ */
+
+#ifdef CELLULAR_CFG_OVERRIDE
+# include "cellular_cfg_override.h" // For a customer's configuration override
+#endif
+#include "cellular_cfg_sw.h"
+#include "cellular_cfg_module.h"
+#include "cellular_cfg_hw_platform_specific.h"
+#include "cellular_cfg_os_platform_specific.h"
+#include "cellular_cfg_test.h"
+#include "cellular_port_clib.h"
+#include "cellular_port.h"
+#include "cellular_port_debug.h"
+#include "cellular_port_os.h"
+#include "cellular_port_uart.h"
+#include "cellular_ctrl.h"
+#include "cellular_sock.h"
+#include "cellular_sock_errno.h" // For CELLULAR_SOCK_EINPROGRESS
+#include "cellular_ctrl_at.h" // For the UART byte counts
+
+#include "sys/resource.h" // For getrusage()
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+// How much stack the task running the benchmarks needs in bytes.
+#define CELLULAR_SIM_BENCH_TASK_STACK_SIZE_BYTES (1024 * 4)
+
+// The priority of the task running the benchmarks: should be low.
+#define CELLULAR_SIM_BENCH_TASK_PRIORITY (CELLULAR_PORT_OS_PRIORITY_MIN + 1)
+
+// The number of bytes to send over TCP for the throughput benchmark.
+#define CELLULAR_SIM_BENCH_TCP_SIZE_BYTES (1024 * 32)
+
+// The size of each TCP write.
+#define CELLULAR_SIM_BENCH_TCP_CHUNK_SIZE_BYTES 1024
+
+// The number of bytes echoed over TCP for the download benchmark.
+#define CELLULAR_SIM_BENCH_DOWNLOAD_SIZE_BYTES (1024 * 1024)
+
+// How long the download benchmark waits for a data callback
+// once all has been sent, before looking again.
+#define CELLULAR_SIM_BENCH_DOWNLOAD_WAIT_MS 10
+
+// The number of bytes echoed over TCP for the record-read benchmark.
+#define CELLULAR_SIM_BENCH_RECORD_SIZE_BYTES (1024 * 8)
+
+// The size of each record, header included, for the record-read
+// benchmark.
+#define CELLULAR_SIM_BENCH_RECORD_LENGTH_BYTES 512
+
+// The size of the header at the start of each record, which is
+// read separately, the way a TLS stack reads a TLS record.
+#define CELLULAR_SIM_BENCH_RECORD_HEADER_LENGTH_BYTES 5
+
+// The number of records written, a header and then a body each,
+// for the small-write benchmark.
+#define CELLULAR_SIM_BENCH_SMALL_WRITE_NUM_RECORDS 32
+
+// The length of the body of each record written for the
+// small-write benchmark.
+#define CELLULAR_SIM_BENCH_SMALL_WRITE_BODY_LENGTH_BYTES 59
+
+// The number of single writes to an idle socket for which the
+// time until the echo arrives is measured.
+#define CELLULAR_SIM_BENCH_SMALL_WRITE_NUM_IDLE 10
+
+// The size of each single write to an idle socket.
+#define CELLULAR_SIM_BENCH_SMALL_WRITE_IDLE_LENGTH_BYTES 16
+
+// The number of UDP round trips for the latency benchmark.
+#define CELLULAR_SIM_BENCH_UDP_NUM_ROUND_TRIPS 50
+
+// The size of each UDP datagram for the latency benchmark.
+#define CELLULAR_SIM_BENCH_UDP_SIZE_BYTES 100
+
+// The number of back-to-back UDP sends for the send rate benchmark.
+#define CELLULAR_SIM_BENCH_UDP_NUM_SENDS 50
+
+// The number of datagrams in each burst of the UDP burst send
+// benchmark, e.g. readings sent by a sensor to a collector.
+#define CELLULAR_SIM_BENCH_UDP_BURST_LENGTH 20
+
+// The size of each datagram of the UDP burst send benchmark.
+#define CELLULAR_SIM_BENCH_UDP_BURST_SIZE_BYTES 32
+
+// The number of bursts of the UDP burst send benchmark.
+#define CELLULAR_SIM_BENCH_UDP_NUM_BURSTS 5
+
+// The number of UDP datagrams echoed and left to queue up in
+// the module before being read, in each round of the receive
+// rate benchmark; no more than the simulator will hold.
+#define CELLULAR_SIM_BENCH_UDP_NUM_QUEUED 16
+
+// The number of rounds of the UDP receive rate benchmark.
+#define CELLULAR_SIM_BENCH_UDP_NUM_ROUNDS 4
+
+// How long to let echoed datagrams settle in the module before
+// reading them.
+#define CELLULAR_SIM_BENCH_UDP_SETTLE_TIME_MS 1000
+
+// The number of look-ups of the same host name, as if
+// reconnecting to a server, for the DNS benchmark.
+#define CELLULAR_SIM_BENCH_DNS_NUM_LOOKUPS 10
+
+// How long to wait for echoed data before giving up.
+#define CELLULAR_SIM_BENCH_TIMEOUT_MS 10000
+
+// The number of TCP connections made at once for the connect
+// benchmark, as after a reconnect storm.
+#define CELLULAR_SIM_BENCH_CONNECT_NUM_SOCKETS 4
+
+// The number of secure connections made to the same server for
+// the TLS benchmark, the first with a full handshake.
+#define CELLULAR_SIM_BENCH_TLS_NUM_CONNECTS 4
+
+// The name under which the TLS benchmark stores its root CA.
+#define CELLULAR_SIM_BENCH_TLS_ROOT_CA_NAME "bench-root-ca"
+
+// The number of sockets blocked in a receive for the idle benchmark.
+#define CELLULAR_SIM_BENCH_IDLE_NUM_READERS 4
+
+// How long the idle benchmark runs for.
+#define CELLULAR_SIM_BENCH_IDLE_TIME_MS 2000
+
+// How much stack each blocked reader task needs in bytes.
+#define CELLULAR_SIM_BENCH_IDLE_TASK_STACK_SIZE_BYTES (1024 * 2)
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+// A flight of a TLS handshake run on the MCU: what the client
+// sends and what the server sends back.
+typedef struct {
+    size_t txSizeBytes;
+    size_t rxSizeBytes;
+} CellularSimBenchTlsFlight_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+// The flights of a typical full TLS 1.2 handshake run on the MCU,
+// mbedTLS with no session resumption: ClientHello then ServerHello
+// with a two-certificate chain, ServerKeyExchange and
+// ServerHelloDone; ClientKeyExchange, ChangeCipherSpec and Finished
+// then ChangeCipherSpec and Finished.
+static const CellularSimBenchTlsFlight_t gTlsMcuFlights[] = {{256, 3072},
+                                                             {160, 64}};
+
+// Handle for the UART queue.
+static CellularPortQueueHandle_t gUartQueueHandle = NULL;
+
+// Time at which a connection attempt is abandoned.
+static int64_t gStopTimeMs;
+
+// Buffer for data to send.
+static char gSendBuffer[CELLULAR_SIM_BENCH_TCP_SIZE_BYTES];
+
+// Buffer for data received.
+static char gReceiveBuffer[CELLULAR_SIM_BENCH_TCP_SIZE_BYTES];
+
+// The exit code of the process: zero if all benchmarks ran.
+static int gExitCode = 0;
+
+// Queue on which the blocked reader tasks report that they are done.
+static CellularPortQueueHandle_t gIdleQueueHandle = NULL;
+
+// Set by the data callback of the download benchmark.
+static volatile bool gDownloadDataReady = false;
+
+// The number of times the data callback of the download
+// benchmark has been called.
+static volatile size_t gDownloadNumCallbacks = 0;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Callback function for the cellular connect process.
+static bool keepGoingCallback()
+{
+    return cellularPortGetTickTimeMs() < gStopTimeMs;
+}
+
+// Power up the module and connect to the network.
+static int32_t networkConnect()
+{
+    int32_t errorCode;
+
+    errorCode = cellularPortUartInit(CELLULAR_CFG_PIN_TXD,
+                                     CELLULAR_CFG_PIN_RXD,
+                                     CELLULAR_CFG_PIN_CTS,
+                                     CELLULAR_CFG_PIN_RTS,
+                                     CELLULAR_CFG_BAUD_RATE,
+                                     CELLULAR_CFG_RTS_THRESHOLD,
+                                     CELLULAR_CFG_UART,
+                                     &gUartQueueHandle);
+    if (errorCode == 0) {
+        errorCode = cellularCtrlInit(CELLULAR_CFG_PIN_ENABLE_POWER,
+                                     CELLULAR_CFG_PIN_PWR_ON,
+                                     CELLULAR_CFG_PIN_VINT,
+                                     false,
+                                     CELLULAR_CFG_UART,
+                                     gUartQueueHandle);
+    }
+    if (errorCode == 0) {
+        errorCode = cellularCtrlPowerOn(NULL);
+    }
+    if (errorCode == 0) {
+        cellularPortLog("CELLULAR_SIM_BENCH: connecting...\n");
+        gStopTimeMs = cellularPortGetTickTimeMs() +
+                      (CELLULAR_CFG_TEST_CONNECT_TIMEOUT_SECONDS * 1000);
+        errorCode = cellularCtrlConnect(keepGoingCallback,
+                                        CELLULAR_CFG_TEST_APN,
+                                        CELLULAR_CFG_TEST_USERNAME,
+                                        CELLULAR_CFG_TEST_PASSWORD);
+    }
+
+    return errorCode;
+}
+
+// Disconnect, power down the module and tidy up.
+static void networkDisconnect()
+{
+    cellularSockDeinit();
+    cellularCtrlDisconnect();
+    cellularCtrlPowerOff(NULL);
+    cellularCtrlDeinit();
+    cellularPortUartDeinit(CELLULAR_CFG_UART);
+}
+
+// Look up a host name and create a socket.
+static int32_t openSocket(const char *pDomainName, int32_t port,
+                          CellularSockType_t type,
+                          CellularSockProtocol_t protocol,
+                          CellularSockAddress_t *pRemoteAddress)
+{
+    int32_t descriptor = -1;
+
+    if (cellularSockGetHostByName(pDomainName,
+                                  &(pRemoteAddress->ipAddress)) == 0) {
+        pRemoteAddress->port = port;
+        descriptor = cellularSockCreate(type, protocol);
+    } else {
+        cellularPortLog("CELLULAR_SIM_BENCH: unable to look up \"%s\".\n",
+                        pDomainName);
+    }
+
+    return descriptor;
+}
+
+// TCP throughput: write a block of data in chunks, reading back
+// the echo as it goes, and report the rate.
+static int32_t benchTcp()
+{
+    int32_t errorCode = -1;
+    CellularSockAddress_t remoteAddress;
+    int32_t descriptor;
+    size_t sent = 0;
+    size_t received = 0;
+    int32_t x;
+    int64_t startTimeMs;
+    int64_t timeoutMs;
+    int64_t durationMs;
+
+    for (size_t y = 0; y < sizeof(gSendBuffer); y++) {
+        gSendBuffer[y] = (char) ('!' + (y % 94));
+    }
+
+    descriptor = openSocket(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                            CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT,
+                            CELLULAR_SOCK_TYPE_STREAM,
+                            CELLULAR_SOCK_PROTOCOL_TCP,
+                            &remoteAddress);
+    if ((descriptor >= 0) &&
+        (cellularSockConnect(descriptor, &remoteAddress) == 0)) {
+        // Non-blocking, so that a read with nothing to read
+        // doesn't hold up the next write
+        cellularSockFcntl(descriptor, CELLULAR_SOCK_FCNTL_SET_STATUS,
+                          CELLULAR_SOCK_FCNTL_STATUS_NONBLOCK);
+        startTimeMs = cellularPortGetTickTimeMs();
+        timeoutMs = startTimeMs + CELLULAR_SIM_BENCH_TIMEOUT_MS;
+        while ((received < sizeof(gReceiveBuffer)) &&
+               (cellularPortGetTickTimeMs() < timeoutMs)) {
+            if (sent < sizeof(gSendBuffer)) {
+                x = sizeof(gSendBuffer) - sent;
+                if (x > CELLULAR_SIM_BENCH_TCP_CHUNK_SIZE_BYTES) {
+                    x = CELLULAR_SIM_BENCH_TCP_CHUNK_SIZE_BYTES;
+                }
+                x = cellularSockWrite(descriptor, gSendBuffer + sent, x);
+                if (x > 0) {
+                    sent += x;
+                    timeoutMs = cellularPortGetTickTimeMs() +
+                                CELLULAR_SIM_BENCH_TIMEOUT_MS;
+                }
+            }
+            x = cellularSockRead(descriptor, gReceiveBuffer + received,
+                                 sizeof(gReceiveBuffer) - received);
+            if (x > 0) {
+                received += x;
+                timeoutMs = cellularPortGetTickTimeMs() +
+                            CELLULAR_SIM_BENCH_TIMEOUT_MS;
+            }
+        }
+        durationMs = cellularPortGetTickTimeMs() - startTimeMs;
+        if ((received == sizeof(gReceiveBuffer)) &&
+            (cellularPort_memcmp(gSendBuffer, gReceiveBuffer, received) == 0)) {
+            if (durationMs < 1) {
+                durationMs = 1;
+            }
+            cellularPortLog("CELLULAR_SIM_BENCH: TCP %d byte(s) echoed"
+                            " in %d ms, %d byte(s)/s.\n",
+                            (int) received, (int) durationMs,
+                            (int) ((received * 1000) / durationMs));
+            errorCode = 0;
+        } else {
+            cellularPortLog("CELLULAR_SIM_BENCH: TCP sent %d byte(s),"
+                            " %d byte(s) echoed, %s.\n",
+                            (int) sent, (int) received,
+                            received == sizeof(gReceiveBuffer) ?
+                            "DIFFERENT" : "INCOMPLETE");
+        }
+    } else {
+        cellularPortLog("CELLULAR_SIM_BENCH: unable to connect TCP socket.\n");
+    }
+    if (descriptor >= 0) {
+        cellularSockClose(descriptor);
+    }
+
+    return errorCode;
+}
+
+// Data callback for the download benchmark.
+static void downloadCallback(void *pParam)
+{
+    (void) pParam;
+
+    gDownloadNumCallbacks++;
+    gDownloadDataReady = true;
+}
+
+// Download: echo a large block of data over TCP, reading it back
+// only when the data callback says there is something to read,
+// as an application driven by the callback would, until there
+// is nothing left, and report the +UUSORD URCs received against
+// the data callbacks delivered.
+static int32_t benchDownload()
+{
+    int32_t errorCode = -1;
+    CellularSockAddress_t remoteAddress;
+    CellularSockStats_t stats;
+    int32_t descriptor;
+    size_t sent = 0;
+    size_t received = 0;
+    bool same = true;
+    int32_t x;
+    int64_t startTimeMs;
+    int64_t timeoutMs;
+    int64_t durationMs;
+
+    for (size_t y = 0; y < sizeof(gSendBuffer); y++) {
+        gSendBuffer[y] = (char) ('!' + (y % 94));
+    }
+    gDownloadDataReady = false;
+    gDownloadNumCallbacks = 0;
+
+    descriptor = openSocket(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                            CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT,
+                            CELLULAR_SOCK_TYPE_STREAM,
+                            CELLULAR_SOCK_PROTOCOL_TCP,
+                            &remoteAddress);
+    if ((descriptor >= 0) &&
+        (cellularSockRegisterCallbackData(descriptor, downloadCallback,
+                                          NULL) == 0) &&
+        (cellularSockConnect(descriptor, &remoteAddress) == 0)) {
+        cellularSockFcntl(descriptor, CELLULAR_SOCK_FCNTL_SET_STATUS,
+                          CELLULAR_SOCK_FCNTL_STATUS_NONBLOCK);
+        startTimeMs = cellularPortGetTickTimeMs();
+        timeoutMs = startTimeMs + CELLULAR_SIM_BENCH_TIMEOUT_MS;
+        while ((received < CELLULAR_SIM_BENCH_DOWNLOAD_SIZE_BYTES) && same &&
+               (cellularPortGetTickTimeMs() < timeoutMs)) {
+            if (sent < CELLULAR_SIM_BENCH_DOWNLOAD_SIZE_BYTES) {
+                x = CELLULAR_SIM_BENCH_DOWNLOAD_SIZE_BYTES - sent;
+                if (x > CELLULAR_SIM_BENCH_TCP_CHUNK_SIZE_BYTES) {
+                    x = CELLULAR_SIM_BENCH_TCP_CHUNK_SIZE_BYTES;
+                }
+                // Starting part-way into the pattern keeps it
+                // continuous from one write to the next
+                x = cellularSockWrite(descriptor, gSendBuffer + (sent % 94), x);
+                if (x > 0) {
+                    sent += x;
+                    timeoutMs = cellularPortGetTickTimeMs() +
+                                CELLULAR_SIM_BENCH_TIMEOUT_MS;
+                }
+            } else if (!gDownloadDataReady) {
+                cellularPortTaskBlock(CELLULAR_SIM_BENCH_DOWNLOAD_WAIT_MS);
+            }
+            if (gDownloadDataReady) {
+                // Clear the flag first: a callback from now on
+                // means there is more
+                gDownloadDataReady = false;
+                do {
+                    x = cellularSockRead(descriptor, gReceiveBuffer,
+                                         sizeof(gReceiveBuffer));
+                    for (int32_t y = 0; (y < x) && same; y++) {
+                        same = (gReceiveBuffer[y] == (char) ('!' + ((received + y) % 94)));
+                    }
+                    if (x > 0) {
+                        received += x;
+                        timeoutMs = cellularPortGetTickTimeMs() +
+                                    CELLULAR_SIM_BENCH_TIMEOUT_MS;
+                    }
+                } while ((x > 0) && same);
+            }
+        }
+        durationMs = cellularPortGetTickTimeMs() - startTimeMs;
+        if ((received == CELLULAR_SIM_BENCH_DOWNLOAD_SIZE_BYTES) && same &&
+            (cellularSockGetStats(descriptor, &stats) == 0)) {
+            if (durationMs < 1) {
+                durationMs = 1;
+            }
+            cellularPortLog("CELLULAR_SIM_BENCH: TCP download of %d byte(s)"
+                            " in %d ms, %d byte(s)/s, %d URC(s), %d data"
+                            " callback(s) queued, %d delivered.\n",
+                            (int) received, (int) durationMs,
+                            (int) ((received * 1000) / durationMs),
+                            (int) stats.numUrcs, (int) stats.numDataCallbacks,
+                            (int) gDownloadNumCallbacks);
+            errorCode = 0;
+        } else {
+            cellularPortLog("CELLULAR_SIM_BENCH: TCP download sent %d byte(s),"
+                            " %d byte(s) echoed, %s.\n",
+                            (int) sent, (int) received,
+                            same ? "INCOMPLETE" : "DIFFERENT");
+        }
+    } else {
+        cellularPortLog("CELLULAR_SIM_BENCH: unable to connect TCP socket.\n");
+    }
+    if (descriptor >= 0) {
+        cellularSockClose(descriptor);
+    }
+
+    return errorCode;
+}
+
+// UDP send rate: a number of small datagrams sent back to back,
+// without waiting for the echoes, reporting the sends per second.
+static int32_t benchUdpSend()
+{
+    int32_t errorCode = -1;
+    CellularSockAddress_t remoteAddress;
+    int32_t descriptor;
+    size_t numSends = 0;
+    int64_t startTimeMs;
+    int64_t durationMs;
+
+    descriptor = openSocket(CELLULAR_CFG_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+                            CELLULAR_CFG_TEST_ECHO_UDP_SERVER_PORT,
+                            CELLULAR_SOCK_TYPE_DGRAM,
+                            CELLULAR_SOCK_PROTOCOL_UDP,
+                            &remoteAddress);
+    if (descriptor >= 0) {
+        startTimeMs = cellularPortGetTickTimeMs();
+        for (size_t y = 0; y < CELLULAR_SIM_BENCH_UDP_NUM_SENDS; y++) {
+            if (cellularSockSendTo(descriptor, &remoteAddress, gSendBuffer,
+                                   CELLULAR_SIM_BENCH_UDP_SIZE_BYTES) ==
+                CELLULAR_SIM_BENCH_UDP_SIZE_BYTES) {
+                numSends++;
+            }
+        }
+        durationMs = cellularPortGetTickTimeMs() - startTimeMs;
+        if (durationMs < 1) {
+            durationMs = 1;
+        }
+        if (numSends == CELLULAR_SIM_BENCH_UDP_NUM_SENDS) {
+            cellularPortLog("CELLULAR_SIM_BENCH: UDP %d send(s) of %d byte(s)"
+                            " in %d ms, %d.%01d send(s)/s.\n",
+                            (int) numSends, CELLULAR_SIM_BENCH_UDP_SIZE_BYTES,
+                            (int) durationMs,
+                            (int) ((numSends * 1000) / durationMs),
+                            (int) (((numSends * 10000) / durationMs) % 10));
+            errorCode = 0;
+        } else {
+            cellularPortLog("CELLULAR_SIM_BENCH: UDP only %d of %d send(s)"
+                            " succeeded.\n", (int) numSends,
+                            CELLULAR_SIM_BENCH_UDP_NUM_SENDS);
+        }
+        cellularSockClose(descriptor);
+    } else {
+        cellularPortLog("CELLULAR_SIM_BENCH: unable to create UDP socket.\n");
+    }
+
+    return errorCode;
+}
+
+// UDP burst send rate: bursts of small datagrams to the same
+// host, one per cellularSockSendTo() or, if multi is true, a
+// burst per cellularSockSendToMulti(), reporting the datagrams
+// sent per second and the proportion of the capacity of the
+// UART that the data of the datagrams used, the rest going on
+// AT commands, responses and idle time.
+static int32_t benchUdpSendBurst(bool multi)
+{
+    int32_t errorCode = -1;
+    CellularSockAddress_t remoteAddress;
+    CellularSockDatagram_t datagrams[CELLULAR_SIM_BENCH_UDP_BURST_LENGTH];
+    int32_t descriptor;
+    size_t numSent = 0;
+    int32_t x;
+    int64_t startTimeMs;
+    int64_t durationMs = 0;
+    int64_t capacityBytes;
+
+    descriptor = openSocket(CELLULAR_CFG_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+                            CELLULAR_CFG_TEST_ECHO_UDP_SERVER_PORT,
+                            CELLULAR_SOCK_TYPE_DGRAM,
+                            CELLULAR_SOCK_PROTOCOL_UDP,
+                            &remoteAddress);
+    if (descriptor >= 0) {
+        for (size_t y = 0; y < CELLULAR_SIM_BENCH_UDP_BURST_LENGTH; y++) {
+            datagrams[y].pData = gSendBuffer + (y * CELLULAR_SIM_BENCH_UDP_BURST_SIZE_BYTES);
+            datagrams[y].dataSizeBytes = CELLULAR_SIM_BENCH_UDP_BURST_SIZE_BYTES;
+            datagrams[y].address = remoteAddress;
+        }
+        for (size_t b = 0; b < CELLULAR_SIM_BENCH_UDP_NUM_BURSTS; b++) {
+            startTimeMs = cellularPortGetTickTimeMs();
+            if (multi) {
+                x = cellularSockSendToMulti(descriptor, datagrams,
+                                            CELLULAR_SIM_BENCH_UDP_BURST_LENGTH);
+                if (x > 0) {
+                    numSent += x;
+                }
+            } else {
+                for (size_t y = 0; y < CELLULAR_SIM_BENCH_UDP_BURST_LENGTH; y++) {
+                    if (cellularSockSendTo(descriptor, &(datagrams[y].address),
+                                           datagrams[y].pData,
+                                           datagrams[y].dataSizeBytes) ==
+                        CELLULAR_SIM_BENCH_UDP_BURST_SIZE_BYTES) {
+                        numSent++;
+                    }
+                }
+            }
+            durationMs += cellularPortGetTickTimeMs() - startTimeMs;
+            // Let the echoes come back and be thrown away by
+            // the module before the next burst
+            cellularPortTaskBlock(CELLULAR_SIM_BENCH_UDP_SETTLE_TIME_MS);
+        }
+        if (durationMs < 1) {
+            durationMs = 1;
+        }
+        // Ten bit periods per byte
+        capacityBytes = (((int64_t) CELLULAR_CFG_BAUD_RATE) * durationMs) / 10000;
+        if (capacityBytes < 1) {
+            capacityBytes = 1;
+        }
+        if (numSent == CELLULAR_SIM_BENCH_UDP_BURST_LENGTH *
+                       CELLULAR_SIM_BENCH_UDP_NUM_BURSTS) {
+            cellularPortLog("CELLULAR_SIM_BENCH: UDP %s: %d burst(s) of %d"
+                            " datagram(s) of %d byte(s) sent in %d ms,"
+                            " %d.%01d datagram(s)/s, datagram data %d.%01d%%"
+                            " of UART capacity.\n",
+                            multi ? "cellularSockSendToMulti()" :
+                                    "cellularSockSendTo()",
+                            CELLULAR_SIM_BENCH_UDP_NUM_BURSTS,
+                            CELLULAR_SIM_BENCH_UDP_BURST_LENGTH,
+                            CELLULAR_SIM_BENCH_UDP_BURST_SIZE_BYTES,
+                            (int) durationMs,
+                            (int) ((numSent * 1000) / durationMs),
+                            (int) (((numSent * 10000) / durationMs) % 10),
+                            (int) ((numSent * CELLULAR_SIM_BENCH_UDP_BURST_SIZE_BYTES * 100) /
+                                   capacityBytes),
+                            (int) (((numSent * CELLULAR_SIM_BENCH_UDP_BURST_SIZE_BYTES * 1000) /
+                                    capacityBytes) % 10));
+            errorCode = 0;
+        } else {
+            cellularPortLog("CELLULAR_SIM_BENCH: UDP only %d of %d burst"
+                            " send(s) succeeded.\n", (int) numSent,
+                            CELLULAR_SIM_BENCH_UDP_BURST_LENGTH *
+                            CELLULAR_SIM_BENCH_UDP_NUM_BURSTS);
+        }
+        cellularSockClose(descriptor);
+    } else {
+        cellularPortLog("CELLULAR_SIM_BENCH: unable to create UDP socket.\n");
+    }
+
+    return errorCode;
+}
+
+// UDP receive rate: let a number of echoed datagrams queue up
+// in the module and then time how long it takes to read them,
+// one per cellularSockReceiveFrom() or, if multi is true, as
+// many as will come per cellularSockReceiveFromMulti().
+static int32_t benchUdpReceive(bool multi)
+{
+    int32_t errorCode = -1;
+    CellularSockAddress_t remoteAddress;
+    CellularSockDatagram_t datagrams[CELLULAR_SIM_BENCH_UDP_NUM_QUEUED];
+    int32_t descriptor;
+    size_t numReceived = 0;
+    size_t numCalls = 0;
+    size_t numThisRound;
+    int32_t x;
+    int64_t startTimeMs;
+    int64_t durationMs = 0;
+
+    for (size_t y = 0; y < CELLULAR_SIM_BENCH_UDP_NUM_QUEUED; y++) {
+        datagrams[y].pData = gReceiveBuffer + (y * CELLULAR_SIM_BENCH_UDP_SIZE_BYTES);
+        datagrams[y].dataSizeBytes = CELLULAR_SIM_BENCH_UDP_SIZE_BYTES;
+    }
+
+    descriptor = openSocket(CELLULAR_CFG_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+                            CELLULAR_CFG_TEST_ECHO_UDP_SERVER_PORT,
+                            CELLULAR_SOCK_TYPE_DGRAM,
+                            CELLULAR_SOCK_PROTOCOL_UDP,
+                            &remoteAddress);
+    if (descriptor >= 0) {
+        for (size_t r = 0; r < CELLULAR_SIM_BENCH_UDP_NUM_ROUNDS; r++) {
+            for (size_t y = 0; y < CELLULAR_SIM_BENCH_UDP_NUM_QUEUED; y++) {
+                cellularSockSendTo(descriptor, &remoteAddress, gSendBuffer,
+                                   CELLULAR_SIM_BENCH_UDP_SIZE_BYTES);
+            }
+            cellularPortTaskBlock(CELLULAR_SIM_BENCH_UDP_SETTLE_TIME_MS);
+            numThisRound = 0;
+            x = 0;
+            startTimeMs = cellularPortGetTickTimeMs();
+            while ((numThisRound < CELLULAR_SIM_BENCH_UDP_NUM_QUEUED) && (x >= 0)) {
+                if (multi) {
+                    x = cellularSockReceiveFromMulti(descriptor, datagrams,
+                                                     CELLULAR_SIM_BENCH_UDP_NUM_QUEUED -
+                                                     numThisRound);
+                    if (x > 0) {
+                        numThisRound += x;
+                    }
+                } else {
+                    x = cellularSockReceiveFrom(descriptor, NULL, gReceiveBuffer,
+                                                CELLULAR_SIM_BENCH_UDP_SIZE_BYTES);
+                    if (x > 0) {
+                        numThisRound++;
+                    }
+                }
+                numCalls++;
+            }
+            durationMs += cellularPortGetTickTimeMs() - startTimeMs;
+            numReceived += numThisRound;
+        }
+        if (durationMs < 1) {
+            durationMs = 1;
+        }
+        if (numReceived == CELLULAR_SIM_BENCH_UDP_NUM_QUEUED *
+                           CELLULAR_SIM_BENCH_UDP_NUM_ROUNDS) {
+            cellularPortLog("CELLULAR_SIM_BENCH: UDP %s: %d queued datagram(s)"
+                            " of %d byte(s) read in %d call(s), %d ms,"
+                            " %d.%01d datagram(s)/s.\n",
+                            multi ? "cellularSockReceiveFromMulti()" :
+                                    "cellularSockReceiveFrom()",
+                            (int) numReceived, CELLULAR_SIM_BENCH_UDP_SIZE_BYTES,
+                            (int) numCalls, (int) durationMs,
+                            (int) ((numReceived * 1000) / durationMs),
+                            (int) (((numReceived * 10000) / durationMs) % 10));
+            errorCode = 0;
+        } else {
+            cellularPortLog("CELLULAR_SIM_BENCH: UDP only %d of %d queued"
+                            " datagram(s) read.\n", (int) numReceived,
+                            CELLULAR_SIM_BENCH_UDP_NUM_QUEUED *
+                            CELLULAR_SIM_BENCH_UDP_NUM_ROUNDS);
+        }
+        cellularSockClose(descriptor);
+    } else {
+        cellularPortLog("CELLULAR_SIM_BENCH: unable to create UDP socket.\n");
+    }
+
+    return errorCode;
+}
+
+// Record reads: echo a block of data over TCP and read it back
+// the way a TLS stack does, a short header and then the body of
+// each record, with the receive cache set to rxCacheSizeBytes,
+// reporting the number of AT+USORD transactions per KiB.
+static int32_t benchRecord(int32_t rxCacheSizeBytes)
+{
+    int32_t errorCode = -1;
+    CellularSockAddress_t remoteAddress;
+    CellularSockRxCacheStats_t stats;
+    int32_t descriptor;
+    size_t sent = 0;
+    size_t received = 0;
+    size_t wanted;
+    int32_t x;
+    int64_t startTimeMs;
+    int64_t durationMs;
+
+    for (size_t y = 0; y < CELLULAR_SIM_BENCH_RECORD_SIZE_BYTES; y++) {
+        gSendBuffer[y] = (char) ('!' + (y % 94));
+    }
+
+    descriptor = openSocket(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                            CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT,
+                            CELLULAR_SOCK_TYPE_STREAM,
+                            CELLULAR_SOCK_PROTOCOL_TCP,
+                            &remoteAddress);
+    if ((descriptor >= 0) &&
+        (cellularSockSetOption(descriptor, CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                               CELLULAR_SOCK_OPT_RCVBUF,
+                               &rxCacheSizeBytes,
+                               sizeof(rxCacheSizeBytes)) == 0) &&
+        (cellularSockConnect(descriptor, &remoteAddress) == 0)) {
+        while (sent < CELLULAR_SIM_BENCH_RECORD_SIZE_BYTES) {
+            x = CELLULAR_SIM_BENCH_RECORD_SIZE_BYTES - sent;
+            if (x > CELLULAR_SIM_BENCH_TCP_CHUNK_SIZE_BYTES) {
+                x = CELLULAR_SIM_BENCH_TCP_CHUNK_SIZE_BYTES;
+            }
+            x = cellularSockWrite(descriptor, gSendBuffer + sent, x);
+            if (x <= 0) {
+                break;
+            }
+            sent += x;
+        }
+        cellularSockResetRxCacheStats();
+        startTimeMs = cellularPortGetTickTimeMs();
+        x = 0;
+        while ((received < sent) && (x >= 0)) {
+            // Header first, then the remainder of the record
+            wanted = CELLULAR_SIM_BENCH_RECORD_HEADER_LENGTH_BYTES;
+            if ((received % CELLULAR_SIM_BENCH_RECORD_LENGTH_BYTES) != 0) {
+                wanted = CELLULAR_SIM_BENCH_RECORD_LENGTH_BYTES -
+                         (received % CELLULAR_SIM_BENCH_RECORD_LENGTH_BYTES);
+            }
+            x = cellularSockRead(descriptor, gReceiveBuffer + received,
+                                 wanted);
+            if (x > 0) {
+                received += x;
+            } else {
+                x = -1;
+            }
+        }
+        durationMs = cellularPortGetTickTimeMs() - startTimeMs;
+        if ((received == CELLULAR_SIM_BENCH_RECORD_SIZE_BYTES) &&
+            (cellularPort_memcmp(gSendBuffer, gReceiveBuffer, received) == 0) &&
+            (cellularSockGetRxCacheStats(&stats) == 0) &&
+            (stats.numReads > 0) && (stats.numBytesRead > 0)) {
+            cellularPortLog("CELLULAR_SIM_BENCH: TCP record reads with a %d"
+                            " byte receive cache: %d read(s) of %d byte(s)"
+                            " in %d ms, %d%% from the cache, %d.%02d"
+                            " AT+USORD per KiB.\n",
+                            (int) rxCacheSizeBytes, (int) stats.numReads,
+                            (int) stats.numBytesRead, (int) durationMs,
+                            (int) ((stats.numReadsFromCache * 100) / stats.numReads),
+                            (int) ((stats.numAtReads * 1024) / stats.numBytesRead),
+                            (int) (((stats.numAtReads * 102400) / stats.numBytesRead) % 100));
+            errorCode = 0;
+        } else {
+            cellularPortLog("CELLULAR_SIM_BENCH: TCP record reads sent %d"
+                            " byte(s), %d byte(s) read back, %s.\n",
+                            (int) sent, (int) received,
+                            received == CELLULAR_SIM_BENCH_RECORD_SIZE_BYTES ?
+                            "DIFFERENT" : "INCOMPLETE");
+        }
+    } else {
+        cellularPortLog("CELLULAR_SIM_BENCH: unable to connect TCP socket.\n");
+    }
+    if (descriptor >= 0) {
+        cellularSockClose(descriptor);
+    }
+
+    return errorCode;
+}
+
+// Read exactly dataSizeBytes from a TCP socket, returning the
+// number of bytes read.
+static size_t readAll(int32_t descriptor, char *pData, size_t dataSizeBytes)
+{
+    size_t received = 0;
+    int32_t x = 0;
+
+    while ((received < dataSizeBytes) && (x >= 0)) {
+        x = cellularSockRead(descriptor, pData + received,
+                             dataSizeBytes - received);
+        if (x > 0) {
+            received += x;
+        } else {
+            x = -1;
+        }
+    }
+
+    return received;
+}
+
+// Small writes: write records over TCP the way a TLS stack does,
+// a short header and then the body of each, with the transmit
+// buffer set to txBufferSizeBytes, reporting the number of
+// AT+USOWR transactions per write, then time how long a single
+// small write to an idle socket takes to come back, waiting with
+// cellularSockSelect() so that nothing but the transmit buffer
+// flush policy decides when it goes.
+static int32_t benchSmallWrites(int32_t txBufferSizeBytes)
+{
+    int32_t errorCode = -1;
+    CellularSockAddress_t remoteAddress;
+    CellularSockTxBufferStats_t stats;
+    CellularSockDescriptorSet_t readSet;
+    int32_t descriptor;
+    size_t sent = 0;
+    size_t received = 0;
+    size_t length;
+    int32_t x = 0;
+    int64_t startTimeMs;
+    int64_t durationMs;
+    int64_t latencyMs;
+    int64_t minMs = CELLULAR_SIM_BENCH_TIMEOUT_MS;
+    int64_t maxMs = 0;
+    int64_t totalMs = 0;
+    size_t numIdle = 0;
+
+    for (size_t y = 0; y < sizeof(gSendBuffer); y++) {
+        gSendBuffer[y] = (char) ('!' + (y % 94));
+    }
+
+    descriptor = openSocket(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                            CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT,
+                            CELLULAR_SOCK_TYPE_STREAM,
+                            CELLULAR_SOCK_PROTOCOL_TCP,
+                            &remoteAddress);
+    if ((descriptor >= 0) &&
+        (cellularSockSetOption(descriptor, CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                               CELLULAR_SOCK_OPT_SNDBUF,
+                               &txBufferSizeBytes,
+                               sizeof(txBufferSizeBytes)) == 0) &&
+        (cellularSockConnect(descriptor, &remoteAddress) == 0)) {
+        cellularSockResetTxBufferStats();
+        startTimeMs = cellularPortGetTickTimeMs();
+        for (size_t y = 0; (y < CELLULAR_SIM_BENCH_SMALL_WRITE_NUM_RECORDS * 2) &&
+                           (x >= 0); y++) {
+            // Header first, then the body of the record
+            length = CELLULAR_SIM_BENCH_RECORD_HEADER_LENGTH_BYTES;
+            if (y & 1) {
+                length = CELLULAR_SIM_BENCH_SMALL_WRITE_BODY_LENGTH_BYTES;
+            }
+            x = cellularSockWrite(descriptor, gSendBuffer + sent, length);
+            if (x == (int32_t) length) {
+                sent += x;
+            } else {
+                x = -1;
+            }
+        }
+        if (x >= 0) {
+            x = cellularSockFlush(descriptor);
+        }
+        if (x >= 0) {
+            received = readAll(descriptor, gReceiveBuffer, sent);
+        }
+        durationMs = cellularPortGetTickTimeMs() - startTimeMs;
+        if ((received == sent) &&
+            (cellularPort_memcmp(gSendBuffer, gReceiveBuffer, received) == 0) &&
+            (cellularSockGetTxBufferStats(&stats) == 0) &&
+            (stats.numWrites > 0)) {
+            // Now the idle socket
+            for (size_t y = 0; y < CELLULAR_SIM_BENCH_SMALL_WRITE_NUM_IDLE; y++) {
+                startTimeMs = cellularPortGetTickTimeMs();
+                x = cellularSockWrite(descriptor, gSendBuffer + y,
+                                      CELLULAR_SIM_BENCH_SMALL_WRITE_IDLE_LENGTH_BYTES);
+                if (x == CELLULAR_SIM_BENCH_SMALL_WRITE_IDLE_LENGTH_BYTES) {
+                    CELLULAR_SOCK_FD_ZERO(&readSet);
+                    CELLULAR_SOCK_FD_SET(descriptor, &readSet);
+                    x = cellularSockSelect(descriptor + 1, &readSet, NULL, NULL,
+                                           CELLULAR_SIM_BENCH_TIMEOUT_MS);
+                }
+                latencyMs = cellularPortGetTickTimeMs() - startTimeMs;
+                if ((x > 0) &&
+                    (readAll(descriptor, gReceiveBuffer,
+                             CELLULAR_SIM_BENCH_SMALL_WRITE_IDLE_LENGTH_BYTES) ==
+                     CELLULAR_SIM_BENCH_SMALL_WRITE_IDLE_LENGTH_BYTES)) {
+                    if (latencyMs < minMs) {
+                        minMs = latencyMs;
+                    }
+                    if (latencyMs > maxMs) {
+                        maxMs = latencyMs;
+                    }
+                    totalMs += latencyMs;
+                    numIdle++;
+                }
+            }
+            if (numIdle == CELLULAR_SIM_BENCH_SMALL_WRITE_NUM_IDLE) {
+                cellularPortLog("CELLULAR_SIM_BENCH: TCP small writes with a %d"
+                                " byte transmit buffer: %d write(s) of %d"
+                                " byte(s) echoed in %d ms, %d.%02d AT+USOWR"
+                                " per write; write to echo on an idle socket"
+                                " min %d ms, average %d ms, max %d ms.\n",
+                                (int) txBufferSizeBytes, (int) stats.numWrites,
+                                (int) stats.numBytesWritten, (int) durationMs,
+                                (int) (stats.numAtWrites / stats.numWrites),
+                                (int) (((stats.numAtWrites * 100) / stats.numWrites) % 100),
+                                (int) minMs, (int) (totalMs / numIdle),
+                                (int) maxMs);
+                errorCode = 0;
+            } else {
+                cellularPortLog("CELLULAR_SIM_BENCH: TCP small writes, only %d"
+                                " of %d write(s) to an idle socket echoed.\n",
+                                (int) numIdle,
+                                CELLULAR_SIM_BENCH_SMALL_WRITE_NUM_IDLE);
+            }
+        } else {
+            cellularPortLog("CELLULAR_SIM_BENCH: TCP small writes sent %d"
+                            " byte(s), %d byte(s) read back, %s.\n",
+                            (int) sent, (int) received,
+                            received == sent ? "DIFFERENT" : "INCOMPLETE");
+        }
+    } else {
+        cellularPortLog("CELLULAR_SIM_BENCH: unable to connect TCP socket.\n");
+    }
+    if (descriptor >= 0) {
+        cellularSockClose(descriptor);
+    }
+
+    return errorCode;
+}
+
+// UDP latency: a number of round trips of a small datagram,
+// reporting the minimum, average and maximum.
+static int32_t benchUdp()
+{
+    int32_t errorCode = -1;
+    CellularSockAddress_t remoteAddress;
+    CellularSockAddress_t senderAddress;
+    int32_t descriptor;
+    int32_t x;
+    int64_t startTimeMs;
+    int64_t rttMs;
+    int64_t minMs = CELLULAR_SIM_BENCH_TIMEOUT_MS;
+    int64_t maxMs = 0;
+    int64_t totalMs = 0;
+    size_t numRoundTrips = 0;
+
+    descriptor = openSocket(CELLULAR_CFG_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+                            CELLULAR_CFG_TEST_ECHO_UDP_SERVER_PORT,
+                            CELLULAR_SOCK_TYPE_DGRAM,
+                            CELLULAR_SOCK_PROTOCOL_UDP,
+                            &remoteAddress);
+    if (descriptor >= 0) {
+        for (size_t y = 0; y < CELLULAR_SIM_BENCH_UDP_NUM_ROUND_TRIPS; y++) {
+            gSendBuffer[0] = (char) y;
+            startTimeMs = cellularPortGetTickTimeMs();
+            x = cellularSockSendTo(descriptor, &remoteAddress, gSendBuffer,
+                                   CELLULAR_SIM_BENCH_UDP_SIZE_BYTES);
+            if (x == CELLULAR_SIM_BENCH_UDP_SIZE_BYTES) {
+                do {
+                    x = cellularSockReceiveFrom(descriptor, &senderAddress,
+                                                gReceiveBuffer,
+                                                sizeof(gReceiveBuffer));
+                } while ((x <= 0) &&
+                         (cellularPortGetTickTimeMs() - startTimeMs <
+                          CELLULAR_SIM_BENCH_TIMEOUT_MS));
+            }
+            if ((x == CELLULAR_SIM_BENCH_UDP_SIZE_BYTES) &&
+                (gReceiveBuffer[0] == gSendBuffer[0])) {
+                rttMs = cellularPortGetTickTimeMs() - startTimeMs;
+                if (rttMs < minMs) {
+                    minMs = rttMs;
+                }
+                if (rttMs > maxMs) {
+                    maxMs = rttMs;
+                }
+                totalMs += rttMs;
+                numRoundTrips++;
+            }
+        }
+        if (numRoundTrips == CELLULAR_SIM_BENCH_UDP_NUM_ROUND_TRIPS) {
+            cellularPortLog("CELLULAR_SIM_BENCH: UDP %d round trip(s) of"
+                            " %d byte(s), min %d ms, average %d ms,"
+                            " max %d ms.\n", (int) numRoundTrips,
+                            CELLULAR_SIM_BENCH_UDP_SIZE_BYTES, (int) minMs,
+                            (int) (totalMs / numRoundTrips), (int) maxMs);
+            errorCode = 0;
+        } else {
+            cellularPortLog("CELLULAR_SIM_BENCH: UDP only %d of %d round"
+                            " trip(s) completed.\n", (int) numRoundTrips,
+                            CELLULAR_SIM_BENCH_UDP_NUM_ROUND_TRIPS);
+        }
+        cellularSockClose(descriptor);
+    } else {
+        cellularPortLog("CELLULAR_SIM_BENCH: unable to create UDP socket.\n");
+    }
+
+    return errorCode;
+}
+
+// Socket data in binary or in hex: small TCP writes, small UDP
+// round trips and a large TCP echo, reporting the UART bytes
+// that each takes; the timings are reported by the benchmarks
+// themselves.
+static int32_t benchHexMode(bool hexMode)
+{
+    int32_t errorCode = -1;
+    size_t written[3];
+    size_t read[3];
+
+    if (cellularCtrlSetSockHexMode(hexMode) == 0) {
+        cellularPortLog("CELLULAR_SIM_BENCH: socket data in %s.\n",
+                        hexMode ? "hex" : "binary");
+        cellular_ctrl_at_reset_num_bytes();
+        errorCode = benchSmallWrites(0);
+        cellular_ctrl_at_get_num_bytes(&(written[0]), &(read[0]));
+        cellular_ctrl_at_reset_num_bytes();
+        if (benchUdp() != 0) {
+            errorCode = -1;
+        }
+        cellular_ctrl_at_get_num_bytes(&(written[1]), &(read[1]));
+        cellular_ctrl_at_reset_num_bytes();
+        if (benchTcp() != 0) {
+            errorCode = -1;
+        }
+        cellular_ctrl_at_get_num_bytes(&(written[2]), &(read[2]));
+        if (errorCode == 0) {
+            cellularPortLog("CELLULAR_SIM_BENCH: socket data in %s, byte(s)"
+                            " written to/read from the UART: TCP small"
+                            " writes %d/%d, UDP round trips %d/%d, TCP"
+                            " echo %d/%d.\n", hexMode ? "hex" : "binary",
+                            (int) written[0], (int) read[0],
+                            (int) written[1], (int) read[1],
+                            (int) written[2], (int) read[2]);
+        }
+        if (cellularCtrlSetSockHexMode(CELLULAR_CFG_SOCK_HEX_MODE) != 0) {
+            errorCode = -1;
+        }
+    } else {
+        cellularPortLog("CELLULAR_SIM_BENCH: unable to set hex mode %s.\n",
+                        hexMode ? "on" : "off");
+    }
+
+    return errorCode;
+}
+
+// DNS: look up the same host name a number of times, as a client
+// reconnecting to its server would, either with the DNS cache
+// flushed before each look-up or with it left alone, reporting
+// the average time taken and the number of AT+UDNSRN transactions.
+static int32_t benchDns(bool cached)
+{
+    int32_t errorCode = 0;
+    CellularSockIpAddress_t ipAddress;
+    CellularSockDnsCacheStats_t stats;
+    int64_t startTimeMs;
+
+    cellularSockFlushDnsCache();
+    cellularSockResetDnsCacheStats();
+    startTimeMs = cellularPortGetTickTimeMs();
+    for (size_t x = 0; (errorCode == 0) &&
+                       (x < CELLULAR_SIM_BENCH_DNS_NUM_LOOKUPS); x++) {
+        if (!cached) {
+            cellularSockFlushDnsCache();
+        }
+        errorCode = cellularSockGetHostByName(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                              &ipAddress);
+    }
+    if ((errorCode == 0) && (cellularSockGetDnsCacheStats(&stats) == 0)) {
+        cellularPortLog("CELLULAR_SIM_BENCH: DNS %s cache, %d look-up(s)"
+                        " of the same host name, average %d ms, %d AT+UDNSRN"
+                        " transaction(s).\n", cached ? "with" : "without",
+                        CELLULAR_SIM_BENCH_DNS_NUM_LOOKUPS,
+                        (int) ((cellularPortGetTickTimeMs() - startTimeMs) /
+                               CELLULAR_SIM_BENCH_DNS_NUM_LOOKUPS),
+                        (int) stats.numMisses);
+    } else {
+        cellularPortLog("CELLULAR_SIM_BENCH: unable to look up \"%s\".\n",
+                        CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME);
+        errorCode = -1;
+    }
+
+    return errorCode;
+}
+
+// TCP connect: make a number of connections, either one after the
+// other with blocking connects or in parallel with non-blocking
+// connects, waiting for them with select, and report the time
+// taken.
+static int32_t benchConnect(bool parallel)
+{
+    int32_t errorCode = 0;
+    int32_t descriptor[CELLULAR_SIM_BENCH_CONNECT_NUM_SOCKETS];
+    bool done[CELLULAR_SIM_BENCH_CONNECT_NUM_SOCKETS] = {false};
+    CellularSockAddress_t remoteAddress;
+    CellularSockDescriptorSet_t writeSet;
+    int32_t maxDescriptor = 0;
+    size_t numConnected = 0;
+    int32_t socketError;
+    size_t length;
+    int64_t startTimeMs;
+
+    for (size_t x = 0; x < CELLULAR_SIM_BENCH_CONNECT_NUM_SOCKETS; x++) {
+        descriptor[x] = openSocket(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                   CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT,
+                                   CELLULAR_SOCK_TYPE_STREAM,
+                                   CELLULAR_SOCK_PROTOCOL_TCP,
+                                   &remoteAddress);
+        if (descriptor[x] < 0) {
+            errorCode = -1;
+        } else if (parallel) {
+            cellularSockFcntl(descriptor[x], CELLULAR_SOCK_FCNTL_SET_STATUS,
+                              CELLULAR_SOCK_FCNTL_STATUS_NONBLOCK);
+            if (descriptor[x] >= maxDescriptor) {
+                maxDescriptor = descriptor[x] + 1;
+            }
+        }
+    }
+
+    startTimeMs = cellularPortGetTickTimeMs();
+    for (size_t x = 0; (errorCode == 0) &&
+                       (x < CELLULAR_SIM_BENCH_CONNECT_NUM_SOCKETS); x++) {
+        if (cellularSockConnect(descriptor[x], &remoteAddress) == 0) {
+            done[x] = true;
+            numConnected++;
+        } else if (!parallel ||
+                   (cellularPort_errno_get() != CELLULAR_SOCK_EINPROGRESS)) {
+            errorCode = -1;
+        }
+    }
+    // Collect the outcomes of the non-blocking connects
+    while ((errorCode == 0) &&
+           (numConnected < CELLULAR_SIM_BENCH_CONNECT_NUM_SOCKETS)) {
+        CELLULAR_SOCK_FD_ZERO(&writeSet);
+        for (size_t x = 0; x < CELLULAR_SIM_BENCH_CONNECT_NUM_SOCKETS; x++) {
+            if (!done[x]) {
+                CELLULAR_SOCK_FD_SET(descriptor[x], &writeSet);
+            }
+        }
+        if (cellularSockSelect(maxDescriptor, NULL, &writeSet, NULL,
+                               CELLULAR_SIM_BENCH_TIMEOUT_MS) > 0) {
+            for (size_t x = 0; x < CELLULAR_SIM_BENCH_CONNECT_NUM_SOCKETS; x++) {
+                if (!done[x] &&
+                    CELLULAR_SOCK_FD_ISSET(descriptor[x], &writeSet)) {
+                    done[x] = true;
+                    length = sizeof(socketError);
+                    if ((cellularSockGetOption(descriptor[x],
+                                               CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                               CELLULAR_SOCK_OPT_ERROR,
+                                               &socketError, &length) == 0) &&
+                        (socketError == 0)) {
+                        numConnected++;
+                    } else {
+                        errorCode = -1;
+                    }
+                }
+            }
+        } else {
+            errorCode = -1;
+        }
+    }
+
+    if (errorCode == 0) {
+        cellularPortLog("CELLULAR_SIM_BENCH: TCP %d connection(s) %s took"
+                        " %d ms.\n", CELLULAR_SIM_BENCH_CONNECT_NUM_SOCKETS,
+                        parallel ? "made in parallel" : "made one at a time",
+                        (int) (cellularPortGetTickTimeMs() - startTimeMs));
+    } else {
+        cellularPortLog("CELLULAR_SIM_BENCH: TCP only %d of %d connection(s)"
+                        " made %s.\n", (int) numConnected,
+                        CELLULAR_SIM_BENCH_CONNECT_NUM_SOCKETS,
+                        parallel ? "in parallel" : "one at a time");
+    }
+
+    for (size_t x = 0; x < CELLULAR_SIM_BENCH_CONNECT_NUM_SOCKETS; x++) {
+        if (descriptor[x] >= 0) {
+            cellularSockClose(descriptor[x]);
+        }
+    }
+
+    return errorCode;
+}
+
+// TLS connect: make secure connections to the same server one
+// after the other, reporting the time each takes and the number
+// of bytes that cross the UART.  With offload the module does
+// the handshake, the first in full and the rest resuming the
+// session.  Without, the handshake is run on the MCU over a plain
+// socket; there being no TLS server to talk to, it is modelled by
+// the flights of gTlsMcuFlights, each echoed: the larger of the
+// two sizes of a flight is written so that the server's part
+// comes back, hence the bytes written are over-counted.
+static int32_t benchTls(bool offload)
+{
+    int32_t errorCode = 0;
+    int32_t descriptor;
+    CellularSockAddress_t remoteAddress;
+    CellularSockTlsProfile_t profile = {0};
+    int32_t profileId = -1;
+    size_t sizeBytes;
+    size_t written;
+    size_t read;
+    int64_t startTimeMs;
+
+    if (offload) {
+        profile.validation = CELLULAR_SOCK_TLS_VALIDATION_ROOT_CA_URL;
+        profile.pRootCaName = CELLULAR_SIM_BENCH_TLS_ROOT_CA_NAME;
+        profile.pServerName = CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME;
+        profile.sessionResumption = true;
+        if (cellularSockTlsStoreCredential(CELLULAR_SOCK_TLS_CREDENTIAL_ROOT_CA,
+                                           CELLULAR_SIM_BENCH_TLS_ROOT_CA_NAME,
+                                           CELLULAR_CFG_TEST_TLS_ROOT_CA,
+                                           sizeof(CELLULAR_CFG_TEST_TLS_ROOT_CA) - 1) != 0) {
+            errorCode = -1;
+        }
+    }
+
+    for (size_t x = 0; (errorCode == 0) &&
+                       (x < CELLULAR_SIM_BENCH_TLS_NUM_CONNECTS); x++) {
+        descriptor = openSocket(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT,
+                                CELLULAR_SOCK_TYPE_STREAM,
+                                CELLULAR_SOCK_PROTOCOL_TCP,
+                                &remoteAddress);
+        if (descriptor >= 0) {
+            if (offload) {
+                // Getting the profile is part of the cost
+                cellular_ctrl_at_reset_num_bytes();
+                startTimeMs = cellularPortGetTickTimeMs();
+                profileId = cellularSockTlsProfileGet(&profile);
+                if ((profileId < 0) ||
+                    (cellularSockSetOption(descriptor,
+                                           CELLULAR_SOCK_OPT_LEVEL_TLS,
+                                           CELLULAR_SOCK_OPT_TLS_SECURITY_PROFILE,
+                                           &profileId,
+                                           sizeof(profileId)) != 0) ||
+                    (cellularSockConnect(descriptor, &remoteAddress) != 0)) {
+                    errorCode = -1;
+                }
+            } else {
+                cellular_ctrl_at_reset_num_bytes();
+                startTimeMs = cellularPortGetTickTimeMs();
+                if (cellularSockConnect(descriptor, &remoteAddress) != 0) {
+                    errorCode = -1;
+                }
+                for (size_t y = 0; (errorCode == 0) &&
+                                   (y < sizeof(gTlsMcuFlights) /
+                                        sizeof(gTlsMcuFlights[0])); y++) {
+                    sizeBytes = gTlsMcuFlights[y].txSizeBytes;
+                    if (gTlsMcuFlights[y].rxSizeBytes > sizeBytes) {
+                        sizeBytes = gTlsMcuFlights[y].rxSizeBytes;
+                    }
+                    for (size_t z = 0; (errorCode == 0) && (z < sizeBytes);) {
+                        written = cellularSockWrite(descriptor, gSendBuffer + z,
+                                                    sizeBytes - z);
+                        if ((int32_t) written > 0) {
+                            z += written;
+                        } else {
+                            errorCode = -1;
+                        }
+                    }
+                    if ((errorCode == 0) &&
+                        (readAll(descriptor, gReceiveBuffer,
+                                 sizeBytes) != sizeBytes)) {
+                        errorCode = -1;
+                    }
+                }
+            }
+            if (errorCode == 0) {
+                cellular_ctrl_at_get_num_bytes(&written, &read);
+                cellularPortLog("CELLULAR_SIM_BENCH: TLS %s, connection %d"
+                                " (%s handshake) took %d ms, %d byte(s)"
+                                " written to and %d byte(s) read from the"
+                                " UART.\n",
+                                offload ? "offloaded to the module" : "on the MCU (modelled)",
+                                (int) x + 1,
+                                (offload && (x > 0)) ? "resumed" : "full",
+                                (int) (cellularPortGetTickTimeMs() - startTimeMs),
+                                (int) written, (int) read);
+            }
+            cellularSockClose(descriptor);
+        } else {
+            errorCode = -1;
+        }
+    }
+
+    if (offload) {
+        cellularSockTlsRemoveCredential(CELLULAR_SOCK_TLS_CREDENTIAL_ROOT_CA,
+                                        CELLULAR_SIM_BENCH_TLS_ROOT_CA_NAME);
+        cellularSockFlushTlsCache();
+    }
+    if (errorCode != 0) {
+        cellularPortLog("CELLULAR_SIM_BENCH: TLS %s failed.\n",
+                        offload ? "offloaded to the module" : "on the MCU");
+    }
+
+    return errorCode;
+}
+
+// The number of context switches this process has made so far.
+static int64_t contextSwitches()
+{
+    struct rusage usage;
+    int64_t numSwitches = 0;
+
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        numSwitches = usage.ru_nvcsw + usage.ru_nivcsw;
+    }
+
+    return numSwitches;
+}
+
+// A task which blocks in a receive on the socket it is given,
+// nothing being sent to it, and then reports that it is done.
+static void idleReaderTask(void *pParam)
+{
+    int32_t descriptor = *((int32_t *) pParam);
+    char buffer[CELLULAR_SIM_BENCH_UDP_SIZE_BYTES];
+
+    cellularSockReceiveFrom(descriptor, NULL, buffer, sizeof(buffer));
+    cellularPortQueueSend(gIdleQueueHandle, &descriptor);
+    cellularPortTaskDelete(NULL);
+}
+
+// Idle cost: the context switches per second the process makes
+// with nothing going on, and then with a number of sockets blocked
+// in a receive for which nothing ever arrives.  Each reader has
+// an equal share of the idle time as its receive timeout since,
+// while one waits for data, the others wait for the socket
+// mutex that it holds.
+static int32_t benchIdle()
+{
+    int32_t errorCode = -1;
+    CellularSockAddress_t remoteAddress;
+    int32_t descriptors[CELLULAR_SIM_BENCH_IDLE_NUM_READERS];
+    CellularPortTaskHandle_t taskHandle;
+    CellularPort_timeval timeout;
+    int32_t timeoutMs;
+    size_t numReaders = 0;
+    size_t numDone = 0;
+    int32_t descriptor;
+    int64_t startTimeMs;
+    int64_t durationMs;
+    int64_t baseline;
+    int64_t numSwitches;
+
+    // The baseline
+    numSwitches = contextSwitches();
+    startTimeMs = cellularPortGetTickTimeMs();
+    cellularPortTaskBlock(CELLULAR_SIM_BENCH_IDLE_TIME_MS);
+    durationMs = cellularPortGetTickTimeMs() - startTimeMs;
+    baseline = ((contextSwitches() - numSwitches) * 1000) / durationMs;
+
+    if (cellularPortQueueCreate(CELLULAR_SIM_BENCH_IDLE_NUM_READERS,
+                                sizeof(int32_t), &gIdleQueueHandle) == 0) {
+        timeoutMs = CELLULAR_SIM_BENCH_IDLE_TIME_MS /
+                    CELLULAR_SIM_BENCH_IDLE_NUM_READERS;
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_usec = (timeoutMs % 1000) * 1000;
+        for (size_t x = 0; x < CELLULAR_SIM_BENCH_IDLE_NUM_READERS; x++) {
+            descriptors[x] = openSocket(CELLULAR_CFG_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+                                        CELLULAR_CFG_TEST_ECHO_UDP_SERVER_PORT,
+                                        CELLULAR_SOCK_TYPE_DGRAM,
+                                        CELLULAR_SOCK_PROTOCOL_UDP,
+                                        &remoteAddress);
+            if ((descriptors[x] >= 0) &&
+                (cellularSockSetOption(descriptors[x],
+                                       CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                       CELLULAR_SOCK_OPT_RCVTIMEO,
+                                       (void *) &timeout,
+                                       sizeof(timeout)) == 0)) {
+                numReaders++;
+            }
+        }
+        if (numReaders == CELLULAR_SIM_BENCH_IDLE_NUM_READERS) {
+            numSwitches = contextSwitches();
+            startTimeMs = cellularPortGetTickTimeMs();
+            for (size_t x = 0; x < numReaders; x++) {
+                cellularPortTaskCreate(idleReaderTask, "idleReader",
+                                       CELLULAR_SIM_BENCH_IDLE_TASK_STACK_SIZE_BYTES,
+                                       (void *) &(descriptors[x]),
+                                       CELLULAR_SIM_BENCH_TASK_PRIORITY,
+                                       &taskHandle);
+            }
+            while ((numDone < numReaders) &&
+                   (cellularPortQueueTryReceive(gIdleQueueHandle,
+                                                CELLULAR_SIM_BENCH_TIMEOUT_MS,
+                                                &descriptor) == 0)) {
+                numDone++;
+            }
+            durationMs = cellularPortGetTickTimeMs() - startTimeMs;
+            if (numDone == numReaders) {
+                cellularPortLog("CELLULAR_SIM_BENCH: idle %d context switch(es)/s,"
+                                " %d with %d socket(s) blocked in receive for"
+                                " %d ms.\n", (int) baseline,
+                                (int) (((contextSwitches() - numSwitches) * 1000) /
+                                       durationMs),
+                                (int) numReaders, (int) durationMs);
+                errorCode = 0;
+            } else {
+                cellularPortLog("CELLULAR_SIM_BENCH: only %d of %d blocked"
+                                " reader(s) finished.\n", (int) numDone,
+                                (int) numReaders);
+            }
+        } else {
+            cellularPortLog("CELLULAR_SIM_BENCH: unable to set up %d blocked"
+                            " reader(s).\n", CELLULAR_SIM_BENCH_IDLE_NUM_READERS);
+        }
+        for (size_t x = 0; x < CELLULAR_SIM_BENCH_IDLE_NUM_READERS; x++) {
+            if (descriptors[x] >= 0) {
+                cellularSockClose(descriptors[x]);
+            }
+        }
+        if (numDone == numReaders) {
+            cellularPortQueueDelete(gIdleQueueHandle);
+        }
+    }
+
+    return errorCode;
+}
+
+// The task within which the benchmarks run.
+static void benchTask(void *pParam)
+{
+    (void) pParam;
+
+    cellularPortInit();
+    cellularPortLog("CELLULAR_SIM_BENCH: started.\n");
+
+    if (networkConnect() == 0) {
+        if (benchTcp() != 0) {
+            gExitCode = 1;
+        }
+        if (benchDownload() != 0) {
+            gExitCode = 1;
+        }
+        // Without and then with the receive cache
+        if (benchRecord(0) != 0) {
+            gExitCode = 1;
+        }
+        if (benchRecord(CELLULAR_SOCK_RX_CACHE_SIZE_BYTES) != 0) {
+            gExitCode = 1;
+        }
+        // Without and then with the transmit buffer
+        if (benchSmallWrites(0) != 0) {
+            gExitCode = 1;
+        }
+        if (benchSmallWrites(CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES) != 0) {
+            gExitCode = 1;
+        }
+        if (benchUdp() != 0) {
+            gExitCode = 1;
+        }
+        if (benchUdpSend() != 0) {
+            gExitCode = 1;
+        }
+        // One at a time and then in bursts
+        if (benchUdpSendBurst(false) != 0) {
+            gExitCode = 1;
+        }
+        if (benchUdpSendBurst(true) != 0) {
+            gExitCode = 1;
+        }
+        // One at a time and then in batches
+        if (benchUdpReceive(false) != 0) {
+            gExitCode = 1;
+        }
+        if (benchUdpReceive(true) != 0) {
+            gExitCode = 1;
+        }
+        // Without and then with the DNS cache
+        if (benchDns(false) != 0) {
+            gExitCode = 1;
+        }
+        if (benchDns(true) != 0) {
+            gExitCode = 1;
+        }
+        // One at a time and then in parallel
+        if (benchConnect(false) != 0) {
+            gExitCode = 1;
+        }
+        if (benchConnect(true) != 0) {
+            gExitCode = 1;
+        }
+        // The handshake on the MCU and then in the module
+        if (benchTls(false) != 0) {
+            gExitCode = 1;
+        }
+        if (benchTls(true) != 0) {
+            gExitCode = 1;
+        }
+        // Socket data in binary and then in hex
+        if (benchHexMode(false) != 0) {
+            gExitCode = 1;
+        }
+        if (benchHexMode(true) != 0) {
+            gExitCode = 1;
+        }
+        if (benchIdle() != 0) {
+            gExitCode = 1;
+        }
+    } else {
+        cellularPortLog("CELLULAR_SIM_BENCH: unable to connect.\n");
+        gExitCode = 1;
+    }
+    networkDisconnect();
+
+    cellularPortLog("CELLULAR_SIM_BENCH: ended.\n");
+    cellularPortDeinit();
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Entry point
+int main(void)
+{
+    if (cellularPortPlatformStart(benchTask, NULL,
+                                  CELLULAR_SIM_BENCH_TASK_STACK_SIZE_BYTES,
+                                  CELLULAR_SIM_BENCH_TASK_PRIORITY) != 0) {
+        gExitCode = -1;
+    }
+
+    return gExitCode;
+}
+
+// End of file
@@ -0,0 +1,394 @@
+/*
+ * Copyright 2020 u-blox Cambourne Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// For posix_openpt(), grantpt(), unlockpt(), ptsname() and cfmakeraw()
+#define _GNU_SOURCE
+
+#ifdef CELLULAR_CFG_OVERRIDE
+# include "cellular_cfg_override.h" // For a customer's configuration override
+#endif
+#include "cellular_cfg_hw_platform_specific.h"
+
+// The simulator is a host program, not part of the cellular
+// code, so it uses the C library directly
+#include "stdint.h"
+#include "stddef.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "ctype.h"
+#include "unistd.h" // For fork(), execvp(), getopt() and close()
+#include "fcntl.h" // For open()
+#include "poll.h"
+#include "termios.h"
+#include "signal.h"
+#include "pthread.h"
+#include "sys/mman.h" // For mmap()
+#include "sys/wait.h" // For waitpid()
+
+#include "cellular_sim.h"
+
+/* The entry point of the cellular module simulator: see the
+ * README.md in this directory for how to use it.  A
+ * pseudo-terminal is created to act as the module's UART and a
+ * file to act as its GPIO lines; the names of these are put into
+ * the environment variables that the linux port of the cellular
+ * code looks for and then, if one was given on the command line,
+ * the program under test is launched and the simulator exits
+ * with its exit status once it is done.
+ */
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+// The prefix of the environment variable that names the UART
+// device, see cellular_port_uart.c in the linux src directory.
+#define CELLULAR_SIM_UART_ENV_PREFIX "CELLULAR_PORT_UART"
+
+// The environment variable that names the GPIO file, see
+// cellular_port_gpio.c in the linux src directory.
+#define CELLULAR_SIM_GPIO_ENV "CELLULAR_PORT_GPIO"
+
+// The default time the module takes to boot.
+#define CELLULAR_SIM_DEFAULT_BOOT_TIME_MS 1000
+
+// The default time the module takes to register.
+#define CELLULAR_SIM_DEFAULT_REGISTRATION_TIME_MS 500
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+// The configuration.
+static CellularSimConfig_t gConfig;
+
+// Set to stop the simulated module.
+static volatile bool gStop = false;
+
+// The master side of the pseudo-terminal.
+static int gPtyFd = -1;
+
+// The shared GPIO file, mapped into memory.
+static volatile uint8_t *gpGpio = NULL;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Print the usage.
+static void usage(const char *pProgramName)
+{
+    fprintf(stderr, "Usage: %s [options] [-- program [args]]\n"
+            "Simulate a SARA-R4/R5 cellular module for the linux port of the"
+            " cellular code.\n"
+            "If a program is given it is run with the simulated module"
+            " attached and %s\nexits with its exit status, otherwise"
+            " the simulated module runs until\nterminated.\n"
+            "  -L ms         response latency for all AT commands (default 0).\n"
+            "  -l cmd:ms     response latency for AT command cmd, e.g. +USOWR:100.\n"
+            "  -j ms         maximum random jitter added to each latency (default 0).\n"
+            "  -e cmd:pct    respond to AT command cmd with ERROR pct %% of the time.\n"
+            "  -d cmd:pct    drop AT command cmd, i.e. do not respond, pct %% of the"
+            " time.\n"
+            "  -b ms         time the module takes to boot (default %d).\n"
+            "  -r ms         time the module takes to register (default %d).\n"
+            "  -c ms         time the far end takes to answer a TCP connection"
+            " (default 0).\n"
+            "  -s seed       seed for the pseudo-random number generator (default 1).\n"
+            "  -u uart       the UART number (default %d).\n"
+            "  -p pin        the PWR_ON pin (default %d).\n"
+            "  -V pin        the VInt pin, -1 for none (default %d).\n"
+            "  -H name=ip    resolve host name to ip.\n"
+            "  -v            print the AT traffic.\n",
+            pProgramName, pProgramName,
+            CELLULAR_SIM_DEFAULT_BOOT_TIME_MS,
+            CELLULAR_SIM_DEFAULT_REGISTRATION_TIME_MS,
+            CELLULAR_CFG_UART, CELLULAR_CFG_PIN_PWR_ON,
+            CELLULAR_CFG_PIN_VINT);
+}
+
+// Parse a "cmd:value" option into the settings for that
+// command, returning a pointer to the settings or NULL on error.
+static CellularSimCommandSetting_t *pParseSetting(const char *pOption,
+                                                  int32_t *pValue)
+{
+    CellularSimCommandSetting_t *pSetting = NULL;
+    const char *pColon = strrchr(pOption, ':');
+    char name[CELLULAR_SIM_COMMAND_NAME_MAX_LENGTH_BYTES];
+    size_t length;
+
+    if ((pColon != NULL) && (pColon > pOption) &&
+        (pColon - pOption < (int) sizeof(name))) {
+        length = pColon - pOption;
+        // Allow an "AT" on the front
+        if ((length > 2) && (toupper((unsigned char) pOption[0]) == 'A') &&
+            (toupper((unsigned char) pOption[1]) == 'T')) {
+            pOption += 2;
+            length -= 2;
+        }
+        for (size_t x = 0; x < length; x++) {
+            name[x] = toupper((unsigned char) pOption[x]);
+        }
+        name[length] = 0;
+        *pValue = strtol(pColon + 1, NULL, 10);
+        for (size_t x = 0; (pSetting == NULL) &&
+                           (x < gConfig.numCommandSettings); x++) {
+            if (strcmp(gConfig.commandSettings[x].name, name) == 0) {
+                pSetting = &(gConfig.commandSettings[x]);
+            }
+        }
+        if ((pSetting == NULL) &&
+            (gConfig.numCommandSettings < CELLULAR_SIM_MAX_NUM_COMMAND_SETTINGS)) {
+            pSetting = &(gConfig.commandSettings[gConfig.numCommandSettings]);
+            memset(pSetting, 0, sizeof(*pSetting));
+            memcpy(pSetting->name, name, length + 1);
+            pSetting->latencyMs = -1;
+            gConfig.numCommandSettings++;
+        }
+    }
+
+    return pSetting;
+}
+
+// The task that runs the simulated module.
+static void *modemTask(void *pParam)
+{
+    (void) pParam;
+
+    cellularSimModemRun(&gConfig, gPtyFd, gpGpio, &gStop);
+
+    return NULL;
+}
+
+// Handle a signal by stopping.
+static void signalHandler(int signal)
+{
+    (void) signal;
+
+    gStop = true;
+}
+
+// Create the pseudo-terminal, returning the name of its slave
+// side and, in pSlaveFd, the slave side held open so that the
+// master does not see a hang-up when the program under test
+// closes it.
+static const char *pPtyOpen(int *pSlaveFd)
+{
+    const char *pName = NULL;
+    struct termios config;
+
+    gPtyFd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if ((gPtyFd >= 0) && (grantpt(gPtyFd) == 0) &&
+        (unlockpt(gPtyFd) == 0)) {
+        pName = ptsname(gPtyFd);
+        if (pName != NULL) {
+            *pSlaveFd = open(pName, O_RDWR | O_NOCTTY | O_CLOEXEC);
+            if ((*pSlaveFd >= 0) && (tcgetattr(*pSlaveFd, &config) == 0)) {
+                cfmakeraw(&config);
+                tcsetattr(*pSlaveFd, TCSANOW, &config);
+            }
+            fcntl(gPtyFd, F_SETFL, fcntl(gPtyFd, F_GETFL) | O_NONBLOCK);
+        }
+    }
+
+    return pName;
+}
+
+// Create the GPIO file, returning its mapping or NULL.
+static volatile uint8_t *pGpioOpen(char *pFileName)
+{
+    volatile uint8_t *pGpio = NULL;
+    uint8_t contents[CELLULAR_SIM_GPIO_MAX_NUM * 2];
+    void *pMapped;
+    int fd;
+
+    fd = mkstemp(pFileName);
+    if (fd >= 0) {
+        // Nothing set by the program under test yet, nothing
+        // driven by the module
+        memset(contents, 0, CELLULAR_SIM_GPIO_MAX_NUM);
+        memset(contents + CELLULAR_SIM_GPIO_MAX_NUM, CELLULAR_SIM_GPIO_NOT_DRIVEN,
+               CELLULAR_SIM_GPIO_MAX_NUM);
+        if (write(fd, contents, sizeof(contents)) == sizeof(contents)) {
+            pMapped = mmap(NULL, sizeof(contents), PROT_READ | PROT_WRITE,
+                           MAP_SHARED, fd, 0);
+            if (pMapped != MAP_FAILED) {
+                pGpio = (volatile uint8_t *) pMapped;
+            }
+        }
+        close(fd);
+    }
+
+    return pGpio;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Entry point.
+int main(int argc, char *argv[])
+{
+    int32_t exitCode = EXIT_FAILURE;
+    CellularSimCommandSetting_t *pSetting;
+    char gpioFileName[] = "/tmp/cellular_sim_gpio_XXXXXX";
+    char envName[32];
+    const char *pPtyName;
+    char *pEquals;
+    int32_t uart = CELLULAR_CFG_UART;
+    int32_t value;
+    int slaveFd = -1;
+    pthread_t thread;
+    pid_t pid;
+    int status = 0;
+    int option;
+    bool ok = true;
+
+    memset(&gConfig, 0, sizeof(gConfig));
+    gConfig.pinPwrOn = CELLULAR_CFG_PIN_PWR_ON;
+    gConfig.pinVInt = CELLULAR_CFG_PIN_VINT;
+    gConfig.bootTimeMs = CELLULAR_SIM_DEFAULT_BOOT_TIME_MS;
+    gConfig.registrationTimeMs = CELLULAR_SIM_DEFAULT_REGISTRATION_TIME_MS;
+    gConfig.seed = 1;
+
+    if (cellularSimNetInit() != 0) {
+        fprintf(stderr, "CELLULAR_SIM: unable to start echo servers.\n");
+        ok = false;
+    }
+
+    while (ok && ((option = getopt(argc, argv, "L:l:j:e:d:b:r:c:s:u:p:V:H:vh")) != -1)) {
+        switch (option) {
+            case 'L':
+                gConfig.latencyMs = strtol(optarg, NULL, 10);
+            break;
+            case 'j':
+                gConfig.jitterMs = strtol(optarg, NULL, 10);
+            break;
+            case 'b':
+                gConfig.bootTimeMs = strtol(optarg, NULL, 10);
+            break;
+            case 'r':
+                gConfig.registrationTimeMs = strtol(optarg, NULL, 10);
+            break;
+            case 'c':
+                gConfig.connectTimeMs = strtol(optarg, NULL, 10);
+            break;
+            case 's':
+                gConfig.seed = strtoul(optarg, NULL, 0);
+            break;
+            case 'u':
+                uart = strtol(optarg, NULL, 10);
+            break;
+            case 'p':
+                gConfig.pinPwrOn = strtol(optarg, NULL, 10);
+            break;
+            case 'V':
+                gConfig.pinVInt = strtol(optarg, NULL, 10);
+            break;
+            case 'v':
+                gConfig.verbose = true;
+            break;
+            case 'l':
+            case 'e':
+            case 'd':
+                pSetting = pParseSetting(optarg, &value);
+                if (pSetting != NULL) {
+                    if (option == 'l') {
+                        pSetting->latencyMs = value;
+                    } else if (option == 'e') {
+                        pSetting->errorPercent = value;
+                    } else {
+                        pSetting->dropPercent = value;
+                    }
+                } else {
+                    fprintf(stderr, "CELLULAR_SIM: bad option \"-%c %s\".\n",
+                            option, optarg);
+                    ok = false;
+                }
+            break;
+            case 'H':
+                pEquals = strchr(optarg, '=');
+                if (pEquals != NULL) {
+                    *pEquals = 0;
+                    cellularSimNetAddHost(optarg, pEquals + 1);
+                } else {
+                    fprintf(stderr, "CELLULAR_SIM: bad option \"-H %s\".\n", optarg);
+                    ok = false;
+                }
+            break;
+            default:
+                usage(argv[0]);
+                ok = false;
+            break;
+        }
+    }
+
+    if (ok) {
+        pPtyName = pPtyOpen(&slaveFd);
+        gpGpio = pGpioOpen(gpioFileName);
+        if ((pPtyName != NULL) && (gpGpio != NULL)) {
+            snprintf(envName, sizeof(envName), "%s%d",
+                     CELLULAR_SIM_UART_ENV_PREFIX, (int) uart);
+            setenv(envName, pPtyName, 1);
+            setenv(CELLULAR_SIM_GPIO_ENV, gpioFileName, 1);
+            signal(SIGPIPE, SIG_IGN);
+            signal(SIGINT, signalHandler);
+            signal(SIGTERM, signalHandler);
+            if (pthread_create(&thread, NULL, modemTask, NULL) == 0) {
+                if (optind < argc) {
+                    // Run the program under test
+                    pid = fork();
+                    if (pid == 0) {
+                        execvp(argv[optind], argv + optind);
+                        fprintf(stderr, "CELLULAR_SIM: unable to run \"%s\".\n",
+                                argv[optind]);
+                        _exit(127);
+                    } else if (pid > 0) {
+                        while ((waitpid(pid, &status, 0) < 0) && !gStop) {}
+                        if (!gStop && WIFEXITED(status)) {
+                            exitCode = WEXITSTATUS(status);
+                        }
+                    }
+                    gStop = true;
+                } else {
+                    printf("%s=%s\n%s=%s\n", envName, pPtyName,
+                           CELLULAR_SIM_GPIO_ENV, gpioFileName);
+                    fflush(stdout);
+                    while (!gStop) {
+                        pause();
+                    }
+                    exitCode = EXIT_SUCCESS;
+                }
+                pthread_join(thread, NULL);
+            }
+        } else {
+            fprintf(stderr, "CELLULAR_SIM: unable to create the pseudo-terminal"
+                    " or GPIO file.\n");
+        }
+        if (gpGpio != NULL) {
+            unlink(gpioFileName);
+        }
+        if (slaveFd >= 0) {
+            close(slaveFd);
+        }
+    }
+
+    return exitCode;
+}
+
+// End of file
@@ -0,0 +1,1832 @@
+/*
+ * Copyright 2020 u-blox Cambourne Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// For clock_gettime(), gmtime_r() and usleep()
+#define _GNU_SOURCE
+
+#ifdef CELLULAR_CFG_OVERRIDE
+# include "cellular_cfg_override.h" // For a customer's configuration override
+#endif
+#include "cellular_cfg_module.h"
+
+// The simulator is a host program, not part of the cellular
+// code, so it uses the C library directly
+#include "stdint.h"
+#include "stddef.h"
+#include "stdbool.h"
+#include "stdarg.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "ctype.h"
+#include "time.h"
+#include "unistd.h" // For read() and write()
+#include "poll.h"
+#include "errno.h"
+
+#include "cellular_sim.h"
+
+/* The AT command engine of the simulated module.  It runs in a
+ * single thread: each time around its loop it looks at the PWR_ON
+ * pin, runs any timers that have expired, executes the command in
+ * hand once its latency has passed and, if no command is in
+ * progress, sends any queued URCs, then waits on the
+ * pseudo-terminal and the sockets of cellular_sim_net.c.
+ *
+ * Command lines are collected from the pseudo-terminal, echoed
+ * (until ATE0), then held for the configured latency plus a
+ * random jitter before being executed; while a command is held
+ * or executing further input is buffered, just as a module
+ * buffers input in its UART.  Per command, an "ERROR" response
+ * may be injected instead of executing the command, or the
+ * command may be dropped so that no response is sent at all.
+ * All randomness comes from a seeded pseudo-random number
+ * generator so that a run may be repeated exactly.
+ *
+ * The module starts powered off: a low pulse on PWR_ON boots it
+ * and a long low pulse on PWR_ON powers it off again, as does
+ * AT+CPWROFF; AT+CFUN=15/16 reboots it.  Settings that a real
+ * module keeps in non-volatile memory (the RATs, band masks, MNO
+ * profile and security seal) survive power cycles, everything
+ * else (registration, sockets, MQTT) does not.
+ */
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+// The shortest low pulse on PWR_ON that boots the module.
+#define CELLULAR_SIM_PWR_ON_PULSE_MIN_MS 50
+
+// The shortest low pulse on PWR_ON that powers the module off.
+#define CELLULAR_SIM_PWR_OFF_PULSE_MIN_MS 1000
+
+// The longest time the engine waits before looking at the
+// PWR_ON pin again.
+#define CELLULAR_SIM_POLL_INTERVAL_MS 5
+
+// The maximum number of URCs that may be queued.
+#define CELLULAR_SIM_MAX_NUM_URCS 128
+
+// The maximum number of timers that may be running.
+#define CELLULAR_SIM_MAX_NUM_TIMERS 32
+
+// The maximum length of a formatted response line.
+#define CELLULAR_SIM_RESPONSE_MAX_LENGTH_BYTES 512
+
+// The number of bytes of the file descriptors passed to poll()
+// that the sockets may use.
+#define CELLULAR_SIM_MAX_NUM_POLL_FDS (CELLULAR_SIM_MAX_NUM_SOCKETS + 1)
+
+// The size of the receive buffer, enough for a command
+// line and the data that may follow it.
+#define CELLULAR_SIM_RX_BUFFER_SIZE_BYTES (CELLULAR_SIM_COMMAND_LINE_MAX_LENGTH_BYTES + \
+                                           CELLULAR_SIM_DATA_MAX_LENGTH_BYTES)
+
+// The number of band mask RATs (0 for cat-M1, 1 for NB1).
+#define CELLULAR_SIM_NUM_BAND_MASK_RATS 2
+
+// The local RAT values, as used by AT+URAT.
+#define CELLULAR_SIM_RAT_GPRS  9
+#define CELLULAR_SIM_RAT_CATM1 7
+#define CELLULAR_SIM_RAT_NB1   8
+
+// The APN the network assigns if none is given.
+#define CELLULAR_SIM_DEFAULT_APN "sim.u-blox.com"
+
+// The identity strings of the simulated module.
+#define CELLULAR_SIM_MANUFACTURER "u-blox"
+#ifdef CELLULAR_CFG_MODULE_SARA_R4
+# define CELLULAR_SIM_MODEL "SARA-R412M-02B"
+# define CELLULAR_SIM_FIRMWARE "L0.0.00.00.05.08"
+# define CELLULAR_SIM_I9 "L0.0.00.00.05.08,A.02.04"
+#else
+# define CELLULAR_SIM_MODEL "SARA-R510M8S"
+# define CELLULAR_SIM_FIRMWARE "02.05"
+# define CELLULAR_SIM_I9 "02.05,A00.01"
+#endif
+#define CELLULAR_SIM_IMEI "357520070000001"
+#define CELLULAR_SIM_IMSI "001010123456789"
+#define CELLULAR_SIM_ICCID "8900101234567890123"
+
+// The MCC/MNC and name of the simulated network.
+#define CELLULAR_SIM_OPERATOR_NUMERIC "00101"
+#define CELLULAR_SIM_OPERATOR_NAME "u-blox sim"
+
+// The header the simulated end to end encryption adds.
+#define CELLULAR_SIM_E2E_HEADER_SIZE_BYTES 16
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+// The power state of the module.
+typedef enum {
+    CELLULAR_SIM_POWER_OFF,
+    CELLULAR_SIM_POWER_BOOTING,
+    CELLULAR_SIM_POWER_ON
+} CellularSimPowerState_t;
+
+// The state of command processing.
+typedef enum {
+    CELLULAR_SIM_COMMAND_STATE_IDLE,    // Waiting for a command line
+    CELLULAR_SIM_COMMAND_STATE_PENDING, // Command line held for its latency
+    CELLULAR_SIM_COMMAND_STATE_EXECUTING,
+    CELLULAR_SIM_COMMAND_STATE_DATA     // Waiting for data after a prompt
+} CellularSimCommandState_t;
+
+// A timer.
+typedef struct {
+    int64_t dueMs;
+    void (*pCallback)(int32_t);
+    int32_t param;
+} CellularSimTimer_t;
+
+// An entry in the AT command table.
+typedef struct {
+    const char *pName;
+    CellularSimCommandHandler_t pHandler;
+} CellularSimCommandEntry_t;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTION PROTOTYPES: AT COMMAND HANDLERS
+ * -------------------------------------------------------------- */
+
+static void handleOk(CellularSimCommand_t *pCommand);
+static void handleE0(CellularSimCommand_t *pCommand);
+static void handleE1(CellularSimCommand_t *pCommand);
+static void handleCMEE(CellularSimCommand_t *pCommand);
+static void handleCFUN(CellularSimCommand_t *pCommand);
+static void handleCPWROFF(CellularSimCommand_t *pCommand);
+static void handleCxREG(CellularSimCommand_t *pCommand);
+static void handleCOPS(CellularSimCommand_t *pCommand);
+static void handleCGATT(CellularSimCommand_t *pCommand);
+static void handleCGACT(CellularSimCommand_t *pCommand);
+static void handleCGDCONT(CellularSimCommand_t *pCommand);
+static void handleCGPADDR(CellularSimCommand_t *pCommand);
+static void handleUPSD(CellularSimCommand_t *pCommand);
+static void handleUPSDA(CellularSimCommand_t *pCommand);
+static void handleURAT(CellularSimCommand_t *pCommand);
+static void handleUBANDMASK(CellularSimCommand_t *pCommand);
+static void handleUMNOPROF(CellularSimCommand_t *pCommand);
+static void handleCSQ(CellularSimCommand_t *pCommand);
+static void handleUCGED(CellularSimCommand_t *pCommand);
+static void handleCCLK(CellularSimCommand_t *pCommand);
+static void handleCGMI(CellularSimCommand_t *pCommand);
+static void handleCGMM(CellularSimCommand_t *pCommand);
+static void handleCGMR(CellularSimCommand_t *pCommand);
+static void handleI9(CellularSimCommand_t *pCommand);
+static void handleCGSN(CellularSimCommand_t *pCommand);
+static void handleCIMI(CellularSimCommand_t *pCommand);
+static void handleCCID(CellularSimCommand_t *pCommand);
+static void handleUSECDEVINFO(CellularSimCommand_t *pCommand);
+static void handleUSECE2EDATAENC(CellularSimCommand_t *pCommand);
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+// The AT commands the simulated module understands.
+static const CellularSimCommandEntry_t gCommands[] = {{"", handleOk},
+                                                      {"E0", handleE0},
+                                                      {"E1", handleE1},
+                                                      {"&C1", handleOk},
+                                                      {"&D0", handleOk},
+                                                      {"&K0", handleOk},
+                                                      {"&K3", handleOk},
+                                                      {"+CPSMS", handleOk},
+                                                      {"+UPSV", handleOk},
+                                                      {"+UAUTHREQ", handleOk},
+                                                      {"+CMEE", handleCMEE},
+                                                      {"+CFUN", handleCFUN},
+                                                      {"+CPWROFF", handleCPWROFF},
+                                                      {"+CREG", handleCxREG},
+                                                      {"+CGREG", handleCxREG},
+                                                      {"+CEREG", handleCxREG},
+                                                      {"+COPS", handleCOPS},
+                                                      {"+CGATT", handleCGATT},
+                                                      {"+CGACT", handleCGACT},
+                                                      {"+CGDCONT", handleCGDCONT},
+                                                      {"+CGPADDR", handleCGPADDR},
+                                                      {"+UPSD", handleUPSD},
+                                                      {"+UPSDA", handleUPSDA},
+                                                      {"+URAT", handleURAT},
+                                                      {"+UBANDMASK", handleUBANDMASK},
+                                                      {"+UMNOPROF", handleUMNOPROF},
+                                                      {"+CSQ", handleCSQ},
+                                                      {"+UCGED", handleUCGED},
+                                                      {"+CCLK", handleCCLK},
+                                                      {"+CGMI", handleCGMI},
+                                                      {"+CGMM", handleCGMM},
+                                                      {"+CGMR", handleCGMR},
+                                                      {"I9", handleI9},
+                                                      {"+CGSN", handleCGSN},
+                                                      {"+CIMI", handleCIMI},
+                                                      {"+CCID", handleCCID},
+                                                      {"+USECDEVINFO", handleUSECDEVINFO},
+                                                      {"+USECE2EDATAENC", handleUSECE2EDATAENC},
+                                                      {"+USECMNG", cellularSimSecUSECMNG},
+                                                      {"+USECPRF", cellularSimSecUSECPRF},
+                                                      {"+USOCR", cellularSimNetUSOCR},
+                                                      {"+USOCO", cellularSimNetUSOCO},
+                                                      {"+USOWR", cellularSimNetUSOWR},
+                                                      {"+USOST", cellularSimNetUSOST},
+                                                      {"+USORD", cellularSimNetUSORD},
+                                                      {"+USORF", cellularSimNetUSORF},
+                                                      {"+USOCL", cellularSimNetUSOCL},
+                                                      {"+USOLI", cellularSimNetUSOLI},
+                                                      {"+USOSEC", cellularSimNetUSOSEC},
+                                                      {"+USOSO", cellularSimNetUSOSO},
+                                                      {"+USOGO", cellularSimNetUSOGO},
+                                                      {"+UDNSRN", cellularSimNetUDNSRN},
+                                                      {"+UDCONF", cellularSimNetUDCONF},
+                                                      {"+UMQTT", cellularSimMqttUMQTT},
+                                                      {"+UMQTTC", cellularSimMqttUMQTTC},
+                                                      {"+UMQTTER", cellularSimMqttUMQTTER}};
+
+// The configuration.
+static const CellularSimConfig_t *gpConfig = NULL;
+
+// The file descriptor of the pseudo-terminal.
+static int32_t gFd = -1;
+
+// The shared GPIO file.
+static volatile uint8_t *gpGpio = NULL;
+
+// The monotonic time at start-up.
+static struct timespec gStartTime;
+
+// The state of the pseudo-random number generator.
+static uint32_t gRandom = 1;
+
+// The power state.
+static CellularSimPowerState_t gPowerState = CELLULAR_SIM_POWER_OFF;
+
+// When booting finishes.
+static int64_t gBootDoneMs = 0;
+
+// The last level seen on the PWR_ON pin.
+static int32_t gPwrOnLevel = 0;
+
+// When PWR_ON went low, -1 if it has not.
+static int64_t gPwrOnLowMs = -1;
+
+// Set when the command in progress asks for a power off.
+static bool gPowerOffRequested = false;
+
+// Set when the command in progress asks for a reboot.
+static bool gRebootRequested = false;
+
+// The receive buffer.
+static char gRxBuffer[CELLULAR_SIM_RX_BUFFER_SIZE_BYTES];
+
+// The number of bytes in the receive buffer.
+static size_t gRxLength = 0;
+
+// The command processing state.
+static CellularSimCommandState_t gCommandState = CELLULAR_SIM_COMMAND_STATE_IDLE;
+
+// The command line in hand.
+static char gCommandLine[CELLULAR_SIM_COMMAND_LINE_MAX_LENGTH_BYTES];
+
+// When the command line in hand is to be executed.
+static int64_t gCommandDueMs = 0;
+
+// Set while executing all but the last of a line of concatenated
+// commands, which share the one final result code.
+static bool gOkHeld = false;
+
+// Set when a command of the line in hand fails, so that the
+// commands concatenated after it are not executed.
+static bool gCommandFailed = false;
+
+// Where data following a prompt goes.
+static CellularSimDataHandler_t gpDataHandler = NULL;
+
+// The parameter for gpDataHandler.
+static void *gpDataParam = NULL;
+
+// The amount of data wanted after a prompt.
+static size_t gDataWanted = 0;
+
+// The queued URCs, each a malloc()ed buffer.
+static char *gpUrc[CELLULAR_SIM_MAX_NUM_URCS];
+
+// The length of each queued URC.
+static size_t gUrcLength[CELLULAR_SIM_MAX_NUM_URCS];
+
+// The number of queued URCs.
+static size_t gNumUrcs = 0;
+
+// The timers.
+static CellularSimTimer_t gTimers[CELLULAR_SIM_MAX_NUM_TIMERS];
+
+// The number of running timers.
+static size_t gNumTimers = 0;
+
+// Non-volatile: the RATs in rank order, local values.
+static int32_t gRats[CELLULAR_CTRL_MAX_NUM_SIMULTANEOUS_RATS];
+
+// Non-volatile: the number of entries in gRats.
+static size_t gNumRats = 0;
+
+// Non-volatile: the band masks, two per band mask RAT.
+static uint64_t gBandMask[CELLULAR_SIM_NUM_BAND_MASK_RATS][2];
+
+// Non-volatile: the MNO profile.
+static int32_t gMnoProfile = 100;
+
+// Non-volatile: whether the module is security sealed.
+static bool gSealed = false;
+
+// Whether command echo is on.
+static bool gEcho = true;
+
+// The AT+CMEE setting.
+static int32_t gCmee = 0;
+
+// The AT+CFUN setting.
+static int32_t gCfun = 1;
+
+// The AT+COPS mode.
+static int32_t gCopsMode = 0;
+
+// The AT+COPS format.
+static int32_t gCopsFormat = 0;
+
+// The URC settings for AT+CREG, AT+CGREG and AT+CEREG.
+static int32_t gRegUrc[3] = {0};
+
+// Whether the module is registered.
+static bool gRegistered = false;
+
+// Incremented on each registration attempt so that an old
+// registration timer may be recognised.
+static int32_t gRegistrationAttempt = 0;
+
+// Whether the PDP context is active.
+static bool gContextActive = false;
+
+// Whether the internal profile (AT+UPSDA) is active.
+static bool gProfileActive = false;
+
+// The APN that was set, empty if none.
+static char gApn[64] = {0};
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: MISC
+ * -------------------------------------------------------------- */
+
+// Return a pseudo-random number.
+static uint32_t random32()
+{
+    // xorshift32
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 17;
+    gRandom ^= gRandom << 5;
+
+    return gRandom;
+}
+
+// Print data to stderr with control characters made visible.
+static void logData(const char *pPrefix, const char *pData, size_t size)
+{
+    if (gpConfig->verbose) {
+        fprintf(stderr, "%7d %s", (int) cellularSimGetTimeMs(), pPrefix);
+        for (size_t x = 0; x < size; x++) {
+            if (pData[x] == '\r') {
+                fprintf(stderr, "\\r");
+            } else if (pData[x] == '\n') {
+                fprintf(stderr, "\\n");
+            } else if (isprint((unsigned char) pData[x])) {
+                fputc(pData[x], stderr);
+            } else {
+                fprintf(stderr, "[%02x]", (unsigned char) pData[x]);
+            }
+        }
+        fprintf(stderr, "\n");
+    }
+}
+
+// Write all of the given data to the pseudo-terminal.
+static void writeAll(const char *pData, size_t size)
+{
+    struct pollfd pollFd;
+    ssize_t x;
+
+    logData("CELLULAR_SIM: -> ", pData, size);
+    while (size > 0) {
+        x = write(gFd, pData, size);
+        if (x > 0) {
+            pData += x;
+            size -= x;
+        } else if ((x < 0) && (errno != EAGAIN) && (errno != EINTR)) {
+            // The other end has gone
+            size = 0;
+        } else {
+            pollFd.fd = gFd;
+            pollFd.events = POLLOUT;
+            poll(&pollFd, 1, 100);
+        }
+    }
+}
+
+// Look up the settings for a command, NULL if there are none.
+static const CellularSimCommandSetting_t *pGetSetting(const char *pName)
+{
+    const CellularSimCommandSetting_t *pSetting = NULL;
+
+    for (size_t x = 0; (pSetting == NULL) &&
+                       (x < gpConfig->numCommandSettings); x++) {
+        if (strcmp(gpConfig->commandSettings[x].name, pName) == 0) {
+            pSetting = &(gpConfig->commandSettings[x]);
+        }
+    }
+
+    return pSetting;
+}
+
+// Roll the dice: return true with the given percentage chance.
+static bool chance(int32_t percent)
+{
+    return (percent > 0) && ((int32_t) (random32() % 100) < percent);
+}
+
+// Drive the VInt pin, if there is one.
+static void driveVInt()
+{
+    if ((gpConfig->pinVInt >= 0) &&
+        (gpConfig->pinVInt < CELLULAR_SIM_GPIO_MAX_NUM)) {
+        gpGpio[CELLULAR_SIM_GPIO_MAX_NUM + gpConfig->pinVInt] = (gPowerState != CELLULAR_SIM_POWER_OFF);
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: NETWORK
+ * -------------------------------------------------------------- */
+
+// Return the registration status for the given URC type,
+// 0 for CREG, 1 for CGREG, 2 for CEREG.
+static int32_t registrationStatus(size_t type)
+{
+    int32_t status = 0;
+    bool isEutran = (gNumRats > 0) && (gRats[0] != CELLULAR_SIM_RAT_GPRS);
+
+    if (isEutran == (type == 2)) {
+        if (gRegistered) {
+            status = 1;
+        } else if ((gCfun == 1) && (gCopsMode != 2)) {
+            status = 2;
+        }
+    }
+
+    return status;
+}
+
+// Send the registration URCs that are switched on.
+static void registrationUrcs()
+{
+    const char *pName[] = {"+CREG", "+CGREG", "+CEREG"};
+
+    for (size_t x = 0; x < sizeof(pName) / sizeof(pName[0]); x++) {
+        if (gRegUrc[x] == 1) {
+            cellularSimUrc("%s: %d", pName[x], registrationStatus(x));
+        }
+    }
+}
+
+// Registration completes.
+static void registrationDone(int32_t attempt)
+{
+    if ((attempt == gRegistrationAttempt) && (gCfun == 1) &&
+        (gCopsMode != 2) && !gRegistered) {
+        gRegistered = true;
+        // An EUTRAN network brings up the default bearer
+        // with registration
+        gContextActive = (gNumRats > 0) && (gRats[0] != CELLULAR_SIM_RAT_GPRS);
+        registrationUrcs();
+    }
+}
+
+// Start registration if the module is able to register.
+static void registrationStart()
+{
+    if ((gCfun == 1) && (gCopsMode != 2) && !gRegistered) {
+        gRegistrationAttempt++;
+        cellularSimTimerStart(gpConfig->registrationTimeMs,
+                              registrationDone, gRegistrationAttempt);
+    }
+}
+
+// Leave the network.
+static void deregister()
+{
+    gRegistrationAttempt++;
+    gContextActive = false;
+    gProfileActive = false;
+    if (gRegistered) {
+        gRegistered = false;
+        registrationUrcs();
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: POWER
+ * -------------------------------------------------------------- */
+
+// Throw away everything that does not survive a power cycle.
+static void resetVolatile()
+{
+    for (size_t x = 0; x < gNumUrcs; x++) {
+        free(gpUrc[x]);
+    }
+    gNumUrcs = 0;
+    gNumTimers = 0;
+    gRxLength = 0;
+    gCommandState = CELLULAR_SIM_COMMAND_STATE_IDLE;
+    gEcho = true;
+    gCmee = 0;
+    gCfun = 1;
+    gCopsMode = 0;
+    gCopsFormat = 0;
+    for (size_t x = 0; x < sizeof(gRegUrc) / sizeof(gRegUrc[0]); x++) {
+        gRegUrc[x] = 0;
+    }
+    gRegistered = false;
+    gRegistrationAttempt++;
+    gContextActive = false;
+    gProfileActive = false;
+    gApn[0] = 0;
+    cellularSimNetReset();
+    cellularSimMqttReset();
+    cellularSimSecReset();
+}
+
+// Power the module off.
+static void powerOff()
+{
+    if (gPowerState != CELLULAR_SIM_POWER_OFF) {
+        if (gpConfig->verbose) {
+            fprintf(stderr, "CELLULAR_SIM: powered off.\n");
+        }
+        gPowerState = CELLULAR_SIM_POWER_OFF;
+        resetVolatile();
+        driveVInt();
+    }
+}
+
+// Start the module booting.
+static void boot(int64_t nowMs)
+{
+    if (gpConfig->verbose) {
+        fprintf(stderr, "CELLULAR_SIM: booting.\n");
+    }
+    resetVolatile();
+    gPowerState = CELLULAR_SIM_POWER_BOOTING;
+    gBootDoneMs = nowMs + gpConfig->bootTimeMs;
+    driveVInt();
+}
+
+// Watch the PWR_ON pin and move the power state on.
+static void powerService(int64_t nowMs)
+{
+    int32_t level;
+    int64_t lowMs;
+
+    if ((gpConfig->pinPwrOn >= 0) &&
+        (gpConfig->pinPwrOn < CELLULAR_SIM_GPIO_MAX_NUM)) {
+        level = (gpGpio[gpConfig->pinPwrOn] != 0);
+        if (level != gPwrOnLevel) {
+            gPwrOnLevel = level;
+            if (level == 0) {
+                gPwrOnLowMs = nowMs;
+            } else if (gPwrOnLowMs >= 0) {
+                // A rising edge: act on the length of the pulse
+                lowMs = nowMs - gPwrOnLowMs;
+                gPwrOnLowMs = -1;
+                if (gPowerState == CELLULAR_SIM_POWER_OFF) {
+                    if (lowMs >= CELLULAR_SIM_PWR_ON_PULSE_MIN_MS) {
+                        boot(nowMs);
+                    }
+                } else if (lowMs >= CELLULAR_SIM_PWR_OFF_PULSE_MIN_MS) {
+                    powerOff();
+                }
+            }
+        }
+    }
+
+    if ((gPowerState == CELLULAR_SIM_POWER_BOOTING) &&
+        (nowMs >= gBootDoneMs)) {
+        if (gpConfig->verbose) {
+            fprintf(stderr, "CELLULAR_SIM: powered on.\n");
+        }
+        gPowerState = CELLULAR_SIM_POWER_ON;
+        // Any input that arrived while booting is lost
+        gRxLength = 0;
+        registrationStart();
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: TIMERS
+ * -------------------------------------------------------------- */
+
+// Run any timers that have expired.
+static void timerService(int64_t nowMs)
+{
+    CellularSimTimer_t timer;
+    bool found = true;
+
+    while (found) {
+        found = false;
+        for (size_t x = 0; !found && (x < gNumTimers); x++) {
+            if (nowMs >= gTimers[x].dueMs) {
+                found = true;
+                timer = gTimers[x];
+                // Remove the timer before calling the
+                // callback, which may start another
+                gNumTimers--;
+                memmove(&(gTimers[x]), &(gTimers[x + 1]),
+                        (gNumTimers - x) * sizeof(gTimers[0]));
+                timer.pCallback(timer.param);
+            }
+        }
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: COMMAND PROCESSING
+ * -------------------------------------------------------------- */
+
+// Split a command line into a command; the line is modified.
+static bool parseCommand(char *pLine, CellularSimCommand_t *pCommand)
+{
+    bool success = false;
+    char *pIn = pLine + 2;
+    char *pOut;
+    size_t x = 0;
+
+    memset(pCommand, 0, sizeof(*pCommand));
+    if ((toupper((unsigned char) pLine[0]) == 'A') &&
+        (toupper((unsigned char) pLine[1]) == 'T')) {
+        success = true;
+        // The name is either an extended command, e.g. "+CFUN",
+        // or a basic one, e.g. "E0" or "&K3"
+        if ((*pIn == '+') || (*pIn == '&')) {
+            pCommand->name[x++] = *pIn++;
+        }
+        if (pCommand->name[0] == '&') {
+            // & plus a letter plus digits
+            if (isalpha((unsigned char) *pIn)) {
+                pCommand->name[x++] = toupper((unsigned char) *pIn++);
+            }
+            while (isdigit((unsigned char) *pIn) &&
+                   (x < sizeof(pCommand->name) - 1)) {
+                pCommand->name[x++] = *pIn++;
+            }
+        } else if (pCommand->name[0] == '+') {
+            while (isalnum((unsigned char) *pIn) &&
+                   (x < sizeof(pCommand->name) - 1)) {
+                pCommand->name[x++] = toupper((unsigned char) *pIn++);
+            }
+        } else if (isalpha((unsigned char) *pIn)) {
+            // A letter plus digits
+            pCommand->name[x++] = toupper((unsigned char) *pIn++);
+            while (isdigit((unsigned char) *pIn) &&
+                   (x < sizeof(pCommand->name) - 1)) {
+                pCommand->name[x++] = *pIn++;
+            }
+        }
+        pCommand->type = CELLULAR_SIM_COMMAND_TYPE_ACTION;
+        if (*pIn == '?') {
+            pCommand->type = CELLULAR_SIM_COMMAND_TYPE_QUERY;
+        } else if (*pIn == '=') {
+            pIn++;
+            if (*pIn == '?') {
+                pCommand->type = CELLULAR_SIM_COMMAND_TYPE_TEST;
+            } else {
+                pCommand->type = CELLULAR_SIM_COMMAND_TYPE_SET;
+                // Split the parameters at commas, removing quotes
+                while ((*pIn != 0) &&
+                       (pCommand->numParameters < CELLULAR_SIM_COMMAND_MAX_NUM_PARAMETERS)) {
+                    pCommand->pParameter[pCommand->numParameters] = pIn;
+                    pOut = pIn;
+                    if (*pIn == '"') {
+                        pCommand->quoted[pCommand->numParameters] = true;
+                        pIn++;
+                        while ((*pIn != 0) && (*pIn != '"')) {
+                            *pOut++ = *pIn++;
+                        }
+                        if (*pIn == '"') {
+                            pIn++;
+                        }
+                    }
+                    while ((*pIn != 0) && (*pIn != ',')) {
+                        *pOut++ = *pIn++;
+                    }
+                    if (*pIn == ',') {
+                        pIn++;
+                    }
+                    *pOut = 0;
+                    pCommand->numParameters++;
+                }
+            }
+        } else if (*pIn == 0) {
+            // Just the name
+        }
+    }
+
+    return success;
+}
+
+// Execute a single command.
+static void executeOne(char *pLine)
+{
+    CellularSimCommand_t command;
+    const CellularSimCommandSetting_t *pSetting;
+    CellularSimCommandHandler_t pHandler = NULL;
+
+    gCommandState = CELLULAR_SIM_COMMAND_STATE_EXECUTING;
+    if (parseCommand(pLine, &command)) {
+        pSetting = pGetSetting(command.name);
+        if ((pSetting != NULL) && chance(pSetting->dropPercent)) {
+            // Say nothing at all
+            if (gpConfig->verbose) {
+                fprintf(stderr, "CELLULAR_SIM: dropping AT%s.\n", command.name);
+            }
+            gCommandFailed = true;
+            gCommandState = CELLULAR_SIM_COMMAND_STATE_IDLE;
+        } else if ((pSetting != NULL) && chance(pSetting->errorPercent)) {
+            if (gpConfig->verbose) {
+                fprintf(stderr, "CELLULAR_SIM: injecting an error into AT%s.\n",
+                        command.name);
+            }
+            cellularSimError();
+        } else {
+            for (size_t x = 0; (pHandler == NULL) &&
+                               (x < sizeof(gCommands) / sizeof(gCommands[0])); x++) {
+                if (strcmp(gCommands[x].pName, command.name) == 0) {
+                    pHandler = gCommands[x].pHandler;
+                }
+            }
+            if (pHandler != NULL) {
+                pHandler(&command);
+            } else {
+                cellularSimError();
+            }
+        }
+    } else {
+        // Not an AT command: ignore it
+        gCommandState = CELLULAR_SIM_COMMAND_STATE_IDLE;
+    }
+}
+
+// Execute the command line in hand, which may be several extended
+// commands concatenated with a ';' between them, e.g.
+// "AT+USOSO=0,6,2,60;+USOSO=0,0,1,16".  As in V.250, only the
+// last gives a final result code and the line stops at the first
+// that fails.  A command that doesn't finish straight away (e.g.
+// one that sends a prompt) also ends the line.
+static void executeCommand()
+{
+    char line[CELLULAR_SIM_COMMAND_LINE_MAX_LENGTH_BYTES + 2];
+    const char *pSegment = gCommandLine;
+    const char *pEnd;
+    bool quoted;
+    size_t length;
+
+    gCommandFailed = false;
+    do {
+        // Find the end of this command, ignoring ';' in quotes
+        quoted = false;
+        for (pEnd = pSegment; (*pEnd != 0) &&
+                              (quoted || (*pEnd != ';')); pEnd++) {
+            if (*pEnd == '"') {
+                quoted = !quoted;
+            }
+        }
+        length = 0;
+        if (pSegment != gCommandLine) {
+            // Commands after the first have no "AT" of their own
+            memcpy(line, "AT", 2);
+            length = 2;
+        }
+        if (length + (pEnd - pSegment) >= sizeof(line)) {
+            pEnd = pSegment + sizeof(line) - length - 1;
+        }
+        memcpy(line + length, pSegment, pEnd - pSegment);
+        line[length + (pEnd - pSegment)] = 0;
+        gOkHeld = (*pEnd == ';');
+        executeOne(line);
+        gOkHeld = false;
+        pSegment = pEnd + 1;
+    } while ((*pEnd == ';') && !gCommandFailed &&
+             (gCommandState == CELLULAR_SIM_COMMAND_STATE_IDLE));
+}
+
+// Take a command line out of the receive buffer, if there is
+// one, returning true if one was found.
+static bool takeCommandLine(int64_t nowMs)
+{
+    bool found = false;
+    const CellularSimCommandSetting_t *pSetting;
+    CellularSimCommand_t command;
+    char name[CELLULAR_SIM_COMMAND_LINE_MAX_LENGTH_BYTES];
+    int32_t latencyMs;
+    size_t start = 0;
+    size_t length;
+
+    // Skip leading line-feeds and white space
+    while ((start < gRxLength) &&
+           ((gRxBuffer[start] == '\n') || (gRxBuffer[start] == ' '))) {
+        start++;
+    }
+    for (size_t x = start; !found && (x < gRxLength); x++) {
+        if (gRxBuffer[x] == '\r') {
+            found = true;
+            length = x - start;
+            if (length >= sizeof(gCommandLine)) {
+                length = sizeof(gCommandLine) - 1;
+            }
+            memcpy(gCommandLine, gRxBuffer + start, length);
+            gCommandLine[length] = 0;
+            if (gEcho) {
+                writeAll(gRxBuffer + start, x + 1 - start);
+            }
+            gRxLength -= x + 1;
+            memmove(gRxBuffer, gRxBuffer + x + 1, gRxLength);
+            logData("CELLULAR_SIM: <- ", gCommandLine, length);
+        }
+    }
+    if (!found) {
+        gRxLength -= start;
+        memmove(gRxBuffer, gRxBuffer + start, gRxLength);
+        if (gRxLength >= sizeof(gCommandLine)) {
+            // Nonsense, throw it away
+            gRxLength = 0;
+        }
+    } else if (gCommandLine[0] != 0) {
+        // Work out how long to hold the command for
+        latencyMs = gpConfig->latencyMs;
+        memcpy(name, gCommandLine, strlen(gCommandLine) + 1);
+        if (parseCommand(name, &command)) {
+            pSetting = pGetSetting(command.name);
+            if ((pSetting != NULL) && (pSetting->latencyMs >= 0)) {
+                latencyMs = pSetting->latencyMs;
+            }
+        }
+        if (gpConfig->jitterMs > 0) {
+            latencyMs += random32() % (gpConfig->jitterMs + 1);
+        }
+        gCommandDueMs = nowMs + latencyMs;
+        gCommandState = CELLULAR_SIM_COMMAND_STATE_PENDING;
+    }
+
+    return found;
+}
+
+// Move command processing on as far as possible.
+static void commandService(int64_t nowMs)
+{
+    bool keepGoing = true;
+    size_t length;
+
+    while (keepGoing && (gPowerState == CELLULAR_SIM_POWER_ON)) {
+        keepGoing = false;
+        switch (gCommandState) {
+            case CELLULAR_SIM_COMMAND_STATE_IDLE:
+                keepGoing = takeCommandLine(nowMs);
+            break;
+            case CELLULAR_SIM_COMMAND_STATE_PENDING:
+                if (nowMs >= gCommandDueMs) {
+                    executeCommand();
+                    keepGoing = true;
+                }
+            break;
+            case CELLULAR_SIM_COMMAND_STATE_DATA:
+                if (gRxLength >= gDataWanted) {
+                    length = gDataWanted;
+                    gCommandState = CELLULAR_SIM_COMMAND_STATE_EXECUTING;
+                    logData("CELLULAR_SIM: <- (data) ", gRxBuffer,
+                            length > 32 ? 32 : length);
+                    gpDataHandler(gRxBuffer, length, gpDataParam);
+                    gRxLength -= length;
+                    memmove(gRxBuffer, gRxBuffer + length, gRxLength);
+                    keepGoing = true;
+                }
+            break;
+            default:
+            break;
+        }
+        if (gCommandState == CELLULAR_SIM_COMMAND_STATE_IDLE) {
+            // Things a command asked for once its response is out
+            if (gPowerOffRequested) {
+                gPowerOffRequested = false;
+                powerOff();
+            } else if (gRebootRequested) {
+                gRebootRequested = false;
+                boot(nowMs);
+            }
+        }
+    }
+}
+
+// Send the queued URCs.
+static void urcService()
+{
+    if ((gPowerState == CELLULAR_SIM_POWER_ON) &&
+        (gCommandState == CELLULAR_SIM_COMMAND_STATE_IDLE)) {
+        cellularSimNetUrcs();
+        for (size_t x = 0; x < gNumUrcs; x++) {
+            writeAll(gpUrc[x], gUrcLength[x]);
+            free(gpUrc[x]);
+        }
+        gNumUrcs = 0;
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: AT COMMAND HANDLERS
+ * -------------------------------------------------------------- */
+
+// Any command that just needs an "OK".
+static void handleOk(CellularSimCommand_t *pCommand)
+{
+    (void) pCommand;
+
+    cellularSimOk();
+}
+
+// ATE0.
+static void handleE0(CellularSimCommand_t *pCommand)
+{
+    (void) pCommand;
+
+    gEcho = false;
+    cellularSimOk();
+}
+
+// ATE1.
+static void handleE1(CellularSimCommand_t *pCommand)
+{
+    (void) pCommand;
+
+    gEcho = true;
+    cellularSimOk();
+}
+
+// AT+CMEE.
+static void handleCMEE(CellularSimCommand_t *pCommand)
+{
+    int32_t x;
+
+    if (pCommand->type == CELLULAR_SIM_COMMAND_TYPE_QUERY) {
+        cellularSimRespond("+CMEE: %d", gCmee);
+        cellularSimOk();
+    } else if (cellularSimGetInt(pCommand, 0, &x) && (x >= 0) && (x <= 2)) {
+        gCmee = x;
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+CFUN.
+static void handleCFUN(CellularSimCommand_t *pCommand)
+{
+    int32_t x;
+
+    if (pCommand->type == CELLULAR_SIM_COMMAND_TYPE_QUERY) {
+        cellularSimRespond("+CFUN: %d", gCfun);
+        cellularSimOk();
+    } else if (cellularSimGetInt(pCommand, 0, &x)) {
+        switch (x) {
+            case 0:
+            case 4:
+                gCfun = x;
+                deregister();
+                cellularSimOk();
+            break;
+            case 1:
+                gCfun = x;
+                registrationStart();
+                cellularSimOk();
+            break;
+#ifndef CELLULAR_CFG_MODULE_SARA_R5
+            // SARA-R5 doesn't support 15
+            case 15:
+#endif
+            case 16:
+                cellularSimOk();
+                gRebootRequested = true;
+            break;
+            default:
+                cellularSimError();
+            break;
+        }
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+CPWROFF.
+static void handleCPWROFF(CellularSimCommand_t *pCommand)
+{
+    (void) pCommand;
+
+    cellularSimOk();
+    gPowerOffRequested = true;
+}
+
+// AT+CREG, AT+CGREG and AT+CEREG.
+static void handleCxREG(CellularSimCommand_t *pCommand)
+{
+    size_t type = 0;
+    int32_t x;
+
+    if (strcmp(pCommand->name, "+CGREG") == 0) {
+        type = 1;
+    } else if (strcmp(pCommand->name, "+CEREG") == 0) {
+        type = 2;
+    }
+    if (pCommand->type == CELLULAR_SIM_COMMAND_TYPE_QUERY) {
+        cellularSimRespond("%s: %d,%d", pCommand->name, gRegUrc[type],
+                           registrationStatus(type));
+        cellularSimOk();
+    } else if (cellularSimGetInt(pCommand, 0, &x) && (x >= 0) && (x <= 2)) {
+        gRegUrc[type] = x;
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+COPS.
+static void handleCOPS(CellularSimCommand_t *pCommand)
+{
+    int32_t x;
+    int32_t y;
+    int32_t act = 7;
+
+    if (pCommand->type == CELLULAR_SIM_COMMAND_TYPE_QUERY) {
+        if (gRegistered) {
+            if (gRats[0] == CELLULAR_SIM_RAT_NB1) {
+                act = 9;
+            } else if (gRats[0] == CELLULAR_SIM_RAT_GPRS) {
+                act = 0;
+            }
+            cellularSimRespond("+COPS: %d,%d,\"%s\",%d", gCopsMode, gCopsFormat,
+                               gCopsFormat == 2 ? CELLULAR_SIM_OPERATOR_NUMERIC :
+                                                  CELLULAR_SIM_OPERATOR_NAME,
+                               act);
+        } else {
+            cellularSimRespond("+COPS: %d", gCopsMode);
+        }
+        cellularSimOk();
+    } else if (cellularSimGetInt(pCommand, 0, &x)) {
+        switch (x) {
+            case 0:
+            case 1:
+                gCopsMode = x;
+                registrationStart();
+                cellularSimOk();
+            break;
+            case 2:
+                gCopsMode = x;
+                deregister();
+                cellularSimOk();
+            break;
+            case 3:
+                if (cellularSimGetInt(pCommand, 1, &y) &&
+                    ((y == 0) || (y == 2))) {
+                    gCopsFormat = y;
+                    cellularSimOk();
+                } else {
+                    cellularSimError();
+                }
+            break;
+            default:
+                cellularSimError();
+            break;
+        }
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+CGATT.
+static void handleCGATT(CellularSimCommand_t *pCommand)
+{
+    int32_t x;
+
+    if (pCommand->type == CELLULAR_SIM_COMMAND_TYPE_QUERY) {
+        cellularSimRespond("+CGATT: %d", gRegistered);
+        cellularSimOk();
+    } else if (cellularSimGetInt(pCommand, 0, &x) && ((x == 0) || (x == 1))) {
+        if (x == 0) {
+            gContextActive = false;
+            gProfileActive = false;
+        }
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+CGACT.
+static void handleCGACT(CellularSimCommand_t *pCommand)
+{
+    int32_t x;
+    int32_t y;
+
+    if (pCommand->type == CELLULAR_SIM_COMMAND_TYPE_QUERY) {
+        cellularSimRespond("+CGACT: 1,%d", gContextActive);
+        cellularSimOk();
+    } else if (cellularSimGetInt(pCommand, 0, &x) &&
+               cellularSimGetInt(pCommand, 1, &y) && (y == 1)) {
+        if (x == 0) {
+            gContextActive = false;
+            gProfileActive = false;
+            cellularSimOk();
+        } else if ((x == 1) && gRegistered) {
+            gContextActive = true;
+            cellularSimOk();
+        } else {
+            cellularSimError();
+        }
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+CGDCONT.
+static void handleCGDCONT(CellularSimCommand_t *pCommand)
+{
+    int32_t x;
+    const char *pApn;
+
+    if (pCommand->type == CELLULAR_SIM_COMMAND_TYPE_QUERY) {
+        cellularSimRespond("+CGDCONT: 1,\"IP\",\"%s\",\"%s\",0,0",
+                           gApn[0] != 0 ? gApn : CELLULAR_SIM_DEFAULT_APN,
+                           gContextActive ? CELLULAR_SIM_IP_ADDRESS : "0.0.0.0");
+        cellularSimOk();
+    } else if (cellularSimGetInt(pCommand, 0, &x) && (x == 1)) {
+        gApn[0] = 0;
+        pApn = pCellularSimGetString(pCommand, 2);
+        if (pApn != NULL) {
+            snprintf(gApn, sizeof(gApn), "%s", pApn);
+        }
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+CGPADDR.
+static void handleCGPADDR(CellularSimCommand_t *pCommand)
+{
+    int32_t x;
+
+    if (cellularSimGetInt(pCommand, 0, &x) && (x == 1)) {
+        cellularSimRespond("+CGPADDR: 1,\"%s\"",
+                           gContextActive ? CELLULAR_SIM_IP_ADDRESS : "");
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+UPSD.
+static void handleUPSD(CellularSimCommand_t *pCommand)
+{
+    int32_t x;
+
+    if (cellularSimGetInt(pCommand, 0, &x) && (x >= 0) && (x <= 6)) {
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+UPSDA.
+static void handleUPSDA(CellularSimCommand_t *pCommand)
+{
+    int32_t x;
+
+    if (cellularSimGetInt(pCommand, 1, &x)) {
+        if ((x == 3) && gContextActive) {
+            gProfileActive = true;
+            cellularSimOk();
+        } else if (x == 4) {
+            gProfileActive = false;
+            cellularSimOk();
+        } else {
+            cellularSimError();
+        }
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+URAT.
+static void handleURAT(CellularSimCommand_t *pCommand)
+{
+    char buffer[CELLULAR_SIM_RESPONSE_MAX_LENGTH_BYTES];
+    size_t length = 0;
+    int32_t rats[CELLULAR_CTRL_MAX_NUM_SIMULTANEOUS_RATS];
+    bool success;
+
+    if (pCommand->type == CELLULAR_SIM_COMMAND_TYPE_QUERY) {
+        buffer[0] = 0;
+        for (size_t x = 0; x < gNumRats; x++) {
+            length += snprintf(buffer + length, sizeof(buffer) - length,
+                               "%s%d", x > 0 ? "," : "", (int) gRats[x]);
+        }
+        cellularSimRespond("+URAT: %s", buffer);
+        cellularSimOk();
+    } else {
+        success = (pCommand->numParameters > 0) &&
+                  (pCommand->numParameters <= CELLULAR_CTRL_MAX_NUM_SIMULTANEOUS_RATS);
+        for (size_t x = 0; success && (x < pCommand->numParameters); x++) {
+            success = cellularSimGetInt(pCommand, x, &(rats[x])) &&
+                      (rats[x] >= 0) && (rats[x] <= CELLULAR_SIM_RAT_GPRS);
+        }
+        if (success) {
+            memcpy(gRats, rats, pCommand->numParameters * sizeof(rats[0]));
+            gNumRats = pCommand->numParameters;
+            cellularSimOk();
+        } else {
+            cellularSimError();
+        }
+    }
+}
+
+// AT+UBANDMASK.
+static void handleUBANDMASK(CellularSimCommand_t *pCommand)
+{
+    int32_t rat;
+    const char *pMask;
+
+    if (pCommand->type == CELLULAR_SIM_COMMAND_TYPE_QUERY) {
+        cellularSimRespond("+UBANDMASK: 0,%llu,%llu,1,%llu,%llu",
+                           (unsigned long long) gBandMask[0][0],
+                           (unsigned long long) gBandMask[0][1],
+                           (unsigned long long) gBandMask[1][0],
+                           (unsigned long long) gBandMask[1][1]);
+        cellularSimOk();
+    } else if (cellularSimGetInt(pCommand, 0, &rat) &&
+               (rat >= 0) && (rat < CELLULAR_SIM_NUM_BAND_MASK_RATS) &&
+               (pCommand->numParameters >= 2)) {
+        for (size_t x = 0; x < 2; x++) {
+            gBandMask[rat][x] = 0;
+            pMask = pCellularSimGetString(pCommand, x + 1);
+            if (pMask != NULL) {
+                gBandMask[rat][x] = strtoull(pMask, NULL, 10);
+            }
+        }
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+UMNOPROF.
+static void handleUMNOPROF(CellularSimCommand_t *pCommand)
+{
+    int32_t x;
+
+    if (pCommand->type == CELLULAR_SIM_COMMAND_TYPE_QUERY) {
+        cellularSimRespond("+UMNOPROF: %d", gMnoProfile);
+        cellularSimOk();
+    } else if (cellularSimGetInt(pCommand, 0, &x) && (x >= 0) && !gRegistered) {
+        gMnoProfile = x;
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+CSQ.
+static void handleCSQ(CellularSimCommand_t *pCommand)
+{
+    (void) pCommand;
+
+    if (gRegistered) {
+        cellularSimRespond("+CSQ: 20,0");
+    } else {
+        cellularSimRespond("+CSQ: 99,99");
+    }
+    cellularSimOk();
+}
+
+// AT+UCGED.
+static void handleUCGED(CellularSimCommand_t *pCommand)
+{
+    if (pCommand->type == CELLULAR_SIM_COMMAND_TYPE_QUERY) {
+#ifdef CELLULAR_CFG_MODULE_SARA_R4
+        cellularSimRespond("+RSRP: 217,6300,\"-081.00\",");
+        cellularSimRespond("+RSRQ: 217,6300,\"-10.00\",");
+#else
+        cellularSimRespond("+UCGED: 2");
+        writeAll("6,4,001,01\r\n", 12);
+        cellularSimRespond("2525,5,50,50,e8fe,1a2d001,1,d60814d1,8001,01,28,31,"
+                           "13.75,3,1,10,28,-50,-6,0,255,255,0");
+#endif
+    }
+    cellularSimOk();
+}
+
+// AT+CCLK.
+static void handleCCLK(CellularSimCommand_t *pCommand)
+{
+    time_t now = time(NULL);
+    struct tm timeInfo;
+
+    (void) pCommand;
+
+    gmtime_r(&now, &timeInfo);
+    cellularSimRespond("+CCLK: \"%02d/%02d/%02d,%02d:%02d:%02d+00\"",
+                       timeInfo.tm_year % 100, timeInfo.tm_mon + 1,
+                       timeInfo.tm_mday, timeInfo.tm_hour,
+                       timeInfo.tm_min, timeInfo.tm_sec);
+    cellularSimOk();
+}
+
+// AT+CGMI.
+static void handleCGMI(CellularSimCommand_t *pCommand)
+{
+    (void) pCommand;
+
+    cellularSimRespond(CELLULAR_SIM_MANUFACTURER);
+    cellularSimOk();
+}
+
+// AT+CGMM.
+static void handleCGMM(CellularSimCommand_t *pCommand)
+{
+    (void) pCommand;
+
+    cellularSimRespond(CELLULAR_SIM_MODEL);
+    cellularSimOk();
+}
+
+// AT+CGMR.
+static void handleCGMR(CellularSimCommand_t *pCommand)
+{
+    (void) pCommand;
+
+    cellularSimRespond(CELLULAR_SIM_FIRMWARE);
+    cellularSimOk();
+}
+
+// ATI9.
+static void handleI9(CellularSimCommand_t *pCommand)
+{
+    (void) pCommand;
+
+    cellularSimRespond(CELLULAR_SIM_I9);
+    cellularSimOk();
+}
+
+// AT+CGSN.
+static void handleCGSN(CellularSimCommand_t *pCommand)
+{
+    (void) pCommand;
+
+    cellularSimRespond(CELLULAR_SIM_IMEI);
+    cellularSimOk();
+}
+
+// AT+CIMI.
+static void handleCIMI(CellularSimCommand_t *pCommand)
+{
+    (void) pCommand;
+
+    cellularSimRespond(CELLULAR_SIM_IMSI);
+    cellularSimOk();
+}
+
+// AT+CCID.
+static void handleCCID(CellularSimCommand_t *pCommand)
+{
+    (void) pCommand;
+
+    cellularSimRespond("+CCID: %s", CELLULAR_SIM_ICCID);
+    cellularSimOk();
+}
+
+// AT+USECDEVINFO.
+static void handleUSECDEVINFO(CellularSimCommand_t *pCommand)
+{
+    if (pCommand->type == CELLULAR_SIM_COMMAND_TYPE_QUERY) {
+        cellularSimRespond("+USECDEVINFO: 1,%d,%d", gSealed, gSealed);
+        cellularSimOk();
+    } else if ((pCommand->numParameters == 2) && gRegistered) {
+        gSealed = true;
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// The data for AT+USECE2EDATAENC has arrived: "encrypt" it.
+static void e2eData(const char *pData, size_t dataSizeBytes, void *pParam)
+{
+    char buffer[CELLULAR_SIM_E2E_HEADER_SIZE_BYTES + CELLULAR_SIM_DATA_MAX_LENGTH_BYTES];
+    char prefix[64];
+    size_t length = CELLULAR_SIM_E2E_HEADER_SIZE_BYTES + dataSizeBytes;
+
+    (void) pParam;
+
+    // A header followed by the data, scrambled
+    for (size_t x = 0; x < CELLULAR_SIM_E2E_HEADER_SIZE_BYTES; x++) {
+        buffer[x] = (char) random32();
+    }
+    for (size_t x = 0; x < dataSizeBytes; x++) {
+        buffer[CELLULAR_SIM_E2E_HEADER_SIZE_BYTES + x] = pData[x] ^ 0x5A;
+    }
+    snprintf(prefix, sizeof(prefix), "+USECE2EDATAENC: %d,", (int) length);
+    cellularSimRespondWithData(prefix, buffer, length);
+    cellularSimOk();
+}
+
+// AT+USECE2EDATAENC.
+static void handleUSECE2EDATAENC(CellularSimCommand_t *pCommand)
+{
+    int32_t x;
+
+    if (cellularSimGetInt(pCommand, 0, &x) && (x > 0) &&
+        (x <= CELLULAR_SIM_DATA_MAX_LENGTH_BYTES)) {
+        cellularSimPrompt('>', x, e2eData, NULL);
+    } else {
+        cellularSimError();
+    }
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Run the simulated module.
+int32_t cellularSimModemRun(const CellularSimConfig_t *pConfig,
+                            int32_t fd, volatile uint8_t *pGpio,
+                            volatile bool *pStop)
+{
+    struct pollfd pollFds[CELLULAR_SIM_MAX_NUM_POLL_FDS];
+    size_t numPollFds;
+    int64_t nowMs;
+    int32_t timeoutMs;
+    ssize_t x;
+
+    gpConfig = pConfig;
+    gFd = fd;
+    gpGpio = pGpio;
+    clock_gettime(CLOCK_MONOTONIC, &gStartTime);
+    gRandom = pConfig->seed;
+    if (gRandom == 0) {
+        gRandom = 1;
+    }
+
+    // Non-volatile settings start at their defaults
+    gNumRats = 0;
+#ifdef CELLULAR_CFG_MODULE_SARA_R4
+    gRats[gNumRats++] = CELLULAR_SIM_RAT_CATM1;
+    gRats[gNumRats++] = CELLULAR_SIM_RAT_NB1;
+    gRats[gNumRats++] = CELLULAR_SIM_RAT_GPRS;
+#else
+    gRats[gNumRats++] = CELLULAR_SIM_RAT_CATM1;
+#endif
+    for (size_t y = 0; y < CELLULAR_SIM_NUM_BAND_MASK_RATS; y++) {
+        gBandMask[y][0] = 185473183ULL;
+        gBandMask[y][1] = 0;
+    }
+    gPwrOnLevel = 0;
+    if ((pConfig->pinPwrOn >= 0) &&
+        (pConfig->pinPwrOn < CELLULAR_SIM_GPIO_MAX_NUM)) {
+        gPwrOnLevel = (pGpio[pConfig->pinPwrOn] != 0);
+    }
+    gPowerState = CELLULAR_SIM_POWER_OFF;
+    resetVolatile();
+    driveVInt();
+
+    while (!*pStop) {
+        nowMs = cellularSimGetTimeMs();
+        powerService(nowMs);
+        if (gPowerState == CELLULAR_SIM_POWER_ON) {
+            timerService(nowMs);
+            commandService(nowMs);
+            urcService();
+        }
+
+        // Work out how long to wait for
+        timeoutMs = CELLULAR_SIM_POLL_INTERVAL_MS;
+        if ((gCommandState == CELLULAR_SIM_COMMAND_STATE_PENDING) &&
+            (gCommandDueMs - nowMs < timeoutMs)) {
+            timeoutMs = (int32_t) (gCommandDueMs - nowMs);
+        }
+        if (timeoutMs < 0) {
+            timeoutMs = 0;
+        }
+        pollFds[0].fd = fd;
+        pollFds[0].events = POLLIN;
+        pollFds[0].revents = 0;
+        numPollFds = 1 + cellularSimNetPollFds(pollFds + 1,
+                                               (sizeof(pollFds) / sizeof(pollFds[0])) - 1);
+        poll(pollFds, numPollFds, timeoutMs);
+        if (pollFds[0].revents & POLLIN) {
+            x = read(fd, gRxBuffer + gRxLength, sizeof(gRxBuffer) - gRxLength);
+            if (x > 0) {
+                if (gPowerState == CELLULAR_SIM_POWER_ON) {
+                    gRxLength += x;
+                } else {
+                    logData("CELLULAR_SIM: (off) <- ", gRxBuffer + gRxLength, x);
+                }
+            }
+        } else if (pollFds[0].revents & POLLHUP) {
+            // Nothing has the slave side open at the moment,
+            // don't spin
+            usleep(CELLULAR_SIM_POLL_INTERVAL_MS * 1000);
+        }
+        if (gPowerState == CELLULAR_SIM_POWER_ON) {
+            cellularSimNetService();
+        }
+        if (gRxLength >= sizeof(gRxBuffer)) {
+            // Overflow, throw it all away
+            gRxLength = 0;
+        }
+    }
+
+    powerOff();
+
+    return 0;
+}
+
+// Get the time since start in milliseconds.
+int64_t cellularSimGetTimeMs()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((int64_t) (now.tv_sec - gStartTime.tv_sec) * 1000) +
+           ((now.tv_nsec - gStartTime.tv_nsec) / 1000000);
+}
+
+// Write an information response line.
+void cellularSimRespond(const char *pFormat, ...)
+{
+    char buffer[CELLULAR_SIM_RESPONSE_MAX_LENGTH_BYTES];
+    va_list args;
+    int32_t length;
+
+    buffer[0] = '\r';
+    buffer[1] = '\n';
+    va_start(args, pFormat);
+    length = vsnprintf(buffer + 2, sizeof(buffer) - 4, pFormat, args);
+    va_end(args);
+    if (length > (int32_t) sizeof(buffer) - 5) {
+        length = sizeof(buffer) - 5;
+    }
+    length += 2;
+    buffer[length++] = '\r';
+    buffer[length++] = '\n';
+    writeAll(buffer, length);
+}
+
+// Write an information response line carrying quoted data.
+void cellularSimRespondWithData(const char *pPrefix, const char *pData,
+                                size_t dataSizeBytes)
+{
+    writeAll("\r\n", 2);
+    writeAll(pPrefix, strlen(pPrefix));
+    writeAll("\"", 1);
+    writeAll(pData, dataSizeBytes);
+    writeAll("\"\r\n", 3);
+}
+
+// End the current command with "OK".
+void cellularSimOk()
+{
+    if (!gOkHeld) {
+        writeAll("\r\nOK\r\n", 6);
+    }
+    gCommandState = CELLULAR_SIM_COMMAND_STATE_IDLE;
+}
+
+// End the current command with an error.
+void cellularSimError()
+{
+    const char *pError = "\r\nERROR\r\n";
+
+    if (gCmee == 1) {
+        pError = "\r\n+CME ERROR: 3\r\n";
+    } else if (gCmee == 2) {
+        pError = "\r\n+CME ERROR: operation not allowed\r\n";
+    }
+    writeAll(pError, strlen(pError));
+    gCommandFailed = true;
+    gCommandState = CELLULAR_SIM_COMMAND_STATE_IDLE;
+}
+
+// End the current command with a numbered +CME ERROR, given as a
+// number whatever AT+CMEE says, as the module does for an error it
+// has no text for; with AT+CMEE=0 it is just ERROR.
+void cellularSimCmeError(int32_t code)
+{
+    char buffer[32];
+
+    if (gCmee == 0) {
+        cellularSimError();
+    } else {
+        snprintf(buffer, sizeof(buffer), "\r\n+CME ERROR: %d\r\n", (int) code);
+        writeAll(buffer, strlen(buffer));
+        gCommandFailed = true;
+        gCommandState = CELLULAR_SIM_COMMAND_STATE_IDLE;
+    }
+}
+
+// Send a prompt and wait for data.
+void cellularSimPrompt(char prompt, size_t dataSizeBytes,
+                       CellularSimDataHandler_t pHandler,
+                       void *pParam)
+{
+    gpDataHandler = pHandler;
+    gpDataParam = pParam;
+    gDataWanted = dataSizeBytes;
+    gCommandState = CELLULAR_SIM_COMMAND_STATE_DATA;
+    writeAll(&prompt, 1);
+}
+
+// Queue a URC.
+void cellularSimUrc(const char *pFormat, ...)
+{
+    char buffer[CELLULAR_SIM_RESPONSE_MAX_LENGTH_BYTES];
+    va_list args;
+    int32_t length;
+
+    buffer[0] = '\r';
+    buffer[1] = '\n';
+    va_start(args, pFormat);
+    length = vsnprintf(buffer + 2, sizeof(buffer) - 4, pFormat, args);
+    va_end(args);
+    if (length > (int32_t) sizeof(buffer) - 5) {
+        length = sizeof(buffer) - 5;
+    }
+    length += 2;
+    buffer[length++] = '\r';
+    buffer[length++] = '\n';
+    cellularSimUrcBytes(buffer, length);
+}
+
+// Queue a URC that has already been formed.
+void cellularSimUrcBytes(const char *pData, size_t dataSizeBytes)
+{
+    char *pUrc;
+
+    if (gNumUrcs < CELLULAR_SIM_MAX_NUM_URCS) {
+        pUrc = (char *) malloc(dataSizeBytes);
+        if (pUrc != NULL) {
+            memcpy(pUrc, pData, dataSizeBytes);
+            gpUrc[gNumUrcs] = pUrc;
+            gUrcLength[gNumUrcs] = dataSizeBytes;
+            gNumUrcs++;
+        }
+    }
+}
+
+// Start a timer.
+int32_t cellularSimTimerStart(int32_t delayMs,
+                              void (*pCallback)(int32_t),
+                              int32_t param)
+{
+    int32_t errorCode = -1;
+
+    if (gNumTimers < CELLULAR_SIM_MAX_NUM_TIMERS) {
+        gTimers[gNumTimers].dueMs = cellularSimGetTimeMs() + delayMs;
+        gTimers[gNumTimers].pCallback = pCallback;
+        gTimers[gNumTimers].param = param;
+        gNumTimers++;
+        errorCode = 0;
+    }
+
+    return errorCode;
+}
+
+// Whether a PDP context is active.
+bool cellularSimIsDataReady()
+{
+    return gRegistered && gContextActive;
+}
+
+// Get the IMEI.
+const char *pCellularSimGetImei()
+{
+    return CELLULAR_SIM_IMEI;
+}
+
+// Get the time the far end takes to answer a TCP connection.
+int32_t cellularSimGetConnectTimeMs()
+{
+    return gpConfig->connectTimeMs;
+}
+
+// Get an integer parameter.
+bool cellularSimGetInt(const CellularSimCommand_t *pCommand,
+                       size_t index, int32_t *pValue)
+{
+    bool success = false;
+    char *pEnd;
+    long x;
+
+    if ((index < pCommand->numParameters) &&
+        !pCommand->quoted[index] &&
+        (pCommand->pParameter[index][0] != 0)) {
+        x = strtol(pCommand->pParameter[index], &pEnd, 10);
+        if (*pEnd == 0) {
+            *pValue = (int32_t) x;
+            success = true;
+        }
+    }
+
+    return success;
+}
+
+// Get a string parameter.
+const char *pCellularSimGetString(const CellularSimCommand_t *pCommand,
+                                  size_t index)
+{
+    const char *pString = NULL;
+
+    if (index < pCommand->numParameters) {
+        pString = pCommand->pParameter[index];
+    }
+
+    return pString;
+}
+
+// Decode a hex string.
+int32_t cellularSimFromHex(const char *pHex, char *pBinary,
+                           size_t maxSize)
+{
+    int32_t size = 0;
+    int32_t nibble;
+    char c;
+
+    while ((size >= 0) && (pHex[0] != 0) && (pHex[1] != 0) &&
+           ((size_t) size < maxSize)) {
+        pBinary[size] = 0;
+        for (size_t x = 0; (size >= 0) && (x < 2); x++) {
+            c = pHex[x];
+            nibble = -1;
+            if ((c >= '0') && (c <= '9')) {
+                nibble = c - '0';
+            } else if ((c >= 'a') && (c <= 'f')) {
+                nibble = c - 'a' + 10;
+            } else if ((c >= 'A') && (c <= 'F')) {
+                nibble = c - 'A' + 10;
+            }
+            if (nibble >= 0) {
+                pBinary[size] = (char) ((pBinary[size] << 4) | nibble);
+            } else {
+                size = -1;
+            }
+        }
+        if (size >= 0) {
+            size++;
+            pHex += 2;
+        }
+    }
+    if (pHex[0] != 0) {
+        // Odd length, or too long
+        size = -1;
+    }
+
+    return size;
+}
+
+// Encode binary data as hex.
+void cellularSimToHex(const char *pBinary, size_t dataSizeBytes,
+                      char *pHex)
+{
+    const char *pDigits = "0123456789abcdef";
+
+    for (size_t x = 0; x < dataSizeBytes; x++) {
+        *pHex++ = pDigits[((uint8_t) pBinary[x]) >> 4];
+        *pHex++ = pDigits[((uint8_t) pBinary[x]) & 0x0f];
+    }
+}
+
+// End of file
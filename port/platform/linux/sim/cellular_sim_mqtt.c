@@ -0,0 +1,595 @@
+/*
+ * Copyright 2020 u-blox Cambourne Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef CELLULAR_CFG_OVERRIDE
+# include "cellular_cfg_override.h" // For a customer's configuration override
+#endif
+#include "cellular_cfg_module.h"
+
+// The simulator is a host program, not part of the cellular
+// code, so it uses the C library directly
+#include "stdint.h"
+#include "stddef.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "poll.h"
+
+#include "cellular_sim.h"
+
+/* The MQTT client of the simulated module.  Rather than
+ * talking to a real broker, the client contains a stand-in for
+ * one: a message published to a topic that matches one of the
+ * client's own subscriptions comes straight back to it, which
+ * is what the tests do with a real broker.  Server responses
+ * arrive as URCs after a short delay.
+ *
+ * The SARA-R4 and SARA-R5 AT interfaces for MQTT differ
+ * considerably, both are handled here under
+ * CELLULAR_CFG_MODULE_SARA_R4.
+ */
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+// How long the simulated broker takes to respond.
+#define CELLULAR_SIM_MQTT_SERVER_DELAY_MS 50
+
+// The maximum number of subscriptions.
+#define CELLULAR_SIM_MQTT_MAX_NUM_SUBSCRIPTIONS 8
+
+// The maximum number of messages held, unread, for the client.
+#define CELLULAR_SIM_MQTT_MAX_NUM_MESSAGES 8
+
+// The maximum length of a topic name or filter, including
+// room for a terminator.
+#define CELLULAR_SIM_MQTT_TOPIC_MAX_LENGTH_BYTES 256
+
+// The maximum length of a message.
+#define CELLULAR_SIM_MQTT_MESSAGE_MAX_LENGTH_BYTES 1024
+
+// The maximum length of the other string settings, including
+// room for a terminator.
+#define CELLULAR_SIM_MQTT_STRING_MAX_LENGTH_BYTES 128
+
+// The default local port numbers.
+#define CELLULAR_SIM_MQTT_PORT_UNSECURE 1883
+#define CELLULAR_SIM_MQTT_PORT_SECURE 8883
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+// A subscription.
+typedef struct {
+    char filter[CELLULAR_SIM_MQTT_TOPIC_MAX_LENGTH_BYTES];
+    int32_t qos;
+} CellularSimMqttSubscription_t;
+
+// A message.
+typedef struct {
+    char topic[CELLULAR_SIM_MQTT_TOPIC_MAX_LENGTH_BYTES];
+    int32_t qos;
+    size_t size;
+    char data[CELLULAR_SIM_MQTT_MESSAGE_MAX_LENGTH_BYTES];
+} CellularSimMqttMessage_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+// The local client ID, empty for the default.
+static char gClientId[CELLULAR_SIM_MQTT_STRING_MAX_LENGTH_BYTES];
+
+// The local port, -1 for the default.
+static int32_t gLocalPort = -1;
+
+// Whether a server has been set.
+static bool gServerSet = false;
+
+// The inactivity timeout.
+static int32_t gInactivityTimeoutSeconds = 0;
+
+// Whether TLS is on.
+static bool gSecured = false;
+
+// The security profile.
+static int32_t gSecurityProfileId = 0;
+
+// Whether session clean is on.
+static bool gSessionClean = true;
+
+// Whether the client is logged in to the broker.
+static bool gConnected = false;
+
+// The subscriptions.
+static CellularSimMqttSubscription_t gSubscriptions[CELLULAR_SIM_MQTT_MAX_NUM_SUBSCRIPTIONS];
+
+// The number of subscriptions.
+static size_t gNumSubscriptions = 0;
+
+// The unread messages, oldest first.
+static CellularSimMqttMessage_t gMessages[CELLULAR_SIM_MQTT_MAX_NUM_MESSAGES];
+
+// The number of unread messages.
+static size_t gNumMessages = 0;
+
+// A message on its way to the broker.
+static CellularSimMqttMessage_t gInFlight;
+
+// The last error codes, as returned by AT+UMQTTER.
+static int32_t gLastError = 0;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Send the indication of the number of unread messages.
+static void unreadUrc()
+{
+#ifdef CELLULAR_CFG_MODULE_SARA_R4
+    cellularSimUrc("+UUMQTTCM: 6,%d", (int) gNumMessages);
+#else
+    cellularSimUrc("+UUMQTTC: 6,%d", (int) gNumMessages);
+#endif
+}
+
+// The broker has answered a login (param 1) or a logout (param 0).
+static void loginDone(int32_t param)
+{
+    gConnected = (param == 1);
+#ifdef CELLULAR_CFG_MODULE_SARA_R4
+    // On SARA-R4 a login result of 0 means success
+    cellularSimUrc("+UUMQTTC: %d,%d", (int) param, param == 1 ? 0 : 1);
+#else
+    cellularSimUrc("+UUMQTTC: %d,1", (int) param);
+#endif
+    if (!gConnected && gSessionClean) {
+        gNumSubscriptions = 0;
+    }
+}
+
+// The broker has received the message in flight: deliver it
+// to any matching subscription.
+static void publishDone(int32_t param)
+{
+    int32_t qos = -1;
+
+    (void) param;
+
+#ifndef CELLULAR_CFG_MODULE_SARA_R4
+    cellularSimUrc("+UUMQTTC: 2,1");
+#endif
+    for (size_t x = 0; x < gNumSubscriptions; x++) {
+        if (cellularSimMqttTopicMatch(gSubscriptions[x].filter, gInFlight.topic) &&
+            (gSubscriptions[x].qos > qos)) {
+            qos = gSubscriptions[x].qos;
+        }
+    }
+    if ((qos >= 0) && (gNumMessages < CELLULAR_SIM_MQTT_MAX_NUM_MESSAGES)) {
+        // Delivered at the lower of the two QoS values
+        if (gInFlight.qos < qos) {
+            qos = gInFlight.qos;
+        }
+        gMessages[gNumMessages] = gInFlight;
+        gMessages[gNumMessages].qos = qos;
+        gNumMessages++;
+        unreadUrc();
+    }
+}
+
+#ifdef CELLULAR_CFG_MODULE_SARA_R4
+// Answer an AT+UMQTT=x? query, which on SARA-R4 is done by URC.
+static void queryUrc(int32_t number)
+{
+    switch (number) {
+        case 0:
+            cellularSimUrc("+UUMQTT0: \"%s\"",
+                           gClientId[0] != 0 ? gClientId : pCellularSimGetImei());
+        break;
+        case 1:
+            cellularSimUrc("+UUMQTT1: %d",
+                           gLocalPort >= 0 ? gLocalPort :
+                           gSecured ? CELLULAR_SIM_MQTT_PORT_SECURE :
+                                      CELLULAR_SIM_MQTT_PORT_UNSECURE);
+        break;
+        case 10:
+            cellularSimUrc("+UUMQTT10: %d", (int) gInactivityTimeoutSeconds);
+        break;
+        case 11:
+            // Nothing is reported if unsecured
+            if (gSecured) {
+                cellularSimUrc("+UUMQTT11: 1,%d", (int) gSecurityProfileId);
+            }
+        break;
+        case 12:
+            cellularSimUrc("+UUMQTT12: %d", gSessionClean);
+        break;
+        default:
+        break;
+    }
+}
+#endif
+
+// Respond to an AT+UMQTT/AT+UMQTTC command that has been
+// accepted.
+static void accepted(const char *pName, int32_t number)
+{
+#ifdef CELLULAR_CFG_MODULE_SARA_R4
+    cellularSimRespond("%s: %d,1", pName, (int) number);
+#else
+    (void) pName;
+    (void) number;
+#endif
+    cellularSimOk();
+}
+
+// Note a failure and end the command with an error.
+static void failed(int32_t error)
+{
+    gLastError = error;
+    cellularSimError();
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Reset MQTT.
+void cellularSimMqttReset()
+{
+    gClientId[0] = 0;
+    gLocalPort = -1;
+    gServerSet = false;
+    gInactivityTimeoutSeconds = 0;
+    gSecured = false;
+    gSecurityProfileId = 0;
+    gSessionClean = true;
+    gConnected = false;
+    gNumSubscriptions = 0;
+    gNumMessages = 0;
+    gLastError = 0;
+}
+
+// Determine whether a topic matches a filter.
+bool cellularSimMqttTopicMatch(const char *pFilter, const char *pTopic)
+{
+    bool match = true;
+    bool done = false;
+
+    while (match && !done) {
+        if (*pFilter == '#') {
+            // Matches everything from here
+            done = true;
+        } else if (*pFilter == '+') {
+            // Matches up to the next level
+            while ((*pTopic != 0) && (*pTopic != '/')) {
+                pTopic++;
+            }
+            pFilter++;
+        } else if (*pFilter == *pTopic) {
+            if (*pFilter == 0) {
+                done = true;
+            } else {
+                pFilter++;
+                pTopic++;
+            }
+        } else if ((*pTopic == 0) && (pFilter[0] == '/') && (pFilter[1] == '#')) {
+            // "a/#" matches "a"
+            done = true;
+        } else {
+            match = false;
+        }
+    }
+
+    return match;
+}
+
+// AT+UMQTT.
+void cellularSimMqttUMQTT(CellularSimCommand_t *pCommand)
+{
+    const char *pParameter = pCellularSimGetString(pCommand, 0);
+    const char *pString;
+    int32_t number = -1;
+    int32_t x;
+
+    if (pParameter != NULL) {
+        number = strtol(pParameter, NULL, 10);
+    }
+#ifdef CELLULAR_CFG_MODULE_SARA_R4
+    if ((pParameter != NULL) && (strchr(pParameter, '?') != NULL)) {
+        // A query, answered with a URC
+        accepted("+UMQTT", number);
+        queryUrc(number);
+    } else
+#endif
+    if (pCommand->numParameters == 1) {
+#ifdef CELLULAR_CFG_MODULE_SARA_R4
+        cellularSimError();
+#else
+        // A query
+        switch (number) {
+            case 0:
+                cellularSimRespond("+UMQTT: 0,\"%s\"",
+                                   gClientId[0] != 0 ? gClientId : pCellularSimGetImei());
+                cellularSimOk();
+            break;
+            case 1:
+                cellularSimRespond("+UMQTT: 1,%d",
+                                   gSecured ? CELLULAR_SIM_MQTT_PORT_SECURE :
+                                              CELLULAR_SIM_MQTT_PORT_UNSECURE);
+                cellularSimOk();
+            break;
+            case 10:
+                cellularSimRespond("+UMQTT: 10,%d", (int) gInactivityTimeoutSeconds);
+                cellularSimOk();
+            break;
+            case 11:
+                if (gSecured) {
+                    cellularSimRespond("+UMQTT: 11,1,%d", (int) gSecurityProfileId);
+                } else {
+                    cellularSimRespond("+UMQTT: 11,0");
+                }
+                cellularSimOk();
+            break;
+            case 12:
+                cellularSimRespond("+UMQTT: 12,%d", gSessionClean);
+                cellularSimOk();
+            break;
+            default:
+                cellularSimError();
+            break;
+        }
+#endif
+    } else {
+        pString = pCellularSimGetString(pCommand, 1);
+        switch (number) {
+            case 0:
+                snprintf(gClientId, sizeof(gClientId), "%s", pString);
+                accepted("+UMQTT", number);
+            break;
+            case 1:
+#ifdef CELLULAR_CFG_MODULE_SARA_R5
+                failed(1);
+#else
+                if (cellularSimGetInt(pCommand, 1, &x) && (x >= 0) && (x <= 65535)) {
+                    gLocalPort = x;
+                    accepted("+UMQTT", number);
+                } else {
+                    failed(1);
+                }
+#endif
+            break;
+            case 2:
+            case 3:
+            case 4:
+                if (pString[0] != 0) {
+                    if (number != 4) {
+                        gServerSet = true;
+                    }
+                    accepted("+UMQTT", number);
+                } else {
+                    failed(1);
+                }
+            break;
+            case 10:
+                if (cellularSimGetInt(pCommand, 1, &x) && (x >= 0)) {
+                    gInactivityTimeoutSeconds = x;
+                    accepted("+UMQTT", number);
+                } else {
+                    failed(1);
+                }
+            break;
+            case 11:
+                if (cellularSimGetInt(pCommand, 1, &x) && ((x == 0) || (x == 1))) {
+                    gSecured = (x == 1);
+                    gSecurityProfileId = 0;
+                    if (gSecured) {
+                        cellularSimGetInt(pCommand, 2, &gSecurityProfileId);
+                    }
+                    accepted("+UMQTT", number);
+                } else {
+                    failed(1);
+                }
+            break;
+            case 12:
+#ifdef CELLULAR_CFG_MODULE_SARA_R5
+                failed(1);
+#else
+                if (cellularSimGetInt(pCommand, 1, &x) && ((x == 0) || (x == 1))) {
+                    gSessionClean = (x == 1);
+                    accepted("+UMQTT", number);
+                } else {
+                    failed(1);
+                }
+#endif
+            break;
+            default:
+                failed(1);
+            break;
+        }
+    }
+}
+
+// AT+UMQTTC.
+void cellularSimMqttUMQTTC(CellularSimCommand_t *pCommand)
+{
+    const char *pString;
+    int32_t number = -1;
+    int32_t qos;
+    int32_t x;
+    int32_t size;
+    CellularSimMqttMessage_t *pMessage;
+#ifdef CELLULAR_CFG_MODULE_SARA_R4
+    char *pBuffer;
+    size_t length;
+#else
+    char prefix[CELLULAR_SIM_MQTT_TOPIC_MAX_LENGTH_BYTES + 64];
+#endif
+
+    cellularSimGetInt(pCommand, 0, &number);
+    switch (number) {
+        case 0: // Logout
+            if (gConnected) {
+                accepted("+UMQTTC", number);
+                cellularSimTimerStart(CELLULAR_SIM_MQTT_SERVER_DELAY_MS, loginDone, 0);
+            } else {
+                failed(2);
+            }
+        break;
+        case 1: // Login
+            if (gServerSet && !gConnected && cellularSimIsDataReady()) {
+                accepted("+UMQTTC", number);
+                cellularSimTimerStart(CELLULAR_SIM_MQTT_SERVER_DELAY_MS, loginDone, 1);
+            } else {
+                failed(3);
+            }
+        break;
+        case 2: // Publish: qos, retain, hex, topic, message
+            pString = pCellularSimGetString(pCommand, 4);
+            if (gConnected && cellularSimGetInt(pCommand, 1, &qos) &&
+                (qos >= 0) && (qos <= 2) && cellularSimGetInt(pCommand, 3, &x) &&
+                (pString != NULL) && (pCommand->numParameters >= 6)) {
+                snprintf(gInFlight.topic, sizeof(gInFlight.topic), "%s", pString);
+                gInFlight.qos = qos;
+                pString = pCellularSimGetString(pCommand, 5);
+                if (x == 1) {
+                    size = cellularSimFromHex(pString, gInFlight.data, sizeof(gInFlight.data));
+                } else {
+                    size = strlen(pString);
+                    if ((size_t) size > sizeof(gInFlight.data)) {
+                        size = -1;
+                    } else {
+                        memcpy(gInFlight.data, pString, size);
+                    }
+                }
+                if (size >= 0) {
+                    gInFlight.size = size;
+                    accepted("+UMQTTC", number);
+                    cellularSimTimerStart(CELLULAR_SIM_MQTT_SERVER_DELAY_MS, publishDone, 0);
+                } else {
+                    failed(4);
+                }
+            } else {
+                failed(4);
+            }
+        break;
+        case 4: // Subscribe: qos, filter
+            pString = pCellularSimGetString(pCommand, 2);
+            if (gConnected && cellularSimGetInt(pCommand, 1, &qos) &&
+                (qos >= 0) && (qos <= 2) && (pString != NULL) &&
+                (strlen(pString) < CELLULAR_SIM_MQTT_TOPIC_MAX_LENGTH_BYTES)) {
+                for (x = 0; (x < (int32_t) gNumSubscriptions) &&
+                            (strcmp(gSubscriptions[x].filter, pString) != 0); x++) {
+                }
+                if (x < CELLULAR_SIM_MQTT_MAX_NUM_SUBSCRIPTIONS) {
+                    snprintf(gSubscriptions[x].filter, sizeof(gSubscriptions[x].filter),
+                             "%s", pString);
+                    gSubscriptions[x].qos = qos;
+                    if (x == (int32_t) gNumSubscriptions) {
+                        gNumSubscriptions++;
+                    }
+                    accepted("+UMQTTC", number);
+#ifdef CELLULAR_CFG_MODULE_SARA_R4
+                    // On SARA-R4 the result is the granted QoS
+                    cellularSimUrc("+UUMQTTC: 4,%d,%d,\"%s\"", (int) qos, (int) qos, pString);
+#else
+                    cellularSimUrc("+UUMQTTC: 4,1,%d,\"%s\"", (int) qos, pString);
+#endif
+                } else {
+                    failed(5);
+                }
+            } else {
+                failed(5);
+            }
+        break;
+        case 5: // Unsubscribe: filter
+            pString = pCellularSimGetString(pCommand, 1);
+            if (gConnected && (pString != NULL)) {
+                for (x = 0; x < (int32_t) gNumSubscriptions; x++) {
+                    if (strcmp(gSubscriptions[x].filter, pString) == 0) {
+                        gNumSubscriptions--;
+                        memmove(&(gSubscriptions[x]), &(gSubscriptions[x + 1]),
+                                (gNumSubscriptions - x) * sizeof(gSubscriptions[0]));
+                        break;
+                    }
+                }
+                accepted("+UMQTTC", number);
+#ifndef CELLULAR_CFG_MODULE_SARA_R4
+                cellularSimUrc("+UUMQTTC: 5,1");
+#endif
+            } else {
+                failed(6);
+            }
+        break;
+        case 6: // Read a message
+            if (gNumMessages > 0) {
+                pMessage = &(gMessages[0]);
+#ifdef CELLULAR_CFG_MODULE_SARA_R4
+                // SARA-R4 delivers the message in a URC, verbosely
+                accepted("+UMQTTC", number);
+                pBuffer = (char *) malloc(CELLULAR_SIM_MQTT_TOPIC_MAX_LENGTH_BYTES +
+                                          pMessage->size + 64);
+                if (pBuffer != NULL) {
+                    length = snprintf(pBuffer, CELLULAR_SIM_MQTT_TOPIC_MAX_LENGTH_BYTES + 64,
+                                      "\r\n+UUMQTTCM: 6,%d\r\nTopic:%s\r\r\nLen:%d QoS:%d\r\r\nMsg:",
+                                      (int) (gNumMessages - 1), pMessage->topic,
+                                      (int) pMessage->size, (int) pMessage->qos);
+                    memcpy(pBuffer + length, pMessage->data, pMessage->size);
+                    length += pMessage->size;
+                    memcpy(pBuffer + length, "\r\n", 2);
+                    length += 2;
+                    cellularSimUrcBytes(pBuffer, length);
+                    free(pBuffer);
+                }
+#else
+                snprintf(prefix, sizeof(prefix), "+UMQTTC: 6,%d,%d,%d,\"%s\",%d,",
+                         (int) pMessage->qos,
+                         (int) (strlen(pMessage->topic) + pMessage->size),
+                         (int) strlen(pMessage->topic), pMessage->topic,
+                         (int) pMessage->size);
+                cellularSimRespondWithData(prefix, pMessage->data, pMessage->size);
+                cellularSimOk();
+#endif
+                gNumMessages--;
+                memmove(&(gMessages[0]), &(gMessages[1]),
+                        gNumMessages * sizeof(gMessages[0]));
+            } else {
+                failed(7);
+            }
+        break;
+        case 7: // Message read format
+        case 8: // Ping
+            accepted("+UMQTTC", number);
+        break;
+        default:
+            failed(1);
+        break;
+    }
+}
+
+// AT+UMQTTER.
+void cellularSimMqttUMQTTER(CellularSimCommand_t *pCommand)
+{
+    (void) pCommand;
+
+    cellularSimRespond("+UMQTTER: %d,%d", gLastError != 0, (int) gLastError);
+    cellularSimOk();
+}
+
+// End of file
@@ -0,0 +1,1203 @@
+/*
+ * Copyright 2020 u-blox Cambourne Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef CELLULAR_CFG_OVERRIDE
+# include "cellular_cfg_override.h" // For a customer's configuration override
+#endif
+#include "cellular_cfg_module.h"
+#include "cellular_cfg_test.h"
+
+// The simulator is a host program, not part of the cellular
+// code, so it uses the C library directly
+#include "stdint.h"
+#include "stddef.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h" // For read(), write() and close()
+#include "fcntl.h"
+#include "poll.h"
+#include "pthread.h"
+#include "sys/socket.h"
+#include "netinet/in.h"
+#include "netinet/tcp.h"
+#include "arpa/inet.h"
+
+#include "cellular_sim.h"
+
+/* The sockets of the simulated module.  A real network is not
+ * needed: whatever address the program under test asks for,
+ * TCP sockets are connected to, and UDP datagrams are sent to,
+ * echo servers that this file runs on the loopback interface,
+ * while the address the program under test asked for is what is
+ * reported back to it.  Host names are resolved from a table
+ * that is pre-loaded with the names of the test servers in
+ * cellular_cfg_test.h and may be added to from the command line.
+ *
+ * Data that arrives from an echo server is collected into a
+ * buffer per socket by cellularSimNetService() and is indicated
+ * to the program under test with +UUSORD/+UUSORF URCs, which
+ * are coalesced: one URC carrying the total amount of data
+ * waiting is sent when the AT interface next becomes idle.
+ *
+ * A TCP socket put into listening mode with AT+USOLI listens on
+ * an ephemeral port of the loopback interface; a TCP connection
+ * made with AT+USOCO to the IP address of the module itself, on
+ * the port given to AT+USOLI, goes there instead of to the echo
+ * server, so the program under test can connect to itself.  The
+ * connection is accepted into a new socket by
+ * cellularSimNetService() and indicated with a +UUSOLI URC.
+ *
+ * A TCP connection takes the time given with -c to be answered:
+ * AT+USOCO holds the AT interface for that long unless it is
+ * asked to connect asynchronously, in which case it returns OK
+ * at once and the outcome follows in a +UUSOCO URC.  A socket
+ * given a security profile with AT+USOSEC adds the time of a TLS
+ * handshake to that, see cellular_sim_sec.c.  A TCP connection to
+ * an address starting CELLULAR_SIM_NET_BLACK_HOLE_PREFIX is never
+ * answered: an asynchronous one stays pending until the socket is
+ * closed, a synchronous one is refused.
+ */
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+// The protocol numbers used by AT+USOCR.
+#define CELLULAR_SIM_NET_PROTOCOL_TCP 6
+#define CELLULAR_SIM_NET_PROTOCOL_UDP 17
+
+// The size of the receive buffer of a TCP socket.
+#define CELLULAR_SIM_NET_TCP_BUFFER_SIZE_BYTES (1024 * 64)
+
+// The maximum number of UDP datagrams that a socket may hold.
+#define CELLULAR_SIM_NET_UDP_MAX_NUM_DATAGRAMS 16
+
+// The maximum size of a UDP datagram.
+#define CELLULAR_SIM_NET_UDP_MAX_DATAGRAM_SIZE_BYTES CELLULAR_SIM_DATA_MAX_LENGTH_BYTES
+
+// The most data that may be read with one AT+USORD/AT+USORF.
+#define CELLULAR_SIM_NET_READ_MAX_LENGTH_BYTES 1024
+
+// The maximum number of options that may be set on a socket.
+#define CELLULAR_SIM_NET_MAX_NUM_OPTIONS 16
+
+// The maximum number of entries in the hosts table.
+#define CELLULAR_SIM_NET_MAX_NUM_HOSTS 32
+
+// The maximum length of an IP address string.
+#define CELLULAR_SIM_NET_IP_ADDRESS_MAX_LENGTH_BYTES 48
+
+// The start of the IP addresses, TEST-NET-1, to which a TCP
+// connection is never answered.
+#define CELLULAR_SIM_NET_BLACK_HOLE_PREFIX "192.0.2."
+
+// The socket error reported by +UUSOCO for a connection
+// that nothing was listening for, ECONNREFUSED.
+#define CELLULAR_SIM_NET_ERROR_CONNECTION_REFUSED 111
+
+// The level and option number of the linger option,
+// the only option with two values.
+#define CELLULAR_SIM_NET_OPT_LEVEL_SOCK 65535
+#define CELLULAR_SIM_NET_OPT_LINGER 0x0080
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+// A socket option.
+typedef struct {
+    int32_t level;
+    int32_t option;
+    char value[32];
+} CellularSimNetOption_t;
+
+// A UDP datagram.
+typedef struct {
+    char ipAddress[CELLULAR_SIM_NET_IP_ADDRESS_MAX_LENGTH_BYTES];
+    int32_t port;
+    size_t size;
+    char data[CELLULAR_SIM_NET_UDP_MAX_DATAGRAM_SIZE_BYTES];
+} CellularSimNetDatagram_t;
+
+// A socket.
+typedef struct {
+    bool inUse;
+    int32_t protocol;
+    int32_t fd; // The host socket, -1 if there is none
+    bool connected;
+    bool closedByPeer;
+    // Set while an asynchronous connect awaits its +UUSOCO
+    bool connectPending;
+    // When the +UUSOCO is due
+    int64_t connectDueMs;
+    // The address the program under test asked for
+    char ipAddress[CELLULAR_SIM_NET_IP_ADDRESS_MAX_LENGTH_BYTES];
+    int32_t port;
+    // The port given to AT+USOLI, 0 if none
+    int32_t localPort;
+    // True if fd is listening for TCP connections
+    bool listening;
+    // True if AT+USOSEC has given the socket a security profile
+    bool secure;
+    int32_t securityProfile;
+    // Where fd is listening
+    struct sockaddr_in listenAddress;
+    // TCP receive buffer
+    char *pBuffer;
+    size_t bufferLength;
+    // UDP receive queue
+    CellularSimNetDatagram_t *pDatagrams;
+    size_t datagramsStart;
+    size_t numDatagrams;
+    // Set when data has arrived that has not been indicated
+    bool urcDue;
+    CellularSimNetOption_t options[CELLULAR_SIM_NET_MAX_NUM_OPTIONS];
+    size_t numOptions;
+} CellularSimNetSocket_t;
+
+// An entry in the hosts table.
+typedef struct {
+    char name[128];
+    char ipAddress[CELLULAR_SIM_NET_IP_ADDRESS_MAX_LENGTH_BYTES];
+} CellularSimNetHost_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+// The sockets.
+static CellularSimNetSocket_t gSockets[CELLULAR_SIM_MAX_NUM_SOCKETS];
+
+// The hosts table.
+static CellularSimNetHost_t gHosts[CELLULAR_SIM_NET_MAX_NUM_HOSTS];
+
+// The number of entries in the hosts table.
+static size_t gNumHosts = 0;
+
+// The address of the TCP echo server.
+static struct sockaddr_in gTcpEchoAddress;
+
+// The address of the UDP echo server.
+static struct sockaddr_in gUdpEchoAddress;
+
+// The socket on which the TCP echo server listens.
+static int gTcpListenFd = -1;
+
+// The socket of the UDP echo server.
+static int gUdpEchoFd = -1;
+
+// Whether socket data is in hex, as set by AT+UDCONF=1.
+static bool gHexMode = false;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: ECHO SERVERS
+ * -------------------------------------------------------------- */
+
+// Echo data on one TCP connection until it is closed.
+static void *tcpEchoConnectionTask(void *pParam)
+{
+    int fd = (int) (intptr_t) pParam;
+    char buffer[2048];
+    ssize_t x = 1;
+    ssize_t y;
+    ssize_t z;
+
+    while (x > 0) {
+        x = read(fd, buffer, sizeof(buffer));
+        for (y = 0; y < x; y += z) {
+            z = write(fd, buffer + y, x - y);
+            if (z <= 0) {
+                x = 0;
+                break;
+            }
+        }
+    }
+    close(fd);
+
+    return NULL;
+}
+
+// Accept TCP connections for echoing.
+static void *tcpEchoServerTask(void *pParam)
+{
+    pthread_t thread;
+    int fd;
+
+    (void) pParam;
+
+    for (;;) {
+        fd = accept(gTcpListenFd, NULL, NULL);
+        if (fd >= 0) {
+            if (pthread_create(&thread, NULL, tcpEchoConnectionTask,
+                               (void *) (intptr_t) fd) == 0) {
+                pthread_detach(thread);
+            } else {
+                close(fd);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// Echo UDP datagrams.
+static void *udpEchoServerTask(void *pParam)
+{
+    char buffer[CELLULAR_SIM_NET_UDP_MAX_DATAGRAM_SIZE_BYTES];
+    struct sockaddr_in address;
+    socklen_t addressLength;
+    ssize_t x;
+
+    (void) pParam;
+
+    for (;;) {
+        addressLength = sizeof(address);
+        x = recvfrom(gUdpEchoFd, buffer, sizeof(buffer), 0,
+                     (struct sockaddr *) &address, &addressLength);
+        if (x >= 0) {
+            sendto(gUdpEchoFd, buffer, x, 0,
+                   (struct sockaddr *) &address, addressLength);
+        }
+    }
+
+    return NULL;
+}
+
+// Open a socket bound to an ephemeral port on the loopback
+// interface, returning the address in pAddress.
+static int openLoopback(int type, struct sockaddr_in *pAddress)
+{
+    socklen_t addressLength = sizeof(*pAddress);
+    int fd;
+
+    fd = socket(AF_INET, type, 0);
+    if (fd >= 0) {
+        memset(pAddress, 0, sizeof(*pAddress));
+        pAddress->sin_family = AF_INET;
+        pAddress->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        pAddress->sin_port = 0;
+        if ((bind(fd, (struct sockaddr *) pAddress, sizeof(*pAddress)) != 0) ||
+            (getsockname(fd, (struct sockaddr *) pAddress, &addressLength) != 0)) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    return fd;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: MISC
+ * -------------------------------------------------------------- */
+
+// Get the socket addressed by the first parameter of a
+// command, NULL if there is no such socket.
+static CellularSimNetSocket_t *pGetSocket(const CellularSimCommand_t *pCommand,
+                                          int32_t *pId)
+{
+    CellularSimNetSocket_t *pSocket = NULL;
+    int32_t id;
+
+    if (cellularSimGetInt(pCommand, 0, &id) && (id >= 0) &&
+        (id < CELLULAR_SIM_MAX_NUM_SOCKETS) && gSockets[id].inUse) {
+        pSocket = &(gSockets[id]);
+        if (pId != NULL) {
+            *pId = id;
+        }
+    }
+
+    return pSocket;
+}
+
+// Free a socket.
+static void socketFree(CellularSimNetSocket_t *pSocket)
+{
+    if (pSocket->fd >= 0) {
+        close(pSocket->fd);
+    }
+    free(pSocket->pBuffer);
+    free(pSocket->pDatagrams);
+    memset(pSocket, 0, sizeof(*pSocket));
+    pSocket->fd = -1;
+}
+
+// Find a free socket, NULL if there is none.
+static CellularSimNetSocket_t *pFreeSocket()
+{
+    CellularSimNetSocket_t *pSocket = NULL;
+
+    for (size_t x = 0; (pSocket == NULL) && (x < CELLULAR_SIM_MAX_NUM_SOCKETS); x++) {
+        if (!gSockets[x].inUse) {
+            pSocket = &(gSockets[x]);
+        }
+    }
+
+    return pSocket;
+}
+
+// Find the TCP socket listening on the given port, NULL if
+// there is none.
+static CellularSimNetSocket_t *pFindListeningSocket(int32_t port)
+{
+    CellularSimNetSocket_t *pSocket = NULL;
+
+    for (size_t x = 0; (pSocket == NULL) && (x < CELLULAR_SIM_MAX_NUM_SOCKETS); x++) {
+        if (gSockets[x].inUse && gSockets[x].listening &&
+            (gSockets[x].localPort == port)) {
+            pSocket = &(gSockets[x]);
+        }
+    }
+
+    return pSocket;
+}
+
+// Accept an incoming TCP connection on a listening socket into
+// a new socket and indicate it with +UUSOLI, returning false
+// if there was nothing to accept.
+static bool acceptConnection(CellularSimNetSocket_t *pListeningSocket)
+{
+    CellularSimNetSocket_t *pSocket;
+    struct sockaddr_in address;
+    socklen_t addressLength = sizeof(address);
+    int flag = 1;
+    int fd;
+
+    fd = accept(pListeningSocket->fd, (struct sockaddr *) &address,
+                &addressLength);
+    if (fd >= 0) {
+        pSocket = pFreeSocket();
+        if (pSocket != NULL) {
+            memset(pSocket, 0, sizeof(*pSocket));
+            pSocket->protocol = CELLULAR_SIM_NET_PROTOCOL_TCP;
+            pSocket->pBuffer = (char *) malloc(CELLULAR_SIM_NET_TCP_BUFFER_SIZE_BYTES);
+        }
+        if ((pSocket != NULL) && (pSocket->pBuffer != NULL)) {
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+            pSocket->fd = fd;
+            pSocket->inUse = true;
+            pSocket->connected = true;
+            // The only thing that can connect is the module
+            // itself, so that is where the connection is from
+            snprintf(pSocket->ipAddress, sizeof(pSocket->ipAddress),
+                     "%s", CELLULAR_SIM_IP_ADDRESS);
+            pSocket->port = ntohs(address.sin_port);
+            pSocket->localPort = pListeningSocket->localPort;
+            cellularSimUrc("+UUSOLI: %d,\"%s\",%d,%d,\"%s\",%d",
+                           (int) (pSocket - gSockets), pSocket->ipAddress,
+                           (int) pSocket->port,
+                           (int) (pListeningSocket - gSockets),
+                           CELLULAR_SIM_IP_ADDRESS,
+                           (int) pListeningSocket->localPort);
+        } else {
+            // No room, refuse it
+            if (pSocket != NULL) {
+                socketFree(pSocket);
+            }
+            close(fd);
+        }
+    }
+
+    return fd >= 0;
+}
+
+// The number of bytes waiting to be read on a socket.
+static size_t bytesWaiting(const CellularSimNetSocket_t *pSocket)
+{
+    size_t length = pSocket->bufferLength;
+
+    for (size_t x = 0; x < pSocket->numDatagrams; x++) {
+        length += pSocket->pDatagrams[(pSocket->datagramsStart + x) %
+                                      CELLULAR_SIM_NET_UDP_MAX_NUM_DATAGRAMS].size;
+    }
+
+    return length;
+}
+
+// Whether a socket has room to receive more data.
+static bool hasRoom(const CellularSimNetSocket_t *pSocket)
+{
+    bool room = false;
+
+    if (pSocket->listening) {
+        room = (pFreeSocket() != NULL);
+    } else if (pSocket->protocol == CELLULAR_SIM_NET_PROTOCOL_TCP) {
+        room = pSocket->connected && !pSocket->closedByPeer &&
+               (pSocket->bufferLength < CELLULAR_SIM_NET_TCP_BUFFER_SIZE_BYTES);
+    } else {
+        room = (pSocket->numDatagrams < CELLULAR_SIM_NET_UDP_MAX_NUM_DATAGRAMS);
+    }
+
+    return room;
+}
+
+// Find a socket option, adding it if add is true, NULL
+// if it cannot be found or added.
+static CellularSimNetOption_t *pGetOption(CellularSimNetSocket_t *pSocket,
+                                          int32_t level, int32_t option,
+                                          bool add)
+{
+    CellularSimNetOption_t *pOption = NULL;
+
+    for (size_t x = 0; (pOption == NULL) && (x < pSocket->numOptions); x++) {
+        if ((pSocket->options[x].level == level) &&
+            (pSocket->options[x].option == option)) {
+            pOption = &(pSocket->options[x]);
+        }
+    }
+    if ((pOption == NULL) && add &&
+        (pSocket->numOptions < CELLULAR_SIM_NET_MAX_NUM_OPTIONS)) {
+        pOption = &(pSocket->options[pSocket->numOptions]);
+        pOption->level = level;
+        pOption->option = option;
+        pSocket->numOptions++;
+    }
+
+    return pOption;
+}
+
+// The data for AT+USOWR has arrived: send it.
+static void usowrData(const char *pData, size_t dataSizeBytes, void *pParam)
+{
+    CellularSimNetSocket_t *pSocket = (CellularSimNetSocket_t *) pParam;
+    size_t sent = 0;
+    ssize_t x;
+
+    while (sent < dataSizeBytes) {
+        x = write(pSocket->fd, pData + sent, dataSizeBytes - sent);
+        if (x <= 0) {
+            break;
+        }
+        sent += x;
+    }
+    if (sent == dataSizeBytes) {
+        cellularSimRespond("+USOWR: %d,%d", (int) (pSocket - gSockets),
+                           (int) dataSizeBytes);
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// The data for AT+USOST has arrived: send it.
+static void usostData(const char *pData, size_t dataSizeBytes, void *pParam)
+{
+    CellularSimNetSocket_t *pSocket = (CellularSimNetSocket_t *) pParam;
+
+    if (sendto(pSocket->fd, pData, dataSizeBytes, 0,
+               (struct sockaddr *) &gUdpEchoAddress,
+               sizeof(gUdpEchoAddress)) == (ssize_t) dataSizeBytes) {
+        cellularSimRespond("+USOST: %d,%d", (int) (pSocket - gSockets),
+                           (int) dataSizeBytes);
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// Respond with data read from a socket, as hex if hex mode is on.
+static void respondWithData(const char *pPrefix, const char *pData,
+                            size_t dataSizeBytes)
+{
+    char hex[CELLULAR_SIM_NET_READ_MAX_LENGTH_BYTES * 2];
+
+    if (gHexMode) {
+        cellularSimToHex(pData, dataSizeBytes, hex);
+        cellularSimRespondWithData(pPrefix, hex, dataSizeBytes * 2);
+    } else {
+        cellularSimRespondWithData(pPrefix, pData, dataSizeBytes);
+    }
+}
+
+// Get the data carried in an AT+USOWR/AT+USOST command, hex or
+// plain text depending on hex mode, returning the number of
+// bytes or -1 if it isn't valid.
+static int32_t getData(const CellularSimCommand_t *pCommand,
+                       size_t index, char *pData, size_t maxSize)
+{
+    const char *pString = pCellularSimGetString(pCommand, index);
+    int32_t size = -1;
+
+    if (pString != NULL) {
+        if (gHexMode) {
+            size = cellularSimFromHex(pString, pData, maxSize);
+        } else if (strlen(pString) <= maxSize) {
+            size = strlen(pString);
+            memcpy(pData, pString, size);
+        }
+    }
+
+    return size;
+}
+
+// Look up a host name, returning NULL if it is not known.
+static const char *pLookUp(const char *pName)
+{
+    const char *pIpAddress = NULL;
+    struct in_addr address;
+
+    if (inet_pton(AF_INET, pName, &address) == 1) {
+        // Already an IP address
+        pIpAddress = pName;
+    }
+    for (size_t x = 0; (pIpAddress == NULL) && (x < gNumHosts); x++) {
+        if (strcmp(gHosts[x].name, pName) == 0) {
+            pIpAddress = gHosts[x].ipAddress;
+        }
+    }
+
+    return pIpAddress;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Start the echo servers.
+int32_t cellularSimNetInit()
+{
+    int32_t errorCode = -1;
+    pthread_t thread;
+
+    for (size_t x = 0; x < CELLULAR_SIM_MAX_NUM_SOCKETS; x++) {
+        memset(&(gSockets[x]), 0, sizeof(gSockets[x]));
+        gSockets[x].fd = -1;
+    }
+
+    // The test servers are always known
+    cellularSimNetAddHost(CELLULAR_CFG_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+                          CELLULAR_CFG_TEST_ECHO_UDP_SERVER_IP_ADDRESS);
+    cellularSimNetAddHost(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                          CELLULAR_CFG_TEST_ECHO_TCP_SERVER_IP_ADDRESS);
+    cellularSimNetAddHost(CELLULAR_CFG_TEST_MQTT_SERVER_DOMAIN_NAME,
+                          CELLULAR_CFG_TEST_MQTT_SERVER_IP_ADDRESS);
+
+    gTcpListenFd = openLoopback(SOCK_STREAM, &gTcpEchoAddress);
+    gUdpEchoFd = openLoopback(SOCK_DGRAM, &gUdpEchoAddress);
+    if ((gTcpListenFd >= 0) && (gUdpEchoFd >= 0) &&
+        (listen(gTcpListenFd, CELLULAR_SIM_MAX_NUM_SOCKETS) == 0) &&
+        (pthread_create(&thread, NULL, tcpEchoServerTask, NULL) == 0)) {
+        pthread_detach(thread);
+        if (pthread_create(&thread, NULL, udpEchoServerTask, NULL) == 0) {
+            pthread_detach(thread);
+            errorCode = 0;
+        }
+    }
+
+    return errorCode;
+}
+
+// Add a host name.
+int32_t cellularSimNetAddHost(const char *pName, const char *pIpAddress)
+{
+    int32_t errorCode = -1;
+    const char *pColon;
+    size_t length;
+
+    if (gNumHosts < CELLULAR_SIM_NET_MAX_NUM_HOSTS) {
+        // Names may carry a port number, which is
+        // not part of the name
+        length = strlen(pName);
+        pColon = strchr(pName, ':');
+        if (pColon != NULL) {
+            length = pColon - pName;
+        }
+        snprintf(gHosts[gNumHosts].name, sizeof(gHosts[gNumHosts].name),
+                 "%.*s", (int) length, pName);
+        snprintf(gHosts[gNumHosts].ipAddress, sizeof(gHosts[gNumHosts].ipAddress),
+                 "%s", pIpAddress);
+        gNumHosts++;
+        errorCode = 0;
+    }
+
+    return errorCode;
+}
+
+// Close all sockets.
+void cellularSimNetReset()
+{
+    for (size_t x = 0; x < CELLULAR_SIM_MAX_NUM_SOCKETS; x++) {
+        if (gSockets[x].inUse) {
+            socketFree(&(gSockets[x]));
+        }
+    }
+    gHexMode = false;
+}
+
+// Add the file descriptors of sockets that have room.
+size_t cellularSimNetPollFds(struct pollfd *pPollFds, size_t maxNumFds)
+{
+    size_t numFds = 0;
+
+    for (size_t x = 0; (x < CELLULAR_SIM_MAX_NUM_SOCKETS) &&
+                       (numFds < maxNumFds); x++) {
+        if (gSockets[x].inUse && (gSockets[x].fd >= 0) &&
+            hasRoom(&(gSockets[x]))) {
+            pPollFds[numFds].fd = gSockets[x].fd;
+            pPollFds[numFds].events = POLLIN;
+            pPollFds[numFds].revents = 0;
+            numFds++;
+        }
+    }
+
+    return numFds;
+}
+
+// Collect any data that has arrived.
+void cellularSimNetService()
+{
+    CellularSimNetSocket_t *pSocket;
+    CellularSimNetDatagram_t *pDatagram;
+    ssize_t x;
+
+    for (size_t y = 0; y < CELLULAR_SIM_MAX_NUM_SOCKETS; y++) {
+        pSocket = &(gSockets[y]);
+        x = 1;
+        while (pSocket->inUse && (pSocket->fd >= 0) &&
+               hasRoom(pSocket) && (x > 0)) {
+            if (pSocket->listening) {
+                x = acceptConnection(pSocket) ? 1 : 0;
+            } else if (pSocket->protocol == CELLULAR_SIM_NET_PROTOCOL_TCP) {
+                x = recv(pSocket->fd, pSocket->pBuffer + pSocket->bufferLength,
+                         CELLULAR_SIM_NET_TCP_BUFFER_SIZE_BYTES - pSocket->bufferLength,
+                         MSG_DONTWAIT);
+                if (x > 0) {
+                    pSocket->bufferLength += x;
+                    pSocket->urcDue = true;
+                } else if (x == 0) {
+                    // The far end has closed the connection
+                    pSocket->closedByPeer = true;
+                    cellularSimUrc("+UUSOCL: %d", (int) y);
+                }
+            } else {
+                pDatagram = &(pSocket->pDatagrams[(pSocket->datagramsStart +
+                                                   pSocket->numDatagrams) %
+                                                  CELLULAR_SIM_NET_UDP_MAX_NUM_DATAGRAMS]);
+                x = recv(pSocket->fd, pDatagram->data, sizeof(pDatagram->data),
+                         MSG_DONTWAIT);
+                if (x >= 0) {
+                    // Report the datagram as coming from where
+                    // the program under test last sent to
+                    snprintf(pDatagram->ipAddress, sizeof(pDatagram->ipAddress),
+                             "%s", pSocket->ipAddress);
+                    pDatagram->port = pSocket->port;
+                    pDatagram->size = x;
+                    pSocket->numDatagrams++;
+                    pSocket->urcDue = true;
+                    // A zero length datagram is still a datagram
+                    x = 1;
+                }
+            }
+        }
+    }
+}
+
+// Send URCs for data that has arrived.
+void cellularSimNetUrcs()
+{
+    for (size_t x = 0; x < CELLULAR_SIM_MAX_NUM_SOCKETS; x++) {
+        if (gSockets[x].inUse && gSockets[x].urcDue) {
+            gSockets[x].urcDue = false;
+            cellularSimUrc("%s: %d,%d",
+                           gSockets[x].protocol == CELLULAR_SIM_NET_PROTOCOL_TCP ?
+                           "+UUSORD" : "+UUSORF",
+                           (int) x, (int) bytesWaiting(&(gSockets[x])));
+        }
+    }
+}
+
+// AT+USOCR.
+void cellularSimNetUSOCR(CellularSimCommand_t *pCommand)
+{
+    CellularSimNetSocket_t *pSocket = NULL;
+    int32_t protocol;
+
+    if (cellularSimGetInt(pCommand, 0, &protocol) &&
+        ((protocol == CELLULAR_SIM_NET_PROTOCOL_TCP) ||
+         (protocol == CELLULAR_SIM_NET_PROTOCOL_UDP)) &&
+        cellularSimIsDataReady()) {
+        pSocket = pFreeSocket();
+    }
+    if (pSocket != NULL) {
+        memset(pSocket, 0, sizeof(*pSocket));
+        pSocket->fd = -1;
+        pSocket->protocol = protocol;
+        if (protocol == CELLULAR_SIM_NET_PROTOCOL_TCP) {
+            pSocket->pBuffer = (char *) malloc(CELLULAR_SIM_NET_TCP_BUFFER_SIZE_BYTES);
+        } else {
+            pSocket->pDatagrams = (CellularSimNetDatagram_t *) malloc(CELLULAR_SIM_NET_UDP_MAX_NUM_DATAGRAMS *
+                                                                      sizeof(CellularSimNetDatagram_t));
+            pSocket->fd = socket(AF_INET, SOCK_DGRAM, 0);
+        }
+        if ((pSocket->pBuffer != NULL) ||
+            ((pSocket->pDatagrams != NULL) && (pSocket->fd >= 0))) {
+            pSocket->inUse = true;
+            cellularSimRespond("+USOCR: %d", (int) (pSocket - gSockets));
+            cellularSimOk();
+        } else {
+            socketFree(pSocket);
+            cellularSimError();
+        }
+    } else {
+        cellularSimError();
+    }
+}
+
+// End a synchronous AT+USOCO once the far end has answered.
+static void connectAnswered(int32_t unused)
+{
+    (void) unused;
+
+    cellularSimOk();
+}
+
+// Send the +UUSOCO URC of an asynchronous AT+USOCO once the far
+// end has answered; the socket may have been closed, or closed
+// and re-used, since.
+static void connectUrc(int32_t id)
+{
+    CellularSimNetSocket_t *pSocket = &(gSockets[id]);
+
+    if (pSocket->inUse && pSocket->connectPending &&
+        (cellularSimGetTimeMs() >= pSocket->connectDueMs)) {
+        pSocket->connectPending = false;
+        if (pSocket->fd >= 0) {
+            pSocket->connected = true;
+            cellularSimUrc("+UUSOCO: %d,0", (int) id);
+        } else {
+            cellularSimUrc("+UUSOCO: %d,%d", (int) id,
+                           CELLULAR_SIM_NET_ERROR_CONNECTION_REFUSED);
+        }
+    }
+}
+
+// AT+USOCO.
+void cellularSimNetUSOCO(CellularSimCommand_t *pCommand)
+{
+    CellularSimNetSocket_t *pSocket;
+    const char *pIpAddress = pCellularSimGetString(pCommand, 1);
+    const struct sockaddr_in *pAddress = &gTcpEchoAddress;
+    CellularSimNetSocket_t *pListeningSocket;
+    int32_t id;
+    int32_t port;
+    int32_t async = 0;
+    int32_t connectTimeMs = cellularSimGetConnectTimeMs();
+    int32_t roundTrips;
+    bool blackHole = false;
+    int flag = 1;
+
+    pSocket = pGetSocket(pCommand, &id);
+    if ((pSocket != NULL) && (pIpAddress != NULL) &&
+        cellularSimGetInt(pCommand, 2, &port) &&
+        ((pCommand->numParameters < 4) || cellularSimGetInt(pCommand, 3, &async)) &&
+        !pSocket->connected && !pSocket->connectPending &&
+        !pSocket->listening) {
+        snprintf(pSocket->ipAddress, sizeof(pSocket->ipAddress), "%s", pIpAddress);
+        pSocket->port = port;
+        if (pSocket->protocol == CELLULAR_SIM_NET_PROTOCOL_TCP) {
+            if (strcmp(pIpAddress, CELLULAR_SIM_IP_ADDRESS) == 0) {
+                // Connecting to ourselves: only works if
+                // something is listening
+                pListeningSocket = pFindListeningSocket(port);
+                pAddress = NULL;
+                if (pListeningSocket != NULL) {
+                    pAddress = &(pListeningSocket->listenAddress);
+                }
+            }
+            if (strncmp(pIpAddress, CELLULAR_SIM_NET_BLACK_HOLE_PREFIX,
+                        strlen(CELLULAR_SIM_NET_BLACK_HOLE_PREFIX)) == 0) {
+                pAddress = NULL;
+                blackHole = true;
+            }
+            if (pAddress != NULL) {
+                pSocket->fd = socket(AF_INET, SOCK_STREAM, 0);
+            }
+            if ((pSocket->fd >= 0) &&
+                (connect(pSocket->fd, (const struct sockaddr *) pAddress,
+                         sizeof(*pAddress)) == 0)) {
+                // The module does its own buffering, don't
+                // add Nagle delays on top
+                setsockopt(pSocket->fd, IPPROTO_TCP, TCP_NODELAY,
+                           &flag, sizeof(flag));
+                if (pSocket->secure) {
+                    // Then there's the TLS handshake
+                    roundTrips = cellularSimSecHandshake(pSocket->securityProfile,
+                                                         pIpAddress, port);
+                    if (roundTrips >= 0) {
+                        connectTimeMs += roundTrips * cellularSimGetConnectTimeMs();
+                    } else {
+                        close(pSocket->fd);
+                        pSocket->fd = -1;
+                    }
+                }
+            } else if (pSocket->fd >= 0) {
+                close(pSocket->fd);
+                pSocket->fd = -1;
+            }
+            if ((async == 1) && blackHole) {
+                // Nothing will ever come back
+                pSocket->connectPending = true;
+                pSocket->connectDueMs = INT64_MAX;
+                cellularSimOk();
+            } else if (async == 1) {
+                // Whatever the outcome, it is reported later
+                pSocket->connectPending = true;
+                pSocket->connectDueMs = cellularSimGetTimeMs() + connectTimeMs;
+                cellularSimOk();
+                if (cellularSimTimerStart(connectTimeMs, connectUrc, id) != 0) {
+                    // No timer free, answer now
+                    pSocket->connectDueMs = 0;
+                    connectUrc(id);
+                }
+            } else if (pSocket->fd >= 0) {
+                pSocket->connected = true;
+                // Hold the AT interface until answered
+                if ((connectTimeMs <= 0) ||
+                    (cellularSimTimerStart(connectTimeMs, connectAnswered, 0) != 0)) {
+                    cellularSimOk();
+                }
+            } else {
+                cellularSimError();
+            }
+        } else {
+            pSocket->connected = true;
+            cellularSimOk();
+        }
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+USOWR.
+void cellularSimNetUSOWR(CellularSimCommand_t *pCommand)
+{
+    CellularSimNetSocket_t *pSocket = pGetSocket(pCommand, NULL);
+    char data[CELLULAR_SIM_DATA_MAX_LENGTH_BYTES];
+    int32_t length;
+
+    if ((pSocket != NULL) && (pSocket->protocol == CELLULAR_SIM_NET_PROTOCOL_TCP) &&
+        pSocket->connected && !pSocket->closedByPeer &&
+        cellularSimGetInt(pCommand, 1, &length) &&
+        (length > 0) && (length <= CELLULAR_SIM_DATA_MAX_LENGTH_BYTES)) {
+        if (pCommand->numParameters < 3) {
+            // Binary syntax: the data follows a prompt
+            cellularSimPrompt('@', length, usowrData, pSocket);
+        } else if (getData(pCommand, 2, data, sizeof(data)) == length) {
+            // Base syntax: the data is in the command
+            usowrData(data, length, pSocket);
+        } else {
+            cellularSimError();
+        }
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+USOST.
+void cellularSimNetUSOST(CellularSimCommand_t *pCommand)
+{
+    CellularSimNetSocket_t *pSocket = pGetSocket(pCommand, NULL);
+    const char *pIpAddress = pCellularSimGetString(pCommand, 1);
+    char data[CELLULAR_SIM_NET_UDP_MAX_DATAGRAM_SIZE_BYTES];
+    int32_t port;
+    int32_t length;
+
+    if ((pSocket != NULL) && (pSocket->protocol == CELLULAR_SIM_NET_PROTOCOL_UDP) &&
+        (pIpAddress != NULL) && cellularSimGetInt(pCommand, 2, &port) &&
+        cellularSimGetInt(pCommand, 3, &length) &&
+        (length > 0) && (length <= CELLULAR_SIM_NET_UDP_MAX_DATAGRAM_SIZE_BYTES)) {
+        snprintf(pSocket->ipAddress, sizeof(pSocket->ipAddress), "%s", pIpAddress);
+        pSocket->port = port;
+        if (pCommand->numParameters < 5) {
+            // Binary syntax: the data follows a prompt
+            cellularSimPrompt('@', length, usostData, pSocket);
+        } else if (getData(pCommand, 4, data, sizeof(data)) == length) {
+            // Base syntax: the data is in the command
+            usostData(data, length, pSocket);
+        } else {
+            cellularSimError();
+        }
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+USORD.
+void cellularSimNetUSORD(CellularSimCommand_t *pCommand)
+{
+    CellularSimNetSocket_t *pSocket;
+    char prefix[32];
+    int32_t id;
+    int32_t length;
+
+    pSocket = pGetSocket(pCommand, &id);
+    if ((pSocket != NULL) && (pSocket->protocol == CELLULAR_SIM_NET_PROTOCOL_TCP) &&
+        cellularSimGetInt(pCommand, 1, &length) && (length >= 0)) {
+        if (length == 0) {
+            cellularSimRespond("+USORD: %d,%d", (int) id, (int) pSocket->bufferLength);
+        } else {
+            if (length > CELLULAR_SIM_NET_READ_MAX_LENGTH_BYTES) {
+                length = CELLULAR_SIM_NET_READ_MAX_LENGTH_BYTES;
+            }
+            if ((size_t) length > pSocket->bufferLength) {
+                length = pSocket->bufferLength;
+            }
+            snprintf(prefix, sizeof(prefix), "+USORD: %d,%d,", (int) id, (int) length);
+            respondWithData(prefix, pSocket->pBuffer, length);
+            pSocket->bufferLength -= length;
+            memmove(pSocket->pBuffer, pSocket->pBuffer + length,
+                    pSocket->bufferLength);
+        }
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+USORF.
+void cellularSimNetUSORF(CellularSimCommand_t *pCommand)
+{
+    CellularSimNetSocket_t *pSocket;
+    CellularSimNetDatagram_t *pDatagram;
+    char prefix[128];
+    int32_t id;
+    int32_t length;
+
+    pSocket = pGetSocket(pCommand, &id);
+    if ((pSocket != NULL) && (pSocket->protocol == CELLULAR_SIM_NET_PROTOCOL_UDP) &&
+        cellularSimGetInt(pCommand, 1, &length) && (length >= 0)) {
+        if (length == 0) {
+            cellularSimRespond("+USORF: %d,%d", (int) id, (int) bytesWaiting(pSocket));
+        } else if (pSocket->numDatagrams > 0) {
+            // One whole datagram, anything that doesn't
+            // fit is lost
+            pDatagram = &(pSocket->pDatagrams[pSocket->datagramsStart]);
+            if (length > CELLULAR_SIM_NET_READ_MAX_LENGTH_BYTES) {
+                length = CELLULAR_SIM_NET_READ_MAX_LENGTH_BYTES;
+            }
+            if ((size_t) length > pDatagram->size) {
+                length = pDatagram->size;
+            }
+            snprintf(prefix, sizeof(prefix), "+USORF: %d,\"%s\",%d,%d,",
+                     (int) id, pDatagram->ipAddress, (int) pDatagram->port,
+                     (int) length);
+            respondWithData(prefix, pDatagram->data, length);
+            pSocket->datagramsStart = (pSocket->datagramsStart + 1) %
+                                      CELLULAR_SIM_NET_UDP_MAX_NUM_DATAGRAMS;
+            pSocket->numDatagrams--;
+        } else {
+            cellularSimRespond("+USORF: %d,\"0.0.0.0\",0,0,\"\"", (int) id);
+        }
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+USOCL.
+void cellularSimNetUSOCL(CellularSimCommand_t *pCommand)
+{
+    CellularSimNetSocket_t *pSocket;
+    int32_t id;
+    int32_t async = 0;
+
+    pSocket = pGetSocket(pCommand, &id);
+    if ((pSocket != NULL) &&
+        ((pCommand->numParameters < 2) || cellularSimGetInt(pCommand, 1, &async))) {
+        socketFree(pSocket);
+        cellularSimOk();
+        if (async == 1) {
+            cellularSimUrc("+UUSOCL: %d", (int) id);
+        }
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+USOLI.
+void cellularSimNetUSOLI(CellularSimCommand_t *pCommand)
+{
+    CellularSimNetSocket_t *pSocket = pGetSocket(pCommand, NULL);
+    int32_t port;
+    bool success = false;
+
+    if ((pSocket != NULL) && cellularSimGetInt(pCommand, 1, &port) &&
+        (port > 0) && (port <= 65535) && !pSocket->connected &&
+        (pSocket->localPort == 0)) {
+        if (pSocket->protocol == CELLULAR_SIM_NET_PROTOCOL_TCP) {
+            if (pFindListeningSocket(port) == NULL) {
+                pSocket->fd = openLoopback(SOCK_STREAM, &(pSocket->listenAddress));
+                if ((pSocket->fd >= 0) &&
+                    (listen(pSocket->fd, CELLULAR_SIM_MAX_NUM_SOCKETS) == 0) &&
+                    (fcntl(pSocket->fd, F_SETFL,
+                           fcntl(pSocket->fd, F_GETFL) | O_NONBLOCK) == 0)) {
+                    pSocket->listening = true;
+                    success = true;
+                } else if (pSocket->fd >= 0) {
+                    close(pSocket->fd);
+                    pSocket->fd = -1;
+                }
+            }
+        } else {
+            // Datagrams go to the echo server whatever, there
+            // is nothing to listen for
+            success = true;
+        }
+        if (success) {
+            pSocket->localPort = port;
+        }
+    }
+    if (success) {
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+USOSEC.
+void cellularSimNetUSOSEC(CellularSimCommand_t *pCommand)
+{
+    CellularSimNetSocket_t *pSocket = pGetSocket(pCommand, NULL);
+    int32_t enable;
+    int32_t profile = 0;
+
+    if ((pSocket != NULL) && (pSocket->protocol == CELLULAR_SIM_NET_PROTOCOL_TCP) &&
+        !pSocket->connected && !pSocket->connectPending && !pSocket->listening &&
+        cellularSimGetInt(pCommand, 1, &enable) &&
+        (((enable == 0) && (pCommand->numParameters == 2)) ||
+         ((enable == 1) && cellularSimGetInt(pCommand, 2, &profile) &&
+          cellularSimSecProfileIsValid(profile)))) {
+        pSocket->secure = (enable == 1);
+        pSocket->securityProfile = profile;
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+USOSO.
+void cellularSimNetUSOSO(CellularSimCommand_t *pCommand)
+{
+    CellularSimNetSocket_t *pSocket = pGetSocket(pCommand, NULL);
+    CellularSimNetOption_t *pOption = NULL;
+    int32_t level;
+    int32_t option;
+    int32_t value;
+    int32_t value2;
+
+    if ((pSocket != NULL) && cellularSimGetInt(pCommand, 1, &level) &&
+        cellularSimGetInt(pCommand, 2, &option) &&
+        cellularSimGetInt(pCommand, 3, &value) && (value >= 0)) {
+        pOption = pGetOption(pSocket, level, option, true);
+    }
+    if (pOption != NULL) {
+        if ((level == CELLULAR_SIM_NET_OPT_LEVEL_SOCK) &&
+            (option == CELLULAR_SIM_NET_OPT_LINGER) && (value == 1) &&
+            cellularSimGetInt(pCommand, 4, &value2)) {
+            snprintf(pOption->value, sizeof(pOption->value), "%d,%d",
+                     (int) value, (int) value2);
+        } else {
+            snprintf(pOption->value, sizeof(pOption->value), "%d", (int) value);
+        }
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+USOGO.
+void cellularSimNetUSOGO(CellularSimCommand_t *pCommand)
+{
+    CellularSimNetSocket_t *pSocket = pGetSocket(pCommand, NULL);
+    CellularSimNetOption_t *pOption;
+    int32_t level;
+    int32_t option;
+
+    if ((pSocket != NULL) && cellularSimGetInt(pCommand, 1, &level) &&
+        cellularSimGetInt(pCommand, 2, &option)) {
+        pOption = pGetOption(pSocket, level, option, false);
+        if (pOption != NULL) {
+            cellularSimRespond("+USOGO: %s", pOption->value);
+        } else if ((level == 0) && (option == 2)) {
+            // IP time to live
+            cellularSimRespond("+USOGO: 64");
+        } else if ((level == 6) && (option == 2)) {
+            // TCP keep idle
+            cellularSimRespond("+USOGO: 7200");
+        } else {
+            cellularSimRespond("+USOGO: 0");
+        }
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+UDNSRN.
+void cellularSimNetUDNSRN(CellularSimCommand_t *pCommand)
+{
+    const char *pName = pCellularSimGetString(pCommand, 1);
+    const char *pIpAddress = NULL;
+    int32_t type;
+
+    if (cellularSimGetInt(pCommand, 0, &type) && (type == 0) &&
+        (pName != NULL) && cellularSimIsDataReady()) {
+        pIpAddress = pLookUp(pName);
+        if (pIpAddress != NULL) {
+            cellularSimRespond("+UDNSRN: \"%s\"", pIpAddress);
+            cellularSimOk();
+        } else {
+            // There is no such host
+            cellularSimCmeError(CELLULAR_SOCK_DNS_CME_ERROR_HOST_NOT_FOUND);
+        }
+    } else {
+        // Can't look anything up
+        cellularSimError();
+    }
+}
+
+// AT+UDCONF: only the hex mode setting, 1, is acted upon.
+void cellularSimNetUDCONF(CellularSimCommand_t *pCommand)
+{
+    int32_t setting;
+    int32_t value;
+
+    if (cellularSimGetInt(pCommand, 0, &setting)) {
+        if (setting == 1) {
+            if (pCommand->type == CELLULAR_SIM_COMMAND_TYPE_SET) {
+                if (pCommand->numParameters < 2) {
+                    cellularSimRespond("+UDCONF: 1,%d", gHexMode ? 1 : 0);
+                    cellularSimOk();
+                } else if (cellularSimGetInt(pCommand, 1, &value) &&
+                           ((value == 0) || (value == 1))) {
+                    gHexMode = (value == 1);
+                    cellularSimOk();
+                } else {
+                    cellularSimError();
+                }
+            } else {
+                cellularSimError();
+            }
+        } else {
+            cellularSimOk();
+        }
+    } else {
+        cellularSimError();
+    }
+}
+
+// End of file
@@ -0,0 +1,362 @@
+/*
+ * Copyright 2020 u-blox Cambourne Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef CELLULAR_CFG_OVERRIDE
+# include "cellular_cfg_override.h" // For a customer's configuration override
+#endif
+#include "cellular_cfg_module.h"
+
+// The simulator is a host program, not part of the cellular
+// code, so it uses the C library directly
+#include "stdint.h"
+#include "stddef.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "poll.h"
+
+#include "cellular_sim.h"
+
+/* The security features of the simulated module: the credential
+ * store of AT+USECMNG and the security profiles of AT+USECPRF,
+ * with which a socket given a profile by AT+USOSEC runs TLS.
+ * No TLS is actually done, the data still goes to and from the
+ * echo servers in the clear; what is simulated is whether the
+ * handshake would succeed, a profile that checks the server
+ * needing a root CA that has been stored, and how long it takes:
+ * two more round trips of the time given with -c for a full
+ * handshake or, with session resumption switched on for the
+ * profile, one for a reconnect to the server that the profile
+ * last made a session with.  Credentials and profiles are kept
+ * in NVM and so survive the module being powered off, the TLS
+ * sessions do not.
+ */
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+// The maximum number of credentials that may be stored.
+#define CELLULAR_SIM_SEC_MAX_NUM_CREDENTIALS 16
+
+// The maximum length of the name of a credential, including
+// room for a terminator.
+#define CELLULAR_SIM_SEC_NAME_MAX_LENGTH_BYTES 201
+
+// The number of security profiles.
+#define CELLULAR_SIM_SEC_NUM_PROFILES 5
+
+// The maximum length of a server name, including room for
+// a terminator.
+#define CELLULAR_SIM_SEC_SERVER_NAME_MAX_LENGTH_BYTES 256
+
+// The maximum length of an IP address string.
+#define CELLULAR_SIM_SEC_IP_ADDRESS_MAX_LENGTH_BYTES 48
+
+// The credential type of a root CA.
+#define CELLULAR_SIM_SEC_CREDENTIAL_ROOT_CA 0
+
+// The number of round trips of a full TLS handshake and of
+// one that resumes a session.
+#define CELLULAR_SIM_SEC_HANDSHAKE_ROUND_TRIPS_FULL    2
+#define CELLULAR_SIM_SEC_HANDSHAKE_ROUND_TRIPS_RESUMED 1
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+// A stored credential.
+typedef struct {
+    bool inUse;
+    int32_t type;
+    char name[CELLULAR_SIM_SEC_NAME_MAX_LENGTH_BYTES];
+    size_t size;
+    uint32_t checksum;
+} CellularSimSecCredential_t;
+
+// A security profile.
+typedef struct {
+    int32_t validation;
+    char rootCaName[CELLULAR_SIM_SEC_NAME_MAX_LENGTH_BYTES];
+    char clientCertName[CELLULAR_SIM_SEC_NAME_MAX_LENGTH_BYTES];
+    char clientKeyName[CELLULAR_SIM_SEC_NAME_MAX_LENGTH_BYTES];
+    char serverName[CELLULAR_SIM_SEC_SERVER_NAME_MAX_LENGTH_BYTES];
+    char sni[CELLULAR_SIM_SEC_SERVER_NAME_MAX_LENGTH_BYTES];
+    bool sessionResumption;
+    // The server that the profile has a TLS session with, if any
+    bool hasSession;
+    char sessionIpAddress[CELLULAR_SIM_SEC_IP_ADDRESS_MAX_LENGTH_BYTES];
+    int32_t sessionPort;
+} CellularSimSecProfile_t;
+
+// A credential waiting for its data to arrive after the prompt.
+typedef struct {
+    int32_t type;
+    char name[CELLULAR_SIM_SEC_NAME_MAX_LENGTH_BYTES];
+} CellularSimSecPending_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+// The credential store.
+static CellularSimSecCredential_t gCredentials[CELLULAR_SIM_SEC_MAX_NUM_CREDENTIALS];
+
+// The security profiles.
+static CellularSimSecProfile_t gProfiles[CELLULAR_SIM_SEC_NUM_PROFILES];
+
+// The credential being imported.
+static CellularSimSecPending_t gPending;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Work out a checksum of a credential, reported in place of
+// the MD5 hash that the module gives.
+static uint32_t checksum(const char *pData, size_t dataSizeBytes)
+{
+    uint32_t x = 2166136261UL;
+
+    for (size_t y = 0; y < dataSizeBytes; y++) {
+        x ^= (uint8_t) pData[y];
+        x *= 16777619UL;
+    }
+
+    return x;
+}
+
+// Find a stored credential, NULL if there is none.
+static CellularSimSecCredential_t *pFindCredential(int32_t type,
+                                                   const char *pName)
+{
+    CellularSimSecCredential_t *pCredential = NULL;
+
+    for (size_t x = 0; (pCredential == NULL) &&
+                       (x < CELLULAR_SIM_SEC_MAX_NUM_CREDENTIALS); x++) {
+        if (gCredentials[x].inUse && (gCredentials[x].type == type) &&
+            (strcmp(gCredentials[x].name, pName) == 0)) {
+            pCredential = &(gCredentials[x]);
+        }
+    }
+
+    return pCredential;
+}
+
+// Get the security profile an AT command is about, NULL if
+// there is no such profile.
+static CellularSimSecProfile_t *pGetProfile(const CellularSimCommand_t *pCommand)
+{
+    CellularSimSecProfile_t *pProfile = NULL;
+    int32_t id;
+
+    if (cellularSimGetInt(pCommand, 0, &id) && (id >= 0) &&
+        (id < CELLULAR_SIM_SEC_NUM_PROFILES)) {
+        pProfile = &(gProfiles[id]);
+    }
+
+    return pProfile;
+}
+
+// The data of a credential being imported with AT+USECMNG
+// has arrived: store it.
+static void usecmngData(const char *pData, size_t dataSizeBytes, void *pParam)
+{
+    CellularSimSecPending_t *pPending = (CellularSimSecPending_t *) pParam;
+    CellularSimSecCredential_t *pCredential;
+    uint32_t x = checksum(pData, dataSizeBytes);
+
+    pCredential = pFindCredential(pPending->type, pPending->name);
+    for (size_t y = 0; (pCredential == NULL) &&
+                       (y < CELLULAR_SIM_SEC_MAX_NUM_CREDENTIALS); y++) {
+        if (!gCredentials[y].inUse) {
+            pCredential = &(gCredentials[y]);
+        }
+    }
+    if (pCredential != NULL) {
+        pCredential->inUse = true;
+        pCredential->type = pPending->type;
+        snprintf(pCredential->name, sizeof(pCredential->name), "%s",
+                 pPending->name);
+        pCredential->size = dataSizeBytes;
+        pCredential->checksum = x;
+        cellularSimRespond("+USECMNG: 0,%d,\"%s\",\"%08x%08x%08x%08x\"",
+                           (int) pCredential->type, pCredential->name,
+                           x, x, x, x);
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Reset security.
+void cellularSimSecReset()
+{
+    for (size_t x = 0; x < CELLULAR_SIM_SEC_NUM_PROFILES; x++) {
+        gProfiles[x].hasSession = false;
+    }
+}
+
+// Determine whether a security profile exists.
+bool cellularSimSecProfileIsValid(int32_t id)
+{
+    return (id >= 0) && (id < CELLULAR_SIM_SEC_NUM_PROFILES);
+}
+
+// Do the TLS handshake of a socket with a security profile.
+int32_t cellularSimSecHandshake(int32_t id, const char *pIpAddress,
+                                int32_t port)
+{
+    int32_t roundTrips = -1;
+    CellularSimSecProfile_t *pProfile;
+
+    if (cellularSimSecProfileIsValid(id)) {
+        pProfile = &(gProfiles[id]);
+        // A profile that checks the server needs the root CA
+        if ((pProfile->validation == 0) ||
+            ((pProfile->rootCaName[0] != 0) &&
+             (pFindCredential(CELLULAR_SIM_SEC_CREDENTIAL_ROOT_CA,
+                              pProfile->rootCaName) != NULL))) {
+            roundTrips = CELLULAR_SIM_SEC_HANDSHAKE_ROUND_TRIPS_FULL;
+            if (pProfile->sessionResumption && pProfile->hasSession &&
+                (strcmp(pProfile->sessionIpAddress, pIpAddress) == 0) &&
+                (pProfile->sessionPort == port)) {
+                roundTrips = CELLULAR_SIM_SEC_HANDSHAKE_ROUND_TRIPS_RESUMED;
+            }
+            pProfile->hasSession = pProfile->sessionResumption;
+            snprintf(pProfile->sessionIpAddress,
+                     sizeof(pProfile->sessionIpAddress), "%s", pIpAddress);
+            pProfile->sessionPort = port;
+        }
+    }
+
+    return roundTrips;
+}
+
+// AT+USECMNG.
+void cellularSimSecUSECMNG(CellularSimCommand_t *pCommand)
+{
+    CellularSimSecCredential_t *pCredential;
+    const char *pName = pCellularSimGetString(pCommand, 2);
+    int32_t op;
+    int32_t type;
+    int32_t size;
+
+    if (cellularSimGetInt(pCommand, 0, &op) &&
+        cellularSimGetInt(pCommand, 1, &type) &&
+        (type >= 0) && (pName != NULL) && (pName[0] != 0) &&
+        (strlen(pName) < CELLULAR_SIM_SEC_NAME_MAX_LENGTH_BYTES)) {
+        if ((op == 0) && cellularSimGetInt(pCommand, 3, &size) &&
+            (size > 0) && (size <= CELLULAR_SIM_DATA_MAX_LENGTH_BYTES)) {
+            // Import
+            gPending.type = type;
+            snprintf(gPending.name, sizeof(gPending.name), "%s", pName);
+            cellularSimPrompt('>', size, usecmngData, &gPending);
+        } else if (op == 2) {
+            // Remove
+            pCredential = pFindCredential(type, pName);
+            if (pCredential != NULL) {
+                pCredential->inUse = false;
+                cellularSimOk();
+            } else {
+                cellularSimError();
+            }
+        } else {
+            cellularSimError();
+        }
+    } else {
+        cellularSimError();
+    }
+}
+
+// AT+USECPRF.
+void cellularSimSecUSECPRF(CellularSimCommand_t *pCommand)
+{
+    CellularSimSecProfile_t *pProfile = pGetProfile(pCommand);
+    const char *pString = pCellularSimGetString(pCommand, 2);
+    char *pSetting = NULL;
+    size_t settingSize = 0;
+    int32_t op;
+    int32_t value = 0;
+    bool success = false;
+
+    if (pProfile != NULL) {
+        if (pCommand->numParameters == 1) {
+            // Back to the defaults
+            memset(pProfile, 0, sizeof(*pProfile));
+            success = true;
+        } else if (cellularSimGetInt(pCommand, 1, &op) && (pString != NULL)) {
+            switch (op) {
+                case 3:
+                    pSetting = pProfile->rootCaName;
+                    settingSize = sizeof(pProfile->rootCaName);
+                break;
+                case 4:
+                    pSetting = pProfile->serverName;
+                    settingSize = sizeof(pProfile->serverName);
+                break;
+                case 5:
+                    pSetting = pProfile->clientCertName;
+                    settingSize = sizeof(pProfile->clientCertName);
+                break;
+                case 6:
+                    pSetting = pProfile->clientKeyName;
+                    settingSize = sizeof(pProfile->clientKeyName);
+                break;
+                case 10:
+                    pSetting = pProfile->sni;
+                    settingSize = sizeof(pProfile->sni);
+                break;
+                default:
+                    // The rest have integer values, of which only
+                    // validation and session resumption matter here
+                    if (cellularSimGetInt(pCommand, 2, &value)) {
+                        success = true;
+                        if (op == 0) {
+                            success = (value >= 0) && (value <= 3);
+                            if (success) {
+                                pProfile->validation = value;
+                            }
+                        } else if (op == 13) {
+                            success = (value == 0) || (value == 1);
+                            if (success) {
+                                pProfile->sessionResumption = (value == 1);
+                            }
+                        }
+                    }
+                break;
+            }
+            if ((pSetting != NULL) && (strlen(pString) < settingSize)) {
+                strcpy(pSetting, pString);
+                success = true;
+            }
+        }
+    }
+    if (success) {
+        // Any change means a new session
+        pProfile->hasSession = false;
+        cellularSimOk();
+    } else {
+        cellularSimError();
+    }
+}
+
+// End of file
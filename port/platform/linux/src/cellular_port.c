@@ -0,0 +1,127 @@
+/*
+ * Copyright 2020 u-blox Cambourne Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+    http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef CELLULAR_CFG_OVERRIDE
+# include "cellular_cfg_override.h" // For a customer's configuration override
+#endif
+#include "cellular_cfg_os_platform_specific.h"
+#include "cellular_port_clib.h"
+#include "cellular_port.h"
+
+#include "pthread.h"
+#include "time.h" // For clock_gettime()
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** The things the entry point thread needs to know.
+ */
+typedef struct {
+    void (*pEntryPoint)(void *);
+    void *pParameter;
+} CellularPortEntryPoint_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// The thread that runs the entry point.
+static void *entryPointThread(void *pParam)
+{
+    CellularPortEntryPoint_t *pEntryPoint = (CellularPortEntryPoint_t *) pParam;
+
+    pEntryPoint->pEntryPoint(pEntryPoint->pParameter);
+
+    return NULL;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Start the platform.
+int32_t cellularPortPlatformStart(void (*pEntryPoint)(void *),
+                                  void *pParameter,
+                                  size_t stackSizeBytes,
+                                  int32_t priority)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortEntryPoint_t entryPoint;
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    // Priority is not applied on this platform,
+    // see cellular_cfg_os_platform_specific.h
+    (void) priority;
+
+    if (pEntryPoint != NULL) {
+        errorCode = CELLULAR_PORT_PLATFORM_ERROR;
+        entryPoint.pEntryPoint = pEntryPoint;
+        entryPoint.pParameter = pParameter;
+        if (stackSizeBytes < CELLULAR_PORT_OS_STACK_SIZE_MIN_BYTES) {
+            stackSizeBytes = CELLULAR_PORT_OS_STACK_SIZE_MIN_BYTES;
+        }
+        // There's no scheduler to start, the "OS" is already
+        // running: simply run pEntryPoint in a thread of its
+        // own, so that it gets the stack size asked for, and
+        // wait for it to finish
+        if (pthread_attr_init(&attr) == 0) {
+            if ((pthread_attr_setstacksize(&attr, stackSizeBytes) == 0) &&
+                (pthread_create(&thread, &attr, entryPointThread,
+                                &entryPoint) == 0)) {
+                pthread_join(thread, NULL);
+                errorCode = CELLULAR_PORT_SUCCESS;
+            }
+            pthread_attr_destroy(&attr);
+        }
+    }
+
+    return errorCode;
+}
+
+// Initialise the porting layer.
+int32_t cellularPortInit()
+{
+    // Nothing to do
+    return CELLULAR_PORT_SUCCESS;
+}
+
+// Deinitialise the porting layer.
+void cellularPortDeinit()
+{
+    // Nothing to do
+}
+
+// Get the current tick converted to a time in milliseconds.
+int64_t cellularPortGetTickTimeMs()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (((int64_t) now.tv_sec) * 1000) + (now.tv_nsec / 1000000);
+}
+
+// End of file
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2020 u-blox Cambourne Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+    http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef CELLULAR_CFG_OVERRIDE
+# include "cellular_cfg_override.h" // For a customer's configuration override
+#endif
+#include "cellular_port_clib.h"
+#include "cellular_port.h"
+#include "cellular_port_gpio.h"
+
+#include "stdlib.h" // For getenv()
+#include "unistd.h" // For close()
+#include "fcntl.h" // For open()
+#include "sys/mman.h" // For mmap()
+#include "pthread.h"
+
+/* A host has no GPIOs so this is a shim which holds the state of
+ * each "pin" in memory: an output pin reads back the level it was
+ * last set to, an input pin reads back the level of its pull
+ * (high for pull-up, otherwise low).  As with real hardware the
+ * level of a pin may be set before it is made an output.
+ *
+ * So that something playing the part of a cellular module, e.g.
+ * the modem simulator in port/platform/linux/sim, can see and
+ * drive the pins, if the environment variable CELLULAR_PORT_GPIO
+ * names a file of at least 2 * CELLULAR_PORT_GPIO_MAX_NUM bytes
+ * then that file is mapped into memory as the "wires": the first
+ * CELLULAR_PORT_GPIO_MAX_NUM bytes carry the level set on each
+ * pin by this side, the second CELLULAR_PORT_GPIO_MAX_NUM bytes
+ * the level the far end is driving onto each pin, 0 or 1, or
+ * CELLULAR_PORT_GPIO_NOT_DRIVEN if the far end leaves it alone,
+ * in which case an input pin reads back the level of its pull
+ * as before.
+ */
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+// The number of GPIOs supported, which is the range of the
+// "pin" parameter on this platform.
+#define CELLULAR_PORT_GPIO_MAX_NUM 64
+
+// The name of the environment variable that may name a file
+// shared with the far end of the pins.
+#define CELLULAR_PORT_GPIO_ENV "CELLULAR_PORT_GPIO"
+
+// The value in the far end's half of the shared file that means
+// the far end is not driving a pin.
+#define CELLULAR_PORT_GPIO_NOT_DRIVEN 0xFF
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** The state of a GPIO.
+ */
+typedef struct {
+    CellularPortGpioDirection_t direction;
+    CellularPortGpioPullMode_t pullMode;
+    int32_t level;
+} CellularPortGpioState_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+// Mutex to protect the GPIO state.
+static pthread_mutex_t gMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// The state of all the GPIOs, initially no direction and low.
+static CellularPortGpioState_t gGpio[CELLULAR_PORT_GPIO_MAX_NUM];
+
+// The file shared with the far end, if there is one.
+static volatile uint8_t *gpShared = NULL;
+
+// Set once a look for the shared file has been made.
+static bool gSharedChecked = false;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Map in the file shared with the far end, if there is one;
+// must be called with gMutex locked.
+static void sharedInit()
+{
+    const char *pFileName;
+    void *pMapped;
+    int fd;
+
+    if (!gSharedChecked) {
+        gSharedChecked = true;
+        pFileName = getenv(CELLULAR_PORT_GPIO_ENV);
+        if (pFileName != NULL) {
+            fd = open(pFileName, O_RDWR);
+            if (fd >= 0) {
+                pMapped = mmap(NULL, CELLULAR_PORT_GPIO_MAX_NUM * 2,
+                               PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                if (pMapped != MAP_FAILED) {
+                    gpShared = (volatile uint8_t *) pMapped;
+                    for (size_t x = 0; x < CELLULAR_PORT_GPIO_MAX_NUM; x++) {
+                        gpShared[x] = (uint8_t) gGpio[x].level;
+                    }
+                }
+                close(fd);
+            }
+        }
+    }
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Configure a GPIO.
+int32_t cellularPortGpioConfig(CellularPortGpioConfig_t *pConfig)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+
+    if ((pConfig != NULL) && (pConfig->pin >= 0) &&
+        (pConfig->pin < CELLULAR_PORT_GPIO_MAX_NUM) &&
+        (pConfig->direction < MAX_NUM_CELLULAR_PORT_GPIO_DIRECTIONS) &&
+        (pConfig->pullMode < MAX_NUM_CELLULAR_PORT_GPIO_PULL_MODES) &&
+        (pConfig->driveMode < MAX_NUM_CELLULAR_PORT_GPIO_DRIVE_MODES) &&
+        (pConfig->driveCapability < MAX_NUM_CELLULAR_PORT_GPIO_DRIVE_CAPABILITIES)) {
+        pthread_mutex_lock(&gMutex);
+        sharedInit();
+        gGpio[pConfig->pin].direction = pConfig->direction;
+        gGpio[pConfig->pin].pullMode = pConfig->pullMode;
+        pthread_mutex_unlock(&gMutex);
+        errorCode = CELLULAR_PORT_SUCCESS;
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Set the state of a GPIO.
+int32_t cellularPortGpioSet(int32_t pin, int32_t level)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+
+    if ((pin >= 0) && (pin < CELLULAR_PORT_GPIO_MAX_NUM)) {
+        pthread_mutex_lock(&gMutex);
+        sharedInit();
+        gGpio[pin].level = (level != 0);
+        if (gpShared != NULL) {
+            gpShared[pin] = (uint8_t) gGpio[pin].level;
+        }
+        pthread_mutex_unlock(&gMutex);
+        errorCode = CELLULAR_PORT_SUCCESS;
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Get the state of a GPIO.
+int32_t cellularPortGpioGet(int32_t pin)
+{
+    int32_t levelOrErrorCode = CELLULAR_PORT_INVALID_PARAMETER;
+
+    if ((pin >= 0) && (pin < CELLULAR_PORT_GPIO_MAX_NUM)) {
+        pthread_mutex_lock(&gMutex);
+        sharedInit();
+        switch (gGpio[pin].direction) {
+            case CELLULAR_PORT_GPIO_DIRECTION_OUTPUT:
+            case CELLULAR_PORT_GPIO_DIRECTION_INPUT_OUTPUT:
+                levelOrErrorCode = gGpio[pin].level;
+            break;
+            default:
+                if ((gpShared != NULL) &&
+                    (gpShared[CELLULAR_PORT_GPIO_MAX_NUM + pin] != CELLULAR_PORT_GPIO_NOT_DRIVEN)) {
+                    levelOrErrorCode = (gpShared[CELLULAR_PORT_GPIO_MAX_NUM + pin] != 0);
+                } else {
+                    levelOrErrorCode = (gGpio[pin].pullMode ==
+                                        CELLULAR_PORT_GPIO_PULL_MODE_PULL_UP);
+                }
+            break;
+        }
+        pthread_mutex_unlock(&gMutex);
+    }
+
+    return levelOrErrorCode;
+}
+
+// End of file
@@ -0,0 +1,527 @@
+/*
+ * Copyright 2020 u-blox Cambourne Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+    http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef CELLULAR_CFG_OVERRIDE
+# include "cellular_cfg_override.h" // For a customer's configuration override
+#endif
+#include "cellular_cfg_os_platform_specific.h"
+#include "cellular_port_clib.h"
+#include "cellular_port.h"
+#include "cellular_port_os.h"
+#include "cellular_port_private.h"
+
+#include "stdlib.h" // For malloc() and free()
+#include "string.h" // For memcpy()
+#include "pthread.h"
+#include "time.h" // For clock_gettime() and nanosleep()
+#include "errno.h" // For EINTR
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** The things a task needs to know to get started.
+ */
+typedef struct {
+    void (*pFunction)(void *);
+    void *pParameter;
+} CellularPortOsTask_t;
+
+/** A queue: a ring of items protected by a pthread mutex with
+ * condition variables to wait on for "not empty" and "not full".
+ */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+    size_t itemSizeBytes;
+    size_t queueLength;
+    size_t count;
+    size_t readIndex;
+    char *pBuffer;
+} CellularPortOsQueue_t;
+
+/** A mutex.  This is not a pthread mutex as FreeRTOS
+ * semantics are required: a mutex may be taken with a timeout
+ * and is not recursive.
+ */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t notLocked;
+    bool locked;
+} CellularPortOsMutex_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// The function that every task starts in.
+static void *taskStart(void *pParam)
+{
+    CellularPortOsTask_t task = *((CellularPortOsTask_t *) pParam);
+
+    free(pParam);
+    task.pFunction(task.pParameter);
+
+    return NULL;
+}
+
+// Initialise a condition variable that waits on the monotonic clock.
+static bool condInit(pthread_cond_t *pCond)
+{
+    bool success = false;
+    pthread_condattr_t attr;
+
+    if (pthread_condattr_init(&attr) == 0) {
+        if ((pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) == 0) &&
+            (pthread_cond_init(pCond, &attr) == 0)) {
+            success = true;
+        }
+        pthread_condattr_destroy(&attr);
+    }
+
+    return success;
+}
+
+// Work out the absolute monotonic time that is waitMs from now.
+static void deadlineFromNow(struct timespec *pDeadline, int32_t waitMs)
+{
+    clock_gettime(CLOCK_MONOTONIC, pDeadline);
+    if (waitMs < 0) {
+        waitMs = 0;
+    }
+    pDeadline->tv_sec += waitMs / 1000;
+    pDeadline->tv_nsec += (waitMs % 1000) * 1000000L;
+    if (pDeadline->tv_nsec >= 1000000000L) {
+        pDeadline->tv_sec++;
+        pDeadline->tv_nsec -= 1000000000L;
+    }
+}
+
+// Wait for an item to arrive on a queue and take it; if
+// pDeadline is NULL wait forever.  Returns true on success.
+static bool queueReceive(CellularPortOsQueue_t *pQueue,
+                         void *pEventData,
+                         const struct timespec *pDeadline)
+{
+    bool success = false;
+    int32_t waitResult = 0;
+
+    pthread_mutex_lock(&(pQueue->mutex));
+    while ((pQueue->count == 0) && (waitResult == 0)) {
+        if (pDeadline != NULL) {
+            waitResult = pthread_cond_timedwait(&(pQueue->notEmpty),
+                                                &(pQueue->mutex),
+                                                pDeadline);
+        } else {
+            pthread_cond_wait(&(pQueue->notEmpty), &(pQueue->mutex));
+        }
+    }
+    if (pQueue->count > 0) {
+        memcpy(pEventData,
+               pQueue->pBuffer + (pQueue->readIndex * pQueue->itemSizeBytes),
+               pQueue->itemSizeBytes);
+        pQueue->readIndex++;
+        if (pQueue->readIndex >= pQueue->queueLength) {
+            pQueue->readIndex = 0;
+        }
+        pQueue->count--;
+        pthread_cond_signal(&(pQueue->notFull));
+        success = true;
+    }
+    pthread_mutex_unlock(&(pQueue->mutex));
+
+    return success;
+}
+
+// Take a mutex; if pDeadline is NULL wait forever.
+// Returns true on success.
+static bool mutexTake(CellularPortOsMutex_t *pMutex,
+                      const struct timespec *pDeadline)
+{
+    bool success = false;
+    int32_t waitResult = 0;
+
+    pthread_mutex_lock(&(pMutex->mutex));
+    while (pMutex->locked && (waitResult == 0)) {
+        if (pDeadline != NULL) {
+            waitResult = pthread_cond_timedwait(&(pMutex->notLocked),
+                                                &(pMutex->mutex),
+                                                pDeadline);
+        } else {
+            pthread_cond_wait(&(pMutex->notLocked), &(pMutex->mutex));
+        }
+    }
+    if (!pMutex->locked) {
+        pMutex->locked = true;
+        success = true;
+    }
+    pthread_mutex_unlock(&(pMutex->mutex));
+
+    return success;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: TASKS
+ * -------------------------------------------------------------- */
+
+// Create a task.
+int32_t cellularPortTaskCreate(void (*pFunction)(void *),
+                               const char *pName,
+                               size_t stackSizeBytes,
+                               void *pParameter,
+                               int32_t priority,
+                               CellularPortTaskHandle_t *pTaskHandle)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortOsTask_t *pTask;
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    // Priority is not applied on this platform,
+    // see cellular_cfg_os_platform_specific.h
+    (void) priority;
+    (void) pName;
+
+    if ((pFunction != NULL) && (pTaskHandle != NULL)) {
+        errorCode = CELLULAR_PORT_OUT_OF_MEMORY;
+        pTask = (CellularPortOsTask_t *) malloc(sizeof(*pTask));
+        if (pTask != NULL) {
+            errorCode = CELLULAR_PORT_PLATFORM_ERROR;
+            pTask->pFunction = pFunction;
+            pTask->pParameter = pParameter;
+            if (stackSizeBytes < CELLULAR_PORT_OS_STACK_SIZE_MIN_BYTES) {
+                stackSizeBytes = CELLULAR_PORT_OS_STACK_SIZE_MIN_BYTES;
+            }
+            if (pthread_attr_init(&attr) == 0) {
+                // Tasks delete themselves, nothing ever joins
+                // them, so they must be detached
+                if ((pthread_attr_setstacksize(&attr, stackSizeBytes) == 0) &&
+                    (pthread_attr_setdetachstate(&attr,
+                                                 PTHREAD_CREATE_DETACHED) == 0) &&
+                    (pthread_create(&thread, &attr, taskStart, pTask) == 0)) {
+                    *pTaskHandle = (CellularPortTaskHandle_t) thread;
+                    errorCode = CELLULAR_PORT_SUCCESS;
+                }
+                pthread_attr_destroy(&attr);
+            }
+            if (errorCode != CELLULAR_PORT_SUCCESS) {
+                free(pTask);
+            }
+        }
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Delete the given task.
+int32_t cellularPortTaskDelete(const CellularPortTaskHandle_t taskHandle)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+
+    // Can only delete oneself, as in FreeRTOS
+    if (taskHandle == NULL) {
+        pthread_exit(NULL);
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Check if the current task handle is equal to the given task handle.
+bool cellularPortTaskIsThis(const CellularPortTaskHandle_t taskHandle)
+{
+    return pthread_equal(pthread_self(), (pthread_t) taskHandle) != 0;
+}
+
+// Block the current task for a time.
+void cellularPortTaskBlock(int32_t delayMs)
+{
+    struct timespec deadline;
+
+    // Sleep to an absolute time so that being
+    // interrupted by a signal doesn't stretch it
+    deadlineFromNow(&deadline, delayMs);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+                           &deadline, NULL) == EINTR) {}
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: QUEUES
+ * -------------------------------------------------------------- */
+
+// Create a queue.
+int32_t cellularPortQueueCreate(size_t queueLength,
+                                size_t itemSizeBytes,
+                                CellularPortQueueHandle_t *pQueueHandle)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortOsQueue_t *pQueue;
+
+    if ((pQueueHandle != NULL) && (queueLength > 0) && (itemSizeBytes > 0)) {
+        errorCode = CELLULAR_PORT_OUT_OF_MEMORY;
+        pQueue = (CellularPortOsQueue_t *) malloc(sizeof(*pQueue));
+        if (pQueue != NULL) {
+            pQueue->pBuffer = (char *) malloc(queueLength * itemSizeBytes);
+            if (pQueue->pBuffer != NULL) {
+                errorCode = CELLULAR_PORT_PLATFORM_ERROR;
+                pQueue->itemSizeBytes = itemSizeBytes;
+                pQueue->queueLength = queueLength;
+                pQueue->count = 0;
+                pQueue->readIndex = 0;
+                if (pthread_mutex_init(&(pQueue->mutex), NULL) == 0) {
+                    if (condInit(&(pQueue->notEmpty))) {
+                        if (condInit(&(pQueue->notFull))) {
+                            *pQueueHandle = (CellularPortQueueHandle_t) pQueue;
+                            errorCode = CELLULAR_PORT_SUCCESS;
+                        } else {
+                            pthread_cond_destroy(&(pQueue->notEmpty));
+                        }
+                    }
+                    if (errorCode != CELLULAR_PORT_SUCCESS) {
+                        pthread_mutex_destroy(&(pQueue->mutex));
+                    }
+                }
+                if (errorCode != CELLULAR_PORT_SUCCESS) {
+                    free(pQueue->pBuffer);
+                }
+            }
+            if (errorCode != CELLULAR_PORT_SUCCESS) {
+                free(pQueue);
+            }
+        }
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Delete the given queue.
+int32_t cellularPortQueueDelete(const CellularPortQueueHandle_t queueHandle)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortOsQueue_t *pQueue = (CellularPortOsQueue_t *) queueHandle;
+
+    if (pQueue != NULL) {
+        pthread_cond_destroy(&(pQueue->notFull));
+        pthread_cond_destroy(&(pQueue->notEmpty));
+        pthread_mutex_destroy(&(pQueue->mutex));
+        free(pQueue->pBuffer);
+        free(pQueue);
+        errorCode = CELLULAR_PORT_SUCCESS;
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Send to the given queue.
+int32_t cellularPortQueueSend(const CellularPortQueueHandle_t queueHandle,
+                              const void *pEventData)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortOsQueue_t *pQueue = (CellularPortOsQueue_t *) queueHandle;
+    size_t writeIndex;
+
+    if ((pQueue != NULL) && (pEventData != NULL)) {
+        pthread_mutex_lock(&(pQueue->mutex));
+        while (pQueue->count >= pQueue->queueLength) {
+            pthread_cond_wait(&(pQueue->notFull), &(pQueue->mutex));
+        }
+        writeIndex = pQueue->readIndex + pQueue->count;
+        if (writeIndex >= pQueue->queueLength) {
+            writeIndex -= pQueue->queueLength;
+        }
+        memcpy(pQueue->pBuffer + (writeIndex * pQueue->itemSizeBytes),
+               pEventData, pQueue->itemSizeBytes);
+        pQueue->count++;
+        pthread_cond_signal(&(pQueue->notEmpty));
+        pthread_mutex_unlock(&(pQueue->mutex));
+        errorCode = CELLULAR_PORT_SUCCESS;
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Send to the given queue, failing rather than blocking if it is full.
+int32_t cellularPortPrivateQueueSendNoWait(const CellularPortQueueHandle_t queueHandle,
+                                           const void *pEventData)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortOsQueue_t *pQueue = (CellularPortOsQueue_t *) queueHandle;
+    size_t writeIndex;
+
+    if ((pQueue != NULL) && (pEventData != NULL)) {
+        errorCode = CELLULAR_PORT_OUT_OF_MEMORY;
+        pthread_mutex_lock(&(pQueue->mutex));
+        if (pQueue->count < pQueue->queueLength) {
+            writeIndex = pQueue->readIndex + pQueue->count;
+            if (writeIndex >= pQueue->queueLength) {
+                writeIndex -= pQueue->queueLength;
+            }
+            memcpy(pQueue->pBuffer + (writeIndex * pQueue->itemSizeBytes),
+                   pEventData, pQueue->itemSizeBytes);
+            pQueue->count++;
+            pthread_cond_signal(&(pQueue->notEmpty));
+            errorCode = CELLULAR_PORT_SUCCESS;
+        }
+        pthread_mutex_unlock(&(pQueue->mutex));
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Receive from the given queue, blocking.
+int32_t cellularPortQueueReceive(const CellularPortQueueHandle_t queueHandle,
+                                 void *pEventData)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+
+    if ((queueHandle != NULL) && (pEventData != NULL)) {
+        errorCode = CELLULAR_PORT_PLATFORM_ERROR;
+        if (queueReceive((CellularPortOsQueue_t *) queueHandle,
+                         pEventData, NULL)) {
+            errorCode = CELLULAR_PORT_SUCCESS;
+        }
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Receive from the given queue, with a wait time.
+int32_t cellularPortQueueTryReceive(const CellularPortQueueHandle_t queueHandle,
+                                    int32_t waitMs, void *pEventData)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    struct timespec deadline;
+
+    if ((queueHandle != NULL) && (pEventData != NULL)) {
+        errorCode = CELLULAR_PORT_TIMEOUT;
+        deadlineFromNow(&deadline, waitMs);
+        if (queueReceive((CellularPortOsQueue_t *) queueHandle,
+                         pEventData, &deadline)) {
+            errorCode = CELLULAR_PORT_SUCCESS;
+        }
+    }
+
+    return (int32_t) errorCode;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: MUTEXES
+ * -------------------------------------------------------------- */
+
+// Create a mutex.
+int32_t cellularPortMutexCreate(CellularPortMutexHandle_t *pMutexHandle)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortOsMutex_t *pMutex;
+
+    if (pMutexHandle != NULL) {
+        errorCode = CELLULAR_PORT_OUT_OF_MEMORY;
+        pMutex = (CellularPortOsMutex_t *) malloc(sizeof(*pMutex));
+        if (pMutex != NULL) {
+            errorCode = CELLULAR_PORT_PLATFORM_ERROR;
+            pMutex->locked = false;
+            if (pthread_mutex_init(&(pMutex->mutex), NULL) == 0) {
+                if (condInit(&(pMutex->notLocked))) {
+                    *pMutexHandle = (CellularPortMutexHandle_t) pMutex;
+                    errorCode = CELLULAR_PORT_SUCCESS;
+                } else {
+                    pthread_mutex_destroy(&(pMutex->mutex));
+                }
+            }
+            if (errorCode != CELLULAR_PORT_SUCCESS) {
+                free(pMutex);
+            }
+        }
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Destroy a mutex.
+int32_t cellularPortMutexDelete(const CellularPortMutexHandle_t mutexHandle)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortOsMutex_t *pMutex = (CellularPortOsMutex_t *) mutexHandle;
+
+    if (pMutex != NULL) {
+        pthread_cond_destroy(&(pMutex->notLocked));
+        pthread_mutex_destroy(&(pMutex->mutex));
+        free(pMutex);
+        errorCode = CELLULAR_PORT_SUCCESS;
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Lock the given mutex.
+int32_t cellularPortMutexLock(const CellularPortMutexHandle_t mutexHandle)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+
+    if (mutexHandle != NULL) {
+        errorCode = CELLULAR_PORT_PLATFORM_ERROR;
+        if (mutexTake((CellularPortOsMutex_t *) mutexHandle, NULL)) {
+            errorCode = CELLULAR_PORT_SUCCESS;
+        }
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Try to lock the given mutex.
+int32_t cellularPortMutexTryLock(const CellularPortMutexHandle_t mutexHandle,
+                                 int32_t delayMs)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    struct timespec deadline;
+
+    if (mutexHandle != NULL) {
+        errorCode = CELLULAR_PORT_TIMEOUT;
+        deadlineFromNow(&deadline, delayMs);
+        if (mutexTake((CellularPortOsMutex_t *) mutexHandle, &deadline)) {
+            errorCode = CELLULAR_PORT_SUCCESS;
+        }
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Unlock the given mutex.
+int32_t cellularPortMutexUnlock(const CellularPortMutexHandle_t mutexHandle)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortOsMutex_t *pMutex = (CellularPortOsMutex_t *) mutexHandle;
+
+    if (pMutex != NULL) {
+        pthread_mutex_lock(&(pMutex->mutex));
+        pMutex->locked = false;
+        pthread_cond_signal(&(pMutex->notLocked));
+        pthread_mutex_unlock(&(pMutex->mutex));
+        errorCode = CELLULAR_PORT_SUCCESS;
+    }
+
+    return (int32_t) errorCode;
+}
+
+// End of file
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2020 u-blox Cambourne Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+    http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _CELLULAR_PORT_PRIVATE_H_
+#define _CELLULAR_PORT_PRIVATE_H_
+
+/** Stuff private to the Linux porting layer.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Send to the given queue without blocking, the equivalent
+ * of xQueueSendFromISR() on a FreeRTOS platform: if the queue
+ * is full the send fails rather than waiting for room.
+ *
+ * @param queueHandle  the handle of the queue.
+ * @param pEventData   pointer to the data to send.
+ * @return             zero on success else negative error code.
+ */
+int32_t cellularPortPrivateQueueSendNoWait(const CellularPortQueueHandle_t queueHandle,
+                                           const void *pEventData);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _CELLULAR_PORT_PRIVATE_H_
+
+// End of file
@@ -0,0 +1,999 @@
+/*
+ * Copyright 2020 u-blox Cambourne Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+    http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// For posix_openpt(), ptsname(), cfmakeraw() and pipe2()
+#define _GNU_SOURCE
+
+#ifdef CELLULAR_CFG_OVERRIDE
+# include "cellular_cfg_override.h" // For a customer's configuration override
+#endif
+#include "cellular_cfg_sw.h"
+#include "cellular_port_debug.h"
+#include "cellular_port_clib.h"
+#include "cellular_port.h"
+#include "cellular_port_os.h"
+#include "cellular_port_uart.h"
+#include "cellular_port_private.h"
+
+#include "stdlib.h" // For malloc(), free(), getenv() and the pty functions
+#include "stdio.h" // For snprintf()
+#include "string.h" // For strtok_r() and strncmp()
+#include "time.h" // For clock_gettime() and nanosleep()
+#include "unistd.h" // For read(), write(), close() and pipe2()
+#include "fcntl.h" // For open()
+#include "poll.h"
+#include "termios.h"
+#include "errno.h"
+#include "pthread.h"
+
+/* A UART on a host is a file descriptor, which can be one of:
+ *
+ * - a loop-back: if pinTx and pinRx are given the same value
+ *   then the UART is wired back to itself through a pipe, which
+ *   is what the UART port test uses,
+ * - a device: if the environment variable CELLULAR_PORT_UARTx,
+ *   where x is the uart number, is set then the device it names
+ *   is opened, e.g. /dev/ttyUSB0 to reach a real module through
+ *   a USB to serial converter or the slave side of a
+ *   pseudo-terminal created by a modem simulator,
+ * - a pseudo-terminal: otherwise a pseudo-terminal is created
+ *   and the name of its slave side logged, so that something
+ *   else may open it and play the part of the module.
+ *
+ * A receive thread per UART waits on the file descriptor and
+ * copies whatever arrives into the receive ring buffer which
+ * the user empties with cellularPortUartRead(), the receive
+ * thread sending a single event to the UART event queue when
+ * new data arrives and the user has read everything, just as
+ * the interrupt handlers of the MCU ports do.  Writes block
+ * until the data has been handed to the operating system or
+ * until CELLULAR_PORT_UART_TX_TIMEOUT_MS passes without the
+ * other end taking any.
+ *
+ * Left to itself a file descriptor moves data at memory speed,
+ * which hides the serial bottleneck of a real UART.  If the
+ * environment variable CELLULAR_PORT_UART_TIMING is set, even to
+ * an empty string, the timing of a real UART is emulated in both
+ * directions: each character takes 10 bits (start, 8 data, stop)
+ * at the baud rate, no character is handed over before it would
+ * have arrived, writes block until the last character would have
+ * left and received characters that find the receive FIFO full
+ * are lost (an overrun) unless RTS flow control is on, in which
+ * case the far end is held off.  The variable may contain a
+ * comma-separated list of:
+ *
+ * - baud=<rate>: use this baud rate instead of the one passed
+ *   to cellularPortUartInit(),
+ * - gap=<bits>: an idle gap of this many bit periods between
+ *   characters,
+ * - cts=<ms>/<period ms>: the far end drops CTS for <ms> out of
+ *   every <period ms>, stalling transmission,
+ * - fifo=<bytes>: the depth of the receive FIFO, at most
+ *   CELLULAR_PORT_UART_RX_BUFFER_SIZE, which is the default.
+ *
+ * For instance CELLULAR_PORT_UART_TIMING=gap=2,fifo=256.  The
+ * number of bytes sent, received and lost is logged when the UART
+ * is closed so that the cost of the AT overhead can be measured.
+ */
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+// The maximum number of UARTs supported, which is the range of the
+// "uart" parameter on this platform.
+#define CELLULAR_PORT_UART_MAX_NUM 4
+
+// The prefix of the environment variable that names the device
+// behind a UART, the UART number being appended.
+#define CELLULAR_PORT_UART_DEVICE_ENV_PREFIX "CELLULAR_PORT_UART"
+
+// How long the receive thread waits for data in one go, which
+// is also how long it may take for cellularPortUartDeinit() to
+// stop the thread.
+#define CELLULAR_PORT_UART_RX_POLL_INTERVAL_MS 10
+
+// The name of the environment variable that switches on the
+// emulation of UART timing.
+#define CELLULAR_PORT_UART_TIMING_ENV "CELLULAR_PORT_UART_TIMING"
+
+// The number of bits in a character on the wire: start bit,
+// eight data bits and a stop bit.
+#define CELLULAR_PORT_UART_BITS_PER_CHARACTER 10
+
+// The number of characters read from the file descriptor in one
+// go when emulating UART timing, i.e. those "on the wire", which
+// are then handed over one character time apart.
+#define CELLULAR_PORT_UART_WIRE_SIZE_BYTES 64
+
+// The most that the receive thread or a write sleeps in one go
+// when emulating UART timing, in nanoseconds.
+#define CELLULAR_PORT_UART_TIMING_TICK_NS 1000000LL
+
+// How long a write may wait for the other end to take some data
+// before giving up, e.g. when nothing has opened the slave side
+// of a pseudo-terminal.
+#define CELLULAR_PORT_UART_TX_TIMEOUT_MS 1000
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** The UART event queue data: since we only need to send
+ * size or error then on this platform the
+ * CellularPortUartEventData_t can simply be an int32_t.
+ */
+typedef int32_t CellularPortUartEventData_t;
+
+/** Structure of the data per UART.
+ */
+typedef struct {
+    int32_t number;
+    CellularPortMutexHandle_t mutex;
+    CellularPortQueueHandle_t queue;
+    pthread_mutex_t txMutex; //!< separate from mutex so that a
+                             // blocked write can't hold up
+                             // the receive thread.
+    int readFd;
+    int writeFd;
+    int ptySlaveFd; //!< -1 unless a pseudo-terminal was created.
+    pthread_t rxThread;
+    volatile bool rxThreadStop;
+    char *pRxBufferStart;
+    char *pRxBufferRead;
+    char *pRxBufferWrite;
+    bool userNeedsNotify; //!< set this if toRead has hit zero and
+                          // hence the user would like a notification
+                          // when new data arrives.
+    bool ctsFlowControl;
+    bool rtsFlowControl;
+    bool timed; //!< true if UART timing is being emulated,
+                // in which case the fields below apply.
+    int64_t characterTimeNs;
+    int32_t ctsStallMs;
+    int32_t ctsPeriodMs;
+    size_t rxFifoSizeBytes;
+    int64_t startTimeNs;
+    int64_t txLineFreeNs; //!< when the last character sent is gone.
+    int64_t rxLineFreeNs; //!< when the last character received arrived.
+    char rxWire[CELLULAR_PORT_UART_WIRE_SIZE_BYTES];
+    size_t rxWireStart;
+    size_t rxWireLength;
+    size_t txBytes;
+    size_t rxBytes;
+    size_t rxOverrunBytes;
+} CellularPortUartData_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+// The UARTs that are in use.
+static CellularPortUartData_t *gpUartData[CELLULAR_PORT_UART_MAX_NUM] = {NULL};
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Find a UART's data.
+static CellularPortUartData_t *pGetUart(int32_t uart)
+{
+    CellularPortUartData_t *pUartData = NULL;
+
+    if ((uart >= 0) && (uart < CELLULAR_PORT_UART_MAX_NUM)) {
+        pUartData = gpUartData[uart];
+    }
+
+    return pUartData;
+}
+
+// Convert a baud rate into a termios speed, returning
+// B0 if there is no match.
+static speed_t baudToSpeed(int32_t baudRate)
+{
+    speed_t speed = B0;
+
+    switch (baudRate) {
+        case 9600:
+            speed = B9600;
+        break;
+        case 19200:
+            speed = B19200;
+        break;
+        case 38400:
+            speed = B38400;
+        break;
+        case 57600:
+            speed = B57600;
+        break;
+        case 115200:
+            speed = B115200;
+        break;
+        case 230400:
+            speed = B230400;
+        break;
+        case 460800:
+            speed = B460800;
+        break;
+        case 921600:
+            speed = B921600;
+        break;
+        default:
+        break;
+    }
+
+    return speed;
+}
+
+// Put a terminal into raw mode and, if speed is not
+// B0, set its speed and flow control.
+static bool setRaw(int fd, speed_t speed, bool flowControl)
+{
+    bool success = false;
+    struct termios config;
+
+    if (tcgetattr(fd, &config) == 0) {
+        cfmakeraw(&config);
+        config.c_cflag |= CLOCAL | CREAD;
+        if (speed != B0) {
+            cfsetispeed(&config, speed);
+            cfsetospeed(&config, speed);
+            config.c_cflag &= ~CRTSCTS;
+            if (flowControl) {
+                config.c_cflag |= CRTSCTS;
+            }
+        }
+        success = (tcsetattr(fd, TCSANOW, &config) == 0);
+    }
+
+    return success;
+}
+
+// Get the monotonic time in nanoseconds.
+static int64_t timeNowNs()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((int64_t) now.tv_sec * 1000000000LL) + now.tv_nsec;
+}
+
+// Sleep until the given monotonic time in nanoseconds.
+static void sleepUntilNs(int64_t timeNs)
+{
+    struct timespec until;
+
+    until.tv_sec = timeNs / 1000000000LL;
+    until.tv_nsec = timeNs % 1000000000LL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+                           &until, NULL) == EINTR) {}
+}
+
+// Set up the emulation of UART timing from the environment
+// variable CELLULAR_PORT_UART_TIMING, if it is set.
+static CellularPortErrorCode_t timingInit(CellularPortUartData_t *pUartData,
+                                          int32_t baudRate)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_SUCCESS;
+    const char *pEnv = getenv(CELLULAR_PORT_UART_TIMING_ENV);
+    char buffer[128];
+    char *pSave = NULL;
+    char *pItem;
+    int32_t gapBits = 0;
+    int32_t x;
+    int32_t y;
+
+    if (pEnv != NULL) {
+        pUartData->rxFifoSizeBytes = CELLULAR_PORT_UART_RX_BUFFER_SIZE;
+        snprintf(buffer, sizeof(buffer), "%s", pEnv);
+        for (pItem = strtok_r(buffer, ",", &pSave);
+             (pItem != NULL) && (errorCode == 0);
+             pItem = strtok_r(NULL, ",", &pSave)) {
+            if (sscanf(pItem, "baud=%d", &x) == 1) {
+                baudRate = x;
+            } else if (sscanf(pItem, "gap=%d", &x) == 1) {
+                gapBits = x;
+            } else if (sscanf(pItem, "cts=%d/%d", &x, &y) == 2) {
+                pUartData->ctsStallMs = x;
+                pUartData->ctsPeriodMs = y;
+            } else if (sscanf(pItem, "fifo=%d", &x) == 1) {
+                pUartData->rxFifoSizeBytes = x;
+            } else {
+                errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+            }
+        }
+        if ((baudRate <= 0) || (gapBits < 0) ||
+            (pUartData->ctsStallMs < 0) ||
+            ((pUartData->ctsStallMs > 0) &&
+             (pUartData->ctsStallMs >= pUartData->ctsPeriodMs)) ||
+            (pUartData->rxFifoSizeBytes < 2) ||
+            (pUartData->rxFifoSizeBytes > CELLULAR_PORT_UART_RX_BUFFER_SIZE)) {
+            errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+        }
+        if (errorCode == 0) {
+            pUartData->timed = true;
+            pUartData->characterTimeNs = ((CELLULAR_PORT_UART_BITS_PER_CHARACTER + gapBits) *
+                                          1000000000LL) / baudRate;
+            pUartData->startTimeNs = timeNowNs();
+            pUartData->txLineFreeNs = pUartData->startTimeNs;
+            pUartData->rxLineFreeNs = pUartData->startTimeNs;
+            cellularPortLog("CELLULAR_PORT_UART: UART %d emulating %d baud,"
+                            " %d bit gap, CTS stall %d/%d ms, %d byte"
+                            " receive FIFO.\n", pUartData->number,
+                            baudRate, gapBits, pUartData->ctsStallMs,
+                            pUartData->ctsPeriodMs,
+                            (int) pUartData->rxFifoSizeBytes);
+        } else {
+            cellularPortLog("CELLULAR_PORT_UART: %s \"%s\" is not valid.\n",
+                            CELLULAR_PORT_UART_TIMING_ENV, pEnv);
+        }
+    }
+
+    return errorCode;
+}
+
+// If the far end is holding CTS off at the given time,
+// return the time it lets go, else return the given time.
+static int64_t ctsReleaseNs(const CellularPortUartData_t *pUartData,
+                            int64_t timeNs)
+{
+    int64_t periodNs = (int64_t) pUartData->ctsPeriodMs * 1000000LL;
+    int64_t offsetNs;
+
+    if (pUartData->ctsStallMs > 0) {
+        offsetNs = (timeNs - pUartData->startTimeNs) % periodNs;
+        if (offsetNs < (int64_t) pUartData->ctsStallMs * 1000000LL) {
+            timeNs += ((int64_t) pUartData->ctsStallMs * 1000000LL) - offsetNs;
+        }
+    }
+
+    return timeNs;
+}
+
+// Open the thing behind a UART, populating the file descriptors
+// in pUartData.
+static CellularPortErrorCode_t openUart(CellularPortUartData_t *pUartData,
+                                        bool loopback,
+                                        int32_t baudRate)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_PLATFORM_ERROR;
+    char envName[sizeof(CELLULAR_PORT_UART_DEVICE_ENV_PREFIX) + 4];
+    const char *pDevice;
+    int fds[2];
+    int fd;
+
+    if (loopback) {
+        if (pipe2(fds, O_CLOEXEC) == 0) {
+            pUartData->readFd = fds[0];
+            pUartData->writeFd = fds[1];
+            errorCode = CELLULAR_PORT_SUCCESS;
+        }
+    } else {
+        snprintf(envName, sizeof(envName), "%s%d",
+                 CELLULAR_PORT_UART_DEVICE_ENV_PREFIX,
+                 (int) pUartData->number);
+        pDevice = getenv(envName);
+        if (pDevice != NULL) {
+            fd = open(pDevice, O_RDWR | O_NOCTTY | O_CLOEXEC);
+            if (fd >= 0) {
+                // If it's a terminal, make it a raw one,
+                // and set the speed
+                if (!isatty(fd) ||
+                    setRaw(fd, baudToSpeed(baudRate),
+                           pUartData->ctsFlowControl &&
+                           pUartData->rtsFlowControl)) {
+                    pUartData->readFd = fd;
+                    pUartData->writeFd = fd;
+                    errorCode = CELLULAR_PORT_SUCCESS;
+                    cellularPortLog("CELLULAR_PORT_UART: UART %d is %s.\n",
+                                    pUartData->number, pDevice);
+                } else {
+                    close(fd);
+                }
+            }
+        } else {
+            fd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+            if (fd >= 0) {
+                if ((grantpt(fd) == 0) && (unlockpt(fd) == 0)) {
+                    pDevice = ptsname(fd);
+                    // Keep the slave side open ourselves, in raw
+                    // mode, otherwise reads of the master side fail
+                    // whenever nothing else has the slave open
+                    pUartData->ptySlaveFd = open(pDevice,
+                                                 O_RDWR | O_NOCTTY | O_CLOEXEC);
+                    if ((pUartData->ptySlaveFd >= 0) &&
+                        setRaw(pUartData->ptySlaveFd, B0, false)) {
+                        pUartData->readFd = fd;
+                        pUartData->writeFd = fd;
+                        errorCode = CELLULAR_PORT_SUCCESS;
+                        cellularPortLog("CELLULAR_PORT_UART: UART %d is pseudo-terminal %s (set %s%d to use a device instead).\n",
+                                        pUartData->number, pDevice,
+                                        CELLULAR_PORT_UART_DEVICE_ENV_PREFIX,
+                                        pUartData->number);
+                    }
+                }
+                if (errorCode != CELLULAR_PORT_SUCCESS) {
+                    if (pUartData->ptySlaveFd >= 0) {
+                        close(pUartData->ptySlaveFd);
+                        pUartData->ptySlaveFd = -1;
+                    }
+                    close(fd);
+                }
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Close the thing behind a UART.
+static void closeUart(CellularPortUartData_t *pUartData)
+{
+    if (pUartData->writeFd != pUartData->readFd) {
+        close(pUartData->writeFd);
+    }
+    close(pUartData->readFd);
+    if (pUartData->ptySlaveFd >= 0) {
+        close(pUartData->ptySlaveFd);
+    }
+}
+
+// One pass of the receive thread when emulating UART timing:
+// take characters from the file descriptor onto the "wire" and
+// hand over to the receive buffer those that would have arrived
+// by now.
+static void rxTimed(CellularPortUartData_t *pUartData,
+                    struct pollfd *pPollFd)
+{
+    int64_t nowNs;
+    size_t numArrived = 0;
+    size_t used;
+    size_t handedOver = 0;
+    size_t lost = 0;
+    ssize_t thisSize = 0;
+    bool heldOff = false;
+    bool notify = false;
+    CellularPortUartEventData_t uartSizeOrError;
+
+    if (pUartData->rxWireLength == 0) {
+        pUartData->rxWireStart = 0;
+        if ((poll(pPollFd, 1, CELLULAR_PORT_UART_RX_POLL_INTERVAL_MS) > 0) &&
+            (pPollFd->revents & POLLIN)) {
+            thisSize = read(pUartData->readFd, pUartData->rxWire,
+                            sizeof(pUartData->rxWire));
+        }
+        if (thisSize > 0) {
+            pUartData->rxWireLength = thisSize;
+            // If the line was idle, the first character starts now
+            nowNs = timeNowNs();
+            if (pUartData->rxLineFreeNs < nowNs) {
+                pUartData->rxLineFreeNs = nowNs;
+            }
+        } else if ((thisSize < 0) || (pPollFd->revents & (POLLHUP | POLLERR))) {
+            // No-one at the other end: wait a while rather than spinning
+            cellularPortTaskBlock(CELLULAR_PORT_UART_RX_POLL_INTERVAL_MS);
+        }
+    }
+
+    if (pUartData->rxWireLength > 0) {
+        nowNs = timeNowNs();
+        if (nowNs > pUartData->rxLineFreeNs) {
+            numArrived = (nowNs - pUartData->rxLineFreeNs) /
+                         pUartData->characterTimeNs;
+        }
+        if (numArrived > pUartData->rxWireLength) {
+            numArrived = pUartData->rxWireLength;
+        }
+
+        CELLULAR_PORT_MUTEX_LOCK(pUartData->mutex);
+
+        used = pUartData->pRxBufferWrite - pUartData->pRxBufferRead;
+        if (pUartData->pRxBufferWrite < pUartData->pRxBufferRead) {
+            used += CELLULAR_PORT_UART_RX_BUFFER_SIZE;
+        }
+        for (size_t x = 0; (x < numArrived) && !heldOff; x++) {
+            if (used < pUartData->rxFifoSizeBytes - 1) {
+                *pUartData->pRxBufferWrite = pUartData->rxWire[pUartData->rxWireStart];
+                pUartData->pRxBufferWrite++;
+                if (pUartData->pRxBufferWrite >= pUartData->pRxBufferStart +
+                                                 CELLULAR_PORT_UART_RX_BUFFER_SIZE) {
+                    pUartData->pRxBufferWrite = pUartData->pRxBufferStart;
+                }
+                used++;
+                handedOver++;
+            } else if (pUartData->rtsFlowControl) {
+                // RTS is off, the far end holds on to the character
+                heldOff = true;
+            } else {
+                // Overrun
+                lost++;
+            }
+            if (!heldOff) {
+                pUartData->rxWireStart++;
+                pUartData->rxWireLength--;
+                pUartData->rxLineFreeNs += pUartData->characterTimeNs;
+            }
+        }
+        if (handedOver > 0) {
+            notify = pUartData->userNeedsNotify;
+            pUartData->userNeedsNotify = false;
+        }
+        pUartData->rxBytes += handedOver;
+        pUartData->rxOverrunBytes += lost;
+
+        CELLULAR_PORT_MUTEX_UNLOCK(pUartData->mutex);
+
+        if (notify) {
+            uartSizeOrError = handedOver;
+            cellularPortPrivateQueueSendNoWait(pUartData->queue,
+                                               &uartSizeOrError);
+        }
+        if (lost > 0) {
+            cellularPortLog("CELLULAR_PORT_UART: UART %d receive FIFO overrun,"
+                            " %d byte(s) lost.\n", pUartData->number,
+                            (int) lost);
+        }
+        if (heldOff) {
+            // The line is idle until the user makes some room
+            pUartData->rxLineFreeNs = nowNs;
+            sleepUntilNs(nowNs + CELLULAR_PORT_UART_TIMING_TICK_NS);
+        } else if (pUartData->rxWireLength > 0) {
+            // Wait for the next character, or a tick, whichever is sooner
+            nowNs += CELLULAR_PORT_UART_TIMING_TICK_NS;
+            if (pUartData->rxLineFreeNs + pUartData->characterTimeNs < nowNs) {
+                nowNs = pUartData->rxLineFreeNs + pUartData->characterTimeNs;
+            }
+            sleepUntilNs(nowNs);
+        }
+    }
+}
+
+// The receive thread: the equivalent of the UART
+// interrupt on an MCU.
+static void *rxThread(void *pParam)
+{
+    CellularPortUartData_t *pUartData = (CellularPortUartData_t *) pParam;
+    struct pollfd pollFd;
+    char *pRxBufferRead;
+    size_t space;
+    ssize_t thisSize;
+    bool notify;
+    CellularPortUartEventData_t uartSizeOrError;
+
+    pollFd.fd = pUartData->readFd;
+    pollFd.events = POLLIN;
+
+    while (!pUartData->rxThreadStop && pUartData->timed) {
+        rxTimed(pUartData, &pollFd);
+    }
+
+    while (!pUartData->rxThreadStop && !pUartData->timed) {
+        // Work out how much contiguous space there is at
+        // the write pointer, leaving a gap of one so that
+        // a full buffer can be told apart from an empty one;
+        // only the user moves the read pointer and only
+        // this thread moves the write pointer
+        CELLULAR_PORT_MUTEX_LOCK(pUartData->mutex);
+        pRxBufferRead = pUartData->pRxBufferRead;
+        CELLULAR_PORT_MUTEX_UNLOCK(pUartData->mutex);
+        if (pRxBufferRead > pUartData->pRxBufferWrite) {
+            space = pRxBufferRead - pUartData->pRxBufferWrite - 1;
+        } else {
+            space = pUartData->pRxBufferStart +
+                    CELLULAR_PORT_UART_RX_BUFFER_SIZE -
+                    pUartData->pRxBufferWrite;
+            if (pRxBufferRead == pUartData->pRxBufferStart) {
+                space--;
+            }
+        }
+
+        thisSize = 0;
+        if (space > 0) {
+            if ((poll(&pollFd, 1, CELLULAR_PORT_UART_RX_POLL_INTERVAL_MS) > 0) &&
+                (pollFd.revents & POLLIN)) {
+                thisSize = read(pUartData->readFd,
+                                pUartData->pRxBufferWrite, space);
+            }
+        }
+
+        if (thisSize > 0) {
+            CELLULAR_PORT_MUTEX_LOCK(pUartData->mutex);
+            pUartData->pRxBufferWrite += thisSize;
+            if (pUartData->pRxBufferWrite >= pUartData->pRxBufferStart +
+                                             CELLULAR_PORT_UART_RX_BUFFER_SIZE) {
+                pUartData->pRxBufferWrite = pUartData->pRxBufferStart;
+            }
+            notify = pUartData->userNeedsNotify;
+            pUartData->userNeedsNotify = false;
+            CELLULAR_PORT_MUTEX_UNLOCK(pUartData->mutex);
+            if (notify) {
+                // As from an interrupt, don't wait: if the queue
+                // is full the user has events to process already,
+                // and blocking here would stop this thread reading
+                // the data that the user may be waiting for
+                uartSizeOrError = thisSize;
+                cellularPortPrivateQueueSendNoWait(pUartData->queue,
+                                                   &uartSizeOrError);
+            }
+        } else if ((space == 0) || (thisSize < 0) ||
+                   (pollFd.revents & (POLLHUP | POLLERR))) {
+            // Either the user has some reading to do or
+            // there's no-one at the other end: wait a while
+            // rather than spinning
+            cellularPortTaskBlock(CELLULAR_PORT_UART_RX_POLL_INTERVAL_MS);
+        }
+    }
+
+    return NULL;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Initialise a UART.
+int32_t cellularPortUartInit(int32_t pinTx, int32_t pinRx,
+                             int32_t pinCts, int32_t pinRts,
+                             int32_t baudRate,
+                             size_t rtsThreshold,
+                             int32_t uart,
+                             CellularPortQueueHandle_t *pUartQueue)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortUartData_t *pUartData;
+
+    (void) rtsThreshold;
+
+    if ((pUartQueue != NULL) && (pinRx >= 0) && (pinTx >= 0) &&
+        (uart >= 0) && (uart < CELLULAR_PORT_UART_MAX_NUM)) {
+        errorCode = CELLULAR_PORT_SUCCESS;
+        if (gpUartData[uart] == NULL) {
+            errorCode = CELLULAR_PORT_OUT_OF_MEMORY;
+            pUartData = (CellularPortUartData_t *) pCellularPort_malloc(sizeof(*pUartData));
+            if (pUartData != NULL) {
+                pCellularPort_memset(pUartData, 0, sizeof(*pUartData));
+                pUartData->number = uart;
+                pUartData->ptySlaveFd = -1;
+                pUartData->ctsFlowControl = (pinCts >= 0);
+                pUartData->rtsFlowControl = (pinRts >= 0);
+                pUartData->pRxBufferStart = (char *) pCellularPort_malloc(CELLULAR_PORT_UART_RX_BUFFER_SIZE);
+                if (pUartData->pRxBufferStart != NULL) {
+                    pUartData->pRxBufferRead = pUartData->pRxBufferStart;
+                    pUartData->pRxBufferWrite = pUartData->pRxBufferStart;
+                    pUartData->userNeedsNotify = true;
+                    errorCode = cellularPortMutexCreate(&(pUartData->mutex));
+                    if (errorCode == 0) {
+                        errorCode = cellularPortQueueCreate(CELLULAR_PORT_UART_EVENT_QUEUE_SIZE,
+                                                            sizeof(CellularPortUartEventData_t),
+                                                            &(pUartData->queue));
+                        if (errorCode == 0) {
+                            errorCode = CELLULAR_PORT_PLATFORM_ERROR;
+                            if (pthread_mutex_init(&(pUartData->txMutex), NULL) == 0) {
+                                errorCode = timingInit(pUartData, baudRate);
+                                if (errorCode == 0) {
+                                    errorCode = openUart(pUartData, pinTx == pinRx,
+                                                         baudRate);
+                                }
+                                if (errorCode == 0) {
+                                    // Writes are non-blocking so that they
+                                    // can be timed out, see cellularPortUartWrite()
+                                    fcntl(pUartData->writeFd, F_SETFL,
+                                          fcntl(pUartData->writeFd, F_GETFL) | O_NONBLOCK);
+                                    if (pthread_create(&(pUartData->rxThread), NULL,
+                                                       rxThread, pUartData) == 0) {
+                                        *pUartQueue = pUartData->queue;
+                                        gpUartData[uart] = pUartData;
+                                    } else {
+                                        closeUart(pUartData);
+                                        errorCode = CELLULAR_PORT_PLATFORM_ERROR;
+                                    }
+                                }
+                                if (errorCode != 0) {
+                                    pthread_mutex_destroy(&(pUartData->txMutex));
+                                }
+                            }
+                            if (errorCode != 0) {
+                                cellularPortQueueDelete(pUartData->queue);
+                            }
+                        }
+                        if (errorCode != 0) {
+                            cellularPortMutexDelete(pUartData->mutex);
+                        }
+                    }
+                    if (errorCode != 0) {
+                        cellularPort_free(pUartData->pRxBufferStart);
+                    }
+                }
+                if (errorCode != 0) {
+                    cellularPort_free(pUartData);
+                }
+            }
+        }
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Shutdown a UART.
+int32_t cellularPortUartDeinit(int32_t uart)
+{
+    CellularPortErrorCode_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortUartData_t *pUartData;
+
+    if ((uart >= 0) && (uart < CELLULAR_PORT_UART_MAX_NUM)) {
+        errorCode = CELLULAR_PORT_SUCCESS;
+        pUartData = gpUartData[uart];
+        if (pUartData != NULL) {
+            // The caller needs to make sure that no read/write
+            // is in progress when this function is called.
+            pUartData->rxThreadStop = true;
+            pthread_join(pUartData->rxThread, NULL);
+            gpUartData[uart] = NULL;
+            if (pUartData->timed) {
+                cellularPortLog("CELLULAR_PORT_UART: UART %d sent %u byte(s),"
+                                " received %u byte(s), %u byte(s) lost to"
+                                " overrun.\n", uart,
+                                (unsigned int) pUartData->txBytes,
+                                (unsigned int) pUartData->rxBytes,
+                                (unsigned int) pUartData->rxOverrunBytes);
+            }
+            closeUart(pUartData);
+            pthread_mutex_destroy(&(pUartData->txMutex));
+            cellularPortQueueDelete(pUartData->queue);
+            cellularPortMutexDelete(pUartData->mutex);
+            cellularPort_free(pUartData->pRxBufferStart);
+            cellularPort_free(pUartData);
+        }
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Push a UART event onto the UART event queue.
+int32_t cellularPortUartEventSend(const CellularPortQueueHandle_t queueHandle,
+                                  int32_t sizeBytesOrError)
+{
+    int32_t errorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortUartEventData_t uartSizeOrError;
+
+    if (queueHandle != NULL) {
+        uartSizeOrError = sizeBytesOrError;
+        errorCode = cellularPortQueueSend(queueHandle, (void *) &uartSizeOrError);
+    }
+
+    return errorCode;
+}
+
+// Receive a UART event, blocking until one turns up.
+int32_t cellularPortUartEventReceive(const CellularPortQueueHandle_t queueHandle)
+{
+    int32_t sizeOrErrorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortUartEventData_t uartSizeOrError;
+
+    if (queueHandle != NULL) {
+        sizeOrErrorCode = CELLULAR_PORT_PLATFORM_ERROR;
+        if (cellularPortQueueReceive(queueHandle, &uartSizeOrError) == 0) {
+            sizeOrErrorCode = uartSizeOrError;
+        }
+    }
+
+    return sizeOrErrorCode;
+}
+
+// Receive a UART event with a timeout.
+int32_t cellularPortUartEventTryReceive(const CellularPortQueueHandle_t queueHandle,
+                                        int32_t waitMs)
+{
+    int32_t sizeOrErrorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortUartEventData_t uartSizeOrError;
+
+    if (queueHandle != NULL) {
+        sizeOrErrorCode = CELLULAR_PORT_TIMEOUT;
+        if (cellularPortQueueTryReceive(queueHandle, waitMs, &uartSizeOrError) == 0) {
+            sizeOrErrorCode = uartSizeOrError;
+        }
+    }
+
+    return sizeOrErrorCode;
+}
+
+// Get the number of bytes waiting in the receive buffer.
+int32_t cellularPortUartGetReceiveSize(int32_t uart)
+{
+    CellularPortErrorCode_t sizeOrErrorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortUartData_t *pUartData = pGetUart(uart);
+
+    if (pUartData != NULL) {
+
+        CELLULAR_PORT_MUTEX_LOCK(pUartData->mutex);
+
+        sizeOrErrorCode = pUartData->pRxBufferWrite - pUartData->pRxBufferRead;
+        if (sizeOrErrorCode < 0) {
+            // Write pointer has wrapped
+            sizeOrErrorCode += CELLULAR_PORT_UART_RX_BUFFER_SIZE;
+        }
+
+        // If there's nothing waiting, need to inform
+        // the user when something arrives
+        if (sizeOrErrorCode == 0) {
+            pUartData->userNeedsNotify = true;
+        }
+
+        CELLULAR_PORT_MUTEX_UNLOCK(pUartData->mutex);
+
+    }
+
+    return (int32_t) sizeOrErrorCode;
+}
+
+// Read from the given UART interface.
+int32_t cellularPortUartRead(int32_t uart, char *pBuffer,
+                             size_t sizeBytes)
+{
+    CellularPortErrorCode_t sizeOrErrorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortUartData_t *pUartData = pGetUart(uart);
+    size_t thisSize;
+
+    if ((pUartData != NULL) && (pBuffer != NULL)) {
+
+        CELLULAR_PORT_MUTEX_LOCK(pUartData->mutex);
+
+        sizeOrErrorCode = 0;
+        // Take from the read pointer up to either the write
+        // pointer or, if the write pointer has wrapped, the
+        // end of the buffer and then go around again
+        while ((sizeBytes > 0) &&
+               (pUartData->pRxBufferRead != pUartData->pRxBufferWrite)) {
+            if (pUartData->pRxBufferRead < pUartData->pRxBufferWrite) {
+                thisSize = pUartData->pRxBufferWrite - pUartData->pRxBufferRead;
+            } else {
+                thisSize = pUartData->pRxBufferStart +
+                           CELLULAR_PORT_UART_RX_BUFFER_SIZE -
+                           pUartData->pRxBufferRead;
+            }
+            if (thisSize > sizeBytes) {
+                thisSize = sizeBytes;
+            }
+            pCellularPort_memcpy(pBuffer, pUartData->pRxBufferRead,
+                                 thisSize);
+            pBuffer += thisSize;
+            sizeBytes -= thisSize;
+            sizeOrErrorCode += thisSize;
+            pUartData->pRxBufferRead += thisSize;
+            if (pUartData->pRxBufferRead >= pUartData->pRxBufferStart +
+                                            CELLULAR_PORT_UART_RX_BUFFER_SIZE) {
+                pUartData->pRxBufferRead = pUartData->pRxBufferStart;
+            }
+        }
+
+        // If everything has been read, a notification
+        // is needed for the next one
+        if (pUartData->pRxBufferRead == pUartData->pRxBufferWrite) {
+            pUartData->userNeedsNotify = true;
+        }
+
+        CELLULAR_PORT_MUTEX_UNLOCK(pUartData->mutex);
+
+    }
+
+    return (int32_t) sizeOrErrorCode;
+}
+
+// Write all of the given data to the file descriptor of a UART,
+// returning the number of bytes written.
+static size_t writeFd(CellularPortUartData_t *pUartData,
+                      const char *pBuffer, size_t sizeBytes)
+{
+    struct pollfd pollFd;
+    ssize_t thisSize;
+    size_t sent = 0;
+    bool stuck = false;
+
+    pollFd.fd = pUartData->writeFd;
+    pollFd.events = POLLOUT;
+    while ((sent < sizeBytes) && !stuck) {
+        thisSize = write(pUartData->writeFd, pBuffer + sent,
+                         sizeBytes - sent);
+        if (thisSize > 0) {
+            sent += thisSize;
+        } else if ((thisSize < 0) && (errno == EAGAIN)) {
+            // Wait for the other end to make some room
+            stuck = (poll(&pollFd, 1, CELLULAR_PORT_UART_TX_TIMEOUT_MS) <= 0);
+        } else if ((thisSize < 0) && (errno != EINTR)) {
+            stuck = true;
+        }
+    }
+
+    return sent;
+}
+
+// Write to the given UART interface.
+int32_t cellularPortUartWrite(int32_t uart,
+                              const char *pBuffer,
+                              size_t sizeBytes)
+{
+    CellularPortErrorCode_t sizeOrErrorCode = CELLULAR_PORT_INVALID_PARAMETER;
+    CellularPortUartData_t *pUartData = pGetUart(uart);
+    size_t sent = 0;
+    size_t thisSize;
+    size_t chunkSize;
+    int64_t startNs;
+    bool stuck = false;
+
+    if ((pUartData != NULL) && (pBuffer != NULL)) {
+        pthread_mutex_lock(&(pUartData->txMutex));
+
+        if (pUartData->timed) {
+            // Send a tick's worth of characters at a time, each
+            // chunk being handed over once it would have left,
+            // waiting for CTS if the far end is holding it off
+            chunkSize = CELLULAR_PORT_UART_TIMING_TICK_NS /
+                        pUartData->characterTimeNs;
+            if (chunkSize == 0) {
+                chunkSize = 1;
+            }
+            while ((sent < sizeBytes) && !stuck) {
+                thisSize = sizeBytes - sent;
+                if (thisSize > chunkSize) {
+                    thisSize = chunkSize;
+                }
+                startNs = timeNowNs();
+                if (startNs < pUartData->txLineFreeNs) {
+                    startNs = pUartData->txLineFreeNs;
+                }
+                startNs = ctsReleaseNs(pUartData, startNs);
+                pUartData->txLineFreeNs = startNs + (thisSize *
+                                                     pUartData->characterTimeNs);
+                sleepUntilNs(pUartData->txLineFreeNs);
+                stuck = (writeFd(pUartData, pBuffer + sent, thisSize) < thisSize);
+                if (!stuck) {
+                    sent += thisSize;
+                }
+            }
+            pUartData->txBytes += sent;
+        } else {
+            // Do the blocking send
+            sent = writeFd(pUartData, pBuffer, sizeBytes);
+        }
+        sizeOrErrorCode = sent;
+        if (sent < sizeBytes) {
+            sizeOrErrorCode = CELLULAR_PORT_PLATFORM_ERROR;
+        }
+
+        pthread_mutex_unlock(&(pUartData->txMutex));
+    }
+
+    return (int32_t) sizeOrErrorCode;
+}
+
+// Determine if RTS flow control is enabled.
+bool cellularPortIsRtsFlowControlEnabled(int32_t uart)
+{
+    CellularPortUartData_t *pUartData = pGetUart(uart);
+
+    return (pUartData != NULL) && pUartData->rtsFlowControl;
+}
+
+// Determine if CTS flow control is enabled.
+bool cellularPortIsCtsFlowControlEnabled(int32_t uart)
+{
+    CellularPortUartData_t *pUartData = pGetUart(uart);
+
+    return (pUartData != NULL) && pUartData->ctsFlowControl;
+}
+
+// End of file
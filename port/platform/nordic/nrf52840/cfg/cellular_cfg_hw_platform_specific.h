@@ -46,6 +46,16 @@
 # define CELLULAR_CFG_RTS_THRESHOLD                  100
 #endif
 
+/** Define this to have an event sent to the UART event queue
+ * when all of the data queued by cellularPortUartWrite() has
+ * been transmitted.  Since a positive event value indicates
+ * received data, the value given here must be negative, e.g.:
+ *
+ * #define CELLULAR_CFG_UART_TX_COMPLETE_EVENT -2
+ *
+ * Not defined by default since the AT client has no need of it.
+ */
+
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS FOR NRF52840: TIMERS/COUNTERS
  * -------------------------------------------------------------- */
@@ -79,6 +79,25 @@
 # error CELLULAR_CTRL_TASK_CALLBACK_PRIORITY must be less than CELLULAR_CTRL_AT_TASK_URC_PRIORITY
 #endif
 
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS FOR NRF52840: SOCKETS RELATED
+ * -------------------------------------------------------------- */
+
+#ifndef CELLULAR_SOCK_TASK_TX_FLUSH_STACK_SIZE_BYTES
+/** The stack size of the task that flushes the transmit buffers
+ * of TCP sockets when their flush time expires; the task is only
+ * created if a socket has a transmit buffer.
+ */
+# define CELLULAR_SOCK_TASK_TX_FLUSH_STACK_SIZE_BYTES (1024 * 3)
+#endif
+
+#ifndef CELLULAR_SOCK_TASK_TX_FLUSH_PRIORITY
+/** The task priority of the transmit buffer flush task.  In FreeRTOS,
+ * as used on this platform, low numbers indicate lower priority.
+ */
+# define CELLULAR_SOCK_TASK_TX_FLUSH_PRIORITY (CELLULAR_PORT_OS_PRIORITY_MIN + 2)
+#endif
+
 #endif // _CELLULAR_CFG_OS_PLATFORM_SPECIFIC_H_
 
 // End of file
@@ -46,6 +46,17 @@
  * the correct function is accessed through a jump table,
  * making it possible to use it in a parameterised manner
  * again.
+ *
+ * Receive notification is driven by the UART IDLE line
+ * interrupt: when the line has been idle for one character
+ * time after a burst of data (e.g. a URC) a single event is
+ * sent carrying the number of bytes in that burst.  The DMA
+ * half-transfer and transfer-complete interrupts only ever
+ * notify during a long burst (e.g. a socket payload), where
+ * waiting for the line to go idle would risk the DMA
+ * overwriting data the user has not yet read.  Either way,
+ * no further event is sent until the user has read
+ * everything, so the receiving task is never flooded.
  */
 
 /* ----------------------------------------------------------------
@@ -104,6 +115,9 @@ typedef struct CellularPortUartData_t {
     bool userNeedsNotify; //!< set this if toRead has hit zero and
                           // hence the user would like a notification
                           // when new data arrives.
+    size_t rxBurstSize; //!< the number of bytes received since
+                        // the last event was sent or the
+                        // line last went idle.
     struct CellularPortUartData_t *pNext;
 } CellularPortUartData_t;
 
@@ -405,9 +419,11 @@ static bool removeUart(int32_t uart)
 }
 
 // Deal with data already received by the DMA; this
-// code is run in INTERRUPT CONTEXT.
+// code is run in INTERRUPT CONTEXT.  burstEnd should
+// be true if the line has gone idle.
 static inline void dataIrqHandler(CellularPortUartData_t *pUartData,
-                                  char *pRxBufferWriteDma)
+                                  char *pRxBufferWriteDma,
+                                  bool burstEnd)
 {
     CellularPortUartEventData_t uartSizeOrError = 0;
 
@@ -435,18 +451,28 @@ static inline void dataIrqHandler(CellularPortUartData_t *pUartData,
                                     CELLULAR_PORT_UART_RX_BUFFER_SIZE;
     }
 
+    pUartData->rxBurstSize += uartSizeOrError;
+
     // If there is new data and the user wanted to know
-    // then send a message to let them know.
-    if ((uartSizeOrError > 0) && pUartData->userNeedsNotify) {
+    // then send a message to let them know, with the
+    // size of the burst so far.  If the burst has ended
+    // and the user is still reading the last one they
+    // will find this data anyway so no event is needed.
+    if ((pUartData->rxBurstSize > 0) && pUartData->userNeedsNotify) {
         BaseType_t yield = false;
 
+        uartSizeOrError = pUartData->rxBurstSize;
         xQueueSendFromISR((QueueHandle_t) (pUartData->queue),
                           &uartSizeOrError, &yield);
         pUartData->userNeedsNotify = false;
+        pUartData->rxBurstSize = 0;
 
         // Required for correct FreeRTOS operation
         portEND_SWITCHING_ISR(yield);
     }
+    if (burstEnd) {
+        pUartData->rxBurstSize = 0;
+    }
 }
 
 /* ----------------------------------------------------------------
@@ -487,8 +513,10 @@ void dmaIrqHandler(uint32_t dmaEngine, uint32_t dmaStream)
         pRxBufferWriteDma = pUartData->pRxBufferStart +
                             CELLULAR_PORT_UART_RX_BUFFER_SIZE -
                             LL_DMA_GetDataLength(pDmaReg, dmaStream);
-        // Deal with the data
-        dataIrqHandler(pUartData, pRxBufferWriteDma);
+        // Deal with the data; the burst has not
+        // ended, the DMA has just got half way
+        // around or all the way around the buffer
+        dataIrqHandler(pUartData, pRxBufferWriteDma, false);
     }
 }
 
@@ -515,8 +543,8 @@ void uartIrqHandler(CellularPortUartData_t *pUartData)
                             CELLULAR_PORT_UART_RX_BUFFER_SIZE -
                             LL_DMA_GetDataLength(gpDmaReg[pUartCfg->dmaEngine],
                                                  pUartCfg->dmaStream);
-        // Deal with the data
-        dataIrqHandler(pUartData, pRxBufferWriteDma);
+        // Deal with the data: this is the end of a burst
+        dataIrqHandler(pUartData, pRxBufferWriteDma, true);
     }
 }
 
@@ -760,6 +788,7 @@ int32_t cellularPortUartInit(int32_t pinTx, int32_t pinRx,
                     uartData.pRxBufferRead = uartData.pRxBufferStart;
                     uartData.pRxBufferWrite = uartData.pRxBufferStart;
                     uartData.userNeedsNotify = true;
+                    uartData.rxBurstSize = 0;
 
                     // Create the queue
                     errorCode = cellularPortQueueCreate(CELLULAR_PORT_UART_EVENT_QUEUE_SIZE,
@@ -911,7 +940,8 @@ int32_t cellularPortUartInit(int32_t pinTx, int32_t pinRx,
                         if (platformError == SUCCESS) {
                             // Asynchronous UART/USART with DMA on the receive
                             // and include only the idle line interrupt,
-                            // DMA does the rest
+                            // which signals the end of a burst of
+                            // received data, DMA does the rest
                             LL_USART_ConfigAsyncMode(pUartReg);
                             LL_USART_EnableDMAReq_RX(pUartReg);
                             LL_USART_EnableIT_IDLE(pUartReg);
@@ -1079,9 +1109,9 @@ int32_t cellularPortUartGetReceiveSize(int32_t uart)
                               (pRxBufferWrite - pUartData->pRxBufferStart);
         }
 
-        // If there's nothing waiting, need to information
+        // If there's nothing waiting, need to inform
         // the user when something arrives
-        if (sizeOrErrorCode) {
+        if (sizeOrErrorCode == 0) {
             pUartData->userNeedsNotify = true;
         }
 
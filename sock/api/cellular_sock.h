@@ -20,7 +20,11 @@
 /* No #includes allowed here */
 
 /* This header file defines the cellular sockets API.  These
- * functions are thread-safe.
+ * functions are thread-safe.  Each socket is locked on its own,
+ * so a socket that is busy, e.g. connecting, holds up only those
+ * who want that same socket; all sockets share the one AT
+ * interface to the module, however, so their AT commands still
+ * take turns.
  */
 
 /* IMPORTANT: this API is still in the process of definition, anything
@@ -111,17 +115,21 @@
  */
 #define CELLULAR_SOCK_OPT_RCVTIMEO     0x1006
 
-/** Socket option: get and then clear error status.
+/** Socket option: get and then clear error status, an
+ * int32_t which is the errno of a failed non-blocking connect,
+ * else zero.
  * The value matches LWIP.
  */
 #define CELLULAR_SOCK_OPT_ERROR        0x1007
 
-/** Socket option: get socekt type.
+/** Socket option: get socket type, an int32_t which is
+ * a CellularSockType_t.
  * The value matches LWIP.
  */
 #define CELLULAR_SOCK_OPT_TYPE         0x1008
 
-/** Socket option: connect timeout.
+/** Socket option: connect timeout, a CellularPort_timeval
+ * which must not be zero.
  * The value matches LWIP.
  */
 #define CELLULAR_SOCK_OPT_CONTIMEO     0x1009
@@ -157,7 +165,9 @@
  */
 #define CELLULAR_SOCK_OPT_LEVEL_TCP     6
 
-/** TCP socket option: turn off Nagle's algorithm.
+/** TCP socket option: turn off Nagle's algorithm.  This also
+ * sends anything held in the transmit buffer of the socket and
+ * stops further writes being held there.
  * The value matches LWIP.
  */
 #define CELLULAR_SOCK_OPT_TCP_NODELAY  0x0001
@@ -167,6 +177,24 @@
  */
 #define CELLULAR_SOCK_OPT_TCP_KEEPIDLE 0x0002
 
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS: SOCKET OPTIONS FOR TLS LEVEL
+ * -------------------------------------------------------------- */
+
+/** The level for TLS options.  LWIP has no such level, the value
+ * is chosen so as not to clash with those that it does have.
+ */
+#define CELLULAR_SOCK_OPT_LEVEL_TLS     0x0f00
+
+/** TLS socket option: the security profile, an int32_t as returned
+ * by cellularSockTlsProfileGet(), with which the module itself runs
+ * TLS on the socket, or -1, the default, for none.  TCP sockets
+ * only and must be set before cellularSockConnect(), which then
+ * includes the TLS handshake; what is written to and read from the
+ * socket thereafter is the plain text carried inside the TLS session.
+ */
+#define CELLULAR_SOCK_OPT_TLS_SECURITY_PROFILE 0x0001
+
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS: FCTL COMMANDS
  * -------------------------------------------------------------- */
@@ -191,6 +219,11 @@
  */
 #define CELLULAR_SOCK_IOCTL_SET_NONBLOCK 0x8004667E
 
+/** The command to get the number of bytes that can be read
+ * without asking the module. The value matches LWIP.
+ */
+#define CELLULAR_SOCK_IOCTL_GET_NREAD 0x4004667F
+
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS: MISC
  * -------------------------------------------------------------- */
@@ -216,19 +249,9 @@
  */
 #define CELLULAR_SOCK_MODULE_MAX_NUM_SOCKETS 7
 
-/** The number of statically allocated sockets.  When
- * more than this number of sockets are required to
- * be open simultaneously they will be malloc()ed and
- * it is up to the user to call cellularSockCleanUp()
- * to release the memory occupied by closed malloc()ed
- * sockets when done.
- */
-#define CELLULAR_SOCK_NUM_STATIC_SOCKETS CELLULAR_SOCK_MODULE_MAX_NUM_SOCKETS
-
 /** The maximum number of sockets that can be in existence at once.
- * Note: this software doesn't care how big this number is,
- * subject to heap memory availability, but the cellular module
- * does
+ * The sockets are a statically allocated pool of this size,
+ * descriptors running from 0 to this number minus one.
  */
 #define CELLULAR_SOCK_MAX CELLULAR_SOCK_MODULE_MAX_NUM_SOCKETS
 
@@ -243,6 +266,154 @@
  */
 #define CELLULAR_SOCK_RECEIVE_TIMEOUT_DEFAULT_MS 10000
 
+#ifndef CELLULAR_SOCK_CONNECT_TIMEOUT_DEFAULT_MS
+/** The default time allowed for a TCP connection to be made, in
+ * milliseconds; may be changed for a given socket with the
+ * CELLULAR_SOCK_OPT_CONTIMEO socket option.
+ */
+# define CELLULAR_SOCK_CONNECT_TIMEOUT_DEFAULT_MS 10000
+#endif
+
+#ifndef CELLULAR_SOCK_RX_CACHE_SIZE_BYTES
+/** The default size of the receive cache of a TCP socket.  A
+ * read of less than this, e.g. of the 5 byte header of a TLS
+ * record, fetches as much as the cache will hold from the
+ * module so that the reads which follow can be served from RAM
+ * rather than each costing an AT transaction.  The cache is
+ * allocated on first read, is never larger than
+ * CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES and may be resized,
+ * or switched off with zero, for a given socket with the
+ * CELLULAR_SOCK_OPT_RCVBUF socket option.
+ */
+# define CELLULAR_SOCK_RX_CACHE_SIZE_BYTES CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES
+#endif
+
+#ifndef CELLULAR_SOCK_RX_CACHE_BUDGET_BYTES
+/** The most heap memory that the receive caches of all sockets
+ * may occupy at once: a socket whose cache would take the total
+ * over this reads without one.  Zero switches caching off.
+ */
+# define CELLULAR_SOCK_RX_CACHE_BUDGET_BYTES (CELLULAR_SOCK_RX_CACHE_SIZE_BYTES * 2)
+#endif
+
+#ifndef CELLULAR_SOCK_TX_BUFFER_SIZE_BYTES
+/** The default size of the transmit buffer of a TCP socket, zero
+ * for none.  With a transmit buffer, small writes, e.g. the
+ * header and then the body of a TLS record, are gathered together
+ * and sent to the module in one AT transaction when the buffer is
+ * full, when CELLULAR_SOCK_TX_FLUSH_TIME_MS has passed since the
+ * oldest data was written, when the socket is read from, flushed
+ * with cellularSockFlush(), shut down or closed, or when the
+ * CELLULAR_SOCK_OPT_TCP_NODELAY socket option is set.  The buffer
+ * is allocated on first write, is never larger than
+ * CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES and may be resized, or
+ * switched off with zero, for a given socket with the
+ * CELLULAR_SOCK_OPT_SNDBUF socket option.
+ */
+# define CELLULAR_SOCK_TX_BUFFER_SIZE_BYTES 0
+#endif
+
+#ifndef CELLULAR_SOCK_TX_FLUSH_TIME_MS
+/** The longest that data may wait in the transmit buffer of a
+ * TCP socket before it is sent.
+ */
+# define CELLULAR_SOCK_TX_FLUSH_TIME_MS 20
+#endif
+
+#ifndef CELLULAR_SOCK_DNS_CACHE_NUM_ENTRIES
+/** The number of host names that cellularSockGetHostByName()
+ * remembers the answer for, so that looking up the same name
+ * again, e.g. when reconnecting to a server, does not cost an
+ * AT+UDNSRN transaction.  When the cache is full the entry
+ * used least recently makes way.  Zero switches the cache off.
+ */
+# define CELLULAR_SOCK_DNS_CACHE_NUM_ENTRIES 4
+#endif
+
+#ifndef CELLULAR_SOCK_DNS_CACHE_HOST_NAME_MAX_LENGTH_BYTES
+/** The longest host name, not including the terminator, that
+ * the DNS cache will hold; longer names are always looked up.
+ */
+# define CELLULAR_SOCK_DNS_CACHE_HOST_NAME_MAX_LENGTH_BYTES 64
+#endif
+
+#ifndef CELLULAR_SOCK_DNS_CACHE_TTL_SECONDS
+/** How long the IP address of a host name is kept in the DNS
+ * cache.  The module does not pass on the time-to-live given
+ * by the DNS server, hence this is fixed.
+ */
+# define CELLULAR_SOCK_DNS_CACHE_TTL_SECONDS 300
+#endif
+
+#ifndef CELLULAR_SOCK_DNS_CACHE_NEGATIVE_TTL_SECONDS
+/** How long a host name which the module reported could not
+ * be resolved (+CME ERROR CELLULAR_SOCK_DNS_CME_ERROR_HOST_NOT_FOUND,
+ * see cellular_cfg_module.h) is kept in the DNS cache, so that
+ * asking again soon after fails at once; other failures are
+ * not kept.  Zero means that no failures are kept.
+ */
+# define CELLULAR_SOCK_DNS_CACHE_NEGATIVE_TTL_SECONDS 10
+#endif
+
+#ifndef CELLULAR_SOCK_TLS_FIRST_SECURITY_PROFILE
+/** The first of the security profiles of the module that
+ * cellularSockTlsProfileGet() may hand out.
+ */
+# define CELLULAR_SOCK_TLS_FIRST_SECURITY_PROFILE 0
+#endif
+
+#ifndef CELLULAR_SOCK_TLS_NUM_SECURITY_PROFILES
+/** The number of security profiles of the module, starting at
+ * CELLULAR_SOCK_TLS_FIRST_SECURITY_PROFILE, that
+ * cellularSockTlsProfileGet() may hand out; SARA-R4 and SARA-R5
+ * modules have five, 0 to 4.
+ */
+# define CELLULAR_SOCK_TLS_NUM_SECURITY_PROFILES 5
+#endif
+
+#ifndef CELLULAR_SOCK_TLS_CREDENTIAL_CACHE_NUM_ENTRIES
+/** The number of credentials that cellularSockTlsStoreCredential()
+ * remembers having stored in the module, so that storing the same
+ * credential again under the same name, e.g. each time a secure
+ * socket is opened, does not send it over the UART again.  A
+ * copy of each credential is kept on the heap, so that the one
+ * being stored can be compared with it in full.  When the cache
+ * is full the entry used least recently makes way.  Zero switches
+ * the cache off.
+ */
+# define CELLULAR_SOCK_TLS_CREDENTIAL_CACHE_NUM_ENTRIES 4
+#endif
+
+#ifndef CELLULAR_SOCK_STATS_LATENCY_NUM_BUCKETS
+/** The number of buckets in the read and write latency
+ * histograms of CellularSockStats_t.  The first bucket counts
+ * calls that took less than
+ * CELLULAR_SOCK_STATS_LATENCY_FIRST_BUCKET_MS, each bucket
+ * after that reaches twice as far as the one before and the
+ * last counts everything longer.
+ */
+# define CELLULAR_SOCK_STATS_LATENCY_NUM_BUCKETS 8
+#endif
+
+#ifndef CELLULAR_SOCK_STATS_LATENCY_FIRST_BUCKET_MS
+/** The upper limit of the first bucket of the read and write
+ * latency histograms of CellularSockStats_t.
+ */
+# define CELLULAR_SOCK_STATS_LATENCY_FIRST_BUCKET_MS 10
+#endif
+
+/** The longest name, not including the terminator, that a
+ * credential may be stored under with
+ * cellularSockTlsStoreCredential().
+ */
+#define CELLULAR_SOCK_TLS_CREDENTIAL_NAME_MAX_LENGTH_BYTES 32
+
+/** The longest server name, not including the terminator, that
+ * may be given to cellularSockTlsProfileGet(): that of a DNS
+ * name.
+ */
+#define CELLULAR_SOCK_TLS_SERVER_NAME_MAX_LENGTH_BYTES 253
+
 /** Zero a file descriptor set.
  */
 #define CELLULAR_SOCK_FD_ZERO(pSet) pCellularPort_memset(*(pSet), 0,     \
@@ -264,10 +435,9 @@
 
 /** Determine if the bit corresponding to a given file descriptor is set.
  */
-#define CELLULAR_SOCK_FD_ISSET(d, pSet) if (((d) >= 0) &&                               \
-                                            ((d) < CELLULAR_SOCK_DESCRIPTOR_SETSIZE)) { \
-                                            (*(pSet))[(d) / 8] & (1 << ((d) & 7));      \
-                                        }
+#define CELLULAR_SOCK_FD_ISSET(d, pSet) ((((d) >= 0) &&                                   \
+                                          ((d) < CELLULAR_SOCK_DESCRIPTOR_SETSIZE)) ?     \
+                                         ((*(pSet))[(d) / 8] & (1 << ((d) & 7))) : 0)
 
 /* ----------------------------------------------------------------
  * TYPES
@@ -281,6 +451,165 @@ typedef int32_t CellularSockDescriptor_t;
  */
 typedef uint8_t CellularSockDescriptorSet_t[(CELLULAR_SOCK_DESCRIPTOR_SETSIZE + 7) / 8];
 
+/** Statistics of TCP reads and the receive cache, see
+ * cellularSockGetRxCacheStats().
+ */
+typedef struct {
+    size_t numReads;          //<! TCP reads that asked for data.
+    size_t numReadsFromCache; //<! Of those, the reads served
+                              //< entirely from the receive cache.
+    size_t numAtReads;        //<! AT+USORD transactions issued
+                              //< for TCP reads.
+    size_t numBytesRead;      //<! Bytes returned by TCP reads.
+    size_t cacheBytesInUse;   //<! Heap occupied by receive caches.
+} CellularSockRxCacheStats_t;
+
+/** Statistics of TCP writes and the transmit buffer, see
+ * cellularSockGetTxBufferStats().
+ */
+typedef struct {
+    size_t numWrites;        //<! TCP writes that had data.
+    size_t numAtWrites;      //<! AT+USOWR transactions issued
+                             //< for TCP writes.
+    size_t numBytesWritten;  //<! Bytes accepted by TCP writes.
+    size_t numTimedFlushes;  //<! Transmit buffers sent because
+                             //< their flush time expired.
+    size_t bufferBytesInUse; //<! Heap occupied by transmit buffers.
+} CellularSockTxBufferStats_t;
+
+/** Statistics of getting and setting the socket options that
+ * the module holds, see cellularSockGetOptionCacheStats().
+ */
+typedef struct {
+    size_t numGets;        //<! Gets of an option that the module
+                           //< holds.
+    size_t numGetHits;     //<! Of those, answered locally.
+    size_t numSets;        //<! Sets of an option that the module
+                           //< holds.
+    size_t numSetSkips;    //<! Of those, skipped because the value
+                           //< was unchanged.
+    size_t numSetsBatched; //<! Of those, held until connect and
+                           //< then written along with the others
+                           //< held in one AT transaction.
+    size_t numAtCommands;  //<! AT+USOGO/AT+USOSO transactions
+                           //< issued for them.
+} CellularSockOptionCacheStats_t;
+
+/** Statistics of host name look-ups and the DNS cache, see
+ * cellularSockGetDnsCacheStats().
+ */
+typedef struct {
+    size_t numLookups;      //<! Calls to cellularSockGetHostByName()
+                            //< with a host name.
+    size_t numHits;         //<! Of those, answered with an IP
+                            //< address from the DNS cache.
+    size_t numNegativeHits; //<! Of those, answered from the DNS
+                            //< cache as not found.
+    size_t numMisses;       //<! AT+UDNSRN transactions issued.
+    size_t numEntries;      //<! Entries now in the DNS cache.
+} CellularSockDnsCacheStats_t;
+
+/** Statistics of the setting up of TLS in the module, see
+ * cellularSockGetTlsCacheStats().
+ */
+typedef struct {
+    size_t numCredentialStores; //<! Calls to
+                                //< cellularSockTlsStoreCredential().
+    size_t numCredentialHits;   //<! Of those, credentials already
+                                //< in the module.
+    size_t numCredentialBytes;  //<! Bytes of credential sent to
+                                //< the module with AT+USECMNG.
+    size_t numProfileGets;      //<! Calls to
+                                //< cellularSockTlsProfileGet().
+    size_t numProfileHits;      //<! Of those, answered with a
+                                //< security profile already set
+                                //< up the same way.
+    size_t numAtProfileWrites;  //<! AT+USECPRF transactions issued.
+} CellularSockTlsCacheStats_t;
+
+/** Traffic statistics of a socket, or of all sockets, see
+ * cellularSockGetStats() and cellularSockGetStatsAll().
+ */
+typedef struct {
+    size_t numBytesSent;        //<! Bytes taken by the module.
+    size_t numSegmentsSent;     //<! AT+USOWR/AT+USOST transactions
+                                //< that sent data.
+    size_t numBytesReceived;    //<! Bytes read from the module.
+    size_t numSegmentsReceived; //<! AT+USORD/AT+USORF transactions
+                                //< that returned data.
+    size_t numAtCommands;       //<! AT transactions issued to
+                                //< connect, send and receive.
+    size_t numPartialSends;     //<! AT+USOWR transactions in which
+                                //< the module took less data than
+                                //< it was given.
+    size_t numSendsAbandoned;   //<! TCP sends given up because the
+                                //< module kept doing that.
+    size_t numWouldBlocks;      //<! Receives that had nothing to
+                                //< return, with errno
+                                //< CELLULAR_SOCK_EWOULDBLOCK.
+    size_t numUrcs;             //<! URCs from the module about the
+                                //< socket, e.g. +UUSORD.
+    size_t numDataCallbacks;    //<! Data callbacks queued, see
+                                //< cellularSockRegisterCallbackData();
+                                //< +UUSORDs that arrive before the
+                                //< application has read are coalesced.
+    size_t numConnects;         //<! Connections made by
+                                //< cellularSockConnect().
+    size_t connectTimeMs;       //<! The time they took to make,
+                                //< in total.
+    size_t readLatency[CELLULAR_SOCK_STATS_LATENCY_NUM_BUCKETS];  //<! Receives
+                                //< by how long they took, see
+                                //< CELLULAR_SOCK_STATS_LATENCY_NUM_BUCKETS.
+    size_t writeLatency[CELLULAR_SOCK_STATS_LATENCY_NUM_BUCKETS]; //<! Sends
+                                //< to the module by how long
+                                //< they took.
+} CellularSockStats_t;
+
+/** The types of credential that may be stored in the module with
+ * cellularSockTlsStoreCredential(): the numbers match those of
+ * AT+USECMNG.
+ */
+typedef enum {
+    CELLULAR_SOCK_TLS_CREDENTIAL_ROOT_CA     = 0,
+    CELLULAR_SOCK_TLS_CREDENTIAL_CLIENT_CERT = 1,
+    CELLULAR_SOCK_TLS_CREDENTIAL_CLIENT_KEY  = 2
+} CellularSockTlsCredentialType_t;
+
+/** How the module checks the certificate of the server: the
+ * numbers match those of AT+USECPRF.
+ */
+typedef enum {
+    CELLULAR_SOCK_TLS_VALIDATION_NONE             = 0,
+    CELLULAR_SOCK_TLS_VALIDATION_ROOT_CA          = 1, //<! Against the
+                                                       //< root CA.
+    CELLULAR_SOCK_TLS_VALIDATION_ROOT_CA_URL      = 2, //<! As above and
+                                                       //< for pServerName.
+    CELLULAR_SOCK_TLS_VALIDATION_ROOT_CA_URL_DATE = 3  //<! As above and
+                                                       //< that it is in
+                                                       //< date.
+} CellularSockTlsValidation_t;
+
+/** The settings of a security profile of the module, see
+ * cellularSockTlsProfileGet().
+ */
+typedef struct {
+    CellularSockTlsValidation_t validation;
+    const char *pRootCaName;     //<! The name of a root CA stored with
+                                 //< cellularSockTlsStoreCredential(),
+                                 //< NULL for none.
+    const char *pClientCertName; //<! The name of a client certificate,
+                                 //< NULL for none.
+    const char *pClientKeyName;  //<! The name of a client private key,
+                                 //< NULL for none.
+    const char *pServerName;     //<! The name of the server, sent
+                                 //< with SNI and checked against its
+                                 //< certificate, NULL for none.
+    bool sessionResumption;      //<! Have the module keep the TLS
+                                 //< session so that reconnecting to
+                                 //< the same server with this profile
+                                 //< needs only a short handshake.
+} CellularSockTlsProfile_t;
+
 /** Supported socket types: the numbers match those of LWIP.
  */
 typedef enum {
@@ -323,6 +652,25 @@ typedef struct {
     uint16_t port;
 } CellularSockAddress_t;
 
+/** A datagram, for use with cellularSockSendToMulti() and
+ * cellularSockReceiveFromMulti().
+ */
+typedef struct {
+    void *pData;                   //<! Buffer containing the datagram
+                                   //< to send or in which to store the
+                                   //< datagram received, supplied by
+                                   //< the caller.
+    size_t dataSizeBytes;          //<! The number of bytes to send
+                                   //< from pData or of storage at
+                                   //< pData, supplied by the caller.
+    size_t sizeBytes;              //<! The number of bytes of the
+                                   //< datagram sent or stored at pData.
+    CellularSockAddress_t address; //<! The address of the remote host
+                                   //< to send to, supplied by the
+                                   //< caller, or from which it was
+                                   //< received.
+} CellularSockDatagram_t;
+
 /** Socket shut-down types: the numbers match those of LWIP.
  */
 typedef enum {
@@ -339,6 +687,16 @@ typedef struct {
        int32_t l_linger;  //<! linger time in seconds.
 } CellularSockLinger_t;
 
+/** What a receiver, see cellularSockRegisterReceiver(), wants
+ * to happen next.
+ */
+typedef enum {
+    CELLULAR_SOCK_RECEIVER_CONTINUE, //<! Keep the data coming.
+    CELLULAR_SOCK_RECEIVER_PAUSE     //<! Read no more from the module
+                                     //< until cellularSockReceiverResume()
+                                     //< is called.
+} CellularSockReceiverAction_t;
+
 /** Error codes.
  */
 typedef enum {
@@ -372,7 +730,27 @@ typedef enum {
 int32_t cellularSockCreate(CellularSockType_t type,
                            CellularSockProtocol_t protocol);
 
-/** Make an outgoing connection on the given socket.
+/** Make an outgoing connection on the given socket.  The
+ * time allowed for a TCP connection to be made may be set with
+ * the CELLULAR_SOCK_OPT_CONTIMEO socket option.  If a TCP socket
+ * has been set non-blocking with cellularSockFcntl() then this
+ * returns at once with errno CELLULAR_SOCK_EINPROGRESS while the
+ * module makes the connection, so that several connections may
+ * be made in parallel.  When the connection is made, or fails,
+ * the socket becomes writable to cellularSockSelect() and any
+ * callback registered with cellularSockRegisterCallbackConnect()
+ * is called; the outcome may then be read, and cleared, with
+ * the CELLULAR_SOCK_OPT_ERROR socket option, zero meaning
+ * connected.  Calling this again meanwhile fails with errno
+ * CELLULAR_SOCK_EALREADY while the connection is being made,
+ * CELLULAR_SOCK_EISCONN once it has been made, or with the
+ * errno of the failure if that has not yet been read.  A socket
+ * on which a connection has failed should be closed.  If the
+ * CELLULAR_SOCK_OPT_CONTIMEO timeout passes before the module
+ * reports the outcome, the error is CELLULAR_SOCK_ETIMEDOUT and
+ * the connection is abandoned in the module; the socket then
+ * fails everything with CELLULAR_SOCK_ETIMEDOUT until it is
+ * closed.
  *
  * @param descriptor     the descriptor of the socket.
  * @param pRemoteAddress the address of the remote host to connect
@@ -384,6 +762,8 @@ int32_t cellularSockConnect(CellularSockDescriptor_t descriptor,
 
 /** Close a socket.  Note that a TCP socket should be shutdown
  * with a call to cellularSockShutdown() before it is closed.
+ * A socket may be closed while another task is blocked receiving
+ * on it, in which case that receive fails with CELLULAR_SOCK_EBADF.
  *
  * @param descriptor the descriptor of the socket to be closed.
  * @return           zero on success else negative error code.
@@ -393,12 +773,11 @@ int32_t cellularSockClose(CellularSockDescriptor_t descriptor);
 /** In order to maintain thread-safe operation, when a socket is
  * closed, either locally or by the remote host, it is only marked
  * as closed and the memory is retained, since some other thread
- * may be refering to it.  If you ever have more than
- * CELLULAR_SOCK_NUM_STATIC_SOCKETS open at the same time then
- * you must call this clean-up function when you are sure that
- * there is no socket activity, either locally or from the remote
- * host, in order to free memory malloc()ed for those additional
- * sockets.  A socket that is closed locally but waiting for the
+ * may be refering to it.  Call this clean-up function when you
+ * are sure that there is no socket activity, either locally or
+ * from the remote host, in order to return closed sockets to the
+ * pool and free any memory they occupy, e.g. their receive
+ * caches.  A socket that is closed locally but waiting for the
  * far end to close WILL be clean-up by this function and so no
  * callback registered by cellularSockRegisterCallbackClosed()
  * will be triggered when the remote server finally closes the
@@ -411,7 +790,8 @@ void cellularSockCleanUp();
  * sockets to be shut down in an organised way, with all sockets
  * closed locally, it can be done by calling this function.
  * It is different from cellularSockCleanUp() in that
- * all sockets, whatever their state, are closed locally.
+ * all sockets, whatever their state, are closed locally
+ * and the DNS cache is emptied.
  */
 void cellularSockDeinit();
 
@@ -438,13 +818,18 @@ int32_t cellularSockFcntl(CellularSockDescriptor_t descriptor,
  *
  * @param descriptor the descriptor of the socket.
  * @param command    the command to be sent.  Only setting
- *                   FIONBIO (non-blocking) is supported.
+ *                   FIONBIO (non-blocking) and getting FIONREAD
+ *                   (the number of bytes that the socket layer
+ *                   knows are waiting to be read, without
+ *                   asking the module) are supported.
  * @param pValue     a pointer argument relevant to command,
  *                   e.g. a pointer to the Boolean value of
- *                   FIONBIO (1 for non-blocking, 0 for blocking).
+ *                   FIONBIO (1 for non-blocking, 0 for blocking)
+ *                   or a pointer to the int32_t where the
+ *                   FIONREAD count is to be written.
  * @return           on success a value that is dependent
- *                   upon command (in the case of FIONBIO 0)
- *                   else -1 on error.
+ *                   upon command (in the case of FIONBIO and
+ *                   FIONREAD 0) else -1 on error.
  */
 int32_t cellularSockIoctl(CellularSockDescriptor_t descriptor,
                           int32_t command,
@@ -456,6 +841,14 @@ int32_t cellularSockIoctl(CellularSockDescriptor_t descriptor,
  * of CELLULAR_SOCK_OPT_LEVEL_SOCK, and option value of 
  * CELLULAR_SOCK_OPT_RCVTIMEO and then the option value would be
  * a pointer to a structure of type CellularPort_timeval.
+ * Options held by the module are remembered locally, so that
+ * setting one to the value it already has sends nothing to
+ * the module.  On a TCP socket that is not yet connected,
+ * CELLULAR_SOCK_OPT_TCP_KEEPIDLE and CELLULAR_SOCK_OPT_IP_TOS
+ * are held until cellularSockConnect() or cellularSockListen(),
+ * which then write them in one AT transaction; should the
+ * module not accept a value held in this way it is that call
+ * which fails, with errno CELLULAR_SOCK_EINVAL.
  *
  * @param descriptor        the descriptor of the socket.
  * @param level             the option level
@@ -471,7 +864,9 @@ int32_t cellularSockSetOption(CellularSockDescriptor_t descriptor,
                               const void *pOptionValue,
                               size_t optionValueLength);
 
-/** Get the options for the given socket.
+/** Get the options for the given socket.  An option held by
+ * the module is read from it only the first time, or not at all
+ * if it has been set, since it can only change when it is set.
  *
  * @param descriptor         the descriptor of the socket.
  * @param level              the option level
@@ -493,6 +888,20 @@ int32_t cellularSockGetOption(CellularSockDescriptor_t descriptor,
                               void *pOptionValue,
                               size_t *pOptionValueLength);
 
+/** Get the statistics of getting and setting the socket options
+ * that the module holds, across all sockets, since they were
+ * last reset.
+ *
+ * @param pStats  a place to put the statistics.
+ * @return        zero on success else negative error code.
+ */
+int32_t cellularSockGetOptionCacheStats(CellularSockOptionCacheStats_t *pStats);
+
+/** Reset the statistics of getting and setting the socket
+ * options that the module holds.
+ */
+void cellularSockResetOptionCacheStats();
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: UDP ONLY
  * -------------------------------------------------------------- */
@@ -517,6 +926,34 @@ int32_t cellularSockSendTo(CellularSockDescriptor_t descriptor,
                            const CellularSockAddress_t *pRemoteAddress,
                            const void *pData, size_t dataSizeBytes);
 
+/** Send a number of datagrams in one go, like sendmmsg(): the
+ * AT interface is locked just the once, rather than once per
+ * datagram as calling cellularSockSendTo() repeatedly would,
+ * and the address of the remote host is only converted into
+ * the form the module wants when it differs from that of the
+ * previous datagram, so a burst of datagrams to the same host
+ * is cheap.  In hex mode, see cellularCtrlSetSockHexMode(),
+ * datagrams of up to CELLULAR_SOCK_HEX_MODE_MAX_LENGTH_BYTES
+ * are also sent without waiting for a prompt.  Sending stops
+ * at the first datagram that fails.
+ *
+ * @param descriptor     the descriptor of the socket.
+ * @param pDatagrams     an array of numDatagrams datagrams, each
+ *                       with pData, dataSizeBytes (which must be
+ *                       no more than
+ *                       CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES)
+ *                       and address filled in; the sizeBytes
+ *                       field of those sent is filled in.
+ * @param numDatagrams   the number of entries at pDatagrams.
+ * @return               on success the number of datagrams
+ *                       sent, which will be less than
+ *                       numDatagrams if one failed part way
+ *                       through, else negative error code.
+ */
+int32_t cellularSockSendToMulti(CellularSockDescriptor_t descriptor,
+                                CellularSockDatagram_t *pDatagrams,
+                                size_t numDatagrams);
+
 /** Receive a single datagram from the given host.
  *
  * @param descriptor     the descriptor of the socket.
@@ -541,11 +978,38 @@ int32_t cellularSockReceiveFrom(CellularSockDescriptor_t descriptor,
                                 CellularSockAddress_t *pRemoteAddress,
                                 void *pData, size_t dataSizeBytes);
 
+/** Receive a number of datagrams in one go, like recvmmsg():
+ * this blocks, if the socket is blocking, until at least one
+ * datagram has arrived and then receives as many as are waiting
+ * in the module, up to numDatagrams, with the AT interface locked
+ * just the once, rather than once per datagram as calling
+ * cellularSockReceiveFrom() repeatedly would.
+ *
+ * @param descriptor     the descriptor of the socket.
+ * @param pDatagrams     an array of numDatagrams datagrams, each
+ *                       with pData and dataSizeBytes filled in;
+ *                       as with cellularSockReceiveFrom(), the
+ *                       part of a datagram that does not fit
+ *                       into dataSizeBytes is thrown away.  The
+ *                       sizeBytes and address fields of those
+ *                       received are filled in.
+ * @param numDatagrams   the number of entries at pDatagrams.
+ * @return               on success the number of datagrams
+ *                       received else negative error code.
+ */
+int32_t cellularSockReceiveFromMulti(CellularSockDescriptor_t descriptor,
+                                     CellularSockDatagram_t *pDatagrams,
+                                     size_t numDatagrams);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: STREAM (TCP)
  * -------------------------------------------------------------- */
 
-/** Send data.
+/** Send data.  If the socket has a transmit buffer (see
+ * CELLULAR_SOCK_TX_BUFFER_SIZE_BYTES) the data may be held there
+ * for up to CELLULAR_SOCK_TX_FLUSH_TIME_MS before it is sent; if
+ * sending held data later fails, the next write or flush returns
+ * an error.
  *
  * @param descriptor     the descriptor of the socket.
  * @param pData          the data to send.
@@ -569,6 +1033,39 @@ int32_t cellularSockWrite(CellularSockDescriptor_t descriptor,
 int32_t cellularSockRead(CellularSockDescriptor_t descriptor,
                          void *pData, size_t dataSizeBytes);
 
+/** Send any data held in the transmit buffer of a TCP socket
+ * now, rather than waiting for the buffer to fill or its flush
+ * time to expire.
+ *
+ * @param descriptor     the descriptor of the socket.
+ * @return               zero on success else negative error code.
+ */
+int32_t cellularSockFlush(CellularSockDescriptor_t descriptor);
+
+/** Get the statistics of TCP reads and the receive cache,
+ * across all sockets, since they were last reset.
+ *
+ * @param pStats  a place to put the statistics.
+ * @return        zero on success else negative error code.
+ */
+int32_t cellularSockGetRxCacheStats(CellularSockRxCacheStats_t *pStats);
+
+/** Reset the statistics of TCP reads and the receive cache.
+ */
+void cellularSockResetRxCacheStats();
+
+/** Get the statistics of TCP writes and the transmit buffer,
+ * across all sockets, since they were last reset.
+ *
+ * @param pStats  a place to put the statistics.
+ * @return        zero on success else negative error code.
+ */
+int32_t cellularSockGetTxBufferStats(CellularSockTxBufferStats_t *pStats);
+
+/** Reset the statistics of TCP writes and the transmit buffer.
+ */
+void cellularSockResetTxBufferStats();
+
 /** Prepare a TCP socket for being closed.
  * This is provided for BSD socket compatibility however
  * it is not required for the u-blox AT sockets interface; all it
@@ -586,7 +1083,11 @@ int32_t cellularSockShutdown(CellularSockDescriptor_t descriptor,
  * -------------------------------------------------------------- */
 
 /** Register a callback which will be called when incoming
- * data has arrived on a socket.
+ * data has arrived on a socket.  Once the callback has been
+ * called it is not called again, however much more data
+ * arrives, until the application has read from the socket
+ * again, so read until there is nothing left before waiting
+ * for the next call.
  * The callback will be run in a task with stack size
  * CELLULAR_CTRL_TASK_CALLBACK_STACK_SIZE_BYTES and priority
  * CELLULAR_CTRL_TASK_CALLBACK_PRIORITY.
@@ -637,12 +1138,90 @@ int32_t cellularSockRegisterCallbackClosed(CellularSockDescriptor_t descriptor,
                                            void (*pCallback) (void *),
                                            void *pCallbackParam);
 
+/** Register a callback which will be called when a non-blocking
+ * TCP connection, see cellularSockConnect(), is made or fails,
+ * as reported by the module, or the CELLULAR_SOCK_OPT_CONTIMEO
+ * timeout passes first; read the CELLULAR_SOCK_OPT_ERROR socket
+ * option to find out which.
+ * The callback will be run in a task with stack size
+ * CELLULAR_CTRL_TASK_CALLBACK_STACK_SIZE_BYTES and priority
+ * CELLULAR_CTRL_TASK_CALLBACK_PRIORITY.
+ *
+ * IMPORTANT: don't spend long in your callback, i.e. don't
+ * call back into this API, don't call things that will cause any
+ * sort of processing load or might get stuck.
+ *
+ * @param descriptor     the descriptor of the socket.
+ * @param pCallback      the function to call, use NULL
+ *                       to cancel a previously registered
+ *                       callback.
+ * @param pCallbackParam parameter to be passed to the
+ *                       pCallback function when it is
+ *                       called; may be NULL.
+ * @return               zero on success else negative error
+ *                       code.
+ */
+int32_t cellularSockRegisterCallbackConnect(CellularSockDescriptor_t descriptor,
+                                            void (*pCallback) (void *),
+                                            void *pCallbackParam);
+
+/** Register a receiver for a TCP socket: rather than waiting
+ * for the application to call cellularSockRead(), this module
+ * reads data from the module itself as soon as the URC saying
+ * that data has arrived is received, passing it to the receiver
+ * while it is still in the receive buffer of the AT interface,
+ * so that there is no copy.  A segment read from the module may
+ * be passed in more than one span.  Data already in the receive
+ * cache of the socket is passed first.  Once a receiver is
+ * registered all of the incoming data of the socket goes to it:
+ * don't also call any of this module's data reception functions
+ * on the socket.
+ * The receiver will be run in a task with stack size
+ * CELLULAR_CTRL_TASK_CALLBACK_STACK_SIZE_BYTES and priority
+ * CELLULAR_CTRL_TASK_CALLBACK_PRIORITY, with the socket and the
+ * AT interface locked.
+ *
+ * IMPORTANT: the receiver MUST NOT call back into this API or
+ * into anything else that uses the AT interface, it should
+ * just consume or queue the data; pData is only valid for the
+ * duration of the call.  If the receiver cannot keep up it
+ * should return CELLULAR_SOCK_RECEIVER_PAUSE: the rest of the
+ * segment in hand will still be passed to it but nothing
+ * more will be read from the module, where the data will wait,
+ * until cellularSockReceiverResume() is called.
+ *
+ * @param descriptor the descriptor of the socket.
+ * @param pReceiver  the receiver, use NULL to cancel a
+ *                   previously registered receiver.
+ * @param pParam     parameter to be passed to pReceiver
+ *                   when it is called; may be NULL.
+ * @return           zero on success else negative error code.
+ */
+int32_t cellularSockRegisterReceiver(CellularSockDescriptor_t descriptor,
+                                     CellularSockReceiverAction_t (*pReceiver) (CellularSockDescriptor_t,
+                                                                                 const char *,
+                                                                                 size_t,
+                                                                                 void *),
+                                     void *pParam);
+
+/** Resume the passing of data to a receiver that has returned
+ * CELLULAR_SOCK_RECEIVER_PAUSE, see cellularSockRegisterReceiver().
+ *
+ * @param descriptor the descriptor of the socket.
+ * @return           zero on success else negative error code.
+ */
+int32_t cellularSockReceiverResume(CellularSockDescriptor_t descriptor);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: TCP INCOMING (TCP SERVER) ONLY
  * -------------------------------------------------------------- */
 
 /** Prepare a socket for receiving incoming TCP connections
- * by binding it to an address.
+ * by binding it to an address.  Only the port of the address
+ * is used, the module has just the one IP address, and the
+ * port must be non-zero since the module cannot choose one.
+ * A TCP socket goes on to cellularSockListen(); a UDP socket
+ * will receive datagrams sent to the port straight away.
  *
  * @param descriptor     the descriptor of the socket to be prepared.
  * @param pLocalAddress  the local IP address to bind to.
@@ -653,23 +1232,31 @@ int32_t cellularSockBind(CellularSockDescriptor_t descriptor,
 
 /** Set the given socket into listening mode for an incoming
  * TCP connection. The socket must have been bound to an address
- * first.
+ * first.  Incoming connections are queued until accepted;
+ * any that arrive when the queue is full are closed.
  *
  * @param descriptor the descriptor of the socket to listen on.
  * @param backlog    the number of pending connections that can
- *                   be queued.
+ *                   be queued, limited to between 1 and
+ *                   CELLULAR_SOCK_MODULE_MAX_NUM_SOCKETS.
  * @return           zero on success else negative error code.
  */
 int32_t cellularSockListen(CellularSockDescriptor_t descriptor,
                            size_t backlog);
 
 /** Accept an incoming TCP connection on the given socket.
+ * This blocks, up to the receive timeout of the listening
+ * socket, until a connection arrives; if the listening socket
+ * is non-blocking it returns at once with errno set to
+ * CELLULAR_SOCK_EWOULDBLOCK if there is no connection queued.
+ * A listening socket with a connection waiting is readable
+ * as far as cellularSockSelect() is concerned.
  *
  * @param descriptor      the descriptor of the socket with the queued
  *                        incoming connection.
  * @param pRemoteAddress  a pointer to a place to put the address
  *                        of the thing from which the connection has
- *                        been accepted.
+ *                        been accepted; may be NULL.
  * @return                the descriptor of the new socket connection
  *                        that must be used for TCP communication
  *                        with the thing from now on else negative
@@ -679,6 +1266,17 @@ int32_t cellularSockAccept(CellularSockDescriptor_t descriptor,
                            CellularSockAddress_t *pRemoteAddress);
 
 /** Select: wait for one of a set of sockets to become unblocked.
+ * A socket is readable when the module has indicated that
+ * received data is waiting or when a read would return an
+ * error without blocking, e.g. because the socket has been
+ * shut down for reading or is closing.  A socket is writable
+ * when it may be written to: for TCP once it is connected,
+ * for UDP once it has been created, in both cases until it
+ * is shut down for writing.  A socket that is closing is
+ * reported as exceptional.  The calling task is blocked, not
+ * polled, and is woken by the URCs from the module.  Any
+ * number of tasks up to CELLULAR_SOCK_MAX may be in a select
+ * at once.
  *
  * @param maxDescriptor         the highest numbered descriptor in the
  *                              sets that follow to select on + 1.
@@ -691,19 +1289,55 @@ int32_t cellularSockAccept(CellularSockDescriptor_t descriptor,
  * @param pExceptDescriptorSet  the set of descriptors to check for
  *                              exceptional conditions. May be NULL.
  * @param timeMs                the timeout for the select operation
- *                              in milliseconds.
- * @return                      a positive value if an unblocking
- *                              occurred, zero on timeout, negative
- *                              on any other error.  Use
- *                              CELLULAR_SOCK_FD_ISSET() to determine
- *                              which descriptor(s) were unblocked.
+ *                              in milliseconds, zero to check and
+ *                              return immediately, negative to
+ *                              wait forever.
+ * @return                      a positive value, the number of
+ *                              bits set in the three sets, if an
+ *                              unblocking occurred, zero on timeout,
+ *                              negative on any other error, e.g.
+ *                              if one of the descriptors is not
+ *                              that of an open socket, which
+ *                              includes a socket closed by the far
+ *                              end.  Use CELLULAR_SOCK_FD_ISSET() to
+ *                              determine which descriptor(s) were
+ *                              unblocked.
  */
 int32_t cellularSockSelect(int32_t maxDescriptor,
                            CellularSockDescriptorSet_t *pReadDescriptorSet,
-                           CellularSockDescriptorSet_t *pWriteDescriptoreSet,
+                           CellularSockDescriptorSet_t *pWriteDescriptorSet,
                            CellularSockDescriptorSet_t *pExceptDescriptorSet,
                            int32_t timeMs);
 
+/* ----------------------------------------------------------------
+ * FUNCTIONS: STATISTICS
+ * -------------------------------------------------------------- */
+
+/** Get the traffic statistics of the given socket since it
+ * was created.  Writes to a TCP socket that are held in its
+ * transmit buffer only count once they are sent to the module.
+ *
+ * @param descriptor the descriptor of the socket.
+ * @param pStats     a place to put the statistics.
+ * @return           zero on success else negative error code.
+ */
+int32_t cellularSockGetStats(CellularSockDescriptor_t descriptor,
+                             CellularSockStats_t *pStats);
+
+/** Get the traffic statistics of all sockets, open and closed,
+ * since they were last reset.  While other tasks are sending
+ * or receiving the total may be a moment behind.
+ *
+ * @param pStats  a place to put the statistics.
+ * @return        zero on success else negative error code.
+ */
+int32_t cellularSockGetStatsAll(CellularSockStats_t *pStats);
+
+/** Reset the traffic statistics of all sockets; the statistics
+ * of each socket, see cellularSockGetStats(), are not affected.
+ */
+void cellularSockResetStats();
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: FINDING ADDRESSES
  * -------------------------------------------------------------- */
@@ -731,7 +1365,11 @@ int32_t cellularSockGetLocalAddress(CellularSockDescriptor_t descriptor,
 /** Get the IP address of the given host name.  If the host name
  * is already an IP address then the IP address is returned 
  * straight away without any external action, hence this also
- * implements "get host by address".
+ * implements "get host by address".  The answer is kept in a
+ * cache, see CELLULAR_SOCK_DNS_CACHE_NUM_ENTRIES, so that
+ * asking again within CELLULAR_SOCK_DNS_CACHE_TTL_SECONDS, or
+ * CELLULAR_SOCK_DNS_CACHE_NEGATIVE_TTL_SECONDS if the host name
+ * could not be resolved, is answered without asking the module.
  *
  * @param pHostName      a string representing the host to search
  *                       for, e.g. "google.com" or "192.168.1.0".
@@ -744,6 +1382,98 @@ int32_t cellularSockGetLocalAddress(CellularSockDescriptor_t descriptor,
 int32_t cellularSockGetHostByName(const char *pHostName,
                                   CellularSockIpAddress_t *pHostIpAddress);
 
+/** Get the statistics of host name look-ups and the DNS cache
+ * since they were last reset.
+ *
+ * @param pStats  a place to put the statistics.
+ * @return        zero on success else negative error code.
+ */
+int32_t cellularSockGetDnsCacheStats(CellularSockDnsCacheStats_t *pStats);
+
+/** Reset the statistics of host name look-ups and the DNS cache.
+ */
+void cellularSockResetDnsCacheStats();
+
+/** Empty the DNS cache, e.g. because a server is known to have
+ * moved, so that the next look-up of each host name asks the
+ * module.
+ */
+void cellularSockFlushDnsCache();
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS: TLS
+ * -------------------------------------------------------------- */
+
+/** Store a credential, e.g. the root CA with which the module is
+ * to check the certificate of a server, in the module, where it
+ * stays, across power cycles, until it is removed or replaced.
+ * The credential is remembered, see
+ * CELLULAR_SOCK_TLS_CREDENTIAL_CACHE_NUM_ENTRIES, so that storing
+ * the same one again under the same name sends nothing.
+ *
+ * @param type          the type of credential.
+ * @param pName         the null-terminated name to store it under,
+ *                      no longer than
+ *                      CELLULAR_SOCK_TLS_CREDENTIAL_NAME_MAX_LENGTH_BYTES.
+ * @param pData         the credential, PEM or DER.
+ * @param dataSizeBytes the number of bytes at pData.
+ * @return              zero on success else negative error code.
+ */
+int32_t cellularSockTlsStoreCredential(CellularSockTlsCredentialType_t type,
+                                       const char *pName,
+                                       const char *pData,
+                                       size_t dataSizeBytes);
+
+/** Remove a credential from the module.
+ *
+ * @param type   the type of credential.
+ * @param pName  the null-terminated name it was stored under.
+ * @return       zero on success else negative error code.
+ */
+int32_t cellularSockTlsRemoveCredential(CellularSockTlsCredentialType_t type,
+                                        const char *pName);
+
+/** Get a security profile of the module set up with the given
+ * settings, for use with the CELLULAR_SOCK_OPT_TLS_SECURITY_PROFILE
+ * socket option.  If a profile has already been set up with the
+ * same settings it is returned as it is, nothing being sent to the
+ * module; this keeps the TLS session that the module holds for it,
+ * hence a reconnect to the same server with sessionResumption set
+ * needs only a short handshake.  Otherwise a profile not yet set up,
+ * or the profile used least recently, is set up afresh with
+ * AT+USECPRF.  If more differing settings are in use at once than
+ * there are profiles (CELLULAR_SOCK_TLS_NUM_SECURITY_PROFILES)
+ * then a profile may be changed while a socket is still being
+ * connected with it.  The settings of each profile are kept so
+ * that they can be compared one by one, hence the names of
+ * credentials may be no longer than
+ * CELLULAR_SOCK_TLS_CREDENTIAL_NAME_MAX_LENGTH_BYTES and the
+ * server name no longer than
+ * CELLULAR_SOCK_TLS_SERVER_NAME_MAX_LENGTH_BYTES.
+ *
+ * @param pProfile  the settings.
+ * @return          the security profile else negative error code.
+ */
+int32_t cellularSockTlsProfileGet(const CellularSockTlsProfile_t *pProfile);
+
+/** Get the statistics of the setting up of TLS in the module since
+ * they were last reset.
+ *
+ * @param pStats  a place to put the statistics.
+ * @return        zero on success else negative error code.
+ */
+int32_t cellularSockGetTlsCacheStats(CellularSockTlsCacheStats_t *pStats);
+
+/** Reset the statistics of the setting up of TLS in the module.
+ */
+void cellularSockResetTlsCacheStats();
+
+/** Forget which credentials have been stored in the module and
+ * how its security profiles have been set up, e.g. because
+ * something other than this API may have changed them, so that
+ * they are sent to the module again when next asked for.
+ */
+void cellularSockFlushTlsCache();
 
 /* ----------------------------------------------------------------
  * FUNCTIONS: ADDRESS CONVERSION
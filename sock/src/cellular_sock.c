@@ -24,6 +24,7 @@
 # include "cellular_cfg_override.h" // For a customer's configuration override
 #endif
 #include "cellular_cfg_sw.h"
+#include "cellular_cfg_os_platform_specific.h"
 #include "cellular_cfg_module.h"
 #include "cellular_port_clib.h"
 #include "cellular_port.h"
@@ -32,7 +33,7 @@
 #include "cellular_port_gpio.h"
 #include "cellular_port_uart.h"
 #include "cellular_ctrl_at.h"
-#include "cellular_ctrl.h" // For cellularCtrlGetIpAddressStr()
+#include "cellular_ctrl.h" // For cellularCtrlGetIpAddressStr() and hex mode
 #include "cellular_sock_errno.h"
 #include "cellular_sock.h"
 
@@ -40,10 +41,12 @@
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
-// Increment a socket descriptor.
-#define CELLULAR_SOCK_INC_DESCRIPTOR(d) (d)++;         \
-                                        if ((d) < 0) { \
-                                            d = 0;     \
+// Increment a socket descriptor, wrapping so that descriptors
+// always fit into a CellularSockDescriptorSet_t.
+#define CELLULAR_SOCK_INC_DESCRIPTOR(d) (d)++;                                \
+                                        if (((d) < 0) ||                      \
+                                            ((d) >= CELLULAR_SOCK_MAX)) {     \
+                                            d = 0;                            \
                                         }
 
 // Swap endianness.
@@ -68,10 +71,72 @@
 // as the module could be waiting for the ack of the ack of the ack.
 #define CELLULAR_SOCK_CLOSE_TIMEOUT_SECONDS 60
 
+// The timeout value for a DNS look-up: allow plenty of time.
+#define CELLULAR_SOCK_DNS_TIMEOUT_SECONDS 60
+
 // The value to use for socket-level options when talking to the
 // module (-1 as an int16_t)
 #define CELLULAR_SOCK_OPT_LEVEL_SOCK_INT16 65535
 
+// The longest that a blocking receive waits for data in one go.
+#define CELLULAR_SOCK_RECEIVE_WAIT_MAX_MS (1000 * 60 * 60)
+
+// The number of bytes of socket data converted to or from hex
+// in one go, on the stack.
+#define CELLULAR_SOCK_HEX_CHUNK_LENGTH_BYTES 32
+
+// An empty entry in the modem handle table.
+#define CELLULAR_SOCK_TABLE_ENTRY_NONE 0xFFFFFFFFUL
+
+// Make an entry for the modem handle table: the descriptor of the
+// container in the bottom 16 bits and its generation in the top
+// 16 bits, so that the entry can be written and read in one go.
+#define CELLULAR_SOCK_TABLE_ENTRY(descriptor, generation) ((((uint32_t) (generation)) << 16) | \
+                                                           (((uint32_t) (descriptor)) & 0xFFFF))
+
+// Get the descriptor from a modem handle table entry.
+#define CELLULAR_SOCK_TABLE_ENTRY_DESCRIPTOR(entry) ((CellularSockDescriptor_t) ((entry) & 0xFFFF))
+
+// Get the generation from a modem handle table entry.
+#define CELLULAR_SOCK_TABLE_ENTRY_GENERATION(entry) ((uint16_t) ((entry) >> 16))
+
+// The most connections that may wait in the accept queue of a
+// listening socket: more than the module can have open at once
+// would be pointless.
+#define CELLULAR_SOCK_ACCEPT_QUEUE_MAX_LENGTH CELLULAR_SOCK_MODULE_MAX_NUM_SOCKETS
+
+// The maximum number of tasks that may be in cellularSockSelect()
+// at the same time.
+#define CELLULAR_SOCK_SELECT_MAX_NUM_WAITERS CELLULAR_SOCK_MAX
+
+// The number of socket options that the module holds and of
+// which each socket keeps a local copy, see gShadowedOptions[].
+#define CELLULAR_SOCK_NUM_SHADOWED_OPTIONS 9
+
+// The AT+USECPRF op codes used when setting up a security profile.
+#define CELLULAR_SOCK_TLS_OP_VALIDATION         0
+#define CELLULAR_SOCK_TLS_OP_ROOT_CA_NAME       3
+#define CELLULAR_SOCK_TLS_OP_SERVER_NAME        4
+#define CELLULAR_SOCK_TLS_OP_CLIENT_CERT_NAME   5
+#define CELLULAR_SOCK_TLS_OP_CLIENT_KEY_NAME    6
+#define CELLULAR_SOCK_TLS_OP_SNI                10
+#define CELLULAR_SOCK_TLS_OP_SESSION_RESUMPTION 13
+
+// The stack size of the task that flushes transmit buffers.
+#ifndef CELLULAR_SOCK_TASK_TX_FLUSH_STACK_SIZE_BYTES
+# error CELLULAR_SOCK_TASK_TX_FLUSH_STACK_SIZE_BYTES must be defined in cellular_cfg_os_platform_specific.h
+#endif
+
+// The task priority of the task that flushes transmit buffers.
+#ifndef CELLULAR_SOCK_TASK_TX_FLUSH_PRIORITY
+# error CELLULAR_SOCK_TASK_TX_FLUSH_PRIORITY must be defined in cellular_cfg_os_platform_specific.h
+#endif
+
+// Each socket is a client of the AT arbiter.
+#if CELLULAR_CTRL_AT_CLIENT_SOCK + CELLULAR_SOCK_MAX > CELLULAR_CTRL_AT_MAX_NUM_CLIENTS
+# error CELLULAR_CTRL_AT_MAX_NUM_CLIENTS is too small for CELLULAR_SOCK_MAX sockets
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -79,7 +144,13 @@
 // Socket state
 typedef enum {
     CELLULAR_SOCK_STATE_CREATED,   //<! Freshly created, unsullied.
+    CELLULAR_SOCK_STATE_CONNECTING, //<! TCP non-blocking connect in
+                                    //< progress.
+    CELLULAR_SOCK_STATE_TIMED_OUT, //<! TCP non-blocking connect timed
+                                   //< out and abandoned in the module,
+                                   //< only good for closing.
     CELLULAR_SOCK_STATE_CONNECTED, //<! TCP connected or UDP has an address.
+    CELLULAR_SOCK_STATE_LISTENING, //<! TCP waiting for incoming connections.
     CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ,  //<! Block all reads.
     CELLULAR_SOCK_STATE_SHUTDOWN_FOR_WRITE, //<! Block all writes.
     CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE, //<! Block all reads and
@@ -91,6 +162,27 @@ typedef enum {
                                  //< container may be re-used
 } CellularSockState_t;
 
+// A socket option that the module holds.
+typedef struct {
+    int32_t level;
+    uint32_t option;
+} CellularSockOptionId_t;
+
+// The local copy of a socket option that the module holds.
+typedef struct {
+    int32_t value;  // For linger, l_onoff
+    int32_t value2; // For linger, l_linger
+    bool known;     // value is what the module has, or will have
+    bool pending;   // value has yet to be written to the module,
+                    // see optionsFlush()
+} CellularSockOptionShadow_t;
+
+// An incoming TCP connection waiting to be accepted.
+typedef struct {
+    int32_t modemHandle;
+    CellularSockAddress_t remoteAddress;
+} CellularSockAcceptEntry_t;
+
 // A socket.
  typedef struct {
      CellularSockType_t type;
@@ -99,23 +191,121 @@ typedef enum {
      CellularSockState_t state;
      CellularSockAddress_t remoteAddress;
      int64_t receiveTimeoutMs;
+     int64_t connectTimeoutMs;
+     int64_t connectStopTimeMs;     // When a non-blocking connect
+                                    // gives up
+     volatile int32_t pendingError; // The errno of a failed non-blocking
+                                    // connect, until it is read with
+                                    // CELLULAR_SOCK_OPT_ERROR
      bool nonBlocking;
      volatile int32_t pendingBytes;
+     size_t rxCacheSizeBytes;      // Wanted size of the receive cache
+     char *pRxCache;               // The receive cache, NULL if none
+     size_t rxCacheAllocatedBytes; // Actual size of the receive cache
+     size_t rxCacheOffset;         // Where the cached data starts
+     size_t rxCacheLength;         // Amount of data in the cache
+     size_t txBufferSizeBytes;      // Wanted size of the transmit buffer
+     char *pTxBuffer;               // The transmit buffer, NULL if none
+     size_t txBufferAllocatedBytes; // Actual size of the transmit buffer
+     size_t txBufferLength;         // Amount of data in the buffer
+     int64_t txBufferStartTimeMs;   // When the oldest data was buffered
+     bool txFlushFailed;            // Buffered data was lost, tell the
+                                    // next write or flush
+     bool noDelay;                  // TCP_NODELAY: don't buffer writes
+     int32_t securityProfile;       // The security profile the module
+                                    // runs TLS with, -1 for none
+     CellularSockOptionShadow_t optionShadow[CELLULAR_SOCK_NUM_SHADOWED_OPTIONS];
+                                    // Indexed as gShadowedOptions[]
+     uint16_t localPort;            // Set by bind, 0 if not bound
+     CellularSockAcceptEntry_t *pAcceptQueue; // Connections waiting to be
+                                              // accepted, NULL if not
+                                              // listening; protected,
+                                              // along with the three
+                                              // fields below, by
+                                              // gMutexAccept
+     size_t acceptQueueSize;        // Number of entries at pAcceptQueue
+     size_t acceptQueueStart;       // The oldest entry
+     volatile size_t acceptQueueLength; // Number of entries in use
      void (*pPendingDataCallback) (void *);
      void *pPendingDataCallbackParam;
+     volatile bool dataCallbackOutstanding; // The data callback has been
+                                            // queued and the application
+                                            // has not read since
      void (*pConnectionClosedCallback) (void *);
      void *pConnectionClosedCallbackParam;
+     void (*pConnectCallback) (void *);
+     void *pConnectCallbackParam;
+     CellularSockReceiverAction_t (*pReceiver) (CellularSockDescriptor_t,
+                                                const char *,
+                                                size_t,
+                                                void *);
+     void *pReceiverParam;
+     bool receiverPaused;           // The receiver asked for a pause
+     volatile bool receiverScheduled; // receiverRun() is queued
+     CellularSockStats_t stats;     // Updated with the socket locked,
+                                    // except by the URC handlers, which
+                                    // update only numUrcs,
+                                    // numDataCallbacks and, for a
+                                    // non-blocking connect, the connect
+                                    // fields
  } CellularSockSocket_t;
 
-// A socket container.
-typedef struct CellularSockContainer_t {
-    struct CellularSockContainer_t *pPrevious;
+// Something a task can block on until it is signalled: the queue
+// has room for one item and holds an item only when signalled is
+// true, hence signalling never blocks.  Protected by gMutexWait.
+typedef struct {
+    bool signalled;
+    CellularPortQueueHandle_t queueHandle;
+} CellularSockWait_t;
+
+// A task waiting in cellularSockSelect().
+typedef struct {
+    bool inUse;
+    CellularSockWait_t wait;
+} CellularSockSelectWaiter_t;
+
+// A socket container; the containers are a pool, indexed
+// by descriptor.
+typedef struct {
     CellularSockDescriptor_t descriptor;
-    bool isStatic;
+    uint16_t generation; // Incremented each time the container is used
+    CellularPortMutexHandle_t mutex; // Protects the socket, see
+                                     // pContainerLock()
+    CellularSockWait_t dataWait; // Signalled when data arrives
     CellularSockSocket_t socket;
-    struct CellularSockContainer_t *pNext;
 } CellularSockContainer_t;
 
+// An entry in the DNS cache, unused if the host name is empty.
+typedef struct {
+    char hostName[CELLULAR_SOCK_DNS_CACHE_HOST_NAME_MAX_LENGTH_BYTES + 1];
+    bool found; // false if the host name could not be resolved
+    CellularSockIpAddress_t ipAddress;
+    int64_t expiryTimeMs;
+    int64_t lastUsedTimeMs;
+} CellularSockDnsCacheEntry_t;
+
+// An entry in the TLS credential cache, unused if the name is empty.
+typedef struct {
+    CellularSockTlsCredentialType_t type;
+    char name[CELLULAR_SOCK_TLS_CREDENTIAL_NAME_MAX_LENGTH_BYTES + 1];
+    char *pData; // A copy of the credential, malloc()ed
+    size_t sizeBytes;
+    int64_t lastUsedTimeMs;
+} CellularSockTlsCredentialCacheEntry_t;
+
+// How a security profile of the module has been set up: the
+// names are empty where the settings had NULL.
+typedef struct {
+    bool setUp; // false if not known
+    CellularSockTlsValidation_t validation;
+    char rootCaName[CELLULAR_SOCK_TLS_CREDENTIAL_NAME_MAX_LENGTH_BYTES + 1];
+    char clientCertName[CELLULAR_SOCK_TLS_CREDENTIAL_NAME_MAX_LENGTH_BYTES + 1];
+    char clientKeyName[CELLULAR_SOCK_TLS_CREDENTIAL_NAME_MAX_LENGTH_BYTES + 1];
+    char serverName[CELLULAR_SOCK_TLS_SERVER_NAME_MAX_LENGTH_BYTES + 1];
+    bool sessionResumption;
+    int64_t lastUsedTimeMs;
+} CellularSockTlsProfileCacheEntry_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -123,29 +313,146 @@ typedef struct CellularSockContainer_t {
 // Keep track of whether we're initialised or not.
 static bool gInitialised = false;
 
-// Mutex to protect the container list.
+// Mutex to protect the container pool: the allocation of
+// containers, their generation and the modem handle table.
+// It is only ever held for a short time, never across an AT
+// command; each socket has its own mutex for that.  Where both
+// are needed the socket mutex is locked first.
 static CellularPortMutexHandle_t gMutexContainer = NULL;
 
-// Mutex to protect just the callbacks in the container list.
+// Mutex to protect the receive cache, transmit buffer and
+// socket option statistics, which are shared by all sockets.
+static CellularPortMutexHandle_t gMutexStats = NULL;
+
+// Mutex to protect just the callbacks in the container pool.
 static CellularPortMutexHandle_t gMutexCallbacks = NULL;
 
-// Root of the socket container list.
-static CellularSockContainer_t *gpContainerListHead = NULL;
+// Mutex to protect the things that tasks wait on.
+static CellularPortMutexHandle_t gMutexWait = NULL;
+
+// Mutex to protect the accept queues of listening sockets and
+// the modem handles waiting to be closed.
+static CellularPortMutexHandle_t gMutexAccept = NULL;
+
+// The modem handles of sockets that no socket of ours stands
+// for, waiting to be closed: incoming connections for which
+// there was no room in the accept queue and connects that
+// timed out.
+static int32_t gModemHandlesToClose[CELLULAR_SOCK_MODULE_MAX_NUM_SOCKETS];
+
+// The number of entries in gModemHandlesToClose.
+static size_t gNumModemHandlesToClose = 0;
+
+// Mutex to protect the DNS cache and its statistics.
+static CellularPortMutexHandle_t gMutexDns = NULL;
+
+#if CELLULAR_SOCK_DNS_CACHE_NUM_ENTRIES > 0
+// The DNS cache.
+static CellularSockDnsCacheEntry_t gDnsCache[CELLULAR_SOCK_DNS_CACHE_NUM_ENTRIES];
+#endif
+
+// Statistics of host name look-ups and the DNS cache.
+static CellularSockDnsCacheStats_t gDnsCacheStats = {0};
+
+// Mutex to protect the TLS caches and their statistics; when
+// both are needed it is locked before the AT interface.
+static CellularPortMutexHandle_t gMutexTls = NULL;
+
+#if CELLULAR_SOCK_TLS_CREDENTIAL_CACHE_NUM_ENTRIES > 0
+// The credentials stored in the module.
+static CellularSockTlsCredentialCacheEntry_t gTlsCredentialCache[CELLULAR_SOCK_TLS_CREDENTIAL_CACHE_NUM_ENTRIES];
+#endif
+
+// How the security profiles handed out by
+// cellularSockTlsProfileGet() have been set up.
+static CellularSockTlsProfileCacheEntry_t gTlsProfileCache[CELLULAR_SOCK_TLS_NUM_SECURITY_PROFILES];
+
+// Statistics of the setting up of TLS in the module.
+static CellularSockTlsCacheStats_t gTlsCacheStats = {0};
+
+// The tasks waiting in cellularSockSelect().
+static CellularSockSelectWaiter_t gSelectWaiters[CELLULAR_SOCK_SELECT_MAX_NUM_WAITERS];
+
+// Heap occupied by the receive caches.
+static size_t gRxCacheBytesInUse = 0;
+
+// Statistics of TCP reads and the receive cache.
+static CellularSockRxCacheStats_t gRxCacheStats = {0};
+
+// The socket options that the module holds: these only change
+// when they are set and so each socket keeps a copy of them.
+static const CellularSockOptionId_t gShadowedOptions[CELLULAR_SOCK_NUM_SHADOWED_OPTIONS] = {
+    {CELLULAR_SOCK_OPT_LEVEL_SOCK, CELLULAR_SOCK_OPT_REUSEADDR},
+    {CELLULAR_SOCK_OPT_LEVEL_SOCK, CELLULAR_SOCK_OPT_KEEPALIVE},
+    {CELLULAR_SOCK_OPT_LEVEL_SOCK, CELLULAR_SOCK_OPT_BROADCAST},
+    {CELLULAR_SOCK_OPT_LEVEL_SOCK, CELLULAR_SOCK_OPT_REUSEPORT},
+    {CELLULAR_SOCK_OPT_LEVEL_SOCK, CELLULAR_SOCK_OPT_LINGER},
+    {CELLULAR_SOCK_OPT_LEVEL_IP,   CELLULAR_SOCK_OPT_IP_TOS},
+    {CELLULAR_SOCK_OPT_LEVEL_IP,   CELLULAR_SOCK_OPT_IP_TTL},
+    {CELLULAR_SOCK_OPT_LEVEL_TCP,  CELLULAR_SOCK_OPT_TCP_NODELAY},
+    {CELLULAR_SOCK_OPT_LEVEL_TCP,  CELLULAR_SOCK_OPT_TCP_KEEPIDLE}
+};
+
+// Statistics of getting and setting the socket options that
+// the module holds.
+static CellularSockOptionCacheStats_t gOptionCacheStats = {0};
+
+// Heap occupied by the transmit buffers.
+static size_t gTxBufferBytesInUse = 0;
+
+// Statistics of TCP writes and the transmit buffer.
+static CellularSockTxBufferStats_t gTxBufferStats = {0};
+
+// The task that flushes transmit buffers, NULL until a socket
+// first has one.
+static CellularPortTaskHandle_t gTxFlushTaskHandle = NULL;
+
+// Signalled to wake up the flush task when data is first put
+// into a transmit buffer.
+static CellularSockWait_t gTxFlushWait = {0};
 
 // The next descriptor to use.
 static CellularSockDescriptor_t gNextDescriptor = 0;
 
-// Containers for statically allocated sockets.
-static CellularSockContainer_t gStaticContainers[CELLULAR_SOCK_NUM_STATIC_SOCKETS];
+// The pool of socket containers, indexed by descriptor.
+static CellularSockContainer_t gContainers[CELLULAR_SOCK_MAX];
+
+// The traffic statistics of the sockets whose containers have
+// since been re-used, protected by gMutexContainer.
+static CellularSockStats_t gStatsRetired = {0};
+
+// The traffic statistics of all sockets when they were last
+// reset, protected by gMutexContainer.
+static CellularSockStats_t gStatsBaseline = {0};
+
+// Modem handle to container: each entry is made with
+// CELLULAR_SOCK_TABLE_ENTRY(), CELLULAR_SOCK_TABLE_ENTRY_NONE if
+// unused.  Written with gMutexContainer locked, read without it
+// by the URC handlers, which check the generation of the entry
+// against that of the container to catch an entry made stale by
+// the container having since been re-used.
+static volatile uint32_t gModemHandleTable[CELLULAR_SOCK_MODULE_MAX_NUM_SOCKETS];
 
 /* ----------------------------------------------------------------
  * STATIC FUNCTION PROTOTYPES (ONLY WHERE REQUIRED)
  * -------------------------------------------------------------- */
 
 // Find the socket container for the given modem handle.
-// This does NOT lock the mutex, you need to do that.
 static CellularSockContainer_t *pContainerFindByModemHandle(int32_t modemHandle);
 
+// Signal a wait object.
+static void waitSignal(CellularSockWait_t *pWait);
+
+// Wake up any tasks waiting in cellularSockSelect().
+static void selectSignal();
+
+// Send data, TCP style.
+static int32_t send(CellularSockContainer_t *pContainer,
+                    const void *pData, size_t dataSizeBytes);
+
+// Queue receiverRun() for a socket.
+static void receiverSchedule(CellularSockContainer_t *pContainer);
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS: URCs
  * -------------------------------------------------------------- */
@@ -172,11 +479,29 @@ static void UUSORD_UUSORF_urc(void *pUnused)
         // Find the container
         pContainer = pContainerFindByModemHandle(modemHandle);
         if (pContainer != NULL) {
+            pContainer->socket.stats.numUrcs++;
             pContainer->socket.pendingBytes = dataSizeBytes;
+            waitSignal(&(pContainer->dataWait));
+            selectSignal();
+            if ((pContainer->socket.pReceiver != NULL) &&
+                !pContainer->socket.receiverPaused) {
+                receiverSchedule(pContainer);
+            }
+            // The module sends one of these for every arrival:
+            // pendingBytes, written above, is all a read needs
+            // so, once the data callback is queued, further URCs
+            // are coalesced until the application reads again,
+            // rather than filling the callback queue
             CELLULAR_PORT_MUTEX_LOCK(gMutexCallbacks);
-            if (pContainer->socket.pPendingDataCallback != NULL) {
-                cellular_ctrl_at_callback(pContainer->socket.pPendingDataCallback,
-                                          pContainer->socket.pPendingDataCallbackParam);
+            if ((pContainer->socket.pPendingDataCallback != NULL) &&
+                !pContainer->socket.dataCallbackOutstanding) {
+                pContainer->socket.dataCallbackOutstanding = true;
+                if (cellular_ctrl_at_callback(pContainer->socket.pPendingDataCallback,
+                                              pContainer->socket.pPendingDataCallbackParam)) {
+                    pContainer->socket.stats.numDataCallbacks++;
+                } else {
+                    pContainer->socket.dataCallbackOutstanding = false;
+                }
             }
             CELLULAR_PORT_MUTEX_UNLOCK(gMutexCallbacks);
         }
@@ -200,8 +525,11 @@ static void UUSOCL_urc(void *pUnused)
         // in progress and that already has the mutex
         pContainer = pContainerFindByModemHandle(modemHandle);
         if (pContainer != NULL) {
+            pContainer->socket.stats.numUrcs++;
             // Mark the container as closed
             pContainer->socket.state = CELLULAR_SOCK_STATE_CLOSED;
+            waitSignal(&(pContainer->dataWait));
+            selectSignal();
             CELLULAR_PORT_MUTEX_LOCK(gMutexCallbacks);
             if (pContainer->socket.pConnectionClosedCallback != NULL) {
                 cellular_ctrl_at_callback(pContainer->socket.pConnectionClosedCallback,
@@ -212,6 +540,167 @@ static void UUSOCL_urc(void *pUnused)
     }
 }
 
+// Close the sockets in gModemHandlesToClose; called via
+// cellular_ctrl_at_callback() since a URC handler can't send
+// AT commands.
+static void modemHandlesClose(void *pUnused)
+{
+    int32_t modemHandle = -1;
+
+    (void) pUnused;
+
+    do {
+        CELLULAR_PORT_MUTEX_LOCK(gMutexAccept);
+
+        modemHandle = -1;
+        if (gNumModemHandlesToClose > 0) {
+            gNumModemHandlesToClose--;
+            modemHandle = gModemHandlesToClose[gNumModemHandlesToClose];
+        }
+
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexAccept);
+
+        if (modemHandle >= 0) {
+            cellular_ctrl_at_lock();
+            cellular_ctrl_at_cmd_start("AT+USOCL=");
+            cellular_ctrl_at_write_int(modemHandle);
+            cellular_ctrl_at_cmd_stop_read_resp();
+            cellular_ctrl_at_unlock();
+        }
+    } while (modemHandle >= 0);
+}
+
+// Have a socket of the module that no socket of ours stands for
+// closed, from the callback task so that this may be called
+// from anywhere, including a URC handler.
+static void modemHandleCloseLater(int32_t modemHandle)
+{
+    bool queued = false;
+
+    CELLULAR_PORT_MUTEX_LOCK(gMutexAccept);
+
+    if (gNumModemHandlesToClose < sizeof(gModemHandlesToClose) /
+                                  sizeof(gModemHandlesToClose[0])) {
+        gModemHandlesToClose[gNumModemHandlesToClose] = modemHandle;
+        gNumModemHandlesToClose++;
+        queued = true;
+    }
+
+    CELLULAR_PORT_MUTEX_UNLOCK(gMutexAccept);
+
+    if (queued) {
+        cellular_ctrl_at_callback(modemHandlesClose, NULL);
+    }
+}
+
+// Callback for Socket Connect URC, the outcome of a non-blocking
+// connect.
+static void UUSOCO_urc(void *pUnused)
+{
+    int32_t modemHandle;
+    int32_t socketError;
+    CellularSockContainer_t *pContainer = NULL;
+
+    (void) pUnused;
+
+    // +UUSOCO: <socket>,<socket_error>
+    modemHandle = cellular_ctrl_at_read_int();
+    socketError = cellular_ctrl_at_read_int();
+    if (modemHandle >= 0) {
+
+        // Don't lock the container mutex here, as for the
+        // other URCs; a connect that has timed out has been
+        // abandoned, its modem handle with it, so is not found
+        pContainer = pContainerFindByModemHandle(modemHandle);
+        if ((pContainer != NULL) &&
+            (pContainer->socket.state == CELLULAR_SOCK_STATE_CONNECTING)) {
+            pContainer->socket.stats.numUrcs++;
+            if (socketError == 0) {
+                pContainer->socket.stats.numConnects++;
+                pContainer->socket.stats.connectTimeMs += (size_t) (cellularPortGetTickTimeMs() -
+                                                                    (pContainer->socket.connectStopTimeMs -
+                                                                     pContainer->socket.connectTimeoutMs));
+                pContainer->socket.state = CELLULAR_SOCK_STATE_CONNECTED;
+            } else {
+                // The socket error codes of the module are
+                // errno values
+                if (socketError < 0) {
+                    socketError = CELLULAR_SOCK_EHOSTUNREACH;
+                }
+                pContainer->socket.pendingError = socketError;
+                pContainer->socket.state = CELLULAR_SOCK_STATE_CREATED;
+            }
+            selectSignal();
+            CELLULAR_PORT_MUTEX_LOCK(gMutexCallbacks);
+            if (pContainer->socket.pConnectCallback != NULL) {
+                cellular_ctrl_at_callback(pContainer->socket.pConnectCallback,
+                                          pContainer->socket.pConnectCallbackParam);
+            }
+            CELLULAR_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+        }
+    }
+}
+
+// Callback for Socket Listen URC, an incoming TCP connection.
+static void UUSOLI_urc(void *pUnused)
+{
+    int32_t modemHandle;
+    int32_t listeningModemHandle;
+    CellularSockContainer_t *pContainer = NULL;
+    CellularSockAcceptEntry_t *pEntry;
+    CellularSockSocket_t *pSocket;
+    char buffer[CELLULAR_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
+    int32_t port;
+    bool queued = false;
+
+    (void) pUnused;
+
+    // +UUSOLI: <socket>,<ip_address>,<port>,<listening_socket>,
+    //          <local_ip_address>,<listening_port>
+    modemHandle = cellular_ctrl_at_read_int();
+    cellular_ctrl_at_read_string(buffer, sizeof(buffer), false);
+    port = cellular_ctrl_at_read_int();
+    listeningModemHandle = cellular_ctrl_at_read_int();
+
+    if (modemHandle >= 0) {
+
+        // Don't lock the container mutex here, as for the
+        // other URCs; the accept queue has its own mutex
+        pContainer = pContainerFindByModemHandle(listeningModemHandle);
+
+        CELLULAR_PORT_MUTEX_LOCK(gMutexAccept);
+
+        if (pContainer != NULL) {
+            pSocket = &(pContainer->socket);
+            pSocket->stats.numUrcs++;
+            if ((pSocket->pAcceptQueue != NULL) &&
+                (pSocket->acceptQueueLength < pSocket->acceptQueueSize)) {
+                pEntry = &(pSocket->pAcceptQueue[(pSocket->acceptQueueStart +
+                                                  pSocket->acceptQueueLength) %
+                                                 pSocket->acceptQueueSize]);
+                pCellularPort_memset(pEntry, 0, sizeof(*pEntry));
+                pEntry->modemHandle = modemHandle;
+                // If the address can't be understood, leave it empty
+                cellularSockStringToAddress(buffer, &(pEntry->remoteAddress));
+                pEntry->remoteAddress.port = (uint16_t) port;
+                pSocket->acceptQueueLength++;
+                queued = true;
+            }
+        }
+
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexAccept);
+
+        if (queued) {
+            waitSignal(&(pContainer->dataWait));
+            selectSignal();
+        } else {
+            // Nowhere to put it, close it rather than leave
+            // the module holding a socket that no-one knows of
+            modemHandleCloseLater(modemHandle);
+        }
+    }
+}
+
 // Callback for Connection Lost URC.
 static void UUPSDD_urc(void *pUnused)
 {
@@ -231,10 +720,6 @@ static void UUPSDD_urc(void *pUnused)
 // Initialise.
 static bool init()
 {
-    CellularSockContainer_t **ppContainer = &gpContainerListHead;
-    CellularSockContainer_t *pTmp = NULL;
-    CellularSockContainer_t **ppPreviousNext = NULL;
-
     // The mutexes are set up once only
     if (gMutexContainer == NULL) {
         cellularPortMutexCreate(&gMutexContainer);
@@ -242,26 +727,43 @@ static bool init()
     if (gMutexCallbacks == NULL) {
         cellularPortMutexCreate(&gMutexCallbacks);
     }
+    if (gMutexWait == NULL) {
+        cellularPortMutexCreate(&gMutexWait);
+    }
+    if (gMutexAccept == NULL) {
+        cellularPortMutexCreate(&gMutexAccept);
+    }
+    if (gMutexDns == NULL) {
+        cellularPortMutexCreate(&gMutexDns);
+    }
+    if (gMutexTls == NULL) {
+        cellularPortMutexCreate(&gMutexTls);
+    }
+    if (gMutexStats == NULL) {
+        cellularPortMutexCreate(&gMutexStats);
+    }
+    for (size_t x = 0; x < sizeof(gContainers) / sizeof(gContainers[0]); x++) {
+        if (gContainers[x].mutex == NULL) {
+            cellularPortMutexCreate(&(gContainers[x].mutex));
+        }
+    }
 
     if (!gInitialised) {
         cellular_ctrl_at_set_urc_handler("+UUSORD:", UUSORD_UUSORF_urc, NULL);
         cellular_ctrl_at_set_urc_handler("+UUSORF:", UUSORD_UUSORF_urc, NULL);
         cellular_ctrl_at_set_urc_handler("+UUSOCL:", UUSOCL_urc, NULL);
+        cellular_ctrl_at_set_urc_handler("+UUSOCO:", UUSOCO_urc, NULL);
+        cellular_ctrl_at_set_urc_handler("+UUSOLI:", UUSOLI_urc, NULL);
         cellular_ctrl_at_set_urc_handler("+UUPSDD:", UUPSDD_urc, NULL);
 
-        //  Link the static containers into the start of the container list
-        for (size_t x = 0; x < sizeof(gStaticContainers) / sizeof(gStaticContainers[0]); x++) {
-            *ppContainer = &gStaticContainers[x];
-            (*ppContainer)->isStatic = true;
-            (*ppContainer)->socket.state= CELLULAR_SOCK_STATE_CLOSED;
-            (*ppContainer)->pNext = NULL;
-            if (ppPreviousNext != NULL) {
-                *ppPreviousNext = *ppContainer;
-            }
-            ppPreviousNext = &((*ppContainer)->pNext);
-            (*ppContainer)->pPrevious = pTmp;
-            pTmp = *ppContainer;
-            ppContainer = &((*ppContainer)->pNext);
+        // Set up the container pool; the wait objects of the
+        // containers, like the mutexes, are kept from last time
+        for (size_t x = 0; x < sizeof(gContainers) / sizeof(gContainers[0]); x++) {
+            gContainers[x].descriptor = (CellularSockDescriptor_t) x;
+            gContainers[x].socket.state = CELLULAR_SOCK_STATE_CLOSED;
+        }
+        for (size_t x = 0; x < sizeof(gModemHandleTable) / sizeof(gModemHandleTable[0]); x++) {
+            gModemHandleTable[x] = CELLULAR_SOCK_TABLE_ENTRY_NONE;
         }
 
         gInitialised = true;
@@ -279,6 +781,8 @@ static void deinitButNotMutex()
         cellular_ctrl_at_remove_urc_handler("+UUSORD:");
         cellular_ctrl_at_remove_urc_handler("+UUSORF:");
         cellular_ctrl_at_remove_urc_handler("+UUSOCL:");
+        cellular_ctrl_at_remove_urc_handler("+UUSOCO:");
+        cellular_ctrl_at_remove_urc_handler("+UUSOLI:");
         cellular_ctrl_at_remove_urc_handler("+UUPSDD:");
         gInitialised = false;
     }
@@ -295,810 +799,4175 @@ static bool inline isBigEndian()
   return (bool) (*(const uint8_t *) &endianness);
 }
 
-/* ----------------------------------------------------------------
- * STATIC FUNCTIONS: CONTAINER STUFF
- * -------------------------------------------------------------- */
+// Add to one of the receive cache or transmit buffer statistics.
+static void statsAdd(size_t *pCount, size_t amount)
+{
+    CELLULAR_PORT_MUTEX_LOCK(gMutexStats);
 
-// Find the socket container for the given descriptor.
-// Will not find sockets in state CLOSED.
-// This does NOT lock the mutex, you need to do that.
-static CellularSockContainer_t *pContainerFindByDescriptor(CellularSockDescriptor_t descriptor)
+    *pCount += amount;
+
+    CELLULAR_PORT_MUTEX_UNLOCK(gMutexStats);
+}
+
+// Count the time since startTimeMs in a read or write latency
+// histogram of the traffic statistics of a socket.
+static void statsLatencyAdd(size_t *pHistogram, int64_t startTimeMs)
 {
-    CellularSockContainer_t *pContainer = NULL;
-    CellularSockContainer_t *pContainerThis = gpContainerListHead;
+    int64_t durationMs = cellularPortGetTickTimeMs() - startTimeMs;
+    size_t x = 0;
 
-    while ((pContainerThis != NULL) &&
-           (pContainer == NULL)) {
-        if ((pContainerThis->descriptor == descriptor) &&
-            (pContainerThis->socket.state != CELLULAR_SOCK_STATE_CLOSED)) {
-            pContainer = pContainerThis;
-        }
-        pContainerThis = pContainerThis->pNext;
+    while ((x < CELLULAR_SOCK_STATS_LATENCY_NUM_BUCKETS - 1) &&
+           (durationMs >= ((int64_t) CELLULAR_SOCK_STATS_LATENCY_FIRST_BUCKET_MS) << x)) {
+        x++;
     }
-
-    return pContainer;
+    pHistogram[x]++;
 }
 
-// Find the socket container for the given modem handle.
-// Will not find sockets in state CLOSED.
-// This does NOT lock the mutex, you need to do that.
-static CellularSockContainer_t *pContainerFindByModemHandle(int32_t modemHandle)
+// Add one traffic statistic to another or, if subtract is
+// true, take it away.
+static void statsSumOne(size_t *pTo, size_t from, bool subtract)
 {
-    CellularSockContainer_t *pContainer = NULL;
-    CellularSockContainer_t *pContainerThis = gpContainerListHead;
+    if (subtract) {
+        *pTo -= from;
+    } else {
+        *pTo += from;
+    }
+}
 
-    while ((pContainerThis != NULL) &&
-           (pContainer == NULL)) {
-        if ((pContainerThis->socket.modemHandle == modemHandle) &&
-            (pContainerThis->socket.state != CELLULAR_SOCK_STATE_CLOSED)) {
-            pContainer = pContainerThis;
-        }
-        pContainerThis = pContainerThis->pNext;
+// Add one set of traffic statistics to another or, if subtract
+// is true, take it away; a field added to CellularSockStats_t
+// must be added here also.
+static void statsSum(CellularSockStats_t *pTotal,
+                     const CellularSockStats_t *pStats,
+                     bool subtract)
+{
+    statsSumOne(&(pTotal->numBytesSent), pStats->numBytesSent, subtract);
+    statsSumOne(&(pTotal->numSegmentsSent), pStats->numSegmentsSent, subtract);
+    statsSumOne(&(pTotal->numBytesReceived), pStats->numBytesReceived, subtract);
+    statsSumOne(&(pTotal->numSegmentsReceived), pStats->numSegmentsReceived,
+                subtract);
+    statsSumOne(&(pTotal->numAtCommands), pStats->numAtCommands, subtract);
+    statsSumOne(&(pTotal->numPartialSends), pStats->numPartialSends, subtract);
+    statsSumOne(&(pTotal->numSendsAbandoned), pStats->numSendsAbandoned,
+                subtract);
+    statsSumOne(&(pTotal->numWouldBlocks), pStats->numWouldBlocks, subtract);
+    statsSumOne(&(pTotal->numUrcs), pStats->numUrcs, subtract);
+    statsSumOne(&(pTotal->numDataCallbacks), pStats->numDataCallbacks,
+                subtract);
+    statsSumOne(&(pTotal->numConnects), pStats->numConnects, subtract);
+    statsSumOne(&(pTotal->connectTimeMs), pStats->connectTimeMs, subtract);
+    for (size_t x = 0; x < CELLULAR_SOCK_STATS_LATENCY_NUM_BUCKETS; x++) {
+        statsSumOne(&(pTotal->readLatency[x]), pStats->readLatency[x],
+                    subtract);
+        statsSumOne(&(pTotal->writeLatency[x]), pStats->writeLatency[x],
+                    subtract);
     }
+}
 
-    return pContainer;
+// Add up the traffic statistics of all sockets, open and
+// closed, since the start.
+// This does NOT lock the container mutex, you need to do that.
+static void statsTotal(CellularSockStats_t *pTotal)
+{
+    *pTotal = gStatsRetired;
+    for (size_t x = 0; x < sizeof(gContainers) / sizeof(gContainers[0]); x++) {
+        statsSum(pTotal, &(gContainers[x].socket.stats), false);
+    }
 }
 
-// Determine the number of non-closed sockets.
-// This does NOT lock the mutex, you need to do that.
-static size_t numContainersInUse()
+// Re-arm the data callback of a socket: called as the application
+// starts to read so that data arriving from now on, which the
+// read may not see, is notified again.
+// This does NOT lock the socket, you need to do that.
+static void dataCallbackRearm(CellularSockSocket_t *pSocket)
 {
-    CellularSockContainer_t *pContainer = gpContainerListHead;
-    size_t numContainersInUse = 0;
+    pSocket->dataCallbackOutstanding = false;
+}
 
-    while (pContainer != NULL) {
-        if (pContainer->socket.state != CELLULAR_SOCK_STATE_CLOSED) {
-            numContainersInUse++;
+// Fail a non-blocking connect that has run out of time.  The
+// module would otherwise carry on connecting, so the socket is
+// closed there and, since a socket with no modem handle is no
+// use for anything else, from then on fails with ETIMEDOUT
+// until it is closed here too.
+// This does NOT lock the socket, you need to do that.
+static void connectCheckTimeout(CellularSockContainer_t *pContainer)
+{
+    CellularSockSocket_t *pSocket = &(pContainer->socket);
+
+    if ((pSocket->state == CELLULAR_SOCK_STATE_CONNECTING) &&
+        (cellularPortGetTickTimeMs() >= pSocket->connectStopTimeMs)) {
+        pSocket->pendingError = CELLULAR_SOCK_ETIMEDOUT;
+        pSocket->state = CELLULAR_SOCK_STATE_TIMED_OUT;
+        // A late +UUSOCO for the modem handle, or one
+        // for a socket that re-uses it, must not find us
+        modemHandleCloseLater(pSocket->modemHandle);
+        pSocket->modemHandle = -1;
+        selectSignal();
+        CELLULAR_PORT_MUTEX_LOCK(gMutexCallbacks);
+        if (pSocket->pConnectCallback != NULL) {
+            cellular_ctrl_at_callback(pSocket->pConnectCallback,
+                                      pSocket->pConnectCallbackParam);
         }
-        pContainer = pContainer->pNext;
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: WAITING
+ * -------------------------------------------------------------- */
+
+// Create the queue of a wait object if it doesn't already have one.
+static bool waitCreate(CellularSockWait_t *pWait)
+{
+    if (pWait->queueHandle == NULL) {
+        pWait->signalled = false;
+        cellularPortQueueCreate(1, sizeof(int32_t), &(pWait->queueHandle));
     }
 
-    return numContainersInUse;
+    return pWait->queueHandle != NULL;
 }
 
-// Create a socket in a container with the given descriptor.
-// This does NOT lock the mutex, you need to do that.
-static CellularSockContainer_t *pSockContainerCreate(CellularSockDescriptor_t descriptor,
-                                                     CellularSockType_t type,
-                                                     CellularSockProtocol_t protocol)
+// Signal a wait object, waking up whoever is blocked on it.
+// This does NOT lock gMutexWait, you need to do that.
+static void waitSignalNoLock(CellularSockWait_t *pWait)
 {
-    CellularSockContainer_t *pContainer = NULL;
-    CellularSockContainer_t *pContainerPrevious = NULL;
-    CellularSockContainer_t **ppContainerThis = &gpContainerListHead;
+    int32_t dummy = 0;
 
-    // Traverse the list, stopping if there is a container
-    // that holds a closed socket, which we could re-use
-    while ((*ppContainerThis != NULL) && (pContainer == NULL)) {
-        if ((*ppContainerThis)->socket.state == CELLULAR_SOCK_STATE_CLOSED) {
-            pContainer = *ppContainerThis;
-        }
-        pContainerPrevious = *ppContainerThis;
-        ppContainerThis = &((*ppContainerThis)->pNext);
+    if ((pWait->queueHandle != NULL) && !pWait->signalled) {
+        // Only one signal is outstanding at a time so this
+        // will not block
+        pWait->signalled = true;
+        cellularPortQueueSend(pWait->queueHandle, &dummy);
     }
+}
 
-    if (pContainer == NULL) {
-        // Reached the end of the list and found no re-usable
-        // containers, so allocate memory for the new container
-        // and add it to the list
-        pContainer = (CellularSockContainer_t *) pCellularPort_malloc(sizeof (*pContainer));
-        if (pContainer != NULL) {
-            pContainer->pPrevious = pContainerPrevious;
-            pContainer->pNext = NULL;
-            *ppContainerThis = pContainer;
-        }
+// Signal a wait object.
+static void waitSignal(CellularSockWait_t *pWait)
+{
+    if (gMutexWait != NULL) {
+
+        CELLULAR_PORT_MUTEX_LOCK(gMutexWait);
+
+        waitSignalNoLock(pWait);
+
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexWait);
     }
+}
 
-    // Set up the new container and socket
-    if (pContainer != NULL) {
-        pContainer->descriptor = descriptor;
-        pCellularPort_memset(&(pContainer->socket),
-                             0,
-                             sizeof(pContainer->socket));
-        pContainer->socket.type = type;
-        pContainer->socket.protocol = protocol;
-        pContainer->socket.modemHandle = -1;
-        pContainer->socket.state = CELLULAR_SOCK_STATE_CREATED;
-        pContainer->socket.receiveTimeoutMs = CELLULAR_SOCK_RECEIVE_TIMEOUT_DEFAULT_MS;
-        pContainer->socket.nonBlocking = false;
-        pContainer->socket.pPendingDataCallback = NULL;
-        pContainer->socket.pPendingDataCallbackParam = NULL;
-        pContainer->socket.pConnectionClosedCallback = NULL;
-        pContainer->socket.pConnectionClosedCallbackParam = NULL;
+// Clear any signal outstanding on a wait object.
+// This does NOT lock gMutexWait, you need to do that.
+static void waitClearNoLock(CellularSockWait_t *pWait)
+{
+    int32_t dummy;
+
+    if (pWait->signalled) {
+        cellularPortQueueTryReceive(pWait->queueHandle, 0, &dummy);
+        pWait->signalled = false;
     }
+}
 
-    return pContainer;
+// Clear any signal outstanding on a wait object.
+static void waitClear(CellularSockWait_t *pWait)
+{
+    CELLULAR_PORT_MUTEX_LOCK(gMutexWait);
+
+    waitClearNoLock(pWait);
+
+    CELLULAR_PORT_MUTEX_UNLOCK(gMutexWait);
 }
 
-// Free the container corresponding to the descriptor.
-// Has no effect on static containers.
-// This does NOT lock the mutex, you need to do that.
-static bool containerFree(CellularSockDescriptor_t descriptor)
+// Block on a wait object until it is signalled or for timeMs,
+// forever if timeMs is negative.  A signal given before the call
+// ends the wait immediately, so the caller should check whatever
+// it is waiting for after the call, not before it.
+static void waitBlock(CellularSockWait_t *pWait, int32_t timeMs)
 {
-    CellularSockContainer_t **ppContainer = NULL;
-    CellularSockContainer_t **ppContainerThis = &gpContainerListHead;
-    bool success = false;
+    int32_t dummy;
+    bool received;
 
-    while ((*ppContainerThis != NULL) &&
-           (ppContainer == NULL)) {
-        if ((*ppContainerThis)->descriptor == descriptor) {
-            ppContainer = ppContainerThis;
-        } else {
-            ppContainerThis = &((*ppContainerThis)->pNext);
-        }
+    if (timeMs < 0) {
+        received = (cellularPortQueueReceive(pWait->queueHandle, &dummy) == 0);
+    } else {
+        received = (cellularPortQueueTryReceive(pWait->queueHandle,
+                                                timeMs, &dummy) == 0);
     }
 
-    if ((ppContainer != NULL) && (*ppContainer != NULL)) {
-        if (!(*ppContainer)->isStatic) {
-            // If we found it, and it wasn't static, free it
-            // If there is a previous container, move its pNext
-            if ((*ppContainer)->pPrevious != NULL) {
-                (*ppContainer)->pPrevious->pNext = (*ppContainer)->pNext;
-            }
-            // If there is a next container, move its pPrevious
-            if ((*ppContainer)->pNext != NULL) {
-                (*ppContainer)->pNext->pPrevious = (*ppContainer)->pPrevious;
-            }
-
-            // Free the memory and NULL the pointer
-            cellularPort_free(*ppContainer);
-            *ppContainer = NULL;
-        } else {
-            // Nothing to do for a static container, 
-        }
+    CELLULAR_PORT_MUTEX_LOCK(gMutexWait);
 
-        success = true;
+    if (received) {
+        pWait->signalled = false;
+    } else {
+        // Timed out: a signal may have arrived in the meantime
+        waitClearNoLock(pWait);
     }
 
-    return success;
+    CELLULAR_PORT_MUTEX_UNLOCK(gMutexWait);
 }
 
 /* ----------------------------------------------------------------
- * STATIC FUNCTIONS: ADDRESS CONVERSION
+ * STATIC FUNCTIONS: RECEIVE CACHE
  * -------------------------------------------------------------- */
 
-// Given a string, which may be an IP address or a
-// domain name, return a pointer to the separator
-// character for the port number part of it,
-// or NULL if there is no port number
-static const char *pAddressPortSeparator(const char *pAddress)
+// Get the receive cache of a socket, allocating it if the socket
+// should have one and the budget allows, NULL if there is none.
+// This does NOT lock the mutex, you need to do that.
+static char *pRxCacheGet(CellularSockSocket_t *pSocket)
 {
-    const char *pColon = NULL;
+    size_t sizeBytes = pSocket->rxCacheSizeBytes;
 
-    if (pAddress != NULL) {
-        // If there's a square bracket at the start of
-        // the domain string then we've been given an
-        // IPV6 address with port number so move
-        // the pointer to the closing square bracket
-        if (*pAddress == '[') {
-            pAddress = pCellularPort_strchr(pAddress, ']');
+    if ((pSocket->pRxCache == NULL) && (sizeBytes > 0)) {
+        // No point in being bigger than the most the
+        // module will give us in one go
+        if (sizeBytes > CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES) {
+            sizeBytes = CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES;
         }
-        if (pAddress != NULL) {
-            // Check for a port number on the end
-            pColon = pCellularPort_strchr(pAddress, ':');
-            if (pColon != NULL) {
-                // Check if there are more colons in the
-                // string: if so this is an IPV6 address
-                // without a port number on the end
-                if (pCellularPort_strchr(pColon + 1, ':') != NULL) {
-                    pColon = NULL;
-                }
+
+        CELLULAR_PORT_MUTEX_LOCK(gMutexStats);
+
+        // Take from the budget before allocating, another
+        // socket may be after it at the same time
+        if (gRxCacheBytesInUse + sizeBytes <= CELLULAR_SOCK_RX_CACHE_BUDGET_BYTES) {
+            gRxCacheBytesInUse += sizeBytes;
+        } else {
+            sizeBytes = 0;
+        }
+
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexStats);
+
+        if (sizeBytes > 0) {
+            pSocket->pRxCache = (char *) pCellularPort_malloc(sizeBytes);
+            if (pSocket->pRxCache != NULL) {
+                pSocket->rxCacheAllocatedBytes = sizeBytes;
+                pSocket->rxCacheOffset = 0;
+                pSocket->rxCacheLength = 0;
+            } else {
+                // Give it back
+                statsAdd(&gRxCacheBytesInUse, -sizeBytes);
             }
         }
     }
 
-    return pColon;
+    return pSocket->pRxCache;
 }
 
-// Determine whether the given IP address string is IPV4.
-static bool addressStringIsIpv4(const char *pAddressString)
+// Free the receive cache of a socket, losing anything in it.
+// This does NOT lock the mutex, you need to do that.
+static void rxCacheFree(CellularSockSocket_t *pSocket)
 {
-    // If it's got a dot in it, must be IPV4
-    return (pCellularPort_strchr(pAddressString, '.') != NULL);
+    if (pSocket->pRxCache != NULL) {
+        cellularPort_free(pSocket->pRxCache);
+        pSocket->pRxCache = NULL;
+        statsAdd(&gRxCacheBytesInUse, -pSocket->rxCacheAllocatedBytes);
+        pSocket->rxCacheAllocatedBytes = 0;
+        pSocket->rxCacheOffset = 0;
+        pSocket->rxCacheLength = 0;
+    }
 }
 
-// Convert an IPV4 address string "xxx.yyy.www.zzz:65535" into
-// a struct.
-static bool ipv4StringToAddress(const char *pAddressString,
-                                CellularSockAddress_t *pAddress)
+// Copy data out of the receive cache of a socket, returning
+// the number of bytes copied.
+// This does NOT lock the mutex, you need to do that.
+static size_t rxCacheRead(CellularSockSocket_t *pSocket,
+                          char *pData, size_t dataSizeBytes)
 {
-    bool success = true;
-    uint32_t a;
-    uint32_t b;
-    uint32_t c;
-    uint32_t d;
-    uint32_t port;
-    const char *pColon;
-
-    pAddress->ipAddress.type = CELLULAR_SOCK_ADDRESS_TYPE_V4;
-    pAddress->ipAddress.address.ipv4 = 0;
-    pAddress->port = 0;
-
-    // Get the IP address part
-    if (cellularPort_sscanf(pAddressString, "%u.%u.%u.%u",
-                            &a, &b, &c, &d) == 4) {
-        // Range check
-        if ((a <= UCHAR_MAX) && (b <= UCHAR_MAX) &&
-            (c <= UCHAR_MAX) && (d <= UCHAR_MAX)) {
-
-            // Calculate the IP address part, network byte order
-            pAddress->ipAddress.address.ipv4 = (a << 24) |
-                                               (b << 16) |
-                                               (c << 8)  |
-                                               (d << 0);
-
-            // Check for a port number on the end
-            pColon = pCellularPort_strchr(pAddressString, ':');
-            if (pColon != NULL) {
-                // Fill in the port number
-                port = cellularPort_strtol(pColon + 1, NULL, 10);
-                if (port <= USHRT_MAX) {
-                    pAddress->port = port;
-                } else {
-                    success = false;
-                }
-            }
-        } else {
-            success = false;
-        }
-    } else {
-        success = false;
+    if (dataSizeBytes > pSocket->rxCacheLength) {
+        dataSizeBytes = pSocket->rxCacheLength;
+    }
+    if (dataSizeBytes > 0) {
+        pCellularPort_memcpy(pData,
+                             pSocket->pRxCache + pSocket->rxCacheOffset,
+                             dataSizeBytes);
+        pSocket->rxCacheOffset += dataSizeBytes;
+        pSocket->rxCacheLength -= dataSizeBytes;
     }
 
-    return success;
+    return dataSizeBytes;
 }
 
-// Convert an IPV6 address string "2001:0db8:85a3:0000:0000:8a2e:0370:7334" 
-// or "[2001:0db8:85a3:0000:0000:8a2e:0370:7334]:65535" into a struct.
-static bool ipv6StringToAddress(const char *pAddressString,
-                                CellularSockAddress_t *pAddress)
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: TRANSMIT BUFFER
+ * -------------------------------------------------------------- */
+
+// Send whatever is in the transmit buffer of a socket, returning
+// false if it could not all be sent, in which case it is lost.
+// This does NOT lock the mutex, you need to do that.
+static bool txBufferFlush(CellularSockContainer_t *pContainer)
 {
+    CellularSockSocket_t *pSocket = &(pContainer->socket);
     bool success = true;
-    size_t stringLength = cellularPort_strlen(pAddressString);
-    bool hasPort = false;
-    uint32_t a;
-    uint32_t b;
-    uint32_t c;
-    uint32_t d;
-    uint32_t e;
-    uint32_t f;
-    uint32_t g;
-    uint32_t h;
-    uint32_t port;
-    const char *pStr;
 
-    pAddress->ipAddress.type = CELLULAR_SOCK_ADDRESS_TYPE_V6;
-    pCellularPort_memset(pAddress->ipAddress.address.ipv6, 0,
-                         sizeof(pAddress->ipAddress.address.ipv6));
-    pAddress->port = 0;
-
-    // See if there's a '[' on the start
-    if ((stringLength > 0) && (*pAddressString == '[')) {
-        hasPort = true;
-        pAddressString++;
+    if (pSocket->txBufferLength > 0) {
+        success = (send(pContainer, pSocket->pTxBuffer,
+                        pSocket->txBufferLength) == (int32_t) pSocket->txBufferLength);
+        pSocket->txBufferLength = 0;
     }
 
-    // Get the IP address part
-    if (cellularPort_sscanf(pAddressString, "%x:%x:%x:%x:%x:%x:%x:%x",
-                            &a, &b, &c, &d, &e, &f, &g, &h) == 8) {
-        // Range check
-        if ((a <= USHRT_MAX) && (b <= USHRT_MAX) &&
-            (c <= USHRT_MAX) && (d <= USHRT_MAX) &&
-            (e <= USHRT_MAX) && (f <= USHRT_MAX) &&
-            (g <= USHRT_MAX) && (h <= USHRT_MAX)) {
-
-            // Slot the uint16_t's into the array in network-byte order
-            pAddress->ipAddress.address.ipv6[3] = (a << 16) | (b & 0xFFFF);
-            pAddress->ipAddress.address.ipv6[2] = (c << 16) | (d & 0xFFFF);
-            pAddress->ipAddress.address.ipv6[1] = (e << 16) | (f & 0xFFFF);
-            pAddress->ipAddress.address.ipv6[0] = (g << 16) | (h & 0xFFFF);
+    return success;
+}
 
-            // Get the port number if there was one
-            if (hasPort) {
-                pStr = pCellularPort_strchr(pAddressString, ']');
-                if (pStr != NULL) {
-                    pStr = pCellularPort_strchr(pStr, ':');
-                    if (pStr != NULL) {
-                        // Fill in the port number
-                        port = cellularPort_strtol(pStr + 1, NULL, 10);
-                        if (port <= USHRT_MAX) {
-                            pAddress->port = port;
-                        } else {
-                            success = false;
+// Flush the transmit buffers of sockets whose flush time has
+// expired, returning how long until the next one will expire,
+// -1 if no socket has anything buffered.
+static int32_t txBufferFlushExpired()
+{
+    CellularSockSocket_t *pSocket;
+    int64_t nowMs;
+    int64_t dueMs;
+    int32_t waitMs = -1;
+
+    for (size_t x = 0; x < sizeof(gContainers) / sizeof(gContainers[0]); x++) {
+        pSocket = &(gContainers[x].socket);
+        if (pSocket->txBufferLength > 0) {
+            // Don't wait on a socket that is busy, e.g. connecting
+            // or sending, it may be a while; come back to it
+            if (cellularPortMutexTryLock(gContainers[x].mutex, 0) == 0) {
+                nowMs = cellularPortGetTickTimeMs();
+                if (pSocket->txBufferLength == 0) {
+                    // Sent while we were getting here
+                } else if ((pSocket->state != CELLULAR_SOCK_STATE_CONNECTED) &&
+                           (pSocket->state != CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ)) {
+                    // Closed under our feet, nowhere to send it
+                    pSocket->txBufferLength = 0;
+                } else {
+                    dueMs = pSocket->txBufferStartTimeMs + CELLULAR_SOCK_TX_FLUSH_TIME_MS;
+                    if (dueMs <= nowMs) {
+                        statsAdd(&gTxBufferStats.numTimedFlushes, 1);
+                        if (!txBufferFlush(&(gContainers[x]))) {
+                            pSocket->txFlushFailed = true;
                         }
+                    } else if ((waitMs < 0) || (dueMs - nowMs < waitMs)) {
+                        waitMs = (int32_t) (dueMs - nowMs);
                     }
-                } else {
-                    success = false;
                 }
+                cellularPortMutexUnlock(gContainers[x].mutex);
+            } else if ((waitMs < 0) || (CELLULAR_SOCK_TX_FLUSH_TIME_MS < waitMs)) {
+                waitMs = CELLULAR_SOCK_TX_FLUSH_TIME_MS;
             }
-        } else {
-            success = false;
         }
-    } else {
-        success = false;
     }
 
-    return success;
+    return waitMs;
 }
 
-// Convert an IP address struct (i.e. without a port number) into a
-// string, returning the length of the string.
-static int32_t ipAddressToString(const CellularSockIpAddress_t *pIpAddress,
-                                 char *pBuffer,
-                                 size_t sizeBytes)
+// Fail the non-blocking connects that have run out of time,
+// returning how long until the next one will, -1 if no socket
+// is connecting.
+static int32_t connectTimeoutsExpired()
 {
-    CellularSockErrorCode_t stringLengthOrError = CELLULAR_SOCK_INVALID_PARAMETER;
-    int32_t thisLength;
-
-    // Convert the address in network byte order (MSB first);
-    switch (pIpAddress->type) {
-        case CELLULAR_SOCK_ADDRESS_TYPE_V4:
-            stringLengthOrError = cellularPort_snprintf(pBuffer,
-                                                        sizeBytes,
-                                                        "%u.%u.%u.%u",
-                                                        (pIpAddress->address.ipv4 >> 24) & 0xFF,
-                                                        (pIpAddress->address.ipv4 >> 16) & 0xFF,
-                                                        (pIpAddress->address.ipv4 >> 8)  & 0xFF,
-                                                        (pIpAddress->address.ipv4 >> 0)  & 0xFF);
-        break;
-        case CELLULAR_SOCK_ADDRESS_TYPE_V6:
-            stringLengthOrError = 0;
-            for (int32_t x = 3; (x >= 0) && (stringLengthOrError >= 0); x--) {
-                thisLength = cellularPort_snprintf(pBuffer,
-                                                   sizeBytes,
-                                                   "%x:%x",
-                                                   (pIpAddress->address.ipv6[x] >> 16) & 0xFFFF,
-                                                   (pIpAddress->address.ipv6[x] >> 0)  & 0xFFFF);
-                if (x > 0) {
-                    if ((thisLength >= 0) && (thisLength < sizeBytes)) {
-                        *(pBuffer + thisLength) = ':';
-                        thisLength++;
-                    } else {
-                        thisLength = CELLULAR_SOCK_NO_MEMORY;
-                    }
-                }
-                if ((thisLength >= 0) && (thisLength < sizeBytes)) {
-                    sizeBytes -= thisLength;
-                    pBuffer += thisLength;
-                    stringLengthOrError += thisLength;
-                } else {
-                    stringLengthOrError = CELLULAR_SOCK_NO_MEMORY;
+    CellularSockSocket_t *pSocket;
+    int64_t nowMs;
+    int32_t waitMs = -1;
+
+    for (size_t x = 0; x < sizeof(gContainers) / sizeof(gContainers[0]); x++) {
+        pSocket = &(gContainers[x].socket);
+        if (pSocket->state == CELLULAR_SOCK_STATE_CONNECTING) {
+            if (cellularPortMutexTryLock(gContainers[x].mutex, 0) == 0) {
+                connectCheckTimeout(&(gContainers[x]));
+                nowMs = cellularPortGetTickTimeMs();
+                if ((pSocket->state == CELLULAR_SOCK_STATE_CONNECTING) &&
+                    ((waitMs < 0) || (pSocket->connectStopTimeMs - nowMs < waitMs))) {
+                    waitMs = (int32_t) (pSocket->connectStopTimeMs - nowMs);
                 }
+                cellularPortMutexUnlock(gContainers[x].mutex);
+            } else if ((waitMs < 0) || (CELLULAR_SOCK_TX_FLUSH_TIME_MS < waitMs)) {
+                // Busy, come back to it
+                waitMs = CELLULAR_SOCK_TX_FLUSH_TIME_MS;
             }
-        break;
-        default:
-        break;
+        }
     }
 
-    return (int32_t) stringLengthOrError;
+    return waitMs;
 }
 
-// Convert an address struct, which includes a port number,
-// into a string, returning the length of the string.
-static int32_t addressToString(const CellularSockAddress_t *pAddress,
-                               bool includePortNumber,
-                               char *pBuffer,
-                               size_t sizeBytes)
+// Task to flush transmit buffers when their flush time expires
+// and to fail non-blocking connects when theirs does, so that
+// the connect callback is called without anyone having to ask.
+static void txFlushTask(void *pParam)
 {
-    CellularSockErrorCode_t stringLengthOrError = 0;
-    int32_t thisLength;
+    int32_t waitMs;
+    int32_t connectWaitMs;
 
-    if (includePortNumber) {
-        // If this is an IPV6 address, then start with a square bracket
-        // to delineate the IP address part
-        if (pAddress->ipAddress.type == CELLULAR_SOCK_ADDRESS_TYPE_V6) {
-            if (sizeBytes > 1) {
-                *pBuffer = '[';
-                stringLengthOrError++;
-                sizeBytes--;
-                pBuffer++;
-            } else {
-                stringLengthOrError = CELLULAR_SOCK_NO_MEMORY;
-            }
+    (void) pParam;
+
+    for (;;) {
+        waitMs = txBufferFlushExpired();
+        connectWaitMs = connectTimeoutsExpired();
+        if ((waitMs < 0) ||
+            ((connectWaitMs >= 0) && (connectWaitMs < waitMs))) {
+            waitMs = connectWaitMs;
         }
-        // Do the IP address part
-        if (stringLengthOrError >= 0) {
-            thisLength = ipAddressToString(&(pAddress->ipAddress), pBuffer, sizeBytes);
-            if (thisLength >= 0) {
-                sizeBytes -= thisLength;
-                pBuffer += thisLength;
-                stringLengthOrError += thisLength;
-                // If this is an IPV6 address then close the square brackets
-                if (pAddress->ipAddress.type == CELLULAR_SOCK_ADDRESS_TYPE_V6) {
-                    if (sizeBytes > 1) {
-                        *pBuffer = ']';
-                        stringLengthOrError++;
-                        sizeBytes--;
-                        pBuffer++;
-                    } else {
-                        stringLengthOrError = CELLULAR_SOCK_NO_MEMORY;
-                    }
-                }
-            } else {
-                stringLengthOrError = CELLULAR_SOCK_NO_MEMORY;
-            }
+        waitBlock(&gTxFlushWait, waitMs);
+    }
+}
+
+// Start the task that flushes transmit buffers and times out
+// non-blocking connects if it is not already running; like the
+// mutexes, once started it is never stopped.
+static bool txFlushTaskStart()
+{
+    if ((gTxFlushTaskHandle == NULL) && waitCreate(&gTxFlushWait)) {
+        if (cellularPortTaskCreate(txFlushTask, "sock_tx_flush",
+                                   CELLULAR_SOCK_TASK_TX_FLUSH_STACK_SIZE_BYTES,
+                                   NULL,
+                                   CELLULAR_SOCK_TASK_TX_FLUSH_PRIORITY,
+                                   &gTxFlushTaskHandle) != 0) {
+            gTxFlushTaskHandle = NULL;
         }
-        // Add the port number
-        if (stringLengthOrError >= 0) {
-            thisLength = cellularPort_snprintf(pBuffer,
-                                               sizeBytes,
-                                               ":%u",
-                                               pAddress->port);
-            if (thisLength < sizeBytes) {
-                stringLengthOrError += thisLength;
-            } else {
-                stringLengthOrError = CELLULAR_SOCK_NO_MEMORY;
-            }
+    }
+
+    return gTxFlushTaskHandle != NULL;
+}
+
+// Get the transmit buffer of a socket, allocating it if the
+// socket should have one, NULL if there is none.
+// This does NOT lock the mutex, you need to do that.
+static char *pTxBufferGet(CellularSockSocket_t *pSocket)
+{
+    size_t sizeBytes = pSocket->txBufferSizeBytes;
+
+    if ((pSocket->pTxBuffer == NULL) && (sizeBytes > 0) &&
+        txFlushTaskStart()) {
+        // No point in being bigger than the most the
+        // module will take in one go
+        if (sizeBytes > CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES) {
+            sizeBytes = CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES;
+        }
+        pSocket->pTxBuffer = (char *) pCellularPort_malloc(sizeBytes);
+        if (pSocket->pTxBuffer != NULL) {
+            pSocket->txBufferAllocatedBytes = sizeBytes;
+            pSocket->txBufferLength = 0;
+            statsAdd(&gTxBufferBytesInUse, sizeBytes);
         }
-    } else {
-        // No port number required, just do the ipAddress part
-        stringLengthOrError = ipAddressToString(&(pAddress->ipAddress), pBuffer, sizeBytes);
     }
 
-    return (int32_t) stringLengthOrError;
+    return pSocket->pTxBuffer;
 }
 
-/* ----------------------------------------------------------------
- * STATIC FUNCTIONS: SOCKET OPTIONS
- * -------------------------------------------------------------- */
+// Free the transmit buffer of a socket, losing anything in it.
+// This does NOT lock the mutex, you need to do that.
+static void txBufferFree(CellularSockSocket_t *pSocket)
+{
+    if (pSocket->pTxBuffer != NULL) {
+        cellularPort_free(pSocket->pTxBuffer);
+        pSocket->pTxBuffer = NULL;
+        statsAdd(&gTxBufferBytesInUse, -pSocket->txBufferAllocatedBytes);
+        pSocket->txBufferAllocatedBytes = 0;
+        pSocket->txBufferLength = 0;
+    }
+}
 
-// Set a socket option that has an integer as a parameter.
-static int32_t setOptionInt(CellularSockDescriptor_t descriptor,
-                            int32_t modemHandle,
-                            int32_t level,
-                            uint32_t option,
-                            const void *pOptionValue,
-                            size_t optionValueLength,
+// Send data, TCP style, gathering it in the transmit buffer of
+// the socket if it has one.
+// This does NOT lock the mutex, you need to do that.
+static int32_t sendBuffered(CellularSockContainer_t *pContainer,
+                            const char *pData, size_t dataSizeBytes,
                             int32_t *pErrno)
 {
-    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockErrorCode_t errorCodeOrSize = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockSocket_t *pSocket = &(pContainer->socket);
+    char *pTxBuffer = NULL;
+    bool success = true;
 
-    if ((pOptionValue != NULL) && 
-        (optionValueLength >= sizeof(int32_t))) {
-        if (level == CELLULAR_SOCK_OPT_LEVEL_SOCK) {
-            level = CELLULAR_SOCK_OPT_LEVEL_SOCK_INT16;
+    statsAdd(&gTxBufferStats.numWrites, 1);
+    if (!pSocket->noDelay) {
+        pTxBuffer = pTxBufferGet(pSocket);
+    }
+
+    if (pSocket->txFlushFailed) {
+        // Data accepted by an earlier write has been lost
+        pSocket->txFlushFailed = false;
+        *pErrno = CELLULAR_SOCK_EIO;
+    } else if (pTxBuffer == NULL) {
+        errorCodeOrSize = send(pContainer, pData, dataSizeBytes);
+    } else {
+        // Make room, or send what we have ahead of data that
+        // would not fit in the buffer anyway
+        if (pSocket->txBufferLength + dataSizeBytes > pSocket->txBufferAllocatedBytes) {
+            success = txBufferFlush(pContainer);
         }
-        cellular_ctrl_at_lock();
-        cellular_ctrl_at_cmd_start("AT+USOSO=");
-        cellular_ctrl_at_write_int(modemHandle);
-        cellular_ctrl_at_write_int(level);
-        cellular_ctrl_at_write_int(option);
-        cellular_ctrl_at_write_int(*((int32_t *) pOptionValue));
-        cellular_ctrl_at_cmd_stop_read_resp();
-        if (cellular_ctrl_at_unlock_return_error() == 0) {
-            cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, socket option %d:0x%04x (%d) set to %d.\n",
-                            descriptor, modemHandle,
-                            level, option, option,
-                            *((int32_t *) pOptionValue));
-            errorCode = CELLULAR_SOCK_SUCCESS;
-        } else {
-            // Module doesn't support it so it's an
-            // invalid parameter
-            *pErrno = CELLULAR_SOCK_EINVAL;
+        if (success) {
+            if (dataSizeBytes >= pSocket->txBufferAllocatedBytes) {
+                errorCodeOrSize = send(pContainer, pData, dataSizeBytes);
+            } else {
+                if (pSocket->txBufferLength == 0) {
+                    pSocket->txBufferStartTimeMs = cellularPortGetTickTimeMs();
+                    // Let the flush task know there is a new deadline
+                    waitSignal(&gTxFlushWait);
+                }
+                pCellularPort_memcpy(pTxBuffer + pSocket->txBufferLength,
+                                     pData, dataSizeBytes);
+                pSocket->txBufferLength += dataSizeBytes;
+                if (pSocket->txBufferLength == pSocket->txBufferAllocatedBytes) {
+                    success = txBufferFlush(pContainer);
+                }
+                if (success) {
+                    errorCodeOrSize = dataSizeBytes;
+                }
+            }
+        }
+        if (!success) {
+            *pErrno = CELLULAR_SOCK_EIO;
         }
-    } else {
-        *pErrno = CELLULAR_SOCK_EINVAL;
     }
 
-    return (int32_t) errorCode;
+    if (errorCodeOrSize >= 0) {
+        statsAdd(&gTxBufferStats.numBytesWritten, errorCodeOrSize);
+    }
+
+    return (int32_t) errorCodeOrSize;
 }
 
-// Get a socket option that has an integer as a parameter.
-static int32_t getOptionInt(CellularSockDescriptor_t descriptor,
-                            int32_t modemHandle,
-                            int32_t level,
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: CONTAINER STUFF
+ * -------------------------------------------------------------- */
+
+// Free the accept queue of a socket, losing anything in it.
+// This does NOT lock the socket, you need to do that.
+static void acceptQueueFree(CellularSockSocket_t *pSocket)
+{
+    CELLULAR_PORT_MUTEX_LOCK(gMutexAccept);
+
+    if (pSocket->pAcceptQueue != NULL) {
+        cellularPort_free(pSocket->pAcceptQueue);
+        pSocket->pAcceptQueue = NULL;
+        pSocket->acceptQueueSize = 0;
+        pSocket->acceptQueueStart = 0;
+        pSocket->acceptQueueLength = 0;
+    }
+
+    CELLULAR_PORT_MUTEX_UNLOCK(gMutexAccept);
+}
+
+// Find the socket container for the given descriptor.
+// Will not find sockets in state CLOSED.
+// This does NOT lock any mutex, use pContainerLock() for that.
+static CellularSockContainer_t *pContainerFindByDescriptor(CellularSockDescriptor_t descriptor)
+{
+    CellularSockContainer_t *pContainer = NULL;
+
+    if ((descriptor >= 0) && (descriptor < CELLULAR_SOCK_MAX) &&
+        (gContainers[descriptor].socket.state != CELLULAR_SOCK_STATE_CLOSED)) {
+        pContainer = &(gContainers[descriptor]);
+    }
+
+    return pContainer;
+}
+
+// Find the socket container for the given modem handle.
+// Will not find sockets in state CLOSED.
+// This may be called without the mutex locked, e.g. from
+// a URC handler.
+static CellularSockContainer_t *pContainerFindByModemHandle(int32_t modemHandle)
+{
+    CellularSockContainer_t *pContainer = NULL;
+    CellularSockContainer_t *pContainerThis;
+    CellularSockDescriptor_t descriptor;
+    uint32_t entry;
+
+    if ((modemHandle >= 0) &&
+        (modemHandle < CELLULAR_SOCK_MODULE_MAX_NUM_SOCKETS)) {
+        // Read the entry once, it may be changing under us
+        entry = gModemHandleTable[modemHandle];
+        descriptor = CELLULAR_SOCK_TABLE_ENTRY_DESCRIPTOR(entry);
+        if ((entry != CELLULAR_SOCK_TABLE_ENTRY_NONE) &&
+            (descriptor < CELLULAR_SOCK_MAX)) {
+            pContainerThis = &(gContainers[descriptor]);
+            if ((pContainerThis->generation == CELLULAR_SOCK_TABLE_ENTRY_GENERATION(entry)) &&
+                (pContainerThis->socket.modemHandle == modemHandle) &&
+                (pContainerThis->socket.state != CELLULAR_SOCK_STATE_CLOSED)) {
+                pContainer = pContainerThis;
+            }
+        }
+    }
+
+    return pContainer;
+}
+
+// Find the socket container for the given descriptor and
+// lock its socket, NULL if there is no such socket; unlock it
+// again with containerUnlock().  The container mutex is only
+// held for the look-up, so that a socket which is busy, e.g.
+// in the middle of connecting, holds up no-one but those who
+// want the same socket.
+static CellularSockContainer_t *pContainerLock(CellularSockDescriptor_t descriptor)
+{
+    CellularSockContainer_t *pContainer;
+    uint16_t generation = 0;
+
+    CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
+
+    pContainer = pContainerFindByDescriptor(descriptor);
+    if (pContainer != NULL) {
+        generation = pContainer->generation;
+    }
+
+    CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+
+    if (pContainer != NULL) {
+        cellularPortMutexLock(pContainer->mutex);
+        if ((pContainer->generation != generation) ||
+            (pContainer->socket.state == CELLULAR_SOCK_STATE_CLOSED)) {
+            // Closed, and maybe re-used, while we waited
+            cellularPortMutexUnlock(pContainer->mutex);
+            pContainer = NULL;
+        }
+    }
+
+    return pContainer;
+}
+
+// Unlock the socket of a container locked by pContainerLock()
+// or pSockContainerCreate(); pContainer may be NULL.
+static void containerUnlock(CellularSockContainer_t *pContainer)
+{
+    if (pContainer != NULL) {
+        cellularPortMutexUnlock(pContainer->mutex);
+    }
+}
+
+// Record the modem handle of the socket in a container.
+// The socket must be locked, this locks the container mutex.
+static void containerSetModemHandle(CellularSockContainer_t *pContainer,
+                                    int32_t modemHandle)
+{
+    CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
+
+    pContainer->socket.modemHandle = modemHandle;
+    if ((modemHandle >= 0) &&
+        (modemHandle < CELLULAR_SOCK_MODULE_MAX_NUM_SOCKETS)) {
+        gModemHandleTable[modemHandle] = CELLULAR_SOCK_TABLE_ENTRY(pContainer->descriptor,
+                                                                   pContainer->generation);
+    }
+
+    CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+}
+
+// Create a socket in a free container, starting the search
+// for one at the next descriptor in turn, so that a descriptor
+// which has just been closed is not immediately re-used.  The
+// socket is returned locked, unlock it with containerUnlock().
+// This locks the container mutex.
+static CellularSockContainer_t *pSockContainerCreate(CellularSockType_t type,
+                                                     CellularSockProtocol_t protocol)
+{
+    CellularSockContainer_t *pContainer = NULL;
+    CellularSockDescriptor_t descriptor;
+
+    CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
+
+    descriptor = gNextDescriptor;
+    for (size_t x = 0; (x < CELLULAR_SOCK_MAX) && (pContainer == NULL); x++) {
+        // A closed socket may still be locked by someone who
+        // has yet to notice, e.g. if the far end closed it; only
+        // try the lock, waiting for it here would be waiting
+        // with the container mutex locked
+        if ((gContainers[descriptor].socket.state == CELLULAR_SOCK_STATE_CLOSED) &&
+            (cellularPortMutexTryLock(gContainers[descriptor].mutex, 0) == 0)) {
+            pContainer = &(gContainers[descriptor]);
+            gNextDescriptor = descriptor;
+            CELLULAR_SOCK_INC_DESCRIPTOR(gNextDescriptor);
+        }
+        CELLULAR_SOCK_INC_DESCRIPTOR(descriptor);
+    }
+
+    if ((pContainer != NULL) && !waitCreate(&(pContainer->dataWait))) {
+        // Can't have a socket that nothing can wait on
+        containerUnlock(pContainer);
+        pContainer = NULL;
+    }
+
+    // Set up the new container and socket
+    if (pContainer != NULL) {
+        // Any modem handle table entry still pointing
+        // here is now stale, as is anyone who found
+        // the last socket and is waiting for its lock
+        pContainer->generation++;
+        // Lose any signal left over from the last socket
+        waitClear(&(pContainer->dataWait));
+        // The last socket may have been closed by the far end
+        // without its receive cache or transmit buffer being freed
+        rxCacheFree(&(pContainer->socket));
+        txBufferFree(&(pContainer->socket));
+        acceptQueueFree(&(pContainer->socket));
+        // Keep the traffic statistics of the last socket
+        // in the totals
+        statsSum(&gStatsRetired, &(pContainer->socket.stats), false);
+        pCellularPort_memset(&(pContainer->socket),
+                             0,
+                             sizeof(pContainer->socket));
+        pContainer->socket.type = type;
+        pContainer->socket.protocol = protocol;
+        pContainer->socket.modemHandle = -1;
+        pContainer->socket.state = CELLULAR_SOCK_STATE_CREATED;
+        pContainer->socket.receiveTimeoutMs = CELLULAR_SOCK_RECEIVE_TIMEOUT_DEFAULT_MS;
+        pContainer->socket.connectTimeoutMs = CELLULAR_SOCK_CONNECT_TIMEOUT_DEFAULT_MS;
+        pContainer->socket.pendingError = CELLULAR_SOCK_ENONE;
+        pContainer->socket.nonBlocking = false;
+        pContainer->socket.rxCacheSizeBytes = CELLULAR_SOCK_RX_CACHE_SIZE_BYTES;
+        pContainer->socket.pRxCache = NULL;
+        pContainer->socket.txBufferSizeBytes = CELLULAR_SOCK_TX_BUFFER_SIZE_BYTES;
+        pContainer->socket.pTxBuffer = NULL;
+        pContainer->socket.noDelay = false;
+        pContainer->socket.securityProfile = -1;
+        pContainer->socket.pPendingDataCallback = NULL;
+        pContainer->socket.pPendingDataCallbackParam = NULL;
+        pContainer->socket.dataCallbackOutstanding = false;
+        pContainer->socket.pConnectionClosedCallback = NULL;
+        pContainer->socket.pConnectionClosedCallbackParam = NULL;
+        pContainer->socket.pConnectCallback = NULL;
+        pContainer->socket.pConnectCallbackParam = NULL;
+        pContainer->socket.pReceiver = NULL;
+        pContainer->socket.pReceiverParam = NULL;
+    }
+
+    CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+
+    return pContainer;
+}
+
+// Lock the AT interface on behalf of a socket, each socket
+// being a client of the AT arbiter in its own right.
+static void atLock(const CellularSockContainer_t *pContainer)
+{
+    cellular_ctrl_at_lock_client(CELLULAR_CTRL_AT_CLIENT_SOCK +
+                                 pContainer->descriptor);
+}
+
+// Return a container to the pool, waking up anyone waiting
+// for data on its socket so that they notice.
+// This does NOT lock the socket, you need to do that.
+static void containerFree(CellularSockContainer_t *pContainer)
+{
+    rxCacheFree(&(pContainer->socket));
+    txBufferFree(&(pContainer->socket));
+    acceptQueueFree(&(pContainer->socket));
+    pContainer->socket.state = CELLULAR_SOCK_STATE_CLOSED;
+    waitSignal(&(pContainer->dataWait));
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: DNS CACHE
+ * -------------------------------------------------------------- */
+
+#if CELLULAR_SOCK_DNS_CACHE_NUM_ENTRIES > 0
+
+// Find the unexpired DNS cache entry for a host name, NULL if
+// there is none; expired entries met on the way are freed.
+// This does NOT lock the DNS mutex, you need to do that.
+static CellularSockDnsCacheEntry_t *pDnsCacheFind(const char *pHostName,
+                                                  int64_t nowMs)
+{
+    CellularSockDnsCacheEntry_t *pEntry = NULL;
+
+    for (size_t x = 0; (pEntry == NULL) &&
+                       (x < sizeof(gDnsCache) / sizeof(gDnsCache[0])); x++) {
+        if (gDnsCache[x].hostName[0] != 0) {
+            if (nowMs >= gDnsCache[x].expiryTimeMs) {
+                gDnsCache[x].hostName[0] = 0;
+            } else if (cellularPort_strcmp(gDnsCache[x].hostName,
+                                           pHostName) == 0) {
+                pEntry = &(gDnsCache[x]);
+            }
+        }
+    }
+
+    return pEntry;
+}
+
+// Put the result of looking up a host name into the DNS
+// cache, pIpAddress being NULL if it could not be resolved,
+// making way by dropping the least recently used entry.
+// This does NOT lock the DNS mutex, you need to do that.
+static void dnsCacheAdd(const char *pHostName,
+                        const CellularSockIpAddress_t *pIpAddress,
+                        int64_t nowMs)
+{
+    CellularSockDnsCacheEntry_t *pEntry;
+
+    if (cellularPort_strlen(pHostName) <= CELLULAR_SOCK_DNS_CACHE_HOST_NAME_MAX_LENGTH_BYTES) {
+        // Another task may have got there first
+        pEntry = pDnsCacheFind(pHostName, nowMs);
+        for (size_t x = 0; (pEntry == NULL) &&
+                           (x < sizeof(gDnsCache) / sizeof(gDnsCache[0])); x++) {
+            if (gDnsCache[x].hostName[0] == 0) {
+                pEntry = &(gDnsCache[x]);
+            }
+        }
+        if (pEntry == NULL) {
+            pEntry = &(gDnsCache[0]);
+            for (size_t x = 1; x < sizeof(gDnsCache) / sizeof(gDnsCache[0]); x++) {
+                if (gDnsCache[x].lastUsedTimeMs < pEntry->lastUsedTimeMs) {
+                    pEntry = &(gDnsCache[x]);
+                }
+            }
+        }
+        pCellularPort_memset(pEntry, 0, sizeof(*pEntry));
+        pCellularPort_strcpy(pEntry->hostName, pHostName);
+        pEntry->lastUsedTimeMs = nowMs;
+        if (pIpAddress != NULL) {
+            pEntry->found = true;
+            pCellularPort_memcpy(&(pEntry->ipAddress), pIpAddress,
+                                 sizeof(pEntry->ipAddress));
+            pEntry->expiryTimeMs = nowMs +
+                                   ((int64_t) CELLULAR_SOCK_DNS_CACHE_TTL_SECONDS * 1000);
+        } else {
+            pEntry->expiryTimeMs = nowMs +
+                                   ((int64_t) CELLULAR_SOCK_DNS_CACHE_NEGATIVE_TTL_SECONDS * 1000);
+        }
+    }
+}
+
+#endif
+
+// Look up a host name in the DNS cache, returning true if
+// it was there, in which case *pFound is set to whether it
+// could be resolved and, if so, *pIpAddress to its address.
+// This does NOT lock the DNS mutex, you need to do that.
+static bool dnsCacheLookUp(const char *pHostName, bool *pFound,
+                           CellularSockIpAddress_t *pIpAddress)
+{
+    bool cached = false;
+#if CELLULAR_SOCK_DNS_CACHE_NUM_ENTRIES > 0
+    int64_t nowMs = cellularPortGetTickTimeMs();
+    CellularSockDnsCacheEntry_t *pEntry;
+
+    pEntry = pDnsCacheFind(pHostName, nowMs);
+    if (pEntry != NULL) {
+        pEntry->lastUsedTimeMs = nowMs;
+        *pFound = pEntry->found;
+        if (pEntry->found) {
+            pCellularPort_memcpy(pIpAddress, &(pEntry->ipAddress),
+                                 sizeof(*pIpAddress));
+            gDnsCacheStats.numHits++;
+        } else {
+            gDnsCacheStats.numNegativeHits++;
+        }
+        cached = true;
+    }
+#else
+    (void) pHostName;
+    (void) pFound;
+    (void) pIpAddress;
+#endif
+
+    return cached;
+}
+
+// Put the result of looking up a host name into the DNS cache,
+// pIpAddress being NULL if it could not be resolved.
+// This does NOT lock the DNS mutex, you need to do that.
+static void dnsCacheStore(const char *pHostName,
+                          const CellularSockIpAddress_t *pIpAddress)
+{
+#if CELLULAR_SOCK_DNS_CACHE_NUM_ENTRIES > 0
+    if ((pIpAddress != NULL) ||
+        (CELLULAR_SOCK_DNS_CACHE_NEGATIVE_TTL_SECONDS > 0)) {
+        dnsCacheAdd(pHostName, pIpAddress, cellularPortGetTickTimeMs());
+    }
+#else
+    (void) pHostName;
+    (void) pIpAddress;
+#endif
+}
+
+// Empty the DNS cache.
+// This does NOT lock the DNS mutex, you need to do that.
+static void dnsCacheFlush()
+{
+#if CELLULAR_SOCK_DNS_CACHE_NUM_ENTRIES > 0
+    pCellularPort_memset(gDnsCache, 0, sizeof(gDnsCache));
+#endif
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: TLS
+ * -------------------------------------------------------------- */
+
+// Determine whether a string of the settings of a security
+// profile, which may be NULL, fits into the profile cache.
+static bool tlsProfileStringIsValid(const char *pString,
+                                    size_t maxLength)
+{
+    return (pString == NULL) || (cellularPort_strlen(pString) <= maxLength);
+}
+
+// Determine whether a string of the settings of a security
+// profile, which may be NULL, is the same as that kept in
+// the profile cache.
+static bool tlsProfileStringIsSame(const char *pString,
+                                   const char *pCached)
+{
+    if (pString == NULL) {
+        pString = "";
+    }
+
+    return (cellularPort_strcmp(pString, pCached) == 0);
+}
+
+// Keep a string of the settings of a security profile, which
+// may be NULL, in the profile cache; it must have been checked
+// with tlsProfileStringIsValid().
+static void tlsProfileStringCopy(char *pCached, const char *pString)
+{
+    if (pString == NULL) {
+        pString = "";
+    }
+    pCellularPort_strcpy(pCached, pString);
+}
+
+// Determine whether a security profile has been set up with
+// the given settings, comparing every one of them.
+static bool tlsProfileIsSame(const CellularSockTlsProfileCacheEntry_t *pEntry,
+                             const CellularSockTlsProfile_t *pProfile)
+{
+    return pEntry->setUp &&
+           (pEntry->validation == pProfile->validation) &&
+           tlsProfileStringIsSame(pProfile->pRootCaName,
+                                  pEntry->rootCaName) &&
+           tlsProfileStringIsSame(pProfile->pClientCertName,
+                                  pEntry->clientCertName) &&
+           tlsProfileStringIsSame(pProfile->pClientKeyName,
+                                  pEntry->clientKeyName) &&
+           tlsProfileStringIsSame(pProfile->pServerName,
+                                  pEntry->serverName) &&
+           (pEntry->sessionResumption == pProfile->sessionResumption);
+}
+
+#if CELLULAR_SOCK_TLS_CREDENTIAL_CACHE_NUM_ENTRIES > 0
+
+// Find the TLS credential cache entry for a credential, NULL
+// if there is none.
+// This does NOT lock the TLS mutex, you need to do that.
+static CellularSockTlsCredentialCacheEntry_t *pTlsCredentialCacheFind(CellularSockTlsCredentialType_t type,
+                                                                      const char *pName)
+{
+    CellularSockTlsCredentialCacheEntry_t *pEntry = NULL;
+
+    for (size_t x = 0; (pEntry == NULL) &&
+                       (x < sizeof(gTlsCredentialCache) / sizeof(gTlsCredentialCache[0])); x++) {
+        if ((gTlsCredentialCache[x].name[0] != 0) &&
+            (gTlsCredentialCache[x].type == type) &&
+            (cellularPort_strcmp(gTlsCredentialCache[x].name, pName) == 0)) {
+            pEntry = &(gTlsCredentialCache[x]);
+        }
+    }
+
+    return pEntry;
+}
+
+// Put a credential that has been stored in the module into the
+// TLS credential cache, making way by dropping the least recently
+// used entry.
+// This does NOT lock the TLS mutex, you need to do that.
+static void tlsCredentialCacheAdd(CellularSockTlsCredentialType_t type,
+                                  const char *pName, const char *pData,
+                                  size_t sizeBytes)
+{
+    CellularSockTlsCredentialCacheEntry_t *pEntry;
+
+    pEntry = pTlsCredentialCacheFind(type, pName);
+    for (size_t x = 0; (pEntry == NULL) &&
+                       (x < sizeof(gTlsCredentialCache) / sizeof(gTlsCredentialCache[0])); x++) {
+        if (gTlsCredentialCache[x].name[0] == 0) {
+            pEntry = &(gTlsCredentialCache[x]);
+        }
+    }
+    if (pEntry == NULL) {
+        pEntry = &(gTlsCredentialCache[0]);
+        for (size_t x = 1; x < sizeof(gTlsCredentialCache) / sizeof(gTlsCredentialCache[0]); x++) {
+            if (gTlsCredentialCache[x].lastUsedTimeMs < pEntry->lastUsedTimeMs) {
+                pEntry = &(gTlsCredentialCache[x]);
+            }
+        }
+    }
+    if (pEntry->pData != NULL) {
+        cellularPort_free(pEntry->pData);
+    }
+    // Without a copy to compare against, the credential
+    // would have to be stored again next time anyway
+    pEntry->pData = (char *) pCellularPort_malloc(sizeBytes);
+    if (pEntry->pData != NULL) {
+        pCellularPort_memcpy(pEntry->pData, pData, sizeBytes);
+        pEntry->type = type;
+        pCellularPort_strcpy(pEntry->name, pName);
+        pEntry->sizeBytes = sizeBytes;
+        pEntry->lastUsedTimeMs = cellularPortGetTickTimeMs();
+    } else {
+        pEntry->name[0] = 0;
+    }
+}
+
+// Remove an entry from the TLS credential cache.
+// This does NOT lock the TLS mutex, you need to do that.
+static void tlsCredentialCacheRemove(CellularSockTlsCredentialCacheEntry_t *pEntry)
+{
+    if (pEntry->pData != NULL) {
+        cellularPort_free(pEntry->pData);
+        pEntry->pData = NULL;
+    }
+    pEntry->name[0] = 0;
+}
+
+#endif
+
+// Look up a credential in the TLS credential cache, returning
+// true if exactly the same credential has already been stored
+// in the module under the same name.
+// This does NOT lock the TLS mutex, you need to do that.
+static bool tlsCredentialCacheLookUp(CellularSockTlsCredentialType_t type,
+                                     const char *pName, const char *pData,
+                                     size_t sizeBytes)
+{
+    bool cached = false;
+#if CELLULAR_SOCK_TLS_CREDENTIAL_CACHE_NUM_ENTRIES > 0
+    CellularSockTlsCredentialCacheEntry_t *pEntry;
+
+    pEntry = pTlsCredentialCacheFind(type, pName);
+    if ((pEntry != NULL) && (pEntry->sizeBytes == sizeBytes) &&
+        (cellularPort_memcmp(pEntry->pData, pData, sizeBytes) == 0)) {
+        pEntry->lastUsedTimeMs = cellularPortGetTickTimeMs();
+        cached = true;
+    }
+#else
+    (void) type;
+    (void) pName;
+    (void) pData;
+    (void) sizeBytes;
+#endif
+
+    return cached;
+}
+
+// Put a credential into the TLS credential cache or, if it has
+// not been stored, remove it.
+// This does NOT lock the TLS mutex, you need to do that.
+static void tlsCredentialCacheStore(CellularSockTlsCredentialType_t type,
+                                    const char *pName, const char *pData,
+                                    size_t sizeBytes, bool stored)
+{
+#if CELLULAR_SOCK_TLS_CREDENTIAL_CACHE_NUM_ENTRIES > 0
+    CellularSockTlsCredentialCacheEntry_t *pEntry;
+
+    if (stored) {
+        tlsCredentialCacheAdd(type, pName, pData, sizeBytes);
+    } else {
+        pEntry = pTlsCredentialCacheFind(type, pName);
+        if (pEntry != NULL) {
+            tlsCredentialCacheRemove(pEntry);
+        }
+    }
+#else
+    (void) type;
+    (void) pName;
+    (void) pData;
+    (void) sizeBytes;
+    (void) stored;
+#endif
+}
+
+// Empty the TLS credential cache.
+// This does NOT lock the TLS mutex, you need to do that.
+static void tlsCredentialCacheFlush()
+{
+#if CELLULAR_SOCK_TLS_CREDENTIAL_CACHE_NUM_ENTRIES > 0
+    for (size_t x = 0; x < sizeof(gTlsCredentialCache) / sizeof(gTlsCredentialCache[0]); x++) {
+        tlsCredentialCacheRemove(&(gTlsCredentialCache[x]));
+    }
+#endif
+}
+
+// Write one setting of a security profile with AT+USECPRF, an
+// integer value if pString is NULL; with an op code of -1 the
+// profile is instead reset to its defaults.
+// This does NOT lock the AT interface or the TLS mutex, you need
+// to do both.
+static void tlsProfileWrite(int32_t profile, int32_t opCode,
+                            const char *pString, int32_t value)
+{
+    cellular_ctrl_at_cmd_start("AT+USECPRF=");
+    cellular_ctrl_at_write_int(profile);
+    if (opCode >= 0) {
+        cellular_ctrl_at_write_int(opCode);
+        if (pString != NULL) {
+            cellular_ctrl_at_write_string(pString, true);
+        } else {
+            cellular_ctrl_at_write_int(value);
+        }
+    }
+    cellular_ctrl_at_cmd_stop_read_resp();
+    gTlsCacheStats.numAtProfileWrites++;
+}
+
+// Set up a security profile of the module afresh.
+// This does NOT lock the TLS mutex, you need to do that.
+static bool tlsProfileSetUp(int32_t profile,
+                            const CellularSockTlsProfile_t *pProfile)
+{
+    cellular_ctrl_at_lock();
+    tlsProfileWrite(profile, -1, NULL, 0);
+    tlsProfileWrite(profile, CELLULAR_SOCK_TLS_OP_VALIDATION,
+                    NULL, (int32_t) pProfile->validation);
+    if (pProfile->pRootCaName != NULL) {
+        tlsProfileWrite(profile, CELLULAR_SOCK_TLS_OP_ROOT_CA_NAME,
+                        pProfile->pRootCaName, 0);
+    }
+    if (pProfile->pClientCertName != NULL) {
+        tlsProfileWrite(profile, CELLULAR_SOCK_TLS_OP_CLIENT_CERT_NAME,
+                        pProfile->pClientCertName, 0);
+    }
+    if (pProfile->pClientKeyName != NULL) {
+        tlsProfileWrite(profile, CELLULAR_SOCK_TLS_OP_CLIENT_KEY_NAME,
+                        pProfile->pClientKeyName, 0);
+    }
+    if (pProfile->pServerName != NULL) {
+        tlsProfileWrite(profile, CELLULAR_SOCK_TLS_OP_SERVER_NAME,
+                        pProfile->pServerName, 0);
+        tlsProfileWrite(profile, CELLULAR_SOCK_TLS_OP_SNI,
+                        pProfile->pServerName, 0);
+    }
+    if (pProfile->sessionResumption) {
+        tlsProfileWrite(profile, CELLULAR_SOCK_TLS_OP_SESSION_RESUMPTION,
+                        NULL, 1);
+    }
+
+    return (cellular_ctrl_at_unlock_return_error() == 0);
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: ADDRESS CONVERSION
+ * -------------------------------------------------------------- */
+
+// Given a string, which may be an IP address or a
+// domain name, return a pointer to the separator
+// character for the port number part of it,
+// or NULL if there is no port number
+static const char *pAddressPortSeparator(const char *pAddress)
+{
+    const char *pColon = NULL;
+
+    if (pAddress != NULL) {
+        // If there's a square bracket at the start of
+        // the domain string then we've been given an
+        // IPV6 address with port number so move
+        // the pointer to the closing square bracket
+        if (*pAddress == '[') {
+            pAddress = pCellularPort_strchr(pAddress, ']');
+        }
+        if (pAddress != NULL) {
+            // Check for a port number on the end
+            pColon = pCellularPort_strchr(pAddress, ':');
+            if (pColon != NULL) {
+                // Check if there are more colons in the
+                // string: if so this is an IPV6 address
+                // without a port number on the end
+                if (pCellularPort_strchr(pColon + 1, ':') != NULL) {
+                    pColon = NULL;
+                }
+            }
+        }
+    }
+
+    return pColon;
+}
+
+// Determine whether the given IP address string is IPV4.
+static bool addressStringIsIpv4(const char *pAddressString)
+{
+    // If it's got a dot in it, must be IPV4
+    return (pCellularPort_strchr(pAddressString, '.') != NULL);
+}
+
+// Convert an IPV4 address string "xxx.yyy.www.zzz:65535" into
+// a struct.
+static bool ipv4StringToAddress(const char *pAddressString,
+                                CellularSockAddress_t *pAddress)
+{
+    bool success = true;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    uint32_t d;
+    uint32_t port;
+    const char *pColon;
+
+    pAddress->ipAddress.type = CELLULAR_SOCK_ADDRESS_TYPE_V4;
+    pAddress->ipAddress.address.ipv4 = 0;
+    pAddress->port = 0;
+
+    // Get the IP address part
+    if (cellularPort_sscanf(pAddressString, "%u.%u.%u.%u",
+                            &a, &b, &c, &d) == 4) {
+        // Range check
+        if ((a <= UCHAR_MAX) && (b <= UCHAR_MAX) &&
+            (c <= UCHAR_MAX) && (d <= UCHAR_MAX)) {
+
+            // Calculate the IP address part, network byte order
+            pAddress->ipAddress.address.ipv4 = (a << 24) |
+                                               (b << 16) |
+                                               (c << 8)  |
+                                               (d << 0);
+
+            // Check for a port number on the end
+            pColon = pCellularPort_strchr(pAddressString, ':');
+            if (pColon != NULL) {
+                // Fill in the port number
+                port = cellularPort_strtol(pColon + 1, NULL, 10);
+                if (port <= USHRT_MAX) {
+                    pAddress->port = port;
+                } else {
+                    success = false;
+                }
+            }
+        } else {
+            success = false;
+        }
+    } else {
+        success = false;
+    }
+
+    return success;
+}
+
+// Convert an IPV6 address string "2001:0db8:85a3:0000:0000:8a2e:0370:7334" 
+// or "[2001:0db8:85a3:0000:0000:8a2e:0370:7334]:65535" into a struct.
+static bool ipv6StringToAddress(const char *pAddressString,
+                                CellularSockAddress_t *pAddress)
+{
+    bool success = true;
+    size_t stringLength = cellularPort_strlen(pAddressString);
+    bool hasPort = false;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    uint32_t d;
+    uint32_t e;
+    uint32_t f;
+    uint32_t g;
+    uint32_t h;
+    uint32_t port;
+    const char *pStr;
+
+    pAddress->ipAddress.type = CELLULAR_SOCK_ADDRESS_TYPE_V6;
+    pCellularPort_memset(pAddress->ipAddress.address.ipv6, 0,
+                         sizeof(pAddress->ipAddress.address.ipv6));
+    pAddress->port = 0;
+
+    // See if there's a '[' on the start
+    if ((stringLength > 0) && (*pAddressString == '[')) {
+        hasPort = true;
+        pAddressString++;
+    }
+
+    // Get the IP address part
+    if (cellularPort_sscanf(pAddressString, "%x:%x:%x:%x:%x:%x:%x:%x",
+                            &a, &b, &c, &d, &e, &f, &g, &h) == 8) {
+        // Range check
+        if ((a <= USHRT_MAX) && (b <= USHRT_MAX) &&
+            (c <= USHRT_MAX) && (d <= USHRT_MAX) &&
+            (e <= USHRT_MAX) && (f <= USHRT_MAX) &&
+            (g <= USHRT_MAX) && (h <= USHRT_MAX)) {
+
+            // Slot the uint16_t's into the array in network-byte order
+            pAddress->ipAddress.address.ipv6[3] = (a << 16) | (b & 0xFFFF);
+            pAddress->ipAddress.address.ipv6[2] = (c << 16) | (d & 0xFFFF);
+            pAddress->ipAddress.address.ipv6[1] = (e << 16) | (f & 0xFFFF);
+            pAddress->ipAddress.address.ipv6[0] = (g << 16) | (h & 0xFFFF);
+
+            // Get the port number if there was one
+            if (hasPort) {
+                pStr = pCellularPort_strchr(pAddressString, ']');
+                if (pStr != NULL) {
+                    pStr = pCellularPort_strchr(pStr, ':');
+                    if (pStr != NULL) {
+                        // Fill in the port number
+                        port = cellularPort_strtol(pStr + 1, NULL, 10);
+                        if (port <= USHRT_MAX) {
+                            pAddress->port = port;
+                        } else {
+                            success = false;
+                        }
+                    }
+                } else {
+                    success = false;
+                }
+            }
+        } else {
+            success = false;
+        }
+    } else {
+        success = false;
+    }
+
+    return success;
+}
+
+// Convert an IP address struct (i.e. without a port number) into a
+// string, returning the length of the string.
+static int32_t ipAddressToString(const CellularSockIpAddress_t *pIpAddress,
+                                 char *pBuffer,
+                                 size_t sizeBytes)
+{
+    CellularSockErrorCode_t stringLengthOrError = CELLULAR_SOCK_INVALID_PARAMETER;
+    int32_t thisLength;
+
+    // Convert the address in network byte order (MSB first);
+    switch (pIpAddress->type) {
+        case CELLULAR_SOCK_ADDRESS_TYPE_V4:
+            stringLengthOrError = cellularPort_snprintf(pBuffer,
+                                                        sizeBytes,
+                                                        "%u.%u.%u.%u",
+                                                        (pIpAddress->address.ipv4 >> 24) & 0xFF,
+                                                        (pIpAddress->address.ipv4 >> 16) & 0xFF,
+                                                        (pIpAddress->address.ipv4 >> 8)  & 0xFF,
+                                                        (pIpAddress->address.ipv4 >> 0)  & 0xFF);
+        break;
+        case CELLULAR_SOCK_ADDRESS_TYPE_V6:
+            stringLengthOrError = 0;
+            for (int32_t x = 3; (x >= 0) && (stringLengthOrError >= 0); x--) {
+                thisLength = cellularPort_snprintf(pBuffer,
+                                                   sizeBytes,
+                                                   "%x:%x",
+                                                   (pIpAddress->address.ipv6[x] >> 16) & 0xFFFF,
+                                                   (pIpAddress->address.ipv6[x] >> 0)  & 0xFFFF);
+                if (x > 0) {
+                    if ((thisLength >= 0) && (thisLength < sizeBytes)) {
+                        *(pBuffer + thisLength) = ':';
+                        thisLength++;
+                    } else {
+                        thisLength = CELLULAR_SOCK_NO_MEMORY;
+                    }
+                }
+                if ((thisLength >= 0) && (thisLength < sizeBytes)) {
+                    sizeBytes -= thisLength;
+                    pBuffer += thisLength;
+                    stringLengthOrError += thisLength;
+                } else {
+                    stringLengthOrError = CELLULAR_SOCK_NO_MEMORY;
+                }
+            }
+        break;
+        default:
+        break;
+    }
+
+    return (int32_t) stringLengthOrError;
+}
+
+// Convert an address struct, which includes a port number,
+// into a string, returning the length of the string.
+static int32_t addressToString(const CellularSockAddress_t *pAddress,
+                               bool includePortNumber,
+                               char *pBuffer,
+                               size_t sizeBytes)
+{
+    CellularSockErrorCode_t stringLengthOrError = 0;
+    int32_t thisLength;
+
+    if (includePortNumber) {
+        // If this is an IPV6 address, then start with a square bracket
+        // to delineate the IP address part
+        if (pAddress->ipAddress.type == CELLULAR_SOCK_ADDRESS_TYPE_V6) {
+            if (sizeBytes > 1) {
+                *pBuffer = '[';
+                stringLengthOrError++;
+                sizeBytes--;
+                pBuffer++;
+            } else {
+                stringLengthOrError = CELLULAR_SOCK_NO_MEMORY;
+            }
+        }
+        // Do the IP address part
+        if (stringLengthOrError >= 0) {
+            thisLength = ipAddressToString(&(pAddress->ipAddress), pBuffer, sizeBytes);
+            if (thisLength >= 0) {
+                sizeBytes -= thisLength;
+                pBuffer += thisLength;
+                stringLengthOrError += thisLength;
+                // If this is an IPV6 address then close the square brackets
+                if (pAddress->ipAddress.type == CELLULAR_SOCK_ADDRESS_TYPE_V6) {
+                    if (sizeBytes > 1) {
+                        *pBuffer = ']';
+                        stringLengthOrError++;
+                        sizeBytes--;
+                        pBuffer++;
+                    } else {
+                        stringLengthOrError = CELLULAR_SOCK_NO_MEMORY;
+                    }
+                }
+            } else {
+                stringLengthOrError = CELLULAR_SOCK_NO_MEMORY;
+            }
+        }
+        // Add the port number
+        if (stringLengthOrError >= 0) {
+            thisLength = cellularPort_snprintf(pBuffer,
+                                               sizeBytes,
+                                               ":%u",
+                                               pAddress->port);
+            if (thisLength < sizeBytes) {
+                stringLengthOrError += thisLength;
+            } else {
+                stringLengthOrError = CELLULAR_SOCK_NO_MEMORY;
+            }
+        }
+    } else {
+        // No port number required, just do the ipAddress part
+        stringLengthOrError = ipAddressToString(&(pAddress->ipAddress), pBuffer, sizeBytes);
+    }
+
+    return (int32_t) stringLengthOrError;
+}
+
+// Return true if two IP addresses (i.e. without port numbers)
+// are the same; only the part of the address union that the
+// type uses is compared.
+static bool ipAddressIsEqual(const CellularSockIpAddress_t *pIpAddress1,
+                             const CellularSockIpAddress_t *pIpAddress2)
+{
+    bool isEqual = (pIpAddress1->type == pIpAddress2->type);
+
+    if (isEqual) {
+        switch (pIpAddress1->type) {
+            case CELLULAR_SOCK_ADDRESS_TYPE_V4:
+                isEqual = (pIpAddress1->address.ipv4 == pIpAddress2->address.ipv4);
+            break;
+            case CELLULAR_SOCK_ADDRESS_TYPE_V6:
+                for (size_t x = 0; isEqual && (x < sizeof(pIpAddress1->address.ipv6) /
+                                                   sizeof(pIpAddress1->address.ipv6[0])); x++) {
+                    isEqual = (pIpAddress1->address.ipv6[x] == pIpAddress2->address.ipv6[x]);
+                }
+            break;
+            default:
+                isEqual = false;
+            break;
+        }
+    }
+
+    return isEqual;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: SOCKET OPTIONS
+ * -------------------------------------------------------------- */
+
+// Get the local copy of a socket option that the module holds,
+// NULL if the module doesn't hold the option.
+static CellularSockOptionShadow_t *pOptionShadow(CellularSockSocket_t *pSocket,
+                                                 int32_t level,
+                                                 uint32_t option)
+{
+    CellularSockOptionShadow_t *pShadow = NULL;
+
+    for (size_t x = 0; (pShadow == NULL) &&
+                       (x < sizeof(gShadowedOptions) / sizeof(gShadowedOptions[0])); x++) {
+        if ((gShadowedOptions[x].level == level) &&
+            (gShadowedOptions[x].option == option)) {
+            pShadow = &(pSocket->optionShadow[x]);
+        }
+    }
+
+    return pShadow;
+}
+
+// Return true if setting a socket option may be held until
+// connect, to be written along with the others held, see
+// optionsFlush().
+static bool optionIsDeferrable(const CellularSockSocket_t *pSocket,
+                               int32_t level,
+                               uint32_t option)
+{
+    return (pSocket->protocol == CELLULAR_SOCK_PROTOCOL_TCP) &&
+           (pSocket->state == CELLULAR_SOCK_STATE_CREATED) &&
+           (((level == CELLULAR_SOCK_OPT_LEVEL_TCP) &&
+             (option == CELLULAR_SOCK_OPT_TCP_KEEPIDLE)) ||
+            ((level == CELLULAR_SOCK_OPT_LEVEL_IP) &&
+             (option == CELLULAR_SOCK_OPT_IP_TOS)));
+}
+
+// Write the socket options that have been held back to the
+// module, all in one AT command line, returning true on success.
+// This does NOT lock the socket, you need to do that.
+static bool optionsFlush(CellularSockContainer_t *pContainer)
+{
+    bool success = true;
+    size_t numPending = 0;
+    int32_t level;
+
+    for (size_t x = 0; x < sizeof(gShadowedOptions) / sizeof(gShadowedOptions[0]); x++) {
+        if (pContainer->socket.optionShadow[x].pending) {
+            numPending++;
+        }
+    }
+
+    if (numPending > 0) {
+        atLock(pContainer);
+        // Extended commands may be concatenated with a ';'
+        // between them, all being answered by one "OK"
+        cellular_ctrl_at_cmd_start("AT+USOSO=");
+        numPending = 0;
+        for (size_t x = 0; x < sizeof(gShadowedOptions) / sizeof(gShadowedOptions[0]); x++) {
+            if (pContainer->socket.optionShadow[x].pending) {
+                if (numPending > 0) {
+                    cellular_ctrl_at_cmd_start(";+USOSO=");
+                }
+                level = gShadowedOptions[x].level;
+                if (level == CELLULAR_SOCK_OPT_LEVEL_SOCK) {
+                    level = CELLULAR_SOCK_OPT_LEVEL_SOCK_INT16;
+                }
+                cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
+                cellular_ctrl_at_write_int(level);
+                cellular_ctrl_at_write_int(gShadowedOptions[x].option);
+                cellular_ctrl_at_write_int(pContainer->socket.optionShadow[x].value);
+                numPending++;
+            }
+        }
+        cellular_ctrl_at_cmd_stop_read_resp();
+        success = (cellular_ctrl_at_unlock_return_error() == 0);
+        statsAdd(&gOptionCacheStats.numAtCommands, 1);
+        for (size_t x = 0; x < sizeof(gShadowedOptions) / sizeof(gShadowedOptions[0]); x++) {
+            if (pContainer->socket.optionShadow[x].pending) {
+                pContainer->socket.optionShadow[x].pending = false;
+                if (!success) {
+                    // No telling what the module has now
+                    pContainer->socket.optionShadow[x].known = false;
+                }
+            }
+        }
+        cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, %d held socket option(s) %s.\n",
+                        pContainer->descriptor,
+                        pContainer->socket.modemHandle,
+                        numPending, success ? "written" : "NOT accepted");
+    }
+
+    return success;
+}
+
+// Set a socket option that has an integer as a parameter.
+// This does NOT lock the socket, you need to do that.
+static int32_t setOptionInt(CellularSockContainer_t *pContainer,
+                            int32_t level,
+                            uint32_t option,
+                            const void *pOptionValue,
+                            size_t optionValueLength,
+                            int32_t *pErrno)
+{
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockOptionShadow_t *pShadow;
+    int32_t value;
+    int32_t atLevel = level;
+
+    if ((pOptionValue != NULL) && 
+        (optionValueLength >= sizeof(int32_t))) {
+        value = *((int32_t *) pOptionValue);
+        pShadow = pOptionShadow(&(pContainer->socket), level, option);
+        if (pShadow != NULL) {
+            statsAdd(&gOptionCacheStats.numSets, 1);
+        }
+        if ((pShadow != NULL) && pShadow->known &&
+            (pShadow->value == value)) {
+            // The module has it already
+            statsAdd(&gOptionCacheStats.numSetSkips, 1);
+            errorCode = CELLULAR_SOCK_SUCCESS;
+        } else if ((pShadow != NULL) &&
+                   optionIsDeferrable(&(pContainer->socket), level, option)) {
+            // Hold it until connect
+            pShadow->value = value;
+            pShadow->known = true;
+            pShadow->pending = true;
+            statsAdd(&gOptionCacheStats.numSetsBatched, 1);
+            errorCode = CELLULAR_SOCK_SUCCESS;
+        } else {
+            if (level == CELLULAR_SOCK_OPT_LEVEL_SOCK) {
+                atLevel = CELLULAR_SOCK_OPT_LEVEL_SOCK_INT16;
+            }
+            atLock(pContainer);
+            cellular_ctrl_at_cmd_start("AT+USOSO=");
+            cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
+            cellular_ctrl_at_write_int(atLevel);
+            cellular_ctrl_at_write_int(option);
+            cellular_ctrl_at_write_int(value);
+            cellular_ctrl_at_cmd_stop_read_resp();
+            if (pShadow != NULL) {
+                statsAdd(&gOptionCacheStats.numAtCommands, 1);
+            }
+            if (cellular_ctrl_at_unlock_return_error() == 0) {
+                cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, socket option %d:0x%04x (%d) set to %d.\n",
+                                pContainer->descriptor,
+                                pContainer->socket.modemHandle,
+                                atLevel, option, option, value);
+                if (pShadow != NULL) {
+                    pShadow->value = value;
+                    pShadow->known = true;
+                    pShadow->pending = false;
+                }
+                errorCode = CELLULAR_SOCK_SUCCESS;
+            } else {
+                // Module doesn't support it so it's an
+                // invalid parameter
+                *pErrno = CELLULAR_SOCK_EINVAL;
+            }
+        }
+    } else {
+        *pErrno = CELLULAR_SOCK_EINVAL;
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Get a socket option that has an integer as a parameter.
+// This does NOT lock the socket, you need to do that.
+static int32_t getOptionInt(CellularSockContainer_t *pContainer,
+                            int32_t level,
                             uint32_t option,
                             void *pOptionValue,
                             size_t *pOptionValueLength,
                             int32_t *pErrno)
 {
     CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
-    int32_t x;
+    CellularSockOptionShadow_t *pShadow;
+    int32_t atLevel = level;
+    int32_t x;
+
+    if (pOptionValueLength != NULL) {
+        if (pOptionValue != NULL) {
+            if (*pOptionValueLength >= sizeof(int32_t)) {
+                pShadow = pOptionShadow(&(pContainer->socket), level, option);
+                if (pShadow != NULL) {
+                    statsAdd(&gOptionCacheStats.numGets, 1);
+                }
+                if ((pShadow != NULL) && pShadow->known) {
+                    // Answer locally
+                    statsAdd(&gOptionCacheStats.numGetHits, 1);
+                    *((int32_t *) pOptionValue) = pShadow->value;
+                    *pOptionValueLength = sizeof(int32_t);
+                    errorCode = CELLULAR_SOCK_SUCCESS;
+                } else {
+                    // Get the answer
+                    if (level == CELLULAR_SOCK_OPT_LEVEL_SOCK) {
+                        atLevel = CELLULAR_SOCK_OPT_LEVEL_SOCK_INT16;
+                    }
+                    atLock(pContainer);
+                    cellular_ctrl_at_cmd_start("AT+USOGO=");
+                    cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
+                    cellular_ctrl_at_write_int(atLevel);
+                    cellular_ctrl_at_write_int(option);
+                    cellular_ctrl_at_cmd_stop();
+                    cellular_ctrl_at_resp_start("+USOGO:", false);
+                    x = cellular_ctrl_at_read_int();
+                    cellular_ctrl_at_resp_stop();
+                    if (pShadow != NULL) {
+                        statsAdd(&gOptionCacheStats.numAtCommands, 1);
+                    }
+                    if ((cellular_ctrl_at_unlock_return_error() == 0) && (x >= 0)) {
+                        *((int32_t *) pOptionValue)  = x;
+                        cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, socket option %d:0x%04x (%d) is %d.\n",
+                                        pContainer->descriptor,
+                                        pContainer->socket.modemHandle,
+                                        atLevel, option, option, x);
+                        if (pShadow != NULL) {
+                            pShadow->value = x;
+                            pShadow->known = true;
+                        }
+                        *pOptionValueLength = sizeof(int32_t);
+                        errorCode = CELLULAR_SOCK_SUCCESS;
+                    } else {
+                        // Module doesn't support it so it's an
+                        // invalid parameter
+                        *pErrno = CELLULAR_SOCK_EINVAL;
+                    }
+                }
+            } else {
+                // Caller hasn't left enough room
+                *pErrno = CELLULAR_SOCK_EINVAL;
+            }
+        } else {
+            // Caller just wants to know the length required
+            *pOptionValueLength = sizeof(int32_t);
+            errorCode = CELLULAR_SOCK_SUCCESS;
+        }
+    } else {
+        // Invalid argument, there must be a value length pointer
+        *pErrno = CELLULAR_SOCK_EINVAL;
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Set the linger socket option.
+// This does NOT lock the socket, you need to do that.
+static int32_t setOptionLinger(CellularSockContainer_t *pContainer,
+                               const void *pOptionValue,
+                               size_t optionValueLength,
+                               int32_t *pErrno)
+{
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockOptionShadow_t *pShadow;
+    const CellularSockLinger_t *pLinger = (const CellularSockLinger_t *) pOptionValue;
+
+    if ((pOptionValue != NULL) && 
+        (optionValueLength >= sizeof(CellularSockLinger_t))) {
+        pShadow = pOptionShadow(&(pContainer->socket),
+                                CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                CELLULAR_SOCK_OPT_LINGER);
+        statsAdd(&gOptionCacheStats.numSets, 1);
+        if (pShadow->known && (pShadow->value == pLinger->l_onoff) &&
+            ((pLinger->l_onoff != 1) || (pShadow->value2 == pLinger->l_linger))) {
+            // The module has it already
+            statsAdd(&gOptionCacheStats.numSetSkips, 1);
+            errorCode = CELLULAR_SOCK_SUCCESS;
+        } else {
+            atLock(pContainer);
+            cellular_ctrl_at_cmd_start("AT+USOSO=");
+            cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
+            cellular_ctrl_at_write_int(CELLULAR_SOCK_OPT_LEVEL_SOCK_INT16);
+            cellular_ctrl_at_write_int(CELLULAR_SOCK_OPT_LINGER);
+            cellular_ctrl_at_write_int(pLinger->l_onoff);
+            if (pLinger->l_onoff == 1) {
+                cellular_ctrl_at_write_int(pLinger->l_linger);
+            }
+            cellular_ctrl_at_cmd_stop_read_resp();
+            statsAdd(&gOptionCacheStats.numAtCommands, 1);
+            if (cellular_ctrl_at_unlock_return_error() == 0) {
+                if (pLinger->l_onoff == 1) {
+                    cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, linger set to %d and %d ms.\n",
+                                    pContainer->descriptor,
+                                    pContainer->socket.modemHandle,
+                                    pLinger->l_onoff, pLinger->l_linger);
+                } else {
+                    cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, linger option set to %d.\n",
+                                    pContainer->descriptor,
+                                    pContainer->socket.modemHandle,
+                                    pLinger->l_onoff);
+                }
+                pShadow->value = pLinger->l_onoff;
+                pShadow->value2 = pLinger->l_linger;
+                pShadow->known = true;
+                errorCode = CELLULAR_SOCK_SUCCESS;
+            } else {
+                // Module doesn't like it so there must be an
+                // invalid parameter
+                *pErrno = CELLULAR_SOCK_EINVAL;
+            }
+        }
+    } else {
+        *pErrno = CELLULAR_SOCK_EINVAL;
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Get the linger socket option.
+// This does NOT lock the socket, you need to do that.
+static int32_t getOptionLinger(CellularSockContainer_t *pContainer,
+                               void *pOptionValue,
+                               size_t *pOptionValueLength,
+                               int32_t *pErrno)
+{
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockOptionShadow_t *pShadow;
+    int32_t x;
+    int32_t y = -1;
+
+    if (pOptionValueLength != NULL) {
+        if (pOptionValue != NULL) {
+            if (*pOptionValueLength >= sizeof(CellularSockLinger_t)) {
+                pShadow = pOptionShadow(&(pContainer->socket),
+                                        CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                        CELLULAR_SOCK_OPT_LINGER);
+                statsAdd(&gOptionCacheStats.numGets, 1);
+                if (pShadow->known) {
+                    // Answer locally
+                    statsAdd(&gOptionCacheStats.numGetHits, 1);
+                    x = pShadow->value;
+                    y = pShadow->value2;
+                } else {
+                    // Get the answer
+                    atLock(pContainer);
+                    cellular_ctrl_at_cmd_start("AT+USOGO=");
+                    cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
+                    cellular_ctrl_at_write_int(CELLULAR_SOCK_OPT_LEVEL_SOCK_INT16);
+                    cellular_ctrl_at_write_int(CELLULAR_SOCK_OPT_LINGER);
+                    cellular_ctrl_at_cmd_stop();
+                    cellular_ctrl_at_resp_start("+USOGO:", false);
+                    x = cellular_ctrl_at_read_int();
+                    // Second parameter is only relevant if
+                    // the first is 1
+                    if (x == 1) {
+                        y = cellular_ctrl_at_read_int();
+                    }
+                    cellular_ctrl_at_resp_stop();
+                    statsAdd(&gOptionCacheStats.numAtCommands, 1);
+                    if (cellular_ctrl_at_unlock_return_error() != 0) {
+                        // Module obviously doesn't support it so it's an
+                        // invalid parameter
+                        *pErrno = CELLULAR_SOCK_EINVAL;
+                    }
+                }
+                if (*pErrno == CELLULAR_SOCK_ENONE) {
+                    if (x == 0) {
+                        ((CellularSockLinger_t *) pOptionValue)->l_onoff = x;
+                        *pOptionValueLength = sizeof(CellularSockLinger_t);
+                        errorCode = CELLULAR_SOCK_SUCCESS;
+                        cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, linger option is %d.\n",
+                                        pContainer->descriptor,
+                                        pContainer->socket.modemHandle,
+                                        ((CellularSockLinger_t *) pOptionValue)->l_onoff);
+                    } else if ((x == 1) && (y >= 0)) {
+                        // If x is 1, y must be present
+                        ((CellularSockLinger_t *) pOptionValue)->l_onoff = x;
+                        ((CellularSockLinger_t *) pOptionValue)->l_linger = y;
+                        *pOptionValueLength = sizeof(CellularSockLinger_t);
+                        errorCode = CELLULAR_SOCK_SUCCESS;
+                        cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, linger option is %d and %d ms.\n",
+                                        pContainer->descriptor,
+                                        pContainer->socket.modemHandle,
+                                        ((CellularSockLinger_t *) pOptionValue)->l_onoff,
+                                        ((CellularSockLinger_t *) pOptionValue)->l_linger);
+                    } else {
+                        // This is a device error but there doesn't
+                        // seem to be an errno for that, this seems
+                        // closest
+                        *pErrno = CELLULAR_SOCK_EIO;
+                    }
+                    if (errorCode == CELLULAR_SOCK_SUCCESS) {
+                        pShadow->value = x;
+                        pShadow->value2 = y;
+                        pShadow->known = true;
+                    }
+                }
+            } else {
+                // Caller hasn't left enough room
+                *pErrno = CELLULAR_SOCK_EINVAL;
+            }
+        } else {
+            // Caller just wants to know the length required
+            *pOptionValueLength = sizeof(CellularSockLinger_t);
+            errorCode = CELLULAR_SOCK_SUCCESS;
+        }
+    } else {
+        // Invalid argument, there must be a value length pointer
+        *pErrno = CELLULAR_SOCK_EINVAL;
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Set the security profile with which the module runs TLS on
+// a socket, -1 for none.
+// This does NOT lock the socket, you need to do that.
+static int32_t setOptionTlsSecurityProfile(CellularSockContainer_t *pContainer,
+                                           const void *pOptionValue,
+                                           size_t optionValueLength,
+                                           int32_t *pErrno)
+{
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t profile;
+
+    if ((pOptionValue != NULL) &&
+        (optionValueLength == sizeof(int32_t)) &&
+        (*((int32_t *) pOptionValue) >= -1)) {
+        profile = *((int32_t *) pOptionValue);
+        if (pContainer->socket.protocol != CELLULAR_SOCK_PROTOCOL_TCP) {
+            // TLS is for TCP only
+            *pErrno = CELLULAR_SOCK_ENOPROTOOPT;
+        } else if (pContainer->socket.state != CELLULAR_SOCK_STATE_CREATED) {
+            // Too late, the handshake is part of connecting
+            *pErrno = CELLULAR_SOCK_EISCONN;
+        } else {
+            atLock(pContainer);
+            cellular_ctrl_at_cmd_start("AT+USOSEC=");
+            cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
+            if (profile >= 0) {
+                cellular_ctrl_at_write_int(1);
+                cellular_ctrl_at_write_int(profile);
+            } else {
+                cellular_ctrl_at_write_int(0);
+            }
+            cellular_ctrl_at_cmd_stop_read_resp();
+            if (cellular_ctrl_at_unlock_return_error() == 0) {
+                cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, security profile set to %d.\n",
+                                pContainer->descriptor,
+                                pContainer->socket.modemHandle, profile);
+                pContainer->socket.securityProfile = profile;
+                errorCode = CELLULAR_SOCK_SUCCESS;
+            } else {
+                // Module doesn't like the profile so it's
+                // an invalid parameter
+                *pErrno = CELLULAR_SOCK_EINVAL;
+            }
+        }
+    } else {
+        *pErrno = CELLULAR_SOCK_EINVAL;
+    }
+
+    return (int32_t) errorCode;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: SENDING AND RECEIVING
+ * -------------------------------------------------------------- */
+
+// Block until the URC handler signals that data has arrived for
+// a socket or the receive timeout, which began at startTimeMs,
+// expires.  The socket, which must be locked on entry, is
+// unlocked while waiting so that others may use it, e.g. to
+// close it, and is locked again on return; false is returned
+// if it has been closed in the meantime.
+static bool receiveWait(CellularSockContainer_t *pContainer,
+                        int64_t startTimeMs)
+{
+    int64_t waitMs = startTimeMs + pContainer->socket.receiveTimeoutMs -
+                     cellularPortGetTickTimeMs();
+    uint16_t generation = pContainer->generation;
+
+    if (waitMs > 0) {
+        if (waitMs > CELLULAR_SOCK_RECEIVE_WAIT_MAX_MS) {
+            // The caller will come back for the rest
+            waitMs = CELLULAR_SOCK_RECEIVE_WAIT_MAX_MS;
+        }
+        cellularPortMutexUnlock(pContainer->mutex);
+        waitBlock(&(pContainer->dataWait), (int32_t) waitMs);
+        cellularPortMutexLock(pContainer->mutex);
+    }
+
+    return (pContainer->generation == generation) &&
+           (pContainer->socket.state != CELLULAR_SOCK_STATE_CLOSED);
+}
+
+// Write socket data as a quoted hex string parameter of the
+// AT command in progress.
+// This does NOT lock the AT interface, you need to do that.
+static void writeHex(const char *pData, size_t dataSizeBytes)
+{
+    char hex[CELLULAR_SOCK_HEX_CHUNK_LENGTH_BYTES * 2];
+    size_t x;
+
+    // This writes the delimiter and the opening quote
+    cellular_ctrl_at_write_string("\"", false);
+    while (dataSizeBytes > 0) {
+        x = dataSizeBytes;
+        if (x > CELLULAR_SOCK_HEX_CHUNK_LENGTH_BYTES) {
+            x = CELLULAR_SOCK_HEX_CHUNK_LENGTH_BYTES;
+        }
+        cellular_ctrl_at_write_bytes((uint8_t *) hex,
+                                     cellular_ctrl_at_hex_encode(hex, pData, x));
+        pData += x;
+        dataSizeBytes -= x;
+    }
+    cellular_ctrl_at_write_bytes((uint8_t *) "\"", 1);
+}
+
+// Write the data of an AT+USOWR/AT+USOST command, the parameters
+// before the data having already been written: in hex mode,
+// if it fits, the data goes in the command, else it is sent
+// after the '@' prompt and its guard time.
+// This does NOT lock the AT interface, you need to do that:
+// hex mode only changes with the AT interface locked.
+static bool writeData(const char *pData, size_t dataSizeBytes)
+{
+    bool success = true;
+    int64_t promptTimeMs;
+    int64_t guardMs;
+
+    if (cellularCtrlGetSockHexMode() &&
+        (dataSizeBytes <= CELLULAR_SOCK_HEX_MODE_MAX_LENGTH_BYTES)) {
+        writeHex(pData, dataSizeBytes);
+        cellular_ctrl_at_cmd_stop();
+    } else {
+        cellular_ctrl_at_cmd_stop();
+        // Wait for the prompt
+        success = cellular_ctrl_at_wait_char('@');
+        if (success) {
+            promptTimeMs = cellularPortGetTickTimeMs();
+            // Wait for it...checking against the tick timer
+            // since a task block may be rounded down to a
+            // whole number of OS ticks
+            guardMs = CELLULAR_SOCK_PROMPT_GUARD_TIME_MS;
+            while (guardMs > 0) {
+                cellularPortTaskBlock((int32_t) guardMs);
+                guardMs = CELLULAR_SOCK_PROMPT_GUARD_TIME_MS -
+                          (cellularPortGetTickTimeMs() - promptTimeMs);
+            }
+            // Go!
+            cellular_ctrl_at_write_bytes((uint8_t *) pData,
+                                         dataSizeBytes);
+        }
+    }
+
+    return success;
+}
+
+// Read the data of a +USORD/+USORF response, the leading quote
+// mark having already been read; pData may be NULL to throw
+// the data away.
+// This does NOT lock the AT interface, you need to do that.
+static void readData(char *pData, size_t dataSizeBytes)
+{
+    char hex[CELLULAR_SOCK_HEX_CHUNK_LENGTH_BYTES * 2];
+    size_t x;
+
+    if (cellularCtrlGetSockHexMode()) {
+        while (dataSizeBytes > 0) {
+            x = dataSizeBytes;
+            if (x > CELLULAR_SOCK_HEX_CHUNK_LENGTH_BYTES) {
+                x = CELLULAR_SOCK_HEX_CHUNK_LENGTH_BYTES;
+            }
+            cellular_ctrl_at_read_bytes((uint8_t *) hex, x * 2);
+            if (pData != NULL) {
+                pData += cellular_ctrl_at_hex_decode(pData, hex, x * 2);
+            }
+            dataSizeBytes -= x;
+        }
+    } else {
+        cellular_ctrl_at_read_bytes((uint8_t *) pData, dataSizeBytes);
+    }
+}
+
+// Send one UDP packet with AT+USOST to the given IP address,
+// already in string form, and port, returning the number of
+// bytes sent or -1 on error.
+// This does NOT lock the AT interface, you need to do that.
+static int32_t writeDatagram(CellularSockContainer_t *pContainer,
+                             const char *pIpAddressString, uint16_t port,
+                             const void *pData, size_t dataSizeBytes)
+{
+    int32_t sentSize = -1;
+    int32_t x;
+
+    pContainer->socket.stats.numAtCommands++;
+    cellular_ctrl_at_cmd_start("AT+USOST=");
+    // Handle
+    cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
+    // IP address
+    cellular_ctrl_at_write_string(pIpAddressString, true);
+    // Port number
+    cellular_ctrl_at_write_int(port);
+    // Number of bytes to follow
+    cellular_ctrl_at_write_int(dataSizeBytes);
+    if (writeData((const char *) pData, dataSizeBytes)) {
+        // Grab the response
+        cellular_ctrl_at_resp_start("+USOST:", false);
+        // Skip the socket ID
+        cellular_ctrl_at_skip_param(1);
+        // Bytes sent
+        x = cellular_ctrl_at_read_int();
+        cellular_ctrl_at_resp_stop();
+        if (cellular_ctrl_at_get_last_error() == 0) {
+            sentSize = x;
+            if (x > 0) {
+                pContainer->socket.stats.numSegmentsSent++;
+                pContainer->socket.stats.numBytesSent += x;
+            }
+        }
+    }
+
+    return sentSize;
+}
+
+// Send data, UDP style.
+static int32_t sendTo(CellularSockContainer_t *pContainer,
+                      const CellularSockAddress_t *pRemoteAddress,
+                      const void *pData, size_t dataSizeBytes)
+{
+    CellularSockErrorCode_t errorCodeOrSize = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    char buffer[CELLULAR_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
+    int64_t startTimeMs = cellularPortGetTickTimeMs();
+    int32_t sentSize;
+
+    // Get the address as a string
+    if (addressToString(pRemoteAddress,
+                        false,
+                        buffer, 
+                        sizeof(buffer)) > 0) {
+        if (dataSizeBytes > 0) {
+            if (dataSizeBytes <= CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES) {
+                atLock(pContainer);
+                sentSize = writeDatagram(pContainer, buffer,
+                                         pRemoteAddress->port,
+                                         pData, dataSizeBytes);
+                if ((cellular_ctrl_at_unlock_return_error() == 0) &&
+                    (sentSize >= 0)) {
+                    // All is good, probably
+                    errorCodeOrSize = sentSize;
+                } else {
+                    // No route to host
+                    errno = CELLULAR_SOCK_EHOSTUNREACH;
+                }
+                statsLatencyAdd(pContainer->socket.stats.writeLatency,
+                                startTimeMs);
+            } else {
+                // Indicate that the message was too long
+                errno = CELLULAR_SOCK_EMSGSIZE;
+            }
+        } else {
+            // Nothing to do
+            errorCodeOrSize = CELLULAR_SOCK_SUCCESS;
+        }
+    } else {
+        // Seems appropriate
+        errno = CELLULAR_SOCK_EDESTADDRREQ;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCodeOrSize;
+}
+
+// Send a number of UDP packets, stopping at the first that
+// fails, with the AT interface locked just the once and the
+// IP address only converted into a string when it changes.
+// The sizes of the packets must already have been checked.
+static int32_t sendToMulti(CellularSockContainer_t *pContainer,
+                           CellularSockDatagram_t *pDatagrams,
+                           size_t numDatagrams)
+{
+    CellularSockErrorCode_t errorCodeOrNum = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    char buffer[CELLULAR_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
+    const CellularSockIpAddress_t *pIpAddress = NULL;
+    CellularSockDatagram_t *pDatagram;
+    int64_t startTimeMs = cellularPortGetTickTimeMs();
+    size_t numSent = 0;
+    int32_t x = 0;
+
+    atLock(pContainer);
+    while ((numSent < numDatagrams) && (x >= 0)) {
+        pDatagram = &(pDatagrams[numSent]);
+        // Only need a new address string if the address is different
+        if ((pIpAddress == NULL) ||
+            !ipAddressIsEqual(pIpAddress, &(pDatagram->address.ipAddress))) {
+            pIpAddress = NULL;
+            if (addressToString(&(pDatagram->address), false,
+                                buffer, sizeof(buffer)) > 0) {
+                pIpAddress = &(pDatagram->address.ipAddress);
+            } else {
+                // Seems appropriate
+                x = -1;
+                errno = CELLULAR_SOCK_EDESTADDRREQ;
+            }
+        }
+        if (x >= 0) {
+            x = 0;
+            if (pDatagram->dataSizeBytes > 0) {
+                x = writeDatagram(pContainer, buffer,
+                                  pDatagram->address.port,
+                                  pDatagram->pData,
+                                  pDatagram->dataSizeBytes);
+                if (x < 0) {
+                    // No route to host
+                    errno = CELLULAR_SOCK_EHOSTUNREACH;
+                }
+            }
+            if (x >= 0) {
+                pDatagram->sizeBytes = x;
+                numSent++;
+            }
+        }
+    }
+    cellular_ctrl_at_unlock();
+    statsLatencyAdd(pContainer->socket.stats.writeLatency, startTimeMs);
+
+    // Report what got through, if anything did
+    if (numSent > 0) {
+        errorCodeOrNum = numSent;
+    } else if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCodeOrNum;
+}
+
+// Send data, TCP style.
+static int32_t send(CellularSockContainer_t *pContainer,
+                    const void *pData, size_t dataSizeBytes)
+{
+    CellularSockErrorCode_t errorCodeOrSize = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    int32_t sentSize = 0;
+    int32_t leftToSendSize = dataSizeBytes;
+    int32_t thisSendSize = CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES;
+    int64_t startTimeMs = cellularPortGetTickTimeMs();
+    CellularSockStats_t *pStats = &(pContainer->socket.stats);
+    size_t loopCounter = 0;
+    bool success = true;
+
+    while ((leftToSendSize > 0) && success) {
+        loopCounter++;
+        if (leftToSendSize < thisSendSize) {
+            thisSendSize = leftToSendSize;
+        }
+        statsAdd(&gTxBufferStats.numAtWrites, 1);
+        pStats->numAtCommands++;
+        atLock(pContainer);
+        cellular_ctrl_at_cmd_start("AT+USOWR=");
+        // Handle
+        cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
+        // Number of bytes to follow
+        cellular_ctrl_at_write_int(thisSendSize);
+        success = writeData((const char *) pData, thisSendSize);
+        if (success) {
+            // Grab the response
+            cellular_ctrl_at_resp_start("+USOWR:", false);
+            // Skip the socket ID
+            cellular_ctrl_at_skip_param(1);
+            // Bytes sent
+            sentSize = cellular_ctrl_at_read_int();
+            cellular_ctrl_at_resp_stop();
+            if (cellular_ctrl_at_unlock_return_error() == 0) {
+                pData += sentSize;
+                leftToSendSize -= sentSize;
+                if (sentSize > 0) {
+                    pStats->numSegmentsSent++;
+                    pStats->numBytesSent += sentSize;
+                }
+                // Technically, it should be OK to
+                // send fewer bytes than asked for,
+                // however if this happens a lot we'll
+                // get stuck, which isn't desirable,
+                // so use the loop counter to avoid that
+                if (sentSize < thisSendSize) {
+                    pStats->numPartialSends++;
+                    if (loopCounter >= CELLULAR_SOCK_TCP_RETRY_LIMIT) {
+                        pStats->numSendsAbandoned++;
+                        success = false;
+                    }
+                }
+            } else {
+                success = false;
+            }
+        } else {
+            cellular_ctrl_at_unlock();
+        }
+    }
+    statsLatencyAdd(pStats->writeLatency, startTimeMs);
+
+    if (success && (cellular_ctrl_at_get_last_error() == 0)) {
+        // All is good
+        errorCodeOrSize = dataSizeBytes - leftToSendSize;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCodeOrSize;
+}
+
+// If the URC has not filled in pendingBytes, ask the module
+// directly if there is any data to read.
+static void pendingBytesUpdate(CellularSockContainer_t *pContainer)
+{
+    bool isUdp = (pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_UDP);
+    int32_t x;
+
+    if (pContainer->socket.pendingBytes == 0) {
+        pContainer->socket.stats.numAtCommands++;
+        atLock(pContainer);
+        cellular_ctrl_at_cmd_start(isUdp ? "AT+USORF=" : "AT+USORD=");
+        // Handle
+        cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
+        // Zero bytes to read, just want to know the number
+        // of bytes waiting
+        cellular_ctrl_at_write_int(0);
+        cellular_ctrl_at_cmd_stop();
+        cellular_ctrl_at_resp_start(isUdp ? "+USORF:" : "+USORD:", false);
+        // Skip the socket ID
+        cellular_ctrl_at_skip_param(1);
+        // Read the amount of data
+        x = cellular_ctrl_at_read_int();
+        cellular_ctrl_at_resp_stop();
+        if (x >= 0) {
+            pContainer->socket.pendingBytes = x;
+        }
+        cellular_ctrl_at_unlock();
+    }
+}
+
+// Read one UDP packet with AT+USORF, putting up to dataSizeBytes
+// of it at pData, the rest being thrown away, and where it came
+// from at pRemoteAddress, which may be NULL, returning the size
+// of the packet or negative error code.
+// This does NOT lock the AT interface, you need to do that.
+static int32_t readDatagram(CellularSockContainer_t *pContainer,
+                            CellularSockAddress_t *pRemoteAddress,
+                            void *pData, size_t dataSizeBytes)
+{
+    char buffer[CELLULAR_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
+    int32_t port;
+    int32_t actualReceiveSize;
+    uint8_t quoteMark;
+
+    // Note: the real maximum length of UDP packet we can receive
+    // comes from fitting all of the following into one buffer:
+    //
+    // +USORF: xx,"max.len.ip.address.ipv4.or.ipv6",yyyyy,wwww,"the_data"\r\n
+    //
+    // where xx is the handle, max.len.ip.address.ipv4.or.ipv6 is NSAPI_IP_SIZE,
+    // yyyyy is the port number (max 65536), wwww is the length of the data and
+    // the_data is binary data. I make that 29 + 48 + len(the_data),
+    // so the overhead is 77 bytes.
+
+    // In the UDP case we HAVE to read the number
+    // of bytes pending as this will be the size
+    // of the next UDP packet in the module and the
+    // module can only deliver whole UDP packets.
+    pContainer->socket.stats.numAtCommands++;
+    cellular_ctrl_at_cmd_start("AT+USORF=");
+    // Handle
+    cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
+    // Number of bytes to read
+    cellular_ctrl_at_write_int(CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES);
+    cellular_ctrl_at_cmd_stop();
+    cellular_ctrl_at_resp_start("+USORF:", false);
+    // Skip the socket ID
+    cellular_ctrl_at_skip_param(1);
+    // Read the IP address
+    cellular_ctrl_at_read_string(buffer, sizeof(buffer), false);
+    // Read the port
+    port = cellular_ctrl_at_read_int();
+    // Read the amount of data
+    actualReceiveSize = cellular_ctrl_at_read_int();
+    if (actualReceiveSize > CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES) {
+        actualReceiveSize = CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES;
+    }
+    if ((actualReceiveSize >= 0) &&
+        (dataSizeBytes > (size_t) actualReceiveSize)) {
+        dataSizeBytes = actualReceiveSize;
+    }
+    if (actualReceiveSize > 0) {
+        // Don't stop for anything!
+        cellular_ctrl_at_set_delimiter(0);
+        cellular_ctrl_at_set_stop_tag(NULL);
+        // Get the leading quote mark out of the way
+        cellular_ctrl_at_read_bytes(&quoteMark, 1);
+        // Now read out all the actual data,
+        // first the bit we want
+        readData((char *) pData, dataSizeBytes);
+        if ((size_t) actualReceiveSize > dataSizeBytes) {
+            //...and then the rest poured away to NULL
+            readData(NULL, actualReceiveSize - dataSizeBytes);
+        }
+        cellular_ctrl_at_resp_stop();
+        cellular_ctrl_at_set_default_delimiter();
+    }
+    // BEFORE unlocking, work out what's happened
+    // this is to prevent a URC being processed that
+    // may indicate data left, over-write pendingBytes
+    // while we're also writing to it.
+    if (cellular_ctrl_at_get_last_error() == 0) {
+        // Must use what +USORF returns here as it may be less
+        // or more than we asked for and also may be
+        // more than pendingBytes, depending on how
+        // the URCs landed
+        // This update of pendingBytes will be overwritten
+        // by the URC but we have to do something here
+        // 'cos we don't get a URC to tell us when pendingBytes
+        // has gone to zero.
+        if (actualReceiveSize > pContainer->socket.pendingBytes) {
+            pContainer->socket.pendingBytes = 0;
+        } else {
+            pContainer->socket.pendingBytes -= actualReceiveSize;
+        }
+        if (actualReceiveSize >= 0) {
+            pContainer->socket.stats.numSegmentsReceived++;
+            pContainer->socket.stats.numBytesReceived += actualReceiveSize;
+        }
+        // cellular_ctrl_at_read_bytes() should not fail
+        if ((actualReceiveSize >= 0) && (pRemoteAddress != NULL) && (port >= 0)) {
+            if (cellularSockStringToAddress(buffer, pRemoteAddress) == 0) {
+                pRemoteAddress->port = port;
+            } else {
+                actualReceiveSize = -1;
+            }
+        }
+    } else {
+        actualReceiveSize = -1;
+    }
+
+    return actualReceiveSize;
+}
+
+// Receive data, UDP style.
+// Notes: pRemoteAddress may be NULL, it is valid
+// to receive a zero length UDP packet, one whole
+// UDP packet is received by each USORF command,
+// the socket must be locked on entry.
+static int32_t receiveFrom(CellularSockContainer_t *pContainer,
+                           CellularSockAddress_t *pRemoteAddress,
+                           void *pData, size_t dataSizeBytes)
+{
+    CellularSockErrorCode_t errorCodeOrSize = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    int64_t startTimeMs = cellularPortGetTickTimeMs();
+    uint16_t generation = pContainer->generation;
+    int32_t receivedSize = -1;
+    bool success = true;
+
+    dataCallbackRearm(&(pContainer->socket));
+    pendingBytesUpdate(pContainer);
+    // Run around the loop until a packet of data turns up or we time out
+    while (success && (dataSizeBytes > 0) && (receivedSize < 0)) {
+        if (pContainer->socket.pendingBytes > 0) {
+            atLock(pContainer);
+            receivedSize = readDatagram(pContainer, pRemoteAddress,
+                                        pData, dataSizeBytes);
+            success = (receivedSize >= 0);
+            cellular_ctrl_at_unlock();
+        } else if (!pContainer->socket.nonBlocking &&
+                   (cellularPortGetTickTimeMs() - startTimeMs < pContainer->socket.receiveTimeoutMs)) {
+            // Wait for the URC that indicates incoming data
+            if (!receiveWait(pContainer, startTimeMs)) {
+                // Closed while we waited
+                success = false;
+                errno = CELLULAR_SOCK_EBADF;
+            }
+        } else {
+            // Timeout with nothing received
+            // Indicate that we would have blocked here
+            success = false;
+            errno = CELLULAR_SOCK_EWOULDBLOCK;
+            pContainer->socket.stats.numWouldBlocks++;
+        }
+    }
+    if (pContainer->generation == generation) {
+        statsLatencyAdd(pContainer->socket.stats.readLatency, startTimeMs);
+    }
+
+    // Set the return code
+    if (success) {
+        errorCodeOrSize = receivedSize;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCodeOrSize;
+}
+
+// Receive as many UDP packets as are waiting, up to
+// numDatagrams, with the AT interface locked just the
+// once, waiting for the first as receiveFrom() does.
+// Note: the socket must be locked on entry.
+static int32_t receiveFromMulti(CellularSockContainer_t *pContainer,
+                                CellularSockDatagram_t *pDatagrams,
+                                size_t numDatagrams)
+{
+    CellularSockErrorCode_t errorCodeOrNum = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    int64_t startTimeMs = cellularPortGetTickTimeMs();
+    uint16_t generation = pContainer->generation;
+    CellularSockDatagram_t *pDatagram;
+    size_t numReceived = 0;
+    int32_t x = 0;
+    bool success = true;
+
+    dataCallbackRearm(&(pContainer->socket));
+    pendingBytesUpdate(pContainer);
+    // Run around the loop until packets turn up or we time out
+    while (success && (numReceived == 0)) {
+        if (pContainer->socket.pendingBytes > 0) {
+            atLock(pContainer);
+            // Drain what the module has until pendingBytes,
+            // which the +UUSORF URC may increase while we
+            // are at it, reaches zero
+            while ((numReceived < numDatagrams) &&
+                   (pContainer->socket.pendingBytes > 0) && (x >= 0)) {
+                pDatagram = &(pDatagrams[numReceived]);
+                x = readDatagram(pContainer, &(pDatagram->address),
+                                 pDatagram->pData, pDatagram->dataSizeBytes);
+                if (x >= 0) {
+                    pDatagram->sizeBytes = x;
+                    if (pDatagram->sizeBytes > pDatagram->dataSizeBytes) {
+                        pDatagram->sizeBytes = pDatagram->dataSizeBytes;
+                    }
+                    numReceived++;
+                }
+            }
+            success = (numReceived > 0);
+            cellular_ctrl_at_unlock();
+        } else if (!pContainer->socket.nonBlocking &&
+                   (cellularPortGetTickTimeMs() - startTimeMs < pContainer->socket.receiveTimeoutMs)) {
+            // Wait for the URC that indicates incoming data
+            if (!receiveWait(pContainer, startTimeMs)) {
+                // Closed while we waited
+                success = false;
+                errno = CELLULAR_SOCK_EBADF;
+            }
+        } else {
+            // Timeout with nothing received
+            // Indicate that we would have blocked here
+            success = false;
+            errno = CELLULAR_SOCK_EWOULDBLOCK;
+            pContainer->socket.stats.numWouldBlocks++;
+        }
+    }
+    if (pContainer->generation == generation) {
+        statsLatencyAdd(pContainer->socket.stats.readLatency, startTimeMs);
+    }
+
+    // Set the return code
+    if (success) {
+        errorCodeOrNum = numReceived;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCodeOrNum;
+}
+
+// Receive data, TCP style.
+// Note: the socket must be locked on entry.
+static int32_t receive(CellularSockContainer_t *pContainer,
+                       void *pData, size_t dataSizeBytes)
+{
+    CellularSockErrorCode_t errorCodeOrSize = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    int64_t startTimeMs = cellularPortGetTickTimeMs();
+    uint16_t generation = pContainer->generation;
+    CellularSockStats_t *pStats = &(pContainer->socket.stats);
+    int32_t wantedReceiveSize;
+    int32_t actualReceiveSize;
+    int32_t receivedSize = 0;
+    int32_t x = 0;
+    bool success = true;
+    uint8_t quoteMark;
+    char *pRxCache;
+
+    dataCallbackRearm(&(pContainer->socket));
+    statsAdd(&gRxCacheStats.numReads, 1);
+    // Serve what we can from the receive cache
+    receivedSize = (int32_t) rxCacheRead(&(pContainer->socket),
+                                         (char *) pData, dataSizeBytes);
+    dataSizeBytes -= receivedSize;
+    if ((receivedSize > 0) && (dataSizeBytes == 0)) {
+        statsAdd(&gRxCacheStats.numReadsFromCache, 1);
+    }
+
+    if ((dataSizeBytes > 0) && (pContainer->socket.pendingBytes == 0)) {
+        statsAdd(&gRxCacheStats.numAtReads, 1);
+        pStats->numAtCommands++;
+        atLock(pContainer);
+        // If the URC has not filled in pendingBytes, 
+        // ask the module directly if there is anything
+        // to read
+        cellular_ctrl_at_cmd_start("AT+USORD=");
+        // Handle
+        cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
+        // Zero bytes to read, just want to know the number
+        // of bytes waiting
+        cellular_ctrl_at_write_int(0);
+        cellular_ctrl_at_cmd_stop();
+        cellular_ctrl_at_resp_start("+USORD:", false);
+        // Skip the socket ID
+        cellular_ctrl_at_skip_param(1);
+        // Read the amount of data
+        x = cellular_ctrl_at_read_int();
+        cellular_ctrl_at_resp_stop();
+        if (x >= 0) {
+            pContainer->socket.pendingBytes = x;
+        }
+        cellular_ctrl_at_unlock();
+    }
+    // Run around the loop until we run out of room in the buffer
+    // or we time out
+    while (success && (dataSizeBytes > 0)) {
+        pRxCache = pRxCacheGet(&(pContainer->socket));
+        if ((pRxCache != NULL) &&
+            (dataSizeBytes < pContainer->socket.rxCacheAllocatedBytes)) {
+            // A small read: fetch as much as the cache will hold
+            wantedReceiveSize = pContainer->socket.rxCacheAllocatedBytes;
+        } else {
+            // Read straight into the caller's buffer
+            pRxCache = NULL;
+            wantedReceiveSize = CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES;
+            if ((size_t) wantedReceiveSize > dataSizeBytes) {
+                wantedReceiveSize = (int32_t) dataSizeBytes;
+            }
+        }
+        if (pContainer->socket.pendingBytes > 0) {
+            statsAdd(&gRxCacheStats.numAtReads, 1);
+            pStats->numAtCommands++;
+            atLock(pContainer);
+            cellular_ctrl_at_cmd_start("AT+USORD=");
+            // Handle
+            cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
+            // Number of bytes to read
+            cellular_ctrl_at_write_int(wantedReceiveSize);
+            cellular_ctrl_at_cmd_stop();
+            cellular_ctrl_at_resp_start("+USORD:", false);
+            // Skip the socket ID
+            cellular_ctrl_at_skip_param(1);
+            // Read the amount of data
+            actualReceiveSize = cellular_ctrl_at_read_int();
+            if (actualReceiveSize > wantedReceiveSize) {
+                actualReceiveSize = wantedReceiveSize;
+            }
+            if (actualReceiveSize > 0) {
+                // Don't stop for anything!
+                cellular_ctrl_at_set_delimiter(0);
+                cellular_ctrl_at_set_stop_tag(NULL);
+                // Get the leading quote mark out of the way
+                cellular_ctrl_at_read_bytes(&quoteMark, 1);
+                // Now read the actual data
+                if (pRxCache != NULL) {
+                    readData(pRxCache, actualReceiveSize);
+                } else {
+                    readData((char *) pData + receivedSize,
+                             actualReceiveSize);
+                }
+                cellular_ctrl_at_resp_stop();
+                cellular_ctrl_at_set_default_delimiter();
+            }
+            // BEFORE unlocking, work out what's happened
+            // this is to prevent a URC being processed that
+            // may indicate data left, over-write pendingBytes
+            // while we're also writing to it.
+            if (cellular_ctrl_at_get_last_error() == 0) {
+                // Must use what +USORF returns here as it may be less
+                // or more than we asked for and also may be
+                // more than pendingBytes, depending on how
+                // the URCs landed
+                // This update of pendingBytes will be overwritten
+                // by the URC but we have to do something here
+                // 'cos we don't get a URC to tell us when pendingBytes
+                // has gone to zero.
+                if (actualReceiveSize > pContainer->socket.pendingBytes) {
+                    pContainer->socket.pendingBytes = 0;
+                } else {
+                    pContainer->socket.pendingBytes -= actualReceiveSize;
+                }
+                if (actualReceiveSize > 0) {
+                    pStats->numSegmentsReceived++;
+                    pStats->numBytesReceived += actualReceiveSize;
+                    if (pRxCache != NULL) {
+                        // Give the caller what they asked for
+                        // from what is now in the cache
+                        pContainer->socket.rxCacheOffset = 0;
+                        pContainer->socket.rxCacheLength = actualReceiveSize;
+                        actualReceiveSize = (int32_t) rxCacheRead(&(pContainer->socket),
+                                                                  (char *) pData + receivedSize,
+                                                                  dataSizeBytes);
+                    }
+                    receivedSize += actualReceiveSize;
+                    dataSizeBytes -= actualReceiveSize;
+                } else {
+                    // cellular_ctrl_at_read_bytes() should not fail
+                    success = false;
+                }
+            } else {
+                success = false;
+            }
+            cellular_ctrl_at_unlock();
+        } else if (!pContainer->socket.nonBlocking &&
+                   cellularPortGetTickTimeMs() - startTimeMs < pContainer->socket.receiveTimeoutMs) {
+            // Wait for the URC that indicates incoming data
+            if (!receiveWait(pContainer, startTimeMs)) {
+                if (receivedSize == 0) {
+                    // Closed while we waited
+                    success = false;
+                    errno = CELLULAR_SOCK_EBADF;
+                }
+                // Leave with what we have
+                break;
+            }
+        } else {
+            if (receivedSize == 0) {
+                // Timeout with nothing received
+                // Indicate that we would have blocked here
+                success = false;
+                errno = CELLULAR_SOCK_EWOULDBLOCK;
+                pStats->numWouldBlocks++;
+            }
+            // Timed out, after maybe having received something,
+            // leave with what we have
+            break;
+        }
+    }
+
+    if (pContainer->generation == generation) {
+        statsLatencyAdd(pStats->readLatency, startTimeMs);
+    }
+
+    // Set the return code
+    if (success) {
+        errorCodeOrSize = receivedSize;
+        statsAdd(&gRxCacheStats.numBytesRead, receivedSize);
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCodeOrSize;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: RECEIVER
+ * -------------------------------------------------------------- */
+
+// Pass a span of data to the receiver of a socket, noting
+// if it asks for a pause; the form of this function is that
+// required by cellular_ctrl_at_read_bytes_span().
+// This does NOT lock the socket, you need to do that.
+static void receiverSpan(const uint8_t *pData, size_t dataSizeBytes,
+                         void *pParam)
+{
+    CellularSockContainer_t *pContainer = (CellularSockContainer_t *) pParam;
+    CellularSockSocket_t *pSocket = &(pContainer->socket);
+
+    if ((pSocket->pReceiver != NULL) && (dataSizeBytes > 0) &&
+        (pSocket->pReceiver(pContainer->descriptor,
+                            (const char *) pData, dataSizeBytes,
+                            pSocket->pReceiverParam) == CELLULAR_SOCK_RECEIVER_PAUSE)) {
+        pSocket->receiverPaused = true;
+    }
+}
+
+// Read the data of a +USORD response, the leading quote mark
+// having already been read, passing it to the receiver of the
+// socket: straight from the AT buffer or, in hex mode, in chunks
+// as it is decoded.
+// This does NOT lock the socket or the AT interface, you need
+// to do that.
+static void receiverReadData(CellularSockContainer_t *pContainer,
+                             size_t dataSizeBytes)
+{
+    char data[CELLULAR_SOCK_HEX_CHUNK_LENGTH_BYTES];
+    size_t x;
+
+    if (cellularCtrlGetSockHexMode()) {
+        while (dataSizeBytes > 0) {
+            x = dataSizeBytes;
+            if (x > sizeof(data)) {
+                x = sizeof(data);
+            }
+            readData(data, x);
+            receiverSpan((const uint8_t *) data, x, pContainer);
+            dataSizeBytes -= x;
+        }
+    } else {
+        cellular_ctrl_at_read_bytes_span(dataSizeBytes, receiverSpan,
+                                         pContainer);
+    }
+}
+
+// Pass the data of a socket to its receiver: first what is in
+// the receive cache, then what the module has, until there is
+// no more or the receiver asks for a pause.  This is run in the
+// callback task via cellular_ctrl_at_callback(), see
+// receiverSchedule().
+static void receiverRun(void *pParam)
+{
+    CellularSockContainer_t *pContainer = (CellularSockContainer_t *) pParam;
+    CellularSockSocket_t *pSocket = &(pContainer->socket);
+    int32_t actualReceiveSize;
+    uint8_t quoteMark;
+    bool success = true;
+
+    cellularPortMutexLock(pContainer->mutex);
+
+    // Clear this first: a URC arriving from now on
+    // will queue another run
+    pSocket->receiverScheduled = false;
+    dataCallbackRearm(pSocket);
+
+    if ((pSocket->pReceiver != NULL) &&
+        (pSocket->state != CELLULAR_SOCK_STATE_CLOSED)) {
+        if (!pSocket->receiverPaused && (pSocket->rxCacheLength > 0)) {
+            receiverSpan((const uint8_t *) (pSocket->pRxCache + pSocket->rxCacheOffset),
+                         pSocket->rxCacheLength, pContainer);
+            pSocket->rxCacheOffset = 0;
+            pSocket->rxCacheLength = 0;
+        }
+        while (success && !pSocket->receiverPaused &&
+               (pSocket->pendingBytes > 0)) {
+            pSocket->stats.numAtCommands++;
+            atLock(pContainer);
+            cellular_ctrl_at_cmd_start("AT+USORD=");
+            // Handle
+            cellular_ctrl_at_write_int(pSocket->modemHandle);
+            // Number of bytes to read
+            cellular_ctrl_at_write_int(CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES);
+            cellular_ctrl_at_cmd_stop();
+            cellular_ctrl_at_resp_start("+USORD:", false);
+            // Skip the socket ID
+            cellular_ctrl_at_skip_param(1);
+            // Read the amount of data
+            actualReceiveSize = cellular_ctrl_at_read_int();
+            if (actualReceiveSize > CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES) {
+                actualReceiveSize = CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES;
+            }
+            if (actualReceiveSize > 0) {
+                // Don't stop for anything!
+                cellular_ctrl_at_set_delimiter(0);
+                cellular_ctrl_at_set_stop_tag(NULL);
+                // Get the leading quote mark out of the way
+                cellular_ctrl_at_read_bytes(&quoteMark, 1);
+                // Now hand over the actual data
+                receiverReadData(pContainer, actualReceiveSize);
+                cellular_ctrl_at_resp_stop();
+                cellular_ctrl_at_set_default_delimiter();
+            }
+            // As in receive(), work this out BEFORE unlocking
+            if (cellular_ctrl_at_get_last_error() == 0) {
+                if (actualReceiveSize > 0) {
+                    if (actualReceiveSize > pSocket->pendingBytes) {
+                        pSocket->pendingBytes = 0;
+                    } else {
+                        pSocket->pendingBytes -= actualReceiveSize;
+                    }
+                    pSocket->stats.numSegmentsReceived++;
+                    pSocket->stats.numBytesReceived += actualReceiveSize;
+                } else {
+                    // The module has nothing after all
+                    pSocket->pendingBytes = 0;
+                }
+            } else {
+                // Wait for the next URC
+                success = false;
+            }
+            cellular_ctrl_at_unlock();
+        }
+    }
+
+    cellularPortMutexUnlock(pContainer->mutex);
+}
+
+// Queue receiverRun() for a socket, if it isn't already queued.
+// This may be called from a URC handler.
+static void receiverSchedule(CellularSockContainer_t *pContainer)
+{
+    if (!pContainer->socket.receiverScheduled) {
+        pContainer->socket.receiverScheduled = true;
+        if (!cellular_ctrl_at_callback(receiverRun, pContainer)) {
+            pContainer->socket.receiverScheduled = false;
+        }
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: TCP SERVER
+ * -------------------------------------------------------------- */
+
+// Take the oldest incoming connection from the accept queue
+// of a socket, returning false if there is none.
+static bool acceptQueuePop(CellularSockSocket_t *pSocket,
+                           CellularSockAcceptEntry_t *pEntry)
+{
+    bool popped = false;
+
+    CELLULAR_PORT_MUTEX_LOCK(gMutexAccept);
+
+    if ((pSocket->pAcceptQueue != NULL) && (pSocket->acceptQueueLength > 0)) {
+        *pEntry = pSocket->pAcceptQueue[pSocket->acceptQueueStart];
+        pSocket->acceptQueueStart = (pSocket->acceptQueueStart + 1) %
+                                    pSocket->acceptQueueSize;
+        pSocket->acceptQueueLength--;
+        popped = true;
+    }
+
+    CELLULAR_PORT_MUTEX_UNLOCK(gMutexAccept);
+
+    return popped;
+}
+
+// Close, in the module, the incoming connections that were
+// never accepted and free the accept queue of a socket.
+// This does NOT lock the socket, you need to do that.
+static void acceptQueueClose(CellularSockContainer_t *pContainer)
+{
+    CellularSockAcceptEntry_t entry;
+
+    while (acceptQueuePop(&(pContainer->socket), &entry)) {
+        atLock(pContainer);
+        cellular_ctrl_at_cmd_start("AT+USOCL=");
+        cellular_ctrl_at_write_int(entry.modemHandle);
+        cellular_ctrl_at_cmd_stop_read_resp();
+        cellular_ctrl_at_unlock();
+    }
+    acceptQueueFree(&(pContainer->socket));
+}
+
+// Put an incoming connection into a new socket, returning
+// its descriptor or negative error code; if there is no
+// room for it the connection is closed.
+// This does NOT lock the listening socket, you need to do that.
+static int32_t acceptInto(const CellularSockContainer_t *pListeningContainer,
+                          const CellularSockAcceptEntry_t *pEntry,
+                          int32_t *pErrno)
+{
+    CellularSockErrorCode_t descriptorOrErrorCode = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockContainer_t *pContainer;
+
+    pContainer = pSockContainerCreate(CELLULAR_SOCK_TYPE_STREAM,
+                                      CELLULAR_SOCK_PROTOCOL_TCP);
+    if (pContainer != NULL) {
+        containerSetModemHandle(pContainer, pEntry->modemHandle);
+        pCellularPort_memcpy(&(pContainer->socket.remoteAddress),
+                             &(pEntry->remoteAddress),
+                             sizeof(pContainer->socket.remoteAddress));
+        pContainer->socket.localPort = pListeningContainer->socket.localPort;
+        pContainer->socket.state = CELLULAR_SOCK_STATE_CONNECTED;
+        // Data may have arrived before there was a socket
+        // for the URC to tell
+        pendingBytesUpdate(pContainer);
+        descriptorOrErrorCode = pContainer->descriptor;
+        cellularPortLog("CELLULAR_SOCK: incoming connection accepted, descriptor %d, modem handle %d.\n",
+                        pContainer->descriptor, pEntry->modemHandle);
+        containerUnlock(pContainer);
+    } else {
+        // No room, refuse the connection
+        atLock(pListeningContainer);
+        cellular_ctrl_at_cmd_start("AT+USOCL=");
+        cellular_ctrl_at_write_int(pEntry->modemHandle);
+        cellular_ctrl_at_cmd_stop_read_resp();
+        cellular_ctrl_at_unlock();
+        *pErrno = CELLULAR_SOCK_ENFILE;
+        cellularPortLog("CELLULAR_SOCK: unable to accept incoming connection, no free descriptors.\n");
+    }
+
+    return (int32_t) descriptorOrErrorCode;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: SELECT
+ * -------------------------------------------------------------- */
+
+// Wake up any tasks waiting in cellularSockSelect(); to be called
+// whenever the readiness of a socket may have changed.
+static void selectSignal()
+{
+    if (gMutexWait != NULL) {
+
+        CELLULAR_PORT_MUTEX_LOCK(gMutexWait);
+
+        for (size_t x = 0; x < sizeof(gSelectWaiters) / sizeof(gSelectWaiters[0]); x++) {
+            if (gSelectWaiters[x].inUse) {
+                waitSignalNoLock(&(gSelectWaiters[x].wait));
+            }
+        }
+
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexWait);
+    }
+}
+
+// Get a select waiter for the current task, NULL if there are none
+// free.  The queues are created on first use and are never deleted.
+static CellularSockSelectWaiter_t *pSelectWaiterGet()
+{
+    CellularSockSelectWaiter_t *pWaiter = NULL;
+
+    CELLULAR_PORT_MUTEX_LOCK(gMutexWait);
+
+    for (size_t x = 0; (x < sizeof(gSelectWaiters) / sizeof(gSelectWaiters[0])) &&
+                       (pWaiter == NULL); x++) {
+        if (!gSelectWaiters[x].inUse && waitCreate(&(gSelectWaiters[x].wait))) {
+            pWaiter = &(gSelectWaiters[x]);
+            pWaiter->inUse = true;
+        }
+    }
+
+    CELLULAR_PORT_MUTEX_UNLOCK(gMutexWait);
+
+    return pWaiter;
+}
+
+// Give a select waiter back.
+static void selectWaiterRelease(CellularSockSelectWaiter_t *pWaiter)
+{
+    CELLULAR_PORT_MUTEX_LOCK(gMutexWait);
+
+    waitClearNoLock(&(pWaiter->wait));
+    pWaiter->inUse = false;
+
+    CELLULAR_PORT_MUTEX_UNLOCK(gMutexWait);
+}
+
+// Determine if a read on a socket would not block.
+static bool selectIsReadable(const CellularSockSocket_t *pSocket)
+{
+    return (pSocket->pendingBytes > 0) ||
+           (pSocket->rxCacheLength > 0) ||
+           (pSocket->acceptQueueLength > 0) ||
+           (pSocket->state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ) ||
+           (pSocket->state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE) ||
+           (pSocket->state == CELLULAR_SOCK_STATE_CLOSING) ||
+           (pSocket->state == CELLULAR_SOCK_STATE_TIMED_OUT);
+}
+
+// Determine if a socket may be written to; this includes a
+// socket with the outcome of a non-blocking connect to collect.
+static bool selectIsWritable(const CellularSockSocket_t *pSocket)
+{
+    return (pSocket->state == CELLULAR_SOCK_STATE_CONNECTED) ||
+           (pSocket->state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ) ||
+           ((pSocket->protocol == CELLULAR_SOCK_PROTOCOL_UDP) &&
+            (pSocket->state == CELLULAR_SOCK_STATE_CREATED)) ||
+           (pSocket->pendingError != CELLULAR_SOCK_ENONE) ||
+           (pSocket->state == CELLULAR_SOCK_STATE_TIMED_OUT) ||
+           ((pSocket->state == CELLULAR_SOCK_STATE_CONNECTING) &&
+            (cellularPortGetTickTimeMs() >= pSocket->connectStopTimeMs));
+}
+
+// Check the sockets in the requested sets, setting the bits of
+// those that are ready in the (already zeroed) ready sets and
+// returning the number of bits set or negative error code if a
+// requested descriptor is not that of an open socket.  Since no
+// URC marks the timeout of a non-blocking connect, *pWakeTimeMs
+// is brought forward, if it is negative or later, to when the
+// first such connect in the write set times out.  Like the URCs,
+// this does NOT lock the container mutex, so that a select can
+// see readiness change while a send or receive is in progress.
+static int32_t selectCheck(int32_t maxDescriptor,
+                           CellularSockDescriptorSet_t *pReadRequested,
+                           CellularSockDescriptorSet_t *pWriteRequested,
+                           CellularSockDescriptorSet_t *pExceptRequested,
+                           CellularSockDescriptorSet_t *pReadReady,
+                           CellularSockDescriptorSet_t *pWriteReady,
+                           CellularSockDescriptorSet_t *pExceptReady,
+                           int64_t *pWakeTimeMs)
+{
+    int32_t numOrErrorCode = 0;
+    CellularSockContainer_t *pContainer;
+    bool read;
+    bool write;
+    bool except;
+
+    for (CellularSockDescriptor_t d = 0; (d < maxDescriptor) &&
+                                         (numOrErrorCode >= 0); d++) {
+        read = (pReadRequested != NULL) && CELLULAR_SOCK_FD_ISSET(d, pReadRequested);
+        write = (pWriteRequested != NULL) && CELLULAR_SOCK_FD_ISSET(d, pWriteRequested);
+        except = (pExceptRequested != NULL) && CELLULAR_SOCK_FD_ISSET(d, pExceptRequested);
+        if (read || write || except) {
+            pContainer = pContainerFindByDescriptor(d);
+            if (pContainer != NULL) {
+                if (read && selectIsReadable(&(pContainer->socket))) {
+                    CELLULAR_SOCK_FD_SET(d, pReadReady);
+                    numOrErrorCode++;
+                }
+                if (write && selectIsWritable(&(pContainer->socket))) {
+                    CELLULAR_SOCK_FD_SET(d, pWriteReady);
+                    numOrErrorCode++;
+                } else if (write &&
+                           (pContainer->socket.state == CELLULAR_SOCK_STATE_CONNECTING) &&
+                           ((*pWakeTimeMs < 0) ||
+                            (pContainer->socket.connectStopTimeMs < *pWakeTimeMs))) {
+                    *pWakeTimeMs = pContainer->socket.connectStopTimeMs;
+                }
+                if (except &&
+                    (pContainer->socket.state == CELLULAR_SOCK_STATE_CLOSING)) {
+                    CELLULAR_SOCK_FD_SET(d, pExceptReady);
+                    numOrErrorCode++;
+                }
+            } else {
+                numOrErrorCode = CELLULAR_SOCK_BSD_ERROR;
+            }
+        }
+    }
+
+    return numOrErrorCode;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: CREATE/OPEN/CLOSE
+ * -------------------------------------------------------------- */
+
+// Create a socket.
+int32_t cellularSockCreate(CellularSockType_t type,
+                           CellularSockProtocol_t protocol)
+{
+    CellularSockErrorCode_t descriptorOrErrorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    CellularSockContainer_t *pContainer = NULL;
+    int32_t modemHandle;
+
+    if (init()) {
+        if ((type == CELLULAR_SOCK_TYPE_STREAM) ||
+            (type == CELLULAR_SOCK_TYPE_DGRAM)) {
+            if ((protocol == CELLULAR_SOCK_PROTOCOL_TCP) ||
+                (protocol == CELLULAR_SOCK_PROTOCOL_UDP)) {
+
+                // Find a free container, its socket locked
+                pContainer = pSockContainerCreate(type, protocol);
+                if (pContainer != NULL) {
+                    descriptorOrErrorCode = pContainer->descriptor;
+                } else {
+                    cellularPortLog("CELLULAR_SOCK: unable to create socket, no free descriptors.\n");
+                }
+
+                // If we have a container, talk to cellular to
+                // create the socket there
+                if (pContainer != NULL) {
+                    atLock(pContainer);
+                    cellular_ctrl_at_cmd_start("AT+USOCR=");
+                    // Protocol will be 6 or 17
+                    cellular_ctrl_at_write_int(protocol);
+                    cellular_ctrl_at_cmd_stop();
+                    cellular_ctrl_at_resp_start("+USOCR:", false);
+                    modemHandle = cellular_ctrl_at_read_int();
+                    cellular_ctrl_at_resp_stop();
+                    if (cellular_ctrl_at_unlock_return_error() == 0) {
+                        // All is good, no need to set descriptorOrErrorCode
+                        // as it was already set above
+                        containerSetModemHandle(pContainer, modemHandle);
+                        cellularPortLog("CELLULAR_SOCK: socket created, descriptor %d, modem handle %d.\n",
+                                        descriptorOrErrorCode,
+                                        pContainer->socket.modemHandle);
+                    } else {
+                        // If the modem could not create the socket,
+                        // free the container once more
+                        containerFree(pContainer);
+                        descriptorOrErrorCode = CELLULAR_SOCK_BSD_ERROR;
+                        // Use a distinctly different errno for this
+                        errno = CELLULAR_SOCK_EIO;
+                        cellularPortLog("CELLULAR_SOCK: modem could not create socket.\n");
+                    }
+                } else {
+                    // No buffers available
+                    errno = CELLULAR_SOCK_ENOBUFS;
+                }
+
+                containerUnlock(pContainer);
+
+            } else {
+                // Not a protocol we support
+                errno = CELLULAR_SOCK_EPROTONOSUPPORT;
+            }
+        } else {
+            // Not a protocol type we support
+            errno = CELLULAR_SOCK_EPFNOSUPPORT;
+        }
+    } else {
+        // The only reason initialisation might fail
+        errno = CELLULAR_SOCK_ENOMEM;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) descriptorOrErrorCode;
+}
+
+// Make an outgoing connection on the given socket.
+int32_t cellularSockConnect(CellularSockDescriptor_t descriptor,
+                            const CellularSockAddress_t *pRemoteAddress)
+{
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    CellularSockContainer_t *pContainer = NULL;
+    char buffer[CELLULAR_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
+    int64_t startTimeMs = cellularPortGetTickTimeMs();
+    bool async;
+
+    if (init()) {
+        // Check that the remote IP address is sensible
+        if ((pRemoteAddress != NULL) &&
+            (addressToString(pRemoteAddress, false, buffer, sizeof(buffer)) > 0)) {
+
+            // Find the container and lock its socket
+            pContainer = pContainerLock(descriptor);
+
+            // If we have found the container, talk to cellular to
+            // make the connection
+            if (pContainer != NULL) {
+                // A non-blocking connect may have run out of time
+                connectCheckTimeout(pContainer);
+                if (pContainer->socket.pendingError != CELLULAR_SOCK_ENONE) {
+                    // The last non-blocking connect failed and
+                    // no-one has collected the reason, hand it over
+                    errno = pContainer->socket.pendingError;
+                    pContainer->socket.pendingError = CELLULAR_SOCK_ENONE;
+                } else if ((pContainer->socket.state == CELLULAR_SOCK_STATE_CREATED) &&
+                           !optionsFlush(pContainer)) {
+                    // The module wouldn't take the socket options
+                    // that were held for connect
+                    errno = CELLULAR_SOCK_EINVAL;
+                } else if (pContainer->socket.state == CELLULAR_SOCK_STATE_CREATED) {
+                    // A non-blocking TCP socket has the module connect
+                    // in the background, the outcome arriving in a
+                    // +UUSOCO URC, so that the AT interface is not
+                    // held for the duration
+                    async = pContainer->socket.nonBlocking &&
+                            (pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_TCP);
+                    cellularPortLog("CELLULAR_CTRL_SOCK: connecting socket to \"%s\"%s...\n",
+                                    buffer, async ? " in the background" : "");
+                    if (async) {
+                        // Be ready for the URC before sending the
+                        // command, it may arrive straight after
+                        pCellularPort_memcpy(&pContainer->socket.remoteAddress,
+                                             pRemoteAddress,
+                                             sizeof (pContainer->socket.remoteAddress));
+                        pContainer->socket.connectStopTimeMs = cellularPortGetTickTimeMs() +
+                                                               pContainer->socket.connectTimeoutMs;
+                        pContainer->socket.state = CELLULAR_SOCK_STATE_CONNECTING;
+                        // Have the timeout noticed even if no-one asks
+                        if (txFlushTaskStart()) {
+                            waitSignal(&gTxFlushWait);
+                        }
+                    }
+                    pContainer->socket.stats.numAtCommands++;
+                    atLock(pContainer);
+                    if (!async) {
+                        // The response comes once the connection is made
+                        cellular_ctrl_at_set_at_timeout((uint32_t) pContainer->socket.connectTimeoutMs,
+                                                        false);
+                    }
+                    cellular_ctrl_at_cmd_start("AT+USOCO=");
+                    // Handle
+                    cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
+                    // IP address
+                    cellular_ctrl_at_write_string(buffer, true);
+                    // Port number
+                    if ((pRemoteAddress->port > 0) || async) {
+                        cellular_ctrl_at_write_int(pRemoteAddress->port);
+                    }
+                    if (async) {
+                        // Asynchronous connect
+                        cellular_ctrl_at_write_int(1);
+                    }
+                    cellular_ctrl_at_cmd_stop_read_resp();
+                    if (!async) {
+                        cellular_ctrl_at_restore_at_timeout();
+                    }
+                    if (cellular_ctrl_at_unlock_return_error() != 0) {
+                        if (async) {
+                            pContainer->socket.state = CELLULAR_SOCK_STATE_CREATED;
+                        }
+                        // Host is not reachable
+                        errno = CELLULAR_SOCK_EHOSTUNREACH;
+                        cellularPortLog("CELLULAR_SOCK: remote address %.*s is not reachable.\n",
+                                        addressToString(pRemoteAddress, true,
+                                                        buffer, sizeof(buffer)),
+                                        buffer);
+                    } else if (async) {
+                        // The URC may already have arrived but, either
+                        // way, this is the answer for non-blocking
+                        errno = CELLULAR_SOCK_EINPROGRESS;
+                        cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, is connecting.\n",
+                                        descriptor,
+                                        pContainer->socket.modemHandle);
+                    } else {
+                        // All is good
+                        pCellularPort_memcpy(&pContainer->socket.remoteAddress,
+                                             pRemoteAddress,
+                                             sizeof (pContainer->socket.remoteAddress));
+                        pContainer->socket.state = CELLULAR_SOCK_STATE_CONNECTED;
+                        pContainer->socket.stats.numConnects++;
+                        pContainer->socket.stats.connectTimeMs += (size_t) (cellularPortGetTickTimeMs() -
+                                                                            startTimeMs);
+                        selectSignal();
+                        errorCode = CELLULAR_SOCK_SUCCESS;
+                        cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, is connected to address %.*s.\n",
+                                        descriptor,
+                                        pContainer->socket.modemHandle,
+                                        addressToString(&pContainer->socket.remoteAddress,
+                                                        true,
+                                                        buffer, sizeof(buffer)),
+                                        buffer);
+                    }
+                } else if (pContainer->socket.state == CELLULAR_SOCK_STATE_CONNECTING) {
+                    errno = CELLULAR_SOCK_EALREADY;
+                } else if (pContainer->socket.state == CELLULAR_SOCK_STATE_TIMED_OUT) {
+                    // The last non-blocking connect timed out and
+                    // was abandoned, the socket is no more use
+                    errno = CELLULAR_SOCK_ETIMEDOUT;
+                } else if ((pContainer->socket.state == CELLULAR_SOCK_STATE_CONNECTED) &&
+                           (pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_TCP)) {
+                    errno = CELLULAR_SOCK_EISCONN;
+                } else {
+                    // TODO: is "operation not permitted" the right error?
+                    errno = CELLULAR_SOCK_EPERM;
+                }
+            } else {
+                // Indicate that we weren't passed a valid socket descriptor
+                errno = CELLULAR_SOCK_EBADF;
+            }
+
+            containerUnlock(pContainer);
+
+        } else {
+            // Seems appropriate
+            errno = CELLULAR_SOCK_EDESTADDRREQ;
+        }
+    } else {
+        // The only reason initialisation might fail
+        errno = CELLULAR_SOCK_ENOMEM;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Close a socket.
+int32_t cellularSockClose(CellularSockDescriptor_t descriptor)
+{
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    CellularSockContainer_t *pContainer = NULL;
+    CellularSockState_t finalState = CELLULAR_SOCK_STATE_CLOSED;
+    bool closed = true;
+
+    if (init()) {
+
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
+
+        // If we have found the container, talk to cellular to
+        // close the socket there
+        if (pContainer != NULL) {
+            // Send anything still in the transmit buffer first;
+            // if that fails there's no-one left to tell
+            txBufferFlush(pContainer);
+            // Connections that were never accepted go too
+            acceptQueueClose(pContainer);
+            // A socket whose connect timed out has already
+            // been closed in the module
+            if (pContainer->socket.state != CELLULAR_SOCK_STATE_TIMED_OUT) {
+                atLock(pContainer);
+                // Closing can take a loong time sometimes
+                cellular_ctrl_at_set_at_timeout(CELLULAR_SOCK_CLOSE_TIMEOUT_SECONDS * 1000,
+                                                false);
+                cellular_ctrl_at_cmd_start("AT+USOCL=");
+                cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
+#ifdef CELLULAR_CFG_MODULE_SARA_R4
+                // SARA-R4, can take a long time to close a TCP
+                // socket due to being strict about waiting
+                // for the ack for the ack for the ack, so
+                // ask for an asynchronous indication
+                if ((pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_TCP) &&
+                    (pContainer->socket.state == CELLULAR_SOCK_STATE_CONNECTED)) {
+                    cellular_ctrl_at_write_int(1);
+                    finalState = CELLULAR_SOCK_STATE_CLOSING;
+                }
+#endif
+                cellular_ctrl_at_cmd_stop_read_resp();
+                cellular_ctrl_at_restore_at_timeout();
+                closed = (cellular_ctrl_at_unlock_return_error() == 0);
+            }
+            if (closed) {
+                cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, has been closed.\n",
+                                descriptor,
+                                pContainer->socket.modemHandle);
+                errorCode = CELLULAR_SOCK_SUCCESS;
+                // Now mark the socket as closed (or closing).
+                // Socket is only freed by a call to
+                // cellularSockCleanUp() in order to ensure
+                // thread-safeness
+                pContainer->socket.state = finalState;
+                // Any unread data in the receive cache is now lost
+                rxCacheFree(&(pContainer->socket));
+                txBufferFree(&(pContainer->socket));
+                // Wake up anyone blocked reading so that they notice
+                waitSignal(&(pContainer->dataWait));
+                selectSignal();
+            } else {
+                // Use a distinctly different errno for this
+                errno = CELLULAR_SOCK_EIO;
+                cellularPortLog("CELLULAR_SOCK: modem could not close socket with descriptor %d, handle %d.\n",
+                                 descriptor,
+                                 pContainer->socket.modemHandle);
+            }
+        } else {
+            // Indicate that we weren't passed a valid socket descriptor
+            errno = CELLULAR_SOCK_EBADF;
+        }
+
+        containerUnlock(pContainer);
+
+    } else {
+        // The only reason initialisation might fail
+        errno = CELLULAR_SOCK_ENOMEM;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Clean-up memory occupied by closed sockets.
+void cellularSockCleanUp()
+{
+    CellularSockContainer_t *pContainer;
+    size_t numNonClosedSockets = 0;
+
+    if (gInitialised) {
+
+        CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Return closed and closing sockets to the pool; one
+        // that is still locked is in use by someone who has yet
+        // to notice that it is closed, leave that for next time
+        // rather than wait for it with the container mutex locked
+        for (size_t x = 0; x < sizeof(gContainers) / sizeof(gContainers[0]); x++) {
+            pContainer = &(gContainers[x]);
+            if (((pContainer->socket.state == CELLULAR_SOCK_STATE_CLOSED) ||
+                 (pContainer->socket.state == CELLULAR_SOCK_STATE_CLOSING)) &&
+                (cellularPortMutexTryLock(pContainer->mutex, 0) == 0)) {
+                containerFree(pContainer);
+                containerUnlock(pContainer);
+            } else {
+                // Count the number of non-closed sockets
+                numNonClosedSockets++;
+            }
+        }
+
+        // If everything has been closed, we can deinit()
+        if (numNonClosedSockets == 0) {
+            deinitButNotMutex();
+        }
+
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
+}
+
+// Deinitialise sockets.
+void cellularSockDeinit()
+{
+    if (gInitialised) {
+
+        // Return all sockets to the pool, waiting for any
+        // that are busy
+        for (size_t x = 0; x < sizeof(gContainers) / sizeof(gContainers[0]); x++) {
+            cellularPortMutexLock(gContainers[x].mutex);
+            containerFree(&(gContainers[x]));
+            containerUnlock(&(gContainers[x]));
+        }
+
+        CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // We can now deinit()
+        deinitButNotMutex();
+        selectSignal();
+
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
+
+    // The DNS cache outlives cellularSockCleanUp(), which is
+    // what a reconnect does, but not this: the next module,
+    // or network, may see things differently
+    if (gMutexDns != NULL) {
+
+        CELLULAR_PORT_MUTEX_LOCK(gMutexDns);
+
+        dnsCacheFlush();
+
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexDns);
+    }
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: CONFIGURE
+ * -------------------------------------------------------------- */
+
+// Configure the given socket's file parameters.
+int32_t cellularSockFcntl(CellularSockDescriptor_t descriptor,
+                          int32_t command,
+                          int32_t value)
+{
+    // Since the return value depends upon the command, 
+    // the only reliable error value for FCNTL is -1.
+    CellularSockErrorCode_t errorCodeOrReturnValue = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    CellularSockContainer_t *pContainer = NULL;
+
+    if (init()) {
+
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
+
+        if (pContainer != NULL) {
+            switch (command) {
+                case CELLULAR_SOCK_FCNTL_SET_STATUS:
+                    pContainer->socket.nonBlocking =
+                      ((value & CELLULAR_SOCK_FCNTL_STATUS_NONBLOCK) != 0);
+                    errorCodeOrReturnValue = CELLULAR_SOCK_SUCCESS;
+                break;
+                case CELLULAR_SOCK_FCNTL_GET_STATUS:
+                    // From here on errorCodeOrReturnValue is a return value
+                    errorCodeOrReturnValue = 0;
+                    if (pContainer->socket.nonBlocking) {
+                        errorCodeOrReturnValue = CELLULAR_SOCK_FCNTL_STATUS_NONBLOCK;
+                    }
+                break;
+                default:
+                    // Invalid argument
+                    errno = CELLULAR_SOCK_EINVAL;
+                break;
+            }
+        } else {
+            // Indicate that we weren't passed a valid socket descriptor
+            errno = CELLULAR_SOCK_EBADF;
+        }
+
+        containerUnlock(pContainer);
+
+    } else {
+        // The only reason initialisation might fail
+        errno = CELLULAR_SOCK_ENOMEM;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCodeOrReturnValue;
+}
+
+// Configure the given socket's device parameters.
+int32_t cellularSockIoctl(CellularSockDescriptor_t descriptor,
+                          int32_t command,
+                          void *pValue)
+{
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    CellularSockContainer_t *pContainer = NULL;
+
+    if (init()) {
+
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
+
+        if (pContainer != NULL) {
+            switch (command) {
+                case CELLULAR_SOCK_IOCTL_SET_NONBLOCK:
+                    if (pValue != NULL) {
+                        pContainer->socket.nonBlocking = (*(int32_t *) pValue != 0);
+                        errorCode = CELLULAR_SOCK_SUCCESS;
+                    }
+                break;
+                case CELLULAR_SOCK_IOCTL_GET_NREAD:
+                    if (pValue != NULL) {
+                        *(int32_t *) pValue = pContainer->socket.pendingBytes +
+                                              (int32_t) pContainer->socket.rxCacheLength;
+                        errorCode = CELLULAR_SOCK_SUCCESS;
+                    }
+                break;
+                default:
+                    // Invalid argument
+                    errno = CELLULAR_SOCK_EINVAL;
+                break;
+            }
+        } else {
+            // Indicate that we weren't passed a valid socket descriptor
+            errno = CELLULAR_SOCK_EBADF;
+        }
+
+        containerUnlock(pContainer);
+
+    } else {
+        // The only reason initialisation might fail
+        errno = CELLULAR_SOCK_ENOMEM;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Set the options for the given socket.
+int32_t cellularSockSetOption(CellularSockDescriptor_t descriptor,
+                              int32_t level,
+                              uint32_t option,
+                              const void *pOptionValue,
+                              size_t optionValueLength)
+{
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    CellularSockContainer_t *pContainer = NULL;
+
+    cellularPortLog("CELLULAR_SOCK: cellularSockSetOption() called on socket %d with command %d:0x%04x.\n",
+                    descriptor, level, option);
+
+    if (init()) {
+
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
+
+        if (pContainer != NULL) {
+            // Check parameters
+            if ((optionValueLength == 0) || 
+                ((optionValueLength > 0) && (pOptionValue != NULL))) {
+                switch (level) {
+                    case CELLULAR_SOCK_OPT_LEVEL_SOCK:
+                        switch (option) {
+                            // The supported options which
+                            // have an integer as a parameter
+                            case CELLULAR_SOCK_OPT_REUSEADDR:
+                            case CELLULAR_SOCK_OPT_KEEPALIVE:
+                            case CELLULAR_SOCK_OPT_BROADCAST:
+                            case CELLULAR_SOCK_OPT_REUSEPORT:
+                                errorCode = setOptionInt(pContainer,
+                                                         level,
+                                                         option,
+                                                         pOptionValue,
+                                                         optionValueLength,
+                                                         &errno);
+                            break;
+                            // The linger option which has
+                            // cellularSock_linger as its
+                            // parameter
+                            case CELLULAR_SOCK_OPT_LINGER:
+                                errorCode = setOptionLinger(pContainer,
+                                                            pOptionValue,
+                                                            optionValueLength,
+                                                            &errno);
+                            break;
+                            // Receive timeout, which we set locally
+                            case CELLULAR_SOCK_OPT_RCVTIMEO:
+                                if ((pOptionValue != NULL) && 
+                                    (optionValueLength == sizeof(CellularPort_timeval))) {
+                                        pContainer->socket.receiveTimeoutMs = 
+                                          (((CellularPort_timeval *) pOptionValue)->tv_usec / 1000) + 
+                                          (((CellularPort_timeval *) pOptionValue)->tv_sec * 1000);
+                                    errorCode = CELLULAR_SOCK_SUCCESS;
+                                } else {
+                                    errno = CELLULAR_SOCK_EINVAL;
+                                }
+                            break;
+                            // Connect timeout, which we also set
+                            // locally; it must be non-zero as it is
+                            // used as the AT timeout of a blocking
+                            // connect
+                            case CELLULAR_SOCK_OPT_CONTIMEO:
+                                if ((pOptionValue != NULL) &&
+                                    (optionValueLength == sizeof(CellularPort_timeval)) &&
+                                    ((((CellularPort_timeval *) pOptionValue)->tv_usec / 1000) +
+                                     (((CellularPort_timeval *) pOptionValue)->tv_sec * 1000) > 0)) {
+                                    pContainer->socket.connectTimeoutMs =
+                                      (((CellularPort_timeval *) pOptionValue)->tv_usec / 1000) +
+                                      (((CellularPort_timeval *) pOptionValue)->tv_sec * 1000);
+                                    errorCode = CELLULAR_SOCK_SUCCESS;
+                                } else {
+                                    errno = CELLULAR_SOCK_EINVAL;
+                                }
+                            break;
+                            // Receive buffer size, which is the size
+                            // of our local receive cache, 0 for none
+                            case CELLULAR_SOCK_OPT_RCVBUF:
+                                if ((pOptionValue != NULL) &&
+                                    (optionValueLength == sizeof(int32_t)) &&
+                                    (*((int32_t *) pOptionValue) >= 0)) {
+                                    if (pContainer->socket.rxCacheLength == 0) {
+                                        // Free the cache, it will be
+                                        // re-allocated at the new size
+                                        // when next needed
+                                        rxCacheFree(&(pContainer->socket));
+                                        pContainer->socket.rxCacheSizeBytes = *((int32_t *) pOptionValue);
+                                        errorCode = CELLULAR_SOCK_SUCCESS;
+                                    } else {
+                                        // Can't resize the cache while
+                                        // it has data in it
+                                        errno = CELLULAR_SOCK_EBUSY;
+                                    }
+                                } else {
+                                    errno = CELLULAR_SOCK_EINVAL;
+                                }
+                            break;
+                            // Send buffer size, which is the size
+                            // of our local transmit buffer, 0 for none
+                            case CELLULAR_SOCK_OPT_SNDBUF:
+                                if ((pOptionValue != NULL) &&
+                                    (optionValueLength == sizeof(int32_t)) &&
+                                    (*((int32_t *) pOptionValue) >= 0)) {
+                                    // Send what is in the buffer and free
+                                    // it, it will be re-allocated at the
+                                    // new size when next needed
+                                    if (txBufferFlush(pContainer)) {
+                                        txBufferFree(&(pContainer->socket));
+                                        pContainer->socket.txBufferSizeBytes = *((int32_t *) pOptionValue);
+                                        errorCode = CELLULAR_SOCK_SUCCESS;
+                                    } else {
+                                        errno = CELLULAR_SOCK_EIO;
+                                    }
+                                } else {
+                                    errno = CELLULAR_SOCK_EINVAL;
+                                }
+                            break;
+                            default:
+                                // Invalid argument
+                                errno = CELLULAR_SOCK_EINVAL;
+                            break;
+                        }
+                    break;
+                    case CELLULAR_SOCK_OPT_LEVEL_IP:
+                        switch (option) {
+                            // The supported options, both of
+                            // which have an integer as a
+                            // parameter
+                            case CELLULAR_SOCK_OPT_IP_TOS:
+                            case CELLULAR_SOCK_OPT_IP_TTL:
+                                errorCode = setOptionInt(pContainer,
+                                                         level,
+                                                         option,
+                                                         pOptionValue,
+                                                         optionValueLength,
+                                                         &errno);
+                            break;
+                            default:
+                                // Invalid argument
+                                errno = CELLULAR_SOCK_EINVAL;
+                            break;
+                        }
+                    break;
+                    case CELLULAR_SOCK_OPT_LEVEL_TCP:
+                        switch (option) {
+                            // The supported options, both of
+                            // which have an integer as a
+                            // parameter; no delay also stops
+                            // us buffering locally
+                            case CELLULAR_SOCK_OPT_TCP_NODELAY:
+                                errorCode = setOptionInt(pContainer,
+                                                         level,
+                                                         option,
+                                                         pOptionValue,
+                                                         optionValueLength,
+                                                         &errno);
+                                if (errorCode == CELLULAR_SOCK_SUCCESS) {
+                                    pContainer->socket.noDelay = (*((int32_t *) pOptionValue) != 0);
+                                    if (pContainer->socket.noDelay &&
+                                        !txBufferFlush(pContainer)) {
+                                        pContainer->socket.txFlushFailed = true;
+                                    }
+                                }
+                            break;
+                            case CELLULAR_SOCK_OPT_TCP_KEEPIDLE:
+                                errorCode = setOptionInt(pContainer,
+                                                         level,
+                                                         option,
+                                                         pOptionValue,
+                                                         optionValueLength,
+                                                         &errno);
+                            break;
+                            default:
+                                // Invalid argument
+                                errno = CELLULAR_SOCK_EINVAL;
+                            break;
+                        }
+                    break;
+                    case CELLULAR_SOCK_OPT_LEVEL_TLS:
+                        switch (option) {
+                            // The security profile, which has an
+                            // integer as a parameter
+                            case CELLULAR_SOCK_OPT_TLS_SECURITY_PROFILE:
+                                errorCode = setOptionTlsSecurityProfile(pContainer,
+                                                                        pOptionValue,
+                                                                        optionValueLength,
+                                                                        &errno);
+                            break;
+                            default:
+                                // Invalid argument
+                                errno = CELLULAR_SOCK_EINVAL;
+                            break;
+                        }
+                    break;
+                    default:
+                        // Invalid argument
+                        errno = CELLULAR_SOCK_EINVAL;
+                    break;
+                }
+            } else {
+                // Invalid argument
+                errno = CELLULAR_SOCK_EINVAL;
+            }
+        } else {
+            // Indicate that we weren't passed a valid socket descriptor
+            errno = CELLULAR_SOCK_EBADF;
+        }
+
+        containerUnlock(pContainer);
+
+    } else {
+        // The only reason initialisation might fail
+        errno = CELLULAR_SOCK_ENOMEM;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Get the options for the given socket.
+int32_t cellularSockGetOption(CellularSockDescriptor_t descriptor,
+                              int32_t level,
+                              uint32_t option,
+                              void *pOptionValue,
+                              size_t *pOptionValueLength)
+{
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    CellularSockContainer_t *pContainer = NULL;
+    int64_t timeoutMs;
 
-    if (pOptionValueLength != NULL) {
-        if (pOptionValue != NULL) {
-            if (*pOptionValueLength >= sizeof(int32_t)) {
-                // Get the answer
-                if (level == CELLULAR_SOCK_OPT_LEVEL_SOCK) {
-                    level = CELLULAR_SOCK_OPT_LEVEL_SOCK_INT16;
-                }
-                cellular_ctrl_at_lock();
-                cellular_ctrl_at_cmd_start("AT+USOGO=");
-                cellular_ctrl_at_write_int(modemHandle);
-                cellular_ctrl_at_write_int(level);
-                cellular_ctrl_at_write_int(option);
-                cellular_ctrl_at_cmd_stop();
-                cellular_ctrl_at_resp_start("+USOGO:", false);
-                x = cellular_ctrl_at_read_int();
-                cellular_ctrl_at_resp_stop();
-                if ((cellular_ctrl_at_unlock_return_error() == 0) && (x >= 0)) {
-                    *((int32_t *) pOptionValue)  = x;
-                    cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, socket option %d:0x%04x (%d) is %d.\n",
-                                    descriptor, modemHandle,
-                                    level, option, option,
-                                    *((int32_t *) pOptionValue));
-                    *pOptionValueLength = sizeof(int32_t);
-                    errorCode = CELLULAR_SOCK_SUCCESS;
-                } else {
-                    // Module doesn't support it so it's an
-                    // invalid parameter
-                    *pErrno = CELLULAR_SOCK_EINVAL;
+    if (init()) {
+
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
+
+        if (pContainer != NULL) {
+            // If there's an optionValue then there must be a length
+            if ((pOptionValue == NULL) || 
+                (pOptionValueLength != NULL)) {
+                switch (level) {
+                    case CELLULAR_SOCK_OPT_LEVEL_SOCK:
+                        switch (option) {
+                            // The supported options which
+                            // have an integer as a parameter
+                            case CELLULAR_SOCK_OPT_REUSEADDR:
+                            case CELLULAR_SOCK_OPT_KEEPALIVE:
+                            case CELLULAR_SOCK_OPT_BROADCAST:
+                            case CELLULAR_SOCK_OPT_REUSEPORT:
+                                errorCode = getOptionInt(pContainer,
+                                                         level,
+                                                         option,
+                                                         pOptionValue,
+                                                         pOptionValueLength,
+                                                         &errno);
+                            break;
+                            // The linger option which has
+                            // cellularSock_linger as its
+                            // parameter
+                            case CELLULAR_SOCK_OPT_LINGER:
+                                errorCode = getOptionLinger(pContainer,
+                                                            pOptionValue,
+                                                            pOptionValueLength,
+                                                            &errno);
+                            break;
+                            // Receive and connect timeouts, which we
+                            // just get locally
+                            case CELLULAR_SOCK_OPT_RCVTIMEO:
+                            case CELLULAR_SOCK_OPT_CONTIMEO:
+                                if (pOptionValueLength != NULL) {
+                                    if (pOptionValue != NULL) {
+                                        if (*pOptionValueLength >= sizeof(CellularPort_timeval)) {
+                                            // Return the answer
+                                            timeoutMs = pContainer->socket.receiveTimeoutMs;
+                                            if (option == CELLULAR_SOCK_OPT_CONTIMEO) {
+                                                timeoutMs = pContainer->socket.connectTimeoutMs;
+                                            }
+                                            ((CellularPort_timeval *) pOptionValue)->tv_sec = 
+                                                timeoutMs / 1000;
+                                            ((CellularPort_timeval *) pOptionValue)->tv_usec = 
+                                              (timeoutMs % 1000) * 1000;
+                                            *pOptionValueLength = sizeof(CellularPort_timeval);
+                                            errorCode = CELLULAR_SOCK_SUCCESS;
+                                        } else {
+                                            // Caller hasn't left enough room
+                                            errno = CELLULAR_SOCK_EINVAL;
+                                        }
+                                    } else {
+                                        // Caller just wants to know the length required
+                                        *pOptionValueLength = sizeof(CellularPort_timeval);
+                                        errorCode = CELLULAR_SOCK_SUCCESS;
+                                    }
+                                } else {
+                                    // Invalid argument, there must be a value length
+                                    errno = CELLULAR_SOCK_EINVAL;
+                                }
+                            break;
+                            // Receive and send buffer sizes and the
+                            // socket type, which we just get locally,
+                            // and the error status, which is the outcome
+                            // of a non-blocking connect and is cleared
+                            // by reading it
+                            case CELLULAR_SOCK_OPT_RCVBUF:
+                            case CELLULAR_SOCK_OPT_SNDBUF:
+                            case CELLULAR_SOCK_OPT_ERROR:
+                            case CELLULAR_SOCK_OPT_TYPE:
+                                if (pOptionValueLength != NULL) {
+                                    if (pOptionValue != NULL) {
+                                        if (*pOptionValueLength >= sizeof(int32_t)) {
+                                            // Return the answer
+                                            if (option == CELLULAR_SOCK_OPT_ERROR) {
+                                                connectCheckTimeout(pContainer);
+                                                *((int32_t *) pOptionValue) =
+                                                    pContainer->socket.pendingError;
+                                                pContainer->socket.pendingError = CELLULAR_SOCK_ENONE;
+                                            } else if (option == CELLULAR_SOCK_OPT_TYPE) {
+                                                *((int32_t *) pOptionValue) =
+                                                    (int32_t) pContainer->socket.type;
+                                            } else if (option == CELLULAR_SOCK_OPT_RCVBUF) {
+                                                *((int32_t *) pOptionValue) =
+                                                    (int32_t) pContainer->socket.rxCacheSizeBytes;
+                                            } else {
+                                                *((int32_t *) pOptionValue) =
+                                                    (int32_t) pContainer->socket.txBufferSizeBytes;
+                                            }
+                                            *pOptionValueLength = sizeof(int32_t);
+                                            errorCode = CELLULAR_SOCK_SUCCESS;
+                                        } else {
+                                            // Caller hasn't left enough room
+                                            errno = CELLULAR_SOCK_EINVAL;
+                                        }
+                                    } else {
+                                        // Caller just wants to know the length required
+                                        *pOptionValueLength = sizeof(int32_t);
+                                        errorCode = CELLULAR_SOCK_SUCCESS;
+                                    }
+                                } else {
+                                    // Invalid argument, there must be a value length
+                                    errno = CELLULAR_SOCK_EINVAL;
+                                }
+                            break;
+                            default:
+                                // Invalid argument
+                                errno = CELLULAR_SOCK_EINVAL;
+                            break;
+                        }
+                    break;
+                    case CELLULAR_SOCK_OPT_LEVEL_IP:
+                        switch (option) {
+                            // The supported options, both of
+                            // which have an integer as a
+                            // parameter
+                            case CELLULAR_SOCK_OPT_IP_TOS:
+                            case CELLULAR_SOCK_OPT_IP_TTL:
+                                errorCode = getOptionInt(pContainer,
+                                                         level,
+                                                         option,
+                                                         pOptionValue,
+                                                         pOptionValueLength,
+                                                         &errno);
+                            break;
+                            default:
+                                // Invalid argument
+                                errno = CELLULAR_SOCK_EINVAL;
+                            break;
+                        }
+                    break;
+                    case CELLULAR_SOCK_OPT_LEVEL_TCP:
+                        switch (option) {
+                            // The supported options, both of
+                            // which have an integer as a
+                            // parameter
+                            case CELLULAR_SOCK_OPT_TCP_NODELAY:
+                            case CELLULAR_SOCK_OPT_TCP_KEEPIDLE:
+                                errorCode = getOptionInt(pContainer,
+                                                         level,
+                                                         option,
+                                                         pOptionValue,
+                                                         pOptionValueLength,
+                                                         &errno);
+                            break;
+                            default:
+                                // Invalid argument
+                                errno = CELLULAR_SOCK_EINVAL;
+                            break;
+                        }
+                    break;
+                    case CELLULAR_SOCK_OPT_LEVEL_TLS:
+                        switch (option) {
+                            // The security profile, which we
+                            // just get locally
+                            case CELLULAR_SOCK_OPT_TLS_SECURITY_PROFILE:
+                                if (pOptionValueLength != NULL) {
+                                    if (pOptionValue != NULL) {
+                                        if (*pOptionValueLength >= sizeof(int32_t)) {
+                                            // Return the answer
+                                            *((int32_t *) pOptionValue) =
+                                                pContainer->socket.securityProfile;
+                                            *pOptionValueLength = sizeof(int32_t);
+                                            errorCode = CELLULAR_SOCK_SUCCESS;
+                                        } else {
+                                            // Caller hasn't left enough room
+                                            errno = CELLULAR_SOCK_EINVAL;
+                                        }
+                                    } else {
+                                        // Caller just wants to know the length required
+                                        *pOptionValueLength = sizeof(int32_t);
+                                        errorCode = CELLULAR_SOCK_SUCCESS;
+                                    }
+                                } else {
+                                    // Invalid argument, there must be a value length
+                                    errno = CELLULAR_SOCK_EINVAL;
+                                }
+                            break;
+                            default:
+                                // Invalid argument
+                                errno = CELLULAR_SOCK_EINVAL;
+                            break;
+                        }
+                    break;
+                    default:
+                        // Invalid argument
+                        errno = CELLULAR_SOCK_EINVAL;
+                    break;
                 }
             } else {
-                // Caller hasn't left enough room
-                *pErrno = CELLULAR_SOCK_EINVAL;
+                // Invalid argument
+                errno = CELLULAR_SOCK_EINVAL;
             }
         } else {
-            // Caller just wants to know the length required
-            *pOptionValueLength = sizeof(int32_t);
-            errorCode = CELLULAR_SOCK_SUCCESS;
+            // Indicate that we weren't passed a valid socket descriptor
+            errno = CELLULAR_SOCK_EBADF;
         }
+
+        containerUnlock(pContainer);
+
     } else {
-        // Invalid argument, there must be a value length pointer
-        *pErrno = CELLULAR_SOCK_EINVAL;
+        // The only reason initialisation might fail
+        errno = CELLULAR_SOCK_ENOMEM;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
     }
 
     return (int32_t) errorCode;
 }
 
-// Set the linger socket option.
-static int32_t setOptionLinger(CellularSockDescriptor_t descriptor,
-                               int32_t modemHandle,
-                               const void *pOptionValue,
-                               size_t optionValueLength,
-                               int32_t *pErrno)
+// Get the statistics of getting and setting the socket options
+// that the module holds.
+int32_t cellularSockGetOptionCacheStats(CellularSockOptionCacheStats_t *pStats)
 {
     CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
 
-    if ((pOptionValue != NULL) && 
-        (optionValueLength >= sizeof(CellularSockLinger_t))) {
-        cellular_ctrl_at_lock();
-        cellular_ctrl_at_cmd_start("AT+USOSO=");
-        cellular_ctrl_at_write_int(modemHandle);
-        cellular_ctrl_at_write_int(CELLULAR_SOCK_OPT_LEVEL_SOCK_INT16);
-        cellular_ctrl_at_write_int(CELLULAR_SOCK_OPT_LINGER);
-        cellular_ctrl_at_write_int(((CellularSockLinger_t *) pOptionValue)->l_onoff);
-        if (((CellularSockLinger_t *) pOptionValue)->l_onoff == 1) {
-            cellular_ctrl_at_write_int(((CellularSockLinger_t *) pOptionValue)->l_linger);
-        }
-        cellular_ctrl_at_cmd_stop_read_resp();
-        if (cellular_ctrl_at_unlock_return_error() == 0) {
-            if (((CellularSockLinger_t *) pOptionValue)->l_onoff == 1) {
-                cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, linger set to %d and %d ms.\n",
-                                descriptor, modemHandle,
-                                ((CellularSockLinger_t *) pOptionValue)->l_onoff,
-                                ((CellularSockLinger_t *) pOptionValue)->l_linger);
-            } else {
-                cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, linger option set to %d.\n",
-                                descriptor, modemHandle,
-                                ((CellularSockLinger_t *) pOptionValue)->l_onoff);
-            }
+    if (pStats != NULL) {
+        if (init()) {
+
+            CELLULAR_PORT_MUTEX_LOCK(gMutexStats);
+
+            *pStats = gOptionCacheStats;
             errorCode = CELLULAR_SOCK_SUCCESS;
+
+            CELLULAR_PORT_MUTEX_UNLOCK(gMutexStats);
+
         } else {
-            // Module doesn't like it so there must be an
-            // invalid parameter
-            *pErrno = CELLULAR_SOCK_EINVAL;
+            // The only reason initialisation might fail
+            errno = CELLULAR_SOCK_ENOMEM;
         }
     } else {
-        *pErrno = CELLULAR_SOCK_EINVAL;
+        // Invalid argument
+        errno = CELLULAR_SOCK_EINVAL;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
     }
 
     return (int32_t) errorCode;
 }
 
-// Get the linger socket option.
-static int32_t getOptionLinger(CellularSockDescriptor_t descriptor,
-                               int32_t modemHandle,
-                               void *pOptionValue,
-                               size_t *pOptionValueLength,
-                               int32_t *pErrno)
+// Reset the statistics of getting and setting the socket options
+// that the module holds.
+void cellularSockResetOptionCacheStats()
 {
-    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
-    int32_t x;
-    int32_t y = -1;
+    if (init()) {
 
-    if (pOptionValueLength != NULL) {
-        if (pOptionValue != NULL) {
-            if (*pOptionValueLength >= sizeof(CellularSockLinger_t)) {
-                // Get the answer
-                cellular_ctrl_at_lock();
-                cellular_ctrl_at_cmd_start("AT+USOGO=");
-                cellular_ctrl_at_write_int(modemHandle);
-                cellular_ctrl_at_write_int(CELLULAR_SOCK_OPT_LEVEL_SOCK_INT16);
-                cellular_ctrl_at_write_int(CELLULAR_SOCK_OPT_LINGER);
-                cellular_ctrl_at_cmd_stop();
-                cellular_ctrl_at_resp_start("+USOGO:", false);
-                x = cellular_ctrl_at_read_int();
-                // Second parameter is only relevant if
-                // the first is 1
-                if (x == 1) {
-                    y = cellular_ctrl_at_read_int();
-                }
-                cellular_ctrl_at_resp_stop();
-                if (cellular_ctrl_at_unlock_return_error() == 0) {
-                    if (x == 0) {
-                        ((CellularSockLinger_t *) pOptionValue)->l_onoff = x;
-                        *pOptionValueLength = sizeof(CellularSockLinger_t);
-                        errorCode = CELLULAR_SOCK_SUCCESS;
-                        cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, linger option is %d.\n",
-                                        descriptor, modemHandle,
-                                        ((CellularSockLinger_t *) pOptionValue)->l_onoff);
-                    } else if ((x == 1) && (y >= 0)) {
-                        // If x is 1, y must be present
-                        ((CellularSockLinger_t *) pOptionValue)->l_onoff = x;
-                        ((CellularSockLinger_t *) pOptionValue)->l_linger = y;
-                        *pOptionValueLength = sizeof(CellularSockLinger_t);
-                        errorCode = CELLULAR_SOCK_SUCCESS;
-                        cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, linger option is %d and %d ms.\n",
-                                        descriptor, modemHandle,
-                                        ((CellularSockLinger_t *) pOptionValue)->l_onoff,
-                                        ((CellularSockLinger_t *) pOptionValue)->l_linger);
-                    } else {
-                        // This is a device error but there doesn't
-                        // seem to be an errno for that, this seems
-                        // closest
-                        *pErrno = CELLULAR_SOCK_EIO;
-                    }
-                } else {
-                    // Module obviously doesn't support it so it's an
-                    // invalid parameter
-                    *pErrno = CELLULAR_SOCK_EINVAL;
-                }
-            } else {
-                // Caller hasn't left enough room
-                *pErrno = CELLULAR_SOCK_EINVAL;
-            }
-        } else {
-            // Caller just wants to know the length required
-            *pOptionValueLength = sizeof(CellularSockLinger_t);
-            errorCode = CELLULAR_SOCK_SUCCESS;
-        }
-    } else {
-        // Invalid argument, there must be a value length pointer
-        *pErrno = CELLULAR_SOCK_EINVAL;
-    }
+        CELLULAR_PORT_MUTEX_LOCK(gMutexStats);
 
-    return (int32_t) errorCode;
+        pCellularPort_memset(&gOptionCacheStats, 0, sizeof(gOptionCacheStats));
+
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexStats);
+    }
 }
 
 /* ----------------------------------------------------------------
- * STATIC FUNCTIONS: SENDING AND RECEIVING
+ * PUBLIC FUNCTIONS: UDP ONLY
  * -------------------------------------------------------------- */
 
-// Send data, UDP style.
-int32_t sendTo(CellularSockContainer_t *pContainer,
-               const CellularSockAddress_t *pRemoteAddress,
-               const void *pData, size_t dataSizeBytes)
+// Send a datagram to the given host.
+int32_t cellularSockSendTo(CellularSockDescriptor_t descriptor,
+                           const CellularSockAddress_t *pRemoteAddress,
+                           const void *pData, size_t dataSizeBytes)
 {
     CellularSockErrorCode_t errorCodeOrSize = CELLULAR_SOCK_BSD_ERROR;
     int32_t errno = CELLULAR_SOCK_ENONE;
-    char buffer[CELLULAR_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
-    int32_t sentSize = 0;
+    CellularSockContainer_t *pContainer = NULL;
 
-    // Get the address as a string
-    if (addressToString(pRemoteAddress,
-                        false,
-                        buffer, 
-                        sizeof(buffer)) > 0) {
-        if (dataSizeBytes > 0) {
-            if (dataSizeBytes <= CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES) {
-                cellular_ctrl_at_lock();
-                cellular_ctrl_at_cmd_start("AT+USOST=");
-                // Handle
-                cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
-                // IP address
-                cellular_ctrl_at_write_string(buffer, true);
-                // Port number
-                cellular_ctrl_at_write_int(pRemoteAddress->port);
-                // Number of bytes to follow
-                cellular_ctrl_at_write_int(dataSizeBytes);
-                cellular_ctrl_at_cmd_stop();
-                // Wait for the prompt
-                if (cellular_ctrl_at_wait_char('@')) {
-                    // Wait for it...
-                    cellularPortTaskBlock(50);
-                    // Go!
-                    cellular_ctrl_at_write_bytes((uint8_t *) pData,
-                                                 dataSizeBytes);
-                    // Grab the response
-                    cellular_ctrl_at_resp_start("+USOST:", false);
-                    // Skip the socket ID
-                    cellular_ctrl_at_skip_param(1);
-                    // Bytes sent
-                    sentSize = cellular_ctrl_at_read_int();
-                    cellular_ctrl_at_resp_stop();
-                    if (cellular_ctrl_at_unlock_return_error() == 0) {
-                        // All is good, probably
-                        errorCodeOrSize = sentSize;
+    if (init()) {
+
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
+
+        // If we have found the container, talk to cellular to
+        // do the sending
+        if (pContainer != NULL) {
+            // Check parameters
+            if (pRemoteAddress == NULL) {
+                // If there is no remote address and the socket was
+                // connected we must use the stored address
+                if (pContainer->socket.state == CELLULAR_SOCK_STATE_CONNECTED) {
+                    pRemoteAddress = &(pContainer->socket.remoteAddress);
+                } else {
+                    if ((pContainer->socket.state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_WRITE) ||
+                        (pContainer->socket.state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
+                        // Socket is shut down
+                        errno = CELLULAR_SOCK_ESHUTDOWN;
+                    } else if (pContainer->socket.state == CELLULAR_SOCK_STATE_CLOSING) {
+                        // I know connection isn't strictly relevant
+                        // to UDP transmission but I can't see anything
+                        // more appropriate to return
+                        errno = CELLULAR_SOCK_ENOTCONN;
                     } else {
-                        // No route to host
-                        errno = CELLULAR_SOCK_EHOSTUNREACH;
+                        // Destination address required?
+                        errno = CELLULAR_SOCK_EDESTADDRREQ;
                     }
-                } else {
-                    cellular_ctrl_at_unlock();
                 }
-            } else {
-                // Indicate that the message was too long
-                errno = CELLULAR_SOCK_EMSGSIZE;
             }
-        } else {
-            // Nothing to do
-            errorCodeOrSize = CELLULAR_SOCK_SUCCESS;
-        }
-    } else {
-        // Seems appropriate
-        errno = CELLULAR_SOCK_EDESTADDRREQ;
-    }
-
-    if (errno != CELLULAR_SOCK_ENONE) {
-        // Write the errno
-        cellularPort_errno_set(errno);
-    }
-
-    return (int32_t) errorCodeOrSize;
-}
-
-// Send data, TCP style.
-int32_t send(CellularSockContainer_t *pContainer,
-             const void *pData, size_t dataSizeBytes)
-{
-    CellularSockErrorCode_t errorCodeOrSize = CELLULAR_SOCK_BSD_ERROR;
-    int32_t errno = CELLULAR_SOCK_ENONE;
-    int32_t sentSize = 0;
-    int32_t leftToSendSize = dataSizeBytes;
-    int32_t thisSendSize = CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES;
-    size_t loopCounter = 0;
-    bool success = true;
-
-    while ((leftToSendSize > 0) && success) {
-        loopCounter++;
-        if (leftToSendSize < thisSendSize) {
-            thisSendSize = leftToSendSize;
-        }
-        cellular_ctrl_at_lock();
-        cellular_ctrl_at_cmd_start("AT+USOWR=");
-        // Handle
-        cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
-        // Number of bytes to follow
-        cellular_ctrl_at_write_int(thisSendSize);
-        cellular_ctrl_at_cmd_stop();
-        // Wait for the prompt
-        success = cellular_ctrl_at_wait_char('@');
-        if (success) {
-            // Wait for it...
-            cellularPortTaskBlock(50);
-            // Go!
-            cellular_ctrl_at_write_bytes((uint8_t *) pData,
-                                         dataSizeBytes);
-            // Grab the response
-            cellular_ctrl_at_resp_start("+USOWR:", false);
-            // Skip the socket ID
-            cellular_ctrl_at_skip_param(1);
-            // Bytes sent
-            sentSize = cellular_ctrl_at_read_int();
-            cellular_ctrl_at_resp_stop();
-            if (cellular_ctrl_at_unlock_return_error() == 0) {
-                pData += sentSize;
-                leftToSendSize -= sentSize;
-                // Technically, it should be OK to
-                // send fewer bytes than asked for,
-                // however if this happens a lot we'll
-                // get stuck, which isn't desirable,
-                // so use the loop counter to avoid that
-                if ((sentSize < thisSendSize) &&
-                    (loopCounter >= CELLULAR_SOCK_TCP_RETRY_LIMIT)) {
-                    success = false;
+            if ((pRemoteAddress != NULL) &&
+                (errno == CELLULAR_SOCK_ENONE)) {
+                if ((pData == NULL) && (dataSizeBytes > 0)) {
+                    // Invalid argument
+                    errno = CELLULAR_SOCK_EINVAL;
+                } else {
+                    if ((pData != NULL) && (dataSizeBytes > 0)) {
+                        // It's OK to send UDP packets on a TCP socket
+                        if ((pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_UDP) ||
+                            (pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_TCP)) {
+                            errorCodeOrSize = sendTo(pContainer, pRemoteAddress,
+                                                     pData, dataSizeBytes);
+                        } else {
+                            // Should never get here, throw 'em a googley so that the
+                            // error is distinct
+                            errno = CELLULAR_SOCK_EPROTOTYPE;
+                        }
+                    } else {
+                        // Nothing to do
+                        errorCodeOrSize = CELLULAR_SOCK_SUCCESS;
+                    }
                 }
-            } else {
-                success = false;
             }
         } else {
-            cellular_ctrl_at_unlock();
+            // Indicate that we weren't passed a valid socket descriptor
+            errno = CELLULAR_SOCK_EBADF;
         }
-    }
 
-    if (success && (cellular_ctrl_at_get_last_error() == 0)) {
-        // All is good
-        errorCodeOrSize = dataSizeBytes - leftToSendSize;
+        containerUnlock(pContainer);
+
+    } else {
+        // The only reason initialisation might fail
+        errno = CELLULAR_SOCK_ENOMEM;
     }
 
     if (errno != CELLULAR_SOCK_ENONE) {
@@ -1109,155 +4978,67 @@ int32_t send(CellularSockContainer_t *pContainer,
     return (int32_t) errorCodeOrSize;
 }
 
-// Receive data, UDP style.
-// Notes: pRemoteAddress may be NULL, it is valid
-// to receive a zero length UDP packet, one whole
-// UDP packet is received by each USORF command,
-// gMutexContainer must be locked on entry.
-int32_t receiveFrom(CellularSockContainer_t *pContainer,
-                    CellularSockAddress_t *pRemoteAddress,
-                    void *pData, size_t dataSizeBytes)
+// Send a number of datagrams in one go.
+int32_t cellularSockSendToMulti(CellularSockDescriptor_t descriptor,
+                                CellularSockDatagram_t *pDatagrams,
+                                size_t numDatagrams)
 {
-    CellularSockErrorCode_t errorCodeOrSize = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockErrorCode_t errorCodeOrNum = CELLULAR_SOCK_BSD_ERROR;
     int32_t errno = CELLULAR_SOCK_ENONE;
-    int32_t startTimeMs = cellularPortGetTickTimeMs();
-    char buffer[CELLULAR_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
-    int32_t x = -1;
-    int32_t actualReceiveSize;
-    int32_t receivedSize = -1;
-    uint8_t quoteMark;
-    bool success = true;
-
-    // Note: the real maximum length of UDP packet we can receive
-    // comes from fitting all of the following into one buffer:
-    //
-    // +USORF: xx,"max.len.ip.address.ipv4.or.ipv6",yyyyy,wwww,"the_data"\r\n
-    //
-    // where xx is the handle, max.len.ip.address.ipv4.or.ipv6 is NSAPI_IP_SIZE,
-    // yyyyy is the port number (max 65536), wwww is the length of the data and
-    // the_data is binary data. I make that 29 + 48 + len(the_data),
-    // so the overhead is 77 bytes.
+    CellularSockContainer_t *pContainer = NULL;
 
-    if (pContainer->socket.pendingBytes == 0) {
-        cellular_ctrl_at_lock();
-        // If the URC has not filled in pendingBytes, 
-        // ask the module directly if there is anything
-        // to read
-        cellular_ctrl_at_cmd_start("AT+USORF=");
-        // Handle
-        cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
-        // Zero bytes to read, just want to know the number
-        // of bytes waiting
-        cellular_ctrl_at_write_int(0);
-        cellular_ctrl_at_cmd_stop();
-        cellular_ctrl_at_resp_start("+USORF:", false);
-        // Skip the socket ID
-        cellular_ctrl_at_skip_param(1);
-        // Read the amount of data
-        x = cellular_ctrl_at_read_int();
-        cellular_ctrl_at_resp_stop();
-        if (x >= 0) {
-            pContainer->socket.pendingBytes = x;
+    if ((pDatagrams == NULL) || (numDatagrams == 0)) {
+        // Invalid argument
+        errno = CELLULAR_SOCK_EINVAL;
+    }
+    // Check all of the datagrams up front so that we
+    // don't send half of them and then give up
+    for (size_t x = 0; (errno == CELLULAR_SOCK_ENONE) && (x < numDatagrams); x++) {
+        if ((pDatagrams[x].pData == NULL) && (pDatagrams[x].dataSizeBytes > 0)) {
+            // Invalid argument
+            errno = CELLULAR_SOCK_EINVAL;
+        } else if (pDatagrams[x].dataSizeBytes > CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES) {
+            // Indicate that the message was too long
+            errno = CELLULAR_SOCK_EMSGSIZE;
         }
-        cellular_ctrl_at_unlock();
     }
-    // Run around the loop until a packet of data turns up or we time out
-    while (success && (dataSizeBytes > 0) && (receivedSize < 0)) {
-        if (pContainer->socket.pendingBytes > 0) {
-            // In the UDP case we HAVE to read the number
-            // of bytes pending as this will be the size
-            // of the next UDP packet in the module and the
-            // module can only deliver whole UDP packets.
-            cellular_ctrl_at_lock();
-            cellular_ctrl_at_cmd_start("AT+USORF=");
-            // Handle
-            cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
-            // Number of bytes to read
-            cellular_ctrl_at_write_int(CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES);
-            cellular_ctrl_at_cmd_stop();
-            cellular_ctrl_at_resp_start("+USORF:", false);
-            // Skip the socket ID
-            cellular_ctrl_at_skip_param(1);
-            // Read the IP address
-            cellular_ctrl_at_read_string(buffer, sizeof(buffer), false);
-            // Read the port
-            x = cellular_ctrl_at_read_int();
-            // Read the amount of data
-            actualReceiveSize = cellular_ctrl_at_read_int();
-            if (actualReceiveSize > CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES) {
-                actualReceiveSize = CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES;
-            }
-            if (dataSizeBytes > actualReceiveSize) {
-                dataSizeBytes = actualReceiveSize;
-            }
-            if (actualReceiveSize > 0) {
-                // Don't stop for anything!
-                cellular_ctrl_at_set_delimiter(0);
-                cellular_ctrl_at_set_stop_tag(NULL);
-                // Get the leading quote mark out of the way
-                cellular_ctrl_at_read_bytes(&quoteMark, 1);
-                // Now read out all the actual data,
-                // first the bit we want
-                cellular_ctrl_at_read_bytes((uint8_t *) pData,
-                                            dataSizeBytes);
-                if (actualReceiveSize > dataSizeBytes) {
-                    //...and then the rest poured away to NULL
-                    cellular_ctrl_at_read_bytes(NULL,
-                                                actualReceiveSize - dataSizeBytes);
-                }
-                cellular_ctrl_at_resp_stop();
-                cellular_ctrl_at_set_default_delimiter();
-            }
-            // BEFORE unlocking, work out what's happened
-            // this is to prevent a URC being processed that
-            // may indicate data left, over-write pendingBytes
-            // while we're also writing to it.
-            if (cellular_ctrl_at_get_last_error() == 0) {
-                // Must use what +USORF returns here as it may be less
-                // or more than we asked for and also may be
-                // more than pendingBytes, depending on how
-                // the URCs landed
-                // This update of pendingBytes will be overwritten
-                // by the URC but we have to do something here
-                // 'cos we don't get a URC to tell us when pendingBytes
-                // has gone to zero.
-                if (actualReceiveSize > pContainer->socket.pendingBytes) {
-                    pContainer->socket.pendingBytes = 0;
-                } else {
-                    pContainer->socket.pendingBytes -= actualReceiveSize;
-                }
-                if (actualReceiveSize >= 0) {
-                    receivedSize = actualReceiveSize;
-                    dataSizeBytes -= actualReceiveSize;
+
+    if (init()) {
+
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
+
+        // If we have found the container, talk to cellular to
+        // do the sending
+        if (pContainer != NULL) {
+            if (errno == CELLULAR_SOCK_ENONE) {
+                if (pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_UDP) {
+                    if ((pContainer->socket.state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_WRITE) ||
+                        (pContainer->socket.state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
+                        // Socket is shut down
+                        errno = CELLULAR_SOCK_ESHUTDOWN;
+                    } else if (pContainer->socket.state == CELLULAR_SOCK_STATE_CLOSING) {
+                        // As for cellularSockSendTo()
+                        errno = CELLULAR_SOCK_ENOTCONN;
+                    } else {
+                        errorCodeOrNum = sendToMulti(pContainer, pDatagrams,
+                                                     numDatagrams);
+                    }
                 } else {
-                    // cellular_ctrl_at_read_bytes() should not fail
-                    success = false;
+                    // Datagrams only go to UDP sockets
+                    errno = CELLULAR_SOCK_EPROTOTYPE;
                 }
-            } else {
-                success = false;
             }
-            cellular_ctrl_at_unlock();
-        } else if (!pContainer->socket.nonBlocking &&
-                   (cellularPortGetTickTimeMs() - startTimeMs < pContainer->socket.receiveTimeoutMs)) {
-            // Yield to the AT parser task that is listening for URCs
-            // that indicated incoming data
-            cellularPortTaskBlock(10);
         } else {
-            // Timeout with nothing received
-            // Indicate that we would have blocked here
-            success = false;
-            errno = CELLULAR_SOCK_EWOULDBLOCK;
+            // Indicate that we weren't passed a valid socket descriptor
+            errno = CELLULAR_SOCK_EBADF;
         }
-    }
 
-    if (success && (receivedSize >= 0) && (pRemoteAddress != NULL) && (x >= 0)) {
-        success = (cellularSockStringToAddress(buffer, pRemoteAddress) == 0);
-        pRemoteAddress->port = x;
-    }
+        containerUnlock(pContainer);
 
-    // Set the return code
-    if (success) {
-        errorCodeOrSize = receivedSize;
+    } else {
+        // The only reason initialisation might fail
+        errno = CELLULAR_SOCK_ENOMEM;
     }
 
     if (errno != CELLULAR_SOCK_ENONE) {
@@ -1265,132 +5046,69 @@ int32_t receiveFrom(CellularSockContainer_t *pContainer,
         cellularPort_errno_set(errno);
     }
 
-    return (int32_t) errorCodeOrSize;
+    return (int32_t) errorCodeOrNum;
 }
 
-// Receive data, TCP style.
-// Note: gMutexContainer must be locked on entry.
-int32_t receive(CellularSockContainer_t *pContainer,
-                void *pData, size_t dataSizeBytes)
+// Receive a datagram from the given host.
+int32_t cellularSockReceiveFrom(CellularSockDescriptor_t descriptor,
+                                CellularSockAddress_t *pRemoteAddress,
+                                void *pData, size_t dataSizeBytes)
 {
     CellularSockErrorCode_t errorCodeOrSize = CELLULAR_SOCK_BSD_ERROR;
     int32_t errno = CELLULAR_SOCK_ENONE;
-    int32_t startTimeMs = cellularPortGetTickTimeMs();
-    int32_t wantedReceiveSize;
-    int32_t actualReceiveSize;
-    int32_t receivedSize = 0;
-    int32_t x = 0;
-    bool success = true;
-    uint8_t quoteMark;
+    CellularSockContainer_t *pContainer = NULL;
 
-    if (pContainer->socket.pendingBytes == 0) {
-        cellular_ctrl_at_lock();
-        // If the URC has not filled in pendingBytes, 
-        // ask the module directly if there is anything
-        // to read
-        cellular_ctrl_at_cmd_start("AT+USORD=");
-        // Handle
-        cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
-        // Zero bytes to read, just want to know the number
-        // of bytes waiting
-        cellular_ctrl_at_write_int(0);
-        cellular_ctrl_at_cmd_stop();
-        cellular_ctrl_at_resp_start("+USORD:", false);
-        // Skip the socket ID
-        cellular_ctrl_at_skip_param(1);
-        // Read the amount of data
-        x = cellular_ctrl_at_read_int();
-        cellular_ctrl_at_resp_stop();
-        if (x >= 0) {
-            pContainer->socket.pendingBytes = x;
-        }
-        cellular_ctrl_at_unlock();
-    }
-    // Run around the loop until we run out of room in the buffer
-    // or we time out
-    while (success && (dataSizeBytes > 0)) {
-        wantedReceiveSize = CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES;
-        if (wantedReceiveSize > dataSizeBytes) {
-            wantedReceiveSize = dataSizeBytes;
-        }
-        if (pContainer->socket.pendingBytes > 0) {
-            cellular_ctrl_at_lock();
-            cellular_ctrl_at_cmd_start("AT+USORD=");
-            // Handle
-            cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
-            // Number of bytes to read
-            cellular_ctrl_at_write_int(wantedReceiveSize);
-            cellular_ctrl_at_cmd_stop();
-            cellular_ctrl_at_resp_start("+USORD:", false);
-            // Skip the socket ID
-            cellular_ctrl_at_skip_param(1);
-            // Read the amount of data
-            actualReceiveSize = cellular_ctrl_at_read_int();
-            if (actualReceiveSize > dataSizeBytes) {
-                actualReceiveSize = dataSizeBytes;
-            }
-            if (actualReceiveSize > 0) {
-                // Don't stop for anything!
-                cellular_ctrl_at_set_delimiter(0);
-                cellular_ctrl_at_set_stop_tag(NULL);
-                // Get the leading quote mark out of the way
-                cellular_ctrl_at_read_bytes(&quoteMark, 1);
-                // Now read the actual data
-                cellular_ctrl_at_read_bytes((uint8_t *) (pData + receivedSize),
-                                            actualReceiveSize);
-                cellular_ctrl_at_resp_stop();
-                cellular_ctrl_at_set_default_delimiter();
-            }
-            // BEFORE unlocking, work out what's happened
-            // this is to prevent a URC being processed that
-            // may indicate data left, over-write pendingBytes
-            // while we're also writing to it.
-            if (cellular_ctrl_at_get_last_error() == 0) {
-                // Must use what +USORF returns here as it may be less
-                // or more than we asked for and also may be
-                // more than pendingBytes, depending on how
-                // the URCs landed
-                // This update of pendingBytes will be overwritten
-                // by the URC but we have to do something here
-                // 'cos we don't get a URC to tell us when pendingBytes
-                // has gone to zero.
-                if (actualReceiveSize > pContainer->socket.pendingBytes) {
-                    pContainer->socket.pendingBytes = 0;
-                } else {
-                    pContainer->socket.pendingBytes -= actualReceiveSize;
-                }
-                if (actualReceiveSize > 0) {
-                    receivedSize += actualReceiveSize;
-                    dataSizeBytes -= actualReceiveSize;
+    if (init()) {
+
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
+
+        // If we have found the container, talk to cellular to
+        // do the receiving
+        if (pContainer != NULL) {
+            if ((pData == NULL) && (dataSizeBytes > 0)) {
+                // Invalid argument
+                errno = CELLULAR_SOCK_EINVAL;
+            } else {
+                if ((pData != NULL) && (dataSizeBytes > 0)) {
+                    // It's OK to receive UDP packets on a TCP socket
+                    if ((pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_UDP) ||
+                        (pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_TCP)) {
+                        if (pContainer->socket.state != CELLULAR_SOCK_STATE_CLOSING) {
+                            if ((pContainer->socket.state != CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ) &&
+                                (pContainer->socket.state != CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
+                                errorCodeOrSize = receiveFrom(pContainer, pRemoteAddress,
+                                                              pData, dataSizeBytes);
+                            } else {
+                                // Socket is shut down
+                                errno = CELLULAR_SOCK_ESHUTDOWN;
+                            }
+                        } else {
+                            // I know connection isn't strictly relevant
+                            // to UDP transmission but I can't see anything
+                            // more appropriate to return
+                            errno = CELLULAR_SOCK_ENOTCONN;
+                        }
+                    } else {
+                        // Should never get here, throw 'em a googley so that the
+                        // error is distinct
+                        errno = CELLULAR_SOCK_EPROTOTYPE;
+                    }
                 } else {
-                    // cellular_ctrl_at_read_bytes() should not fail
-                    success = false;
+                    // Not an error, just nothing to do
+                    errorCodeOrSize = CELLULAR_SOCK_SUCCESS;
                 }
-            } else {
-                success = false;
             }
-            cellular_ctrl_at_unlock();
-        } else if (!pContainer->socket.nonBlocking &&
-                   cellularPortGetTickTimeMs() - startTimeMs < pContainer->socket.receiveTimeoutMs) {
-            // Yield to the AT parser task that is listening for URCs
-            // that indicate incoming data
-            cellularPortTaskBlock(10);
         } else {
-            if (receivedSize == 0) {
-                // Timeout with nothing received
-                // Indicate that we would have blocked here
-                success = false;
-                errno = CELLULAR_SOCK_EWOULDBLOCK;
-            }
-            // Timed out, after maybe having received something,
-            // leave with what we have
-            break;
+            // Indicate that we weren't passed a valid socket descriptor
+            errno = CELLULAR_SOCK_EBADF;
         }
-    }
 
-    // Set the return code
-    if (success) {
-        errorCodeOrSize = receivedSize;
+        containerUnlock(pContainer);
+
+    } else {
+        // The only reason initialisation might fail
+        errno = CELLULAR_SOCK_ENOMEM;
     }
 
     if (errno != CELLULAR_SOCK_ENONE) {
@@ -1401,99 +5119,60 @@ int32_t receive(CellularSockContainer_t *pContainer,
     return (int32_t) errorCodeOrSize;
 }
 
-/* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS: CREATE/OPEN/CLOSE
- * -------------------------------------------------------------- */
-
-// Create a socket.
-int32_t cellularSockCreate(CellularSockType_t type,
-                           CellularSockProtocol_t protocol)
+// Receive a number of datagrams in one go.
+int32_t cellularSockReceiveFromMulti(CellularSockDescriptor_t descriptor,
+                                     CellularSockDatagram_t *pDatagrams,
+                                     size_t numDatagrams)
 {
-    CellularSockErrorCode_t descriptorOrErrorCode = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockErrorCode_t errorCodeOrNum = CELLULAR_SOCK_BSD_ERROR;
     int32_t errno = CELLULAR_SOCK_ENONE;
-    CellularSockDescriptor_t descriptor = gNextDescriptor;
     CellularSockContainer_t *pContainer = NULL;
+    bool valid = (pDatagrams != NULL) && (numDatagrams > 0);
 
-    if (init()) {
-        if ((type == CELLULAR_SOCK_TYPE_STREAM) ||
-            (type == CELLULAR_SOCK_TYPE_DGRAM)) {
-            if ((protocol == CELLULAR_SOCK_PROTOCOL_TCP) ||
-                (protocol == CELLULAR_SOCK_PROTOCOL_UDP)) {
+    // Each datagram needs somewhere to go
+    for (size_t x = 0; valid && (x < numDatagrams); x++) {
+        valid = (pDatagrams[x].pData != NULL) &&
+                (pDatagrams[x].dataSizeBytes > 0);
+    }
 
-                CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
-
-                if (numContainersInUse() < CELLULAR_SOCK_MAX) {
-                    // Find the next free descriptor
-                    while (descriptorOrErrorCode < 0) {
-                        // Try the descriptor value, making sure 
-                        // each time that it can't be found.
-                        if (pContainerFindByDescriptor(descriptor) == NULL) {
-                            gNextDescriptor = descriptor;
-                            CELLULAR_SOCK_INC_DESCRIPTOR(gNextDescriptor);
-                            // Found a free descriptor, now try to
-                            // create the socket in a container
-                            pContainer = pSockContainerCreate(descriptor,
-                                                              type, protocol);
-                            if (pContainer != NULL) {
-                                descriptorOrErrorCode = descriptor;
-                            } else {
-                                cellularPortLog("CELLULAR_SOCK: unable to allocate memory for socket.\n");
-                                // Exit stage left
-                                break;
-                            }
-                        }
-                        CELLULAR_SOCK_INC_DESCRIPTOR(descriptor);
-                    }
+    if (init()) {
 
-                    if (descriptorOrErrorCode < 0) {
-                        cellularPortLog("CELLULAR_SOCK: unable to create socket, no free descriptors.\n");
-                    }
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
 
-                    // If we have a container, talk to cellular to
-                    // create the socket there
-                    if (pContainer != NULL) {
-                        cellular_ctrl_at_lock();
-                        cellular_ctrl_at_cmd_start("AT+USOCR=");
-                        // Protocol will be 6 or 17
-                        cellular_ctrl_at_write_int(protocol);
-                        cellular_ctrl_at_cmd_stop();
-                        cellular_ctrl_at_resp_start("+USOCR:", false);
-                        pContainer->socket.modemHandle = cellular_ctrl_at_read_int();
-                        cellular_ctrl_at_resp_stop();
-                        if (cellular_ctrl_at_unlock_return_error() == 0) {
-                            // All is good, no need to set descriptorOrErrorCode
-                            // as it was already set above
-                            cellularPortLog("CELLULAR_SOCK: socket created, descriptor %d, modem handle %d.\n",
-                                            descriptorOrErrorCode,
-                                            pContainer->socket.modemHandle);
+        // If we have found the container, talk to cellular to
+        // do the receiving
+        if (pContainer != NULL) {
+            if (valid) {
+                if (pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_UDP) {
+                    if (pContainer->socket.state != CELLULAR_SOCK_STATE_CLOSING) {
+                        if ((pContainer->socket.state != CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ) &&
+                            (pContainer->socket.state != CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
+                            errorCodeOrNum = receiveFromMulti(pContainer, pDatagrams,
+                                                              numDatagrams);
                         } else {
-                            // If the modem could not create the socket,
-                            // free the container once more
-                            containerFree(descriptorOrErrorCode);
-                            descriptorOrErrorCode = CELLULAR_SOCK_BSD_ERROR;
-                            // Use a distinctly different errno for this
-                            errno = CELLULAR_SOCK_EIO;
-                            cellularPortLog("CELLULAR_SOCK: modem could not create socket.\n");
+                            // Socket is shut down
+                            errno = CELLULAR_SOCK_ESHUTDOWN;
                         }
                     } else {
-                        // No buffers available
-                        errno = CELLULAR_SOCK_ENOBUFS;
+                        // As for cellularSockReceiveFrom()
+                        errno = CELLULAR_SOCK_ENOTCONN;
                     }
                 } else {
-                    // No buffers available
-                    errno = CELLULAR_SOCK_ENOBUFS;
+                    // Datagrams only come from UDP sockets
+                    errno = CELLULAR_SOCK_EPROTOTYPE;
                 }
-
-                CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
-
             } else {
-                // Not a protocol we support
-                errno = CELLULAR_SOCK_EPROTONOSUPPORT;
+                // Invalid argument
+                errno = CELLULAR_SOCK_EINVAL;
             }
         } else {
-            // Not a protocol type we support
-            errno = CELLULAR_SOCK_EPFNOSUPPORT;
+            // Indicate that we weren't passed a valid socket descriptor
+            errno = CELLULAR_SOCK_EBADF;
         }
+
+        containerUnlock(pContainer);
+
     } else {
         // The only reason initialisation might fail
         errno = CELLULAR_SOCK_ENOMEM;
@@ -1504,84 +5183,78 @@ int32_t cellularSockCreate(CellularSockType_t type,
         cellularPort_errno_set(errno);
     }
 
-    return (int32_t) descriptorOrErrorCode;
+    return (int32_t) errorCodeOrNum;
 }
 
-// Make an outgoing connection on the given socket.
-int32_t cellularSockConnect(CellularSockDescriptor_t descriptor,
-                            const CellularSockAddress_t *pRemoteAddress)
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: STREAM (TCP)
+ * -------------------------------------------------------------- */
+
+// Send data.
+int32_t cellularSockWrite(CellularSockDescriptor_t descriptor,
+                          const void *pData, size_t dataSizeBytes)
 {
-    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockErrorCode_t errorCodeOrSize = CELLULAR_SOCK_BSD_ERROR;
     int32_t errno = CELLULAR_SOCK_ENONE;
     CellularSockContainer_t *pContainer = NULL;
-    char buffer[CELLULAR_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
 
     if (init()) {
-        // Check that the remote IP address is sensible
-        if ((pRemoteAddress != NULL) &&
-            (addressToString(pRemoteAddress, false, buffer, sizeof(buffer)) > 0)) {
-
-            CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
+        // Check parameters
+        if (pData != NULL) {
 
-            // Find the container
-            pContainer = pContainerFindByDescriptor(descriptor);
+            // Find the container and lock its socket
+            pContainer = pContainerLock(descriptor);
 
             // If we have found the container, talk to cellular to
-            // make the connection
+            // do the sending
             if (pContainer != NULL) {
-                if (pContainer->socket.state == CELLULAR_SOCK_STATE_CREATED) {
-                    cellularPortLog("CELLULAR_CTRL_SOCK: connecting socket to \"%s\"...\n",
-                                    buffer);
-                    cellular_ctrl_at_lock();
-                    // TODO: set timeout correctly for this socket
-                    cellular_ctrl_at_set_at_timeout(10000, false);
-                    cellular_ctrl_at_cmd_start("AT+USOCO=");
-                    // Handle
-                    cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
-                    // IP address
-                    cellular_ctrl_at_write_string(buffer, true);
-                    // Port number
-                    if (pRemoteAddress->port > 0) {
-                        cellular_ctrl_at_write_int(pRemoteAddress->port);
-                    }
-                    cellular_ctrl_at_cmd_stop_read_resp();
-                    cellular_ctrl_at_restore_at_timeout();
-                    if (cellular_ctrl_at_unlock_return_error() == 0) {
-                        // All is good
-                        pCellularPort_memcpy(&pContainer->socket.remoteAddress,
-                                             pRemoteAddress,
-                                             sizeof (pContainer->socket.remoteAddress));
-                        pContainer->socket.state = CELLULAR_SOCK_STATE_CONNECTED;
-                        errorCode = CELLULAR_SOCK_SUCCESS;
-                        cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, is connected to address %.*s.\n",
-                                        descriptor,
-                                        pContainer->socket.modemHandle,
-                                        addressToString(&pContainer->socket.remoteAddress,
-                                                        true,
-                                                        buffer, sizeof(buffer)),
-                                        buffer);
+                if (pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_TCP) {
+                    if (pContainer->socket.state == CELLULAR_SOCK_STATE_CONNECTED) {
+                        if ((pData == NULL) && (dataSizeBytes > 0)) {
+                            // Invalid argument
+                            errno = CELLULAR_SOCK_EINVAL;
+                        } else {
+                            if ((pData != NULL) && (dataSizeBytes > 0)) {
+                                errorCodeOrSize = sendBuffered(pContainer,
+                                                               (const char *) pData,
+                                                               dataSizeBytes,
+                                                               &errno);
+                            } else {
+                                // Nothing to do
+                                errorCodeOrSize = CELLULAR_SOCK_SUCCESS;
+                            }
+                        }
                     } else {
-                        // Host is not reachable
-                        errno = CELLULAR_SOCK_EHOSTUNREACH;
-                        cellularPortLog("CELLULAR_SOCK: remote address %.*s is not reachable.\n",
-                                        addressToString(pRemoteAddress, true,
-                                                        buffer, sizeof(buffer)),
-                                        buffer);
+                        if ((pContainer->socket.state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_WRITE) ||
+                            (pContainer->socket.state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
+                            // Socket is shut down
+                            errno = CELLULAR_SOCK_ESHUTDOWN;
+                        } else if (pContainer->socket.state == CELLULAR_SOCK_STATE_CLOSING) {
+                            // Not connected mate
+                            errno = CELLULAR_SOCK_ENOTCONN;
+                        } else if (pContainer->socket.state == CELLULAR_SOCK_STATE_TIMED_OUT) {
+                            // Never will be
+                            errno = CELLULAR_SOCK_ETIMEDOUT;
+                        } else {
+                            // No route to host?
+                            errno = CELLULAR_SOCK_EHOSTUNREACH;
+                        }
                     }
                 } else {
-                    // TODO: is "operation not permitted" the right error?
-                    errno = CELLULAR_SOCK_EPERM;
+                    // Should never get here, throw 'em a googley so that the
+                    // error is distinct
+                    errno = CELLULAR_SOCK_EPROTOTYPE;
                 }
             } else {
                 // Indicate that we weren't passed a valid socket descriptor
                 errno = CELLULAR_SOCK_EBADF;
             }
 
-            CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+            containerUnlock(pContainer);
 
         } else {
-            // Seems appropriate
-            errno = CELLULAR_SOCK_EDESTADDRREQ;
+            // Invalid argument
+            errno = CELLULAR_SOCK_EINVAL;
         }
     } else {
         // The only reason initialisation might fail
@@ -1593,69 +5266,115 @@ int32_t cellularSockConnect(CellularSockDescriptor_t descriptor,
         cellularPort_errno_set(errno);
     }
 
-    return (int32_t) errorCode;
+    return (int32_t) errorCodeOrSize;
 }
 
-// Close a socket.
-int32_t cellularSockClose(CellularSockDescriptor_t descriptor)
+// Receive data.
+int32_t cellularSockRead(CellularSockDescriptor_t descriptor,
+                         void *pData, size_t dataSizeBytes)
 {
-    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockErrorCode_t errorCodeOrSize = CELLULAR_SOCK_BSD_ERROR;
     int32_t errno = CELLULAR_SOCK_ENONE;
     CellularSockContainer_t *pContainer = NULL;
-    CellularSockState_t finalState = CELLULAR_SOCK_STATE_CLOSED;
 
     if (init()) {
 
-        CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
-
-        // Find the container
-        pContainer = pContainerFindByDescriptor(descriptor);
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
 
         // If we have found the container, talk to cellular to
-        // close the socket there
+        // do the receiving
         if (pContainer != NULL) {
-            cellular_ctrl_at_lock();
-            // Closing can take a loong time sometimes
-            cellular_ctrl_at_set_at_timeout(CELLULAR_SOCK_CLOSE_TIMEOUT_SECONDS * 1000,
-                                            false);
-            cellular_ctrl_at_cmd_start("AT+USOCL=");
-            cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
-#ifdef CELLULAR_CFG_MODULE_SARA_R4
-            // SARA-R4, can take a long time to close a TCP
-            // socket due to being strict about waiting
-            // for the ack for the ack for the ack, so
-            // ask for an asynchronous indication
-            if ((pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_TCP) &&
-                (pContainer->socket.state == CELLULAR_SOCK_STATE_CONNECTED)) {
-                cellular_ctrl_at_write_int(1);
-                finalState = CELLULAR_SOCK_STATE_CLOSING;
+            if (pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_TCP) {
+                if (pContainer->socket.state == CELLULAR_SOCK_STATE_CONNECTED) {
+                    if ((pData == NULL) && (dataSizeBytes > 0)) {
+                        // Invalid argument
+                        errno = CELLULAR_SOCK_EINVAL;
+                    } else {
+                        if ((pData != NULL) && (dataSizeBytes != 0)) {
+                            if (pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_TCP) {
+                                // Whatever we are waiting for an answer
+                                // to should go now, not when the
+                                // transmit buffer's flush time expires
+                                if (!txBufferFlush(pContainer)) {
+                                    pContainer->socket.txFlushFailed = true;
+                                }
+                                errorCodeOrSize = receive(pContainer, pData, dataSizeBytes);
+                            }
+                        } else {
+                            // Not an error, just nothing to do
+                            errorCodeOrSize = CELLULAR_SOCK_SUCCESS;
+                        }
+                    }
+                } else {
+                    if ((pContainer->socket.state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ) ||
+                        (pContainer->socket.state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
+                        // Socket is shut down
+                        errno = CELLULAR_SOCK_ESHUTDOWN;
+                    } else if (pContainer->socket.state == CELLULAR_SOCK_STATE_CLOSING) {
+                        // Not connected mate
+                        errno = CELLULAR_SOCK_ENOTCONN;
+                    } else if (pContainer->socket.state == CELLULAR_SOCK_STATE_TIMED_OUT) {
+                        // Never will be
+                        errno = CELLULAR_SOCK_ETIMEDOUT;
+                    } else {
+                        // No route to host?
+                        errno = CELLULAR_SOCK_EHOSTUNREACH;
+                    }
+                }
+            } else {
+                // Should never get here, throw 'em a googley so that the
+                // error is distinct
+                errno = CELLULAR_SOCK_EPROTOTYPE;
             }
-#endif
-            cellular_ctrl_at_cmd_stop_read_resp();
-            cellular_ctrl_at_restore_at_timeout();
-            if (cellular_ctrl_at_unlock_return_error() == 0) {
-                cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, has been closed.\n",
-                                descriptor,
-                                pContainer->socket.modemHandle);
+        } else {
+            // Indicate that we weren't passed a valid socket descriptor
+            errno = CELLULAR_SOCK_EBADF;
+        }
+
+        containerUnlock(pContainer);
+
+    } else {
+        // The only reason initialisation might fail
+        errno = CELLULAR_SOCK_ENOMEM;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCodeOrSize;
+}
+
+// Send anything in the transmit buffer now.
+int32_t cellularSockFlush(CellularSockDescriptor_t descriptor)
+{
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    CellularSockContainer_t *pContainer = NULL;
+
+    if (init()) {
+
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
+
+        if (pContainer != NULL) {
+            if (pContainer->socket.txFlushFailed) {
+                // Data accepted by an earlier write has been lost
+                pContainer->socket.txFlushFailed = false;
+                errno = CELLULAR_SOCK_EIO;
+            } else if (txBufferFlush(pContainer)) {
                 errorCode = CELLULAR_SOCK_SUCCESS;
-                // Now mark the socket as closed (or closing).
-                // Socket is only freed by a call to
-                // cellularSockCleanUp() in order to ensure
-                // thread-safeness
-                pContainer->socket.state = finalState;
             } else {
-                // Use a distinctly different errno for this
                 errno = CELLULAR_SOCK_EIO;
-                cellularPortLog("CELLULAR_SOCK: modem could not close socket with descriptor %d, handle %d.\n",
-                                 descriptor,
-                                 pContainer->socket.modemHandle);
             }
         } else {
             // Indicate that we weren't passed a valid socket descriptor
             errno = CELLULAR_SOCK_EBADF;
         }
 
-        CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+        containerUnlock(pContainer);
 
     } else {
         // The only reason initialisation might fail
@@ -1670,163 +5389,77 @@ int32_t cellularSockClose(CellularSockDescriptor_t descriptor)
     return (int32_t) errorCode;
 }
 
-// Clean-up memory occupied by closed sockets.
-void cellularSockCleanUp()
+// Get the statistics of TCP reads and the receive cache.
+int32_t cellularSockGetRxCacheStats(CellularSockRxCacheStats_t *pStats)
 {
-    CellularSockContainer_t *pContainer = gpContainerListHead;
-    CellularSockContainer_t *pTmp;
-    size_t numNonClosedSockets = 0;
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
 
-    if (gInitialised) {
+    if (pStats != NULL) {
+        if (init()) {
 
-        CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
+            CELLULAR_PORT_MUTEX_LOCK(gMutexStats);
 
-        // Move through the list removing closed sockets
-        while (pContainer != NULL) {
-            if ((pContainer->socket.state == CELLULAR_SOCK_STATE_CLOSED) ||
-                (pContainer->socket.state == CELLULAR_SOCK_STATE_CLOSING)) {
-                if (!(pContainer->isStatic)) {
-                    // If this socket is not static, uncouple it
-                    // If there is a previous container, move its pNext
-                    if (pContainer->pPrevious != NULL) {
-                        pContainer->pPrevious->pNext = pContainer->pNext;
-                    } else {
-                        // If there is no previous container, must be
-                        // at the start of the list so move the head
-                        // pointer on instead
-                        gpContainerListHead = pContainer->pNext;
-                    }
-                    // If there is a next container, move its pPrevious
-                    if (pContainer->pNext != NULL) {
-                        pContainer->pNext->pPrevious = pContainer->pPrevious;
-                    }
+            *pStats = gRxCacheStats;
+            pStats->cacheBytesInUse = gRxCacheBytesInUse;
+            errorCode = CELLULAR_SOCK_SUCCESS;
 
-                    // Remember the next pointer
-                    pTmp = pContainer->pNext;
-                    // Free the memory
-                    cellularPort_free(pContainer);
-                    // Move to the next entry
-                    pContainer = pTmp;
-                } else {
-                    pContainer->socket.state = CELLULAR_SOCK_STATE_CLOSED;
-                    // Move on
-                    pContainer = pContainer->pNext;
-                }
-            } else {
-                // Move on but count the number of non-closed sockets
-                numNonClosedSockets++;
-                pContainer = pContainer->pNext;
-            }
-        }
+            CELLULAR_PORT_MUTEX_UNLOCK(gMutexStats);
 
-        // If everything has been closed, we can deinit()
-        if (numNonClosedSockets == 0) {
-            deinitButNotMutex();
+        } else {
+            // The only reason initialisation might fail
+            errno = CELLULAR_SOCK_ENOMEM;
         }
+    } else {
+        // Invalid argument
+        errno = CELLULAR_SOCK_EINVAL;
+    }
 
-        CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
     }
+
+    return (int32_t) errorCode;
 }
 
-// Deinitialise sockets.
-void cellularSockDeinit()
+// Reset the statistics of TCP reads and the receive cache.
+void cellularSockResetRxCacheStats()
 {
-    CellularSockContainer_t *pContainer = gpContainerListHead;
-    CellularSockContainer_t *pTmp;
-
-    if (gInitialised) {
-
-        CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
+    if (init()) {
 
-        // Move through the list removing sockets
-        while (pContainer != NULL) {
-            if (!(pContainer->isStatic)) {
-                // If this socket is not static, uncouple it
-                // If there is a previous container, move its pNext
-                if (pContainer->pPrevious != NULL) {
-                    pContainer->pPrevious->pNext = pContainer->pNext;
-                } else {
-                    // If there is no previous container, must be
-                    // at the start of the list so move the head
-                    // pointer on instead
-                    gpContainerListHead = pContainer->pNext;
-                }
-                // If there is a next container, move its pPrevious
-                if (pContainer->pNext != NULL) {
-                    pContainer->pNext->pPrevious = pContainer->pPrevious;
-                }
-
-                // Remember the next pointer
-                pTmp = pContainer->pNext;
-                // Free the memory
-                cellularPort_free(pContainer);
-                // Move to the next entry
-                pContainer = pTmp;
-            } else {
-                pContainer->socket.state = CELLULAR_SOCK_STATE_CLOSED;
-                // Move on
-                pContainer = pContainer->pNext;
-            }
-        }
+        CELLULAR_PORT_MUTEX_LOCK(gMutexStats);
 
-        // We can now deinit()
-        deinitButNotMutex();
+        pCellularPort_memset(&gRxCacheStats, 0, sizeof(gRxCacheStats));
 
-        CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexStats);
     }
 }
 
-/* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS: CONFIGURE
- * -------------------------------------------------------------- */
-
-// Configure the given socket's file parameters.
-int32_t cellularSockFcntl(CellularSockDescriptor_t descriptor,
-                          int32_t command,
-                          int32_t value)
+// Get the statistics of TCP writes and the transmit buffer.
+int32_t cellularSockGetTxBufferStats(CellularSockTxBufferStats_t *pStats)
 {
-    // Since the return value depends upon the command, 
-    // the only reliable error value for FCNTL is -1.
-    CellularSockErrorCode_t errorCodeOrReturnValue = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
     int32_t errno = CELLULAR_SOCK_ENONE;
-    CellularSockContainer_t *pContainer = NULL;
 
-    if (init()) {
+    if (pStats != NULL) {
+        if (init()) {
 
-        CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
+            CELLULAR_PORT_MUTEX_LOCK(gMutexStats);
 
-        // Find the container
-        pContainer = pContainerFindByDescriptor(descriptor);
+            *pStats = gTxBufferStats;
+            pStats->bufferBytesInUse = gTxBufferBytesInUse;
+            errorCode = CELLULAR_SOCK_SUCCESS;
+
+            CELLULAR_PORT_MUTEX_UNLOCK(gMutexStats);
 
-        if (pContainer != NULL) {
-            switch (command) {
-                case CELLULAR_SOCK_FCNTL_SET_STATUS:
-                    pContainer->socket.nonBlocking = 
-                      ((value | CELLULAR_SOCK_FCNTL_STATUS_NONBLOCK) == 1);
-                    errorCodeOrReturnValue = CELLULAR_SOCK_SUCCESS;
-                break;
-                case CELLULAR_SOCK_FCNTL_GET_STATUS:
-                    // From here on errorCodeOrReturnValue is a return value
-                    errorCodeOrReturnValue = 0;
-                    if (pContainer->socket.nonBlocking) {
-                        errorCodeOrReturnValue = CELLULAR_SOCK_FCNTL_STATUS_NONBLOCK;
-                    }
-                break;
-                default:
-                    // Invalid argument
-                    errno = CELLULAR_SOCK_EINVAL;
-                break;
-            }
         } else {
-            // Indicate that we weren't passed a valid socket descriptor
-            errno = CELLULAR_SOCK_EBADF;
+            // The only reason initialisation might fail
+            errno = CELLULAR_SOCK_ENOMEM;
         }
-
-        CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
-
     } else {
-        // The only reason initialisation might fail
-        errno = CELLULAR_SOCK_ENOMEM;
+        // Invalid argument
+        errno = CELLULAR_SOCK_EINVAL;
     }
 
     if (errno != CELLULAR_SOCK_ENONE) {
@@ -1834,13 +5467,25 @@ int32_t cellularSockFcntl(CellularSockDescriptor_t descriptor,
         cellularPort_errno_set(errno);
     }
 
-    return (int32_t) errorCodeOrReturnValue;
+    return (int32_t) errorCode;
 }
 
-// Configure the given socket's device parameters.
-int32_t cellularSockIoctl(CellularSockDescriptor_t descriptor,
-                          int32_t command,
-                          void *pValue)
+// Reset the statistics of TCP writes and the transmit buffer.
+void cellularSockResetTxBufferStats()
+{
+    if (init()) {
+
+        CELLULAR_PORT_MUTEX_LOCK(gMutexStats);
+
+        pCellularPort_memset(&gTxBufferStats, 0, sizeof(gTxBufferStats));
+
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexStats);
+    }
+}
+
+// Prepare a TCP socket for being closed.
+int32_t cellularSockShutdown(CellularSockDescriptor_t descriptor,
+                             CellularSockShutdown_t how)
 {
     CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
     int32_t errno = CELLULAR_SOCK_ENONE;
@@ -1848,30 +5493,38 @@ int32_t cellularSockIoctl(CellularSockDescriptor_t descriptor,
 
     if (init()) {
 
-        CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
-
-        // Find the container
-        pContainer = pContainerFindByDescriptor(descriptor);
-
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
         if (pContainer != NULL) {
-            switch (command) {
-                case CELLULAR_SOCK_IOCTL_SET_NONBLOCK:
-                    if (pValue != NULL) {
-                        pContainer->socket.nonBlocking = (*(int32_t *) pValue != 0);
-                        errorCode = CELLULAR_SOCK_SUCCESS;
-                    }
+            // Set the socket state
+            switch (how) {
+                case CELLULAR_SOCK_SHUTDOWN_READ:
+                    pContainer->socket.state = CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ;
+                    errorCode = CELLULAR_SOCK_SUCCESS;
+                break;
+                case CELLULAR_SOCK_SHUTDOWN_WRITE:
+                    // Anything written before the shutdown still goes
+                    txBufferFlush(pContainer);
+                    pContainer->socket.state = CELLULAR_SOCK_STATE_SHUTDOWN_FOR_WRITE;
+                    errorCode = CELLULAR_SOCK_SUCCESS;
+                break;
+                case CELLULAR_SOCK_SHUTDOWN_READ_WRITE:
+                    txBufferFlush(pContainer);
+                    pContainer->socket.state = CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE;
+                    errorCode = CELLULAR_SOCK_SUCCESS;
                 break;
                 default:
                     // Invalid argument
                     errno = CELLULAR_SOCK_EINVAL;
                 break;
             }
+            selectSignal();
         } else {
             // Indicate that we weren't passed a valid socket descriptor
             errno = CELLULAR_SOCK_EBADF;
         }
 
-        CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+        containerUnlock(pContainer);
 
     } else {
         // The only reason initialisation might fail
@@ -1886,133 +5539,42 @@ int32_t cellularSockIoctl(CellularSockDescriptor_t descriptor,
     return (int32_t) errorCode;
 }
 
-// Set the options for the given socket.
-int32_t cellularSockSetOption(CellularSockDescriptor_t descriptor,
-                              int32_t level,
-                              uint32_t option,
-                              const void *pOptionValue,
-                              size_t optionValueLength)
-{
-    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
-    int32_t errno = CELLULAR_SOCK_ENONE;
-    CellularSockContainer_t *pContainer = NULL;
-
-    cellularPortLog("CELLULAR_SOCK: cellularSockSetOption() called on socket %d with command %d:0x%04x.\n",
-                    descriptor, level, option);
-
-    if (init()) {
-
-        CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
-
-        // Find the container
-        pContainer = pContainerFindByDescriptor(descriptor);
-
-        if (pContainer != NULL) {
-            // Check parameters
-            if ((optionValueLength == 0) || 
-                ((optionValueLength > 0) && (pOptionValue != NULL))) {
-                switch (level) {
-                    case CELLULAR_SOCK_OPT_LEVEL_SOCK:
-                        switch (option) {
-                            // The supported options which
-                            // have an integer as a parameter
-                            case CELLULAR_SOCK_OPT_REUSEADDR:
-                            case CELLULAR_SOCK_OPT_KEEPALIVE:
-                            case CELLULAR_SOCK_OPT_BROADCAST:
-                            case CELLULAR_SOCK_OPT_REUSEPORT:
-                                errorCode = setOptionInt(descriptor,
-                                                         pContainer->socket.modemHandle,
-                                                         level,
-                                                         option,
-                                                         pOptionValue,
-                                                         optionValueLength,
-                                                         &errno);
-                            break;
-                            // The linger option which has
-                            // cellularSock_linger as its
-                            // parameter
-                            case CELLULAR_SOCK_OPT_LINGER:
-                                errorCode = setOptionLinger(descriptor,
-                                                            pContainer->socket.modemHandle,
-                                                            pOptionValue,
-                                                            optionValueLength,
-                                                            &errno);
-                            break;
-                            // Receive timeout, which we set locally
-                            case CELLULAR_SOCK_OPT_RCVTIMEO:
-                                if ((pOptionValue != NULL) && 
-                                    (optionValueLength == sizeof(CellularPort_timeval))) {
-                                        pContainer->socket.receiveTimeoutMs = 
-                                          (((CellularPort_timeval *) pOptionValue)->tv_usec / 1000) + 
-                                          (((CellularPort_timeval *) pOptionValue)->tv_sec * 1000);
-                                    errorCode = CELLULAR_SOCK_SUCCESS;
-                                } else {
-                                    errno = CELLULAR_SOCK_EINVAL;
-                                }
-                            break;
-                            default:
-                                // Invalid argument
-                                errno = CELLULAR_SOCK_EINVAL;
-                            break;
-                        }
-                    break;
-                    case CELLULAR_SOCK_OPT_LEVEL_IP:
-                        switch (option) {
-                            // The supported options, both of
-                            // which have an integer as a
-                            // parameter
-                            case CELLULAR_SOCK_OPT_IP_TOS:
-                            case CELLULAR_SOCK_OPT_IP_TTL:
-                                errorCode = setOptionInt(descriptor,
-                                                         pContainer->socket.modemHandle,
-                                                         level,
-                                                         option,
-                                                         pOptionValue,
-                                                         optionValueLength,
-                                                         &errno);
-                            break;
-                            default:
-                                // Invalid argument
-                                errno = CELLULAR_SOCK_EINVAL;
-                            break;
-                        }
-                    break;
-                    case CELLULAR_SOCK_OPT_LEVEL_TCP:
-                        switch (option) {
-                            // The supported options, both of
-                            // which have an integer as a
-                            // parameter
-                            case CELLULAR_SOCK_OPT_TCP_NODELAY:
-                            case CELLULAR_SOCK_OPT_TCP_KEEPIDLE:
-                                errorCode = setOptionInt(descriptor,
-                                                         pContainer->socket.modemHandle,
-                                                         level,
-                                                         option,
-                                                         pOptionValue,
-                                                         optionValueLength,
-                                                         &errno);
-                            break;
-                            default:
-                                // Invalid argument
-                                errno = CELLULAR_SOCK_EINVAL;
-                            break;
-                        }
-                    break;
-                    default:
-                        // Invalid argument
-                        errno = CELLULAR_SOCK_EINVAL;
-                    break;
-                }
-            } else {
-                // Invalid argument
-                errno = CELLULAR_SOCK_EINVAL;
-            }
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: ASYNC
+ * -------------------------------------------------------------- */
+
+// Register a callback for incoming data.
+int32_t cellularSockRegisterCallbackData(CellularSockDescriptor_t descriptor,
+                                         void (*pCallback) (void *),
+                                         void *pCallbackParam)
+{
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    CellularSockContainer_t *pContainer = NULL;
+
+    if (init()) {
+
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
+
+        // If we have found the container, set up the callback
+        if (pContainer != NULL) {
+
+            CELLULAR_PORT_MUTEX_LOCK(gMutexCallbacks);
+
+            pContainer->socket.pPendingDataCallback = pCallback;
+            pContainer->socket.pPendingDataCallbackParam = pCallbackParam;
+            pContainer->socket.dataCallbackOutstanding = false;
+
+            CELLULAR_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+
+            errorCode = CELLULAR_SOCK_SUCCESS;
         } else {
             // Indicate that we weren't passed a valid socket descriptor
             errno = CELLULAR_SOCK_EBADF;
         }
 
-        CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+        containerUnlock(pContainer);
 
     } else {
         // The only reason initialisation might fail
@@ -2027,12 +5589,10 @@ int32_t cellularSockSetOption(CellularSockDescriptor_t descriptor,
     return (int32_t) errorCode;
 }
 
-// Get the options for the given socket.
-int32_t cellularSockGetOption(CellularSockDescriptor_t descriptor,
-                              int32_t level,
-                              uint32_t option,
-                              void *pOptionValue,
-                              size_t *pOptionValueLength)
+// Register a callback for socket closed.
+int32_t cellularSockRegisterCallbackClosed(CellularSockDescriptor_t descriptor,
+                                           void (*pCallback) (void *),
+                                           void *pCallbackParam)
 {
     CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
     int32_t errno = CELLULAR_SOCK_ENONE;
@@ -2040,131 +5600,26 @@ int32_t cellularSockGetOption(CellularSockDescriptor_t descriptor,
 
     if (init()) {
 
-        CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
-
-        // Find the container
-        pContainer = pContainerFindByDescriptor(descriptor);
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
 
+        // If we have found the container, set up the callbacks
         if (pContainer != NULL) {
-            // If there's an optionValue then there must be a length
-            if ((pOptionValue == NULL) || 
-                (pOptionValueLength != NULL)) {
-                switch (level) {
-                    case CELLULAR_SOCK_OPT_LEVEL_SOCK:
-                        switch (option) {
-                            // The supported options which
-                            // have an integer as a parameter
-                            case CELLULAR_SOCK_OPT_REUSEADDR:
-                            case CELLULAR_SOCK_OPT_KEEPALIVE:
-                            case CELLULAR_SOCK_OPT_BROADCAST:
-                            case CELLULAR_SOCK_OPT_REUSEPORT:
-                                errorCode = getOptionInt(descriptor,
-                                                         pContainer->socket.modemHandle,
-                                                         level,
-                                                         option,
-                                                         pOptionValue,
-                                                         pOptionValueLength,
-                                                         &errno);
-                            break;
-                            // The linger option which has
-                            // cellularSock_linger as its
-                            // parameter
-                            case CELLULAR_SOCK_OPT_LINGER:
-                                errorCode = getOptionLinger(descriptor,
-                                                            pContainer->socket.modemHandle,
-                                                            pOptionValue,
-                                                            pOptionValueLength,
-                                                            &errno);
-                            break;
-                            // Receive timeout, which we just get locally
-                            case CELLULAR_SOCK_OPT_RCVTIMEO:
-                                if (pOptionValueLength != NULL) {
-                                    if (pOptionValue != NULL) {
-                                        if (*pOptionValueLength >= sizeof(CellularPort_timeval)) {
-                                            // Return the answer
-                                            ((CellularPort_timeval *) pOptionValue)->tv_sec = 
-                                                pContainer->socket.receiveTimeoutMs / 1000;
-                                            ((CellularPort_timeval *) pOptionValue)->tv_usec = 
-                                              (pContainer->socket.receiveTimeoutMs % 1000) * 1000;
-                                            *pOptionValueLength = sizeof(CellularPort_timeval);
-                                            errorCode = CELLULAR_SOCK_SUCCESS;
-                                        } else {
-                                            // Caller hasn't left enough room
-                                            errno = CELLULAR_SOCK_EINVAL;
-                                        }
-                                    } else {
-                                        // Caller just wants to know the length required
-                                        *pOptionValueLength = sizeof(CellularPort_timeval);
-                                        errorCode = CELLULAR_SOCK_SUCCESS;
-                                    }
-                                } else {
-                                    // Invalid argument, there must be a value length
-                                    errno = CELLULAR_SOCK_EINVAL;
-                                }
-                            break;
-                            default:
-                                // Invalid argument
-                                errno = CELLULAR_SOCK_EINVAL;
-                            break;
-                        }
-                    break;
-                    case CELLULAR_SOCK_OPT_LEVEL_IP:
-                        switch (option) {
-                            // The supported options, both of
-                            // which have an integer as a
-                            // parameter
-                            case CELLULAR_SOCK_OPT_IP_TOS:
-                            case CELLULAR_SOCK_OPT_IP_TTL:
-                                errorCode = getOptionInt(descriptor,
-                                                         pContainer->socket.modemHandle,
-                                                         level,
-                                                         option,
-                                                         pOptionValue,
-                                                         pOptionValueLength,
-                                                         &errno);
-                            break;
-                            default:
-                                // Invalid argument
-                                errno = CELLULAR_SOCK_EINVAL;
-                            break;
-                        }
-                    break;
-                    case CELLULAR_SOCK_OPT_LEVEL_TCP:
-                        switch (option) {
-                            // The supported options, both of
-                            // which have an integer as a
-                            // parameter
-                            case CELLULAR_SOCK_OPT_TCP_NODELAY:
-                            case CELLULAR_SOCK_OPT_TCP_KEEPIDLE:
-                                errorCode = getOptionInt(descriptor,
-                                                         pContainer->socket.modemHandle,
-                                                         level,
-                                                         option,
-                                                         pOptionValue,
-                                                         pOptionValueLength,
-                                                         &errno);
-                            break;
-                            default:
-                                // Invalid argument
-                                errno = CELLULAR_SOCK_EINVAL;
-                            break;
-                        }
-                    break;
-                    default:
-                        // Invalid argument
-                        errno = CELLULAR_SOCK_EINVAL;
-                    break;
-                }
-            } else {
-                // Invalid argument
-                errno = CELLULAR_SOCK_EINVAL;
-            }
+
+            CELLULAR_PORT_MUTEX_LOCK(gMutexCallbacks);
+
+            pContainer->socket.pConnectionClosedCallback = pCallback;
+            pContainer->socket.pConnectionClosedCallbackParam = pCallbackParam;
+
+            CELLULAR_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+
+            errorCode = CELLULAR_SOCK_SUCCESS;
         } else {
             // Indicate that we weren't passed a valid socket descriptor
             errno = CELLULAR_SOCK_EBADF;
         }
 
-        CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+        containerUnlock(pContainer);
 
     } else {
         // The only reason initialisation might fail
@@ -2179,80 +5634,89 @@ int32_t cellularSockGetOption(CellularSockDescriptor_t descriptor,
     return (int32_t) errorCode;
 }
 
-/* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS: UDP ONLY
- * -------------------------------------------------------------- */
-
-// Send a datagram to the given host.
-int32_t cellularSockSendTo(CellularSockDescriptor_t descriptor,
-                           const CellularSockAddress_t *pRemoteAddress,
-                           const void *pData, size_t dataSizeBytes)
+// Register a callback for the outcome of a non-blocking connect.
+int32_t cellularSockRegisterCallbackConnect(CellularSockDescriptor_t descriptor,
+                                            void (*pCallback) (void *),
+                                            void *pCallbackParam)
 {
-    CellularSockErrorCode_t errorCodeOrSize = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
     int32_t errno = CELLULAR_SOCK_ENONE;
     CellularSockContainer_t *pContainer = NULL;
 
     if (init()) {
 
-        CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
 
-        // Find the container
-        pContainer = pContainerFindByDescriptor(descriptor);
+        // If we have found the container, set up the callback
+        if (pContainer != NULL) {
+
+            CELLULAR_PORT_MUTEX_LOCK(gMutexCallbacks);
+
+            pContainer->socket.pConnectCallback = pCallback;
+            pContainer->socket.pConnectCallbackParam = pCallbackParam;
+
+            CELLULAR_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+
+            errorCode = CELLULAR_SOCK_SUCCESS;
+        } else {
+            // Indicate that we weren't passed a valid socket descriptor
+            errno = CELLULAR_SOCK_EBADF;
+        }
+
+        containerUnlock(pContainer);
+
+    } else {
+        // The only reason initialisation might fail
+        errno = CELLULAR_SOCK_ENOMEM;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Register a receiver for the incoming data of a socket.
+int32_t cellularSockRegisterReceiver(CellularSockDescriptor_t descriptor,
+                                     CellularSockReceiverAction_t (*pReceiver) (CellularSockDescriptor_t,
+                                                                                 const char *,
+                                                                                 size_t,
+                                                                                 void *),
+                                     void *pParam)
+{
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    CellularSockContainer_t *pContainer = NULL;
+
+    if (init()) {
+
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
 
-        // If we have found the container, talk to cellular to
-        // do the sending
         if (pContainer != NULL) {
-            // Check parameters
-            if (pRemoteAddress == NULL) {
-                // If there is no remote address and the socket was
-                // connected we must use the stored address
-                if (pContainer->socket.state == CELLULAR_SOCK_STATE_CONNECTED) {
-                    pRemoteAddress = &(pContainer->socket.remoteAddress);
-                } else {
-                    if ((pContainer->socket.state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_WRITE) ||
-                        (pContainer->socket.state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
-                        // Socket is shut down
-                        errno = CELLULAR_SOCK_ESHUTDOWN;
-                    } else if (pContainer->socket.state == CELLULAR_SOCK_STATE_CLOSING) {
-                        // I know connection isn't strictly relevant
-                        // to UDP transmission but I can't see anything
-                        // more appropriate to return
-                        errno = CELLULAR_SOCK_ENOTCONN;
-                    } else {
-                        // Destination address required?
-                        errno = CELLULAR_SOCK_EDESTADDRREQ;
-                    }
-                }
-            }
-            if ((pRemoteAddress != NULL) &&
-                (errno == CELLULAR_SOCK_ENONE)) {
-                if ((pData == NULL) && (dataSizeBytes > 0)) {
-                    // Invalid argument
-                    errno = CELLULAR_SOCK_EINVAL;
-                } else {
-                    if ((pData != NULL) && (dataSizeBytes > 0)) {
-                        // It's OK to send UDP packets on a TCP socket
-                        if ((pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_UDP) ||
-                            (pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_TCP)) {
-                            errorCodeOrSize = sendTo(pContainer, pRemoteAddress,
-                                                     pData, dataSizeBytes);
-                        } else {
-                            // Should never get here, throw 'em a googley so that the
-                            // error is distinct
-                            errno = CELLULAR_SOCK_EPROTOTYPE;
-                        }
-                    } else {
-                        // Nothing to do
-                        errorCodeOrSize = CELLULAR_SOCK_SUCCESS;
-                    }
+            if (pContainer->socket.type == CELLULAR_SOCK_TYPE_STREAM) {
+                pContainer->socket.pReceiver = pReceiver;
+                pContainer->socket.pReceiverParam = pParam;
+                pContainer->socket.receiverPaused = false;
+                if (pReceiver != NULL) {
+                    // Hand over anything that is already here
+                    receiverSchedule(pContainer);
                 }
+                errorCode = CELLULAR_SOCK_SUCCESS;
+            } else {
+                // Datagrams come with an address, use
+                // cellularSockReceiveFrom()
+                errno = CELLULAR_SOCK_EOPNOTSUPP;
             }
         } else {
             // Indicate that we weren't passed a valid socket descriptor
             errno = CELLULAR_SOCK_EBADF;
         }
 
-        CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+        containerUnlock(pContainer);
 
     } else {
         // The only reason initialisation might fail
@@ -2264,67 +5728,36 @@ int32_t cellularSockSendTo(CellularSockDescriptor_t descriptor,
         cellularPort_errno_set(errno);
     }
 
-    return (int32_t) errorCodeOrSize;
+    return (int32_t) errorCode;
 }
-
-// Receive a datagram from the given host.
-int32_t cellularSockReceiveFrom(CellularSockDescriptor_t descriptor,
-                                CellularSockAddress_t *pRemoteAddress,
-                                void *pData, size_t dataSizeBytes)
+
+// Resume a paused receiver.
+int32_t cellularSockReceiverResume(CellularSockDescriptor_t descriptor)
 {
-    CellularSockErrorCode_t errorCodeOrSize = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
     int32_t errno = CELLULAR_SOCK_ENONE;
     CellularSockContainer_t *pContainer = NULL;
 
     if (init()) {
 
-        CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
-
-        // Find the container
-        pContainer = pContainerFindByDescriptor(descriptor);
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
 
-        // If we have found the container, talk to cellular to
-        // do the receiving
         if (pContainer != NULL) {
-            if ((pData == NULL) && (dataSizeBytes > 0)) {
-                // Invalid argument
-                errno = CELLULAR_SOCK_EINVAL;
+            if (pContainer->socket.pReceiver != NULL) {
+                pContainer->socket.receiverPaused = false;
+                receiverSchedule(pContainer);
+                errorCode = CELLULAR_SOCK_SUCCESS;
             } else {
-                if ((pData != NULL) && (dataSizeBytes > 0)) {
-                    // It's OK to receive UDP packets on a TCP socket
-                    if ((pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_UDP) ||
-                        (pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_TCP)) {
-                        if (pContainer->socket.state != CELLULAR_SOCK_STATE_CLOSING) {
-                            if ((pContainer->socket.state != CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ) &&
-                                (pContainer->socket.state != CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
-                                errorCodeOrSize = receiveFrom(pContainer, pRemoteAddress,
-                                                              pData, dataSizeBytes);
-                            } else {
-                                // Socket is shut down
-                                errno = CELLULAR_SOCK_ESHUTDOWN;
-                            }
-                        } else {
-                            // I know connection isn't strictly relevant
-                            // to UDP transmission but I can't see anything
-                            // more appropriate to return
-                            errno = CELLULAR_SOCK_ENOTCONN;
-                        }
-                    } else {
-                        // Should never get here, throw 'em a googley so that the
-                        // error is distinct
-                        errno = CELLULAR_SOCK_EPROTOTYPE;
-                    }
-                } else {
-                    // Not an error, just nothing to do
-                    errorCodeOrSize = CELLULAR_SOCK_SUCCESS;
-                }
+                // There is nothing to resume
+                errno = CELLULAR_SOCK_EINVAL;
             }
         } else {
             // Indicate that we weren't passed a valid socket descriptor
             errno = CELLULAR_SOCK_EBADF;
         }
 
-        CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+        containerUnlock(pContainer);
 
     } else {
         // The only reason initialisation might fail
@@ -2336,70 +5769,59 @@ int32_t cellularSockReceiveFrom(CellularSockDescriptor_t descriptor,
         cellularPort_errno_set(errno);
     }
 
-    return (int32_t) errorCodeOrSize;
+    return (int32_t) errorCode;
 }
 
 /* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS: STREAM (TCP)
+ * PUBLIC FUNCTIONS: TCP INCOMING (TCP SERVER) ONLY
  * -------------------------------------------------------------- */
 
-// Send data.
-int32_t cellularSockWrite(CellularSockDescriptor_t descriptor,
-                          const void *pData, size_t dataSizeBytes)
+// Bind a socket to a local address.
+int32_t cellularSockBind(CellularSockDescriptor_t descriptor,
+                         const CellularSockAddress_t *pLocalAddress)
 {
-    CellularSockErrorCode_t errorCodeOrSize = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
     int32_t errno = CELLULAR_SOCK_ENONE;
     CellularSockContainer_t *pContainer = NULL;
 
     if (init()) {
-        // Check parameters
-        if (pData != NULL) {
+        // The module has no way of choosing a port for us
+        if ((pLocalAddress != NULL) && (pLocalAddress->port > 0)) {
 
-            CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
-
-            // Find the container
-            pContainer = pContainerFindByDescriptor(descriptor);
-
-            // If we have found the container, talk to cellular to
-            // do the sending
+            // Find the container and lock its socket
+            pContainer = pContainerLock(descriptor);
             if (pContainer != NULL) {
-                if (pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_TCP) {
-                    if (pContainer->socket.state == CELLULAR_SOCK_STATE_CONNECTED) {
-                        if ((pData == NULL) && (dataSizeBytes > 0)) {
-                            // Invalid argument
-                            errno = CELLULAR_SOCK_EINVAL;
-                        } else {
-                            if ((pData != NULL) && (dataSizeBytes > 0)) {
-                                errorCodeOrSize = send(pContainer, pData, dataSizeBytes);
-                            } else {
-                                // Nothing to do
-                                errorCodeOrSize = CELLULAR_SOCK_SUCCESS;
-                            }
-                        }
-                    } else {
-                        if ((pContainer->socket.state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_WRITE) ||
-                            (pContainer->socket.state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
-                            // Socket is shut down
-                            errno = CELLULAR_SOCK_ESHUTDOWN;
-                        } else if (pContainer->socket.state == CELLULAR_SOCK_STATE_CLOSING) {
-                            // Not connected mate
-                            errno = CELLULAR_SOCK_ENOTCONN;
-                        } else {
-                            // No route to host?
-                            errno = CELLULAR_SOCK_EHOSTUNREACH;
+                if ((pContainer->socket.state == CELLULAR_SOCK_STATE_CREATED) &&
+                    (pContainer->socket.localPort == 0)) {
+                    if (pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_UDP) {
+                        // There is nothing more to come for a UDP socket,
+                        // tell the module to receive on the port now
+                        atLock(pContainer);
+                        cellular_ctrl_at_cmd_start("AT+USOLI=");
+                        cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
+                        cellular_ctrl_at_write_int(pLocalAddress->port);
+                        cellular_ctrl_at_cmd_stop_read_resp();
+                        if (cellular_ctrl_at_unlock_return_error() != 0) {
+                            // The module wouldn't have it
+                            errno = CELLULAR_SOCK_EADDRINUSE;
                         }
                     }
+                    if (errno == CELLULAR_SOCK_ENONE) {
+                        // For TCP the port is given to the module
+                        // by cellularSockListen()
+                        pContainer->socket.localPort = pLocalAddress->port;
+                        errorCode = CELLULAR_SOCK_SUCCESS;
+                    }
                 } else {
-                    // Should never get here, throw 'em a googley so that the
-                    // error is distinct
-                    errno = CELLULAR_SOCK_EPROTOTYPE;
+                    // Already bound or connected
+                    errno = CELLULAR_SOCK_EINVAL;
                 }
             } else {
                 // Indicate that we weren't passed a valid socket descriptor
                 errno = CELLULAR_SOCK_EBADF;
             }
 
-            CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+            containerUnlock(pContainer);
 
         } else {
             // Invalid argument
@@ -2415,66 +5837,87 @@ int32_t cellularSockWrite(CellularSockDescriptor_t descriptor,
         cellularPort_errno_set(errno);
     }
 
-    return (int32_t) errorCodeOrSize;
+    return (int32_t) errorCode;
 }
 
-// Receive data.
-int32_t cellularSockRead(CellularSockDescriptor_t descriptor,
-                         void *pData, size_t dataSizeBytes)
+// Set the given socket into listening mode.
+int32_t cellularSockListen(CellularSockDescriptor_t descriptor,
+                           size_t backlog)
 {
-    CellularSockErrorCode_t errorCodeOrSize = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
     int32_t errno = CELLULAR_SOCK_ENONE;
     CellularSockContainer_t *pContainer = NULL;
+    CellularSockAcceptEntry_t *pAcceptQueue;
 
     if (init()) {
 
-        CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
-
-        // Find the container
-        pContainer = pContainerFindByDescriptor(descriptor);
-
-        // If we have found the container, talk to cellular to
-        // do the receiving
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
         if (pContainer != NULL) {
             if (pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_TCP) {
-                if (pContainer->socket.state == CELLULAR_SOCK_STATE_CONNECTED) {
-                    if ((pData == NULL) && (dataSizeBytes > 0)) {
-                        // Invalid argument
-                        errno = CELLULAR_SOCK_EINVAL;
-                    } else {
-                        if ((pData != NULL) && (dataSizeBytes != 0)) {
-                            if (pContainer->socket.protocol == CELLULAR_SOCK_PROTOCOL_TCP) {
-                                errorCodeOrSize = receive(pContainer, pData, dataSizeBytes);
-                            }
+                if (pContainer->socket.state == CELLULAR_SOCK_STATE_LISTENING) {
+                    // Already listening, nothing to do
+                    errorCode = CELLULAR_SOCK_SUCCESS;
+                } else if (pContainer->socket.state != CELLULAR_SOCK_STATE_CREATED) {
+                    // Connected or on the way out
+                    errno = CELLULAR_SOCK_EINVAL;
+                } else if (pContainer->socket.localPort == 0) {
+                    // Must be bound to a port first
+                    errno = CELLULAR_SOCK_EDESTADDRREQ;
+                } else if (!optionsFlush(pContainer)) {
+                    // The module wouldn't take the socket options
+                    // that were held for listen
+                    errno = CELLULAR_SOCK_EINVAL;
+                } else {
+                    if (backlog < 1) {
+                        backlog = 1;
+                    }
+                    if (backlog > CELLULAR_SOCK_ACCEPT_QUEUE_MAX_LENGTH) {
+                        backlog = CELLULAR_SOCK_ACCEPT_QUEUE_MAX_LENGTH;
+                    }
+                    pAcceptQueue = (CellularSockAcceptEntry_t *) pCellularPort_malloc(backlog *
+                                                                                      sizeof(CellularSockAcceptEntry_t));
+                    if (pAcceptQueue != NULL) {
+                        // The queue has to be there before the
+                        // module can send a URC to fill it
+                        CELLULAR_PORT_MUTEX_LOCK(gMutexAccept);
+                        pContainer->socket.pAcceptQueue = pAcceptQueue;
+                        pContainer->socket.acceptQueueSize = backlog;
+                        pContainer->socket.acceptQueueStart = 0;
+                        pContainer->socket.acceptQueueLength = 0;
+                        CELLULAR_PORT_MUTEX_UNLOCK(gMutexAccept);
+                        atLock(pContainer);
+                        cellular_ctrl_at_cmd_start("AT+USOLI=");
+                        cellular_ctrl_at_write_int(pContainer->socket.modemHandle);
+                        cellular_ctrl_at_write_int(pContainer->socket.localPort);
+                        cellular_ctrl_at_cmd_stop_read_resp();
+                        if (cellular_ctrl_at_unlock_return_error() == 0) {
+                            pContainer->socket.state = CELLULAR_SOCK_STATE_LISTENING;
+                            errorCode = CELLULAR_SOCK_SUCCESS;
+                            cellularPortLog("CELLULAR_SOCK: socket with descriptor %d, modem handle %d, is listening on port %d.\n",
+                                            descriptor,
+                                            pContainer->socket.modemHandle,
+                                            pContainer->socket.localPort);
                         } else {
-                            // Not an error, just nothing to do
-                            errorCodeOrSize = CELLULAR_SOCK_SUCCESS;
+                            acceptQueueFree(&(pContainer->socket));
+                            // The module wouldn't have it
+                            errno = CELLULAR_SOCK_EADDRINUSE;
                         }
-                    }
-                } else {
-                    if ((pContainer->socket.state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ) ||
-                        (pContainer->socket.state == CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
-                        // Socket is shut down
-                        errno = CELLULAR_SOCK_ESHUTDOWN;
-                    } else if (pContainer->socket.state == CELLULAR_SOCK_STATE_CLOSING) {
-                        // Not connected mate
-                        errno = CELLULAR_SOCK_ENOTCONN;
                     } else {
-                        // No route to host?
-                        errno = CELLULAR_SOCK_EHOSTUNREACH;
+                        // No memory for the accept queue
+                        errno = CELLULAR_SOCK_ENOBUFS;
                     }
                 }
             } else {
-                // Should never get here, throw 'em a googley so that the
-                // error is distinct
-                errno = CELLULAR_SOCK_EPROTOTYPE;
+                // Only TCP sockets listen
+                errno = CELLULAR_SOCK_EOPNOTSUPP;
             }
         } else {
             // Indicate that we weren't passed a valid socket descriptor
             errno = CELLULAR_SOCK_EBADF;
         }
 
-        CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+        containerUnlock(pContainer);
 
     } else {
         // The only reason initialisation might fail
@@ -2486,50 +5929,56 @@ int32_t cellularSockRead(CellularSockDescriptor_t descriptor,
         cellularPort_errno_set(errno);
     }
 
-    return (int32_t) errorCodeOrSize;
+    return (int32_t) errorCode;
 }
 
-// Prepare a TCP socket for being closed.
-int32_t cellularSockShutdown(CellularSockDescriptor_t descriptor,
-                             CellularSockShutdown_t how)
+// Accept an incoming TCP connection on the given socket.
+int32_t cellularSockAccept(CellularSockDescriptor_t descriptor,
+                           CellularSockAddress_t *pRemoteAddress)
 {
-    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockErrorCode_t descriptorOrErrorCode = CELLULAR_SOCK_BSD_ERROR;
     int32_t errno = CELLULAR_SOCK_ENONE;
     CellularSockContainer_t *pContainer = NULL;
+    CellularSockAcceptEntry_t entry;
+    int64_t startTimeMs = cellularPortGetTickTimeMs();
+    bool waiting;
 
     if (init()) {
 
-        CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
-
-        // Find the container
-        pContainer = pContainerFindByDescriptor(descriptor);
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
         if (pContainer != NULL) {
-            // Set the socket state
-            switch (how) {
-                case CELLULAR_SOCK_SHUTDOWN_READ:
-                    pContainer->socket.state = CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ;
-                    errorCode = CELLULAR_SOCK_SUCCESS;
-                break;
-                case CELLULAR_SOCK_SHUTDOWN_WRITE:
-                    pContainer->socket.state = CELLULAR_SOCK_STATE_SHUTDOWN_FOR_WRITE;
-                    errorCode = CELLULAR_SOCK_SUCCESS;
-                break;
-                case CELLULAR_SOCK_SHUTDOWN_READ_WRITE:
-                    pContainer->socket.state = CELLULAR_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE;
-                    errorCode = CELLULAR_SOCK_SUCCESS;
-                break;
-                default:
-                    // Invalid argument
+            do {
+                waiting = false;
+                if (pContainer->socket.state != CELLULAR_SOCK_STATE_LISTENING) {
+                    // Not listening
                     errno = CELLULAR_SOCK_EINVAL;
-                break;
-            }
+                } else if (acceptQueuePop(&(pContainer->socket), &entry)) {
+                    descriptorOrErrorCode = acceptInto(pContainer, &entry, &errno);
+                    if ((descriptorOrErrorCode >= 0) && (pRemoteAddress != NULL)) {
+                        pCellularPort_memcpy(pRemoteAddress, &(entry.remoteAddress),
+                                             sizeof(*pRemoteAddress));
+                    }
+                } else if (!pContainer->socket.nonBlocking &&
+                           (cellularPortGetTickTimeMs() - startTimeMs < pContainer->socket.receiveTimeoutMs)) {
+                    // Wait for the URC that indicates an incoming
+                    // connection
+                    waiting = receiveWait(pContainer, startTimeMs);
+                    if (!waiting) {
+                        // Closed while we waited
+                        errno = CELLULAR_SOCK_EBADF;
+                    }
+                } else {
+                    // Indicate that we would have blocked here
+                    errno = CELLULAR_SOCK_EWOULDBLOCK;
+                }
+            } while (waiting);
+            containerUnlock(pContainer);
         } else {
             // Indicate that we weren't passed a valid socket descriptor
             errno = CELLULAR_SOCK_EBADF;
         }
 
-        CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
-
     } else {
         // The only reason initialisation might fail
         errno = CELLULAR_SOCK_ENOMEM;
@@ -2540,47 +5989,107 @@ int32_t cellularSockShutdown(CellularSockDescriptor_t descriptor,
         cellularPort_errno_set(errno);
     }
 
-    return (int32_t) errorCode;
+    return (int32_t) descriptorOrErrorCode;
 }
 
-/* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS: ASYNC
- * -------------------------------------------------------------- */
-
-// Register a callback for incoming data.
-int32_t cellularSockRegisterCallbackData(CellularSockDescriptor_t descriptor,
-                                         void (*pCallback) (void *),
-                                         void *pCallbackParam)
+// Select: wait for one of a set of sockets to become unblocked.
+int32_t cellularSockSelect(int32_t maxDescriptor,
+                           CellularSockDescriptorSet_t *pReadDescriptorSet,
+                           CellularSockDescriptorSet_t *pWriteDescriptorSet,
+                           CellularSockDescriptorSet_t *pExceptDescriptorSet,
+                           int32_t timeMs)
 {
-    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    CellularSockErrorCode_t errorCodeOrNum = CELLULAR_SOCK_BSD_ERROR;
     int32_t errno = CELLULAR_SOCK_ENONE;
-    CellularSockContainer_t *pContainer = NULL;
+    CellularSockSelectWaiter_t *pWaiter;
+    CellularSockDescriptorSet_t readRequested;
+    CellularSockDescriptorSet_t writeRequested;
+    CellularSockDescriptorSet_t exceptRequested;
+    int64_t stopTimeMs = cellularPortGetTickTimeMs() + timeMs;
+    int64_t wakeTimeMs;
+    int64_t nowMs;
+    bool keepGoing = true;
 
     if (init()) {
-
-        CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
-
-        // Find the container
-        pContainer = pContainerFindByDescriptor(descriptor);
-
-        // If we have found the container, set up the callback
-        if (pContainer != NULL) {
-
-            CELLULAR_PORT_MUTEX_LOCK(gMutexCallbacks);
-
-            pContainer->socket.pPendingDataCallback = pCallback;
-            pContainer->socket.pPendingDataCallbackParam = pCallbackParam;
-
-            CELLULAR_PORT_MUTEX_UNLOCK(gMutexCallbacks);
-
-            errorCode = CELLULAR_SOCK_SUCCESS;
+        if (maxDescriptor >= 0) {
+            if (maxDescriptor > CELLULAR_SOCK_DESCRIPTOR_SETSIZE) {
+                maxDescriptor = CELLULAR_SOCK_DESCRIPTOR_SETSIZE;
+            }
+            // Register as a waiter before the first check so that
+            // no change in readiness can be missed
+            pWaiter = pSelectWaiterGet();
+            if (pWaiter != NULL) {
+                // Take a copy of what was asked for since the
+                // caller's sets are overwritten with the result
+                if (pReadDescriptorSet != NULL) {
+                    pCellularPort_memcpy(readRequested, *pReadDescriptorSet,
+                                         sizeof(readRequested));
+                }
+                if (pWriteDescriptorSet != NULL) {
+                    pCellularPort_memcpy(writeRequested, *pWriteDescriptorSet,
+                                         sizeof(writeRequested));
+                }
+                if (pExceptDescriptorSet != NULL) {
+                    pCellularPort_memcpy(exceptRequested, *pExceptDescriptorSet,
+                                         sizeof(exceptRequested));
+                }
+                while (keepGoing) {
+                    // Clear any signal first: a change after this
+                    // will leave a signal that ends the wait below
+                    waitClear(&(pWaiter->wait));
+                    if (pReadDescriptorSet != NULL) {
+                        CELLULAR_SOCK_FD_ZERO(pReadDescriptorSet);
+                    }
+                    if (pWriteDescriptorSet != NULL) {
+                        CELLULAR_SOCK_FD_ZERO(pWriteDescriptorSet);
+                    }
+                    if (pExceptDescriptorSet != NULL) {
+                        CELLULAR_SOCK_FD_ZERO(pExceptDescriptorSet);
+                    }
+                    wakeTimeMs = -1;
+                    errorCodeOrNum = selectCheck(maxDescriptor,
+                                                 (pReadDescriptorSet != NULL) ? &readRequested : NULL,
+                                                 (pWriteDescriptorSet != NULL) ? &writeRequested : NULL,
+                                                 (pExceptDescriptorSet != NULL) ? &exceptRequested : NULL,
+                                                 pReadDescriptorSet,
+                                                 pWriteDescriptorSet,
+                                                 pExceptDescriptorSet,
+                                                 &wakeTimeMs);
+                    keepGoing = (errorCodeOrNum == 0);
+                    if (keepGoing) {
+                        // Nothing ready, block until a URC signals
+                        // a change, a connect times out or we run
+                        // out of time
+                        nowMs = cellularPortGetTickTimeMs();
+                        if ((timeMs >= 0) && (nowMs >= stopTimeMs)) {
+                            // Timeout with nothing ready
+                            keepGoing = false;
+                        } else {
+                            if ((timeMs >= 0) &&
+                                ((wakeTimeMs < 0) || (wakeTimeMs > stopTimeMs))) {
+                                wakeTimeMs = stopTimeMs;
+                            }
+                            if (wakeTimeMs < 0) {
+                                waitBlock(&(pWaiter->wait), -1);
+                            } else if (wakeTimeMs > nowMs) {
+                                waitBlock(&(pWaiter->wait), (int32_t) (wakeTimeMs - nowMs));
+                            }
+                        }
+                    }
+                }
+                selectWaiterRelease(pWaiter);
+                if (errorCodeOrNum < 0) {
+                    // Indicate that we weren't passed a valid socket descriptor
+                    errno = CELLULAR_SOCK_EBADF;
+                }
+            } else {
+                // Too many tasks selecting at once
+                errno = CELLULAR_SOCK_ENOMEM;
+            }
         } else {
-            // Indicate that we weren't passed a valid socket descriptor
-            errno = CELLULAR_SOCK_EBADF;
+            // Invalid argument
+            errno = CELLULAR_SOCK_EINVAL;
         }
-
-        CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
-
     } else {
         // The only reason initialisation might fail
         errno = CELLULAR_SOCK_ENOMEM;
@@ -2591,13 +6100,16 @@ int32_t cellularSockRegisterCallbackData(CellularSockDescriptor_t descriptor,
         cellularPort_errno_set(errno);
     }
 
-    return (int32_t) errorCode;
+    return (int32_t) errorCodeOrNum;
 }
 
-// Register a callback for socket closed.
-int32_t cellularSockRegisterCallbackClosed(CellularSockDescriptor_t descriptor,
-                                           void (*pCallback) (void *),
-                                           void *pCallbackParam)
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: STATISTICS
+ * -------------------------------------------------------------- */
+
+// Get the traffic statistics of a socket.
+int32_t cellularSockGetStats(CellularSockDescriptor_t descriptor,
+                             CellularSockStats_t *pStats)
 {
     CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
     int32_t errno = CELLULAR_SOCK_ENONE;
@@ -2605,28 +6117,23 @@ int32_t cellularSockRegisterCallbackClosed(CellularSockDescriptor_t descriptor,
 
     if (init()) {
 
-        CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
-
-        // Find the container
-        pContainer = pContainerFindByDescriptor(descriptor);
+        // Find the container and lock its socket
+        pContainer = pContainerLock(descriptor);
 
-        // If we have found the container, set up the callbacks
         if (pContainer != NULL) {
-
-            CELLULAR_PORT_MUTEX_LOCK(gMutexCallbacks);
-
-            pContainer->socket.pConnectionClosedCallback = pCallback;
-            pContainer->socket.pConnectionClosedCallbackParam = pCallbackParam;
-
-            CELLULAR_PORT_MUTEX_UNLOCK(gMutexCallbacks);
-
-            errorCode = CELLULAR_SOCK_SUCCESS;
+            if (pStats != NULL) {
+                *pStats = pContainer->socket.stats;
+                errorCode = CELLULAR_SOCK_SUCCESS;
+            } else {
+                // Invalid argument
+                errno = CELLULAR_SOCK_EINVAL;
+            }
         } else {
             // Indicate that we weren't passed a valid socket descriptor
             errno = CELLULAR_SOCK_EBADF;
         }
 
-        CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+        containerUnlock(pContainer);
 
     } else {
         // The only reason initialisation might fail
@@ -2641,53 +6148,34 @@ int32_t cellularSockRegisterCallbackClosed(CellularSockDescriptor_t descriptor,
     return (int32_t) errorCode;
 }
 
-/* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS: TCP INCOMING (TCP SERVER) ONLY
- * -------------------------------------------------------------- */
-
-// Bind a socket to a local address.
-int32_t cellularSockBind(CellularSockDescriptor_t descriptor,
-                         const CellularSockAddress_t *pLocalAddress)
+// Get the traffic statistics of all sockets.
+int32_t cellularSockGetStatsAll(CellularSockStats_t *pStats)
 {
-    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_NOT_IMPLEMENTED;
-    int32_t errno = CELLULAR_SOCK_ENOSYS;
-
-    // TODO
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
 
-    if (errno != CELLULAR_SOCK_ENONE) {
-        // Write the errno
-        cellularPort_errno_set(errno);
-    }
+    if (pStats != NULL) {
+        if (init()) {
 
-    return (int32_t) errorCode;
-}
+            // The sockets are not locked: their counters are
+            // read as they stand
+            CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
 
-// Set the given socket into listening mode.
-int32_t cellularSockListen(CellularSockDescriptor_t descriptor,
-                           size_t backlog)
-{
-    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_NOT_IMPLEMENTED;
-    int32_t errno = CELLULAR_SOCK_ENOSYS;
+            statsTotal(pStats);
+            statsSum(pStats, &gStatsBaseline, true);
+            errorCode = CELLULAR_SOCK_SUCCESS;
 
-    // TODO
+            CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
 
-    if (errno != CELLULAR_SOCK_ENONE) {
-        // Write the errno
-        cellularPort_errno_set(errno);
+        } else {
+            // The only reason initialisation might fail
+            errno = CELLULAR_SOCK_ENOMEM;
+        }
+    } else {
+        // Invalid argument
+        errno = CELLULAR_SOCK_EINVAL;
     }
 
-    return (int32_t) errorCode;
-}
-
-// Accept an incoming TCP connection on the given socket.
-int32_t cellularSockAccept(CellularSockDescriptor_t descriptor,
-                           CellularSockAddress_t *pRemoteAddress)
-{
-    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_NOT_IMPLEMENTED;
-    int32_t errno = CELLULAR_SOCK_ENOSYS;
-
-    // TODO
-
     if (errno != CELLULAR_SOCK_ENONE) {
         // Write the errno
         cellularPort_errno_set(errno);
@@ -2696,24 +6184,19 @@ int32_t cellularSockAccept(CellularSockDescriptor_t descriptor,
     return (int32_t) errorCode;
 }
 
-// Select: wait for one of a set of sockets to become unblocked.
-int32_t cellularSockSelect(int32_t maxDescriptor,
-                           CellularSockDescriptorSet_t *pReadDescriptorSet,
-                           CellularSockDescriptorSet_t *pWriteDescriptoreSet,
-                           CellularSockDescriptorSet_t *pExceptDescriptorSet,
-                           int32_t timeMs)
+// Reset the traffic statistics of all sockets.
+void cellularSockResetStats()
 {
-    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_NOT_IMPLEMENTED;
-    int32_t errno = CELLULAR_SOCK_ENOSYS;
+    if (init()) {
 
-    // TODO
+        // Rather than zero the counters of each socket, which
+        // would mean locking each one, remember where they are
+        CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
 
-    if (errno != CELLULAR_SOCK_ENONE) {
-        // Write the errno
-        cellularPort_errno_set(errno);
-    }
+        statsTotal(&gStatsBaseline);
 
-    return (int32_t) errorCode;
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
 }
 
 /* ----------------------------------------------------------------
@@ -2733,10 +6216,8 @@ int32_t cellularSockGetRemoteAddress(CellularSockDescriptor_t descriptor,
         // Check parameters
         if (pRemoteAddress != NULL) {
 
-            CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
-
-            // Find the container
-            pContainer = pContainerFindByDescriptor(descriptor);
+            // Find the container and lock its socket
+            pContainer = pContainerLock(descriptor);
 
             if (pContainer != NULL) {
                 if (pContainer->socket.state == CELLULAR_SOCK_STATE_CONNECTED) {
@@ -2753,7 +6234,7 @@ int32_t cellularSockGetRemoteAddress(CellularSockDescriptor_t descriptor,
                 errno = CELLULAR_SOCK_EBADF;
             }
 
-            CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+            containerUnlock(pContainer);
 
         } else {
             // Invalid argument
@@ -2786,18 +6267,19 @@ int32_t cellularSockGetLocalAddress(CellularSockDescriptor_t descriptor,
         // Check parameters
         if (pLocalAddress != NULL) {
 
-            CELLULAR_PORT_MUTEX_LOCK(gMutexContainer);
-
             // Check that the descriptor is at least valid
-            pContainer = pContainerFindByDescriptor(descriptor);
+            pContainer = pContainerLock(descriptor);
             if (pContainer != NULL) {
                 // IP address is that of cellular, for all sockets
                 if (cellularCtrlGetIpAddressStr(buffer) > 0) {
                     if (cellularSockStringToAddress(buffer,
                                                     pLocalAddress) == 0) {
+                        // The port is only known for a socket that
+                        // was bound or accepted, otherwise it is
+                        // chosen by the module and left as zero
+                        pLocalAddress->port = pContainer->socket.localPort;
                         errorCode = CELLULAR_SOCK_SUCCESS;
                     }
-                    // TODO: where to get the port number from?
                 } else {
                     // Network is down
                     errno = CELLULAR_SOCK_ENETDOWN;
@@ -2807,7 +6289,7 @@ int32_t cellularSockGetLocalAddress(CellularSockDescriptor_t descriptor,
                 errno = CELLULAR_SOCK_EBADF;
             }
 
-            CELLULAR_PORT_MUTEX_UNLOCK(gMutexContainer);
+            containerUnlock(pContainer);
 
         } else {
             // Nothing to do
@@ -2835,43 +6317,86 @@ int32_t cellularSockGetHostByName(const char *pHostName,
     CellularSockAddress_t address;
     int32_t bytesRead;
     int32_t atError;
+    cellular_ctrl_at_device_err_t deviceError;
+    bool cached = false;
+    bool found = false;
 
-    // No need to call init() here, this does not use the mutexes
     if (pHostName != NULL) {
-        cellularPortLog("CELLULAR_SOCK: looking up IP address of \"%s\".\n",
-                        pHostName);
-        cellular_ctrl_at_lock();
-        // Allow plenty of time
-        cellular_ctrl_at_set_at_timeout(60000, false);
-        cellular_ctrl_at_cmd_start("AT+UDNSRN=");
-        cellular_ctrl_at_write_int(0);
-        cellular_ctrl_at_write_string(pHostName, true);
-        cellular_ctrl_at_cmd_stop();
-        cellular_ctrl_at_resp_start("+UDNSRN:", false);
-        bytesRead = cellular_ctrl_at_read_string(buffer,
-                                                 sizeof(buffer),
-                                                 false);
-        cellular_ctrl_at_resp_stop();
-        cellular_ctrl_at_restore_at_timeout();
-        atError = cellular_ctrl_at_unlock_return_error();
-        if ((bytesRead >= 0) && (atError == 0)) {
-            // All is good
-            cellularPortLog("CELLULAR_SOCK: found it at \"%.*s\".\n",
-                            bytesRead, buffer);
-            if (pHostIpAddress != NULL) {
-                // Convert to struct
-                if (cellularSockStringToAddress(buffer,
-                                                &address) == 0) {
-                    pCellularPort_memcpy(pHostIpAddress,
-                                         &(address.ipAddress),
-                                         sizeof(*pHostIpAddress));
+        if (init()) {
+
+            CELLULAR_PORT_MUTEX_LOCK(gMutexDns);
+
+            gDnsCacheStats.numLookups++;
+            cached = dnsCacheLookUp(pHostName, &found,
+                                    &(address.ipAddress));
+
+            CELLULAR_PORT_MUTEX_UNLOCK(gMutexDns);
+
+            if (cached) {
+                if (found) {
+                    if (pHostIpAddress != NULL) {
+                        pCellularPort_memcpy(pHostIpAddress,
+                                             &(address.ipAddress),
+                                             sizeof(*pHostIpAddress));
+                    }
                     errorCode = CELLULAR_SOCK_SUCCESS;
                 }
             } else {
-                errorCode = CELLULAR_SOCK_SUCCESS;
+                cellularPortLog("CELLULAR_SOCK: looking up IP address of \"%s\".\n",
+                                pHostName);
+                cellular_ctrl_at_lock();
+                cellular_ctrl_at_set_at_timeout(CELLULAR_SOCK_DNS_TIMEOUT_SECONDS * 1000,
+                                                false);
+                cellular_ctrl_at_cmd_start("AT+UDNSRN=");
+                cellular_ctrl_at_write_int(0);
+                cellular_ctrl_at_write_string(pHostName, true);
+                cellular_ctrl_at_cmd_stop();
+                cellular_ctrl_at_resp_start("+UDNSRN:", false);
+                bytesRead = cellular_ctrl_at_read_string(buffer,
+                                                         sizeof(buffer),
+                                                         false);
+                cellular_ctrl_at_resp_stop();
+                cellular_ctrl_at_restore_at_timeout();
+                deviceError = cellular_ctrl_at_get_last_device_error();
+                atError = cellular_ctrl_at_unlock_return_error();
+                if ((bytesRead >= 0) && (atError == 0)) {
+                    // All is good
+                    cellularPortLog("CELLULAR_SOCK: found it at \"%.*s\".\n",
+                                    bytesRead, buffer);
+                    // Convert to struct
+                    if (cellularSockStringToAddress(buffer,
+                                                    &address) == 0) {
+                        if (pHostIpAddress != NULL) {
+                            pCellularPort_memcpy(pHostIpAddress,
+                                                 &(address.ipAddress),
+                                                 sizeof(*pHostIpAddress));
+                        }
+                        found = true;
+                        errorCode = CELLULAR_SOCK_SUCCESS;
+                    } else if (pHostIpAddress == NULL) {
+                        errorCode = CELLULAR_SOCK_SUCCESS;
+                    }
+                } else {
+                    cellularPortLog("CELLULAR_SOCK: host not found.\n");
+                }
+
+                CELLULAR_PORT_MUTEX_LOCK(gMutexDns);
+
+                gDnsCacheStats.numMisses++;
+                if (found) {
+                    dnsCacheStore(pHostName, &(address.ipAddress));
+                } else if ((atError != 0) &&
+                           (deviceError.errType == CELLULAR_CTRL_AT_DEVICE_ERROR_TYPE_CME) &&
+                           (deviceError.errCode == CELLULAR_SOCK_DNS_CME_ERROR_HOST_NOT_FOUND)) {
+                    // The answer was that the name doesn't exist,
+                    // rather than no answer or that the look-up
+                    // couldn't be done (e.g. no network), which
+                    // may be different next time
+                    dnsCacheStore(pHostName, NULL);
+                }
+
+                CELLULAR_PORT_MUTEX_UNLOCK(gMutexDns);
             }
-        } else {
-            cellularPortLog("CELLULAR_SOCK: host not found.\n");
         }
     } else {
         // Nothing to do
@@ -2881,6 +6406,343 @@ int32_t cellularSockGetHostByName(const char *pHostName,
     return (int32_t) errorCode;
 }
 
+// Get the statistics of host name look-ups and the DNS cache.
+int32_t cellularSockGetDnsCacheStats(CellularSockDnsCacheStats_t *pStats)
+{
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+
+    if (pStats != NULL) {
+        if (init()) {
+
+            CELLULAR_PORT_MUTEX_LOCK(gMutexDns);
+
+            *pStats = gDnsCacheStats;
+            pStats->numEntries = 0;
+#if CELLULAR_SOCK_DNS_CACHE_NUM_ENTRIES > 0
+            for (size_t x = 0; x < sizeof(gDnsCache) / sizeof(gDnsCache[0]); x++) {
+                if (gDnsCache[x].hostName[0] != 0) {
+                    pStats->numEntries++;
+                }
+            }
+#endif
+            errorCode = CELLULAR_SOCK_SUCCESS;
+
+            CELLULAR_PORT_MUTEX_UNLOCK(gMutexDns);
+
+        } else {
+            // The only reason initialisation might fail
+            errno = CELLULAR_SOCK_ENOMEM;
+        }
+    } else {
+        // Invalid argument
+        errno = CELLULAR_SOCK_EINVAL;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Reset the statistics of host name look-ups and the DNS cache.
+void cellularSockResetDnsCacheStats()
+{
+    if (init()) {
+
+        CELLULAR_PORT_MUTEX_LOCK(gMutexDns);
+
+        pCellularPort_memset(&gDnsCacheStats, 0, sizeof(gDnsCacheStats));
+
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexDns);
+    }
+}
+
+// Empty the DNS cache.
+void cellularSockFlushDnsCache()
+{
+    if (init()) {
+
+        CELLULAR_PORT_MUTEX_LOCK(gMutexDns);
+
+        dnsCacheFlush();
+
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexDns);
+    }
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: TLS
+ * -------------------------------------------------------------- */
+
+// Store a credential in the module.
+int32_t cellularSockTlsStoreCredential(CellularSockTlsCredentialType_t type,
+                                       const char *pName,
+                                       const char *pData,
+                                       size_t dataSizeBytes)
+{
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    bool stored = false;
+
+    if ((pName != NULL) && (pName[0] != 0) &&
+        (cellularPort_strlen(pName) <= CELLULAR_SOCK_TLS_CREDENTIAL_NAME_MAX_LENGTH_BYTES) &&
+        (pData != NULL) && (dataSizeBytes > 0)) {
+        if (init()) {
+
+            CELLULAR_PORT_MUTEX_LOCK(gMutexTls);
+
+            gTlsCacheStats.numCredentialStores++;
+            if (tlsCredentialCacheLookUp(type, pName, pData,
+                                         dataSizeBytes)) {
+                gTlsCacheStats.numCredentialHits++;
+                errorCode = CELLULAR_SOCK_SUCCESS;
+            } else {
+                cellularPortLog("CELLULAR_SOCK: storing credential \"%s\", %d byte(s).\n",
+                                pName, (int) dataSizeBytes);
+                cellular_ctrl_at_lock();
+                cellular_ctrl_at_cmd_start("AT+USECMNG=");
+                cellular_ctrl_at_write_int(0);
+                cellular_ctrl_at_write_int((int32_t) type);
+                cellular_ctrl_at_write_string(pName, true);
+                cellular_ctrl_at_write_int((int32_t) dataSizeBytes);
+                cellular_ctrl_at_cmd_stop();
+                if (cellular_ctrl_at_wait_char('>')) {
+                    cellular_ctrl_at_write_bytes((const uint8_t *) pData,
+                                                 dataSizeBytes);
+                }
+                cellular_ctrl_at_resp_start("+USECMNG:", false);
+                cellular_ctrl_at_resp_stop();
+                if (cellular_ctrl_at_unlock_return_error() == 0) {
+                    gTlsCacheStats.numCredentialBytes += dataSizeBytes;
+                    stored = true;
+                    errorCode = CELLULAR_SOCK_SUCCESS;
+                } else {
+                    // Whatever the module had under that name
+                    // may or may not still be there
+                    errno = CELLULAR_SOCK_EIO;
+                }
+                tlsCredentialCacheStore(type, pName, pData,
+                                        dataSizeBytes, stored);
+            }
+
+            CELLULAR_PORT_MUTEX_UNLOCK(gMutexTls);
+
+        } else {
+            // The only reason initialisation might fail
+            errno = CELLULAR_SOCK_ENOMEM;
+        }
+    } else {
+        // Invalid argument
+        errno = CELLULAR_SOCK_EINVAL;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Remove a credential from the module.
+int32_t cellularSockTlsRemoveCredential(CellularSockTlsCredentialType_t type,
+                                        const char *pName)
+{
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+
+    if ((pName != NULL) && (pName[0] != 0)) {
+        if (init()) {
+
+            CELLULAR_PORT_MUTEX_LOCK(gMutexTls);
+
+            cellular_ctrl_at_lock();
+            cellular_ctrl_at_cmd_start("AT+USECMNG=");
+            cellular_ctrl_at_write_int(2);
+            cellular_ctrl_at_write_int((int32_t) type);
+            cellular_ctrl_at_write_string(pName, true);
+            cellular_ctrl_at_cmd_stop_read_resp();
+            if (cellular_ctrl_at_unlock_return_error() == 0) {
+                errorCode = CELLULAR_SOCK_SUCCESS;
+            } else {
+                // Not there
+                errno = CELLULAR_SOCK_ENOENT;
+            }
+            tlsCredentialCacheStore(type, pName, NULL, 0, false);
+
+            CELLULAR_PORT_MUTEX_UNLOCK(gMutexTls);
+
+        } else {
+            // The only reason initialisation might fail
+            errno = CELLULAR_SOCK_ENOMEM;
+        }
+    } else {
+        // Invalid argument
+        errno = CELLULAR_SOCK_EINVAL;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Get a security profile of the module set up in a given way.
+int32_t cellularSockTlsProfileGet(const CellularSockTlsProfile_t *pProfile)
+{
+    CellularSockErrorCode_t errorCodeOrProfile = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+    CellularSockTlsProfileCacheEntry_t *pEntry = NULL;
+    int32_t profile;
+
+    if ((pProfile != NULL) &&
+        tlsProfileStringIsValid(pProfile->pRootCaName,
+                                CELLULAR_SOCK_TLS_CREDENTIAL_NAME_MAX_LENGTH_BYTES) &&
+        tlsProfileStringIsValid(pProfile->pClientCertName,
+                                CELLULAR_SOCK_TLS_CREDENTIAL_NAME_MAX_LENGTH_BYTES) &&
+        tlsProfileStringIsValid(pProfile->pClientKeyName,
+                                CELLULAR_SOCK_TLS_CREDENTIAL_NAME_MAX_LENGTH_BYTES) &&
+        tlsProfileStringIsValid(pProfile->pServerName,
+                                CELLULAR_SOCK_TLS_SERVER_NAME_MAX_LENGTH_BYTES)) {
+        if (init()) {
+
+            CELLULAR_PORT_MUTEX_LOCK(gMutexTls);
+
+            gTlsCacheStats.numProfileGets++;
+            // Look for one set up the same way, else one
+            // not set up, else the one used least recently
+            for (size_t x = 0; (pEntry == NULL) &&
+                               (x < sizeof(gTlsProfileCache) / sizeof(gTlsProfileCache[0])); x++) {
+                if (tlsProfileIsSame(&(gTlsProfileCache[x]), pProfile)) {
+                    pEntry = &(gTlsProfileCache[x]);
+                    gTlsCacheStats.numProfileHits++;
+                }
+            }
+            for (size_t x = 0; (pEntry == NULL) &&
+                               (x < sizeof(gTlsProfileCache) / sizeof(gTlsProfileCache[0])); x++) {
+                if (!gTlsProfileCache[x].setUp) {
+                    pEntry = &(gTlsProfileCache[x]);
+                }
+            }
+            if (pEntry == NULL) {
+                pEntry = &(gTlsProfileCache[0]);
+                for (size_t x = 1; x < sizeof(gTlsProfileCache) / sizeof(gTlsProfileCache[0]); x++) {
+                    if (gTlsProfileCache[x].lastUsedTimeMs < pEntry->lastUsedTimeMs) {
+                        pEntry = &(gTlsProfileCache[x]);
+                    }
+                }
+            }
+            profile = CELLULAR_SOCK_TLS_FIRST_SECURITY_PROFILE +
+                      (int32_t) (pEntry - gTlsProfileCache);
+            if (!tlsProfileIsSame(pEntry, pProfile)) {
+                cellularPortLog("CELLULAR_SOCK: setting up security profile %d.\n",
+                                profile);
+                pEntry->setUp = tlsProfileSetUp(profile, pProfile);
+                pEntry->validation = pProfile->validation;
+                tlsProfileStringCopy(pEntry->rootCaName,
+                                     pProfile->pRootCaName);
+                tlsProfileStringCopy(pEntry->clientCertName,
+                                     pProfile->pClientCertName);
+                tlsProfileStringCopy(pEntry->clientKeyName,
+                                     pProfile->pClientKeyName);
+                tlsProfileStringCopy(pEntry->serverName,
+                                     pProfile->pServerName);
+                pEntry->sessionResumption = pProfile->sessionResumption;
+            }
+            if (pEntry->setUp) {
+                pEntry->lastUsedTimeMs = cellularPortGetTickTimeMs();
+                errorCodeOrProfile = (CellularSockErrorCode_t) profile;
+            } else {
+                // The module didn't like the settings
+                errno = CELLULAR_SOCK_EINVAL;
+            }
+
+            CELLULAR_PORT_MUTEX_UNLOCK(gMutexTls);
+
+        } else {
+            // The only reason initialisation might fail
+            errno = CELLULAR_SOCK_ENOMEM;
+        }
+    } else {
+        // Invalid argument
+        errno = CELLULAR_SOCK_EINVAL;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCodeOrProfile;
+}
+
+// Get the statistics of the setting up of TLS in the module.
+int32_t cellularSockGetTlsCacheStats(CellularSockTlsCacheStats_t *pStats)
+{
+    CellularSockErrorCode_t errorCode = CELLULAR_SOCK_BSD_ERROR;
+    int32_t errno = CELLULAR_SOCK_ENONE;
+
+    if (pStats != NULL) {
+        if (init()) {
+
+            CELLULAR_PORT_MUTEX_LOCK(gMutexTls);
+
+            *pStats = gTlsCacheStats;
+            errorCode = CELLULAR_SOCK_SUCCESS;
+
+            CELLULAR_PORT_MUTEX_UNLOCK(gMutexTls);
+
+        } else {
+            // The only reason initialisation might fail
+            errno = CELLULAR_SOCK_ENOMEM;
+        }
+    } else {
+        // Invalid argument
+        errno = CELLULAR_SOCK_EINVAL;
+    }
+
+    if (errno != CELLULAR_SOCK_ENONE) {
+        // Write the errno
+        cellularPort_errno_set(errno);
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Reset the statistics of the setting up of TLS in the module.
+void cellularSockResetTlsCacheStats()
+{
+    if (init()) {
+
+        CELLULAR_PORT_MUTEX_LOCK(gMutexTls);
+
+        pCellularPort_memset(&gTlsCacheStats, 0, sizeof(gTlsCacheStats));
+
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexTls);
+    }
+}
+
+// Forget what has been stored in the module and how its
+// security profiles have been set up.
+void cellularSockFlushTlsCache()
+{
+    if (init()) {
+
+        CELLULAR_PORT_MUTEX_LOCK(gMutexTls);
+
+        tlsCredentialCacheFlush();
+        pCellularPort_memset(gTlsProfileCache, 0,
+                             sizeof(gTlsProfileCache));
+
+        CELLULAR_PORT_MUTEX_UNLOCK(gMutexTls);
+    }
+}
+
 /* ----------------------------------------------------------------
  * PUBIC FUNCTIONS: ADDRESS CONVERSION
  * -------------------------------------------------------------- */
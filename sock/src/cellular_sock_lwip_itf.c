@@ -471,17 +471,18 @@ int cellular_lwip_listen(int s, int backlog)
 int cellular_lwip_accept(int s, struct sockaddr *addr,
                          socklen_t *addrlen)
 {
-    int errorCode;
+    int descriptorOrErrorCode;
     CellularSockAddress_t remoteAddress;
 
-    errorCode = cellularSockAccept((CellularSockDescriptor_t) s,
-                                   &remoteAddress);
-    if (errorCode == 0) {
-        errorCode = cellularSockAddressToSockaddr(&remoteAddress,
-                                                  addr, addrlen);
+    descriptorOrErrorCode = cellularSockAccept((CellularSockDescriptor_t) s,
+                                               &remoteAddress);
+    if ((descriptorOrErrorCode >= 0) && (addr != NULL)) {
+        // The connection is accepted whether or not
+        // the address fits, so ignore any error here
+        cellularSockAddressToSockaddr(&remoteAddress, addr, addrlen);
     }
 
-    return errorCode;
+    return descriptorOrErrorCode;
 }
 
 // Select: wait for one of a set of sockets to become unblocked.
@@ -490,7 +491,12 @@ int cellular_lwip_select(int maxfdp1, fd_set *readset,
                          fd_set *exceptset,
                          struct timeval *timeout)
 {
-    int32_t timeMs = (timeout->tv_sec * 1000) + (timeout->tv_usec / 1000);
+    int32_t timeMs = -1;
+
+    // A NULL timeout means wait forever
+    if (timeout != NULL) {
+        timeMs = (timeout->tv_sec * 1000) + (timeout->tv_usec / 1000);
+    }
 
     return cellularSockSelect(maxfdp1,
                               (CellularSockDescriptorSet_t *) readset,
@@ -69,6 +69,67 @@
 // Margin on timers.
 #define CELLULAR_SOCK_TEST_TIME_MARGIN_MS 100
 
+// The amount of data to echo in the select() test.
+#define CELLULAR_SOCK_TEST_SELECT_DATA_SIZE_BYTES 100
+
+// The number of datagrams to ask for in each call to
+// cellularSockReceiveFromMulti().
+#define CELLULAR_SOCK_TEST_MULTI_NUM_DATAGRAMS 8
+
+// The number of clients that connect to the listening socket in
+// the TCP server test: with the listening socket and an accepted
+// socket for each client this uses up all of the sockets.
+#define CELLULAR_SOCK_TEST_TCP_SERVER_NUM_CLIENTS ((CELLULAR_SOCK_MAX - 1) / 2)
+
+// How long the client in the TCP server test waits before
+// connecting, while the server is blocked in accept.
+#define CELLULAR_SOCK_TEST_TCP_SERVER_CONNECT_DELAY_MS 2000
+
+// The receive timeout of the socket left blocked in the
+// concurrency test: long enough that anything which has to
+// wait for it would be obvious.
+#define CELLULAR_SOCK_TEST_CONCURRENT_RECEIVE_TIMEOUT_MS 30000
+
+// The number of times the connecting task in the concurrency
+// test connects a socket, and closes it again.
+#define CELLULAR_SOCK_TEST_CONCURRENT_NUM_CONNECTS 3
+
+// The number of times the data is echoed over TCP in the
+// concurrency test while the other sockets are busy.
+#define CELLULAR_SOCK_TEST_CONCURRENT_NUM_ECHOES 4
+
+// How long the concurrency test allows for an operation on one
+// socket while another is busy, way less than
+// CELLULAR_SOCK_TEST_CONCURRENT_RECEIVE_TIMEOUT_MS.
+#define CELLULAR_SOCK_TEST_CONCURRENT_MARGIN_MS 2000
+
+// The number of sockets connected in parallel, non-blocking, by
+// the non-blocking connect test.
+#define CELLULAR_SOCK_TEST_CONNECT_NUM_SOCKETS 3
+
+// How long the non-blocking connect test waits for its
+// connections to be made.
+#define CELLULAR_SOCK_TEST_CONNECT_TIMEOUT_MS 30000
+
+// The connect timeout the non-blocking connect test gives a
+// connection that is never answered.
+#define CELLULAR_SOCK_TEST_CONNECT_BLACK_HOLE_TIMEOUT_MS 2000
+
+// How long the AT arbiter test keeps a socket busy while it
+// times control commands.
+#define CELLULAR_SOCK_TEST_ARBITER_LOAD_TIME_MS 10000
+
+// The transmit buffer size used by the transmit buffer test.
+#define CELLULAR_SOCK_TEST_TX_BUFFER_SIZE_BYTES 256
+
+// The number of writes the transmit buffer test gathers in
+// the transmit buffer, each CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES
+// long; together they must fit.
+#define CELLULAR_SOCK_TEST_TX_NUM_WRITES 10
+
+// The size of each write of the transmit buffer test.
+#define CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES 10
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -113,6 +174,28 @@ typedef struct {
     int32_t returnCode;
 } CellularSockReceiveTaskUdpData_t;
 
+// Struct to pass to receiveBlockedTask(), connectTask() and
+// delayedConnectTask().
+typedef struct {
+    CellularSockDescriptor_t sockDescriptor;
+    const CellularSockAddress_t *pRemoteAddress;
+    int32_t returnCode;
+    int32_t errorNumber;
+    int32_t timeMs;
+    volatile bool done;
+} CellularSockTestConcurrentTaskData_t;
+
+// Struct to pass to testReceiver().
+typedef struct {
+    CellularSockDescriptor_t sockDescriptor;
+    char *pBuffer; // With guard bands either side
+    size_t sizeBytes;
+    volatile size_t offset;
+    volatile size_t numCalls;
+    volatile bool pause; // Ask for a pause on the next call
+    bool wrongDescriptor;
+} CellularSockTestReceiverData_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES: MISC
  * -------------------------------------------------------------- */
@@ -367,6 +450,8 @@ static CellularSockTestOption_t gSupportedOptions[] = {
 # endif
 #endif
     {CELLULAR_SOCK_OPT_LEVEL_SOCK, CELLULAR_SOCK_OPT_RCVTIMEO,     sizeof(CellularPort_timeval), compareTimeval, changeTimevalMs},
+    {CELLULAR_SOCK_OPT_LEVEL_SOCK, CELLULAR_SOCK_OPT_RCVBUF,       sizeof(int32_t),              compareInt32,   changeInt32Positive},
+    {CELLULAR_SOCK_OPT_LEVEL_SOCK, CELLULAR_SOCK_OPT_SNDBUF,       sizeof(int32_t),              compareInt32,   changeInt32Positive},
     {CELLULAR_SOCK_OPT_LEVEL_IP,   CELLULAR_SOCK_OPT_IP_TOS,       sizeof(int32_t),              compareInt32,   changeMod256},
     {CELLULAR_SOCK_OPT_LEVEL_IP,   CELLULAR_SOCK_OPT_IP_TTL,       sizeof(int32_t),              compareInt32,   changeMod256NonZero},
     {CELLULAR_SOCK_OPT_LEVEL_TCP,  CELLULAR_SOCK_OPT_TCP_NODELAY,  sizeof(int32_t),              compareInt32,   changeMod2},
@@ -980,6 +1065,104 @@ static void echoDataTaskTcp(void *pParameters)
     cellularPortTaskDelete(NULL);
 }
 
+// Task to sit in a receive on a socket that nothing will
+// arrive on.
+static void receiveBlockedTask(void *pParameters)
+{
+    CellularSockTestConcurrentTaskData_t *pData;
+    char buffer[CELLULAR_SOCK_TEST_MAX_UDP_PACKET_SIZE];
+    int64_t startTimeMs;
+
+    pData = (CellularSockTestConcurrentTaskData_t *) pParameters;
+
+    cellularPortLog("CELLULAR_SOCK_TEST: receiving on socket descriptor %d"
+                    " @%d ms...\n", pData->sockDescriptor,
+                    (int32_t) cellularPortGetTickTimeMs());
+    startTimeMs = cellularPortGetTickTimeMs();
+    pData->returnCode = cellularSockReceiveFrom(pData->sockDescriptor, NULL,
+                                                buffer, sizeof(buffer));
+    pData->errorNumber = cellularPort_errno_get();
+    pData->timeMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+    cellularPortLog("CELLULAR_SOCK_TEST: receive on socket descriptor %d"
+                    " returned %d, errno %d, after %d ms.\n",
+                    pData->sockDescriptor, pData->returnCode,
+                    pData->errorNumber, pData->timeMs);
+    pData->done = true;
+
+    // Delete ourself: only valid way out in Free RTOS
+    cellularPortTaskDelete(NULL);
+}
+
+// Task to connect TCP sockets, and close them again, a few times.
+static void connectTask(void *pParameters)
+{
+    CellularSockTestConcurrentTaskData_t *pData;
+    CellularSockDescriptor_t sockDescriptor;
+    int64_t startTimeMs;
+
+    pData = (CellularSockTestConcurrentTaskData_t *) pParameters;
+
+    startTimeMs = cellularPortGetTickTimeMs();
+    for (size_t x = 0; (x < CELLULAR_SOCK_TEST_CONCURRENT_NUM_CONNECTS) &&
+                       (pData->returnCode == 0); x++) {
+        sockDescriptor = cellularSockCreate(CELLULAR_SOCK_TYPE_STREAM,
+                                            CELLULAR_SOCK_PROTOCOL_TCP);
+        if (sockDescriptor >= 0) {
+            cellularPortLog("CELLULAR_SOCK_TEST: connecting socket descriptor %d"
+                            " @%d ms...\n", sockDescriptor,
+                            (int32_t) cellularPortGetTickTimeMs());
+            pData->returnCode = cellularSockConnect(sockDescriptor,
+                                                    pData->pRemoteAddress);
+            cellularPortLog("CELLULAR_SOCK_TEST: socket descriptor %d connect"
+                            " returned %d @%d ms.\n", sockDescriptor,
+                            pData->returnCode,
+                            (int32_t) cellularPortGetTickTimeMs());
+            if ((cellularSockClose(sockDescriptor) < 0) &&
+                (pData->returnCode == 0)) {
+                pData->returnCode = -1;
+            }
+        } else {
+            pData->returnCode = sockDescriptor;
+        }
+        if (pData->returnCode < 0) {
+            pData->errorNumber = cellularPort_errno_get();
+        }
+    }
+    pData->timeMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+    pData->done = true;
+
+    // Delete ourself: only valid way out in Free RTOS
+    cellularPortTaskDelete(NULL);
+}
+
+// Task to connect a TCP socket after a delay, leaving it
+// open in sockDescriptor.
+static void delayedConnectTask(void *pParameters)
+{
+    CellularSockTestConcurrentTaskData_t *pData;
+
+    pData = (CellularSockTestConcurrentTaskData_t *) pParameters;
+
+    cellularPortTaskBlock(pData->timeMs);
+    pData->sockDescriptor = cellularSockCreate(CELLULAR_SOCK_TYPE_STREAM,
+                                               CELLULAR_SOCK_PROTOCOL_TCP);
+    pData->returnCode = pData->sockDescriptor;
+    if (pData->sockDescriptor >= 0) {
+        cellularPortLog("CELLULAR_SOCK_TEST: connecting socket descriptor %d"
+                        " @%d ms...\n", pData->sockDescriptor,
+                        (int32_t) cellularPortGetTickTimeMs());
+        pData->returnCode = cellularSockConnect(pData->sockDescriptor,
+                                                pData->pRemoteAddress);
+    }
+    if (pData->returnCode < 0) {
+        pData->errorNumber = cellularPort_errno_get();
+    }
+    pData->done = true;
+
+    // Delete ourself: only valid way out in Free RTOS
+    cellularPortTaskDelete(NULL);
+}
+
 // Wait for the spawned task to finish
 static void asyncTestTaskJoin(int32_t timeoutSeconds,
                               CellularPortMutexHandle_t mutexHandle,
@@ -1069,6 +1252,43 @@ static void setBool(void *pParam)
     }
 }
 
+// Increment the int32_t that the parameter points to.
+static void incrementInt(void *pParam)
+{
+    (*((volatile int32_t *) pParam))++;
+}
+
+// Receiver for cellularSockRegisterReceiver(): copy what
+// arrives into the buffer of the CellularSockTestReceiverData_t
+// that the parameter points to.
+static CellularSockReceiverAction_t testReceiver(CellularSockDescriptor_t descriptor,
+                                                 const char *pData,
+                                                 size_t dataSizeBytes,
+                                                 void *pParam)
+{
+    CellularSockTestReceiverData_t *pReceiverData = (CellularSockTestReceiverData_t *) pParam;
+    CellularSockReceiverAction_t action = CELLULAR_SOCK_RECEIVER_CONTINUE;
+
+    if (descriptor != pReceiverData->sockDescriptor) {
+        pReceiverData->wrongDescriptor = true;
+    }
+    if (dataSizeBytes > pReceiverData->sizeBytes - pReceiverData->offset) {
+        dataSizeBytes = pReceiverData->sizeBytes - pReceiverData->offset;
+    }
+    pCellularPort_memcpy(pReceiverData->pBuffer +
+                         CELLULAR_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES +
+                         pReceiverData->offset,
+                         pData, dataSizeBytes);
+    pReceiverData->offset += dataSizeBytes;
+    pReceiverData->numCalls++;
+    if (pReceiverData->pause) {
+        pReceiverData->pause = false;
+        action = CELLULAR_SOCK_RECEIVER_PAUSE;
+    }
+
+    return action;
+}
+
 // Check getting an option.
 static void checkGetOption(CellularSockDescriptor_t sockDescriptor,
                            int32_t level,
@@ -1179,6 +1399,104 @@ static void checkSetOption(CellularSockDescriptor_t sockDescriptor,
     cellularPort_free(pValueRead);
 }
 
+// Send some data on a connected TCP socket and check
+// that it comes back
+static bool tcpEchoCheck(CellularSockDescriptor_t sockDescriptor)
+{
+    bool success = false;
+    char *pDataReceived;
+    size_t offset = 0;
+    int32_t x;
+    int64_t startTimeMs;
+
+    pDataReceived = (char *) pCellularPort_malloc(sizeof(gSendData) - 1 +
+                                                  (CELLULAR_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+    if (pDataReceived != NULL) {
+        pCellularPort_memset(pDataReceived,
+                            CELLULAR_SOCK_TEST_FILL_CHARACTER,
+                            sizeof(gSendData) - 1 + (CELLULAR_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+        if (sendTcp(sockDescriptor, gSendData,
+                    sizeof(gSendData) - 1) == sizeof(gSendData) - 1) {
+            startTimeMs = cellularPortGetTickTimeMs();
+            while ((offset < sizeof(gSendData) - 1) &&
+                   (cellularPortGetTickTimeMs() - startTimeMs < 20000)) {
+                x = cellularSockRead(sockDescriptor,
+                                     pDataReceived + offset +
+                                     CELLULAR_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES,
+                                     sizeof(gSendData) - 1 - offset);
+                if (x > 0) {
+                    offset += x;
+                }
+            }
+            cellularPort_errno_set(0);
+        }
+        success = checkAgainstSentData(gSendData, sizeof(gSendData) - 1,
+                                       pDataReceived, offset);
+        cellularPort_free(pDataReceived);
+    }
+
+    return success;
+}
+
+// Read back the TCP echo of data that has already been sent,
+// checking that it is all present and correct.
+static bool tcpEchoReceive(CellularSockDescriptor_t sockDescriptor,
+                           const char *pDataSent, size_t sizeBytes)
+{
+    bool success = false;
+    char *pDataReceived;
+    size_t offset = 0;
+    int32_t x;
+    int64_t startTimeMs;
+
+    pDataReceived = (char *) pCellularPort_malloc(sizeBytes +
+                                                  (CELLULAR_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+    if (pDataReceived != NULL) {
+        pCellularPort_memset(pDataReceived,
+                            CELLULAR_SOCK_TEST_FILL_CHARACTER,
+                            sizeBytes + (CELLULAR_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+        startTimeMs = cellularPortGetTickTimeMs();
+        while ((offset < sizeBytes) &&
+               (cellularPortGetTickTimeMs() - startTimeMs < 20000)) {
+            x = cellularSockRead(sockDescriptor,
+                                 pDataReceived + offset +
+                                 CELLULAR_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES,
+                                 sizeBytes - offset);
+            if (x > 0) {
+                offset += x;
+            }
+        }
+        cellularPort_errno_set(0);
+        success = checkAgainstSentData(pDataSent, sizeBytes,
+                                       pDataReceived, offset);
+        cellularPort_free(pDataReceived);
+    }
+
+    return success;
+}
+
+// Task to keep the AT interface busy with TCP echoes for
+// timeMs, setting returnCode to -1 if any of them fail.
+static void echoPumpTask(void *pParameters)
+{
+    CellularSockTestConcurrentTaskData_t *pData;
+    int64_t startTimeMs;
+
+    pData = (CellularSockTestConcurrentTaskData_t *) pParameters;
+
+    startTimeMs = cellularPortGetTickTimeMs();
+    while ((pData->returnCode == 0) &&
+           (cellularPortGetTickTimeMs() - startTimeMs < pData->timeMs)) {
+        if (!tcpEchoCheck(pData->sockDescriptor)) {
+            pData->returnCode = -1;
+        }
+    }
+    pData->done = true;
+
+    // Delete ourself: only valid way out in Free RTOS
+    cellularPortTaskDelete(NULL);
+}
+
 // Release OS resources that may have been left hanging
 // by a failed test
 static void osCleanup()
@@ -1284,7 +1602,7 @@ CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestAddressStrings(),
                                     cellularPort_strlen(buffer));
                 }
                 cellularPortLog(".\n");
-                CELLULAR_PORT_TEST_ASSERT(errorCode == cellularPort_strlen(buffer));
+                CELLULAR_PORT_TEST_ASSERT(errorCode == (int32_t) cellularPort_strlen(buffer));
                 CELLULAR_PORT_TEST_ASSERT(cellularPort_strcmp(gTestAddressList[x].pAddressString,
                                                               buffer) == 0);
             } else {
@@ -1301,7 +1619,7 @@ CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestAddressStrings(),
                                     cellularPort_strlen(buffer));
                 }
                 cellularPortLog(".\n");
-                CELLULAR_PORT_TEST_ASSERT(errorCode == cellularPort_strlen(buffer));
+                CELLULAR_PORT_TEST_ASSERT(errorCode == (int32_t) cellularPort_strlen(buffer));
                 CELLULAR_PORT_TEST_ASSERT(cellularPort_strcmp(gTestAddressList[x].pAddressString,
                                                               buffer) == 0);
             }
@@ -1438,6 +1756,7 @@ CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestTcpEchoBasic(),
     CellularSockAddress_t address;
     CellularSockDescriptor_t sockDescriptor;
     bool dataCallbackCalled;
+    CellularSockStats_t stats;
     int32_t errorCode;
     size_t sizeBytes;
     size_t offset;
@@ -1504,7 +1823,7 @@ CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestTcpEchoBasic(),
             sizeBytes = sizeof(gSendData) - 1 - offset;
         }
         if (sendTcp(sockDescriptor,
-                    gSendData + offset, sizeBytes) == sizeBytes) {
+                    gSendData + offset, sizeBytes) == (int32_t) sizeBytes) {
             offset += sizeBytes;
         }
         x++;
@@ -1549,6 +1868,15 @@ CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestTcpEchoBasic(),
     CELLULAR_PORT_TEST_ASSERT(checkAgainstSentData(gSendData, sizeof(gSendData) - 1,
                                                    pDataReceived, sizeBytes));
 
+    // The data callback must have been called, though not
+    // necessarily for every +UUSORD since those are coalesced
+    CELLULAR_PORT_TEST_ASSERT(dataCallbackCalled);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetStats(sockDescriptor, &stats) == 0);
+    cellularPortLog("CELLULAR_SOCK_TEST: %d URC(s), %d data callback(s).\n",
+                    stats.numUrcs, stats.numDataCallbacks);
+    CELLULAR_PORT_TEST_ASSERT(stats.numDataCallbacks > 0);
+    CELLULAR_PORT_TEST_ASSERT(stats.numDataCallbacks <= stats.numUrcs);
+
     cellularPortLog("CELLULAR_SOCK_TEST: shutting down socket for read...\n");
     errorCode = cellularSockShutdown(sockDescriptor,
                                      CELLULAR_SOCK_SHUTDOWN_READ);
@@ -1993,6 +2321,19 @@ CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestNonBlocking(),
     CELLULAR_PORT_TEST_ASSERT(elapsedMs >= timeoutMs);
     CELLULAR_PORT_TEST_ASSERT(elapsedMs < timeoutMs + CELLULAR_SOCK_TEST_TIME_MARGIN_MS);
 
+    cellularPortLog("CELLULAR_SOCK_TEST: get the number of bytes waiting"
+                    " using cellularSockIoctl()...\n");
+    value = -1;
+    returnCode = cellularSockIoctl(sockDescriptor,
+                                   CELLULAR_SOCK_IOCTL_GET_NREAD,
+                                   &value);
+    cellularPortLog("CELLULAR_SOCK_TEST: cellularSockIoctl() with"
+                    " CELLULAR_SOCK_IOCTL_GET_NREAD returned %d, value %d,"
+                    " errno %d.\n", returnCode, value, cellularPort_errno_get());
+    CELLULAR_PORT_TEST_ASSERT(returnCode == 0);
+    CELLULAR_PORT_TEST_ASSERT(value == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == 0);
+
     cellularPortLog("CELLULAR_SOCK_TEST: set non-blocking state using cellularSockIoctl()...\n");
     value = 1;
     returnCode = cellularSockIoctl(sockDescriptor,
@@ -2203,6 +2544,172 @@ CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestUdpEchoNonPingPong(),
     stdDataTestDeinit(sockDescriptor);
 }
 
+/** UDP echo test that throws up multiple packets with
+ * cellularSockSendToMulti() and then receives them with
+ * cellularSockReceiveFromMulti().
+ */
+CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestUdpEchoMulti(),
+                            "sockUdpEchoMulti",
+                            "sock")
+{
+    CellularSockAddress_t remoteAddress;
+    CellularSockDescriptor_t sockDescriptor;
+    CellularSockDatagram_t datagrams[CELLULAR_SOCK_TEST_MULTI_NUM_DATAGRAMS];
+    bool allPacketsReceived;
+    bool success;
+    int32_t tries = 0;
+    int32_t sizeBytes = 0;
+    size_t offset;
+    int32_t numCalls;
+    int32_t numDatagrams;
+    int32_t x;
+    char *pDataReceived;
+    char *pBuffers;
+    int64_t startTimeMs;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    stdDataTestInit(CELLULAR_CFG_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_UDP_SERVER_PORT,
+                    &remoteAddress,
+                    CELLULAR_SOCK_TYPE_DGRAM,
+                    CELLULAR_SOCK_PROTOCOL_UDP,
+                    &sockDescriptor);
+
+    cellularPortLog("CELLULAR_SOCK_TEST: check that bad parameters are rejected...\n");
+    CELLULAR_PORT_TEST_ASSERT(cellularSockSendToMulti(sockDescriptor, NULL, 1) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EINVAL);
+    cellularPort_errno_set(0);
+    pCellularPort_memset(datagrams, 0, sizeof(datagrams));
+    datagrams[0].dataSizeBytes = 1;
+    CELLULAR_PORT_TEST_ASSERT(cellularSockSendToMulti(sockDescriptor, datagrams, 1) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EINVAL);
+    cellularPort_errno_set(0);
+    datagrams[0].pData = (void *) gSendData;
+    datagrams[0].dataSizeBytes = CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES + 1;
+    CELLULAR_PORT_TEST_ASSERT(cellularSockSendToMulti(sockDescriptor, datagrams, 1) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EMSGSIZE);
+    cellularPort_errno_set(0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockReceiveFromMulti(sockDescriptor, NULL, 1) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EINVAL);
+    cellularPort_errno_set(0);
+    pCellularPort_memset(datagrams, 0, sizeof(datagrams));
+    CELLULAR_PORT_TEST_ASSERT(cellularSockReceiveFromMulti(sockDescriptor, datagrams, 1) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EINVAL);
+    cellularPort_errno_set(0);
+
+    // A buffer for each datagram
+    pBuffers = (char *) pCellularPort_malloc(CELLULAR_SOCK_TEST_MULTI_NUM_DATAGRAMS *
+                                             CELLULAR_SOCK_TEST_MAX_UDP_PACKET_SIZE);
+    CELLULAR_PORT_TEST_ASSERT(pBuffers != NULL);
+
+    do {
+        // Reset errno 'cos we might retry and subsequent things might be upset by it
+        cellularPort_errno_set(0);
+        // Throw random sized UDP packets up, as many
+        // at a time as there are datagrams...
+        offset = 0;
+        x = 0;
+        while (offset < sizeof(gSendData) - 1) {
+            numDatagrams = 0;
+            sizeBytes = offset;
+            while ((numDatagrams < CELLULAR_SOCK_TEST_MULTI_NUM_DATAGRAMS) &&
+                   ((size_t) sizeBytes < sizeof(gSendData) - 1)) {
+                datagrams[numDatagrams].dataSizeBytes = (cellularPort_rand() %
+                                                         CELLULAR_SOCK_TEST_MAX_UDP_PACKET_SIZE) + 1;
+                datagrams[numDatagrams].dataSizeBytes = fix(datagrams[numDatagrams].dataSizeBytes,
+                                                            CELLULAR_SOCK_TEST_MAX_UDP_PACKET_SIZE);
+                if (sizeBytes + datagrams[numDatagrams].dataSizeBytes > sizeof(gSendData) - 1) {
+                    datagrams[numDatagrams].dataSizeBytes = sizeof(gSendData) - 1 - sizeBytes;
+                }
+                datagrams[numDatagrams].pData = (void *) (gSendData + sizeBytes);
+                datagrams[numDatagrams].sizeBytes = 0;
+                datagrams[numDatagrams].address = remoteAddress;
+                sizeBytes += datagrams[numDatagrams].dataSizeBytes;
+                numDatagrams++;
+            }
+            success = false;
+            for (size_t y = 0; !success && (y < CELLULAR_CFG_TEST_UDP_RETRIES); y++) {
+                cellularPortLog("CELLULAR_SOCK_TEST: sending UDP packets %d to %d"
+                                " in one go, send try %d.\n", x + 1,
+                                x + numDatagrams, y + 1);
+                if (cellularSockSendToMulti(sockDescriptor, datagrams,
+                                            numDatagrams) == numDatagrams) {
+                    success = true;
+                    for (int32_t z = 0; z < numDatagrams; z++) {
+                        CELLULAR_PORT_TEST_ASSERT(datagrams[z].sizeBytes ==
+                                                  datagrams[z].dataSizeBytes);
+                    }
+                    offset = sizeBytes;
+                } else {
+                    // Reset errno 'cos we're going to retry and subsequent things might be upset by it
+                    cellularPort_errno_set(0);
+                }
+            }
+            x += numDatagrams;
+            CELLULAR_PORT_TEST_ASSERT(success);
+        }
+        cellularPortLog("CELLULAR_SOCK_TEST: a total of %d UDP packet(s) sent, now receiving...\n", x);
+
+        // ...and capture them all again afterwards, as many
+        // at a time as have arrived
+        pDataReceived = (char *) pCellularPort_malloc(sizeof(gSendData) - 1 +
+                                                     (CELLULAR_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+        CELLULAR_PORT_TEST_ASSERT(pDataReceived != NULL);
+        pCellularPort_memset(pDataReceived, CELLULAR_SOCK_TEST_FILL_CHARACTER,
+                             sizeof(gSendData) - 1 + (CELLULAR_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+        startTimeMs = cellularPortGetTickTimeMs();
+        offset = 0;
+        numCalls = 0;
+        while ((offset < sizeof(gSendData) - 1) &&
+               (cellularPortGetTickTimeMs() - startTimeMs < 10000)) {
+            for (size_t y = 0; y < CELLULAR_SOCK_TEST_MULTI_NUM_DATAGRAMS; y++) {
+                datagrams[y].pData = pBuffers + (y * CELLULAR_SOCK_TEST_MAX_UDP_PACKET_SIZE);
+                datagrams[y].dataSizeBytes = CELLULAR_SOCK_TEST_MAX_UDP_PACKET_SIZE;
+                datagrams[y].sizeBytes = 0;
+            }
+            x = cellularSockReceiveFromMulti(sockDescriptor, datagrams,
+                                             CELLULAR_SOCK_TEST_MULTI_NUM_DATAGRAMS);
+            numCalls++;
+            if (x > 0) {
+                CELLULAR_PORT_TEST_ASSERT(x <= CELLULAR_SOCK_TEST_MULTI_NUM_DATAGRAMS);
+                cellularPortLog("CELLULAR_SOCK_TEST: received %d UDP packet(s) in one go.\n", x);
+                for (size_t y = 0; (y < (size_t) x) && (offset < sizeof(gSendData) - 1); y++) {
+                    sizeBytes = datagrams[y].sizeBytes;
+                    CELLULAR_PORT_TEST_ASSERT(sizeBytes <= CELLULAR_SOCK_TEST_MAX_UDP_PACKET_SIZE);
+                    CELLULAR_PORT_TEST_ASSERT(datagrams[y].address.port == remoteAddress.port);
+                    if (offset + sizeBytes > sizeof(gSendData) - 1) {
+                        sizeBytes = sizeof(gSendData) - 1 - offset;
+                    }
+                    pCellularPort_memcpy(pDataReceived + offset +
+                                         CELLULAR_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES,
+                                         datagrams[y].pData, sizeBytes);
+                    offset += sizeBytes;
+                }
+            } else {
+                cellularPort_errno_set(0);
+            }
+        }
+        sizeBytes = offset;
+        cellularPortLog("CELLULAR_SOCK_TEST: either received everything back in %d"
+                        " call(s) or timed out waiting.\n", numCalls);
+
+        // Check that we reassembled everything correctly
+        allPacketsReceived = checkAgainstSentData(gSendData, sizeof(gSendData) - 1,
+                                                  pDataReceived, sizeBytes);
+        cellularPort_free(pDataReceived);
+        tries++;
+    } while (!allPacketsReceived && (tries < CELLULAR_CFG_TEST_UDP_RETRIES));
+
+    cellularPort_free(pBuffers);
+
+    CELLULAR_PORT_TEST_ASSERT(allPacketsReceived);
+
+    stdDataTestDeinit(sockDescriptor);
+}
+
 /** UDP echo test that does asynchronous receive.
  */
 CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestUdpEchoAsyncMayMayFailDueToInternetDatagramDrop(),
@@ -2451,6 +2958,1881 @@ CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestTcpEchoAsync(),
     stdDataTestDeinit(params.sockDescriptor);
 }
 
+/** Test select(): multiplex all of the sockets the module supports
+ * from one task, measuring how long select() takes to wake up
+ * once the echoed data arrives.
+ */
+CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestSelect(),
+                            "sockSelect",
+                            "sock")
+{
+    CellularSockAddress_t remoteAddress;
+    CellularSockDescriptor_t sockDescriptor[CELLULAR_SOCK_MAX];
+    CellularSockDescriptor_t maxDescriptor = 0;
+    CellularSockDescriptorSet_t readSet;
+    CellularSockDescriptorSet_t writeSet;
+    char *pDataReceived;
+    int32_t errorCode;
+    int32_t sizeBytes;
+    int64_t startTimeMs;
+    int32_t wakeUpMs;
+    int32_t wakeUpMinMs = CELLULAR_SOCK_RECEIVE_TIMEOUT_DEFAULT_MS;
+    int32_t wakeUpMaxMs = 0;
+    int32_t wakeUpTotalMs = 0;
+    bool success;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    pDataReceived = (char *) pCellularPort_malloc(CELLULAR_SOCK_TEST_SELECT_DATA_SIZE_BYTES);
+    CELLULAR_PORT_TEST_ASSERT(pDataReceived != NULL);
+
+    // Do the standard preamble, which opens the first socket
+    stdDataTestInit(CELLULAR_CFG_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_UDP_SERVER_PORT,
+                    &remoteAddress,
+                    CELLULAR_SOCK_TYPE_DGRAM,
+                    CELLULAR_SOCK_PROTOCOL_UDP,
+                    &(sockDescriptor[0]));
+
+    // Open the rest
+    cellularPortLog("CELLULAR_SOCK_TEST: opening another %d socket(s).\n",
+                    CELLULAR_SOCK_MAX - 1);
+    for (size_t x = 1; x < CELLULAR_SOCK_MAX; x++) {
+        sockDescriptor[x] = cellularSockCreate(CELLULAR_SOCK_TYPE_DGRAM,
+                                               CELLULAR_SOCK_PROTOCOL_UDP);
+        CELLULAR_PORT_TEST_ASSERT(sockDescriptor[x] >= 0);
+        CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == 0);
+    }
+    for (size_t x = 0; x < CELLULAR_SOCK_MAX; x++) {
+        if (sockDescriptor[x] >= maxDescriptor) {
+            maxDescriptor = sockDescriptor[x] + 1;
+        }
+    }
+
+    // Nothing has been sent so nothing should be readable
+    // while all of the UDP sockets should be writable
+    CELLULAR_SOCK_FD_ZERO(&readSet);
+    CELLULAR_SOCK_FD_ZERO(&writeSet);
+    for (size_t x = 0; x < CELLULAR_SOCK_MAX; x++) {
+        CELLULAR_SOCK_FD_SET(sockDescriptor[x], &readSet);
+        CELLULAR_SOCK_FD_SET(sockDescriptor[x], &writeSet);
+    }
+    errorCode = cellularSockSelect(maxDescriptor, &readSet, &writeSet, NULL, 0);
+    cellularPortLog("CELLULAR_SOCK_TEST: cellularSockSelect() with zero timeout"
+                    " returned %d.\n", errorCode);
+    CELLULAR_PORT_TEST_ASSERT(errorCode == CELLULAR_SOCK_MAX);
+    for (size_t x = 0; x < CELLULAR_SOCK_MAX; x++) {
+        CELLULAR_PORT_TEST_ASSERT(!CELLULAR_SOCK_FD_ISSET(sockDescriptor[x], &readSet));
+        CELLULAR_PORT_TEST_ASSERT(CELLULAR_SOCK_FD_ISSET(sockDescriptor[x], &writeSet));
+    }
+
+    // Waiting to read should time out
+    CELLULAR_SOCK_FD_ZERO(&readSet);
+    for (size_t x = 0; x < CELLULAR_SOCK_MAX; x++) {
+        CELLULAR_SOCK_FD_SET(sockDescriptor[x], &readSet);
+    }
+    startTimeMs = cellularPortGetTickTimeMs();
+    errorCode = cellularSockSelect(maxDescriptor, &readSet, NULL, NULL,
+                                   CELLULAR_SOCK_TEST_NON_BLOCKING_TIME_MS);
+    wakeUpMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+    cellularPortLog("CELLULAR_SOCK_TEST: cellularSockSelect() with %d ms timeout"
+                    " returned %d after %d ms.\n",
+                    CELLULAR_SOCK_TEST_NON_BLOCKING_TIME_MS, errorCode, wakeUpMs);
+    CELLULAR_PORT_TEST_ASSERT(errorCode == 0);
+    CELLULAR_PORT_TEST_ASSERT(wakeUpMs > CELLULAR_SOCK_TEST_NON_BLOCKING_TIME_MS -
+                                         CELLULAR_SOCK_TEST_TIME_MARGIN_MS);
+    CELLULAR_PORT_TEST_ASSERT(wakeUpMs < CELLULAR_SOCK_TEST_NON_BLOCKING_TIME_MS +
+                                         CELLULAR_SOCK_TEST_TIME_MARGIN_MS);
+    for (size_t x = 0; x < CELLULAR_SOCK_MAX; x++) {
+        CELLULAR_PORT_TEST_ASSERT(!CELLULAR_SOCK_FD_ISSET(sockDescriptor[x], &readSet));
+    }
+
+    // Now send on each socket in turn and wait for the echo
+    // in select() on all of them
+    for (size_t x = 0; x < CELLULAR_SOCK_MAX; x++) {
+        success = false;
+        // Retry this a few times, don't want to fail due to a flaky link
+        for (size_t y = 0; !success && (y < CELLULAR_CFG_TEST_UDP_RETRIES); y++) {
+            sizeBytes = cellularSockSendTo(sockDescriptor[x], &remoteAddress,
+                                           (void *) gSendData,
+                                           CELLULAR_SOCK_TEST_SELECT_DATA_SIZE_BYTES);
+            startTimeMs = cellularPortGetTickTimeMs();
+            if (sizeBytes == CELLULAR_SOCK_TEST_SELECT_DATA_SIZE_BYTES) {
+                CELLULAR_SOCK_FD_ZERO(&readSet);
+                for (size_t z = 0; z < CELLULAR_SOCK_MAX; z++) {
+                    CELLULAR_SOCK_FD_SET(sockDescriptor[z], &readSet);
+                }
+                errorCode = cellularSockSelect(maxDescriptor, &readSet, NULL, NULL,
+                                               CELLULAR_SOCK_RECEIVE_TIMEOUT_DEFAULT_MS);
+                wakeUpMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+                cellularPortLog("CELLULAR_SOCK_TEST: socket %d, try %d, cellularSockSelect()"
+                                " returned %d %d ms after sending.\n",
+                                sockDescriptor[x], y + 1, errorCode, wakeUpMs);
+                if (errorCode > 0) {
+                    // Only the socket that was sent on should be readable
+                    CELLULAR_PORT_TEST_ASSERT(errorCode == 1);
+                    for (size_t z = 0; z < CELLULAR_SOCK_MAX; z++) {
+                        CELLULAR_PORT_TEST_ASSERT((CELLULAR_SOCK_FD_ISSET(sockDescriptor[z],
+                                                                          &readSet) != 0) ==
+                                                  (z == x));
+                    }
+                    sizeBytes = cellularSockReceiveFrom(sockDescriptor[x], NULL,
+                                                        pDataReceived,
+                                                        CELLULAR_SOCK_TEST_SELECT_DATA_SIZE_BYTES);
+                    CELLULAR_PORT_TEST_ASSERT(sizeBytes == CELLULAR_SOCK_TEST_SELECT_DATA_SIZE_BYTES);
+                    CELLULAR_PORT_TEST_ASSERT(cellularPort_memcmp(pDataReceived, gSendData,
+                                                                  sizeBytes) == 0);
+                    // Having read the data the socket should no longer be readable
+                    CELLULAR_SOCK_FD_ZERO(&readSet);
+                    CELLULAR_SOCK_FD_SET(sockDescriptor[x], &readSet);
+                    CELLULAR_PORT_TEST_ASSERT(cellularSockSelect(maxDescriptor, &readSet,
+                                                                 NULL, NULL, 0) == 0);
+                    if (wakeUpMs < wakeUpMinMs) {
+                        wakeUpMinMs = wakeUpMs;
+                    }
+                    if (wakeUpMs > wakeUpMaxMs) {
+                        wakeUpMaxMs = wakeUpMs;
+                    }
+                    wakeUpTotalMs += wakeUpMs;
+                    success = true;
+                }
+            } else {
+                // Reset errno 'cos we're going to retry and subsequent things might be upset by it
+                cellularPort_errno_set(0);
+            }
+        }
+        CELLULAR_PORT_TEST_ASSERT(success);
+    }
+    cellularPortLog("CELLULAR_SOCK_TEST: from send to cellularSockSelect() waking up on"
+                    " the echo took min %d ms, average %d ms, max %d ms (includes the"
+                    " round trip to the echo server).\n", wakeUpMinMs,
+                    wakeUpTotalMs / CELLULAR_SOCK_MAX, wakeUpMaxMs);
+
+    // Close all but the first, which stdDataTestDeinit() closes,
+    // and check that select() then rejects a closed descriptor
+    for (size_t x = 1; x < CELLULAR_SOCK_MAX; x++) {
+        CELLULAR_PORT_TEST_ASSERT(cellularSockClose(sockDescriptor[x]) == 0);
+    }
+    CELLULAR_SOCK_FD_ZERO(&readSet);
+    CELLULAR_SOCK_FD_SET(sockDescriptor[1], &readSet);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockSelect(maxDescriptor, &readSet,
+                                                 NULL, NULL, 0) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EBADF);
+    cellularPort_errno_set(0);
+
+    cellularPort_free(pDataReceived);
+
+    stdDataTestDeinit(sockDescriptor[0]);
+}
+
+/** Test TCP server operation: listen on a local port, have
+ * several clients connect to it at once, accept them all,
+ * timing how long each accept takes, and exchange data.
+ */
+CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestTcpServer(),
+                            "sockTcpServer",
+                            "sock")
+{
+    CellularSockAddress_t localAddress;
+    CellularSockAddress_t address;
+    CellularSockDescriptor_t listeningDescriptor;
+    CellularSockDescriptor_t clientDescriptor[CELLULAR_SOCK_TEST_TCP_SERVER_NUM_CLIENTS];
+    CellularSockDescriptor_t acceptedDescriptor[CELLULAR_SOCK_TEST_TCP_SERVER_NUM_CLIENTS];
+    CellularSockDescriptorSet_t readSet;
+    CellularSockTestConcurrentTaskData_t connectData;
+    CellularPortTaskHandle_t taskHandle;
+    char buffer[CELLULAR_CTRL_IP_ADDRESS_SIZE];
+    char *pDataReceived;
+    int32_t errorCode;
+    int32_t sizeBytes;
+    size_t offset;
+    int64_t startTimeMs;
+    int32_t acceptMs;
+    int32_t acceptMinMs = CELLULAR_SOCK_RECEIVE_TIMEOUT_DEFAULT_MS;
+    int32_t acceptMaxMs = 0;
+    int32_t acceptTotalMs = 0;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    pDataReceived = (char *) pCellularPort_malloc(CELLULAR_SOCK_TEST_SELECT_DATA_SIZE_BYTES);
+    CELLULAR_PORT_TEST_ASSERT(pDataReceived != NULL);
+
+    // Do the standard preamble, which opens the socket
+    // that will become the listening socket
+    stdDataTestInit(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT,
+                    &address,
+                    CELLULAR_SOCK_TYPE_STREAM,
+                    CELLULAR_SOCK_PROTOCOL_TCP,
+                    &listeningDescriptor);
+
+    // The clients connect to our own IP address
+    CELLULAR_PORT_TEST_ASSERT(cellularCtrlGetIpAddressStr(buffer) > 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockStringToAddress(buffer,
+                                                          &localAddress) == 0);
+    localAddress.port = CELLULAR_CFG_TEST_LOCAL_PORT;
+
+    cellularPortLog("CELLULAR_SOCK_TEST: check that accept and listen fail"
+                    " before binding...\n");
+    CELLULAR_PORT_TEST_ASSERT(cellularSockAccept(listeningDescriptor, NULL) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EINVAL);
+    cellularPort_errno_set(0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockListen(listeningDescriptor,
+                                                 CELLULAR_SOCK_TEST_TCP_SERVER_NUM_CLIENTS) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EDESTADDRREQ);
+    cellularPort_errno_set(0);
+
+    cellularPortLog("CELLULAR_SOCK_TEST: listening on port %d...\n",
+                    localAddress.port);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockBind(listeningDescriptor,
+                                               &localAddress) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockListen(listeningDescriptor,
+                                                 CELLULAR_SOCK_TEST_TCP_SERVER_NUM_CLIENTS) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetLocalAddress(listeningDescriptor,
+                                                          &address) == 0);
+    CELLULAR_PORT_TEST_ASSERT(address.port == localAddress.port);
+
+    // Nothing waiting so a non-blocking accept should
+    // return immediately and select should see nothing
+    CELLULAR_PORT_TEST_ASSERT(cellularSockFcntl(listeningDescriptor,
+                                                CELLULAR_SOCK_FCNTL_SET_STATUS,
+                                                CELLULAR_SOCK_FCNTL_STATUS_NONBLOCK) == 0);
+    startTimeMs = cellularPortGetTickTimeMs();
+    CELLULAR_PORT_TEST_ASSERT(cellularSockAccept(listeningDescriptor, NULL) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EWOULDBLOCK);
+    CELLULAR_PORT_TEST_ASSERT(cellularPortGetTickTimeMs() - startTimeMs <
+                              CELLULAR_SOCK_TEST_TIME_MARGIN_MS);
+    cellularPort_errno_set(0);
+    CELLULAR_SOCK_FD_ZERO(&readSet);
+    CELLULAR_SOCK_FD_SET(listeningDescriptor, &readSet);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockSelect(listeningDescriptor + 1, &readSet,
+                                                 NULL, NULL, 0) == 0);
+
+    // Block in accept with nothing waiting: it should
+    // return when a client, connecting later, arrives
+    CELLULAR_PORT_TEST_ASSERT(cellularSockFcntl(listeningDescriptor,
+                                                CELLULAR_SOCK_FCNTL_SET_STATUS,
+                                                0) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockFcntl(listeningDescriptor,
+                                                CELLULAR_SOCK_FCNTL_GET_STATUS,
+                                                0) == 0);
+    pCellularPort_memset(&connectData, 0, sizeof(connectData));
+    connectData.sockDescriptor = -1;
+    connectData.pRemoteAddress = &localAddress;
+    connectData.timeMs = CELLULAR_SOCK_TEST_TCP_SERVER_CONNECT_DELAY_MS;
+    CELLULAR_PORT_TEST_ASSERT(cellularPortTaskCreate(delayedConnectTask,
+                                                     "testTaskConnect",
+                                                     CELLULAR_PORT_TEST_SOCK_TASK_STACK_SIZE_BYTES,
+                                                     (void *) &connectData,
+                                                     CELLULAR_PORT_TEST_SOCK_TASK_PRIORITY,
+                                                     &taskHandle) == 0);
+    cellularPortLog("CELLULAR_SOCK_TEST: blocking in accept, a client will"
+                    " connect in %d ms...\n",
+                    CELLULAR_SOCK_TEST_TCP_SERVER_CONNECT_DELAY_MS);
+    startTimeMs = cellularPortGetTickTimeMs();
+    acceptedDescriptor[0] = cellularSockAccept(listeningDescriptor, NULL);
+    acceptMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+    cellularPortLog("CELLULAR_SOCK_TEST: cellularSockAccept() returned %d"
+                    " after %d ms, errno %d.\n", acceptedDescriptor[0],
+                    acceptMs, cellularPort_errno_get());
+    CELLULAR_PORT_TEST_ASSERT(acceptedDescriptor[0] >= 0);
+    CELLULAR_PORT_TEST_ASSERT(acceptMs >= CELLULAR_SOCK_TEST_TCP_SERVER_CONNECT_DELAY_MS -
+                                          CELLULAR_SOCK_TEST_TIME_MARGIN_MS);
+    CELLULAR_PORT_TEST_ASSERT(acceptMs < CELLULAR_SOCK_RECEIVE_TIMEOUT_DEFAULT_MS);
+    startTimeMs = cellularPortGetTickTimeMs();
+    while (!connectData.done &&
+           (cellularPortGetTickTimeMs() - startTimeMs <
+            CELLULAR_SOCK_RECEIVE_TIMEOUT_DEFAULT_MS)) {
+        cellularPortTaskBlock(CELLULAR_SOCK_TEST_TIME_MARGIN_MS);
+    }
+    CELLULAR_PORT_TEST_ASSERT(connectData.done);
+    CELLULAR_PORT_TEST_ASSERT(connectData.returnCode == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockClose(acceptedDescriptor[0]) == 0);
+    if (cellularSockClose(connectData.sockDescriptor) < 0) {
+        CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EBADF);
+    }
+    cellularPort_errno_set(0);
+    // Allow the task to be deleted
+    cellularPortTaskBlock(CELLULAR_SOCK_TEST_TIME_MARGIN_MS);
+
+    // Connect all of the clients before accepting any
+    // of them, so that the connections queue up
+    cellularPortLog("CELLULAR_SOCK_TEST: connecting %d client(s)...\n",
+                    CELLULAR_SOCK_TEST_TCP_SERVER_NUM_CLIENTS);
+    for (size_t x = 0; x < CELLULAR_SOCK_TEST_TCP_SERVER_NUM_CLIENTS; x++) {
+        clientDescriptor[x] = cellularSockCreate(CELLULAR_SOCK_TYPE_STREAM,
+                                                 CELLULAR_SOCK_PROTOCOL_TCP);
+        CELLULAR_PORT_TEST_ASSERT(clientDescriptor[x] >= 0);
+        errorCode = cellularSockConnect(clientDescriptor[x], &localAddress);
+        cellularPortLog("CELLULAR_SOCK_TEST: client %d, cellularSockConnect()"
+                        " returned %d, errno %d.\n", x, errorCode,
+                        cellularPort_errno_get());
+        CELLULAR_PORT_TEST_ASSERT(errorCode == 0);
+    }
+
+    // The listening socket should now be readable
+    CELLULAR_SOCK_FD_ZERO(&readSet);
+    CELLULAR_SOCK_FD_SET(listeningDescriptor, &readSet);
+    errorCode = cellularSockSelect(listeningDescriptor + 1, &readSet, NULL, NULL,
+                                   CELLULAR_SOCK_RECEIVE_TIMEOUT_DEFAULT_MS);
+    CELLULAR_PORT_TEST_ASSERT(errorCode == 1);
+    CELLULAR_PORT_TEST_ASSERT(CELLULAR_SOCK_FD_ISSET(listeningDescriptor, &readSet));
+
+    // Accept them all, blocking (as set above), timing each one
+    for (size_t x = 0; x < CELLULAR_SOCK_TEST_TCP_SERVER_NUM_CLIENTS; x++) {
+        pCellularPort_memset(&address, 0, sizeof(address));
+        startTimeMs = cellularPortGetTickTimeMs();
+        acceptedDescriptor[x] = cellularSockAccept(listeningDescriptor, &address);
+        acceptMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+        cellularPortLog("CELLULAR_SOCK_TEST: cellularSockAccept() returned %d"
+                        " after %d ms, errno %d, remote address ",
+                        acceptedDescriptor[x], acceptMs, cellularPort_errno_get());
+        printAddress(&address, true);
+        cellularPortLog(".\n");
+        CELLULAR_PORT_TEST_ASSERT(acceptedDescriptor[x] >= 0);
+        CELLULAR_PORT_TEST_ASSERT(address.port > 0);
+        if (acceptMs < acceptMinMs) {
+            acceptMinMs = acceptMs;
+        }
+        if (acceptMs > acceptMaxMs) {
+            acceptMaxMs = acceptMs;
+        }
+        acceptTotalMs += acceptMs;
+    }
+    cellularPortLog("CELLULAR_SOCK_TEST: accepting a queued connection took min %d ms,"
+                    " average %d ms, max %d ms.\n", acceptMinMs,
+                    acceptTotalMs / CELLULAR_SOCK_TEST_TCP_SERVER_NUM_CLIENTS,
+                    acceptMaxMs);
+
+    // All accepted: a non-blocking accept should say so
+    CELLULAR_PORT_TEST_ASSERT(cellularSockFcntl(listeningDescriptor,
+                                                CELLULAR_SOCK_FCNTL_SET_STATUS,
+                                                CELLULAR_SOCK_FCNTL_STATUS_NONBLOCK) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockAccept(listeningDescriptor, NULL) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EWOULDBLOCK);
+    cellularPort_errno_set(0);
+
+    // Send from each client and read the data back on the
+    // accepted sockets; the order of accepting need not be
+    // the order of connecting so read from whichever has it
+    for (size_t x = 0; x < CELLULAR_SOCK_TEST_TCP_SERVER_NUM_CLIENTS; x++) {
+        CELLULAR_PORT_TEST_ASSERT(cellularSockWrite(clientDescriptor[x],
+                                                    gSendData + x,
+                                                    CELLULAR_SOCK_TEST_SELECT_DATA_SIZE_BYTES) ==
+                                  CELLULAR_SOCK_TEST_SELECT_DATA_SIZE_BYTES);
+    }
+    for (size_t x = 0; x < CELLULAR_SOCK_TEST_TCP_SERVER_NUM_CLIENTS; x++) {
+        offset = 0;
+        startTimeMs = cellularPortGetTickTimeMs();
+        while ((offset < CELLULAR_SOCK_TEST_SELECT_DATA_SIZE_BYTES) &&
+               (cellularPortGetTickTimeMs() - startTimeMs <
+                CELLULAR_SOCK_RECEIVE_TIMEOUT_DEFAULT_MS)) {
+            sizeBytes = cellularSockRead(acceptedDescriptor[x],
+                                         pDataReceived + offset,
+                                         CELLULAR_SOCK_TEST_SELECT_DATA_SIZE_BYTES - offset);
+            if (sizeBytes > 0) {
+                offset += sizeBytes;
+            }
+        }
+        cellularPortLog("CELLULAR_SOCK_TEST: %d byte(s) received on accepted socket %d.\n",
+                        offset, acceptedDescriptor[x]);
+        CELLULAR_PORT_TEST_ASSERT(offset == CELLULAR_SOCK_TEST_SELECT_DATA_SIZE_BYTES);
+        // Find which client it came from
+        errorCode = -1;
+        for (size_t y = 0; (errorCode < 0) &&
+                           (y < CELLULAR_SOCK_TEST_TCP_SERVER_NUM_CLIENTS); y++) {
+            if (cellularPort_memcmp(pDataReceived, gSendData + y, offset) == 0) {
+                errorCode = (int32_t) y;
+            }
+        }
+        CELLULAR_PORT_TEST_ASSERT(errorCode >= 0);
+        // Send it back to that client
+        CELLULAR_PORT_TEST_ASSERT(cellularSockWrite(acceptedDescriptor[x],
+                                                    pDataReceived, offset) ==
+                                  (int32_t) offset);
+        offset = 0;
+        startTimeMs = cellularPortGetTickTimeMs();
+        while ((offset < CELLULAR_SOCK_TEST_SELECT_DATA_SIZE_BYTES) &&
+               (cellularPortGetTickTimeMs() - startTimeMs <
+                CELLULAR_SOCK_RECEIVE_TIMEOUT_DEFAULT_MS)) {
+            sizeBytes = cellularSockRead(clientDescriptor[errorCode],
+                                         pDataReceived + offset,
+                                         CELLULAR_SOCK_TEST_SELECT_DATA_SIZE_BYTES - offset);
+            if (sizeBytes > 0) {
+                offset += sizeBytes;
+            }
+        }
+        CELLULAR_PORT_TEST_ASSERT(offset == CELLULAR_SOCK_TEST_SELECT_DATA_SIZE_BYTES);
+        CELLULAR_PORT_TEST_ASSERT(cellularPort_memcmp(pDataReceived, gSendData + errorCode,
+                                                      offset) == 0);
+    }
+    cellularPort_errno_set(0);
+
+    // Close the lot; closing one end of a connection may
+    // close the other before we get to it, in which case
+    // the descriptor is no longer valid
+    for (size_t x = 0; x < CELLULAR_SOCK_TEST_TCP_SERVER_NUM_CLIENTS; x++) {
+        CELLULAR_PORT_TEST_ASSERT(cellularSockClose(acceptedDescriptor[x]) == 0);
+        if (cellularSockClose(clientDescriptor[x]) < 0) {
+            CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EBADF);
+            cellularPort_errno_set(0);
+        }
+    }
+
+    cellularPort_free(pDataReceived);
+
+    stdDataTestDeinit(listeningDescriptor);
+}
+
+/** Test the DNS cache: a look-up of a host name that has been
+ * looked up before should not go to the module, nor should a
+ * repeat look-up of a host name that could not be resolved.
+ */
+CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestDnsCache(),
+                            "sockDnsCache",
+                            "sock")
+{
+    CellularSockAddress_t remoteAddress;
+    CellularSockAddress_t address;
+    CellularSockDescriptor_t sockDescriptor;
+    CellularSockDnsCacheStats_t stats;
+    int64_t startTimeMs;
+    int32_t missMs;
+    int32_t hitMs;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    // Do the standard preamble, which looks up the
+    // UDP echo server and so puts it in the cache
+    stdDataTestInit(CELLULAR_CFG_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_UDP_SERVER_PORT,
+                    &remoteAddress,
+                    CELLULAR_SOCK_TYPE_DGRAM,
+                    CELLULAR_SOCK_PROTOCOL_UDP,
+                    &sockDescriptor);
+    cellularSockResetDnsCacheStats();
+
+    cellularPortLog("CELLULAR_SOCK_TEST: looking up \"%s\" again...\n",
+                    CELLULAR_CFG_TEST_ECHO_UDP_SERVER_DOMAIN_NAME);
+    pCellularPort_memset(&address, 0, sizeof(address));
+    startTimeMs = cellularPortGetTickTimeMs();
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetHostByName(CELLULAR_CFG_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+                                                        &(address.ipAddress)) == 0);
+    hitMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+    addressAssert(&remoteAddress, &address, false);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetHostByName(CELLULAR_CFG_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+                                                        NULL) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetDnsCacheStats(&stats) == 0);
+    CELLULAR_PORT_TEST_ASSERT(stats.numLookups == 2);
+    CELLULAR_PORT_TEST_ASSERT(stats.numHits == 2);
+    CELLULAR_PORT_TEST_ASSERT(stats.numMisses == 0);
+    CELLULAR_PORT_TEST_ASSERT(stats.numEntries == 1);
+
+    cellularPortLog("CELLULAR_SOCK_TEST: flushing the DNS cache and looking up"
+                    " \"%s\" once more...\n",
+                    CELLULAR_CFG_TEST_ECHO_UDP_SERVER_DOMAIN_NAME);
+    cellularSockFlushDnsCache();
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetDnsCacheStats(&stats) == 0);
+    CELLULAR_PORT_TEST_ASSERT(stats.numEntries == 0);
+    pCellularPort_memset(&address, 0, sizeof(address));
+    startTimeMs = cellularPortGetTickTimeMs();
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetHostByName(CELLULAR_CFG_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+                                                        &(address.ipAddress)) == 0);
+    missMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+    addressAssert(&remoteAddress, &address, false);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetDnsCacheStats(&stats) == 0);
+    CELLULAR_PORT_TEST_ASSERT(stats.numMisses == 1);
+    CELLULAR_PORT_TEST_ASSERT(stats.numEntries == 1);
+    cellularPortLog("CELLULAR_SOCK_TEST: look-up from the DNS cache took %d ms,"
+                    " from the module %d ms.\n", hitMs, missMs);
+    CELLULAR_PORT_TEST_ASSERT(hitMs <= missMs);
+
+    // A name in the .invalid domain never resolves
+    cellularPortLog("CELLULAR_SOCK_TEST: looking up a host name that doesn't"
+                    " exist, twice...\n");
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetHostByName("nonexistent.invalid",
+                                                        &(address.ipAddress)) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetHostByName("nonexistent.invalid",
+                                                        &(address.ipAddress)) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetDnsCacheStats(&stats) == 0);
+    cellularPortLog("CELLULAR_SOCK_TEST: %d look-up(s), %d hit(s), %d negative"
+                    " hit(s), %d miss(es), %d entries.\n", stats.numLookups,
+                    stats.numHits, stats.numNegativeHits, stats.numMisses,
+                    stats.numEntries);
+    CELLULAR_PORT_TEST_ASSERT(stats.numMisses == 2);
+    CELLULAR_PORT_TEST_ASSERT(stats.numNegativeHits == 1);
+    CELLULAR_PORT_TEST_ASSERT(stats.numEntries == 2);
+
+    cellularSockFlushDnsCache();
+    cellularPort_errno_set(0);
+
+    stdDataTestDeinit(sockDescriptor);
+}
+
+/** Test non-blocking connect: connect several sockets in
+ * parallel, picking up the outcomes with select, the callback
+ * and the error socket option, connect one to a port where
+ * nothing is listening, which should fail in the same way, and
+ * one to an address that never answers, which should time out.
+ */
+CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestConnectNonBlocking(),
+                            "sockConnectNonBlocking",
+                            "sock")
+{
+    CellularSockAddress_t remoteAddress;
+    CellularSockAddress_t localAddress;
+    CellularSockDescriptor_t sockDescriptor[CELLULAR_SOCK_TEST_CONNECT_NUM_SOCKETS];
+    CellularSockDescriptor_t refusedDescriptor;
+    CellularSockDescriptor_t timedOutDescriptor;
+    CellularSockDescriptorSet_t writeSet;
+    CellularSockDescriptor_t maxDescriptor;
+    CellularPort_timeval timeout;
+    char buffer[CELLULAR_CTRL_IP_ADDRESS_SIZE];
+    char *pDataReceived;
+    volatile int32_t numCallbacks = 0;
+    volatile int32_t numTimedOutCallbacks = 0;
+    bool connected[CELLULAR_SOCK_TEST_CONNECT_NUM_SOCKETS] = {false};
+    size_t numConnected = 0;
+    size_t sizeBytes = sizeof(gAllChars) - 1;
+    size_t length;
+    size_t offset;
+    int32_t socketError;
+    int32_t x;
+    int64_t startTimeMs;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    pDataReceived = (char *) pCellularPort_malloc(sizeBytes);
+    CELLULAR_PORT_TEST_ASSERT(pDataReceived != NULL);
+
+    // Do the standard preamble, which opens the first socket
+    stdDataTestInit(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT,
+                    &remoteAddress,
+                    CELLULAR_SOCK_TYPE_STREAM,
+                    CELLULAR_SOCK_PROTOCOL_TCP,
+                    &(sockDescriptor[0]));
+
+    // Check the connect timeout option
+    length = sizeof(timeout);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetOption(sockDescriptor[0],
+                                                    CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                    CELLULAR_SOCK_OPT_CONTIMEO,
+                                                    (void *) &timeout,
+                                                    &length) == 0);
+    CELLULAR_PORT_TEST_ASSERT(length == sizeof(timeout));
+    CELLULAR_PORT_TEST_ASSERT((timeout.tv_sec * 1000) + (timeout.tv_usec / 1000) ==
+                              CELLULAR_SOCK_CONNECT_TIMEOUT_DEFAULT_MS);
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 0;
+    CELLULAR_PORT_TEST_ASSERT(cellularSockSetOption(sockDescriptor[0],
+                                                    CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                    CELLULAR_SOCK_OPT_CONTIMEO,
+                                                    (void *) &timeout,
+                                                    sizeof(timeout)) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EINVAL);
+    cellularPort_errno_set(0);
+
+    // Start all of the connections before waiting for any
+    cellularPortLog("CELLULAR_SOCK_TEST: connecting %d socket(s) in parallel...\n",
+                    CELLULAR_SOCK_TEST_CONNECT_NUM_SOCKETS);
+    maxDescriptor = 0;
+    startTimeMs = cellularPortGetTickTimeMs();
+    for (size_t y = 0; y < CELLULAR_SOCK_TEST_CONNECT_NUM_SOCKETS; y++) {
+        if (y > 0) {
+            sockDescriptor[y] = cellularSockCreate(CELLULAR_SOCK_TYPE_STREAM,
+                                                   CELLULAR_SOCK_PROTOCOL_TCP);
+            CELLULAR_PORT_TEST_ASSERT(sockDescriptor[y] >= 0);
+        }
+        if (sockDescriptor[y] >= maxDescriptor) {
+            maxDescriptor = sockDescriptor[y] + 1;
+        }
+        timeout.tv_sec = CELLULAR_SOCK_TEST_CONNECT_TIMEOUT_MS / 1000;
+        CELLULAR_PORT_TEST_ASSERT(cellularSockSetOption(sockDescriptor[y],
+                                                        CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                        CELLULAR_SOCK_OPT_CONTIMEO,
+                                                        (void *) &timeout,
+                                                        sizeof(timeout)) == 0);
+        CELLULAR_PORT_TEST_ASSERT(cellularSockRegisterCallbackConnect(sockDescriptor[y],
+                                                                      incrementInt,
+                                                                      (void *) &numCallbacks) == 0);
+        CELLULAR_PORT_TEST_ASSERT(cellularSockFcntl(sockDescriptor[y],
+                                                    CELLULAR_SOCK_FCNTL_SET_STATUS,
+                                                    CELLULAR_SOCK_FCNTL_STATUS_NONBLOCK) == 0);
+        CELLULAR_PORT_TEST_ASSERT(cellularSockConnect(sockDescriptor[y],
+                                                      &remoteAddress) < 0);
+        CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EINPROGRESS);
+        cellularPort_errno_set(0);
+        // Asking again will find it connecting or, if the
+        // module is quick, connected
+        CELLULAR_PORT_TEST_ASSERT(cellularSockConnect(sockDescriptor[y],
+                                                      &remoteAddress) < 0);
+        CELLULAR_PORT_TEST_ASSERT((cellularPort_errno_get() == CELLULAR_SOCK_EALREADY) ||
+                                  (cellularPort_errno_get() == CELLULAR_SOCK_EISCONN));
+        cellularPort_errno_set(0);
+    }
+
+    // Wait for them all to become writable
+    while ((numConnected < CELLULAR_SOCK_TEST_CONNECT_NUM_SOCKETS) &&
+           (cellularPortGetTickTimeMs() - startTimeMs <
+            CELLULAR_SOCK_TEST_CONNECT_TIMEOUT_MS)) {
+        CELLULAR_SOCK_FD_ZERO(&writeSet);
+        for (size_t y = 0; y < CELLULAR_SOCK_TEST_CONNECT_NUM_SOCKETS; y++) {
+            if (!connected[y]) {
+                CELLULAR_SOCK_FD_SET(sockDescriptor[y], &writeSet);
+            }
+        }
+        CELLULAR_PORT_TEST_ASSERT(cellularSockSelect(maxDescriptor, NULL,
+                                                     &writeSet, NULL,
+                                                     CELLULAR_SOCK_TEST_CONNECT_TIMEOUT_MS) > 0);
+        for (size_t y = 0; y < CELLULAR_SOCK_TEST_CONNECT_NUM_SOCKETS; y++) {
+            if (!connected[y] && CELLULAR_SOCK_FD_ISSET(sockDescriptor[y], &writeSet)) {
+                length = sizeof(socketError);
+                socketError = -1;
+                CELLULAR_PORT_TEST_ASSERT(cellularSockGetOption(sockDescriptor[y],
+                                                                CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                                CELLULAR_SOCK_OPT_ERROR,
+                                                                (void *) &socketError,
+                                                                &length) == 0);
+                CELLULAR_PORT_TEST_ASSERT(socketError == 0);
+                connected[y] = true;
+                numConnected++;
+            }
+        }
+    }
+    cellularPortLog("CELLULAR_SOCK_TEST: %d of %d socket(s) connected in %d ms.\n",
+                    (int) numConnected, CELLULAR_SOCK_TEST_CONNECT_NUM_SOCKETS,
+                    (int) (cellularPortGetTickTimeMs() - startTimeMs));
+    CELLULAR_PORT_TEST_ASSERT(numConnected == CELLULAR_SOCK_TEST_CONNECT_NUM_SOCKETS);
+
+    // The callbacks are run in another task, give them time
+    startTimeMs = cellularPortGetTickTimeMs();
+    while ((numCallbacks < CELLULAR_SOCK_TEST_CONNECT_NUM_SOCKETS) &&
+           (cellularPortGetTickTimeMs() - startTimeMs <
+            CELLULAR_SOCK_TEST_CONCURRENT_MARGIN_MS)) {
+        cellularPortTaskBlock(10);
+    }
+    cellularPortLog("CELLULAR_SOCK_TEST: connect callback called %d time(s).\n",
+                    numCallbacks);
+    CELLULAR_PORT_TEST_ASSERT(numCallbacks == CELLULAR_SOCK_TEST_CONNECT_NUM_SOCKETS);
+
+    // Now they are connected, connecting again should say so
+    // and the sockets should carry data
+    for (size_t y = 0; y < CELLULAR_SOCK_TEST_CONNECT_NUM_SOCKETS; y++) {
+        CELLULAR_PORT_TEST_ASSERT(cellularSockConnect(sockDescriptor[y],
+                                                      &remoteAddress) < 0);
+        CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EISCONN);
+        cellularPort_errno_set(0);
+        CELLULAR_PORT_TEST_ASSERT(sendTcp(sockDescriptor[y], gAllChars,
+                                          sizeBytes) == (int32_t) sizeBytes);
+        pCellularPort_memset(pDataReceived, 0, sizeBytes);
+        offset = 0;
+        startTimeMs = cellularPortGetTickTimeMs();
+        while ((offset < sizeBytes) &&
+               (cellularPortGetTickTimeMs() - startTimeMs <
+                CELLULAR_SOCK_TEST_CONNECT_TIMEOUT_MS)) {
+            x = cellularSockRead(sockDescriptor[y], pDataReceived + offset,
+                                 sizeBytes - offset);
+            if (x > 0) {
+                offset += x;
+            } else {
+                cellularPortTaskBlock(10);
+            }
+        }
+        CELLULAR_PORT_TEST_ASSERT(offset == sizeBytes);
+        CELLULAR_PORT_TEST_ASSERT(cellularPort_memcmp(pDataReceived, gAllChars,
+                                                      sizeBytes) == 0);
+    }
+    cellularPort_errno_set(0);
+
+    // Connecting to a port of our own IP address where
+    // nothing is listening should be refused, the socket
+    // still becoming writable
+    cellularPortLog("CELLULAR_SOCK_TEST: connecting to a port where nothing"
+                    " is listening...\n");
+    CELLULAR_PORT_TEST_ASSERT(cellularCtrlGetIpAddressStr(buffer) > 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockStringToAddress(buffer,
+                                                          &localAddress) == 0);
+    localAddress.port = CELLULAR_CFG_TEST_LOCAL_PORT;
+    refusedDescriptor = cellularSockCreate(CELLULAR_SOCK_TYPE_STREAM,
+                                           CELLULAR_SOCK_PROTOCOL_TCP);
+    CELLULAR_PORT_TEST_ASSERT(refusedDescriptor >= 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockFcntl(refusedDescriptor,
+                                                CELLULAR_SOCK_FCNTL_SET_STATUS,
+                                                CELLULAR_SOCK_FCNTL_STATUS_NONBLOCK) == 0);
+    x = cellularSockConnect(refusedDescriptor, &localAddress);
+    cellularPortLog("CELLULAR_SOCK_TEST: cellularSockConnect() returned %d,"
+                    " errno %d.\n", x, cellularPort_errno_get());
+    CELLULAR_PORT_TEST_ASSERT(x < 0);
+    if (cellularPort_errno_get() == CELLULAR_SOCK_EINPROGRESS) {
+        CELLULAR_SOCK_FD_ZERO(&writeSet);
+        CELLULAR_SOCK_FD_SET(refusedDescriptor, &writeSet);
+        CELLULAR_PORT_TEST_ASSERT(cellularSockSelect(refusedDescriptor + 1, NULL,
+                                                     &writeSet, NULL,
+                                                     CELLULAR_SOCK_TEST_CONNECT_TIMEOUT_MS) == 1);
+        length = sizeof(socketError);
+        socketError = 0;
+        CELLULAR_PORT_TEST_ASSERT(cellularSockGetOption(refusedDescriptor,
+                                                        CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                        CELLULAR_SOCK_OPT_ERROR,
+                                                        (void *) &socketError,
+                                                        &length) == 0);
+        cellularPortLog("CELLULAR_SOCK_TEST: error socket option is %d.\n",
+                        socketError);
+        CELLULAR_PORT_TEST_ASSERT(socketError != 0);
+        // Reading it clears it
+        CELLULAR_PORT_TEST_ASSERT(cellularSockGetOption(refusedDescriptor,
+                                                        CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                        CELLULAR_SOCK_OPT_ERROR,
+                                                        (void *) &socketError,
+                                                        &length) == 0);
+        CELLULAR_PORT_TEST_ASSERT(socketError == 0);
+    }
+    cellularPort_errno_set(0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockClose(refusedDescriptor) == 0);
+
+    // A connection that is never answered should time out of its
+    // own accord, calling the callback, after which the socket
+    // is no more use and connecting again must not start afresh
+    cellularPortLog("CELLULAR_SOCK_TEST: connecting to an address that"
+                    " never answers...\n");
+    CELLULAR_PORT_TEST_ASSERT(cellularSockStringToAddress(CELLULAR_CFG_TEST_BLACK_HOLE_IP_ADDRESS,
+                                                          &localAddress) == 0);
+    localAddress.port = CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT;
+    timedOutDescriptor = cellularSockCreate(CELLULAR_SOCK_TYPE_STREAM,
+                                            CELLULAR_SOCK_PROTOCOL_TCP);
+    CELLULAR_PORT_TEST_ASSERT(timedOutDescriptor >= 0);
+    timeout.tv_sec = CELLULAR_SOCK_TEST_CONNECT_BLACK_HOLE_TIMEOUT_MS / 1000;
+    timeout.tv_usec = (CELLULAR_SOCK_TEST_CONNECT_BLACK_HOLE_TIMEOUT_MS % 1000) * 1000;
+    CELLULAR_PORT_TEST_ASSERT(cellularSockSetOption(timedOutDescriptor,
+                                                    CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                    CELLULAR_SOCK_OPT_CONTIMEO,
+                                                    (void *) &timeout,
+                                                    sizeof(timeout)) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockRegisterCallbackConnect(timedOutDescriptor,
+                                                                  incrementInt,
+                                                                  (void *) &numTimedOutCallbacks) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockFcntl(timedOutDescriptor,
+                                                CELLULAR_SOCK_FCNTL_SET_STATUS,
+                                                CELLULAR_SOCK_FCNTL_STATUS_NONBLOCK) == 0);
+    startTimeMs = cellularPortGetTickTimeMs();
+    CELLULAR_PORT_TEST_ASSERT(cellularSockConnect(timedOutDescriptor,
+                                                  &localAddress) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EINPROGRESS);
+    cellularPort_errno_set(0);
+    while ((numTimedOutCallbacks == 0) &&
+           (cellularPortGetTickTimeMs() - startTimeMs <
+            CELLULAR_SOCK_TEST_CONNECT_BLACK_HOLE_TIMEOUT_MS +
+            CELLULAR_SOCK_TEST_CONCURRENT_MARGIN_MS)) {
+        cellularPortTaskBlock(10);
+    }
+    x = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+    cellularPortLog("CELLULAR_SOCK_TEST: connect callback called %d time(s)"
+                    " after %d ms.\n", numTimedOutCallbacks, x);
+    CELLULAR_PORT_TEST_ASSERT(numTimedOutCallbacks == 1);
+    CELLULAR_PORT_TEST_ASSERT(x >= CELLULAR_SOCK_TEST_CONNECT_BLACK_HOLE_TIMEOUT_MS);
+    CELLULAR_SOCK_FD_ZERO(&writeSet);
+    CELLULAR_SOCK_FD_SET(timedOutDescriptor, &writeSet);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockSelect(timedOutDescriptor + 1, NULL,
+                                                 &writeSet, NULL, 0) == 1);
+    length = sizeof(socketError);
+    socketError = 0;
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetOption(timedOutDescriptor,
+                                                    CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                    CELLULAR_SOCK_OPT_ERROR,
+                                                    (void *) &socketError,
+                                                    &length) == 0);
+    CELLULAR_PORT_TEST_ASSERT(socketError == CELLULAR_SOCK_ETIMEDOUT);
+    for (size_t y = 0; y < 2; y++) {
+        CELLULAR_PORT_TEST_ASSERT(cellularSockConnect(timedOutDescriptor,
+                                                      &remoteAddress) < 0);
+        CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_ETIMEDOUT);
+        cellularPort_errno_set(0);
+    }
+    CELLULAR_PORT_TEST_ASSERT(cellularSockWrite(timedOutDescriptor, gAllChars,
+                                                sizeBytes) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_ETIMEDOUT);
+    cellularPort_errno_set(0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockClose(timedOutDescriptor) == 0);
+    CELLULAR_PORT_TEST_ASSERT(numTimedOutCallbacks == 1);
+
+    for (size_t y = 1; y < CELLULAR_SOCK_TEST_CONNECT_NUM_SOCKETS; y++) {
+        CELLULAR_PORT_TEST_ASSERT(cellularSockClose(sockDescriptor[y]) == 0);
+    }
+
+    cellularPort_free(pDataReceived);
+    cellularPort_errno_set(0);
+
+    stdDataTestDeinit(sockDescriptor[0]);
+}
+
+/** Test that sockets don't hold each other up: while one task
+ * sits in a receive on one socket and another connects sockets,
+ * data should flow on a third socket and the blocked socket should
+ * remain usable, e.g. for closing, by others.
+ */
+CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestConcurrent(),
+                            "sockConcurrent",
+                            "sock")
+{
+    CellularSockAddress_t remoteAddress;
+    CellularSockDescriptor_t sockDescriptor;
+    CellularSockTestConcurrentTaskData_t receiveData;
+    CellularSockTestConcurrentTaskData_t connectData;
+    CellularPortTaskHandle_t taskHandle;
+    CellularPort_timeval timeout;
+    char *pDataReceived;
+    size_t sizeBytes = sizeof(gSendData) - 1;
+    size_t offset;
+    int32_t x;
+    int64_t startTimeMs;
+    int32_t elapsedMs;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    pDataReceived = (char *) pCellularPort_malloc(sizeBytes);
+    CELLULAR_PORT_TEST_ASSERT(pDataReceived != NULL);
+
+    // Do the standard preamble, which opens the socket
+    // that the data will flow on
+    stdDataTestInit(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT,
+                    &remoteAddress,
+                    CELLULAR_SOCK_TYPE_STREAM,
+                    CELLULAR_SOCK_PROTOCOL_TCP,
+                    &sockDescriptor);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockConnect(sockDescriptor,
+                                                  &remoteAddress) == 0);
+
+    // A UDP socket that nothing will arrive on, with a
+    // long receive timeout, and a task to sit on it
+    pCellularPort_memset(&receiveData, 0, sizeof(receiveData));
+    receiveData.sockDescriptor = cellularSockCreate(CELLULAR_SOCK_TYPE_DGRAM,
+                                                    CELLULAR_SOCK_PROTOCOL_UDP);
+    CELLULAR_PORT_TEST_ASSERT(receiveData.sockDescriptor >= 0);
+    timeout.tv_sec = CELLULAR_SOCK_TEST_CONCURRENT_RECEIVE_TIMEOUT_MS / 1000;
+    timeout.tv_usec = 0;
+    CELLULAR_PORT_TEST_ASSERT(cellularSockSetOption(receiveData.sockDescriptor,
+                                                    CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                    CELLULAR_SOCK_OPT_RCVTIMEO,
+                                                    (void *) &timeout,
+                                                    sizeof(timeout)) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPortTaskCreate(receiveBlockedTask,
+                                                     "testTaskRxBlocked",
+                                                     CELLULAR_PORT_TEST_SOCK_TASK_STACK_SIZE_BYTES,
+                                                     (void *) &receiveData,
+                                                     CELLULAR_PORT_TEST_SOCK_TASK_PRIORITY,
+                                                     &taskHandle) == 0);
+    // Give it time to get stuck in
+    cellularPortTaskBlock(CELLULAR_SOCK_TEST_TIME_MARGIN_MS);
+    CELLULAR_PORT_TEST_ASSERT(!receiveData.done);
+
+    // The blocked socket should still be available to us
+    startTimeMs = cellularPortGetTickTimeMs();
+    CELLULAR_PORT_TEST_ASSERT(cellularSockFcntl(receiveData.sockDescriptor,
+                                                CELLULAR_SOCK_FCNTL_GET_STATUS,
+                                                0) == 0);
+    elapsedMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+    cellularPortLog("CELLULAR_SOCK_TEST: cellularSockFcntl() on the blocked"
+                    " socket took %d ms.\n", elapsedMs);
+    CELLULAR_PORT_TEST_ASSERT(elapsedMs < CELLULAR_SOCK_TEST_CONCURRENT_MARGIN_MS);
+
+    // A task to connect other sockets in the meantime
+    pCellularPort_memset(&connectData, 0, sizeof(connectData));
+    connectData.sockDescriptor = -1;
+    connectData.pRemoteAddress = &remoteAddress;
+    CELLULAR_PORT_TEST_ASSERT(cellularPortTaskCreate(connectTask,
+                                                     "testTaskConnect",
+                                                     CELLULAR_PORT_TEST_SOCK_TASK_STACK_SIZE_BYTES,
+                                                     (void *) &connectData,
+                                                     CELLULAR_PORT_TEST_SOCK_TASK_PRIORITY,
+                                                     &taskHandle) == 0);
+
+    // Now echo data while all that is going on
+    startTimeMs = cellularPortGetTickTimeMs();
+    for (size_t y = 0; y < CELLULAR_SOCK_TEST_CONCURRENT_NUM_ECHOES; y++) {
+        CELLULAR_PORT_TEST_ASSERT(sendTcp(sockDescriptor, gSendData,
+                                          sizeBytes) == (int32_t) sizeBytes);
+        pCellularPort_memset(pDataReceived, 0, sizeBytes);
+        offset = 0;
+        while ((offset < sizeBytes) &&
+               (cellularPortGetTickTimeMs() - startTimeMs <
+                CELLULAR_SOCK_TEST_CONCURRENT_RECEIVE_TIMEOUT_MS)) {
+            x = cellularSockRead(sockDescriptor, pDataReceived + offset,
+                                 sizeBytes - offset);
+            if (x > 0) {
+                offset += x;
+            }
+        }
+        CELLULAR_PORT_TEST_ASSERT(offset == sizeBytes);
+        CELLULAR_PORT_TEST_ASSERT(cellularPort_memcmp(pDataReceived, gSendData,
+                                                      sizeBytes) == 0);
+    }
+    elapsedMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+    cellularPortLog("CELLULAR_SOCK_TEST: %d x %d byte(s) echoed in %d ms.\n",
+                    CELLULAR_SOCK_TEST_CONCURRENT_NUM_ECHOES, sizeBytes,
+                    elapsedMs);
+
+    // Wait for the connecting to be done
+    startTimeMs = cellularPortGetTickTimeMs();
+    while (!connectData.done &&
+           (cellularPortGetTickTimeMs() - startTimeMs <
+            CELLULAR_SOCK_TEST_CONCURRENT_RECEIVE_TIMEOUT_MS)) {
+        cellularPortTaskBlock(10);
+    }
+    cellularPortLog("CELLULAR_SOCK_TEST: %d connect(s) took %d ms, returned %d,"
+                    " errno %d.\n", CELLULAR_SOCK_TEST_CONCURRENT_NUM_CONNECTS,
+                    connectData.timeMs, connectData.returnCode,
+                    connectData.errorNumber);
+    CELLULAR_PORT_TEST_ASSERT(connectData.done);
+    CELLULAR_PORT_TEST_ASSERT(connectData.returnCode == 0);
+
+    // All of that should have happened with the receive still
+    // blocked; closing its socket should be prompt and should
+    // end the receive
+    CELLULAR_PORT_TEST_ASSERT(!receiveData.done);
+    startTimeMs = cellularPortGetTickTimeMs();
+    CELLULAR_PORT_TEST_ASSERT(cellularSockClose(receiveData.sockDescriptor) == 0);
+    while (!receiveData.done &&
+           (cellularPortGetTickTimeMs() - startTimeMs <
+            CELLULAR_SOCK_TEST_CONCURRENT_RECEIVE_TIMEOUT_MS)) {
+        cellularPortTaskBlock(10);
+    }
+    elapsedMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+    cellularPortLog("CELLULAR_SOCK_TEST: closing the blocked socket ended the"
+                    " receive in %d ms.\n", elapsedMs);
+    CELLULAR_PORT_TEST_ASSERT(receiveData.done);
+    CELLULAR_PORT_TEST_ASSERT(elapsedMs < CELLULAR_SOCK_TEST_CONCURRENT_MARGIN_MS);
+    CELLULAR_PORT_TEST_ASSERT(receiveData.returnCode < 0);
+    CELLULAR_PORT_TEST_ASSERT(receiveData.errorNumber == CELLULAR_SOCK_EBADF);
+
+    // Allow the tasks to be deleted, required by some
+    // operating systems (e.g. freeRTOS)
+    cellularPortTaskBlock(100);
+
+    cellularPort_free(pDataReceived);
+    cellularPort_errno_set(0);
+
+    stdDataTestDeinit(sockDescriptor);
+}
+
+/** Test TLS done by the module: storing a credential, getting
+ * security profiles, a TCP echo over a secure socket and a
+ * reconnect to the same server, which should resume the TLS
+ * session, then the cases that should fail.
+ */
+CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestTls(),
+                            "sockTls",
+                            "sock")
+{
+    CellularSockAddress_t remoteAddress;
+    CellularSockDescriptor_t sockDescriptor;
+    CellularSockDescriptor_t udpSockDescriptor;
+    CellularSockTlsProfile_t profile;
+    CellularSockTlsCacheStats_t stats;
+    int32_t profileId;
+    int32_t otherProfileId;
+    int32_t value;
+    size_t length;
+    int32_t connectMs[2];
+    int64_t startTimeMs;
+    char *pOtherRootCa;
+    char serverName[CELLULAR_SOCK_TLS_SERVER_NAME_MAX_LENGTH_BYTES + 2];
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    stdDataTestInit(CELLULAR_CFG_TEST_ECHO_TLS_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_TLS_SERVER_PORT,
+                    &remoteAddress,
+                    CELLULAR_SOCK_TYPE_STREAM,
+                    CELLULAR_SOCK_PROTOCOL_TCP,
+                    &sockDescriptor);
+    cellularSockFlushTlsCache();
+    cellularSockResetTlsCacheStats();
+
+    cellularPortLog("CELLULAR_SOCK_TEST: storing the root CA, twice...\n");
+    CELLULAR_PORT_TEST_ASSERT(cellularSockTlsStoreCredential(CELLULAR_SOCK_TLS_CREDENTIAL_ROOT_CA,
+                                                             "test-root-ca",
+                                                             CELLULAR_CFG_TEST_TLS_ROOT_CA,
+                                                             sizeof(CELLULAR_CFG_TEST_TLS_ROOT_CA) - 1) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockTlsStoreCredential(CELLULAR_SOCK_TLS_CREDENTIAL_ROOT_CA,
+                                                             "test-root-ca",
+                                                             CELLULAR_CFG_TEST_TLS_ROOT_CA,
+                                                             sizeof(CELLULAR_CFG_TEST_TLS_ROOT_CA) - 1) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetTlsCacheStats(&stats) == 0);
+    CELLULAR_PORT_TEST_ASSERT(stats.numCredentialStores == 2);
+    CELLULAR_PORT_TEST_ASSERT(stats.numCredentialHits == 1);
+
+    // A credential of the same size that differs in just one
+    // byte is not the same credential; the module may not like
+    // the changed one, it is the real one that has to work
+    cellularPortLog("CELLULAR_SOCK_TEST: storing a different root CA of"
+                    " the same size, then the root CA again...\n");
+    pOtherRootCa = (char *) pCellularPort_malloc(sizeof(CELLULAR_CFG_TEST_TLS_ROOT_CA));
+    CELLULAR_PORT_TEST_ASSERT(pOtherRootCa != NULL);
+    pCellularPort_memcpy(pOtherRootCa, CELLULAR_CFG_TEST_TLS_ROOT_CA,
+                         sizeof(CELLULAR_CFG_TEST_TLS_ROOT_CA));
+    length = (sizeof(CELLULAR_CFG_TEST_TLS_ROOT_CA) - 1) / 2;
+    pOtherRootCa[length] = (pOtherRootCa[length] == 'A') ? 'B' : 'A';
+    cellularSockTlsStoreCredential(CELLULAR_SOCK_TLS_CREDENTIAL_ROOT_CA,
+                                   "test-root-ca", pOtherRootCa,
+                                   sizeof(CELLULAR_CFG_TEST_TLS_ROOT_CA) - 1);
+    cellularPort_errno_set(0);
+    cellularPort_free(pOtherRootCa);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockTlsStoreCredential(CELLULAR_SOCK_TLS_CREDENTIAL_ROOT_CA,
+                                                             "test-root-ca",
+                                                             CELLULAR_CFG_TEST_TLS_ROOT_CA,
+                                                             sizeof(CELLULAR_CFG_TEST_TLS_ROOT_CA) - 1) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetTlsCacheStats(&stats) == 0);
+    CELLULAR_PORT_TEST_ASSERT(stats.numCredentialStores == 4);
+    CELLULAR_PORT_TEST_ASSERT(stats.numCredentialHits == 1);
+
+    cellularPortLog("CELLULAR_SOCK_TEST: getting security profiles...\n");
+    pCellularPort_memset(&profile, 0, sizeof(profile));
+    profile.validation = CELLULAR_SOCK_TLS_VALIDATION_ROOT_CA;
+    profile.pRootCaName = "test-root-ca";
+    profile.pServerName = CELLULAR_CFG_TEST_ECHO_TLS_SERVER_DOMAIN_NAME;
+    profile.sessionResumption = true;
+    profileId = cellularSockTlsProfileGet(&profile);
+    CELLULAR_PORT_TEST_ASSERT(profileId >= 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockTlsProfileGet(&profile) == profileId);
+    profile.sessionResumption = false;
+    otherProfileId = cellularSockTlsProfileGet(&profile);
+    CELLULAR_PORT_TEST_ASSERT(otherProfileId >= 0);
+    CELLULAR_PORT_TEST_ASSERT(otherProfileId != profileId);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetTlsCacheStats(&stats) == 0);
+    cellularPortLog("CELLULAR_SOCK_TEST: %d profile get(s), %d hit(s), %d AT"
+                    " write(s).\n", stats.numProfileGets, stats.numProfileHits,
+                    stats.numAtProfileWrites);
+    CELLULAR_PORT_TEST_ASSERT(stats.numProfileGets == 3);
+    CELLULAR_PORT_TEST_ASSERT(stats.numProfileHits == 1);
+    profile.sessionResumption = true;
+
+    // A server name too long to be kept can't be compared
+    pCellularPort_memset(serverName, 'a', sizeof(serverName) - 1);
+    serverName[sizeof(serverName) - 1] = 0;
+    profile.pServerName = serverName;
+    CELLULAR_PORT_TEST_ASSERT(cellularSockTlsProfileGet(&profile) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EINVAL);
+    cellularPort_errno_set(0);
+    profile.pServerName = CELLULAR_CFG_TEST_ECHO_TLS_SERVER_DOMAIN_NAME;
+
+    // Connect securely twice, the second time
+    // should resume the session of the first
+    for (size_t x = 0; x < sizeof(connectMs) / sizeof(connectMs[0]); x++) {
+        if (x > 0) {
+            CELLULAR_PORT_TEST_ASSERT(cellularSockClose(sockDescriptor) == 0);
+            sockDescriptor = cellularSockCreate(CELLULAR_SOCK_TYPE_STREAM,
+                                                CELLULAR_SOCK_PROTOCOL_TCP);
+            CELLULAR_PORT_TEST_ASSERT(sockDescriptor >= 0);
+            CELLULAR_PORT_TEST_ASSERT(cellularSockTlsProfileGet(&profile) == profileId);
+        }
+        CELLULAR_PORT_TEST_ASSERT(cellularSockSetOption(sockDescriptor,
+                                                        CELLULAR_SOCK_OPT_LEVEL_TLS,
+                                                        CELLULAR_SOCK_OPT_TLS_SECURITY_PROFILE,
+                                                        &profileId,
+                                                        sizeof(profileId)) == 0);
+        value = -1;
+        length = sizeof(value);
+        CELLULAR_PORT_TEST_ASSERT(cellularSockGetOption(sockDescriptor,
+                                                        CELLULAR_SOCK_OPT_LEVEL_TLS,
+                                                        CELLULAR_SOCK_OPT_TLS_SECURITY_PROFILE,
+                                                        &value, &length) == 0);
+        CELLULAR_PORT_TEST_ASSERT(length == sizeof(value));
+        CELLULAR_PORT_TEST_ASSERT(value == profileId);
+
+        cellularPortLog("CELLULAR_SOCK_TEST: connecting securely to \"%s:%d\"...\n",
+                        CELLULAR_CFG_TEST_ECHO_TLS_SERVER_DOMAIN_NAME,
+                        CELLULAR_CFG_TEST_ECHO_TLS_SERVER_PORT);
+        startTimeMs = cellularPortGetTickTimeMs();
+        CELLULAR_PORT_TEST_ASSERT(cellularSockConnect(sockDescriptor,
+                                                      &remoteAddress) == 0);
+        connectMs[x] = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+        CELLULAR_PORT_TEST_ASSERT(tcpEchoCheck(sockDescriptor));
+
+        // The security profile can't be changed once connected
+        CELLULAR_PORT_TEST_ASSERT(cellularSockSetOption(sockDescriptor,
+                                                        CELLULAR_SOCK_OPT_LEVEL_TLS,
+                                                        CELLULAR_SOCK_OPT_TLS_SECURITY_PROFILE,
+                                                        &otherProfileId,
+                                                        sizeof(otherProfileId)) < 0);
+        CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EISCONN);
+        cellularPort_errno_set(0);
+    }
+    cellularPortLog("CELLULAR_SOCK_TEST: secure connect took %d ms, reconnect"
+                    " %d ms.\n", connectMs[0], connectMs[1]);
+
+    // TLS is for TCP sockets only
+    cellularPortLog("CELLULAR_SOCK_TEST: trying TLS on a UDP socket...\n");
+    udpSockDescriptor = cellularSockCreate(CELLULAR_SOCK_TYPE_DGRAM,
+                                           CELLULAR_SOCK_PROTOCOL_UDP);
+    CELLULAR_PORT_TEST_ASSERT(udpSockDescriptor >= 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockSetOption(udpSockDescriptor,
+                                                    CELLULAR_SOCK_OPT_LEVEL_TLS,
+                                                    CELLULAR_SOCK_OPT_TLS_SECURITY_PROFILE,
+                                                    &profileId,
+                                                    sizeof(profileId)) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_ENOPROTOOPT);
+    cellularPort_errno_set(0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockClose(udpSockDescriptor) == 0);
+
+    // A profile which checks the server against a root CA
+    // that isn't there can't connect
+    cellularPortLog("CELLULAR_SOCK_TEST: connecting with a root CA that"
+                    " isn't stored...\n");
+    CELLULAR_PORT_TEST_ASSERT(cellularSockClose(sockDescriptor) == 0);
+    sockDescriptor = cellularSockCreate(CELLULAR_SOCK_TYPE_STREAM,
+                                        CELLULAR_SOCK_PROTOCOL_TCP);
+    CELLULAR_PORT_TEST_ASSERT(sockDescriptor >= 0);
+    profile.pRootCaName = "test-no-root-ca";
+    otherProfileId = cellularSockTlsProfileGet(&profile);
+    CELLULAR_PORT_TEST_ASSERT(otherProfileId >= 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockSetOption(sockDescriptor,
+                                                    CELLULAR_SOCK_OPT_LEVEL_TLS,
+                                                    CELLULAR_SOCK_OPT_TLS_SECURITY_PROFILE,
+                                                    &otherProfileId,
+                                                    sizeof(otherProfileId)) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockConnect(sockDescriptor,
+                                                  &remoteAddress) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() > 0);
+    cellularPort_errno_set(0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockClose(sockDescriptor) == 0);
+    sockDescriptor = cellularSockCreate(CELLULAR_SOCK_TYPE_STREAM,
+                                        CELLULAR_SOCK_PROTOCOL_TCP);
+    CELLULAR_PORT_TEST_ASSERT(sockDescriptor >= 0);
+
+    cellularPortLog("CELLULAR_SOCK_TEST: removing the root CA, twice...\n");
+    CELLULAR_PORT_TEST_ASSERT(cellularSockTlsRemoveCredential(CELLULAR_SOCK_TLS_CREDENTIAL_ROOT_CA,
+                                                              "test-root-ca") == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockTlsRemoveCredential(CELLULAR_SOCK_TLS_CREDENTIAL_ROOT_CA,
+                                                              "test-root-ca") < 0);
+    cellularPort_errno_set(0);
+
+    cellularSockFlushTlsCache();
+
+    stdDataTestDeinit(sockDescriptor);
+}
+
+/** Test the local copy of the socket options that the module
+ * holds: options set before connect are written in one go at
+ * connect, an unchanged value is not set again and repeated gets
+ * are answered without troubling the module.
+ */
+CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestOptionCache(),
+                            "sockOptionCache",
+                            "sock")
+{
+    CellularSockAddress_t remoteAddress;
+    CellularSockDescriptor_t sockDescriptor;
+    CellularSockOptionCacheStats_t stats;
+    CellularPort_timeval timeout;
+    int32_t value;
+    size_t length;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    stdDataTestInit(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT,
+                    &remoteAddress,
+                    CELLULAR_SOCK_TYPE_STREAM,
+                    CELLULAR_SOCK_PROTOCOL_TCP,
+                    &sockDescriptor);
+    cellularSockResetOptionCacheStats();
+
+    // These two are held until connect
+    cellularPortLog("CELLULAR_SOCK_TEST: setting TCP keep-idle and IP TOS"
+                    " before connect...\n");
+    value = 60;
+    CELLULAR_PORT_TEST_ASSERT(cellularSockSetOption(sockDescriptor,
+                                                    CELLULAR_SOCK_OPT_LEVEL_TCP,
+                                                    CELLULAR_SOCK_OPT_TCP_KEEPIDLE,
+                                                    &value, sizeof(value)) == 0);
+    value = 16;
+    CELLULAR_PORT_TEST_ASSERT(cellularSockSetOption(sockDescriptor,
+                                                    CELLULAR_SOCK_OPT_LEVEL_IP,
+                                                    CELLULAR_SOCK_OPT_IP_TOS,
+                                                    &value, sizeof(value)) == 0);
+    value = -1;
+    length = sizeof(value);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetOption(sockDescriptor,
+                                                    CELLULAR_SOCK_OPT_LEVEL_TCP,
+                                                    CELLULAR_SOCK_OPT_TCP_KEEPIDLE,
+                                                    &value, &length) == 0);
+    CELLULAR_PORT_TEST_ASSERT(length == sizeof(value));
+    CELLULAR_PORT_TEST_ASSERT(value == 60);
+
+    // The second of these should be skipped
+    cellularPortLog("CELLULAR_SOCK_TEST: setting reuse address, twice...\n");
+    value = 1;
+    for (size_t x = 0; x < 2; x++) {
+        CELLULAR_PORT_TEST_ASSERT(cellularSockSetOption(sockDescriptor,
+                                                        CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                        CELLULAR_SOCK_OPT_REUSEADDR,
+                                                        &value, sizeof(value)) == 0);
+    }
+
+    // Only the first get of keep-alive should go to
+    // the module, the others being answered locally
+    cellularPortLog("CELLULAR_SOCK_TEST: getting the options a TLS stack"
+                    " would, three times over...\n");
+    for (size_t x = 0; x < 3; x++) {
+        value = -1;
+        length = sizeof(value);
+        CELLULAR_PORT_TEST_ASSERT(cellularSockGetOption(sockDescriptor,
+                                                        CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                        CELLULAR_SOCK_OPT_ERROR,
+                                                        &value, &length) == 0);
+        CELLULAR_PORT_TEST_ASSERT(value == 0);
+        value = -1;
+        length = sizeof(value);
+        CELLULAR_PORT_TEST_ASSERT(cellularSockGetOption(sockDescriptor,
+                                                        CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                        CELLULAR_SOCK_OPT_TYPE,
+                                                        &value, &length) == 0);
+        CELLULAR_PORT_TEST_ASSERT(value == CELLULAR_SOCK_TYPE_STREAM);
+        value = -1;
+        length = sizeof(value);
+        CELLULAR_PORT_TEST_ASSERT(cellularSockGetOption(sockDescriptor,
+                                                        CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                        CELLULAR_SOCK_OPT_KEEPALIVE,
+                                                        &value, &length) == 0);
+        CELLULAR_PORT_TEST_ASSERT(value == 0);
+        length = sizeof(timeout);
+        CELLULAR_PORT_TEST_ASSERT(cellularSockGetOption(sockDescriptor,
+                                                        CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                        CELLULAR_SOCK_OPT_RCVTIMEO,
+                                                        &timeout, &length) == 0);
+    }
+
+    cellularPortLog("CELLULAR_SOCK_TEST: connecting to \"%s:%d\"...\n",
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockConnect(sockDescriptor,
+                                                  &remoteAddress) == 0);
+    CELLULAR_PORT_TEST_ASSERT(tcpEchoCheck(sockDescriptor));
+    value = -1;
+    length = sizeof(value);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetOption(sockDescriptor,
+                                                    CELLULAR_SOCK_OPT_LEVEL_IP,
+                                                    CELLULAR_SOCK_OPT_IP_TOS,
+                                                    &value, &length) == 0);
+    CELLULAR_PORT_TEST_ASSERT(value == 16);
+
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetOptionCacheStats(&stats) == 0);
+    cellularPortLog("CELLULAR_SOCK_TEST: %d get(s), %d hit(s), %d set(s), %d"
+                    " skipped, %d batched, %d AT command(s): saved %d AT"
+                    " command(s) per connection.\n", stats.numGets,
+                    stats.numGetHits, stats.numSets, stats.numSetSkips,
+                    stats.numSetsBatched, stats.numAtCommands,
+                    (int) (stats.numGets + stats.numSets - stats.numAtCommands));
+    CELLULAR_PORT_TEST_ASSERT(stats.numGets == 5);
+    CELLULAR_PORT_TEST_ASSERT(stats.numGetHits == 4);
+    CELLULAR_PORT_TEST_ASSERT(stats.numSets == 4);
+    CELLULAR_PORT_TEST_ASSERT(stats.numSetSkips == 1);
+    CELLULAR_PORT_TEST_ASSERT(stats.numSetsBatched == 2);
+    // Reuse address, the first keep-alive get and the batch
+    CELLULAR_PORT_TEST_ASSERT(stats.numAtCommands == 3);
+
+    cellularPort_errno_set(0);
+
+    stdDataTestDeinit(sockDescriptor);
+}
+
+/** Test the transmit buffer: small writes are gathered into
+ * one AT+USOWR and sent when the flush time expires, without
+ * anyone asking, or at once by cellularSockFlush() or by setting
+ * TCP_NODELAY.
+ */
+CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestTxBuffer(),
+                            "sockTxBuffer",
+                            "sock")
+{
+    CellularSockAddress_t remoteAddress;
+    CellularSockDescriptor_t sockDescriptor;
+    CellularSockDescriptorSet_t readSet;
+    CellularSockTxBufferStats_t stats;
+    int32_t value;
+    int32_t errorCode;
+    size_t sizeBytes;
+    int64_t startTimeMs;
+    int32_t elapsedMs;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    stdDataTestInit(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT,
+                    &remoteAddress,
+                    CELLULAR_SOCK_TYPE_STREAM,
+                    CELLULAR_SOCK_PROTOCOL_TCP,
+                    &sockDescriptor);
+
+    cellularPortLog("CELLULAR_SOCK_TEST: giving the socket a %d byte"
+                    " transmit buffer...\n",
+                    CELLULAR_SOCK_TEST_TX_BUFFER_SIZE_BYTES);
+    value = CELLULAR_SOCK_TEST_TX_BUFFER_SIZE_BYTES;
+    CELLULAR_PORT_TEST_ASSERT(cellularSockSetOption(sockDescriptor,
+                                                    CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                    CELLULAR_SOCK_OPT_SNDBUF,
+                                                    &value, sizeof(value)) == 0);
+    value = -1;
+    sizeBytes = sizeof(value);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetOption(sockDescriptor,
+                                                    CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                    CELLULAR_SOCK_OPT_SNDBUF,
+                                                    &value, &sizeBytes) == 0);
+    CELLULAR_PORT_TEST_ASSERT(value == CELLULAR_SOCK_TEST_TX_BUFFER_SIZE_BYTES);
+
+    cellularPortLog("CELLULAR_SOCK_TEST: connecting to \"%s:%d\"...\n",
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockConnect(sockDescriptor,
+                                                  &remoteAddress) == 0);
+
+    // Lots of small writes should go as one
+    cellularPortLog("CELLULAR_SOCK_TEST: %d writes of %d byte(s)...\n",
+                    CELLULAR_SOCK_TEST_TX_NUM_WRITES,
+                    CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES);
+    cellularSockResetTxBufferStats();
+    startTimeMs = cellularPortGetTickTimeMs();
+    for (size_t x = 0; x < CELLULAR_SOCK_TEST_TX_NUM_WRITES; x++) {
+        CELLULAR_PORT_TEST_ASSERT(cellularSockWrite(sockDescriptor,
+                                                    gSendData + (x * CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES),
+                                                    CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES) ==
+                                  CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES);
+    }
+    elapsedMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetTxBufferStats(&stats) == 0);
+    cellularPortLog("CELLULAR_SOCK_TEST: writes took %d ms, %d write(s),"
+                    " %d AT write(s), %d timed flush(es), %d byte(s) of"
+                    " buffer.\n", elapsedMs, stats.numWrites,
+                    stats.numAtWrites, stats.numTimedFlushes,
+                    stats.bufferBytesInUse);
+    CELLULAR_PORT_TEST_ASSERT(stats.numWrites == CELLULAR_SOCK_TEST_TX_NUM_WRITES);
+    CELLULAR_PORT_TEST_ASSERT(stats.numBytesWritten == CELLULAR_SOCK_TEST_TX_NUM_WRITES *
+                                                       CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES);
+    CELLULAR_PORT_TEST_ASSERT(stats.bufferBytesInUse == CELLULAR_SOCK_TEST_TX_BUFFER_SIZE_BYTES);
+    if (elapsedMs < CELLULAR_SOCK_TX_FLUSH_TIME_MS) {
+        // Too quick for the flush time to have expired
+        CELLULAR_PORT_TEST_ASSERT(stats.numAtWrites == 0);
+    }
+
+    // Nobody flushes, the echo should still arrive: select()
+    // doesn't send anything, it just waits
+    cellularPortLog("CELLULAR_SOCK_TEST: waiting for the echo without"
+                    " a flush...\n");
+    CELLULAR_SOCK_FD_ZERO(&readSet);
+    CELLULAR_SOCK_FD_SET(sockDescriptor, &readSet);
+    errorCode = cellularSockSelect(sockDescriptor + 1, &readSet, NULL, NULL,
+                                   CELLULAR_SOCK_RECEIVE_TIMEOUT_DEFAULT_MS);
+    elapsedMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+    cellularPortLog("CELLULAR_SOCK_TEST: cellularSockSelect() returned %d,"
+                    " %d ms after the first write.\n", errorCode, elapsedMs);
+    CELLULAR_PORT_TEST_ASSERT(errorCode == 1);
+    CELLULAR_PORT_TEST_ASSERT(elapsedMs >= CELLULAR_SOCK_TX_FLUSH_TIME_MS);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetTxBufferStats(&stats) == 0);
+    CELLULAR_PORT_TEST_ASSERT(stats.numTimedFlushes == 1);
+    CELLULAR_PORT_TEST_ASSERT(stats.numAtWrites == 1);
+    CELLULAR_PORT_TEST_ASSERT(tcpEchoReceive(sockDescriptor, gSendData,
+                                             CELLULAR_SOCK_TEST_TX_NUM_WRITES *
+                                             CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES));
+
+    // Flushing should send at once
+    cellularPortLog("CELLULAR_SOCK_TEST: write then cellularSockFlush()...\n");
+    cellularSockResetTxBufferStats();
+    startTimeMs = cellularPortGetTickTimeMs();
+    CELLULAR_PORT_TEST_ASSERT(cellularSockWrite(sockDescriptor, gSendData,
+                                                CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES) ==
+                              CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES);
+    elapsedMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockFlush(sockDescriptor) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetTxBufferStats(&stats) == 0);
+    cellularPortLog("CELLULAR_SOCK_TEST: flushed %d ms after the write, %d AT"
+                    " write(s), %d timed flush(es).\n", elapsedMs,
+                    stats.numAtWrites, stats.numTimedFlushes);
+    CELLULAR_PORT_TEST_ASSERT(stats.numAtWrites == 1);
+    if (elapsedMs < CELLULAR_SOCK_TX_FLUSH_TIME_MS) {
+        // Too quick for the flush time to have expired
+        CELLULAR_PORT_TEST_ASSERT(stats.numTimedFlushes == 0);
+    }
+    // Nothing left to flush
+    CELLULAR_PORT_TEST_ASSERT(cellularSockFlush(sockDescriptor) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetTxBufferStats(&stats) == 0);
+    CELLULAR_PORT_TEST_ASSERT(stats.numAtWrites == 1);
+    CELLULAR_PORT_TEST_ASSERT(tcpEchoReceive(sockDescriptor, gSendData,
+                                             CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES));
+
+    // Setting TCP_NODELAY should send what is buffered and
+    // then stop buffering
+    cellularPortLog("CELLULAR_SOCK_TEST: write then set TCP_NODELAY...\n");
+    cellularSockResetTxBufferStats();
+    startTimeMs = cellularPortGetTickTimeMs();
+    CELLULAR_PORT_TEST_ASSERT(cellularSockWrite(sockDescriptor, gSendData,
+                                                CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES) ==
+                              CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES);
+    value = 1;
+    elapsedMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockSetOption(sockDescriptor,
+                                                    CELLULAR_SOCK_OPT_LEVEL_TCP,
+                                                    CELLULAR_SOCK_OPT_TCP_NODELAY,
+                                                    &value, sizeof(value)) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetTxBufferStats(&stats) == 0);
+    cellularPortLog("CELLULAR_SOCK_TEST: TCP_NODELAY set %d ms after the write,"
+                    " %d AT write(s), %d timed flush(es).\n", elapsedMs,
+                    stats.numAtWrites, stats.numTimedFlushes);
+    CELLULAR_PORT_TEST_ASSERT(stats.numAtWrites == 1);
+    if (elapsedMs < CELLULAR_SOCK_TX_FLUSH_TIME_MS) {
+        // Too quick for the flush time to have expired
+        CELLULAR_PORT_TEST_ASSERT(stats.numTimedFlushes == 0);
+    }
+    CELLULAR_PORT_TEST_ASSERT(cellularSockWrite(sockDescriptor,
+                                                gSendData + CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES,
+                                                CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES) ==
+                              CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetTxBufferStats(&stats) == 0);
+    CELLULAR_PORT_TEST_ASSERT(stats.numAtWrites == 2);
+    CELLULAR_PORT_TEST_ASSERT(stats.numTimedFlushes == 0);
+    CELLULAR_PORT_TEST_ASSERT(tcpEchoReceive(sockDescriptor, gSendData,
+                                             CELLULAR_SOCK_TEST_TX_WRITE_SIZE_BYTES * 2));
+
+    cellularPort_errno_set(0);
+
+    stdDataTestDeinit(sockDescriptor);
+
+    // Closing the socket gives its transmit buffer back
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetTxBufferStats(&stats) == 0);
+    CELLULAR_PORT_TEST_ASSERT(stats.bufferBytesInUse == 0);
+}
+
+/** Test the traffic statistics of a socket and of all sockets.
+ */
+CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestStats(),
+                            "sockStats",
+                            "sock")
+{
+    CellularSockAddress_t remoteAddress;
+    CellularSockDescriptor_t sockDescriptor;
+    CellularSockStats_t stats;
+    CellularSockStats_t statsAll;
+    CellularPort_timeval timeout;
+    char buffer[32];
+    int64_t startTimeMs;
+    int32_t elapsedMs;
+    size_t numReads = 0;
+    size_t numWrites = 0;
+    size_t bucket = 0;
+    size_t x;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    stdDataTestInit(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT,
+                    &remoteAddress,
+                    CELLULAR_SOCK_TYPE_STREAM,
+                    CELLULAR_SOCK_PROTOCOL_TCP,
+                    &sockDescriptor);
+
+    // Start counting from here
+    cellularSockResetStats();
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetStatsAll(&statsAll) == 0);
+    CELLULAR_PORT_TEST_ASSERT(statsAll.numBytesSent == 0);
+    CELLULAR_PORT_TEST_ASSERT(statsAll.numBytesReceived == 0);
+
+    // A new socket has done nothing
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetStats(sockDescriptor, &stats) == 0);
+    CELLULAR_PORT_TEST_ASSERT(stats.numAtCommands == 0);
+    CELLULAR_PORT_TEST_ASSERT(stats.numConnects == 0);
+
+    cellularPortLog("CELLULAR_SOCK_TEST: connecting to \"%s:%d\"...\n",
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockConnect(sockDescriptor,
+                                                  &remoteAddress) == 0);
+    CELLULAR_PORT_TEST_ASSERT(tcpEchoCheck(sockDescriptor));
+
+    // Nothing more is coming, so a short read should
+    // time out and say that it would have blocked
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 500000;
+    CELLULAR_PORT_TEST_ASSERT(cellularSockSetOption(sockDescriptor,
+                                                    CELLULAR_SOCK_OPT_LEVEL_SOCK,
+                                                    CELLULAR_SOCK_OPT_RCVTIMEO,
+                                                    (void *) &timeout,
+                                                    sizeof(timeout)) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetStats(sockDescriptor, &statsAll) == 0);
+    startTimeMs = cellularPortGetTickTimeMs();
+    CELLULAR_PORT_TEST_ASSERT(cellularSockRead(sockDescriptor, buffer,
+                                               sizeof(buffer)) < 0);
+    elapsedMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EWOULDBLOCK);
+    cellularPort_errno_set(0);
+    while ((bucket < CELLULAR_SOCK_STATS_LATENCY_NUM_BUCKETS - 1) &&
+           (elapsedMs >= CELLULAR_SOCK_STATS_LATENCY_FIRST_BUCKET_MS << bucket)) {
+        bucket++;
+    }
+
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetStats(sockDescriptor, &stats) == 0);
+    for (x = 0; x < CELLULAR_SOCK_STATS_LATENCY_NUM_BUCKETS; x++) {
+        numReads += stats.readLatency[x];
+        numWrites += stats.writeLatency[x];
+    }
+    cellularPortLog("CELLULAR_SOCK_TEST: sent %d byte(s) in %d segment(s),"
+                    " received %d byte(s) in %d segment(s), %d AT command(s),"
+                    " %d partial send(s), %d would-block(s), %d URC(s),"
+                    " connect took %d ms, %d read(s), %d write(s).\n",
+                    stats.numBytesSent, stats.numSegmentsSent,
+                    stats.numBytesReceived, stats.numSegmentsReceived,
+                    stats.numAtCommands, stats.numPartialSends,
+                    stats.numWouldBlocks, stats.numUrcs, stats.connectTimeMs,
+                    numReads, numWrites);
+    CELLULAR_PORT_TEST_ASSERT(stats.numBytesSent == sizeof(gSendData) - 1);
+    CELLULAR_PORT_TEST_ASSERT(stats.numBytesReceived == sizeof(gSendData) - 1);
+    CELLULAR_PORT_TEST_ASSERT(stats.numSegmentsSent > 0);
+    CELLULAR_PORT_TEST_ASSERT(stats.numSegmentsReceived > 0);
+    // The connect, the sends and the reads, at least
+    CELLULAR_PORT_TEST_ASSERT(stats.numAtCommands >= 1 + stats.numSegmentsSent +
+                                                     stats.numSegmentsReceived);
+    CELLULAR_PORT_TEST_ASSERT(stats.numSendsAbandoned == 0);
+    CELLULAR_PORT_TEST_ASSERT(stats.numConnects == 1);
+    CELLULAR_PORT_TEST_ASSERT(stats.numUrcs > 0);
+    CELLULAR_PORT_TEST_ASSERT(stats.numWouldBlocks == statsAll.numWouldBlocks + 1);
+    CELLULAR_PORT_TEST_ASSERT(stats.readLatency[bucket] == statsAll.readLatency[bucket] + 1);
+    CELLULAR_PORT_TEST_ASSERT(numWrites >= 1);
+
+    // Once closed, the socket's statistics are in the totals
+    cellularPortLog("CELLULAR_SOCK_TEST: closing the socket...\n");
+    CELLULAR_PORT_TEST_ASSERT(cellularSockClose(sockDescriptor) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetStats(sockDescriptor, &statsAll) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EBADF);
+    cellularPort_errno_set(0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetStatsAll(&statsAll) == 0);
+    CELLULAR_PORT_TEST_ASSERT(statsAll.numBytesSent == stats.numBytesSent);
+    CELLULAR_PORT_TEST_ASSERT(statsAll.numBytesReceived == stats.numBytesReceived);
+    CELLULAR_PORT_TEST_ASSERT(statsAll.numConnects == 1);
+    CELLULAR_PORT_TEST_ASSERT(statsAll.connectTimeMs == stats.connectTimeMs);
+    for (x = 0; x < CELLULAR_SOCK_STATS_LATENCY_NUM_BUCKETS; x++) {
+        CELLULAR_PORT_TEST_ASSERT(statsAll.readLatency[x] == stats.readLatency[x]);
+    }
+
+    // ...and stay there when the container is used again
+    sockDescriptor = cellularSockCreate(CELLULAR_SOCK_TYPE_STREAM,
+                                        CELLULAR_SOCK_PROTOCOL_TCP);
+    CELLULAR_PORT_TEST_ASSERT(sockDescriptor >= 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetStatsAll(&statsAll) == 0);
+    CELLULAR_PORT_TEST_ASSERT(statsAll.numBytesSent == stats.numBytesSent);
+    cellularSockResetStats();
+    CELLULAR_PORT_TEST_ASSERT(cellularSockGetStatsAll(&statsAll) == 0);
+    CELLULAR_PORT_TEST_ASSERT(statsAll.numBytesSent == 0);
+    CELLULAR_PORT_TEST_ASSERT(statsAll.numConnects == 0);
+
+    stdDataTestDeinit(sockDescriptor);
+}
+
+/** Test receiving TCP data through a registered receiver,
+ * including pausing and resuming it.
+ */
+CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestReceiver(),
+                            "sockReceiver",
+                            "sock")
+{
+    CellularSockAddress_t remoteAddress;
+    CellularSockDescriptor_t sockDescriptor;
+    CellularSockDescriptor_t udpSockDescriptor;
+    CellularSockTestReceiverData_t receiverData;
+    size_t offset;
+    int64_t startTimeMs;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    pCellularPort_memset(&receiverData, 0, sizeof(receiverData));
+    receiverData.sizeBytes = sizeof(gSendData) - 1;
+    receiverData.pBuffer = (char *) pCellularPort_malloc(receiverData.sizeBytes +
+                                                         (CELLULAR_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+    CELLULAR_PORT_TEST_ASSERT(receiverData.pBuffer != NULL);
+    pCellularPort_memset(receiverData.pBuffer,
+                         CELLULAR_SOCK_TEST_FILL_CHARACTER,
+                         receiverData.sizeBytes + (CELLULAR_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+
+    stdDataTestInit(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT,
+                    &remoteAddress,
+                    CELLULAR_SOCK_TYPE_STREAM,
+                    CELLULAR_SOCK_PROTOCOL_TCP,
+                    &sockDescriptor);
+    receiverData.sockDescriptor = sockDescriptor;
+
+    // Only TCP sockets can have a receiver
+    udpSockDescriptor = cellularSockCreate(CELLULAR_SOCK_TYPE_DGRAM,
+                                           CELLULAR_SOCK_PROTOCOL_UDP);
+    CELLULAR_PORT_TEST_ASSERT(udpSockDescriptor >= 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockRegisterReceiver(udpSockDescriptor,
+                                                           testReceiver,
+                                                           &receiverData) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EOPNOTSUPP);
+    cellularPort_errno_set(0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockClose(udpSockDescriptor) == 0);
+    // ...and there is nothing to resume without one
+    CELLULAR_PORT_TEST_ASSERT(cellularSockReceiverResume(sockDescriptor) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularPort_errno_get() == CELLULAR_SOCK_EINVAL);
+    cellularPort_errno_set(0);
+
+    cellularPortLog("CELLULAR_SOCK_TEST: connecting to \"%s:%d\"...\n",
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockConnect(sockDescriptor,
+                                                  &remoteAddress) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockRegisterReceiver(sockDescriptor,
+                                                           testReceiver,
+                                                           &receiverData) == 0);
+
+    // Ask for a pause straight away: the module gives us
+    // no more than a segment at a time so the data can't
+    // all arrive before the pause takes effect
+    receiverData.pause = true;
+    CELLULAR_PORT_TEST_ASSERT(sendTcp(sockDescriptor, gSendData,
+                                      sizeof(gSendData) - 1) == sizeof(gSendData) - 1);
+    startTimeMs = cellularPortGetTickTimeMs();
+    while ((receiverData.numCalls == 0) &&
+           (cellularPortGetTickTimeMs() - startTimeMs < 20000)) {
+        cellularPortTaskBlock(100);
+    }
+    CELLULAR_PORT_TEST_ASSERT(receiverData.numCalls > 0);
+    // Give it time to finish the segment in hand, then
+    // check that nothing more arrives
+    cellularPortTaskBlock(1000);
+    offset = receiverData.offset;
+    cellularPortLog("CELLULAR_SOCK_TEST: paused after %d byte(s) in %d call(s).\n",
+                    offset, receiverData.numCalls);
+    CELLULAR_PORT_TEST_ASSERT(offset > 0);
+    CELLULAR_PORT_TEST_ASSERT(offset <= CELLULAR_SOCK_MAX_SEGMENT_LENGTH_BYTES);
+    cellularPortTaskBlock(2000);
+    CELLULAR_PORT_TEST_ASSERT(receiverData.offset == offset);
+
+    // Resume and get the rest
+    CELLULAR_PORT_TEST_ASSERT(cellularSockReceiverResume(sockDescriptor) == 0);
+    startTimeMs = cellularPortGetTickTimeMs();
+    while ((receiverData.offset < receiverData.sizeBytes) &&
+           (cellularPortGetTickTimeMs() - startTimeMs < 20000)) {
+        cellularPortTaskBlock(100);
+    }
+    cellularPortLog("CELLULAR_SOCK_TEST: received %d byte(s) in %d call(s).\n",
+                    receiverData.offset, receiverData.numCalls);
+    CELLULAR_PORT_TEST_ASSERT(!receiverData.wrongDescriptor);
+    CELLULAR_PORT_TEST_ASSERT(checkAgainstSentData(gSendData, sizeof(gSendData) - 1,
+                                                   receiverData.pBuffer,
+                                                   receiverData.offset));
+
+    // Cancel the receiver and check that the data goes
+    // back to cellularSockRead()
+    CELLULAR_PORT_TEST_ASSERT(cellularSockRegisterReceiver(sockDescriptor,
+                                                           NULL, NULL) == 0);
+    offset = receiverData.offset;
+    CELLULAR_PORT_TEST_ASSERT(tcpEchoCheck(sockDescriptor));
+    CELLULAR_PORT_TEST_ASSERT(receiverData.offset == offset);
+
+    cellularPort_free(receiverData.pBuffer);
+
+    stdDataTestDeinit(sockDescriptor);
+}
+
+/** Test that control commands get their turn on the AT interface
+ * promptly while a socket keeps it busy.
+ */
+CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestAtArbiter(),
+                            "sockAtArbiter",
+                            "sock")
+{
+    CellularSockAddress_t remoteAddress;
+    CellularSockTestConcurrentTaskData_t pumpData;
+    CellularPortTaskHandle_t taskHandle;
+    CellularCtrlAtClientStats_t ctrlStats;
+    CellularCtrlAtClientStats_t sockStats;
+    CellularCtrlAtClientStats_t urcStats;
+    int64_t startTimeMs;
+    int32_t elapsedMs;
+    int32_t maxElapsedMs = 0;
+    size_t numRefreshes = 0;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    pCellularPort_memset(&pumpData, 0, sizeof(pumpData));
+    stdDataTestInit(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT,
+                    &remoteAddress,
+                    CELLULAR_SOCK_TYPE_STREAM,
+                    CELLULAR_SOCK_PROTOCOL_TCP,
+                    &(pumpData.sockDescriptor));
+
+    // Clients can be configured but not given a weight of zero
+    // and the maximum hold time must be positive
+    CELLULAR_PORT_TEST_ASSERT(cellularCtrlSetAtClient(CELLULAR_CTRL_AT_CLIENT_MQTT,
+                                                      CELLULAR_CTRL_AT_CLIENT_DATA_PRIORITY,
+                                                      0) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularCtrlSetAtClient(CELLULAR_CTRL_AT_MAX_NUM_CLIENTS,
+                                                      CELLULAR_CTRL_AT_CLIENT_DATA_PRIORITY,
+                                                      CELLULAR_CTRL_AT_CLIENT_WEIGHT) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularCtrlSetAtClient(CELLULAR_CTRL_AT_CLIENT_MQTT,
+                                                      CELLULAR_CTRL_AT_CLIENT_DATA_PRIORITY,
+                                                      CELLULAR_CTRL_AT_CLIENT_WEIGHT) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularCtrlSetAtMaxHoldTime(0) < 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularCtrlSetAtMaxHoldTime(CELLULAR_CTRL_AT_MAX_HOLD_TIME_MS) == 0);
+
+    cellularPortLog("CELLULAR_SOCK_TEST: connecting to \"%s:%d\"...\n",
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockConnect(pumpData.sockDescriptor,
+                                                  &remoteAddress) == 0);
+
+    cellularCtrlResetAtClientStats();
+    pumpData.timeMs = CELLULAR_SOCK_TEST_ARBITER_LOAD_TIME_MS;
+    CELLULAR_PORT_TEST_ASSERT(cellularPortTaskCreate(echoPumpTask,
+                                                     "testTaskEchoPump",
+                                                     CELLULAR_PORT_TEST_SOCK_TASK_STACK_SIZE_BYTES,
+                                                     (void *) &pumpData,
+                                                     CELLULAR_PORT_TEST_SOCK_TASK_PRIORITY,
+                                                     &taskHandle) == 0);
+
+    // Refresh the radio parameters over and over while the
+    // socket is busy
+    while (!pumpData.done) {
+        startTimeMs = cellularPortGetTickTimeMs();
+        cellularCtrlRefreshRadioParameters();
+        elapsedMs = (int32_t) (cellularPortGetTickTimeMs() - startTimeMs);
+        if (elapsedMs > maxElapsedMs) {
+            maxElapsedMs = elapsedMs;
+        }
+        numRefreshes++;
+        cellularPortTaskBlock(CELLULAR_SOCK_TEST_TIME_MARGIN_MS);
+    }
+    CELLULAR_PORT_TEST_ASSERT(pumpData.returnCode == 0);
+
+    CELLULAR_PORT_TEST_ASSERT(cellularCtrlGetAtClientStats(CELLULAR_CTRL_AT_CLIENT_CTRL,
+                                                           &ctrlStats) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularCtrlGetAtClientStats(CELLULAR_CTRL_AT_CLIENT_SOCK +
+                                                           pumpData.sockDescriptor,
+                                                           &sockStats) == 0);
+    CELLULAR_PORT_TEST_ASSERT(cellularCtrlGetAtClientStats(CELLULAR_CTRL_AT_CLIENT_URC,
+                                                           &urcStats) == 0);
+    cellularPortLog("CELLULAR_SOCK_TEST: %d radio parameter refresh(es), the longest"
+                    " taking %d ms.\n", numRefreshes, maxElapsedMs);
+    cellularPortLog("CELLULAR_SOCK_TEST: control: %d turn(s), %d wait(s),"
+                    " longest wait %d ms, longest hold %d ms.\n",
+                    ctrlStats.numTurns, ctrlStats.numWaits,
+                    (int32_t) ctrlStats.maxWaitMs, (int32_t) ctrlStats.maxHoldMs);
+    cellularPortLog("CELLULAR_SOCK_TEST: socket: %d turn(s), %d wait(s),"
+                    " longest wait %d ms, longest hold %d ms, %d overrun(s).\n",
+                    sockStats.numTurns, sockStats.numWaits,
+                    (int32_t) sockStats.maxWaitMs, (int32_t) sockStats.maxHoldMs,
+                    sockStats.numOverruns);
+    cellularPortLog("CELLULAR_SOCK_TEST: URCs: %d turn(s), longest hold %d ms.\n",
+                    urcStats.numTurns, (int32_t) urcStats.maxHoldMs);
+    CELLULAR_PORT_TEST_ASSERT(numRefreshes > 0);
+    CELLULAR_PORT_TEST_ASSERT(ctrlStats.numTurns >= numRefreshes);
+    CELLULAR_PORT_TEST_ASSERT(sockStats.numTurns > 0);
+    CELLULAR_PORT_TEST_ASSERT(ctrlStats.queueDepth == 0);
+    CELLULAR_PORT_TEST_ASSERT(sockStats.queueDepth == 0);
+    // Control goes ahead of the socket, so it should never
+    // have to wait for more than the turn in progress plus
+    // any URCs that are waiting
+    CELLULAR_PORT_TEST_ASSERT(ctrlStats.maxWaitMs <= sockStats.maxHoldMs +
+                                                     urcStats.maxHoldMs +
+                                                     CELLULAR_SOCK_TEST_TIME_MARGIN_MS);
+
+    stdDataTestDeinit(pumpData.sockDescriptor);
+}
+
+/** Test switching hex mode on and off with a TCP socket open,
+ * echoing every byte value in each mode.
+ */
+CELLULAR_PORT_TEST_FUNCTION(void cellularSockTestHexMode(),
+                            "sockHexMode",
+                            "sock")
+{
+    CellularSockDescriptor_t sockDescriptor;
+    CellularSockAddress_t remoteAddress;
+    char dataSent[256];
+    char dataReceived[sizeof(dataSent)];
+    bool hexMode;
+    size_t offset;
+    int32_t x;
+    int64_t startTimeMs;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    for (size_t y = 0; y < sizeof(dataSent); y++) {
+        dataSent[y] = (char) y;
+    }
+
+    stdDataTestInit(CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT,
+                    &remoteAddress,
+                    CELLULAR_SOCK_TYPE_STREAM,
+                    CELLULAR_SOCK_PROTOCOL_TCP,
+                    &sockDescriptor);
+
+    cellularPortLog("CELLULAR_SOCK_TEST: connecting to \"%s:%d\"...\n",
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                    CELLULAR_CFG_TEST_ECHO_TCP_SERVER_PORT);
+    CELLULAR_PORT_TEST_ASSERT(cellularSockConnect(sockDescriptor,
+                                                  &remoteAddress) == 0);
+
+    hexMode = cellularCtrlGetSockHexMode();
+    CELLULAR_PORT_TEST_ASSERT(hexMode == CELLULAR_CFG_SOCK_HEX_MODE);
+    // Do it in the default mode, then the other one, then back
+    for (size_t y = 0; y < 3; y++) {
+        cellularPortLog("CELLULAR_SOCK_TEST: hex mode %s.\n",
+                        hexMode ? "on" : "off");
+        CELLULAR_PORT_TEST_ASSERT(tcpEchoCheck(sockDescriptor));
+        CELLULAR_PORT_TEST_ASSERT(sendTcp(sockDescriptor, dataSent,
+                                          sizeof(dataSent)) == sizeof(dataSent));
+        pCellularPort_memset(dataReceived, 0, sizeof(dataReceived));
+        offset = 0;
+        startTimeMs = cellularPortGetTickTimeMs();
+        while ((offset < sizeof(dataReceived)) &&
+               (cellularPortGetTickTimeMs() - startTimeMs < 20000)) {
+            x = cellularSockRead(sockDescriptor, dataReceived + offset,
+                                 sizeof(dataReceived) - offset);
+            if (x > 0) {
+                offset += x;
+            }
+        }
+        cellularPort_errno_set(0);
+        CELLULAR_PORT_TEST_ASSERT(offset == sizeof(dataReceived));
+        CELLULAR_PORT_TEST_ASSERT(cellularPort_memcmp(dataSent, dataReceived,
+                                                      sizeof(dataSent)) == 0);
+        hexMode = !hexMode;
+        CELLULAR_PORT_TEST_ASSERT(cellularCtrlSetSockHexMode(hexMode) == 0);
+        CELLULAR_PORT_TEST_ASSERT(cellularCtrlGetSockHexMode() == hexMode);
+    }
+    CELLULAR_PORT_TEST_ASSERT(cellularCtrlSetSockHexMode(CELLULAR_CFG_SOCK_HEX_MODE) == 0);
+
+    stdDataTestDeinit(sockDescriptor);
+}
+
 /** Clean-up to be run at the end of this round of tests, just
  * in case there were test failures which would have resulted
  * in the deinitialisation being skipped.